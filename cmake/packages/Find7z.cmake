@@ -4,9 +4,11 @@
 # 7Z_INCLUDE_DIR
 # 7Z_LIBRARIES
 # 7Z_FOUND
+# 7ZMT_LIBRARIES (if the multi-threaded library is installed)
 #
 # Additionally, one of the following import targets will be defined:
-# z
+# LLVM_STATIC_7z
+# LLVM_STATIC_7zmt (if the multi-threaded library is installed)
 
 find_package(PkgConfig QUIET)
 pkg_check_modules(PC_7Z QUIET 7Z)
@@ -34,6 +36,17 @@ find_library(7Z_LIBRARIES NAMES lib7z.a
   NO_CMAKE_FIND_ROOT_PATH
 )
 
+find_library(7ZMT_LIBRARIES NAMES lib7zmt.a
+  PATHS ${LLVM_BUILD_ROOT__ROOTFS}/lib
+  NO_DEFAULT_PATH
+  NO_PACKAGE_ROOT_PATH
+  NO_CMAKE_PATH
+  NO_CMAKE_ENVIRONMENT_PATH
+  NO_SYSTEM_ENVIRONMENT_PATH
+  NO_CMAKE_SYSTEM_PATH
+  NO_CMAKE_FIND_ROOT_PATH
+)
+
 set(CMAKE_FIND_DEBUG_MODE FALSE)
 
 include(CheckIncludeFile)
@@ -65,12 +78,23 @@ find_package_handle_standard_args(7z
                                     7Z_LIBRARIES
                                   VERSION_VAR
                                     7Z_VERSION_STRING)
-mark_as_advanced(7Z_INCLUDE_DIRS 7Z_LIBRARIES)
+mark_as_advanced(7Z_INCLUDE_DIRS 7Z_LIBRARIES 7ZMT_LIBRARIES)
 
 if (7Z_FOUND AND NOT TARGET LLVM_STATIC_7z)
   add_library(LLVM_STATIC_7z UNKNOWN IMPORTED)
   set_target_properties(LLVM_STATIC_7z PROPERTIES
                         IMPORTED_LOCATION ${7Z_LIBRARIES}
-                        INTERFACE_INCLUDE_DIRECTORIES ${7Z_INCLUDE_DIRS})
+                        INTERFACE_INCLUDE_DIRECTORIES ${7Z_INCLUDE_DIRS}
+                        INTERFACE_COMPILE_DEFINITIONS Z7_ST)
   set(7Z_TARGET LLVM_STATIC_7z)
 endif()
+
+if (7Z_FOUND AND 7ZMT_LIBRARIES AND NOT TARGET LLVM_STATIC_7zmt)
+  find_package(Threads REQUIRED)
+  add_library(LLVM_STATIC_7zmt UNKNOWN IMPORTED)
+  set_target_properties(LLVM_STATIC_7zmt PROPERTIES
+                        IMPORTED_LOCATION ${7ZMT_LIBRARIES}
+                        INTERFACE_INCLUDE_DIRECTORIES ${7Z_INCLUDE_DIRS}
+                        INTERFACE_LINK_LIBRARIES Threads::Threads)
+  set(7ZMT_TARGET LLVM_STATIC_7zmt)
+endif()
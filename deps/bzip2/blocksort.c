@@ -1015,6 +1015,335 @@ void mainSort ( UInt32* ptr,
 #undef CLEARMASK
 
 
+/*---------------------------------------------*/
+/*--- Linear-time sorting by induced        ---*/
+/*--- sorting (SA-IS), for any block        ---*/
+/*---------------------------------------------*/
+
+/* The rotations of a block are sorted through the suffix
+   array of a rotation of the block that is a Lyndon word
+   (its least rotation).  For a Lyndon word L, the order of
+   the suffixes of L, with an implicit sentinel that is
+   smaller than any symbol, is the same as the order of
+   its rotations.  This holds only if all the rotations are
+   different, so periodic blocks are not handled here.
+
+   The suffix array is built with the SA-IS algorithm of
+   Nong, Zhang and Chan; the implementation follows the
+   layout of Yuta Mori's sais-lite.  The types of suffixes
+   are not stored, they are recomputed from the text and
+   encoded in the sign of SA entries while inducing.  Texts
+   are bytes (cs == 1) at the top level and Int32s (cs == 4)
+   in the reduced problems, which live in the tail of SA.
+*/
+
+#define SAIS_CHR(i) \
+   (cs == 1 ? (Int32)((const UChar*)T)[i] : ((const Int32*)T)[i])
+
+/*---------------------------------------------*/
+static
+void saisGetCounts ( const void* T,
+                     Int32*      C,
+                     Int32       n,
+                     Int32       k,
+                     Int32       cs )
+{
+   Int32 i;
+   for (i = 0; i < k; i++) C[i] = 0;
+   for (i = 0; i < n; i++) C[SAIS_CHR(i)]++;
+}
+
+
+/*---------------------------------------------*/
+/* C and B may be the same array. */
+static
+void saisGetBuckets ( const Int32* C,
+                      Int32*       B,
+                      Int32        k,
+                      Bool         end )
+{
+   Int32 i, c, sum = 0;
+   if (end) {
+      for (i = 0; i < k; i++) { sum += C[i]; B[i] = sum; }
+   } else {
+      for (i = 0; i < k; i++) { c = C[i]; B[i] = sum; sum += c; }
+   }
+}
+
+
+/*---------------------------------------------*/
+/* Pre:
+      SA holds the seed S-type suffixes at the ends of
+      their buckets and zeroes elsewhere.
+   Post:
+      SA holds all the suffixes, induced from the seeds.
+*/
+static
+void saisInduce ( const void* T,
+                  Int32*      SA,
+                  Int32*      C,
+                  Int32*      B,
+                  Int32       n,
+                  Int32       k,
+                  Int32       cs )
+{
+   Int32 *b, i, j, c0, c1;
+
+   /* L-type suffixes, left to right; the suffix n-1
+      follows the sentinel.  A negative entry is an
+      L-type suffix preceded by an S-type one. */
+   if (C == B) saisGetCounts ( T, C, n, k, cs );
+   saisGetBuckets ( C, B, k, False );
+   j = n - 1;
+   b = SA + B[c1 = SAIS_CHR(j)];
+   *b++ = ((0 < j) && (SAIS_CHR(j - 1) < c1)) ? ~j : j;
+   for (i = 0; i < n; i++) {
+      j = SA[i];
+      SA[i] = ~j;
+      if (0 < j) {
+         j--;
+         if ((c0 = SAIS_CHR(j)) != c1) {
+            B[c1] = (Int32)(b - SA);
+            b = SA + B[c1 = c0];
+         }
+         *b++ = ((0 < j) && (SAIS_CHR(j - 1) < c1)) ? ~j : j;
+      }
+   }
+
+   /* S-type suffixes, right to left */
+   if (C == B) saisGetCounts ( T, C, n, k, cs );
+   saisGetBuckets ( C, B, k, True );
+   c1 = 0;
+   b = SA + B[c1];
+   for (i = n - 1; 0 <= i; i--) {
+      if (0 < (j = SA[i])) {
+         j--;
+         if ((c0 = SAIS_CHR(j)) != c1) {
+            B[c1] = (Int32)(b - SA);
+            b = SA + B[c1 = c0];
+         }
+         *--b = ((j == 0) || (SAIS_CHR(j - 1) > c1)) ? ~j : j;
+      } else {
+         SA[i] = ~j;
+      }
+   }
+}
+
+
+/*---------------------------------------------*/
+/* Scans T right to left and calls STMT with i + 1
+   being each LMS position, from the rightmost one.
+   j is the previous LMS position (n at first).
+*/
+#define SAIS_FOR_EACH_LMS(STMT)                          \
+{                                                        \
+   i = n - 1; j = n; c0 = SAIS_CHR(n - 1);               \
+   do { c1 = c0; }                                       \
+      while ((0 <= --i) && ((c0 = SAIS_CHR(i)) >= c1));  \
+   while (0 <= i) {                                      \
+      do { c1 = c0; }                                    \
+         while ((0 <= --i) && ((c0 = SAIS_CHR(i)) <= c1)); \
+      if (0 <= i) {                                      \
+         STMT;                                           \
+         j = i + 1;                                      \
+         do { c1 = c0; }                                 \
+            while ((0 <= --i) && ((c0 = SAIS_CHR(i)) >= c1)); \
+      }                                                  \
+   }                                                     \
+}
+
+
+/*---------------------------------------------*/
+/* Pre:
+      T [0 .. n-1] holds the text, 0 <= T[i] < k
+      SA exists for [0 .. n-1]
+      bkt exists for [0 .. n/2-1], for the reduced problems
+      C, B exist for [0 .. k-1]; they may be the same array
+   Post:
+      SA [0 .. n-1] holds the suffix array of T
+      C, B and bkt destroyed
+*/
+static
+void saisMain ( const void* T,
+                Int32*      SA,
+                Int32*      C,
+                Int32*      B,
+                Int32*      bkt,
+                Int32       n,
+                Int32       k,
+                Int32       cs )
+{
+   Int32 *RA;
+   Int32 i, j, m, p, q, plen, qlen, name, c0, c1;
+   Bool  diff;
+
+   /* stage 1: sort the LMS-substrings by inducing
+      from the LMS positions in any order */
+   saisGetCounts ( T, C, n, k, cs );
+   saisGetBuckets ( C, B, k, True );
+   for (i = 0; i < n; i++) SA[i] = 0;
+   m = 0;
+   SAIS_FOR_EACH_LMS ( SA[--B[SAIS_CHR(i + 1)]] = i + 1; m++ );
+
+   saisInduce ( T, SA, C, B, n, k, cs );
+   if (m == 0) {
+      /* no LMS positions: inducing from the sentinel
+         alone sorted everything */
+      return;
+   }
+
+   /* compact the sorted LMS-substrings into SA [0 .. m-1] */
+   for (i = 0, q = 0; i < n; i++) {
+      p = SA[i];
+      if (0 < p && SAIS_CHR(p - 1) > (c0 = SAIS_CHR(p))) {
+         for (j = p + 1; j < n && c0 == (c1 = SAIS_CHR(j)); j++) ;
+         if (j < n && c0 < c1) SA[q++] = p;
+      }
+   }
+   AssertH ( q == m, 1010 );
+
+   /* store the length of each LMS-substring, up to and
+      including the next LMS position, in SA [m + p/2].
+      LMS positions are at least two apart, so these
+      slots are distinct. */
+   for (i = m; i < n; i++) SA[i] = 0;
+   SAIS_FOR_EACH_LMS ( SA[m + ((i + 1) >> 1)] = j - i );
+
+   /* name the LMS-substrings; the rightmost one holds
+      the sentinel and is unique */
+   name = 0;
+   q = n;
+   qlen = 0;
+   for (i = 0; i < m; i++) {
+      p = SA[i];
+      plen = SA[m + (p >> 1)];
+      diff = True;
+      if (plen == qlen && p + plen <= n && q + plen <= n) {
+         for (j = 0; j < plen && SAIS_CHR(p + j) == SAIS_CHR(q + j); j++) ;
+         if (j == plen) diff = False;
+      }
+      if (diff) { name++; q = p; qlen = plen; }
+      SA[m + (p >> 1)] = name;
+   }
+
+   /* the reduced text goes to the tail of SA */
+   for (i = n - 1, j = n - 1; m <= i; i--)
+      if (SA[i] != 0) SA[j--] = SA[i] - 1;
+   RA = SA + n - m;
+
+   /* stage 2: sort the reduced problem */
+   if (name < m) {
+      saisMain ( RA, SA, bkt, bkt, bkt, m, name, sizeof(Int32) );
+   } else {
+      for (i = 0; i < m; i++) SA[RA[i]] = i;
+   }
+
+   /* stage 3: map the reduced suffix array to the LMS
+      positions, put them at the ends of their buckets,
+      and induce */
+   q = m;
+   SAIS_FOR_EACH_LMS ( RA[--q] = i + 1 );
+   for (i = 0; i < m; i++) SA[i] = RA[SA[i]];
+
+   if (C == B) saisGetCounts ( T, C, n, k, cs );
+   saisGetBuckets ( C, B, k, True );
+   for (i = m; i < n; i++) SA[i] = 0;
+   i = m - 1;
+   j = n;
+   p = SA[m - 1];
+   c1 = SAIS_CHR(p);
+   do {
+      q = B[c0 = c1];
+      while (q < j) SA[--j] = 0;
+      do {
+         SA[--j] = p;
+         if (--i < 0) break;
+         p = SA[i];
+      } while ((c1 = SAIS_CHR(p)) == c0);
+   } while (0 <= i);
+   while (0 < j) SA[--j] = 0;
+
+   saisInduce ( T, SA, C, B, n, k, cs );
+}
+
+#undef SAIS_FOR_EACH_LMS
+#undef SAIS_CHR
+
+
+/*---------------------------------------------*/
+/* Pre:
+      nblock > 0
+      arr2 exists for [0 .. nblock-1 +N_OVERSHOOT]
+      ((UChar*)arr2)  [0 .. nblock-1] holds block
+      arr1 exists for [0 .. nblock-1]
+
+   Post:
+      if the block is periodic, returns False and
+      leaves everything as it was.  Otherwise:
+      ((UChar*)arr2) [0 .. nblock-1] holds block
+      All other areas of block destroyed
+      ftab [ 0 .. 511 ] destroyed
+      arr1 [0 .. nblock-1] holds sorted order
+*/
+static
+Bool saisSort ( UInt32* ptr,
+                UChar*  block,
+                UInt32* ftab,
+                Int32   nblock,
+                Int32   verb )
+{
+   Int32  i, j, k, r, a, b;
+   UChar* text;
+   Int32* bkt;
+
+   /* Find the least rotation (two-pointer minimal
+      rotation search).  k reaching nblock means two
+      different rotations are equal: the block is
+      periodic. */
+   i = 0; j = 1; k = 0;
+   while (i < nblock && j < nblock && k < nblock) {
+      a = i + k; if (a >= nblock) a -= nblock;
+      b = j + k; if (b >= nblock) b -= nblock;
+      if (block[a] == block[b]) {
+         k++;
+      } else {
+         if (block[a] > block[b]) i += k + 1; else j += k + 1;
+         if (i == j) j++;
+         k = 0;
+      }
+   }
+   if (k >= nblock) {
+      if (verb >= 2)
+         VPrintf0 ( "    periodic block; using the"
+                    " main sorting algorithm\n" );
+      return False;
+   }
+   r = i < j ? i : j;
+
+   /* The Lyndon rotation goes after the block, the
+      buckets of the reduced problems after it. */
+   text = block + nblock;
+   for (i = 0; i < nblock - r; i++) text[i] = block[r + i];
+   for (; i < nblock; i++) text[i] = block[i - (nblock - r)];
+   i = 2 * nblock;
+   i = (i + 3) & ~3;
+   bkt = (Int32*)(&(block[i]));
+
+   saisMain ( text, (Int32*)ptr, (Int32*)ftab, (Int32*)ftab + 256,
+              bkt, nblock, 256, 1 );
+
+   for (i = 0; i < nblock; i++) {
+      j = (Int32)ptr[i] + r;
+      if (j >= nblock) j -= nblock;
+      ptr[i] = (UInt32)j;
+   }
+
+   if (verb >= 3)
+      VPrintf1 ( "      SA-IS, least rotation at %d\n", r );
+   return True;
+}
+
+
 /*---------------------------------------------*/
 /* Pre:
       nblock > 0
@@ -1041,7 +1370,11 @@ void BZ2_blockSort ( EState* s )
    Int32   budgetInit;
    Int32   i;
 
-   if (nblock < 10000) {
+   if (s->sortAlgorithm == BZ_SORT_SAIS &&
+       saisSort ( ptr, block, ftab, nblock, verb )) {
+      /* sorted; periodic blocks fall through to the
+         classic algorithms, see saisSort */
+   } else if (nblock < 10000) {
       fallbackSort ( s->arr1, s->arr2, ftab, nblock, verb );
    } else {
       /* Calculate the location for quadrant, remembering to get
@@ -196,6 +196,7 @@ int BZ_API(BZ2_bzCompressInit)
    s->nblockMAX         = 100000 * blockSize100k - 19;
    s->verbosity         = verbosity;
    s->workFactor        = workFactor;
+   s->sortAlgorithm     = BZ_DEFAULT_SORT;
 
    s->block             = (UChar*)s->arr2;
    s->mtfv              = (UInt16*)s->arr1;
@@ -213,6 +214,24 @@ int BZ_API(BZ2_bzCompressInit)
 }
 
 
+/*---------------------------------------------------*/
+int BZ_API(BZ2_bzCompressSetSort)
+                    ( bz_stream* strm,
+                     int        sortAlgorithm )
+{
+   EState* s;
+   if (strm == NULL) return BZ_PARAM_ERROR;
+   s = strm->state;
+   if (s == NULL) return BZ_PARAM_ERROR;
+   if (s->strm != strm) return BZ_PARAM_ERROR;
+   if (sortAlgorithm != BZ_SORT_CLASSIC &&
+       sortAlgorithm != BZ_SORT_SAIS) return BZ_PARAM_ERROR;
+
+   s->sortAlgorithm = sortAlgorithm;
+   return BZ_OK;
+}
+
+
 /*---------------------------------------------------*/
 static
 void add_pair_to_block ( EState* s )
@@ -45,6 +45,9 @@ extern "C" {
 #define BZ_OUTBUFF_FULL      (-8)
 #define BZ_CONFIG_ERROR      (-9)
 
+#define BZ_SORT_CLASSIC      0
+#define BZ_SORT_SAIS         1
+
 typedef
    struct {
       char *next_in;
@@ -109,6 +112,11 @@ BZ_EXTERN int BZ_API(BZ2_bzCompressInit) (
       int        workFactor
    );
 
+BZ_EXTERN int BZ_API(BZ2_bzCompressSetSort) (
+      bz_stream* strm,
+      int        sortAlgorithm
+   );
+
 BZ_EXTERN int BZ_API(BZ2_bzCompress) (
       bz_stream* strm,
       int action
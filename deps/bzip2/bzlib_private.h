@@ -186,6 +186,13 @@ extern UInt32 BZ2_crc32Table[256];
 #define BZ_N_SHELL 18
 #define BZ_N_OVERSHOOT (BZ_N_RADIX + BZ_N_QSORT + BZ_N_SHELL + 2)
 
+/*-- The block sorting algorithm of new compression streams;
+     build with -DBZ_DEFAULT_SORT=BZ_SORT_SAIS to change it. --*/
+
+#ifndef BZ_DEFAULT_SORT
+#define BZ_DEFAULT_SORT BZ_SORT_CLASSIC
+#endif
+
 
 
 
@@ -219,6 +226,9 @@ typedef
       /* for deciding when to use the fallback sorting algorithm */
       Int32    workFactor;
 
+      /* BZ_SORT_CLASSIC or BZ_SORT_SAIS */
+      Int32    sortAlgorithm;
+
       /* run-length-encoding of the input */
       UInt32   state_in_ch;
       Int32    state_in_len;
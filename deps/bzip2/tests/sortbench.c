@@ -0,0 +1,328 @@
+
+/* Compares the classic block sorting algorithms with the SA-IS
+   mode (BZ_SORT_SAIS).  Every input is compressed with both, and
+   the .bz2 streams must be byte-identical; the SA-IS stream is also
+   decompressed and checked against the input.  The exit status is
+   non-zero if any of this fails, so `sortbench -c` doubles as a test.
+
+   The generated inputs cover the cases the classic algorithms are
+   worst at (long repeats, log-like text) next to random and
+   text-like data, where they are already fast.  Files given on the
+   command line are added to the list.
+*/
+
+/* ------------------------------------------------------------------
+   This file is part of bzip2/libbzip2, a program and library for
+   lossless, block-sorting data compression.
+
+   bzip2/libbzip2 version 1.1.0 of 6 September 2010
+   Copyright (C) 1996-2010 Julian Seward <jseward@acm.org>
+
+   Please read the WARNING, DISCLAIMER and PATENTS sections in the
+   README file.
+
+   This program is released under the terms of the license contained
+   in the file LICENSE.
+------------------------------------------------------------------ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bzlib.h"
+
+#define N_GEN 5
+
+static const char* genNames[N_GEN] =
+   { "random", "text", "repeat", "logs", "periodic" };
+
+static unsigned long seed;
+
+static unsigned int next_rand ( void )
+{
+   seed = (seed * 1103515245UL + 12345UL) & 0xffffffffUL;
+   return (unsigned int)(seed >> 16);
+}
+
+
+/*---------------------------------------------*/
+static void generate ( int which, unsigned char* p, size_t n )
+{
+   size_t i, k;
+   unsigned int line;
+   char tmp[128];
+
+   seed = 1;
+   switch (which) {
+      case 0:
+         /* incompressible */
+         for (i = 0; i < n; i++) p[i] = (unsigned char)(next_rand() >> 7);
+         break;
+      case 1:
+         /* random words from a small alphabet */
+         for (i = 0; i < n; i++)
+            p[i] = (next_rand() % 7 == 0)
+                   ? ' ' : (unsigned char)('a' + next_rand() % 16);
+         break;
+      case 2:
+         /* one 64k chunk repeated, with a rare point mutation */
+         for (i = 0; i < n && i < 65536; i++)
+            p[i] = (unsigned char)(next_rand() >> 7);
+         for (; i < n; i++) {
+            p[i] = p[i - 65536];
+            if (next_rand() % 50000 == 0) p[i] ^= 1;
+         }
+         break;
+      case 3:
+         /* near-identical log lines */
+         i = 0;
+         line = 0;
+         while (i < n) {
+            sprintf ( tmp, "2010-09-06 12:%02u:%02u host worker[%u]: "
+                           "request %u served, status=200\n",
+                      (line / 60) % 60, line % 60, 1000 + line % 4, line );
+            for (k = 0; tmp[k] != 0 && i < n; k++, i++)
+               p[i] = (unsigned char)tmp[k];
+            line++;
+         }
+         break;
+      default:
+         /* a short word repeated; the blocks are nearly periodic */
+         for (i = 0; i < n; i++) p[i] = (unsigned char)("abcab"[i % 5]);
+         break;
+   }
+}
+
+
+/*---------------------------------------------*/
+static unsigned char* read_file ( const char* name, size_t* n )
+{
+   FILE* f;
+   unsigned char* buf = NULL;
+   unsigned char* tmp;
+   size_t cap = 0, len = 0, r;
+
+   f = fopen ( name, "rb" );
+   if (f == NULL) return NULL;
+   for (;;) {
+      if (len == cap) {
+         cap = cap ? 2 * cap : 1 << 20;
+         tmp = realloc ( buf, cap );
+         if (tmp == NULL) { free(buf); fclose(f); return NULL; }
+         buf = tmp;
+      }
+      r = fread ( buf + len, 1, cap - len, f );
+      if (r == 0) break;
+      len += r;
+   }
+   fclose ( f );
+   *n = len;
+   return buf;
+}
+
+
+/*---------------------------------------------*/
+static int compress ( unsigned char* dst, unsigned int* dstLen,
+                      unsigned char* src, unsigned int srcLen,
+                      int level, int sortAlgorithm, int verbosity )
+{
+   bz_stream strm;
+   int ret;
+
+   strm.bzalloc = NULL;
+   strm.bzfree = NULL;
+   strm.opaque = NULL;
+   ret = BZ2_bzCompressInit ( &strm, level, verbosity, 0 );
+   if (ret != BZ_OK) return ret;
+   ret = BZ2_bzCompressSetSort ( &strm, sortAlgorithm );
+   if (ret != BZ_OK) { BZ2_bzCompressEnd ( &strm ); return ret; }
+
+   strm.next_in = (char*)src;
+   strm.avail_in = srcLen;
+   strm.next_out = (char*)dst;
+   strm.avail_out = *dstLen;
+   do {
+      ret = BZ2_bzCompress ( &strm, BZ_FINISH );
+   } while (ret == BZ_FINISH_OK);
+   if (ret == BZ_STREAM_END) {
+      *dstLen -= strm.avail_out;
+      ret = BZ_OK;
+   } else if (ret == BZ_FINISH_OK) {
+      ret = BZ_OUTBUFF_FULL;
+   }
+   BZ2_bzCompressEnd ( &strm );
+   return ret;
+}
+
+
+/*---------------------------------------------*/
+static double best_time ( unsigned char* dst, unsigned int* dstLen,
+                          unsigned char* src, unsigned int srcLen,
+                          int level, int sortAlgorithm, int verbosity,
+                          int reps, int* ret )
+{
+   clock_t t0;
+   double t, best = -1.0;
+   unsigned int cap = *dstLen;
+   int r;
+
+   for (r = 0; r < reps; r++) {
+      *dstLen = cap;
+      t0 = clock();
+      *ret = compress ( dst, dstLen, src, srcLen,
+                        level, sortAlgorithm, verbosity );
+      t = (double)(clock() - t0) / CLOCKS_PER_SEC;
+      if (*ret != BZ_OK) break;
+      if (best < 0.0 || t < best) best = t;
+   }
+   return best;
+}
+
+
+/*---------------------------------------------*/
+static double mbps ( size_t n, double t )
+{
+   if (t <= 0.0) return 0.0;
+   return (double)n / t / 1048576.0;
+}
+
+
+/*---------------------------------------------*/
+static int run ( const char* name, unsigned char* src, size_t n,
+                 int level, int reps, int verbosity )
+{
+   unsigned char *classic, *sais, *dec;
+   unsigned int cap, classicLen, saisLen, decLen;
+   double tClassic, tSais;
+   int ret, res = 1;
+
+   cap = (unsigned int)(n + n / 100 + 600);
+   classic = malloc ( cap );
+   sais = malloc ( cap );
+   dec = malloc ( n + 1 );
+   if (classic == NULL || sais == NULL || dec == NULL) {
+      fprintf ( stderr, "%s: out of memory\n", name );
+      goto out;
+   }
+
+   classicLen = cap;
+   tClassic = best_time ( classic, &classicLen, src, (unsigned int)n,
+                          level, BZ_SORT_CLASSIC, verbosity, reps, &ret );
+   if (ret != BZ_OK) {
+      fprintf ( stderr, "%s: classic compression failed (%d)\n", name, ret );
+      goto out;
+   }
+   saisLen = cap;
+   tSais = best_time ( sais, &saisLen, src, (unsigned int)n,
+                       level, BZ_SORT_SAIS, verbosity, reps, &ret );
+   if (ret != BZ_OK) {
+      fprintf ( stderr, "%s: SA-IS compression failed (%d)\n", name, ret );
+      goto out;
+   }
+
+   printf ( "%-12.12s %9lu %10u %9.3f %8.2f %9.3f %8.2f %7.2fx  ",
+            name, (unsigned long)n, saisLen,
+            tClassic, mbps ( n, tClassic ), tSais, mbps ( n, tSais ),
+            tSais > 0.0 ? tClassic / tSais : 0.0 );
+
+   if (classicLen != saisLen || memcmp ( classic, sais, saisLen ) != 0) {
+      printf ( "DIFFERENT\n" );
+      goto out;
+   }
+   decLen = (unsigned int)n + 1;
+   ret = BZ2_bzBuffToBuffDecompress ( (char*)dec, &decLen,
+                                      (char*)sais, saisLen, 0, 0 );
+   if (ret != BZ_OK || decLen != n || memcmp ( dec, src, n ) != 0) {
+      printf ( "BAD DATA\n" );
+      goto out;
+   }
+   printf ( "ok\n" );
+   res = 0;
+
+ out:
+   free ( classic );
+   free ( sais );
+   free ( dec );
+   return res;
+}
+
+
+/*---------------------------------------------*/
+static void usage ( const char* prog )
+{
+   fprintf ( stderr,
+             "usage: %s [-c] [-1..-9] [-s MiB] [-r reps] [-v] [file ...]\n"
+             "   -c       quick check: 1 MiB inputs, one repetition\n"
+             "   -1..-9   block size (default 9)\n"
+             "   -s MiB   size of the generated inputs (default 8)\n"
+             "   -r reps  repetitions, the best time is reported "
+             "(default 3)\n"
+             "   -v       pass verbosity to the library "
+             "(repeat for more)\n",
+             prog );
+}
+
+
+/*---------------------------------------------*/
+int main ( int argc, char** argv )
+{
+   int i, which;
+   int level = 9, reps = 3, verbosity = 0, failures = 0;
+   size_t n = (size_t)8 << 20, fileLen;
+   unsigned char* buf;
+
+   for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+      if (strcmp ( argv[i], "-c" ) == 0) {
+         n = (size_t)1 << 20;
+         reps = 1;
+      } else if (argv[i][1] >= '1' && argv[i][1] <= '9' && argv[i][2] == 0) {
+         level = argv[i][1] - '0';
+      } else if (strcmp ( argv[i], "-s" ) == 0 && i + 1 < argc) {
+         n = (size_t)atoi ( argv[++i] ) << 20;
+      } else if (strcmp ( argv[i], "-r" ) == 0 && i + 1 < argc) {
+         reps = atoi ( argv[++i] );
+      } else if (strcmp ( argv[i], "-v" ) == 0) {
+         verbosity++;
+      } else {
+         usage ( argv[0] );
+         return 2;
+      }
+   }
+   if (n == 0 || reps < 1 || verbosity > 4) {
+      usage ( argv[0] );
+      return 2;
+   }
+
+   printf ( "block size %d00k, best of %d\n", level, reps );
+   printf ( "%-12s %9s %10s %9s %8s %9s %8s %8s\n",
+            "input", "bytes", "bz2", "classic s", "MB/s",
+            "SA-IS s", "MB/s", "speedup" );
+
+   buf = malloc ( n );
+   if (buf == NULL) {
+      fprintf ( stderr, "out of memory\n" );
+      return 1;
+   }
+   for (which = 0; which < N_GEN; which++) {
+      generate ( which, buf, n );
+      failures += run ( genNames[which], buf, n, level, reps, verbosity );
+   }
+   free ( buf );
+
+   for (; i < argc; i++) {
+      buf = read_file ( argv[i], &fileLen );
+      if (buf == NULL) {
+         fprintf ( stderr, "%s: cannot read\n", argv[i] );
+         failures++;
+         continue;
+      }
+      failures += run ( strrchr ( argv[i], '/' ) ? strrchr ( argv[i], '/' ) + 1
+                                                 : argv[i],
+                        buf, fileLen, level, reps, verbosity );
+      free ( buf );
+   }
+
+   return failures ? 1 : 0;
+}
@@ -0,0 +1,919 @@
+/*-
+ * Copyright (c) 2026 libarchive contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*-
+ * libarchive_bench: throughput benchmark for the format and filter
+ * writers/readers.
+ *
+ * The program generates reproducible corpora on disk (the contents
+ * depend only on the seed and the scale factor), then for every
+ * corpus x format x filter combination it measures three phases:
+ *
+ *   create  - walk the corpus with archive_read_disk and write an archive
+ *   list    - read every header, skipping entry data
+ *   extract - read the archive and restore it with archive_write_disk
+ *
+ * Each phase runs in a forked child so that the reported peak RSS
+ * belongs to that phase alone.  Results are written as JSON lines, one
+ * object per phase, with a stable key order so that two result files
+ * can be compared with diff(1) or loaded by a script.
+ *
+ * "io_syscalls_per_entry" counts only read(2)/write(2)-class system
+ * calls (syscr + syscw in /proc/self/io), not open(2), stat(2), lseek(2)
+ * and the like; it is -1 where that file is unavailable.
+ */
+
+/* nftw(), mkdtemp() and strsep() are hidden by strict glibc modes. */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define	_GNU_SOURCE
+#endif
+
+#include <sys/types.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#include <archive.h>
+#include <archive_entry.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define	DEFAULT_FORMATS	"gnutar,pax,zip,7zip,cpio,iso9660"
+#define	DEFAULT_FILTERS	"none,gzip,bzip2,xz,zstd,lz4,lzop"
+#define	DEFAULT_CORPORA	"tiny,sparse,deep"
+#define	DEFAULT_SEED	0x6c6962617263ULL	/* "libarc" */
+#define	FIXED_MTIME	1700000000		/* Reproducible timestamps */
+#define	BUFF_SIZE	(64 * 1024)
+
+struct result {
+	int		status;		/* 0 ok, 1 unsupported, 2 failed */
+	char		message[160];
+	int64_t		entries;
+	int64_t		bytes;		/* Logical size of regular files */
+	int64_t		archive_bytes;
+	double		seconds;
+	int64_t		io_syscalls;
+	long		peak_rss_kb;
+};
+
+struct options {
+	const char	*workdir;
+	const char	*formats;
+	const char	*filters;
+	const char	*corpora;
+	const char	*options;
+	FILE		*out;
+	uint64_t	 seed;
+	double		 scale;
+	int		 repeat;
+	int		 keep;
+};
+
+static struct options opt;
+static char buff[BUFF_SIZE];
+
+static void
+die(const char *fmt, ...)
+{
+	va_list ap;
+
+	fprintf(stderr, "libarchive_bench: ");
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+	fprintf(stderr, "\n");
+	exit(1);
+}
+
+/*
+ * xorshift64*: tiny, fast and identical on every platform, which is
+ * all we need to make the corpora reproducible.
+ */
+static uint64_t
+rng_next(uint64_t *s)
+{
+	uint64_t x = *s;
+
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*s = x;
+	return (x * 0x2545F4914F6CDD1DULL);
+}
+
+static double
+now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((double)ts.tv_sec + (double)ts.tv_nsec / 1e9);
+}
+
+/* Sum of syscr and syscw from /proc/self/io, or -1 when unavailable. */
+static int64_t
+io_syscalls(void)
+{
+	char line[128];
+	FILE *f;
+	int64_t total = 0;
+	long long v;
+	int found = 0;
+
+	if ((f = fopen("/proc/self/io", "r")) == NULL)
+		return (-1);
+	while (fgets(line, sizeof(line), f) != NULL) {
+		if (sscanf(line, "syscr: %lld", &v) == 1 ||
+		    sscanf(line, "syscw: %lld", &v) == 1) {
+			total += v;
+			found++;
+		}
+	}
+	fclose(f);
+	return (found == 2 ? total : -1);
+}
+
+static long
+peak_rss_kb(void)
+{
+	struct rusage ru;
+
+	if (getrusage(RUSAGE_SELF, &ru) != 0)
+		return (-1);
+#if defined(__APPLE__)
+	return (ru.ru_maxrss / 1024);	/* Bytes on macOS. */
+#else
+	return (ru.ru_maxrss);
+#endif
+}
+
+static int
+rm_cb(const char *path, const struct stat *st, int flag, struct FTW *ftw)
+{
+	(void)st; (void)flag; (void)ftw; /* UNUSED */
+	return (remove(path));
+}
+
+static void
+rm_rf(const char *path)
+{
+	struct stat st;
+
+	if (lstat(path, &st) == 0)
+		nftw(path, rm_cb, 64, FTW_DEPTH | FTW_PHYS);
+}
+
+static int
+touch_cb(const char *path, const struct stat *st, int flag, struct FTW *ftw)
+{
+	struct timeval tv[2];
+
+	(void)st; (void)flag; (void)ftw; /* UNUSED */
+	tv[0].tv_sec = tv[1].tv_sec = FIXED_MTIME;
+	tv[0].tv_usec = tv[1].tv_usec = 0;
+	utimes(path, tv);
+	return (0);
+}
+
+/*
+ * Corpus generation.
+ */
+
+static const char *words[] = {
+	"archive", "entry", "header", "block", "filter", "format", "read",
+	"write", "data", "sparse", "offset", "length", "pathname", "mode",
+	"uid", "gid", "mtime", "size", "link", "symlink", "directory",
+	"regular", "file", "stream", "buffer", "compress", "extract",
+	"0", "1", "42", "4096", "65536", "\n", "\n", ", ", ": ", "; ",
+};
+
+/* Text-like, moderately compressible content. */
+static void
+fill_text(uint64_t *s, char *p, size_t len)
+{
+	size_t i = 0;
+
+	while (i < len) {
+		const char *w = words[rng_next(s) %
+		    (sizeof(words) / sizeof(words[0]))];
+		size_t wl = strlen(w);
+
+		if (wl > len - i)
+			wl = len - i;
+		memcpy(p + i, w, wl);
+		i += wl;
+		if (i < len)
+			p[i++] = ' ';
+	}
+}
+
+static void
+write_file(const char *path, uint64_t *s, size_t size)
+{
+	int fd;
+
+	if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)
+		die("%s: %s", path, strerror(errno));
+	while (size > 0) {
+		size_t n = size > sizeof(buff) ? sizeof(buff) : size;
+
+		fill_text(s, buff, n);
+		if (write(fd, buff, n) != (ssize_t)n)
+			die("%s: %s", path, strerror(errno));
+		size -= n;
+	}
+	close(fd);
+}
+
+static void
+make_dir(const char *path)
+{
+	if (mkdir(path, 0755) != 0 && errno != EEXIST)
+		die("%s: %s", path, strerror(errno));
+}
+
+static size_t
+scaled(size_t n)
+{
+	double v = (double)n * opt.scale;
+
+	return (v < 1.0 ? 1 : (size_t)v);
+}
+
+/* Many tiny files (0-512 bytes) spread over a flat set of directories. */
+static void
+gen_tiny(const char *root, uint64_t *s)
+{
+	char path[1024];
+	size_t i, nfiles = scaled(20000), ndirs = scaled(100);
+
+	make_dir(root);
+	for (i = 0; i < ndirs; i++) {
+		snprintf(path, sizeof(path), "%s/d%04zu", root, i);
+		make_dir(path);
+	}
+	for (i = 0; i < nfiles; i++) {
+		snprintf(path, sizeof(path), "%s/d%04zu/f%06zu.txt",
+		    root, i % ndirs, i);
+		write_file(path, s, (size_t)(rng_next(s) % 513));
+	}
+}
+
+/*
+ * A few large files that are mostly holes, with a 1 MiB data extent
+ * every 16 MiB.  Formats that understand sparse files only store the
+ * extents; everything else has to read and store the zeros.
+ */
+static void
+gen_sparse(const char *root, uint64_t *s)
+{
+	char path[1024];
+	size_t i, nfiles = scaled(4);
+	int64_t size = 64 * 1024 * 1024, off;
+	int fd;
+
+	make_dir(root);
+	for (i = 0; i < nfiles; i++) {
+		snprintf(path, sizeof(path), "%s/sparse%02zu.img", root, i);
+		if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)
+			die("%s: %s", path, strerror(errno));
+		if (ftruncate(fd, (off_t)size) != 0)
+			die("%s: %s", path, strerror(errno));
+		for (off = 0; off < size; off += 16 * 1024 * 1024) {
+			int64_t done;
+
+			if (lseek(fd, (off_t)off, SEEK_SET) < 0)
+				die("%s: %s", path, strerror(errno));
+			for (done = 0; done < 1024 * 1024;
+			    done += sizeof(buff)) {
+				fill_text(s, buff, sizeof(buff));
+				if (write(fd, buff, sizeof(buff)) !=
+				    (ssize_t)sizeof(buff))
+					die("%s: %s", path, strerror(errno));
+			}
+		}
+		close(fd);
+	}
+}
+
+/* Several deep directory chains with a handful of files per level. */
+static void
+gen_deep(const char *root, uint64_t *s)
+{
+	char path[4096], file[4200];
+	size_t chain, level, f;
+	size_t nchains = scaled(16), depth = 48;
+
+	make_dir(root);
+	for (chain = 0; chain < nchains; chain++) {
+		int n = snprintf(path, sizeof(path), "%s/chain%03zu",
+		    root, chain);
+
+		make_dir(path);
+		for (level = 0; level < depth; level++) {
+			n += snprintf(path + n, sizeof(path) - n,
+			    "/level%02zu_%06x", level,
+			    (unsigned)(rng_next(s) & 0xffffff));
+			make_dir(path);
+			for (f = 0; f < 8; f++) {
+				snprintf(file, sizeof(file), "%s/file%zu",
+				    path, f);
+				write_file(file, s, (size_t)(rng_next(s) % 4096));
+			}
+		}
+	}
+}
+
+static const struct corpus {
+	const char	*name;
+	void		(*generate)(const char *, uint64_t *);
+} corpora[] = {
+	{ "tiny",	gen_tiny },
+	{ "sparse",	gen_sparse },
+	{ "deep",	gen_deep },
+	{ NULL,		NULL }
+};
+
+/*
+ * Benchmark phases.  Each one runs in a child process and fills in
+ * a struct result.
+ */
+
+static void
+set_error(struct result *r, struct archive *a, const char *what)
+{
+	r->status = 2;
+	snprintf(r->message, sizeof(r->message), "%s: %s", what,
+	    a != NULL && archive_error_string(a) != NULL ?
+	    archive_error_string(a) : "failed");
+}
+
+static int
+open_writer(struct archive **ap, const char *format, const char *filter,
+    struct result *r)
+{
+	struct archive *a = archive_write_new();
+	int ret;
+
+	*ap = a;
+	if (archive_write_set_format_by_name(a, format) != ARCHIVE_OK) {
+		r->status = 1;
+		snprintf(r->message, sizeof(r->message), "%s",
+		    archive_error_string(a));
+		return (-1);
+	}
+	/* archive_write_add_filter_by_name() does not know "none". */
+	if (strcmp(filter, "none") == 0)
+		ret = archive_write_add_filter_none(a);
+	else
+		ret = archive_write_add_filter_by_name(a, filter);
+	if (ret == ARCHIVE_WARN) {
+		/* An external program would distort the measurement. */
+		r->status = 1;
+		snprintf(r->message, sizeof(r->message),
+		    "filter %s needs an external program", filter);
+		return (-1);
+	} else if (ret != ARCHIVE_OK) {
+		r->status = 1;
+		snprintf(r->message, sizeof(r->message), "%s",
+		    archive_error_string(a));
+		return (-1);
+	}
+	/* Options may name modules other than the ones in use. */
+	if (opt.options != NULL &&
+	    archive_write_set_options(a, opt.options) < ARCHIVE_WARN) {
+		r->status = 1;
+		snprintf(r->message, sizeof(r->message), "%s",
+		    archive_error_string(a));
+		return (-1);
+	}
+	return (0);
+}
+
+static void
+phase_create(const char *corpus_dir, const char *archive_path,
+    const char *format, const char *filter, struct result *r)
+{
+	struct archive *disk, *a;
+	struct archive_entry *entry;
+	int ret;
+
+	if (open_writer(&a, format, filter, r) != 0) {
+		archive_write_free(a);
+		return;
+	}
+	if (archive_write_open_filename(a, archive_path) != ARCHIVE_OK) {
+		set_error(r, a, "open");
+		archive_write_free(a);
+		return;
+	}
+	disk = archive_read_disk_new();
+	archive_read_disk_set_standard_lookup(disk);
+	/* Store relative pathnames, as "tar -C corpus_dir -c ." would. */
+	if (chdir(corpus_dir) != 0) {
+		r->status = 2;
+		snprintf(r->message, sizeof(r->message), "%s: %s", corpus_dir,
+		    strerror(errno));
+		goto done;
+	}
+	if (archive_read_disk_open(disk, ".") != ARCHIVE_OK) {
+		set_error(r, disk, "read_disk_open");
+		goto done;
+	}
+	for (;;) {
+		int64_t progress = 0, offset;
+		const void *block;
+		size_t len;
+
+		entry = archive_entry_new();
+		ret = archive_read_next_header2(disk, entry);
+		if (ret == ARCHIVE_EOF) {
+			archive_entry_free(entry);
+			break;
+		}
+		if (ret < ARCHIVE_WARN) {
+			set_error(r, disk, "read_disk");
+			archive_entry_free(entry);
+			goto done;
+		}
+		archive_read_disk_descend(disk);
+		ret = archive_write_header(a, entry);
+		if (ret < ARCHIVE_WARN) {
+			set_error(r, a, archive_entry_pathname(entry));
+			archive_entry_free(entry);
+			goto done;
+		}
+		r->entries++;
+		if (ret == ARCHIVE_OK && archive_entry_filetype(entry) == AE_IFREG
+		    && archive_entry_size(entry) > 0) {
+			while ((ret = archive_read_data_block(disk, &block,
+			    &len, &offset)) == ARCHIVE_OK) {
+				/* Formats without sparse support need
+				 * the holes written out as zeros. */
+				while (offset > progress) {
+					size_t ns = offset - progress >
+					    (int64_t)sizeof(buff) ?
+					    sizeof(buff) :
+					    (size_t)(offset - progress);
+
+					memset(buff, 0, ns);
+					if (archive_write_data(a, buff, ns)
+					    < 0) {
+						set_error(r, a, "write_data");
+						archive_entry_free(entry);
+						goto done;
+					}
+					progress += ns;
+				}
+				if (archive_write_data(a, block, len) < 0) {
+					set_error(r, a, "write_data");
+					archive_entry_free(entry);
+					goto done;
+				}
+				progress = offset + len;
+			}
+			if (ret != ARCHIVE_EOF) {
+				set_error(r, disk, "read_data_block");
+				archive_entry_free(entry);
+				goto done;
+			}
+			r->bytes += archive_entry_size(entry);
+		}
+		archive_entry_free(entry);
+	}
+done:
+	archive_read_close(disk);
+	archive_read_free(disk);
+	if (archive_write_close(a) != ARCHIVE_OK && r->status == 0)
+		set_error(r, a, "close");
+	archive_write_free(a);
+}
+
+static struct archive *
+open_reader(const char *archive_path, struct result *r)
+{
+	struct archive *a = archive_read_new();
+
+	archive_read_support_filter_all(a);
+	archive_read_support_format_all(a);
+	if (archive_read_open_filename(a, archive_path, BUFF_SIZE)
+	    != ARCHIVE_OK) {
+		set_error(r, a, "open");
+		archive_read_free(a);
+		return (NULL);
+	}
+	return (a);
+}
+
+static void
+phase_list(const char *archive_path, struct result *r)
+{
+	struct archive *a;
+	struct archive_entry *entry;
+	int ret;
+
+	if ((a = open_reader(archive_path, r)) == NULL)
+		return;
+	while ((ret = archive_read_next_header(a, &entry)) == ARCHIVE_OK ||
+	    ret == ARCHIVE_WARN) {
+		r->entries++;
+		if (archive_entry_filetype(entry) == AE_IFREG)
+			r->bytes += archive_entry_size(entry);
+		if (archive_read_data_skip(a) < ARCHIVE_WARN) {
+			ret = ARCHIVE_FATAL;
+			break;
+		}
+	}
+	if (ret != ARCHIVE_EOF)
+		set_error(r, a, "list");
+	archive_read_free(a);
+}
+
+static void
+phase_extract(const char *archive_path, const char *dest, struct result *r)
+{
+	struct archive *a, *disk;
+	struct archive_entry *entry;
+	int ret;
+
+	if ((a = open_reader(archive_path, r)) == NULL)
+		return;
+	rm_rf(dest);
+	make_dir(dest);
+	if (chdir(dest) != 0) {
+		r->status = 2;
+		snprintf(r->message, sizeof(r->message), "%s: %s", dest,
+		    strerror(errno));
+		archive_read_free(a);
+		return;
+	}
+	disk = archive_write_disk_new();
+	archive_write_disk_set_options(disk, ARCHIVE_EXTRACT_TIME |
+	    ARCHIVE_EXTRACT_PERM | ARCHIVE_EXTRACT_SPARSE);
+	archive_write_disk_set_standard_lookup(disk);
+	while ((ret = archive_read_next_header(a, &entry)) == ARCHIVE_OK ||
+	    ret == ARCHIVE_WARN) {
+		const void *block;
+		size_t len;
+		int64_t offset;
+
+		r->entries++;
+		if (archive_entry_filetype(entry) == AE_IFREG)
+			r->bytes += archive_entry_size(entry);
+		if (archive_write_header(disk, entry) < ARCHIVE_WARN) {
+			set_error(r, disk, archive_entry_pathname(entry));
+			break;
+		}
+		while ((ret = archive_read_data_block(a, &block, &len,
+		    &offset)) == ARCHIVE_OK) {
+			if (archive_write_data_block(disk, block, len, offset)
+			    < ARCHIVE_WARN) {
+				set_error(r, disk, "write_data_block");
+				break;
+			}
+		}
+		if (r->status != 0)
+			break;
+		if (ret != ARCHIVE_EOF) {
+			set_error(r, a, "read_data_block");
+			break;
+		}
+		archive_write_finish_entry(disk);
+	}
+	if (r->status == 0 && ret != ARCHIVE_EOF)
+		set_error(r, a, "extract");
+	archive_write_free(disk);
+	archive_read_free(a);
+}
+
+enum phase { CREATE, LIST, EXTRACT };
+static const char *phase_names[] = { "create", "list", "extract" };
+
+/*
+ * Run one phase in a child process and collect its result through
+ * a pipe.
+ */
+static void
+run_phase(enum phase phase, const char *corpus_dir, const char *archive_path,
+    const char *dest, const char *format, const char *filter,
+    struct result *out)
+{
+	struct result r;
+	int fds[2], status;
+	pid_t pid;
+	ssize_t n;
+
+	status = 0;
+	if (pipe(fds) != 0)
+		die("pipe: %s", strerror(errno));
+	fflush(NULL);
+	if ((pid = fork()) < 0)
+		die("fork: %s", strerror(errno));
+	if (pid == 0) {
+		int64_t sc0, sc1;
+		double t0;
+
+		close(fds[0]);
+		memset(&r, 0, sizeof(r));
+		sc0 = io_syscalls();
+		t0 = now();
+		switch (phase) {
+		case CREATE:
+			phase_create(corpus_dir, archive_path, format, filter,
+			    &r);
+			break;
+		case LIST:
+			phase_list(archive_path, &r);
+			break;
+		case EXTRACT:
+			phase_extract(archive_path, dest, &r);
+			break;
+		}
+		r.seconds = now() - t0;
+		sc1 = io_syscalls();
+		r.io_syscalls = (sc0 < 0 || sc1 < 0) ? -1 : sc1 - sc0;
+		r.peak_rss_kb = peak_rss_kb();
+		n = write(fds[1], &r, sizeof(r));
+		_exit(n == (ssize_t)sizeof(r) ? 0 : 1);
+	}
+	close(fds[1]);
+	n = read(fds[0], out, sizeof(*out));
+	close(fds[0]);
+	if (waitpid(pid, &status, 0) < 0 || n != (ssize_t)sizeof(*out)) {
+		memset(out, 0, sizeof(*out));
+		out->status = 2;
+		if (WIFSIGNALED(status))
+			snprintf(out->message, sizeof(out->message),
+			    "benchmark child killed by signal %d",
+			    WTERMSIG(status));
+		else
+			snprintf(out->message, sizeof(out->message),
+			    "benchmark child exited with status %d",
+			    WEXITSTATUS(status));
+	}
+}
+
+static void
+json_string(FILE *f, const char *s)
+{
+	fputc('"', f);
+	for (; *s != '\0'; s++) {
+		if (*s == '"' || *s == '\\')
+			fprintf(f, "\\%c", *s);
+		else if ((unsigned char)*s < 0x20)
+			fprintf(f, "\\u%04x", (unsigned char)*s);
+		else
+			fputc(*s, f);
+	}
+	fputc('"', f);
+}
+
+static void
+emit(const char *corpus, const char *format, const char *filter,
+    enum phase phase, const struct result *r)
+{
+	static const char *status_names[] = { "ok", "unsupported", "failed" };
+	FILE *f = opt.out;
+
+	fprintf(f, "{\"libarchive\":");
+	json_string(f, ARCHIVE_VERSION_ONLY_STRING);
+	fprintf(f, ",\"corpus\":");
+	json_string(f, corpus);
+	fprintf(f, ",\"format\":");
+	json_string(f, format);
+	fprintf(f, ",\"filter\":");
+	json_string(f, filter);
+	fprintf(f, ",\"phase\":\"%s\",\"status\":\"%s\"",
+	    phase_names[phase], status_names[r->status]);
+	if (r->status != 0) {
+		fprintf(f, ",\"message\":");
+		json_string(f, r->message);
+	} else {
+		double secs = r->seconds > 0 ? r->seconds : 1e-9;
+
+		fprintf(f, ",\"entries\":%lld,\"bytes\":%lld"
+		    ",\"archive_bytes\":%lld,\"seconds\":%.6f"
+		    ",\"mb_per_s\":%.3f,\"entries_per_s\":%.1f"
+		    ",\"io_syscalls_per_entry\":%.3f,\"peak_rss_kb\":%ld",
+		    (long long)r->entries, (long long)r->bytes,
+		    (long long)r->archive_bytes, r->seconds,
+		    (double)r->bytes / secs / 1e6,
+		    (double)r->entries / secs,
+		    r->io_syscalls < 0 || r->entries == 0 ? -1.0 :
+		    (double)r->io_syscalls / (double)r->entries,
+		    r->peak_rss_kb);
+	}
+	fprintf(f, "}\n");
+	fflush(f);
+}
+
+/* Keep the fastest of opt.repeat runs; stop on the first failure. */
+static void
+bench_phase(enum phase phase, const char *corpus, const char *corpus_dir,
+    const char *archive_path, const char *dest, const char *format,
+    const char *filter, struct result *best)
+{
+	struct result r;
+	struct stat st;
+	int i;
+
+	for (i = 0; i < opt.repeat; i++) {
+		run_phase(phase, corpus_dir, archive_path, dest, format,
+		    filter, &r);
+		if (r.status != 0 || i == 0 || r.seconds < best->seconds)
+			*best = r;
+		if (r.status != 0)
+			break;
+	}
+	if (stat(archive_path, &st) == 0)
+		best->archive_bytes = st.st_size;
+	emit(corpus, format, filter, phase, best);
+}
+
+static char *
+next_item(char **listp)
+{
+	char *item;
+
+	while ((item = strsep(listp, ",")) != NULL) {
+		if (*item != '\0')
+			return (item);
+	}
+	return (NULL);
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr,
+	    "usage: libarchive_bench [-k] [-c corpora] [-f formats] "
+	    "[-z filters] [-O options]\n"
+	    "                        [-o file] [-r repeat] [-s seed] "
+	    "[-x scale] [-w workdir]\n"
+	    "  -c  corpora (default " DEFAULT_CORPORA ")\n"
+	    "  -f  formats, as accepted by archive_write_set_format_by_name\n"
+	    "      (default " DEFAULT_FORMATS ")\n"
+	    "  -z  filters, as accepted by archive_write_add_filter_by_name\n"
+	    "      (default " DEFAULT_FILTERS ")\n"
+	    "  -O  writer options, as accepted by archive_write_set_options\n"
+	    "  -o  write JSON lines results to file (default stdout)\n"
+	    "  -r  runs per phase, the fastest is reported (default 1)\n"
+	    "  -s  corpus seed\n"
+	    "  -x  corpus scale factor (default 1.0)\n"
+	    "  -w  work directory (default: a new directory in $TMPDIR)\n"
+	    "  -k  keep the work directory\n");
+	exit(1);
+}
+
+int
+main(int argc, char **argv)
+{
+	char workbuf[1024], corpus_dir[1200], archive_path[1300];
+	char dest[1200], cwd[1024];
+	char *clist, *cp, *corpus, *options = NULL;
+	const struct corpus *c;
+	int ch;
+
+	opt.formats = DEFAULT_FORMATS;
+	opt.filters = DEFAULT_FILTERS;
+	opt.corpora = DEFAULT_CORPORA;
+	opt.seed = DEFAULT_SEED;
+	opt.scale = 1.0;
+	opt.repeat = 1;
+	opt.out = stdout;
+	while ((ch = getopt(argc, argv, "c:f:kO:o:r:s:w:x:z:")) != -1) {
+		switch (ch) {
+		case 'c': opt.corpora = optarg; break;
+		case 'f': opt.formats = optarg; break;
+		case 'k': opt.keep = 1; break;
+		case 'O':
+			if (asprintf(&options, "%s%s",
+			    "__ignore_wrong_module_name__,", optarg) < 0)
+				die("Out of memory");
+			opt.options = options;
+			break;
+		case 'o':
+			if ((opt.out = fopen(optarg, "w")) == NULL)
+				die("%s: %s", optarg, strerror(errno));
+			break;
+		case 'r': opt.repeat = atoi(optarg); break;
+		case 's': opt.seed = strtoull(optarg, NULL, 0); break;
+		case 'w': opt.workdir = optarg; break;
+		case 'x': opt.scale = atof(optarg); break;
+		case 'z': opt.filters = optarg; break;
+		default: usage();
+		}
+	}
+	if (optind != argc || opt.repeat < 1 || opt.scale <= 0 ||
+	    opt.seed == 0)
+		usage();
+	if (getcwd(cwd, sizeof(cwd)) == NULL)
+		die("getcwd: %s", strerror(errno));
+
+	if (opt.workdir == NULL) {
+		const char *tmp = getenv("TMPDIR");
+
+		snprintf(workbuf, sizeof(workbuf), "%s/libarchive_bench.XXXXXX",
+		    tmp != NULL ? tmp : "/tmp");
+		if (mkdtemp(workbuf) == NULL)
+			die("mkdtemp: %s", strerror(errno));
+	} else {
+		snprintf(workbuf, sizeof(workbuf), "%s", opt.workdir);
+		make_dir(workbuf);
+	}
+
+	clist = strdup(opt.corpora);
+	cp = clist;
+	while ((corpus = next_item(&cp)) != NULL) {
+		char *flist, *fp, *format;
+		uint64_t seed = opt.seed;
+
+		for (c = corpora; c->name != NULL; c++)
+			if (strcmp(c->name, corpus) == 0)
+				break;
+		if (c->name == NULL)
+			die("unknown corpus: %s", corpus);
+		snprintf(corpus_dir, sizeof(corpus_dir), "%s/corpus-%s",
+		    workbuf, corpus);
+		snprintf(dest, sizeof(dest), "%s/extract", workbuf);
+		fprintf(stderr, "generating %s corpus\n", corpus);
+		rm_rf(corpus_dir);
+		c->generate(corpus_dir, &seed);
+		/* Directory mtimes changed as entries were added. */
+		nftw(corpus_dir, touch_cb, 64, FTW_DEPTH | FTW_PHYS);
+
+		flist = strdup(opt.formats);
+		fp = flist;
+		while ((format = next_item(&fp)) != NULL) {
+			char *zlist, *zp, *filter;
+
+			zlist = strdup(opt.filters);
+			zp = zlist;
+			while ((filter = next_item(&zp)) != NULL) {
+				struct result r;
+
+				fprintf(stderr, "  %s/%s/%s\n", corpus,
+				    format, filter);
+				snprintf(archive_path, sizeof(archive_path),
+				    "%s/archive-%s-%s", workbuf, format,
+				    filter);
+				bench_phase(CREATE, corpus, corpus_dir,
+				    archive_path, dest, format, filter, &r);
+				if (r.status == 0) {
+					bench_phase(LIST, corpus, corpus_dir,
+					    archive_path, dest, format, filter,
+					    &r);
+					bench_phase(EXTRACT, corpus, corpus_dir,
+					    archive_path, dest, format, filter,
+					    &r);
+				}
+				if (chdir(cwd) != 0)
+					die("chdir: %s", strerror(errno));
+				rm_rf(dest);
+				unlink(archive_path);
+			}
+			free(zlist);
+		}
+		free(flist);
+		if (!opt.keep)
+			rm_rf(corpus_dir);
+	}
+	free(clist);
+	free(options);
+	if (!opt.keep && opt.workdir == NULL)
+		rm_rf(workbuf);
+	if (opt.out != stdout)
+		fclose(opt.out);
+	return (0);
+}
@@ -102,6 +102,23 @@ SRes SzAr_DecodeFolder(const CSzAr *p, UInt32 folderIndex,
     Byte *outBuffer, size_t outSize,
     ISzAllocPtr allocMain);
 
+/*
+SzAr_DecodeFolderToStream() decodes the folder and writes the data to (outStream).
+The memory usage doesn't depend on the size of folder:
+it's about the sum of dictionary sizes of coders in folder, but not more
+than the size of folder, plus less than 1 MB for buffers.
+Returns:
+  SZ_ERROR_WRITE - (outStream) has processed fewer bytes than requested
+  SZ_ERROR_CRC   - the CRC of folder doesn't match.
+                   All data was written to (outStream) already.
+  other decoding errors, as in SzAr_DecodeFolder()
+*/
+
+SRes SzAr_DecodeFolderToStream(const CSzAr *p, UInt32 folderIndex,
+    ILookInStreamPtr stream, UInt64 startPos,
+    ISeqOutStreamPtr outStream,
+    ISzAllocPtr allocMain);
+
 typedef struct
 {
   CSzAr db;
@@ -185,6 +202,45 @@ SRes SzArEx_Extract(
     ISzAllocPtr allocTemp);
 
 
+/*
+  SzArEx_ExtractFolder extracts all files of solid block (folderIndex)
+  through callback interface, without the buffer for whole solid block.
+  The files are sent to callback in order of their indexes:
+  the files from (db->FolderToFile[folderIndex]), while
+  (db->FileToFolder[fileIndex] == folderIndex).
+  These files can include empty files and directories.
+
+  GetStream() is called before the data of file.
+    The callee sets (*outStream) to the stream for the data of file,
+    or keeps (*outStream == NULL), if the data of file must be skipped.
+  SetOperationResult() is called after the data of file,
+    and also for current file, if the extraction was interrupted by error.
+    (res) is SZ_OK, SZ_ERROR_CRC, or the error code that stopped extraction.
+  If callback function returns error code, the extraction is stopped,
+  and SzArEx_ExtractFolder() returns that error code.
+
+  SzArEx_ExtractFolder() returns SZ_ERROR_CRC, if the CRC of some file doesn't match.
+  The extraction is not stopped in that case.
+  allocTemp is used for decoder structures. See SzAr_DecodeFolderToStream().
+*/
+
+Z7_C_IFACE_DECL (ISzExtractCallback)
+{
+  SRes (*GetStream)(ISzExtractCallbackPtr p, UInt32 fileIndex, ISeqOutStreamPtr *outStream);
+  SRes (*SetOperationResult)(ISzExtractCallbackPtr p, UInt32 fileIndex, SRes res);
+};
+
+#define ISzExtractCallback_GetStream(p, fileIndex, outStream) (p)->GetStream(p, fileIndex, outStream)
+#define ISzExtractCallback_SetOperationResult(p, fileIndex, res) (p)->SetOperationResult(p, fileIndex, res)
+
+SRes SzArEx_ExtractFolder(
+    const CSzArEx *db,
+    ILookInStreamPtr inStream,
+    UInt32 folderIndex,         /* index of solid block */
+    ISzExtractCallbackPtr callback,
+    ISzAllocPtr allocTemp);
+
+
 /*
 SzArEx_Open Errors:
 SZ_ERROR_NO_ARCHIVE
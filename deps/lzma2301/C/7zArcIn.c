@@ -1724,6 +1724,149 @@ SRes SzArEx_Extract(
 }
 
 
+/* ---------- SzArEx_ExtractFolder ---------- */
+
+typedef struct
+{
+  ISeqOutStream vt;
+  const CSzArEx *db;
+  ISzExtractCallbackPtr callback;
+  UInt32 folderIndex;
+  UInt32 fileIndex;     /* next file */
+  BoolInt fileStarted;  /* GetStream() was called for (fileIndex - 1) */
+  UInt64 fileRem;
+  UInt32 crc;
+  ISeqOutStreamPtr fileStream;
+  SRes res;             /* error from callback or (fileStream) */
+  SRes crcRes;
+} CSzFolderToFiles;
+
+
+static SRes SzFolderToFiles_FinishFile(CSzFolderToFiles *p, SRes res)
+{
+  const UInt32 fileIndex = p->fileIndex - 1;
+  p->fileStarted = False;
+  if (res == SZ_OK && p->fileRem != 0)
+    res = SZ_ERROR_FAIL;
+  if (res == SZ_OK && SzBitWithVals_Check(&p->db->CRCs, fileIndex))
+    if (CRC_GET_DIGEST(p->crc) != p->db->CRCs.Vals[fileIndex])
+      res = p->crcRes = SZ_ERROR_CRC;
+  return ISzExtractCallback_SetOperationResult(p->callback, fileIndex, res);
+}
+
+
+/* it finishes current file and starts next file of folder.
+   It returns SZ_ERROR_FAIL, if there are no more files in folder */
+
+static SRes SzFolderToFiles_NextFile(CSzFolderToFiles *p)
+{
+  const CSzArEx *db = p->db;
+  const UInt32 fileIndex = p->fileIndex;
+  if (p->fileStarted)
+  {
+    RINOK(SzFolderToFiles_FinishFile(p, SZ_OK))
+  }
+  if (fileIndex >= db->NumFiles || db->FileToFolder[fileIndex] != p->folderIndex)
+    return SZ_ERROR_FAIL;
+  p->fileIndex = fileIndex + 1;
+  p->fileStarted = True;
+  p->fileRem = SzArEx_GetFileSize(db, fileIndex);
+  p->crc = CRC_INIT_VAL;
+  p->fileStream = NULL;
+  return ISzExtractCallback_GetStream(p->callback, fileIndex, &p->fileStream);
+}
+
+
+static size_t SzFolderToFiles_Write(ISeqOutStreamPtr pp, const void *data, size_t size)
+{
+  Z7_CONTAINER_FROM_VTBL_TO_DECL_VAR_pp_vt_p(CSzFolderToFiles)
+  const Byte *buf = (const Byte *)data;
+  size_t processed = 0;
+  
+  if (p->res != SZ_OK)
+    return 0;
+
+  while (processed != size)
+  {
+    size_t cur = size - processed;
+    if (!p->fileStarted || p->fileRem == 0)
+    {
+      p->res = SzFolderToFiles_NextFile(p);
+      if (p->res != SZ_OK)
+        break;
+      continue;
+    }
+    if (cur > p->fileRem)
+      cur = (size_t)p->fileRem;
+    if (p->fileStream)
+      if (ISeqOutStream_Write(p->fileStream, buf + processed, cur) != cur)
+      {
+        p->res = SZ_ERROR_WRITE;
+        break;
+      }
+    p->crc = CrcUpdate(p->crc, buf + processed, cur);
+    p->fileRem -= cur;
+    processed += cur;
+  }
+  
+  return processed;
+}
+
+
+SRes SzArEx_ExtractFolder(
+    const CSzArEx *db,
+    ILookInStreamPtr inStream,
+    UInt32 folderIndex,
+    ISzExtractCallbackPtr callback,
+    ISzAllocPtr allocTemp)
+{
+  CSzFolderToFiles p;
+  SRes res;
+
+  if (folderIndex >= db->db.NumFolders)
+    return SZ_ERROR_PARAM;
+
+  p.vt.Write = SzFolderToFiles_Write;
+  p.db = db;
+  p.callback = callback;
+  p.folderIndex = folderIndex;
+  p.fileIndex = db->FolderToFile[folderIndex];
+  p.fileStarted = False;
+  p.fileRem = 0;
+  p.crc = CRC_INIT_VAL;
+  p.fileStream = NULL;
+  p.res = SZ_OK;
+  p.crcRes = SZ_OK;
+  
+  res = SzAr_DecodeFolderToStream(&db->db, folderIndex,
+      inStream, db->dataPos, &p.vt, allocTemp);
+  
+  if (p.res != SZ_OK)
+    res = p.res;
+
+  if (p.fileStarted)
+  {
+    const SRes res2 = SzFolderToFiles_FinishFile(&p, res);
+    if (res == SZ_OK)
+      res = res2;
+  }
+
+  /* the files of zero size after last data in folder */
+  while (res == SZ_OK
+      && p.fileIndex < db->NumFiles
+      && db->FileToFolder[p.fileIndex] == folderIndex)
+  {
+    res = SzFolderToFiles_NextFile(&p);
+    if (res == SZ_OK)
+      res = SzFolderToFiles_FinishFile(&p, SZ_OK);
+  }
+
+  if (res == SZ_OK)
+    res = p.crcRes;
+  return res;
+}
+
+
 size_t SzArEx_GetFileNameUtf16(const CSzArEx *p, size_t fileIndex, UInt16 *dest)
 {
   const size_t offs = p->FileNameOffsets[fileIndex];
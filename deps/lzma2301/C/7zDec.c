@@ -646,3 +646,763 @@ SRes SzAr_DecodeFolder(const CSzAr *p, UInt32 folderIndex,
     return res;
   }
 }
+
+
+
+/* ---------- Decoding of folder to stream ---------- */
+
+/*
+  SzAr_DecodeFolderToStream() decodes the folder in chunks.
+  LZMA and LZMA2 coders use cyclic dictionary buffers of
+  (min(dictSize, unpackSize)) bytes, and filters and BCJ2 use buffers of fixed size.
+  So the memory usage doesn't depend on the size of folder.
+*/
+
+#define SZ_STREAM_BUF_SIZE      ((size_t)1 << 18)
+#define SZ_STREAM_BCJ2_BUF_SIZE ((size_t)1 << 16)
+
+typedef struct
+{
+  ILookInStreamPtr stream;
+  UInt64 pos;
+} CSzInput;
+
+static SRes SzInput_Look(CSzInput *p, UInt64 pos, const void **buf, size_t *size)
+{
+  if (p->pos != pos)
+  {
+    p->pos = (UInt64)(Int64)-1;
+    RINOK(LookInStream_SeekTo(p->stream, pos))
+    p->pos = pos;
+  }
+  return ILookInStream_Look(p->stream, buf, size);
+}
+
+static SRes SzInput_Skip(CSzInput *p, size_t size)
+{
+  p->pos += size;
+  return ILookInStream_Skip(p->stream, size);
+}
+
+
+#ifdef Z7_PPMD_SUPPORT
+
+typedef struct
+{
+  IByteIn vt;
+  const Byte *cur;
+  const Byte *end;
+  const Byte *begin;
+  UInt64 pos;
+  UInt64 lim;
+  BoolInt extra;
+  SRes res;
+  CSzInput *input;
+} CByteInToInput;
+
+static void ByteInToInput_Release(CByteInToInput *p)
+{
+  const size_t size = (size_t)(p->cur - p->begin);
+  if (size != 0)
+  {
+    p->pos += size;
+    if (p->res == SZ_OK)
+      p->res = SzInput_Skip(p->input, size);
+  }
+  p->begin = p->end = p->cur = NULL;
+}
+
+static Byte ReadByteFromInput(IByteInPtr pp)
+{
+  Z7_CONTAINER_FROM_VTBL_TO_DECL_VAR_pp_vt_p(CByteInToInput)
+  if (p->cur != p->end)
+    return *p->cur++;
+  ByteInToInput_Release(p);
+  if (p->res == SZ_OK)
+  {
+    const void *buf = NULL;
+    size_t size = SZ_STREAM_BUF_SIZE;
+    if (size > p->lim - p->pos)
+      size = (size_t)(p->lim - p->pos);
+    if (size != 0)
+    {
+      p->res = SzInput_Look(p->input, p->pos, &buf, &size);
+      if (p->res == SZ_OK && size != 0)
+      {
+        p->begin = p->cur = (const Byte *)buf;
+        p->end = p->begin + size;
+        return *p->cur++;
+      }
+    }
+  }
+  p->extra = True;
+  return 0;
+}
+
+#endif
+
+
+/* CSzCoderReader decodes the output stream of one main coder */
+
+typedef struct
+{
+  UInt32 methodID;
+  BoolInt finished;
+  UInt64 packPos;
+  UInt64 packRem;
+  UInt64 unpackRem;
+  Byte *dic;
+  SizeT dicBufSize;
+  SizeT dicPos;
+  SizeT dicRead;
+  CLzmaDec lzma;
+ #ifndef Z7_NO_METHOD_LZMA2
+  CLzma2Dec lzma2;
+ #endif
+ #ifdef Z7_PPMD_SUPPORT
+  CPpmd7 ppmd;
+  CByteInToInput ppmdIn;
+ #endif
+} CSzCoderReader;
+
+static void SzCoderReader_Construct(CSzCoderReader *p)
+{
+  p->methodID = k_Copy;
+  p->finished = True;
+  p->dic = NULL;
+  LzmaDec_CONSTRUCT(&p->lzma)
+ #ifndef Z7_NO_METHOD_LZMA2
+  Lzma2Dec_CONSTRUCT(&p->lzma2)
+ #endif
+ #ifdef Z7_PPMD_SUPPORT
+  Ppmd7_Construct(&p->ppmd);
+ #endif
+}
+
+static void SzCoderReader_Free(CSzCoderReader *p, ISzAllocPtr alloc)
+{
+  LzmaDec_FreeProbs(&p->lzma, alloc);
+ #ifndef Z7_NO_METHOD_LZMA2
+  Lzma2Dec_FreeProbs(&p->lzma2, alloc);
+ #endif
+ #ifdef Z7_PPMD_SUPPORT
+  Ppmd7_Free(&p->ppmd, alloc);
+ #endif
+  ISzAlloc_Free(alloc, p->dic);
+  p->dic = NULL;
+}
+
+static SRes SzCoderReader_AllocDic(CSzCoderReader *p, UInt64 size, ISzAllocPtr alloc)
+{
+  if (size == 0)
+    size = 1;
+  p->dicBufSize = (SizeT)size;
+  if (p->dicBufSize != size)
+    return SZ_ERROR_MEM;
+  p->dic = (Byte *)ISzAlloc_Alloc(alloc, p->dicBufSize);
+  if (!p->dic)
+    return SZ_ERROR_MEM;
+  return SZ_OK;
+}
+
+static SRes SzCoderReader_Init(CSzCoderReader *p, UInt32 methodID,
+    const Byte *props, unsigned propsSize,
+    UInt64 packPos, UInt64 packSize, UInt64 unpackSize,
+    CSzInput *input, ISzAllocPtr alloc)
+{
+  UInt64 dicSize = 0;
+  
+  p->methodID = methodID;
+  p->finished = False;
+  p->packPos = packPos;
+  p->packRem = packSize;
+  p->unpackRem = unpackSize;
+  p->dicPos = 0;
+  p->dicRead = 0;
+
+  if (methodID == k_Copy)
+  {
+    if (packSize != unpackSize)
+      return SZ_ERROR_DATA;
+    return SZ_OK;
+  }
+  
+  if (methodID == k_LZMA)
+  {
+    RINOK(LzmaDec_AllocateProbs(&p->lzma, props, propsSize, alloc))
+    dicSize = p->lzma.prop.dicSize;
+    if (dicSize > unpackSize)
+      dicSize = unpackSize;
+    RINOK(SzCoderReader_AllocDic(p, dicSize, alloc))
+    p->lzma.dic = p->dic;
+    p->lzma.dicBufSize = p->dicBufSize;
+    LzmaDec_Init(&p->lzma);
+    return SZ_OK;
+  }
+  
+ #ifndef Z7_NO_METHOD_LZMA2
+  if (methodID == k_LZMA2)
+  {
+    if (propsSize != 1)
+      return SZ_ERROR_DATA;
+    RINOK(Lzma2Dec_AllocateProbs(&p->lzma2, props[0], alloc))
+    dicSize = p->lzma2.decoder.prop.dicSize;
+    if (dicSize > unpackSize)
+      dicSize = unpackSize;
+    RINOK(SzCoderReader_AllocDic(p, dicSize, alloc))
+    p->lzma2.decoder.dic = p->dic;
+    p->lzma2.decoder.dicBufSize = p->dicBufSize;
+    Lzma2Dec_Init(&p->lzma2);
+    return SZ_OK;
+  }
+ #endif
+  
+ #ifdef Z7_PPMD_SUPPORT
+  if (methodID == k_PPMD)
+  {
+    CByteInToInput *s = &p->ppmdIn;
+    unsigned order;
+    UInt32 memSize;
+    if (propsSize != 5)
+      return SZ_ERROR_UNSUPPORTED;
+    order = props[0];
+    memSize = GetUi32(props + 1);
+    if (order < PPMD7_MIN_ORDER ||
+        order > PPMD7_MAX_ORDER ||
+        memSize < PPMD7_MIN_MEM_SIZE ||
+        memSize > PPMD7_MAX_MEM_SIZE)
+      return SZ_ERROR_UNSUPPORTED;
+    if (!Ppmd7_Alloc(&p->ppmd, memSize, alloc))
+      return SZ_ERROR_MEM;
+    Ppmd7_Init(&p->ppmd, order);
+    RINOK(SzCoderReader_AllocDic(p, SZ_STREAM_BUF_SIZE, alloc))
+    
+    s->vt.Read = ReadByteFromInput;
+    s->begin = s->end = s->cur = NULL;
+    s->pos = packPos;
+    s->lim = packPos + packSize;
+    s->extra = False;
+    s->res = SZ_OK;
+    s->input = input;
+    p->ppmd.rc.dec.Stream = &s->vt;
+    
+    if (!Ppmd7z_RangeDec_Init(&p->ppmd.rc.dec))
+      return SZ_ERROR_DATA;
+    ByteInToInput_Release(s);
+    if (s->extra)
+      return (s->res != SZ_OK ? s->res : SZ_ERROR_DATA);
+    return s->res;
+  }
+ #else
+  UNUSED_VAR(input)
+ #endif
+  
+  return SZ_ERROR_UNSUPPORTED;
+}
+
+
+/* SzCoderReader_DecodeLzma() decodes next part of data to the cyclic dictionary */
+
+static SRes SzCoderReader_DecodeLzma(CSzCoderReader *p, CSzInput *input)
+{
+  CLzmaDec *dec = &p->lzma;
+  const void *inBuf = NULL;
+  size_t lookahead = SZ_STREAM_BUF_SIZE;
+  SizeT dicPos, dicLimit, inProcessed;
+  ELzmaFinishMode finishMode = LZMA_FINISH_ANY;
+  ELzmaStatus status;
+  SRes res;
+
+ #ifndef Z7_NO_METHOD_LZMA2
+  if (p->methodID != k_LZMA)
+    dec = &p->lzma2.decoder;
+ #endif
+
+  if (dec->dicPos == dec->dicBufSize)
+    dec->dicPos = 0;
+  dicPos = dec->dicPos;
+  p->dicPos = dicPos;
+  p->dicRead = dicPos;
+  
+  dicLimit = dec->dicBufSize;
+  if (p->unpackRem <= dicLimit - dicPos)
+  {
+    dicLimit = dicPos + (SizeT)p->unpackRem;
+    finishMode = LZMA_FINISH_END;
+  }
+  
+  if (lookahead > p->packRem)
+    lookahead = (size_t)p->packRem;
+  if (lookahead != 0)
+  {
+    RINOK(SzInput_Look(input, p->packPos, &inBuf, &lookahead))
+  }
+  
+  inProcessed = (SizeT)lookahead;
+  
+ #ifndef Z7_NO_METHOD_LZMA2
+  if (p->methodID != k_LZMA)
+    res = Lzma2Dec_DecodeToDic(&p->lzma2, dicLimit, (const Byte *)inBuf, &inProcessed, finishMode, &status);
+  else
+ #endif
+    res = LzmaDec_DecodeToDic(dec, dicLimit, (const Byte *)inBuf, &inProcessed, finishMode, &status);
+  
+  p->dicPos = dec->dicPos;
+  p->unpackRem -= dec->dicPos - dicPos;
+  p->packPos += inProcessed;
+  p->packRem -= inProcessed;
+  RINOK(res)
+  if (inProcessed != 0)
+  {
+    RINOK(SzInput_Skip(input, inProcessed))
+  }
+
+  if (status == LZMA_STATUS_FINISHED_WITH_MARK)
+  {
+    if (p->unpackRem != 0 || p->packRem != 0)
+      return SZ_ERROR_DATA;
+    p->finished = True;
+  }
+  else if (p->unpackRem == 0 && p->packRem == 0
+      && status == LZMA_STATUS_MAYBE_FINISHED_WITHOUT_MARK
+      && p->methodID == k_LZMA)
+    p->finished = True;
+  else if (inProcessed == 0 && dicPos == dec->dicPos)
+    return (lookahead == 0 && p->packRem != 0) ? SZ_ERROR_INPUT_EOF : SZ_ERROR_DATA;
+  return SZ_OK;
+}
+
+
+#ifdef Z7_PPMD_SUPPORT
+
+static SRes SzCoderReader_DecodePpmd(CSzCoderReader *p)
+{
+  CByteInToInput *s = &p->ppmdIn;
+  SizeT size = p->dicBufSize;
+  SizeT i;
+  if (size > p->unpackRem)
+    size = (SizeT)p->unpackRem;
+  
+  for (i = 0; i < size; i++)
+  {
+    const int sym = Ppmd7z_DecodeSymbol(&p->ppmd);
+    if (s->extra || sym < 0)
+      break;
+    p->dic[i] = (Byte)sym;
+  }
+  ByteInToInput_Release(s);
+  
+  p->dicRead = 0;
+  p->dicPos = i;
+  p->unpackRem -= i;
+  
+  if (s->extra)
+    return (s->res != SZ_OK ? s->res : SZ_ERROR_DATA);
+  RINOK(s->res)
+  if (i != size)
+    return SZ_ERROR_DATA;
+  if (p->unpackRem == 0)
+  {
+    if (!Ppmd7z_RangeDec_IsFinishedOK(&p->ppmd.rc.dec) || s->pos != s->lim)
+      return SZ_ERROR_DATA;
+    p->finished = True;
+  }
+  return SZ_OK;
+}
+
+#endif
+
+
+/*
+  SzCoderReader_Read() returns (*processed == 0) only after the end of stream,
+  when all pack stream is processed and the end of coder stream was checked.
+*/
+
+static SRes SzCoderReader_Read(CSzCoderReader *p, CSzInput *input, Byte *buf, size_t size, size_t *processed)
+{
+  *processed = 0;
+  
+  if (p->methodID == k_Copy)
+  {
+    const void *inBuf;
+    if (size > p->packRem)
+      size = (size_t)p->packRem;
+    if (size == 0)
+      return SZ_OK;
+    RINOK(SzInput_Look(input, p->packPos, &inBuf, &size))
+    if (size == 0)
+      return SZ_ERROR_INPUT_EOF;
+    memcpy(buf, inBuf, size);
+    p->packPos += size;
+    p->packRem -= size;
+    *processed = size;
+    return SzInput_Skip(input, size);
+  }
+
+  for (;;)
+  {
+    size_t cur = p->dicPos - p->dicRead;
+    if (cur != 0)
+    {
+      if (cur > size)
+        cur = size;
+      memcpy(buf, p->dic + p->dicRead, cur);
+      p->dicRead += cur;
+      *processed = cur;
+      return SZ_OK;
+    }
+    if (p->finished || size == 0)
+      return SZ_OK;
+   #ifdef Z7_PPMD_SUPPORT
+    if (p->methodID == k_PPMD)
+    {
+      RINOK(SzCoderReader_DecodePpmd(p))
+    }
+    else
+   #endif
+    {
+      RINOK(SzCoderReader_DecodeLzma(p, input))
+    }
+  }
+}
+
+
+#if defined(Z7_USE_BRANCH_FILTER)
+
+typedef struct
+{
+  UInt32 methodID;
+  UInt32 pc;
+  UInt32 x86State;
+ #if !defined(Z7_NO_METHODS_FILTERS)
+  unsigned delta;
+  Byte deltaState[DELTA_STATE_SIZE];
+ #endif
+} CSzFilter;
+
+static SRes SzFilter_Init(CSzFilter *p, const CSzCoderInfo *coder, const Byte *propsData)
+{
+  p->methodID = (UInt32)coder->MethodID;
+  p->pc = 0;
+  p->x86State = Z7_BRANCH_CONV_ST_X86_STATE_INIT_VAL;
+  
+ #if !defined(Z7_NO_METHODS_FILTERS)
+  if (p->methodID == k_Delta)
+  {
+    if (coder->PropsSize != 1)
+      return SZ_ERROR_UNSUPPORTED;
+    p->delta = (unsigned)(propsData[coder->PropsOffset]) + 1;
+    Delta_Init(p->deltaState);
+    return SZ_OK;
+  }
+ #endif
+  
+ #ifdef Z7_USE_FILTER_ARM64
+  if (p->methodID == k_ARM64)
+  {
+    if (coder->PropsSize == 4)
+      p->pc = GetUi32(propsData + coder->PropsOffset);
+    else if (coder->PropsSize != 0)
+      return SZ_ERROR_UNSUPPORTED;
+    return SZ_OK;
+  }
+ #endif
+  
+  UNUSED_VAR(propsData)
+  if (coder->PropsSize != 0)
+    return SZ_ERROR_UNSUPPORTED;
+  return SZ_OK;
+}
+
+/* returns the size of converted data. Unconverted tail must be passed again with new data */
+
+static size_t SzFilter_Convert(CSzFilter *p, Byte *data, size_t size)
+{
+  Byte *lim;
+ #define CASE_BRA_CONV_STREAM(isa) case k_ ## isa: lim = Z7_BRANCH_CONV_DEC(isa)(data, size, p->pc); break;
+  switch (p->methodID)
+  {
+   #if !defined(Z7_NO_METHODS_FILTERS)
+    case k_Delta:
+      Delta_Decode(p->deltaState, p->delta, data, size);
+      return size;
+    case k_BCJ:
+      lim = z7_BranchConvSt_X86_Dec(data, size, p->pc, &p->x86State);
+      break;
+    CASE_BRA_CONV_STREAM(PPC)
+    CASE_BRA_CONV_STREAM(IA64)
+    CASE_BRA_CONV_STREAM(SPARC)
+    CASE_BRA_CONV_STREAM(ARM)
+   #endif
+   #ifdef Z7_USE_FILTER_ARM64
+    CASE_BRA_CONV_STREAM(ARM64)
+   #endif
+   #if !defined(Z7_NO_METHODS_FILTERS) || defined(Z7_USE_FILTER_ARMT)
+    CASE_BRA_CONV_STREAM(ARMT)
+   #endif
+    default:
+      return size;
+  }
+  size = (size_t)(lim - data);
+  p->pc += (UInt32)size;
+  return size;
+}
+
+#endif
+
+
+typedef struct
+{
+  ISeqOutStreamPtr stream;
+  UInt64 rem;
+  UInt32 crc;
+} CSzFolderOut;
+
+static SRes SzFolderOut_Write(CSzFolderOut *p, const Byte *data, size_t size)
+{
+  if (size > p->rem)
+    return SZ_ERROR_DATA;
+  if (size == 0)
+    return SZ_OK;
+  p->rem -= size;
+  p->crc = CrcUpdate(p->crc, data, size);
+  if (ISeqOutStream_Write(p->stream, data, size) != size)
+    return SZ_ERROR_WRITE;
+  return SZ_OK;
+}
+
+
+#define SZ_NUM_STREAM_BUFS (1 + BCJ2_NUM_STREAMS)
+
+static SRes SzFolder_DecodeToStream2(const CSzFolder *folder,
+    const Byte *propsData,
+    const UInt64 *unpackSizes,
+    const UInt64 *packPositions,
+    CSzInput *input, UInt64 startPos,
+    CSzFolderOut *out, ISzAllocPtr alloc,
+    CSzCoderReader *readers, Byte *bufs[])
+{
+  Byte *outBuf;
+  
+  RINOK(CheckSupportedFolder(folder))
+
+  bufs[0] = outBuf = (Byte *)ISzAlloc_Alloc(alloc, SZ_STREAM_BUF_SIZE);
+  if (!outBuf)
+    return SZ_ERROR_MEM;
+
+  if (folder->NumCoders == 4)
+  {
+    const UInt32 indices[] = { 3, 2, 0 };
+    const unsigned streams[] = { BCJ2_STREAM_JUMP, BCJ2_STREAM_CALL, BCJ2_STREAM_MAIN };
+    CBcj2Dec dec;
+    UInt32 ci;
+    unsigned i;
+    
+    if ((unpackSizes[0] & 3) != 0 ||
+        (unpackSizes[1] & 3) != 0 ||
+        unpackSizes[0] + unpackSizes[1] + unpackSizes[2] != out->rem)
+      return SZ_ERROR_DATA;
+
+    for (ci = 0; ci < 3; ci++)
+    {
+      const CSzCoderInfo *coder = &folder->Coders[ci];
+      const UInt32 si = indices[ci];
+      RINOK(SzCoderReader_Init(&readers[streams[ci]], (UInt32)coder->MethodID,
+          propsData + coder->PropsOffset, coder->PropsSize,
+          startPos + packPositions[si], packPositions[(size_t)si + 1] - packPositions[si],
+          unpackSizes[ci], input, alloc))
+    }
+    RINOK(SzCoderReader_Init(&readers[BCJ2_STREAM_RC], k_Copy, NULL, 0,
+        startPos + packPositions[1], packPositions[2] - packPositions[1],
+        packPositions[2] - packPositions[1], input, alloc))
+
+    Bcj2Dec_Init(&dec);
+    for (i = 0; i < BCJ2_NUM_STREAMS; i++)
+    {
+      bufs[1 + i] = (Byte *)ISzAlloc_Alloc(alloc, SZ_STREAM_BCJ2_BUF_SIZE);
+      if (!bufs[1 + i])
+        return SZ_ERROR_MEM;
+      dec.bufs[i] = dec.lims[i] = bufs[1 + i];
+    }
+    dec.dest = outBuf;
+    dec.destLim = outBuf + (out->rem < SZ_STREAM_BUF_SIZE ? (size_t)out->rem : SZ_STREAM_BUF_SIZE);
+    
+    for (;;)
+    {
+      unsigned k;
+
+      if (dec.dest == dec.destLim)
+      {
+        RINOK(SzFolderOut_Write(out, outBuf, (size_t)(dec.dest - outBuf)))
+        if (out->rem == 0)
+          break;
+        dec.dest = outBuf;
+        dec.destLim = outBuf + (out->rem < SZ_STREAM_BUF_SIZE ? (size_t)out->rem : SZ_STREAM_BUF_SIZE);
+      }
+
+      /* Bcj2Dec_Decode() reads RC byte for normalization only if it's in buffer.
+         So we keep the data in RC buffer, while RC stream is not finished. */
+      for (k = 0; k < BCJ2_NUM_STREAMS; k++)
+        if (k == BCJ2_STREAM_RC || k == dec.state)
+          if (dec.bufs[k] == dec.lims[k])
+          {
+            Byte *buf = bufs[1 + k];
+            size_t size = 0;
+            for (;;)
+            {
+              size_t cur;
+              RINOK(SzCoderReader_Read(&readers[k], input, buf + size, SZ_STREAM_BCJ2_BUF_SIZE - size, &cur))
+              if (cur == 0)
+                break;
+              size += cur;
+              if (!BCJ2_IS_32BIT_STREAM(k) || (size & 3) == 0)
+                break;
+            }
+            if (BCJ2_IS_32BIT_STREAM(k) && (size & 3) != 0)
+              return SZ_ERROR_DATA;
+            if (size == 0 && k == dec.state)
+              return SZ_ERROR_DATA;
+            dec.bufs[k] = buf;
+            dec.lims[k] = buf + size;
+          }
+      
+      RINOK(Bcj2Dec_Decode(&dec))
+      if (dec.dest != dec.destLim && dec.state >= BCJ2_NUM_STREAMS)
+        return SZ_ERROR_DATA;
+    }
+
+    if (dec.bufs[BCJ2_STREAM_RC] == dec.lims[BCJ2_STREAM_RC])
+    {
+      /* the normalization at the end of Bcj2Dec_Decode() could be
+         skipped, if RC buffer was empty at that moment */
+      size_t cur;
+      Byte *buf = bufs[1 + BCJ2_STREAM_RC];
+      RINOK(SzCoderReader_Read(&readers[BCJ2_STREAM_RC], input, buf, 1, &cur))
+      if (cur != 0)
+      {
+        if (dec.range >= ((UInt32)1 << 24))
+          return SZ_ERROR_DATA;
+        dec.range <<= 8;
+        dec.code = (dec.code << 8) | buf[0];
+      }
+    }
+
+    for (i = 0; i < BCJ2_NUM_STREAMS; i++)
+    {
+      size_t cur;
+      if (dec.bufs[i] != dec.lims[i])
+        return SZ_ERROR_DATA;
+      RINOK(SzCoderReader_Read(&readers[i], input, outBuf, 1, &cur))
+      if (cur != 0)
+        return SZ_ERROR_DATA;
+    }
+    if (!Bcj2Dec_IsMaybeFinished(&dec))
+      return SZ_ERROR_DATA;
+    return SZ_OK;
+  }
+
+  {
+    const CSzCoderInfo *coder = &folder->Coders[0];
+    size_t rem = 0;
+   #if defined(Z7_USE_BRANCH_FILTER)
+    CSzFilter filter;
+    if (folder->NumCoders == 2)
+    {
+      RINOK(SzFilter_Init(&filter, &folder->Coders[1], propsData))
+    }
+   #endif
+
+    RINOK(SzCoderReader_Init(&readers[0], (UInt32)coder->MethodID,
+        propsData + coder->PropsOffset, coder->PropsSize,
+        startPos + packPositions[0], packPositions[1] - packPositions[0],
+        out->rem, input, alloc))
+
+    for (;;)
+    {
+      size_t size;
+      RINOK(SzCoderReader_Read(&readers[0], input, outBuf + rem, SZ_STREAM_BUF_SIZE - rem, &size))
+      if (size == 0)
+      {
+        /* the filter doesn't convert some bytes at the end of stream */
+        RINOK(SzFolderOut_Write(out, outBuf, rem))
+        break;
+      }
+      size += rem;
+      rem = 0;
+     #if defined(Z7_USE_BRANCH_FILTER)
+      if (folder->NumCoders == 2)
+      {
+        const size_t processed = SzFilter_Convert(&filter, outBuf, size);
+        rem = size - processed;
+        size = processed;
+      }
+     #endif
+      RINOK(SzFolderOut_Write(out, outBuf, size))
+      if (rem != 0)
+        memmove(outBuf, outBuf + size, rem);
+    }
+    
+    if (out->rem != 0)
+      return SZ_ERROR_DATA;
+    return SZ_OK;
+  }
+}
+
+
+SRes SzAr_DecodeFolderToStream(const CSzAr *p, UInt32 folderIndex,
+    ILookInStreamPtr inStream, UInt64 startPos,
+    ISeqOutStreamPtr outStream,
+    ISzAllocPtr allocMain)
+{
+  SRes res;
+  CSzFolder folder;
+  CSzData sd;
+  
+  const Byte *data = p->CodersData + p->FoCodersOffsets[folderIndex];
+  sd.Data = data;
+  sd.Size = p->FoCodersOffsets[(size_t)folderIndex + 1] - p->FoCodersOffsets[folderIndex];
+  
+  res = SzGetNextFolderItem(&folder, &sd);
+  
+  if (res != SZ_OK)
+    return res;
+
+  if (sd.Size != 0
+      || folder.UnpackStream != p->FoToMainUnpackSizeIndex[folderIndex])
+    return SZ_ERROR_FAIL;
+  {
+    unsigned i;
+    CSzInput input;
+    CSzFolderOut out;
+    CSzCoderReader readers[BCJ2_NUM_STREAMS];
+    Byte *bufs[SZ_NUM_STREAM_BUFS];
+
+    input.stream = inStream;
+    input.pos = (UInt64)(Int64)-1;
+    out.stream = outStream;
+    out.rem = SzAr_GetFolderUnpackSize(p, folderIndex);
+    out.crc = CRC_INIT_VAL;
+    for (i = 0; i < BCJ2_NUM_STREAMS; i++)
+      SzCoderReader_Construct(&readers[i]);
+    for (i = 0; i < SZ_NUM_STREAM_BUFS; i++)
+      bufs[i] = NULL;
+
+    res = SzFolder_DecodeToStream2(&folder, data,
+        &p->CoderUnpackSizes[p->FoToCoderUnpackSizes[folderIndex]],
+        p->PackPositions + p->FoStartPackStreamIndex[folderIndex],
+        &input, startPos,
+        &out, allocMain, readers, bufs);
+    
+    for (i = 0; i < BCJ2_NUM_STREAMS; i++)
+      SzCoderReader_Free(&readers[i], allocMain);
+    for (i = 0; i < SZ_NUM_STREAM_BUFS; i++)
+      ISzAlloc_Free(allocMain, bufs[i]);
+
+    if (res == SZ_OK)
+      if (SzBitWithVals_Check(&p->FolderCRCs, folderIndex))
+        if (CRC_GET_DIGEST(out.crc) != p->FolderCRCs.Vals[folderIndex])
+          res = SZ_ERROR_CRC;
+
+    return res;
+  }
+}
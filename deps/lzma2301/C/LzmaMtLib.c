@@ -0,0 +1,312 @@
+/* LzmaMtLib.c -- LZMA2 and XZ multi-thread library wrapper
+2026-10-19 : agent : Public domain */
+
+#include "Precomp.h"
+
+#include <string.h>
+
+#include "7zCrc.h"
+#include "Alloc.h"
+#include "Lzma2DecMt.h"
+#include "Lzma2Enc.h"
+#include "XzCrc64.h"
+#include "XzEnc.h"
+#include "LzmaMtLib.h"
+
+#ifndef Z7_ST
+#include "MtCoder.h"
+#define LZMA_MT_LIB_THREADS_MAX MTCODER_THREADS_MAX
+#else
+#define LZMA_MT_LIB_THREADS_MAX 1
+#endif
+
+
+int LzmaMtLib_GetThreadsMax(void)
+{
+  return LZMA_MT_LIB_THREADS_MAX;
+}
+
+
+static void LzmaMtLib_InitCrc(void)
+{
+  CrcGenerateTable();
+  Crc64GenerateTable();
+}
+
+
+/* ---------- CBufInStream ---------- */
+
+typedef struct
+{
+  ISeqInStream vt;
+  const Byte *data;
+  size_t rem;
+} CBufInStream;
+
+static SRes BufInStream_Read(ISeqInStreamPtr pp, void *data, size_t *size)
+{
+  Z7_CONTAINER_FROM_VTBL_TO_DECL_VAR_pp_vt_p(CBufInStream)
+  size_t size2 = *size;
+  if (size2 > p->rem)
+    size2 = p->rem;
+  if (size2 != 0)
+  {
+    memcpy(data, p->data, size2);
+    p->data += size2;
+    p->rem -= size2;
+  }
+  *size = size2;
+  return SZ_OK;
+}
+
+static void BufInStream_Init(CBufInStream *p, const Byte *data, size_t size)
+{
+  p->vt.Read = BufInStream_Read;
+  p->data = data;
+  p->rem = size;
+}
+
+
+/* ---------- CBufOutStream ---------- */
+
+typedef struct
+{
+  ISeqOutStream vt;
+  Byte *data;
+  size_t size;
+  size_t pos;
+  BoolInt overflow;
+} CBufOutStream;
+
+static size_t BufOutStream_Write(ISeqOutStreamPtr pp, const void *data, size_t size)
+{
+  Z7_CONTAINER_FROM_VTBL_TO_DECL_VAR_pp_vt_p(CBufOutStream)
+  if (size > p->size - p->pos)
+  {
+    size = p->size - p->pos;
+    p->overflow = True;
+  }
+  if (size != 0)
+  {
+    memcpy(p->data + p->pos, data, size);
+    p->pos += size;
+  }
+  return size;
+}
+
+static void BufOutStream_Init(CBufOutStream *p, Byte *data, size_t size)
+{
+  p->vt.Write = BufOutStream_Write;
+  p->data = data;
+  p->size = size;
+  p->pos = 0;
+  p->overflow = False;
+}
+
+
+/*
+  Lzma2Enc and XzEnc switch to one solid block, if (blockSize) is AUTO
+  and only one thread is used. We resolve AUTO here with same rule,
+  so the output doesn't depend on the number of threads.
+*/
+
+static UInt64 LzmaMtLib_GetBlockSize(const CLzmaEncProps *lzmaProps, UInt64 blockSize)
+{
+  if (blockSize == LZMA_MT_LIB_BLOCK_SIZE_AUTO)
+  {
+    const UInt32 kMinSize = (UInt32)1 << 20;
+    const UInt32 kMaxSize = (UInt32)1 << 28;
+    CLzmaEncProps props = *lzmaProps;
+    UInt32 dictSize;
+    LzmaEncProps_Normalize(&props);
+    dictSize = props.dictSize;
+    blockSize = (UInt64)dictSize << 2;
+    if (blockSize < kMinSize) blockSize = kMinSize;
+    if (blockSize > kMaxSize) blockSize = kMaxSize;
+    if (blockSize < dictSize) blockSize = dictSize;
+    blockSize += (kMinSize - 1);
+    blockSize &= ~(UInt64)(kMinSize - 1);
+  }
+  return blockSize;
+}
+
+
+static int LzmaMtLib_GetNumThreads(int numThreads)
+{
+  if (numThreads <= 0)
+    return 1;
+  if (numThreads > LZMA_MT_LIB_THREADS_MAX)
+    return LZMA_MT_LIB_THREADS_MAX;
+  return numThreads;
+}
+
+
+Z7_STDAPI Lzma2MtCompress(unsigned char *dest, size_t *destLen, const unsigned char *src, size_t srcLen,
+  unsigned char *outProp,
+  int level, unsigned dictSize, UInt64 blockSize, int numThreads)
+{
+  CLzma2EncProps props;
+  CLzma2EncHandle enc;
+  SRes res;
+
+  Lzma2EncProps_Init(&props);
+  props.lzmaProps.level = level;
+  props.lzmaProps.dictSize = dictSize;
+  props.lzmaProps.reduceSize = srcLen;
+  props.blockSize = LzmaMtLib_GetBlockSize(&props.lzmaProps, blockSize);
+  props.numTotalThreads = LzmaMtLib_GetNumThreads(numThreads);
+
+  enc = Lzma2Enc_Create(&g_Alloc, &g_BigAlloc);
+  if (!enc)
+    return SZ_ERROR_MEM;
+
+  res = Lzma2Enc_SetProps(enc, &props);
+  if (res == SZ_OK)
+  {
+    *outProp = Lzma2Enc_WriteProperties(enc);
+    Lzma2Enc_SetDataSize(enc, srcLen);
+    res = Lzma2Enc_Encode2(enc,
+        NULL, dest, destLen,
+        NULL, src, srcLen,
+        NULL);
+  }
+
+  Lzma2Enc_Destroy(enc);
+  return res;
+}
+
+
+Z7_STDAPI Lzma2MtUncompress(unsigned char *dest, size_t *destLen, const unsigned char *src, size_t *srcLen,
+  unsigned char prop, int numThreads)
+{
+  CLzma2DecMtProps props;
+  CLzma2DecMtHandle dec;
+  CBufInStream inStream;
+  CBufOutStream outStream;
+  UInt64 inProcessed = 0;
+  int isMT = False;
+  SRes res;
+
+  Lzma2DecMtProps_Init(&props);
+  #ifndef Z7_ST
+  props.numThreads = (unsigned)LzmaMtLib_GetNumThreads(numThreads);
+  #else
+  UNUSED_VAR(numThreads)
+  #endif
+
+  BufInStream_Init(&inStream, src, *srcLen);
+  BufOutStream_Init(&outStream, dest, *destLen);
+  *destLen = 0;
+  *srcLen = 0;
+
+  dec = Lzma2DecMt_Create(&g_Alloc, &g_MidAlloc);
+  if (!dec)
+    return SZ_ERROR_MEM;
+
+  res = Lzma2DecMt_Decode(dec, prop, &props,
+      &outStream.vt, NULL, 1,
+      &inStream.vt,
+      &inProcessed, &isMT, NULL);
+
+  Lzma2DecMt_Destroy(dec);
+
+  if (res == SZ_ERROR_WRITE && outStream.overflow)
+    res = SZ_ERROR_OUTPUT_EOF;
+  *destLen = outStream.pos;
+  *srcLen = (size_t)inProcessed;
+  return res;
+}
+
+
+Z7_STDAPI XzMtCompress(unsigned char *dest, size_t *destLen, const unsigned char *src, size_t srcLen,
+  int level, unsigned dictSize, UInt64 blockSize, int checkId, int numThreads)
+{
+  CXzProps props;
+  CXzEncHandle enc;
+  CBufInStream inStream;
+  CBufOutStream outStream;
+  SRes res;
+
+  LzmaMtLib_InitCrc();
+
+  XzProps_Init(&props);
+  props.lzma2Props.lzmaProps.level = level;
+  props.lzma2Props.lzmaProps.dictSize = dictSize;
+  props.lzma2Props.lzmaProps.reduceSize = srcLen;
+  props.checkId = (checkId < 0 ? XZ_CHECK_CRC32 : (unsigned)checkId);
+  props.blockSize = LzmaMtLib_GetBlockSize(&props.lzma2Props.lzmaProps, blockSize);
+  props.numTotalThreads = LzmaMtLib_GetNumThreads(numThreads);
+  /* the multi-thread encoder always writes the sizes to block headers.
+     We do same in single-thread mode, and the multi-thread decoder needs these sizes. */
+  props.forceWriteSizesInHeader = 1;
+  props.reduceSize = srcLen;
+
+  BufInStream_Init(&inStream, src, srcLen);
+  BufOutStream_Init(&outStream, dest, *destLen);
+  *destLen = 0;
+
+  enc = XzEnc_Create(&g_Alloc, &g_BigAlloc);
+  if (!enc)
+    return SZ_ERROR_MEM;
+
+  res = XzEnc_SetProps(enc, &props);
+  if (res == SZ_OK)
+  {
+    XzEnc_SetDataSize(enc, srcLen);
+    res = XzEnc_Encode(enc, &outStream.vt, &inStream.vt, NULL);
+  }
+
+  XzEnc_Destroy(enc);
+
+  if (res == SZ_ERROR_WRITE && outStream.overflow)
+    res = SZ_ERROR_OUTPUT_EOF;
+  *destLen = outStream.pos;
+  return res;
+}
+
+
+Z7_STDAPI XzMtUncompress(unsigned char *dest, size_t *destLen, const unsigned char *src, size_t *srcLen,
+  int numThreads)
+{
+  CXzDecMtProps props;
+  CXzDecMtHandle dec;
+  CXzStatInfo stat;
+  CBufInStream inStream;
+  CBufOutStream outStream;
+  int isMT = False;
+  SRes res;
+
+  LzmaMtLib_InitCrc();
+
+  XzDecMtProps_Init(&props);
+  #ifndef Z7_ST
+  props.numThreads = (unsigned)LzmaMtLib_GetNumThreads(numThreads);
+  #else
+  UNUSED_VAR(numThreads)
+  #endif
+
+  BufInStream_Init(&inStream, src, *srcLen);
+  BufOutStream_Init(&outStream, dest, *destLen);
+  *destLen = 0;
+  *srcLen = 0;
+
+  dec = XzDecMt_Create(&g_Alloc, &g_MidAlloc);
+  if (!dec)
+    return SZ_ERROR_MEM;
+
+  res = XzDecMt_Decode(dec, &props,
+      NULL, 1,
+      &outStream.vt,
+      &inStream.vt,
+      &stat, &isMT, NULL);
+
+  XzDecMt_Destroy(dec);
+
+  if (res == SZ_OK && stat.DataAfterEnd)
+    res = SZ_ERROR_DATA;
+  if (res == SZ_ERROR_WRITE && outStream.overflow)
+    res = SZ_ERROR_OUTPUT_EOF;
+  *destLen = outStream.pos;
+  *srcLen = (size_t)stat.InSize;
+  return res;
+}
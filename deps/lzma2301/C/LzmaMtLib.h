@@ -0,0 +1,129 @@
+/* LzmaMtLib.h -- LZMA2 and XZ multi-thread library interface
+2026-10-19 : agent : Public domain */
+
+#ifndef ZIP7_INC_LZMA_MT_LIB_H
+#define ZIP7_INC_LZMA_MT_LIB_H
+
+#include "7zTypes.h"
+
+EXTERN_C_BEGIN
+
+#define Z7_STDAPI int Z7_STDCALL
+
+/*
+These functions are buffer-to-buffer wrappers for Lzma2Enc, Lzma2DecMt,
+XzEnc and XzDecMt. Unlike the structures of these coders, the interface
+doesn't depend on Z7_ST, so the same header can be used with the
+single-thread library (7zst) and with the multi-thread library (7zmt).
+The single-thread library ignores (numThreads) and uses one thread.
+
+The encoders split the input into independent blocks of (blockSize) bytes.
+The blocks are encoded in parallel, but the output doesn't depend on the
+number of threads: for same (level, dictSize, blockSize) the single-thread
+and multi-thread libraries write identical streams. The xz encoder always
+stores the sizes in block headers, so the multi-thread decoders can decode
+the blocks in parallel.
+
+level      - compression level: 0 <= level <= 9, default (-1) = 5.
+             See LzmaLib.h for details.
+
+dictSize   - The dictionary size in bytes. The default (0) depends on level.
+
+blockSize  - The size of independent block:
+               LZMA_MT_LIB_BLOCK_SIZE_AUTO  : (0) the size depends on dictSize
+                                              (4 * dictSize, from 1 MB to 256 MB)
+               LZMA_MT_LIB_BLOCK_SIZE_SOLID : (-1) one block; only one thread is used
+             Smaller blocks allow more threads but reduce compression ratio.
+
+numThreads - The number of threads. The default (-1) is 1.
+             (numThreads <= LzmaMtLib_GetThreadsMax()).
+
+Worst case output size (one block) is about:
+  srcLen + srcLen / 1024 + 256
+And each additional block can add up to 64 bytes in xz format.
+
+Returns:
+  SZ_OK                - OK
+  SZ_ERROR_MEM         - Memory allocation error
+  SZ_ERROR_PARAM       - Incorrect paramater
+  SZ_ERROR_DATA        - Data error
+  SZ_ERROR_CRC         - CRC error
+  SZ_ERROR_UNSUPPORTED - Unsupported properties
+  SZ_ERROR_NO_ARCHIVE  - is not xz archive
+  SZ_ERROR_INPUT_EOF   - it needs more bytes in input buffer (src)
+  SZ_ERROR_OUTPUT_EOF  - output buffer overflow
+  SZ_ERROR_THREAD      - errors in multithreading functions (only for Mt version)
+*/
+
+#define LZMA_MT_LIB_BLOCK_SIZE_AUTO   ((UInt64)0)
+#define LZMA_MT_LIB_BLOCK_SIZE_SOLID  ((UInt64)(Int64)-1)
+
+/* returns the maximum number of coder threads. It's 1 for single-thread library */
+int LzmaMtLib_GetThreadsMax(void);
+
+/*
+Lzma2MtCompress
+---------------
+In:
+  dest     - output data buffer
+  destLen  - output data buffer size
+  src      - input data
+  srcLen   - input data size
+Out:
+  destLen  - processed output size
+  outProp  - LZMA2 property byte (dictionary size)
+*/
+
+Z7_STDAPI Lzma2MtCompress(unsigned char *dest, size_t *destLen, const unsigned char *src, size_t srcLen,
+  unsigned char *outProp,
+  int level,          /* 0 <= level <= 9, default = 5 */
+  unsigned dictSize,  /* default = 0 */
+  UInt64 blockSize,   /* default = LZMA_MT_LIB_BLOCK_SIZE_AUTO */
+  int numThreads      /* default = 1 */
+  );
+
+/*
+Lzma2MtUncompress
+-----------------
+In:
+  dest     - output data buffer
+  destLen  - output data buffer size
+  src      - input data
+  srcLen   - input data size
+  prop     - LZMA2 property byte
+Out:
+  destLen  - processed output size
+  srcLen   - processed input size
+*/
+
+Z7_STDAPI Lzma2MtUncompress(unsigned char *dest, size_t *destLen, const unsigned char *src, size_t *srcLen,
+  unsigned char prop,
+  int numThreads);
+
+/*
+XzMtCompress
+------------
+  checkId - XZ_CHECK_* value from Xz.h, default (-1) = XZ_CHECK_CRC32
+  Other parameters are same as in Lzma2MtCompress().
+*/
+
+Z7_STDAPI XzMtCompress(unsigned char *dest, size_t *destLen, const unsigned char *src, size_t srcLen,
+  int level,
+  unsigned dictSize,
+  UInt64 blockSize,
+  int checkId,
+  int numThreads);
+
+/*
+XzMtUncompress
+--------------
+  decodes all xz streams in (src).
+  Parameters are same as in Lzma2MtUncompress().
+*/
+
+Z7_STDAPI XzMtUncompress(unsigned char *dest, size_t *destLen, const unsigned char *src, size_t *srcLen,
+  int numThreads);
+
+EXTERN_C_END
+
+#endif
@@ -0,0 +1,633 @@
+/* 7zStreamTest.c -- Test application for streaming extraction from 7z archive
+2026-10-19 : agent : Public domain */
+
+/*
+The test writes solid 7z archives in memory and extracts them with
+SzArEx_ExtractFolder(). It checks the data and CRC results of files,
+and it checks that the peak memory usage doesn't depend on the size
+of solid block.
+*/
+
+#include "Precomp.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../7z.h"
+#include "../../7zCrc.h"
+#include "../../Alloc.h"
+#include "../../Bra.h"
+#include "../../CpuArch.h"
+#include "../../Delta.h"
+#include "../../Lzma2Enc.h"
+#include "../../LzmaEnc.h"
+
+#define k_LZMA2 0x21
+#define k_LZMA  0x30101
+#define k_BCJ   0x3030103
+#define k_Delta 3
+
+#define TEST_DICT_SIZE ((UInt32)1 << 20)
+
+static const size_t g_FileSizes[] =
+{
+  (size_t)3 << 20,
+  0,
+  ((size_t)5 << 20) + 3,
+  1,
+  (size_t)4 << 20,
+  0
+};
+
+#define NUM_FILES (sizeof(g_FileSizes) / sizeof(g_FileSizes[0]))
+
+/* the empty files after the last data of folder don't belong to folder */
+#define NUM_FOLDER_FILES (NUM_FILES - 1)
+
+typedef struct
+{
+  const char *name;
+  UInt32 method;
+  UInt32 filter;
+} CTestProps;
+
+static const CTestProps g_Tests[] =
+{
+  { "lzma2+bcj",   k_LZMA2, k_BCJ },
+  { "lzma+delta4", k_LZMA,  k_Delta }
+};
+
+#define NUM_TESTS (sizeof(g_Tests) / sizeof(g_Tests[0]))
+
+static Byte *g_Data;
+static size_t g_DataSize;
+static size_t g_FilePos[NUM_FILES + 1];
+static UInt32 g_FileCrcs[NUM_FILES];
+
+
+static int Error(const char *s, const char *name, int res)
+{
+  fprintf(stderr, "\nERROR: %s : %s : res=%d\n", s, name, res);
+  return 1;
+}
+
+
+/* text-like data, x86-like data with CALL instructions, and a repeated part */
+
+static void GenerateData(Byte *p, size_t size)
+{
+  UInt32 x = 1;
+  size_t i;
+  const size_t size1 = size / 3;
+  const size_t size2 = size1 * 2;
+  for (i = 0; i < size1; i++)
+  {
+    x = x * 1103515245 + 12345;
+    p[i] = (Byte)('a' + (x >> 16) % ((x >> 30) + 3));
+  }
+  for (; i < size2; i++)
+  {
+    x = x * 1103515245 + 12345;
+    p[i] = (Byte)(((x >> 16) & 7) == 0 ? 0xE8 : (x >> 24) & 0x3F);
+  }
+  for (; i < size; i++)
+    p[i] = p[i - (1 << 14) - (i >> 18)];
+}
+
+
+/* ---------- allocator with peak size ---------- */
+
+static size_t g_AllocCur;
+static size_t g_AllocPeak;
+
+static void *CountAlloc(ISzAllocPtr p, size_t size)
+{
+  size_t *a;
+  UNUSED_VAR(p)
+  a = (size_t *)malloc(size + sizeof(size_t) * 2);
+  if (!a)
+    return NULL;
+  a[0] = size;
+  g_AllocCur += size;
+  if (g_AllocPeak < g_AllocCur)
+    g_AllocPeak = g_AllocCur;
+  return a + 2;
+}
+
+static void CountFree(ISzAllocPtr p, void *address)
+{
+  UNUSED_VAR(p)
+  if (address)
+  {
+    size_t *a = (size_t *)address - 2;
+    g_AllocCur -= a[0];
+    free(a);
+  }
+}
+
+static const ISzAlloc g_CountAlloc = { CountAlloc, CountFree };
+
+
+/* ---------- archive writer ---------- */
+
+typedef struct
+{
+  Byte *buf;
+  size_t pos;
+} CWriter;
+
+static void WriteByte(CWriter *p, unsigned b)
+{
+  p->buf[p->pos++] = (Byte)b;
+}
+
+static void WriteBytes(CWriter *p, const void *data, size_t size)
+{
+  memcpy(p->buf + p->pos, data, size);
+  p->pos += size;
+}
+
+static void WriteNumber(CWriter *p, UInt64 v)
+{
+  Byte firstByte = 0;
+  Byte mask = 0x80;
+  unsigned i;
+  for (i = 0; i < 8; i++)
+  {
+    if (v < ((UInt64)1 << (7 * (i + 1))))
+    {
+      firstByte |= (Byte)(v >> (8 * i));
+      break;
+    }
+    firstByte |= mask;
+    mask = (Byte)(mask >> 1);
+  }
+  WriteByte(p, firstByte);
+  for (; i > 0; i--)
+  {
+    WriteByte(p, (Byte)v);
+    v >>= 8;
+  }
+}
+
+static void WriteUi32(CWriter *p, UInt32 v)
+{
+  Byte b[4];
+  SetUi32(b, v)
+  WriteBytes(p, b, 4);
+}
+
+static void WriteUi64(CWriter *p, UInt64 v)
+{
+  Byte b[8];
+  SetUi64(b, v)
+  WriteBytes(p, b, 8);
+}
+
+static void WriteMethodID(CWriter *p, UInt32 id, const Byte *props, unsigned propsSize)
+{
+  unsigned idSize = 1;
+  while (idSize < 4 && (id >> (8 * idSize)) != 0)
+    idSize++;
+  WriteByte(p, idSize | (propsSize != 0 ? 0x20 : 0));
+  while (idSize != 0)
+    WriteByte(p, (Byte)(id >> (8 * --idSize)));
+  if (propsSize != 0)
+  {
+    WriteNumber(p, propsSize);
+    WriteBytes(p, props, propsSize);
+  }
+}
+
+static void WriteBoolVector(CWriter *p, const BoolInt *v, unsigned num)
+{
+  unsigned i;
+  Byte b = 0;
+  for (i = 0; i < num; i++)
+  {
+    if (v[i])
+      b |= (Byte)(0x80 >> (i & 7));
+    if ((i & 7) == 7)
+    {
+      WriteByte(p, b);
+      b = 0;
+    }
+  }
+  if ((num & 7) != 0)
+    WriteByte(p, b);
+}
+
+
+/*
+The folder consists of main coder (0) and filter (1),
+with the bond from output of main coder to input of filter.
+The CRC of file (badCrcIndex) is written incorrectly.
+*/
+
+static SRes WriteArchive(const CTestProps *t, Byte *archive, size_t *archiveSize, unsigned badCrcIndex)
+{
+  CWriter w;
+  Byte props[LZMA_PROPS_SIZE];
+  SizeT propsSize = LZMA_PROPS_SIZE;
+  Byte filterProps[1];
+  unsigned filterPropsSize = 0;
+  SizeT packSize = *archiveSize - 32;
+  Byte *packBuf = archive + 32;
+  size_t headerPos;
+  Byte *filtered;
+  unsigned i, numEmpty;
+  BoolInt emptyStreams[NUM_FILES];
+  BoolInt emptyFiles[NUM_FILES];
+
+  filtered = (Byte *)malloc(g_DataSize);
+  if (!filtered)
+    return SZ_ERROR_MEM;
+  memcpy(filtered, g_Data, g_DataSize);
+  if (t->filter == k_BCJ)
+  {
+    UInt32 state = Z7_BRANCH_CONV_ST_X86_STATE_INIT_VAL;
+    z7_BranchConvSt_X86_Enc(filtered, g_DataSize, 0, &state);
+  }
+  else
+  {
+    Byte deltaState[DELTA_STATE_SIZE];
+    const unsigned delta = 4;
+    Delta_Init(deltaState);
+    Delta_Encode(deltaState, delta, filtered, g_DataSize);
+    filterProps[0] = (Byte)(delta - 1);
+    filterPropsSize = 1;
+  }
+
+  {
+    SRes res;
+    if (t->method == k_LZMA2)
+    {
+      CLzma2EncProps p2;
+      CLzma2EncHandle enc = Lzma2Enc_Create(&g_Alloc, &g_BigAlloc);
+      if (!enc)
+        res = SZ_ERROR_MEM;
+      else
+      {
+        Lzma2EncProps_Init(&p2);
+        p2.lzmaProps.level = 1;
+        p2.lzmaProps.dictSize = TEST_DICT_SIZE;
+        p2.blockSize = LZMA2_ENC_PROPS_BLOCK_SIZE_SOLID;
+        res = Lzma2Enc_SetProps(enc, &p2);
+        if (res == SZ_OK)
+        {
+          props[0] = Lzma2Enc_WriteProperties(enc);
+          propsSize = 1;
+          Lzma2Enc_SetDataSize(enc, g_DataSize);
+          res = Lzma2Enc_Encode2(enc, NULL, packBuf, &packSize, NULL, filtered, g_DataSize, NULL);
+        }
+        Lzma2Enc_Destroy(enc);
+      }
+    }
+    else
+    {
+      CLzmaEncProps p1;
+      LzmaEncProps_Init(&p1);
+      p1.level = 1;
+      p1.dictSize = TEST_DICT_SIZE;
+      res = LzmaEncode(packBuf, &packSize, filtered, g_DataSize,
+          &p1, props, &propsSize, 0, NULL, &g_Alloc, &g_BigAlloc);
+    }
+    free(filtered);
+    RINOK(res)
+  }
+
+  w.buf = archive;
+  w.pos = 32 + packSize;
+  headerPos = w.pos;
+
+  WriteByte(&w, 0x01); /* kHeader */
+  WriteByte(&w, 0x04); /* kMainStreamsInfo */
+  
+  WriteByte(&w, 0x06); /* kPackInfo */
+  WriteNumber(&w, 0);
+  WriteNumber(&w, 1);
+  WriteByte(&w, 0x09); /* kSize */
+  WriteNumber(&w, packSize);
+  WriteByte(&w, 0x00);
+
+  WriteByte(&w, 0x07); /* kUnpackInfo */
+  WriteByte(&w, 0x0B); /* kFolder */
+  WriteNumber(&w, 1);
+  WriteByte(&w, 0);
+  WriteNumber(&w, 2);
+  WriteMethodID(&w, t->method, props, (unsigned)propsSize);
+  WriteMethodID(&w, t->filter, filterProps, filterPropsSize);
+  WriteNumber(&w, 1); /* bond: InIndex */
+  WriteNumber(&w, 0); /* bond: OutIndex */
+  WriteByte(&w, 0x0C); /* kCodersUnpackSize */
+  WriteNumber(&w, g_DataSize);
+  WriteNumber(&w, g_DataSize);
+  WriteByte(&w, 0x00);
+
+  WriteByte(&w, 0x08); /* kSubStreamsInfo */
+  numEmpty = 0;
+  for (i = 0; i < NUM_FILES; i++)
+  {
+    emptyStreams[i] = (g_FileSizes[i] == 0);
+    emptyFiles[i] = True;
+    numEmpty += (unsigned)emptyStreams[i];
+  }
+  WriteByte(&w, 0x0D); /* kNumUnpackStream */
+  WriteNumber(&w, NUM_FILES - numEmpty);
+  WriteByte(&w, 0x09); /* kSize */
+  {
+    unsigned last = NUM_FILES;
+    while (last != 0 && emptyStreams[last - 1])
+      last--;
+    for (i = 0; i + 1 < last; i++)
+      if (!emptyStreams[i])
+        WriteNumber(&w, g_FileSizes[i]);
+  }
+  WriteByte(&w, 0x0A); /* kCRC */
+  WriteByte(&w, 1);
+  for (i = 0; i < NUM_FILES; i++)
+    if (!emptyStreams[i])
+      WriteUi32(&w, g_FileCrcs[i] ^ (i == badCrcIndex ? 1 : 0));
+  WriteByte(&w, 0x00);
+  WriteByte(&w, 0x00);
+
+  WriteByte(&w, 0x05); /* kFilesInfo */
+  WriteNumber(&w, NUM_FILES);
+  
+  WriteByte(&w, 0x0E); /* kEmptyStream */
+  WriteNumber(&w, (NUM_FILES + 7) / 8);
+  WriteBoolVector(&w, emptyStreams, NUM_FILES);
+  WriteByte(&w, 0x0F); /* kEmptyFile */
+  WriteNumber(&w, (numEmpty + 7) / 8);
+  WriteBoolVector(&w, emptyFiles, numEmpty);
+  
+  WriteByte(&w, 0x11); /* kName */
+  WriteNumber(&w, 1 + NUM_FILES * 2 * 2);
+  WriteByte(&w, 0);
+  for (i = 0; i < NUM_FILES; i++)
+  {
+    WriteByte(&w, 'a' + i);
+    WriteByte(&w, 0);
+    WriteByte(&w, 0);
+    WriteByte(&w, 0);
+  }
+  WriteByte(&w, 0x00);
+  WriteByte(&w, 0x00);
+
+  {
+    const size_t headerSize = w.pos - headerPos;
+    const UInt32 headerCrc = CrcCalc(archive + headerPos, headerSize);
+    *archiveSize = w.pos;
+    w.pos = 0;
+    WriteBytes(&w, k7zSignature, k7zSignatureSize);
+    WriteByte(&w, 0);
+    WriteByte(&w, 4);
+    WriteUi32(&w, 0);
+    WriteUi64(&w, packSize);
+    WriteUi64(&w, headerSize);
+    WriteUi32(&w, headerCrc);
+    SetUi32(archive + 8, CrcCalc(archive + 12, 20))
+  }
+  return SZ_OK;
+}
+
+
+/* ---------- archive reader ---------- */
+
+typedef struct
+{
+  ISeekInStream vt;
+  const Byte *data;
+  size_t size;
+  size_t pos;
+} CBufSeekInStream;
+
+static SRes BufSeekInStream_Read(ISeekInStreamPtr pp, void *buf, size_t *size)
+{
+  Z7_CONTAINER_FROM_VTBL_TO_DECL_VAR_pp_vt_p(CBufSeekInStream)
+  size_t size2 = p->size - p->pos;
+  if (size2 > *size)
+    size2 = *size;
+  if (size2 != 0)
+    memcpy(buf, p->data + p->pos, size2);
+  p->pos += size2;
+  *size = size2;
+  return SZ_OK;
+}
+
+static SRes BufSeekInStream_Seek(ISeekInStreamPtr pp, Int64 *pos, ESzSeek origin)
+{
+  Z7_CONTAINER_FROM_VTBL_TO_DECL_VAR_pp_vt_p(CBufSeekInStream)
+  Int64 newPos = *pos;
+  switch (origin)
+  {
+    case SZ_SEEK_SET: break;
+    case SZ_SEEK_CUR: newPos += (Int64)p->pos; break;
+    case SZ_SEEK_END: newPos += (Int64)p->size; break;
+    default: return SZ_ERROR_PARAM;
+  }
+  if (newPos < 0 || (UInt64)newPos > p->size)
+    return SZ_ERROR_PARAM;
+  p->pos = (size_t)newPos;
+  *pos = newPos;
+  return SZ_OK;
+}
+
+
+/* ---------- extract callback ---------- */
+
+typedef struct
+{
+  ISeqOutStream vt;
+  const Byte *data;
+  size_t rem;
+  size_t failAfter;
+  BoolInt differs;
+} CCompareOutStream;
+
+static size_t CompareOutStream_Write(ISeqOutStreamPtr pp, const void *data, size_t size)
+{
+  Z7_CONTAINER_FROM_VTBL_TO_DECL_VAR_pp_vt_p(CCompareOutStream)
+  if (size > p->failAfter)
+    size = p->failAfter;
+  p->failAfter -= size;
+  if (size > p->rem || memcmp(p->data, data, size) != 0)
+    p->differs = True;
+  else
+  {
+    p->data += size;
+    p->rem -= size;
+  }
+  return size;
+}
+
+typedef struct
+{
+  ISzExtractCallback vt;
+  CCompareOutStream stream;
+  UInt32 failFileIndex;
+  UInt32 nextFileIndex;
+  BoolInt error;
+  SRes fileResults[NUM_FILES];
+} CExtractCallback;
+
+static SRes ExtractCallback_GetStream(ISzExtractCallbackPtr pp, UInt32 fileIndex, ISeqOutStreamPtr *outStream)
+{
+  Z7_CONTAINER_FROM_VTBL_TO_DECL_VAR_pp_vt_p(CExtractCallback)
+  if (fileIndex != p->nextFileIndex)
+    p->error = True;
+  p->nextFileIndex = fileIndex + 1;
+  p->stream.data = g_Data + g_FilePos[fileIndex];
+  p->stream.rem = g_FileSizes[fileIndex];
+  p->stream.failAfter = (fileIndex == p->failFileIndex ? 1000 : (size_t)0 - 1);
+  p->stream.differs = False;
+  *outStream = &p->stream.vt;
+  return SZ_OK;
+}
+
+static SRes ExtractCallback_SetOperationResult(ISzExtractCallbackPtr pp, UInt32 fileIndex, SRes res)
+{
+  Z7_CONTAINER_FROM_VTBL_TO_DECL_VAR_pp_vt_p(CExtractCallback)
+  if (fileIndex + 1 != p->nextFileIndex
+      || p->stream.differs
+      || (res == SZ_OK && p->stream.rem != 0))
+    p->error = True;
+  p->fileResults[fileIndex] = res;
+  return SZ_OK;
+}
+
+
+static SRes Extract(const Byte *archive, size_t archiveSize, CExtractCallback *cb, UInt32 failFileIndex)
+{
+  CBufSeekInStream inStream;
+  CLookToRead2 lookStream;
+  CSzArEx db;
+  SRes res;
+  unsigned i;
+
+  inStream.vt.Read = BufSeekInStream_Read;
+  inStream.vt.Seek = BufSeekInStream_Seek;
+  inStream.data = archive;
+  inStream.size = archiveSize;
+  inStream.pos = 0;
+
+  LookToRead2_CreateVTable(&lookStream, False);
+  lookStream.buf = (Byte *)malloc((size_t)1 << 14);
+  if (!lookStream.buf)
+    return SZ_ERROR_MEM;
+  lookStream.bufSize = (size_t)1 << 14;
+  lookStream.realStream = &inStream.vt;
+  LookToRead2_INIT(&lookStream)
+
+  cb->vt.GetStream = ExtractCallback_GetStream;
+  cb->vt.SetOperationResult = ExtractCallback_SetOperationResult;
+  cb->stream.vt.Write = CompareOutStream_Write;
+  cb->stream.differs = False;
+  cb->failFileIndex = failFileIndex;
+  cb->nextFileIndex = 0;
+  cb->error = False;
+  for (i = 0; i < NUM_FILES; i++)
+    cb->fileResults[i] = -1;
+
+  SzArEx_Init(&db);
+  res = SzArEx_Open(&db, &lookStream.vt, &g_Alloc, &g_Alloc);
+  if (res == SZ_OK)
+  {
+    if (db.NumFiles != NUM_FILES || db.db.NumFolders != 1)
+      res = SZ_ERROR_FAIL;
+    else
+    {
+      g_AllocCur = 0;
+      g_AllocPeak = 0;
+      res = SzArEx_ExtractFolder(&db, &lookStream.vt, 0, &cb->vt, &g_CountAlloc);
+      if (g_AllocCur != 0)
+        res = SZ_ERROR_FAIL;
+    }
+  }
+  SzArEx_Free(&db, &g_Alloc);
+  free(lookStream.buf);
+  return res;
+}
+
+
+static int Test(const CTestProps *t, Byte *archive)
+{
+  CExtractCallback cb;
+  size_t archiveSize;
+  SRes res;
+  unsigned i;
+
+  archiveSize = g_DataSize + g_DataSize / 64 + (1 << 16);
+  res = WriteArchive(t, archive, &archiveSize, NUM_FILES);
+  if (res != SZ_OK)
+    return Error("write archive", t->name, res);
+  
+  res = Extract(archive, archiveSize, &cb, NUM_FILES);
+  if (res != SZ_OK || cb.error || cb.nextFileIndex != NUM_FOLDER_FILES)
+    return Error("extract", t->name, res);
+  for (i = 0; i < NUM_FOLDER_FILES; i++)
+    if (cb.fileResults[i] != SZ_OK)
+      return Error("file result", t->name, cb.fileResults[i]);
+  
+  printf("%-12s : folder %8u : archive %8u : peak memory %8u\n", t->name,
+      (unsigned)g_DataSize, (unsigned)archiveSize, (unsigned)g_AllocPeak);
+  if (g_AllocPeak > TEST_DICT_SIZE + ((size_t)1 << 20))
+    return Error("memory usage depends on the size of folder", t->name, 0);
+
+  /* CRC error in file (2): other files are extracted */
+  archiveSize = g_DataSize + g_DataSize / 64 + (1 << 16);
+  res = WriteArchive(t, archive, &archiveSize, 2);
+  if (res != SZ_OK)
+    return Error("write archive", t->name, res);
+  res = Extract(archive, archiveSize, &cb, NUM_FILES);
+  if (res != SZ_ERROR_CRC || cb.error || cb.nextFileIndex != NUM_FOLDER_FILES)
+    return Error("CRC error", t->name, res);
+  for (i = 0; i < NUM_FOLDER_FILES; i++)
+    if (cb.fileResults[i] != (i == 2 ? SZ_ERROR_CRC : SZ_OK))
+      return Error("CRC error : file result", t->name, cb.fileResults[i]);
+  
+  /* write error in file (2): the extraction is stopped */
+  res = Extract(archive, archiveSize, &cb, 2);
+  if (res != SZ_ERROR_WRITE || cb.error || cb.nextFileIndex != 3)
+    return Error("write error", t->name, res);
+  for (i = 0; i < NUM_FILES; i++)
+    if (cb.fileResults[i] != (i < 2 ? SZ_OK : i == 2 ? SZ_ERROR_WRITE : -1))
+      return Error("write error : file result", t->name, cb.fileResults[i]);
+  
+  return 0;
+}
+
+
+int Z7_CDECL main(void)
+{
+  Byte *archive;
+  unsigned i;
+  int res = 0;
+
+  CrcGenerateTable();
+
+  g_DataSize = 0;
+  for (i = 0; i < NUM_FILES; i++)
+  {
+    g_FilePos[i] = g_DataSize;
+    g_DataSize += g_FileSizes[i];
+  }
+  g_FilePos[NUM_FILES] = g_DataSize;
+
+  g_Data = (Byte *)malloc(g_DataSize);
+  archive = (Byte *)malloc(g_DataSize + g_DataSize / 64 + (1 << 16));
+  if (!g_Data || !archive)
+    return Error("cannot allocate memory", "", 0);
+
+  GenerateData(g_Data, g_DataSize);
+  for (i = 0; i < NUM_FILES; i++)
+    g_FileCrcs[i] = CrcCalc(g_Data + g_FilePos[i], g_FileSizes[i]);
+
+  for (i = 0; i < NUM_TESTS && res == 0; i++)
+    res = Test(&g_Tests[i], archive);
+
+  free(g_Data);
+  free(archive);
+  return res;
+}
@@ -0,0 +1,209 @@
+/* Bench7z.c -- lzma2301 part of LzmaBench
+2026-10-19 : agent : Public domain */
+
+#include "Precomp.h"
+
+#include <string.h>
+
+#include "../../7zCrc.h"
+#include "../../Xz.h"
+#include "../../XzCrc64.h"
+#include "../../XzEnc.h"
+
+#include "LzmaBench.h"
+
+#ifndef Z7_ST
+#include "../../MtCoder.h"
+#endif
+
+
+static void *SzBenchAlloc(ISzAllocPtr p, size_t size)
+{
+  UNUSED_VAR(p)
+  return BenchAlloc(size);
+}
+
+static void SzBenchFree(ISzAllocPtr p, void *address)
+{
+  UNUSED_VAR(p)
+  BenchFree(address);
+}
+
+static const ISzAlloc g_BenchAlloc = { SzBenchAlloc, SzBenchFree };
+
+
+/* ---------- CBufInStream / CBufOutStream ---------- */
+
+typedef struct
+{
+  ISeqInStream vt;
+  const Byte *data;
+  size_t rem;
+} CBufInStream;
+
+static SRes BufInStream_Read(ISeqInStreamPtr pp, void *data, size_t *size)
+{
+  Z7_CONTAINER_FROM_VTBL_TO_DECL_VAR_pp_vt_p(CBufInStream)
+  size_t size2 = *size;
+  if (size2 > p->rem)
+    size2 = p->rem;
+  if (size2 != 0)
+  {
+    memcpy(data, p->data, size2);
+    p->data += size2;
+    p->rem -= size2;
+  }
+  *size = size2;
+  return SZ_OK;
+}
+
+typedef struct
+{
+  ISeqOutStream vt;
+  Byte *data;
+  size_t size;
+  size_t pos;
+} CBufOutStream;
+
+static size_t BufOutStream_Write(ISeqOutStreamPtr pp, const void *data, size_t size)
+{
+  Z7_CONTAINER_FROM_VTBL_TO_DECL_VAR_pp_vt_p(CBufOutStream)
+  if (size > p->size - p->pos)
+    size = p->size - p->pos;
+  if (size != 0)
+  {
+    memcpy(p->data + p->pos, data, size);
+    p->pos += size;
+  }
+  return size;
+}
+
+
+unsigned Bench7z_GetThreadsMax(void)
+{
+  CrcGenerateTable();
+  Crc64GenerateTable();
+ #ifndef Z7_ST
+  return MTCODER_THREADS_MAX;
+ #else
+  return 1;
+ #endif
+}
+
+
+int Bench7z_Encode(const CBenchEncProps *props,
+    const unsigned char *src, size_t srcSize, unsigned char *dest, size_t *destSize)
+{
+  CXzProps xzProps;
+  CLzmaEncProps *lp = &xzProps.lzma2Props.lzmaProps;
+  CXzEncHandle enc;
+  CBufInStream inStream;
+  CBufOutStream outStream;
+  SRes res;
+
+  XzProps_Init(&xzProps);
+  lp->dictSize = props->lzma.dictSize;
+  lp->lc = (int)props->lzma.lc;
+  lp->lp = (int)props->lzma.lp;
+  lp->pb = (int)props->lzma.pb;
+  lp->algo = props->lzma.fastMode ? 0 : 1;
+  lp->fb = (int)props->lzma.niceLen;
+  lp->btMode = (int)props->lzma.btMode;
+  lp->numHashBytes = (int)props->lzma.numHashBytes;
+  lp->mc = props->lzma.depth;
+  lp->numThreads = 1;
+  /* one LZMA2 coder per xz Block, as in liblzma */
+  xzProps.lzma2Props.blockSize = LZMA2_ENC_PROPS_BLOCK_SIZE_SOLID;
+  xzProps.lzma2Props.numTotalThreads = 1;
+  if (props->x86)
+    xzProps.filterProps.id = XZ_ID_X86;
+  xzProps.checkId = XZ_CHECK_CRC32;
+  xzProps.blockSize = props->blockSize;
+  xzProps.numBlockThreads_Max = (int)props->numThreads;
+  xzProps.numTotalThreads = (int)props->numThreads;
+  xzProps.forceWriteSizesInHeader = 1;
+  xzProps.reduceSize = srcSize;
+
+  inStream.vt.Read = BufInStream_Read;
+  inStream.data = src;
+  inStream.rem = srcSize;
+  outStream.vt.Write = BufOutStream_Write;
+  outStream.data = dest;
+  outStream.size = *destSize;
+  outStream.pos = 0;
+
+  enc = XzEnc_Create(&g_BenchAlloc, &g_BenchAlloc);
+  if (!enc)
+    return SZ_ERROR_MEM;
+  res = XzEnc_SetProps(enc, &xzProps);
+  if (res == SZ_OK)
+  {
+    XzEnc_SetDataSize(enc, srcSize);
+    res = XzEnc_Encode(enc, &outStream.vt, &inStream.vt, NULL);
+  }
+  XzEnc_Destroy(enc);
+  *destSize = outStream.pos;
+  return res;
+}
+
+
+static int Bench7z_DecodeSt(
+    const unsigned char *src, size_t srcSize, unsigned char *dest, size_t *destSize)
+{
+  CXzUnpacker xz;
+  SizeT destLen = *destSize;
+  SizeT srcLen = srcSize;
+  ECoderStatus status;
+  SRes res;
+
+  XzUnpacker_Construct(&xz, &g_BenchAlloc);
+  XzUnpacker_Init(&xz);
+  res = XzUnpacker_CodeFull(&xz, dest, &destLen, src, &srcLen, CODER_FINISH_END, &status);
+  if (res == SZ_OK && (srcLen != srcSize || !XzUnpacker_IsStreamWasFinished(&xz)))
+    res = SZ_ERROR_DATA;
+  XzUnpacker_Free(&xz);
+  *destSize = destLen;
+  return res;
+}
+
+
+int Bench7z_Decode(unsigned numThreads,
+    const unsigned char *src, size_t srcSize, unsigned char *dest, size_t *destSize)
+{
+  CXzDecMtProps props;
+  CXzDecMtHandle dec;
+  CXzStatInfo stat;
+  CBufInStream inStream;
+  CBufOutStream outStream;
+  int isMT = False;
+  SRes res;
+
+  if (numThreads == 0)
+    return Bench7z_DecodeSt(src, srcSize, dest, destSize);
+
+  XzDecMtProps_Init(&props);
+ #ifndef Z7_ST
+  props.numThreads = numThreads;
+  /* liblzma's decoder is used without memory limit too */
+  props.memUseMax = (size_t)1 << (sizeof(size_t) * 8 - 2);
+ #endif
+
+  inStream.vt.Read = BufInStream_Read;
+  inStream.data = src;
+  inStream.rem = srcSize;
+  outStream.vt.Write = BufOutStream_Write;
+  outStream.data = dest;
+  outStream.size = *destSize;
+  outStream.pos = 0;
+
+  dec = XzDecMt_Create(&g_BenchAlloc, &g_BenchAlloc);
+  if (!dec)
+    return SZ_ERROR_MEM;
+  res = XzDecMt_Decode(dec, &props, NULL, 1,
+      &outStream.vt, &inStream.vt, &stat, &isMT, NULL);
+  XzDecMt_Destroy(dec);
+  if (res == SZ_OK && (stat.DataAfterEnd || stat.InSize != srcSize))
+    res = SZ_ERROR_DATA;
+  *destSize = outStream.pos;
+  return res;
+}
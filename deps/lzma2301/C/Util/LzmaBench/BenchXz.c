@@ -0,0 +1,155 @@
+/* BenchXz.c -- liblzma part of LzmaBench
+2026-10-19 : agent : Public domain */
+
+#include "Precomp.h"
+
+#include <string.h>
+
+#include <lzma.h>
+
+#include "LzmaBench.h"
+
+
+static void *XzBenchAlloc(void *opaque, size_t nmemb, size_t size)
+{
+  (void)opaque;
+  if (size != 0 && nmemb > (size_t)-1 / size)
+    return NULL;
+  return BenchAlloc(nmemb * size);
+}
+
+static void XzBenchFree(void *opaque, void *ptr)
+{
+  (void)opaque;
+  BenchFree(ptr);
+}
+
+static const lzma_allocator g_XzBenchAlloc = { XzBenchAlloc, XzBenchFree, NULL };
+
+
+/*
+  liblzma's preset is converted to the properties of 7-Zip encoder.
+  liblzma resolves (depth == 0) in lz_encoder.c with same formulas.
+*/
+
+int BenchXz_GetPreset(unsigned level, CBenchLzmaProps *props)
+{
+  lzma_options_lzma opt;
+  if (lzma_lzma_preset(&opt, level))
+    return 1;
+  props->dictSize = opt.dict_size;
+  props->lc = opt.lc;
+  props->lp = opt.lp;
+  props->pb = opt.pb;
+  props->fastMode = (opt.mode == LZMA_MODE_FAST);
+  props->niceLen = opt.nice_len;
+  switch (opt.mf)
+  {
+    case LZMA_MF_HC3: props->btMode = 0; props->numHashBytes = 3; break;
+    case LZMA_MF_HC4: props->btMode = 0; props->numHashBytes = 4; break;
+    case LZMA_MF_BT2: props->btMode = 1; props->numHashBytes = 2; break;
+    case LZMA_MF_BT3: props->btMode = 1; props->numHashBytes = 3; break;
+    case LZMA_MF_BT4: props->btMode = 1; props->numHashBytes = 4; break;
+    default: return 1;
+  }
+  props->depth = opt.depth;
+  if (props->depth == 0)
+    props->depth = props->btMode ?
+        16 + props->niceLen / 2 :
+         4 + props->niceLen / 4;
+  return 0;
+}
+
+
+static int BenchXz_Code(lzma_stream *strm,
+    const unsigned char *src, size_t srcSize, unsigned char *dest, size_t *destSize)
+{
+  lzma_ret ret;
+  strm->next_in = src;
+  strm->avail_in = srcSize;
+  strm->next_out = dest;
+  strm->avail_out = *destSize;
+  do
+    ret = lzma_code(strm, LZMA_FINISH);
+  while (ret == LZMA_OK);
+  *destSize -= strm->avail_out;
+  lzma_end(strm);
+  if (ret != LZMA_STREAM_END)
+    return (int)ret;
+  return strm->avail_in == 0 ? 0 : LZMA_DATA_ERROR;
+}
+
+
+int BenchXz_Encode(const CBenchEncProps *props,
+    const unsigned char *src, size_t srcSize, unsigned char *dest, size_t *destSize)
+{
+  lzma_stream strm = LZMA_STREAM_INIT;
+  lzma_options_lzma opt;
+  lzma_filter filters[3];
+  lzma_mt mt;
+  lzma_ret ret;
+  unsigned i = 0;
+
+  if (lzma_lzma_preset(&opt, 0))
+    return 1;
+  opt.dict_size = props->lzma.dictSize;
+  opt.lc = props->lzma.lc;
+  opt.lp = props->lzma.lp;
+  opt.pb = props->lzma.pb;
+  opt.mode = props->lzma.fastMode ? LZMA_MODE_FAST : LZMA_MODE_NORMAL;
+  opt.nice_len = props->lzma.niceLen;
+  /* LZMA_MF_HC3 = 0x03, LZMA_MF_HC4 = 0x04, LZMA_MF_BT2 = 0x12, ... */
+  opt.mf = (lzma_match_finder)(props->lzma.btMode ?
+      0x10 + props->lzma.numHashBytes :
+      props->lzma.numHashBytes);
+  opt.depth = props->lzma.depth;
+
+  if (props->x86)
+  {
+    filters[i].id = LZMA_FILTER_X86;
+    filters[i].options = NULL;
+    i++;
+  }
+  filters[i].id = LZMA_FILTER_LZMA2;
+  filters[i].options = &opt;
+  i++;
+  filters[i].id = LZMA_VLI_UNKNOWN;
+  filters[i].options = NULL;
+
+  memset(&mt, 0, sizeof(mt));
+  mt.threads = props->numThreads;
+  mt.block_size = props->blockSize;
+  mt.filters = filters;
+  mt.check = LZMA_CHECK_CRC32;
+
+  strm.allocator = &g_XzBenchAlloc;
+  ret = lzma_stream_encoder_mt(&strm, &mt);
+  if (ret != LZMA_OK)
+    return (int)ret;
+  return BenchXz_Code(&strm, src, srcSize, dest, destSize);
+}
+
+
+int BenchXz_Decode(unsigned numThreads,
+    const unsigned char *src, size_t srcSize, unsigned char *dest, size_t *destSize)
+{
+  lzma_stream strm = LZMA_STREAM_INIT;
+  lzma_ret ret;
+
+  strm.allocator = &g_XzBenchAlloc;
+  if (numThreads == 0)
+    ret = lzma_stream_decoder(&strm, UINT64_MAX, 0);
+  else
+  {
+    lzma_mt mt;
+    memset(&mt, 0, sizeof(mt));
+    mt.threads = numThreads;
+    /* XzDecMt is used without memory limit too */
+    mt.memlimit_threading = UINT64_MAX;
+    mt.memlimit_stop = UINT64_MAX;
+    ret = lzma_stream_decoder_mt(&strm, &mt);
+  }
+  if (ret != LZMA_OK)
+    return (int)ret;
+  return BenchXz_Code(&strm, src, srcSize, dest, destSize);
+}
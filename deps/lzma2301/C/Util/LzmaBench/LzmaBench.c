@@ -0,0 +1,743 @@
+/* LzmaBench.c -- LZMA2 / xz benchmark for lzma2301 and liblzma
+2026-10-19 : agent : Public domain */
+
+/*
+Usage: LzmaBench [options]
+  -m <MiB>        : size of each generated corpus, default 8
+  -l <list>       : liblzma presets, default 1,6
+  -t <list>       : numbers of threads, default 1,2,4
+  -b <bytes>      : xz Block size, default max(3 * dictSize, 1 MiB)
+  -r <num>        : repetitions, the best time is reported, default 3
+  -f <name=path>  : add a file corpus
+  -F <name=path>  : add a file corpus that is encoded with BCJ x86 filter
+  -g <list>       : generated corpora, default text,x86,compressed
+  -o <path>       : write results as JSON lines to <path>
+
+Both libraries write .xz streams with LZMA2 and CRC32. The LZMA
+properties of lzma2301 are taken from liblzma's preset, and both
+encoders use same Block size, so the streams are comparable and the
+number of threads doesn't change them. Each stream is also decoded
+by the other library's decoder before timing.
+*/
+
+#include "Precomp.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include "../../7zWindows.h"
+#else
+#include <time.h>
+#endif
+
+#include "../../CpuArch.h"
+#include "../../Threads.h"
+
+#include "LzmaBench.h"
+
+#define BENCH_MAX_THREADS_VARIANTS 16
+#define BENCH_MAX_LEVELS 10
+#define BENCH_MAX_CORPORA 16
+
+typedef struct
+{
+  char *name;
+  const char *path;   /* NULL for generated corpus */
+  Byte *data;
+  size_t size;
+  BoolInt x86;
+} CCorpus;
+
+typedef struct
+{
+  const char *corpus;
+  size_t size;
+  const char *lib;
+  const char *op;
+  const char *coder;
+  unsigned level;
+  unsigned numThreads;
+  size_t packSize;
+  double seconds;
+  size_t peak;
+  double speed1;      /* speed with first number of threads, for scaling */
+} CResult;
+
+static unsigned g_Levels[BENCH_MAX_LEVELS];
+static unsigned g_NumLevels;
+static unsigned g_Threads[BENCH_MAX_THREADS_VARIANTS];
+static unsigned g_NumThreadsVariants;
+static CCorpus g_Corpora[BENCH_MAX_CORPORA];
+static unsigned g_NumCorpora;
+static UInt64 g_BlockSize;
+static unsigned g_NumReps = 3;
+static unsigned g_Threads7zMax;
+static FILE *g_Json;
+
+static Byte *g_Pack7z;
+static Byte *g_PackXz;
+static Byte *g_Unpack;
+static size_t g_PackCapacity;
+
+
+/* ---------- BenchAlloc ---------- */
+
+/*
+  Both libraries allocate through BenchAlloc, so (peak) is the maximum
+  size of heap blocks of the coder. Thread stacks are not counted.
+  The header keeps the block size. Its size doesn't reduce the
+  alignment of malloc() blocks.
+*/
+
+#define BENCH_ALLOC_ALIGN 64
+
+static CCriticalSection g_AllocCs;
+static size_t g_AllocCur;
+static size_t g_AllocPeak;
+
+void *BenchAlloc(size_t size)
+{
+  Byte *p;
+  if (size == 0)
+    size = 1;
+  if (size > (size_t)-1 - BENCH_ALLOC_ALIGN)
+    return NULL;
+  p = (Byte *)malloc(size + BENCH_ALLOC_ALIGN);
+  if (!p)
+    return NULL;
+  *(size_t *)(void *)p = size;
+  CriticalSection_Enter(&g_AllocCs);
+  g_AllocCur += size;
+  if (g_AllocPeak < g_AllocCur)
+    g_AllocPeak = g_AllocCur;
+  CriticalSection_Leave(&g_AllocCs);
+  return p + BENCH_ALLOC_ALIGN;
+}
+
+void BenchFree(void *address)
+{
+  Byte *p;
+  if (!address)
+    return;
+  p = (Byte *)address - BENCH_ALLOC_ALIGN;
+  CriticalSection_Enter(&g_AllocCs);
+  g_AllocCur -= *(const size_t *)(const void *)p;
+  CriticalSection_Leave(&g_AllocCs);
+  free(p);
+}
+
+static void BenchAlloc_ResetPeak(void)
+{
+  CriticalSection_Enter(&g_AllocCs);
+  g_AllocPeak = g_AllocCur;
+  CriticalSection_Leave(&g_AllocCs);
+}
+
+static size_t BenchAlloc_GetPeak(void)
+{
+  size_t peak;
+  CriticalSection_Enter(&g_AllocCs);
+  peak = g_AllocPeak - g_AllocCur;
+  CriticalSection_Leave(&g_AllocCs);
+  return peak;
+}
+
+
+/* ---------- Timer ---------- */
+
+static double GetTime(void)
+{
+ #ifdef _WIN32
+  LARGE_INTEGER freq, v;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&v);
+  return (double)v.QuadPart / (double)freq.QuadPart;
+ #else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+ #endif
+}
+
+
+/* ---------- Corpora ---------- */
+
+static UInt32 g_Rand;
+
+static UInt32 Rand(void)
+{
+  /* xorshift32 */
+  UInt32 x = g_Rand;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  g_Rand = x;
+  return x;
+}
+
+#define TEXT_NUM_WORDS 4096
+
+/* words with Zipf-like frequencies, punctuation and lines */
+
+static void GenerateText(Byte *p, size_t size)
+{
+  char words[TEXT_NUM_WORDS][12];
+  unsigned i;
+  size_t pos = 0;
+  unsigned lineLen = 0;
+
+  for (i = 0; i < TEXT_NUM_WORDS; i++)
+  {
+    const unsigned len = 1 + i / 512 + Rand() % 4;
+    unsigned k;
+    for (k = 0; k < len; k++)
+    {
+      /* vowels are more frequent */
+      const UInt32 r = Rand();
+      words[i][k] = (r & 1) ?
+          "aeiou"[(r >> 1) % 5] :
+          "bcdfghjklmnprstvwy"[(r >> 1) % 18];
+    }
+    words[i][len] = 0;
+  }
+
+  while (pos < size)
+  {
+    const UInt32 r1 = Rand() % TEXT_NUM_WORDS;
+    const UInt32 r2 = Rand() % TEXT_NUM_WORDS;
+    const char *w = words[(r1 * r2) / TEXT_NUM_WORDS];
+    const UInt32 r = Rand();
+    while (*w && pos < size)
+      p[pos++] = (Byte)*w++;
+    lineLen++;
+    if (pos == size)
+      break;
+    if ((r & 15) == 0)
+      p[pos++] = (Byte)((r & 16) ? '.' : ',');
+    if (pos == size)
+      break;
+    if (lineLen >= 10 + (r >> 28))
+    {
+      p[pos++] = '\n';
+      lineLen = 0;
+    }
+    else
+      p[pos++] = ' ';
+  }
+}
+
+
+#define X86_NUM_FUNCS 1024
+
+/*
+  x86-like code: short instruction sequences with frequent
+  CALL / JMP rel32 (E8 / E9) to a limited set of functions.
+  BCJ x86 filter converts the relative addresses to absolute ones.
+*/
+
+static void GenerateX86(Byte *p, size_t size)
+{
+  static const Byte kOps[][4] =
+  {
+    { 3, 0x48, 0x89, 0xE5 },
+    { 1, 0x55, 0, 0 },
+    { 2, 0x5D, 0xC3, 0 },
+    { 3, 0x48, 0x83, 0xEC },
+    { 2, 0x8B, 0x45, 0 },
+    { 2, 0x89, 0x45, 0 },
+    { 3, 0x0F, 0xB6, 0x07 },
+    { 2, 0x31, 0xC0, 0 },
+    { 2, 0x85, 0xC0, 0 },
+    { 1, 0x74, 0, 0 },
+    { 1, 0x75, 0, 0 },
+    { 3, 0x48, 0x8D, 0x3D }
+  };
+  UInt32 funcs[X86_NUM_FUNCS];
+  size_t pos = 0;
+  unsigned i;
+
+  for (i = 0; i < X86_NUM_FUNCS; i++)
+    funcs[i] = (UInt32)(((UInt64)size * i / X86_NUM_FUNCS) + Rand() % 64);
+
+  while (pos < size)
+  {
+    const UInt32 r = Rand();
+    if ((r & 7) < 2 && size - pos >= 5)
+    {
+      /* CALL or JMP rel32 */
+      const UInt32 f = (r >> 8) % X86_NUM_FUNCS;
+      const UInt32 target = funcs[((r >> 3) & 1) ? f : f * f / X86_NUM_FUNCS];
+      const UInt32 rel = target - (UInt32)(pos + 5);
+      p[pos++] = (Byte)((r & 0x80) ? 0xE9 : 0xE8);
+      SetUi32(p + pos, rel)
+      pos += 4;
+    }
+    else
+    {
+      const Byte *op = kOps[(r >> 8) % Z7_ARRAY_SIZE(kOps)];
+      unsigned k;
+      for (k = 1; k <= op[0] && pos < size; k++)
+        p[pos++] = op[k];
+      /* imm8 / disp8 */
+      if ((r >> 20) & 1 && pos < size)
+        p[pos++] = (Byte)((r >> 24) & 0xF8);
+    }
+  }
+}
+
+
+/* already compressed data is incompressible for LZMA */
+
+static void GenerateCompressed(Byte *p, size_t size)
+{
+  size_t i;
+  for (i = 0; i < size; i++)
+    p[i] = (Byte)(Rand() >> 24);
+}
+
+
+static int Corpus_Load(CCorpus *c)
+{
+  FILE *f = fopen(c->path, "rb");
+  long size;
+  if (!f)
+    return 1;
+  if (fseek(f, 0, SEEK_END) != 0 || (size = ftell(f)) < 0 || fseek(f, 0, SEEK_SET) != 0)
+  {
+    fclose(f);
+    return 1;
+  }
+  c->size = (size_t)size;
+  c->data = (Byte *)malloc(c->size + 1);
+  if (!c->data || fread(c->data, 1, c->size, f) != c->size)
+  {
+    fclose(f);
+    return 1;
+  }
+  fclose(f);
+  return 0;
+}
+
+
+static int Corpus_Generate(CCorpus *c, size_t size)
+{
+  c->size = size;
+  c->data = (Byte *)malloc(size + 1);
+  if (!c->data)
+    return 1;
+  /* each corpus has its own seed, so the data doesn't depend on the order */
+  g_Rand = 0x12345678;
+  if (strcmp(c->name, "text") == 0)
+    GenerateText(c->data, size);
+  else if (strcmp(c->name, "x86") == 0)
+  {
+    c->x86 = True;
+    GenerateX86(c->data, size);
+  }
+  else if (strcmp(c->name, "compressed") == 0)
+    GenerateCompressed(c->data, size);
+  else
+    return 1;
+  return 0;
+}
+
+
+/* ---------- Output ---------- */
+
+static void PrintHeader(void)
+{
+  printf("\n%-10s %5s %-8s %-22s %3s %10s %7s %10s %6s\n",
+      "corpus", "level", "lib", "coder", "T", "MB/s", "ratio", "peak KiB", "scale");
+}
+
+static void PrintResult(const CResult *r)
+{
+  const double speed = (double)r->size / r->seconds / 1000000;
+  const double ratio = (double)r->packSize / (double)r->size;
+  const double scale = speed / r->speed1;
+
+  printf("%-10s %5u %-8s %-22s %3u %10.2f %7.4f %10lu %6.2f\n",
+      r->corpus, r->level, r->lib, r->coder, r->numThreads,
+      speed, ratio, (unsigned long)(r->peak >> 10), scale);
+
+  if (g_Json)
+    fprintf(g_Json,
+        "{\"corpus\":\"%s\",\"size\":%lu,\"lib\":\"%s\",\"op\":\"%s\",\"coder\":\"%s\","
+        "\"level\":%u,\"threads\":%u,\"pack_size\":%lu,\"ratio\":%.4f,"
+        "\"mbps\":%.2f,\"peak_kib\":%lu,\"scale\":%.2f}\n",
+        r->corpus, (unsigned long)r->size, r->lib, r->op, r->coder,
+        r->level, r->numThreads, (unsigned long)r->packSize, ratio,
+        speed, (unsigned long)(r->peak >> 10), scale);
+}
+
+
+/* ---------- Benchmark ---------- */
+
+typedef int (*Func_Encode)(const CBenchEncProps *props,
+    const unsigned char *src, size_t srcSize, unsigned char *dest, size_t *destSize);
+typedef int (*Func_Decode)(unsigned numThreads,
+    const unsigned char *src, size_t srcSize, unsigned char *dest, size_t *destSize);
+
+typedef struct
+{
+  const char *name;
+  const char *encoder;
+  const char *decoderSt;
+  const char *decoderMt;
+  Func_Encode encode;
+  Func_Decode decode;
+  Byte **pack;
+} CLib;
+
+static const CLib g_Libs[] =
+{
+  { "lzma2301", "XzEnc", "XzDec", "XzDecMt",
+      Bench7z_Encode, Bench7z_Decode, &g_Pack7z },
+  { "liblzma", "lzma_stream_encoder_mt", "lzma_stream_decoder", "lzma_stream_decoder_mt",
+      BenchXz_Encode, BenchXz_Decode, &g_PackXz }
+};
+
+#define NUM_LIBS Z7_ARRAY_SIZE(g_Libs)
+
+
+static int Error(const char *s, const char *lib, const char *corpus, int res)
+{
+  fprintf(stderr, "\nERROR: %s : %s : %s : res=%d\n", s, lib, corpus, res);
+  return 1;
+}
+
+
+static int RunEncode(const CLib *lib, const CCorpus *c, const CBenchEncProps *props,
+    size_t *packSize, CResult *r)
+{
+  unsigned i;
+  for (i = 0; i < g_NumReps; i++)
+  {
+    double t;
+    int res;
+    *packSize = g_PackCapacity;
+    BenchAlloc_ResetPeak();
+    t = GetTime();
+    res = lib->encode(props, c->data, c->size, *lib->pack, packSize);
+    t = GetTime() - t;
+    if (res != 0)
+      return res;
+    if (i == 0 || r->seconds > t)
+      r->seconds = t;
+    r->peak = BenchAlloc_GetPeak();
+  }
+  r->packSize = *packSize;
+  return 0;
+}
+
+
+static int RunDecode(const CLib *lib, const CCorpus *c, unsigned numThreads,
+    const Byte *pack, size_t packSize, CResult *r)
+{
+  unsigned i;
+  for (i = 0; i < g_NumReps; i++)
+  {
+    double t;
+    size_t size = c->size + 1;
+    int res;
+    BenchAlloc_ResetPeak();
+    t = GetTime();
+    res = lib->decode(numThreads, pack, packSize, g_Unpack, &size);
+    t = GetTime() - t;
+    if (res != 0)
+      return res;
+    if (size != c->size || memcmp(g_Unpack, c->data, size) != 0)
+      return -1;
+    if (i == 0 || r->seconds > t)
+      r->seconds = t;
+    r->peak = BenchAlloc_GetPeak();
+  }
+  r->packSize = packSize;
+  return 0;
+}
+
+
+static int BenchLevel(const CCorpus *c, unsigned level)
+{
+  CBenchEncProps props;
+  size_t packSizes[NUM_LIBS];
+  unsigned li, k;
+
+  if (BenchXz_GetPreset(level, &props.lzma) != 0)
+    return Error("unsupported preset", "liblzma", c->name, (int)level);
+  props.x86 = c->x86;
+  props.blockSize = g_BlockSize;
+  if (props.blockSize == 0)
+  {
+    props.blockSize = (UInt64)props.lzma.dictSize * 3;
+    if (props.blockSize < ((UInt64)1 << 20))
+      props.blockSize = (UInt64)1 << 20;
+  }
+
+  for (li = 0; li < NUM_LIBS; li++)
+  {
+    const CLib *lib = &g_Libs[li];
+    CResult r;
+    memset(&r, 0, sizeof(r));
+    r.corpus = c->name;
+    r.size = c->size;
+    r.lib = lib->name;
+    r.level = level;
+
+    r.op = "compress";
+    r.coder = lib->encoder;
+    r.speed1 = 0;
+    for (k = 0; k < g_NumThreadsVariants; k++)
+    {
+      int res;
+      r.numThreads = props.numThreads = g_Threads[k];
+      if (li == 0 && r.numThreads > g_Threads7zMax)
+        continue;
+      res = RunEncode(lib, c, &props, &packSizes[li], &r);
+      if (res != 0)
+        return Error("encode", lib->name, c->name, res);
+      if (r.speed1 == 0)
+        r.speed1 = (double)r.size / r.seconds / 1000000;
+      PrintResult(&r);
+    }
+
+    r.op = "decompress";
+    r.coder = lib->decoderSt;
+    r.numThreads = 1;
+    {
+      const int res = RunDecode(lib, c, 0, *lib->pack, packSizes[li], &r);
+      if (res != 0)
+        return Error("decode", lib->name, c->name, res);
+      r.speed1 = (double)r.size / r.seconds / 1000000;
+      PrintResult(&r);
+    }
+
+    r.coder = lib->decoderMt;
+    r.speed1 = 0;
+    for (k = 0; k < g_NumThreadsVariants; k++)
+    {
+      int res;
+      r.numThreads = g_Threads[k];
+      if (li == 0 && r.numThreads > g_Threads7zMax)
+        continue;
+      res = RunDecode(lib, c, r.numThreads, *lib->pack, packSizes[li], &r);
+      if (res != 0)
+        return Error("decode", lib->name, c->name, res);
+      if (r.speed1 == 0)
+        r.speed1 = (double)r.size / r.seconds / 1000000;
+      PrintResult(&r);
+    }
+  }
+
+  /* each library must decode the stream of other library */
+  for (li = 0; li < NUM_LIBS; li++)
+  {
+    const CLib *lib = &g_Libs[li];
+    const unsigned other = (li + 1) % NUM_LIBS;
+    size_t size = c->size + 1;
+    const int res = lib->decode(0, *g_Libs[other].pack, packSizes[other], g_Unpack, &size);
+    if (res != 0 || size != c->size || memcmp(g_Unpack, c->data, size) != 0)
+      return Error("cross decode", lib->name, c->name, res);
+  }
+  return 0;
+}
+
+
+static int ParseList(const char *s, unsigned *items, unsigned maxItems, unsigned *numItems)
+{
+  *numItems = 0;
+  for (;;)
+  {
+    char *end;
+    const unsigned long v = strtoul(s, &end, 10);
+    if (end == s || *numItems == maxItems)
+      return 1;
+    items[(*numItems)++] = (unsigned)v;
+    if (*end == 0)
+      return 0;
+    if (*end != ',')
+      return 1;
+    s = end + 1;
+  }
+}
+
+
+static int AddCorpus(const char *name, size_t nameLen, const char *path, BoolInt x86)
+{
+  CCorpus *c;
+  char *s;
+  if (g_NumCorpora == BENCH_MAX_CORPORA)
+    return 1;
+  s = (char *)malloc(nameLen + 1);
+  if (!s)
+    return 1;
+  memcpy(s, name, nameLen);
+  s[nameLen] = 0;
+  c = &g_Corpora[g_NumCorpora++];
+  c->name = s;
+  c->path = path;
+  c->data = NULL;
+  c->size = 0;
+  c->x86 = x86;
+  return 0;
+}
+
+
+static int AddGenerated(const char *list)
+{
+  for (;;)
+  {
+    const char *end = strchr(list, ',');
+    const size_t len = end ? (size_t)(end - list) : strlen(list);
+    if (len == 0 || AddCorpus(list, len, NULL, False) != 0)
+      return 1;
+    if (!end)
+      return 0;
+    list = end + 1;
+  }
+}
+
+
+static void PrintUsage(void)
+{
+  fputs(
+      "Usage: LzmaBench [-m MiB] [-l levels] [-t threads] [-b blockSize] [-r reps]\n"
+      "                 [-g text,x86,compressed] [-f name=path] [-F name=path] [-o out.jsonl]\n",
+      stderr);
+}
+
+
+int Z7_CDECL main(int numArgs, const char *args[])
+{
+  size_t genSize = (size_t)8 << 20;
+  const char *genList = NULL;
+  const char *jsonPath = NULL;
+  unsigned numFiles = 0;
+  size_t maxSize = 0;
+  int res = 0;
+  int i;
+  unsigned ci;
+
+  g_Levels[0] = 1;
+  g_Levels[1] = 6;
+  g_NumLevels = 2;
+  g_Threads[0] = 1;
+  g_Threads[1] = 2;
+  g_Threads[2] = 4;
+  g_NumThreadsVariants = 3;
+
+  for (i = 1; i < numArgs; i++)
+  {
+    const char *a = args[i];
+    const char *v;
+    if (a[0] != '-' || a[1] == 0 || a[2] != 0 || i + 1 == numArgs)
+    {
+      PrintUsage();
+      return 1;
+    }
+    v = args[++i];
+    switch (a[1])
+    {
+      case 'm': genSize = (size_t)strtoul(v, NULL, 10) << 20; break;
+      case 'l': res = ParseList(v, g_Levels, BENCH_MAX_LEVELS, &g_NumLevels); break;
+      case 't': res = ParseList(v, g_Threads, BENCH_MAX_THREADS_VARIANTS, &g_NumThreadsVariants); break;
+      case 'b': g_BlockSize = (UInt64)strtoul(v, NULL, 10); break;
+      case 'r': g_NumReps = (unsigned)strtoul(v, NULL, 10); break;
+      case 'g': genList = v; break;
+      case 'o': jsonPath = v; break;
+      case 'f':
+      case 'F':
+      {
+        const char *eq = strchr(v, '=');
+        if (!eq || eq == v || eq[1] == 0)
+          res = 1;
+        else
+          res = AddCorpus(v, (size_t)(eq - v), eq + 1, (BoolInt)(a[1] == 'F'));
+        numFiles++;
+        break;
+      }
+      default: res = 1;
+    }
+    if (res != 0)
+    {
+      PrintUsage();
+      return 1;
+    }
+  }
+
+  /* the files replace the generated corpora, if -g is not specified */
+  if (!genList && numFiles == 0)
+    genList = "text,x86,compressed";
+  if (genList && AddGenerated(genList) != 0)
+  {
+    PrintUsage();
+    return 1;
+  }
+  if (g_NumCorpora == 0 || g_NumReps == 0 || genSize == 0)
+  {
+    PrintUsage();
+    return 1;
+  }
+  /* MT coders need one thread at least */
+  for (ci = 0; ci < g_NumThreadsVariants; ci++)
+    if (g_Threads[ci] == 0)
+    {
+      PrintUsage();
+      return 1;
+    }
+
+  if (CriticalSection_Init(&g_AllocCs) != 0)
+    return Error("cannot create critical section", "", "", 0);
+  g_Threads7zMax = Bench7z_GetThreadsMax();
+
+  for (ci = 0; ci < g_NumCorpora; ci++)
+  {
+    CCorpus *c = &g_Corpora[ci];
+    if (c->path ? Corpus_Load(c) : Corpus_Generate(c, genSize))
+      return Error(c->path ? "cannot read file" : "unknown corpus",
+          "", c->path ? c->path : c->name, 0);
+    if (maxSize < c->size)
+      maxSize = c->size;
+  }
+
+  g_PackCapacity = maxSize + maxSize / 32 + (1 << 16);
+  g_Pack7z = (Byte *)malloc(g_PackCapacity);
+  g_PackXz = (Byte *)malloc(g_PackCapacity);
+  g_Unpack = (Byte *)malloc(maxSize + 1);
+  if (!g_Pack7z || !g_PackXz || !g_Unpack)
+    return Error("cannot allocate memory", "", "", 0);
+
+  if (jsonPath)
+  {
+    g_Json = fopen(jsonPath, "w");
+    if (!g_Json)
+      return Error("cannot create file", "", jsonPath, 0);
+  }
+
+  if (g_Threads7zMax < 2)
+    fputs("lzma2301 is single-threaded, its rows with T > 1 are skipped\n", stderr);
+
+  PrintHeader();
+  for (ci = 0; ci < g_NumCorpora && res == 0; ci++)
+  {
+    unsigned k;
+    for (k = 0; k < g_NumLevels && res == 0; k++)
+      res = BenchLevel(&g_Corpora[ci], g_Levels[k]);
+  }
+
+  if (g_Json && fclose(g_Json) != 0 && res == 0)
+    res = Error("cannot write file", "", jsonPath, 0);
+
+  for (ci = 0; ci < g_NumCorpora; ci++)
+  {
+    free(g_Corpora[ci].data);
+    free(g_Corpora[ci].name);
+  }
+  free(g_Pack7z);
+  free(g_PackXz);
+  free(g_Unpack);
+  CriticalSection_Delete(&g_AllocCs);
+  return res;
+}
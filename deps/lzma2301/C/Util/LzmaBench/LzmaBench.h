@@ -0,0 +1,69 @@
+/* LzmaBench.h -- LZMA2 / xz benchmark for lzma2301 and liblzma
+2026-10-19 : agent : Public domain */
+
+#ifndef ZIP7_INC_LZMA_BENCH_H
+#define ZIP7_INC_LZMA_BENCH_H
+
+/*
+Bench7z.c uses the headers of lzma2301 and BenchXz.c uses lzma.h of liblzma.
+Both libraries define LZMA_* names, so the interface between the files
+uses only standard C types.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* LZMA encoder properties of liblzma preset (lzma_options_lzma) */
+
+typedef struct
+{
+  uint32_t dictSize;
+  unsigned lc;
+  unsigned lp;
+  unsigned pb;
+  unsigned fastMode;      /* LZMA_MODE_FAST */
+  unsigned niceLen;
+  unsigned btMode;        /* binary tree match finder */
+  unsigned numHashBytes;  /* 2, 3 or 4 */
+  unsigned depth;         /* the depth after liblzma's default (0) is resolved */
+} CBenchLzmaProps;
+
+typedef struct
+{
+  CBenchLzmaProps lzma;
+  int x86;                /* BCJ x86 filter before LZMA2 */
+  uint64_t blockSize;     /* size of xz Block */
+  unsigned numThreads;
+} CBenchEncProps;
+
+/* The functions return 0 on success.
+   (*destSize) is the size of (dest) on input and the size of data on output. */
+
+/* Bench7z_GetThreadsMax() also initializes CRC tables, so it must be called first */
+unsigned Bench7z_GetThreadsMax(void);
+int Bench7z_Encode(const CBenchEncProps *props,
+    const unsigned char *src, size_t srcSize, unsigned char *dest, size_t *destSize);
+/* (numThreads == 0) : XzUnpacker (XzDec.c); else XzDecMt */
+int Bench7z_Decode(unsigned numThreads,
+    const unsigned char *src, size_t srcSize, unsigned char *dest, size_t *destSize);
+
+int BenchXz_GetPreset(unsigned level, CBenchLzmaProps *props);
+int BenchXz_Encode(const CBenchEncProps *props,
+    const unsigned char *src, size_t srcSize, unsigned char *dest, size_t *destSize);
+/* (numThreads == 0) : lzma_stream_decoder(); else lzma_stream_decoder_mt() */
+int BenchXz_Decode(unsigned numThreads,
+    const unsigned char *src, size_t srcSize, unsigned char *dest, size_t *destSize);
+
+/* thread-safe allocator that counts the peak size of allocated blocks (LzmaBench.c) */
+void *BenchAlloc(size_t size);
+void BenchFree(void *address);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,410 @@
+/* LzmaMtTest.c -- Test application for LzmaMtLib
+2026-10-19 : agent : Public domain */
+
+/*
+Usage:
+  LzmaMtTest w <dir> : (single-thread library) encodes test data and writes
+                       the reference streams to <dir>
+  LzmaMtTest c <dir> : (multi-thread library) encodes test data with
+                       different numbers of threads, compares the streams
+                       with the reference streams, and decodes the reference
+                       streams with multi-thread decoders.
+Both modes also test XzEnc and XzUnpacker directly.
+*/
+
+#include "Precomp.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../7zCrc.h"
+#include "../../Xz.h"
+#include "../../XzCrc64.h"
+#include "../../XzEnc.h"
+#include "../../LzmaMtLib.h"
+
+#define TEST_DATA_SIZE ((size_t)3 << 20)
+#define TEST_OUT_SIZE (TEST_DATA_SIZE + TEST_DATA_SIZE / 1024 + (1 << 12))
+
+typedef struct
+{
+  const char *name;
+  int level;
+  unsigned dictSize;
+  UInt64 blockSize;
+} CTestProps;
+
+static const CTestProps g_Tests[] =
+{
+  { "fast",  1, 0,              (UInt64)1 << 18 },
+  { "bt4",   5, (UInt32)1 << 20, (UInt64)1 << 19 },
+  { "auto",  1, (UInt32)1 << 16, LZMA_MT_LIB_BLOCK_SIZE_AUTO },
+  { "solid", 3, 0,              LZMA_MT_LIB_BLOCK_SIZE_SOLID }
+};
+
+#define NUM_TESTS (sizeof(g_Tests) / sizeof(g_Tests[0]))
+
+static const int g_NumThreads[] = { 1, 2, 4 };
+
+#define NUM_THREADS_VARIANTS (sizeof(g_NumThreads) / sizeof(g_NumThreads[0]))
+
+static Byte *g_Data;
+static Byte *g_Out;
+static Byte *g_Ref;
+static Byte *g_Dec;
+
+
+static int Error(const char *s, const char *name, int numThreads, int res)
+{
+  fprintf(stderr, "\nERROR: %s : %s : threads=%d : res=%d\n", s, name, numThreads, res);
+  return 1;
+}
+
+
+/* text-like data, a repeated part and incompressible data */
+
+static void GenerateData(Byte *p, size_t size)
+{
+  UInt32 x = 1;
+  size_t i;
+  const size_t size1 = size / 2;
+  const size_t size2 = size1 + size / 4;
+  for (i = 0; i < size1; i++)
+  {
+    x = x * 1103515245 + 12345;
+    p[i] = (Byte)('a' + (x >> 16) % ((x >> 30) + 3));
+  }
+  for (; i < size2; i++)
+    p[i] = p[i - (1 << 12) - (i >> 16)];
+  for (; i < size; i++)
+  {
+    x = x * 1103515245 + 12345;
+    p[i] = (Byte)(x >> 24);
+  }
+}
+
+
+static void MakePath(char *path, const char *dir, const char *name, const char *ext)
+{
+  sprintf(path, "%s/%s.%s", dir, name, ext);
+}
+
+
+static int WriteFile(const char *path, const Byte *data, size_t size)
+{
+  FILE *f = fopen(path, "wb");
+  int res = 0;
+  if (!f)
+    return 1;
+  if (fwrite(data, 1, size, f) != size)
+    res = 1;
+  if (fclose(f) != 0)
+    res = 1;
+  return res;
+}
+
+
+static int ReadFile(const char *path, Byte *data, size_t *size)
+{
+  FILE *f = fopen(path, "rb");
+  if (!f)
+    return 1;
+  *size = fread(data, 1, *size, f);
+  fclose(f);
+  return 0;
+}
+
+
+static int Encode(const CTestProps *t, BoolInt xz, int numThreads, size_t *outSize)
+{
+  *outSize = TEST_OUT_SIZE - 1;
+  if (xz)
+    return XzMtCompress(g_Out, outSize, g_Data, TEST_DATA_SIZE,
+        t->level, t->dictSize, t->blockSize, XZ_CHECK_CRC32, numThreads);
+  return Lzma2MtCompress(g_Out + 1, outSize, g_Data, TEST_DATA_SIZE,
+      g_Out, t->level, t->dictSize, t->blockSize, numThreads);
+}
+
+
+static int Decode(const Byte *src, size_t srcSize, BoolInt xz, int numThreads)
+{
+  size_t destLen = TEST_DATA_SIZE + 1;
+  size_t srcLen;
+  int res;
+  if (xz)
+  {
+    srcLen = srcSize;
+    res = XzMtUncompress(g_Dec, &destLen, src, &srcLen, numThreads);
+  }
+  else
+  {
+    srcLen = srcSize - 1;
+    res = Lzma2MtUncompress(g_Dec, &destLen, src + 1, &srcLen, src[0], numThreads);
+    srcLen++;
+  }
+  if (res != SZ_OK)
+    return res;
+  if (srcLen != srcSize
+      || destLen != TEST_DATA_SIZE
+      || memcmp(g_Dec, g_Data, TEST_DATA_SIZE) != 0)
+    return SZ_ERROR_DATA;
+  return SZ_OK;
+}
+
+
+/* ---------- allocator that fills new blocks and counts them ---------- */
+
+static int g_NumAllocs;
+
+static void *FillAlloc(ISzAllocPtr p, size_t size)
+{
+  void *a;
+  UNUSED_VAR(p)
+  a = malloc(size);
+  if (a)
+  {
+    /* the coders must not read fields that they didn't initialize */
+    memset(a, 0xA5, size);
+    g_NumAllocs++;
+  }
+  return a;
+}
+
+static void FillFree(ISzAllocPtr p, void *address)
+{
+  UNUSED_VAR(p)
+  if (address)
+  {
+    g_NumAllocs--;
+    free(address);
+  }
+}
+
+static const ISzAlloc g_FillAlloc = { FillAlloc, FillFree };
+
+
+/* ---------- streams ---------- */
+
+typedef struct
+{
+  ISeqInStream vt;
+  const Byte *data;
+  size_t rem;
+} CBufInStream;
+
+static SRes BufInStream_Read(ISeqInStreamPtr pp, void *buf, size_t *size)
+{
+  Z7_CONTAINER_FROM_VTBL_TO_DECL_VAR_pp_vt_p(CBufInStream)
+  if (*size > p->rem)
+    *size = p->rem;
+  memcpy(buf, p->data, *size);
+  p->data += *size;
+  p->rem -= *size;
+  return SZ_OK;
+}
+
+typedef struct
+{
+  ISeqOutStream vt;
+  Byte *data;
+  size_t pos;
+  size_t size;
+} CBufOutStream;
+
+static size_t BufOutStream_Write(ISeqOutStreamPtr pp, const void *data, size_t size)
+{
+  Z7_CONTAINER_FROM_VTBL_TO_DECL_VAR_pp_vt_p(CBufOutStream)
+  if (size > p->size - p->pos)
+    size = p->size - p->pos;
+  memcpy(p->data + p->pos, data, size);
+  p->pos += size;
+  return size;
+}
+
+
+/*
+XzEnc in single-thread mode uses outBufs[0] for (forceWriteSizesInHeader).
+XzUnpacker_CodeFull() must decode a stream with several blocks:
+all blocks are written to one output buffer.
+*/
+
+static int TestXzCoders(void)
+{
+  CXzProps props;
+  CXzEncHandle enc;
+  CBufInStream inStream;
+  CBufOutStream outStream;
+  CXzUnpacker dec;
+  SizeT destLen = TEST_DATA_SIZE + 1;
+  SizeT srcLen;
+  ECoderStatus status;
+  SRes res;
+
+  CrcGenerateTable();
+  Crc64GenerateTable();
+
+  XzProps_Init(&props);
+  props.lzma2Props.lzmaProps.level = 1;
+  props.blockSize = (UInt64)1 << 18;
+  props.numTotalThreads = 1;
+  props.forceWriteSizesInHeader = 1;
+
+  inStream.vt.Read = BufInStream_Read;
+  inStream.data = g_Data;
+  inStream.rem = TEST_DATA_SIZE;
+  outStream.vt.Write = BufOutStream_Write;
+  outStream.data = g_Out;
+  outStream.pos = 0;
+  outStream.size = TEST_OUT_SIZE;
+
+  g_NumAllocs = 0;
+  enc = XzEnc_Create(&g_FillAlloc, &g_FillAlloc);
+  if (!enc)
+    return Error("cannot allocate memory", "XzEnc", 1, SZ_ERROR_MEM);
+  res = XzEnc_SetProps(enc, &props);
+  if (res == SZ_OK)
+    res = XzEnc_Encode(enc, &outStream.vt, &inStream.vt, NULL);
+  XzEnc_Destroy(enc);
+  if (res != SZ_OK)
+    return Error("encode", "XzEnc", 1, res);
+  if (g_NumAllocs != 0)
+    return Error("memory leak", "XzEnc", 1, g_NumAllocs);
+
+  XzUnpacker_Construct(&dec, &g_FillAlloc);
+  srcLen = outStream.pos;
+  res = XzUnpacker_CodeFull(&dec, g_Dec, &destLen, g_Out, &srcLen,
+      CODER_FINISH_END, &status);
+  if (res == SZ_OK && !XzUnpacker_IsStreamWasFinished(&dec))
+    res = SZ_ERROR_DATA;
+  XzUnpacker_Free(&dec);
+  if (res != SZ_OK)
+    return Error("decode", "XzUnpacker_CodeFull", 1, res);
+  if (srcLen != outStream.pos
+      || destLen != TEST_DATA_SIZE
+      || memcmp(g_Dec, g_Data, TEST_DATA_SIZE) != 0)
+    return Error("decode", "XzUnpacker_CodeFull", 1, SZ_ERROR_DATA);
+
+  printf("XzEnc / XzUnpacker_CodeFull : %8u : OK\n", (unsigned)outStream.pos);
+  return 0;
+}
+
+
+static int TestWrite(const char *dir)
+{
+  unsigned i;
+  for (i = 0; i < NUM_TESTS * 2; i++)
+  {
+    const CTestProps *t = &g_Tests[i / 2];
+    const BoolInt xz = (BoolInt)(i & 1);
+    char path[1024];
+    size_t outSize;
+    int res;
+
+    res = Encode(t, xz, 1, &outSize);
+    if (res != SZ_OK)
+      return Error("encode", t->name, 1, res);
+    outSize += (xz ? 0 : 1);
+    res = Decode(g_Out, outSize, xz, 1);
+    if (res != SZ_OK)
+      return Error("decode", t->name, 1, res);
+
+    MakePath(path, dir, t->name, xz ? "xz" : "lzma2");
+    if (WriteFile(path, g_Out, outSize) != 0)
+      return Error("cannot write file", path, 1, 0);
+    printf("%-6s %-5s : %8u\n", t->name, xz ? "xz" : "lzma2", (unsigned)outSize);
+  }
+  return 0;
+}
+
+
+static int TestCompare(const char *dir)
+{
+  unsigned i;
+
+  if (LzmaMtLib_GetThreadsMax() <= 1)
+    return Error("the library is single-threaded", "", 0, 0);
+
+  for (i = 0; i < NUM_TESTS * 2; i++)
+  {
+    const CTestProps *t = &g_Tests[i / 2];
+    const BoolInt xz = (BoolInt)(i & 1);
+    char path[1024];
+    size_t refSize = TEST_OUT_SIZE;
+    unsigned k;
+
+    MakePath(path, dir, t->name, xz ? "xz" : "lzma2");
+    if (ReadFile(path, g_Ref, &refSize) != 0)
+      return Error("cannot read file", path, 0, 0);
+
+    for (k = 0; k < NUM_THREADS_VARIANTS; k++)
+    {
+      const int numThreads = g_NumThreads[k];
+      size_t outSize;
+      int res;
+
+      res = Encode(t, xz, numThreads, &outSize);
+      if (res != SZ_OK)
+        return Error("encode", t->name, numThreads, res);
+      outSize += (xz ? 0 : 1);
+      if (outSize != refSize || memcmp(g_Out, g_Ref, refSize) != 0)
+        return Error("the stream differs from single-thread library", t->name, numThreads, 0);
+
+      res = Decode(g_Ref, refSize, xz, numThreads);
+      if (res != SZ_OK)
+        return Error("decode", t->name, numThreads, res);
+    }
+    printf("%-6s %-5s : %8u : OK\n", t->name, xz ? "xz" : "lzma2", (unsigned)refSize);
+  }
+
+  {
+    /* output buffer overflow */
+    size_t outSize = 100;
+    int res = XzMtCompress(g_Out, &outSize, g_Data, TEST_DATA_SIZE,
+        1, 0, (UInt64)1 << 18, XZ_CHECK_CRC32, 4);
+    if (res != SZ_ERROR_OUTPUT_EOF)
+      return Error("overflow", "xz", 4, res);
+    outSize = 100;
+    res = Lzma2MtCompress(g_Out, &outSize, g_Data, TEST_DATA_SIZE,
+        g_Out + 100, 1, 0, (UInt64)1 << 18, 4);
+    if (res != SZ_ERROR_OUTPUT_EOF)
+      return Error("overflow", "lzma2", 4, res);
+  }
+  return 0;
+}
+
+
+int Z7_CDECL main(int numArgs, const char *args[])
+{
+  int res;
+
+  if (numArgs != 3 || (strcmp(args[1], "w") != 0 && strcmp(args[1], "c") != 0))
+  {
+    fputs("Usage: LzmaMtTest <w|c> dir\n", stderr);
+    return 1;
+  }
+
+  g_Data = (Byte *)malloc(TEST_DATA_SIZE);
+  g_Out = (Byte *)malloc(TEST_OUT_SIZE);
+  g_Ref = (Byte *)malloc(TEST_OUT_SIZE);
+  g_Dec = (Byte *)malloc(TEST_DATA_SIZE + 1);
+  if (!g_Data || !g_Out || !g_Ref || !g_Dec)
+    return Error("cannot allocate memory", "", 0, 0);
+
+  GenerateData(g_Data, TEST_DATA_SIZE);
+
+  res = TestXzCoders();
+  if (res == 0)
+  {
+    if (args[1][0] == 'w')
+      res = TestWrite(args[2]);
+    else
+      res = TestCompare(args[2]);
+  }
+
+  free(g_Data);
+  free(g_Out);
+  free(g_Ref);
+  free(g_Dec);
+  return res;
+}
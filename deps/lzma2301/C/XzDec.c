@@ -1201,7 +1201,10 @@ SRes XzUnpacker_Code(CXzUnpacker *p, Byte *dest, SizeT *destLen,
             p->headerParsedOk = True;
             return SZ_OK;
           }
-          RINOK(XzDecMix_Init(&p->decoder, &p->block, p->outBuf, p->outBufSize))
+          /* in (outBuf) mode the decoder of each block starts from current position in (outBuf) */
+          RINOK(XzDecMix_Init(&p->decoder, &p->block,
+              p->outBuf ? p->outBuf + p->outDataWritten : NULL,
+              p->outBufSize - p->outDataWritten))
         }
         break;
       }
@@ -989,13 +989,13 @@ static void XzEnc_Construct(CXzEnc *p)
   for (i = 0; i < MTCODER_THREADS_MAX; i++)
     Lzma2WithFilters_Construct(&p->lzmaf_Items[i]);
 
+  /* outBufs[0] is used also by single-thread coder (forceWriteSizesInHeader) */
+  for (i = 0; i < MTCODER_BLOCKS_MAX; i++)
+    p->outBufs[i] = NULL;
+  p->outBufSize = 0;
+
   #ifndef Z7_ST
   p->mtCoder_WasConstructed = False;
-  {
-    for (i = 0; i < MTCODER_BLOCKS_MAX; i++)
-      p->outBufs[i] = NULL;
-    p->outBufSize = 0;
-  }
   #endif
 }
 
@@ -1028,8 +1028,8 @@ static void XzEnc_Free(CXzEnc *p, ISzAllocPtr alloc)
     MtCoder_Destruct(&p->mtCoder);
     p->mtCoder_WasConstructed = False;
   }
-  XzEnc_FreeOutBufs(p);
   #endif
+  XzEnc_FreeOutBufs(p);
 }
 
 
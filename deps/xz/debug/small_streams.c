@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: 0BSD
+
+///////////////////////////////////////////////////////////////////////////////
+//
+/// \file       small_streams.c
+/// \brief      Measures the speed of decoding many small .xz files
+///
+/// Usage: small_streams [COUNT [SIZE [PRESET]]]
+///
+/// COUNT .xz files of SIZE bytes each are created in memory with the
+/// given preset (default: 20000 files of 500 bytes with preset 6). They
+/// are decoded first with a new lzma_stream for every file and then by
+/// reinitializing one lzma_stream, which keeps the dictionary buffer.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "sysdefs.h"
+#include "lzma.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+
+static double
+now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+
+static void
+decode_all(lzma_stream *strm, bool reuse, const uint8_t *files,
+		const size_t *file_sizes, size_t count,
+		uint8_t *out, size_t size)
+{
+	for (size_t i = 0; i < count; ++i) {
+		if (lzma_stream_decoder(strm, UINT64_MAX, 0) != LZMA_OK)
+			exit(1);
+
+		strm->next_in = files;
+		strm->avail_in = file_sizes[i];
+		strm->next_out = out;
+		strm->avail_out = size;
+		if (lzma_code(strm, LZMA_FINISH) != LZMA_STREAM_END
+				|| strm->total_out != size)
+			exit(1);
+
+		files += file_sizes[i];
+
+		if (!reuse)
+			lzma_end(strm);
+	}
+
+	lzma_end(strm);
+}
+
+
+int
+main(int argc, char **argv)
+{
+	const size_t count = argc > 1 ? strtoul(argv[1], NULL, 0) : 20000;
+	const size_t size = argc > 2 ? strtoul(argv[2], NULL, 0) : 500;
+	const uint32_t preset = argc > 3 ? strtoul(argv[3], NULL, 0) : 6;
+
+	const size_t file_max = lzma_stream_buffer_bound(size);
+	uint8_t *files = malloc(count * file_max);
+	size_t *file_sizes = malloc(count * sizeof(size_t));
+	uint8_t *in = malloc(size);
+	uint8_t *out = malloc(size);
+	if (files == NULL || file_sizes == NULL || in == NULL || out == NULL)
+		return 1;
+
+	// Text-like input that differs a little between the files
+	uint32_t x = 1;
+	size_t total = 0;
+	for (size_t i = 0; i < count; ++i) {
+		for (size_t j = 0; j < size; ++j) {
+			x = x * 1103515245 + 12345;
+			in[j] = (uint8_t)('a' + (x >> 16) % ((x >> 30) + 3));
+		}
+
+		size_t file_size = 0;
+		if (lzma_easy_buffer_encode(preset, LZMA_CHECK_CRC32, NULL,
+				in, size, files + total, &file_size,
+				file_max) != LZMA_OK)
+			return 1;
+
+		file_sizes[i] = file_size;
+		total += file_size;
+	}
+
+	lzma_stream strm = LZMA_STREAM_INIT;
+
+	for (int reuse = 0; reuse <= 1; ++reuse) {
+		const double start = now();
+		decode_all(&strm, reuse, files, file_sizes, count, out, size);
+		const double elapsed = now() - start;
+
+		printf("%-10s %8.0f files/s %8.1f MB/s\n",
+				reuse ? "reuse:" : "new:",
+				(double)count / elapsed,
+				(double)(count * size) / elapsed / 1e6);
+	}
+
+	free(files);
+	free(file_sizes);
+	free(in);
+	free(out);
+	return 0;
+}
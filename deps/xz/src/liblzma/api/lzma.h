@@ -310,6 +310,7 @@ extern "C" {
 #include "lzma/block.h"
 #include "lzma/index.h"
 #include "lzma/index_hash.h"
+#include "lzma/seekable.h"
 
 /* Hardware information */
 #include "lzma/hardware.h"
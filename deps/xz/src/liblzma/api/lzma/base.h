@@ -508,6 +508,15 @@ typedef struct lzma_internal_s lzma_internal;
  *    function without calling lzma_end() first. Old allocations are
  *    automatically freed.
  *
+ *    When the same initialization function is used again, the decoders
+ *    reset their existing state instead of allocating it again. The
+ *    LZMA dictionary buffer is kept if it is big enough for the new
+ *    dictionary size, so decoding many small files one after another
+ *    with one lzma_stream avoids allocating and page faulting a big
+ *    dictionary for every file. The cost is that the lzma_stream keeps
+ *    the biggest dictionary buffer it has needed until lzma_end() is
+ *    called. lzma_memusage() doesn't include the unused part.
+ *
  *  - Finally, use lzma_end() to free the allocated memory. lzma_end() never
  *    frees the lzma_stream structure itself.
  *
@@ -67,7 +67,7 @@ typedef struct {
 	 *
 	 * Set this to zero if no flags are wanted.
 	 *
-	 * Encoder: No flags are currently supported.
+	 * Encoder: Zero or LZMA_MT_ADAPTIVE.
 	 *
 	 * Decoder: Bitwise-or of zero or more of the decoder flags:
 	 * - LZMA_TELL_NO_CHECK
@@ -106,6 +106,9 @@ typedef struct {
 	 * For each thread, about 3 * block_size bytes of memory will be
 	 * allocated. This may change in later liblzma versions. If so,
 	 * the memory usage will probably be reduced, not increased.
+	 *
+	 * With LZMA_MT_ADAPTIVE this is the maximum Block size. The encoder
+	 * may use smaller Blocks to fit in memlimit_threading.
 	 */
 	uint64_t block_size;
 
@@ -180,8 +183,16 @@ typedef struct {
 	/** \private     Reserved member. */
 	lzma_reserved_enum reserved_enum3;
 
-	/** \private     Reserved member. */
-	uint32_t reserved_int1;
+	/**
+	 * \brief       Encoder only, output: Maximum number of Blocks in flight
+	 *
+	 * This is set by lzma_stream_encoder_mt_get(). It is the number
+	 * of output buffers that may be allocated at the same time, that
+	 * is, the Blocks being compressed plus the finished Blocks that
+	 * are waiting to be copied to the output of lzma_code().
+	 * This is ignored by the initialization functions.
+	 */
+	uint32_t jobs;
 
 	/** \private     Reserved member. */
 	uint32_t reserved_int2;
@@ -195,7 +206,12 @@ typedef struct {
 	/**
 	 * \brief       Memory usage limit to reduce the number of threads
 	 *
-	 * Encoder: Ignored.
+	 * Encoder: Ignored unless LZMA_MT_ADAPTIVE is used. Then the
+	 * number of threads, the number of Blocks in flight, and the Block
+	 * size are chosen so that about memlimit_threading bytes of memory
+	 * is used at most. Like with the decoder, this never makes
+	 * the initialization fail: if the limit cannot be met even with
+	 * one thread, the limit is exceeded.
 	 *
 	 * Decoder:
 	 *
@@ -235,8 +251,14 @@ typedef struct {
 	 */
 	uint64_t memlimit_stop;
 
-	/** \private     Reserved member. */
-	uint64_t reserved_int7;
+	/**
+	 * \brief       Encoder only, output: Approximate memory usage
+	 *
+	 * This is set by lzma_stream_encoder_mt_get() to the memory
+	 * usage with the reported threads, jobs, and block_size.
+	 * This is ignored by the initialization functions.
+	 */
+	uint64_t memusage;
 
 	/** \private     Reserved member. */
 	uint64_t reserved_int8;
@@ -256,6 +278,35 @@ typedef struct {
 } lzma_mt;
 
 
+/**
+ * \brief       Choose the Block size and the number of threads adaptively
+ *
+ * This flag is supported by lzma_stream_encoder_mt() and
+ * lzma_stream_encoder_mt_memusage(). Instead of using lzma_mt.threads
+ * threads and lzma_mt.block_size byte Blocks as is, the encoder treats
+ * them as the maximums and uses lzma_mt.memlimit_threading as a memory
+ * budget:
+ *
+ *   - If the maximums don't fit in the budget, the number of Blocks in
+ *     flight is reduced first, then the Block size (down to a quarter of
+ *     the maximum or 1 MiB, whichever is more), and only then the number
+ *     of threads.
+ *
+ *   - During encoding, the encoder compares how much of each Block the
+ *     worker thread had compressed by the time the application had
+ *     provided the whole Block. If the application provides input slower
+ *     than the threads can compress it, fewer threads are enough to keep
+ *     up, and the memory of the unneeded threads is used for bigger
+ *     Blocks instead. If the input becomes faster again, the number of
+ *     threads is increased and the Blocks are made smaller.
+ *
+ * Since the Block size may depend on the memory budget and on timing,
+ * the compressed output isn't reproducible when this flag is used.
+ * Use lzma_stream_encoder_mt_get() to find out the current choices.
+ */
+#define LZMA_MT_ADAPTIVE                UINT32_C(0x40)
+
+
 /**
  * \brief       Calculate approximate memory usage of easy encoder
  *
@@ -434,6 +485,29 @@ extern LZMA_API(lzma_ret) lzma_stream_encoder_mt(
 		lzma_nothrow lzma_attr_warn_unused_result;
 
 
+/**
+ * \brief       Get the current settings of multithreaded .xz encoder
+ *
+ * This reports what lzma_stream_encoder_mt() chose, which is mostly
+ * useful with LZMA_MT_ADAPTIVE. The following members of *options are
+ * set: flags, threads (threads that may run at the same time), jobs,
+ * block_size (the size of the next Blocks), timeout, check,
+ * memlimit_threading, and memusage. The other members are left
+ * unchanged.
+ *
+ * \param       strm    Pointer to lzma_stream that has been initialized
+ *                      with lzma_stream_encoder_mt()
+ * \param[out]  options Pointer to lzma_mt to fill
+ *
+ * \return      Possible lzma_ret values:
+ *              - LZMA_OK
+ *              - LZMA_PROG_ERROR: strm isn't a multithreaded .xz encoder.
+ */
+extern LZMA_API(lzma_ret) lzma_stream_encoder_mt_get(
+		const lzma_stream *strm, lzma_mt *options)
+		lzma_nothrow;
+
+
 /**
  * \brief       Calculate recommended Block size for multithreaded .xz encoder
  *
@@ -900,6 +974,55 @@ extern LZMA_API(lzma_ret) lzma_lzip_decoder(
 		lzma_nothrow lzma_attr_warn_unused_result;
 
 
+/**
+ * \brief       Initialize multithreaded .lz (lzip) decoder
+ *
+ * The .lz format has no index, but the footer of a .lz format version 1
+ * member ends with the size of the member. The decoder buffers the input
+ * of each member until it finds the footer and then decodes the member
+ * in a worker thread. Thus files that consist of many members, such as
+ * those created by plzip, can be decoded in parallel. A file with only
+ * one member is decoded in a single thread, and all output of a member
+ * becomes available only after the whole member has been decoded.
+ *
+ * The following members are decoded in single-threaded mode:
+ *
+ *   - members in the .lz format version 0 which lack the Member size field;
+ *
+ *   - a member followed by trailing non-.lz data;
+ *
+ *   - members whose compressed size exceeds
+ *     lzma_mt.memlimit_threading / lzma_mt.threads or whose decoding
+ *     would need more than lzma_mt.memlimit_threading.
+ *
+ * Only LZMA_CONCATENATED enables threading because without it only one
+ * member is decoded.
+ *
+ * The decoded data and the return values are the same as with
+ * lzma_lzip_decoder() except for the handling of trailing non-.lz data:
+ * the decoder buffers input ahead, so lzma_stream.next_in may point past
+ * the beginning of the trailing data when LZMA_STREAM_END is returned.
+ *
+ * The lzma_mt options are used like with lzma_stream_decoder_mt():
+ * flags (see lzma_lzip_decoder()), threads, timeout, memlimit_threading,
+ * and memlimit_stop. The other members are ignored.
+ *
+ * \param       strm        Pointer to lzma_stream that is at least initialized
+ *                          with LZMA_STREAM_INIT.
+ * \param       options     Pointer to multithreaded decompression options
+ *
+ * \return      Possible lzma_ret values:
+ *              - LZMA_OK: Initialization was successful.
+ *              - LZMA_MEM_ERROR: Cannot allocate memory.
+ *              - LZMA_OPTIONS_ERROR: Unsupported flags or invalid
+ *                number of threads
+ *              - LZMA_PROG_ERROR
+ */
+extern LZMA_API(lzma_ret) lzma_lzip_decoder_mt(
+		lzma_stream *strm, const lzma_mt *options)
+		lzma_nothrow lzma_attr_warn_unused_result;
+
+
 /**
  * \brief       Single-call .xz Stream decoder
  *
@@ -180,6 +180,18 @@ typedef enum {
 } lzma_mode;
 
 
+/**
+ * \brief       Flag to enable lzma_options_lzma.mf_threads
+ *
+ * The encoder reads lzma_options_lzma.mf_threads only when this flag has
+ * been ORed to lzma_options_lzma.mode, for example,
+ * opt.mode = LZMA_MODE_NORMAL | LZMA_MODE_MF_THREADS. Without the flag,
+ * mf_threads is ignored like the reserved members, so applications that
+ * don't initialize it keep working as before.
+ */
+#define LZMA_MODE_MF_THREADS 0x100
+
+
 /**
  * \brief       Test if given compression mode is supported
  *
@@ -481,6 +493,29 @@ typedef struct {
 	 */
 	uint32_t ext_size_high;
 
+	/**
+	 * \brief       Number of match finder threads
+	 *
+	 * When this is non-zero, the encoder runs the match finder in
+	 * a separate thread that stays ahead of the rest of the encoder
+	 * and hands over the matches it has found. This speeds up
+	 * encoding of a single stream or Block with the slower match
+	 * finders, for example with the presets 7-9, when a spare
+	 * processor core is available. The compressed output is
+	 * identical to the output without a match finder thread.
+	 *
+	 * This is read only if LZMA_MODE_MF_THREADS has been set in mode.
+	 * Otherwise it is safe to leave this uninitialized.
+	 *
+	 * Currently at most one match finder thread is used, and values
+	 * greater than one are treated as one. This is ignored by the
+	 * decoders and when liblzma has been built without threading
+	 * support.
+	 *
+	 * lzma_lzma_preset() sets this to zero.
+	 */
+	uint32_t mf_threads;
+
 	/*
 	 * Reserved space to allow possible future extensions without
 	 * breaking the ABI. You should not touch these, because the names
@@ -489,9 +524,6 @@ typedef struct {
 	 * uninitialized.
 	 */
 
-	/** \private     Reserved member. */
-	uint32_t reserved_int4;
-
 	/** \private     Reserved member. */
 	uint32_t reserved_int5;
 
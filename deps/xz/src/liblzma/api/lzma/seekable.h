@@ -0,0 +1,168 @@
+/* SPDX-License-Identifier: 0BSD */
+
+/**
+ * \file        lzma/seekable.h
+ * \brief       Random access reading of .xz files
+ * \note        Never include this file directly. Use <lzma.h> instead.
+ */
+
+#ifndef LZMA_H_INTERNAL
+#	error Never include this file directly. Use <lzma.h> instead.
+#endif
+
+
+/**
+ * \brief       Source of the compressed data for lzma_seekable
+ *
+ * The application provides a pread()-like function that liblzma uses
+ * to read the .xz file.
+ */
+typedef struct {
+	/**
+	 * \brief       Pointer to a function to read from the .xz file
+	 *
+	 * \param       opaque  lzma_seekable_source.opaque as is
+	 * \param[out]  buf     Buffer to hold the data
+	 * \param       size    Number of bytes to read. This is never zero.
+	 * \param       pos     Absolute position in the .xz file
+	 *
+	 * \return      LZMA_OK if exactly size bytes were read. Any other
+	 *              value is an error, and the lzma_seekable function
+	 *              that called read() returns that value to the
+	 *              application. LZMA_DATA_ERROR is a good choice for
+	 *              unexpected end of file.
+	 *
+	 * If lzma_seekable_read() is called from multiple threads at the
+	 * same time, this function is called from those threads too, so
+	 * it must be thread safe. pread() is fine for this.
+	 */
+	lzma_ret (LZMA_API_CALL *read)(void *opaque, uint8_t *buf,
+			size_t size, uint64_t pos);
+
+	/**
+	 * \brief       Pointer passed as the first argument to read()
+	 *
+	 * This may be NULL if read() doesn't need it.
+	 */
+	void *opaque;
+
+} lzma_seekable_source;
+
+
+/**
+ * \brief       Opaque data type of a random access reader
+ *
+ * lzma_seekable reads the Indexes of an .xz file once and then decodes
+ * only the Blocks that are needed to read the requested uncompressed
+ * data. Recently decoded Blocks are kept in a cache so that small reads
+ * near each other don't decode the same Block again.
+ *
+ * Thread safety: lzma_seekable_read() may be called from multiple threads
+ * at the same time with the same lzma_seekable. The Blocks are decoded
+ * in the calling threads so reads from different Blocks decode in
+ * parallel. The other functions must not be called at the same time
+ * with any other function using the same lzma_seekable.
+ */
+typedef struct lzma_seekable_s lzma_seekable;
+
+
+/**
+ * \brief       Open an .xz file for random access reading
+ *
+ * The Indexes of the file are decoded like lzma_file_info_decoder() does.
+ * The file may contain multiple Streams and Stream Padding.
+ *
+ * Blocks whose uncompressed size is at most cache_size bytes are decoded
+ * completely, their integrity checks are verified, and the decoded data
+ * is kept in a cache that uses at most cache_size bytes. Bigger Blocks
+ * are decoded only up to the last requested byte every time they are
+ * read, and their integrity checks are verified only when the read
+ * reaches the end of the Block. Thus the Block size used when creating
+ * the file and cache_size together decide how fast random access is.
+ *
+ * \param[out]  seekable    Pointer to a pointer where the new
+ *                          lzma_seekable is stored on success.
+ *                          The old value is ignored (not freed).
+ * \param       source      Function to read the .xz file. The structure
+ *                          is copied so it doesn't need to remain valid.
+ * \param       file_size   Size of the .xz file
+ * \param       cache_size  Maximum number of bytes of decoded data to
+ *                          keep in the cache. Zero disables the cache.
+ * \param       memlimit    Memory usage limit for the Indexes and for
+ *                          the decoder of a single Block. This doesn't
+ *                          include the cache. Use UINT64_MAX to
+ *                          effectively disable the limiter.
+ * \param       allocator   lzma_allocator for custom allocator functions.
+ *                          Set to NULL to use malloc() and free(). The
+ *                          allocator is used also by lzma_seekable_read()
+ *                          and lzma_seekable_end().
+ *
+ * \return      Possible lzma_ret values:
+ *              - LZMA_OK
+ *              - LZMA_FORMAT_ERROR: The file is not in the .xz format.
+ *              - LZMA_OPTIONS_ERROR
+ *              - LZMA_DATA_ERROR
+ *              - LZMA_MEM_ERROR
+ *              - LZMA_MEMLIMIT_ERROR
+ *              - LZMA_PROG_ERROR
+ *              - Errors from source->read()
+ */
+extern LZMA_API(lzma_ret) lzma_seekable_open(lzma_seekable **seekable,
+		const lzma_seekable_source *source, uint64_t file_size,
+		uint64_t cache_size, uint64_t memlimit,
+		const lzma_allocator *allocator)
+		lzma_nothrow lzma_attr_warn_unused_result;
+
+
+/**
+ * \brief       Get the Index of the file
+ *
+ * The returned lzma_index contains the information about all Streams
+ * and Blocks in the file. For example, lzma_index_uncompressed_size()
+ * gives the uncompressed size of the whole file. The lzma_index is valid
+ * until lzma_seekable_end() and it must not be modified.
+ *
+ * \param       seekable    lzma_seekable from lzma_seekable_open()
+ *
+ * \return      Pointer to the Index of the file
+ */
+extern LZMA_API(const lzma_index *) lzma_seekable_index(
+		const lzma_seekable *seekable)
+		lzma_nothrow lzma_attr_pure;
+
+
+/**
+ * \brief       Read uncompressed data at the given offset
+ *
+ * \param       seekable    lzma_seekable from lzma_seekable_open()
+ * \param[out]  buf         Buffer to hold the uncompressed data
+ * \param[in,out] size      On entry, the number of bytes to read. On
+ *                          return, the number of bytes that were read.
+ *                          It is less than requested only if the end
+ *                          of the uncompressed data was reached or if
+ *                          an error occurred.
+ * \param       pos         Uncompressed offset of the first byte to read
+ *
+ * \return      Possible lzma_ret values:
+ *              - LZMA_OK: Reading was successful. If pos is at or past
+ *                the end of the uncompressed data, *size is set to zero.
+ *              - LZMA_OPTIONS_ERROR
+ *              - LZMA_DATA_ERROR
+ *              - LZMA_MEM_ERROR
+ *              - LZMA_MEMLIMIT_ERROR
+ *              - LZMA_PROG_ERROR
+ *              - Errors from lzma_seekable_source.read()
+ */
+extern LZMA_API(lzma_ret) lzma_seekable_read(lzma_seekable *seekable,
+		uint8_t *buf, size_t *size, uint64_t pos)
+		lzma_nothrow lzma_attr_warn_unused_result;
+
+
+/**
+ * \brief       Free the memory allocated for lzma_seekable
+ *
+ * \param       seekable    lzma_seekable from lzma_seekable_open().
+ *                          If this is NULL, this function does nothing.
+ */
+extern LZMA_API(void) lzma_seekable_end(lzma_seekable *seekable)
+		lzma_nothrow;
@@ -91,6 +91,45 @@ typedef struct {
 } lzma_lzip_coder;
 
 
+/// Decodes the dictionary size field of the .lz header into *options.
+/// Returns true if the value isn't valid.
+static bool
+decode_dict_size(lzma_options_lzma *options, uint8_t ds)
+{
+	// The five lowest bits are for the base-2 logarithm of
+	// the dictionary size and the highest three bits are
+	// the fractional part (0/16 to 7/16) that will be
+	// subtracted to get the final value.
+	//
+	// For example, with 0xB5:
+	//     b2log = 21
+	//     fracnum = 5
+	//     dict_size = 2^21 - 2^21 * 5 / 16 = 1408 KiB
+	const uint32_t b2log = ds & 0x1F;
+	const uint32_t fracnum = ds >> 5;
+
+	// The format versions 0 and 1 allow dictionary size in the
+	// range [4 KiB, 512 MiB].
+	if (b2log < 12 || b2log > 29 || (b2log == 12 && fracnum > 0))
+		return true;
+
+	//   2^[b2log] - 2^[b2log] * [fracnum] / 16
+	// = 2^[b2log] - [fracnum] * 2^([b2log] - 4)
+	options->dict_size = (UINT32_C(1) << b2log)
+			- (fracnum << (b2log - 4));
+
+	assert(options->dict_size >= 4096);
+	assert(options->dict_size <= (UINT32_C(512) << 20));
+
+	options->preset_dict = NULL;
+	options->lc = LZIP_LC;
+	options->lp = LZIP_LP;
+	options->pb = LZIP_PB;
+
+	return false;
+}
+
+
 static lzma_ret
 lzip_decode(void *coder_ptr, const lzma_allocator *allocator,
 		const uint8_t *restrict in, size_t *restrict in_pos,
@@ -179,39 +218,12 @@ lzip_decode(void *coder_ptr, const lzma_allocator *allocator,
 		if (*in_pos >= in_size)
 			return LZMA_OK;
 
-		const uint32_t ds = in[(*in_pos)++];
+		const uint8_t ds = in[(*in_pos)++];
 		++coder->member_size;
 
-		// The five lowest bits are for the base-2 logarithm of
-		// the dictionary size and the highest three bits are
-		// the fractional part (0/16 to 7/16) that will be
-		// subtracted to get the final value.
-		//
-		// For example, with 0xB5:
-		//     b2log = 21
-		//     fracnum = 5
-		//     dict_size = 2^21 - 2^21 * 5 / 16 = 1408 KiB
-		const uint32_t b2log = ds & 0x1F;
-		const uint32_t fracnum = ds >> 5;
-
-		// The format versions 0 and 1 allow dictionary size in the
-		// range [4 KiB, 512 MiB].
-		if (b2log < 12 || b2log > 29 || (b2log == 12 && fracnum > 0))
+		if (decode_dict_size(&coder->options, ds))
 			return LZMA_DATA_ERROR;
 
-		//   2^[b2log] - 2^[b2log] * [fracnum] / 16
-		// = 2^[b2log] - [fracnum] * 2^([b2log] - 4)
-		coder->options.dict_size = (UINT32_C(1) << b2log)
-				- (fracnum << (b2log - 4));
-
-		assert(coder->options.dict_size >= 4096);
-		assert(coder->options.dict_size <= (UINT32_C(512) << 20));
-
-		coder->options.preset_dict = NULL;
-		coder->options.lc = LZIP_LC;
-		coder->options.lp = LZIP_LP;
-		coder->options.pb = LZIP_PB;
-
 		// Calculate the memory usage.
 		coder->memusage = lzma_lzma_decoder_memusage(&coder->options)
 				+ LZMA_MEMUSAGE_BASE;
@@ -405,6 +417,17 @@ lzma_lzip_decoder_init(
 }
 
 
+extern uint64_t
+lzma_lzip_decoder_memusage(uint8_t ds)
+{
+	lzma_options_lzma options;
+	if (decode_dict_size(&options, ds))
+		return UINT64_MAX;
+
+	return lzma_lzma_decoder_memusage(&options) + LZMA_MEMUSAGE_BASE;
+}
+
+
 extern LZMA_API(lzma_ret)
 lzma_lzip_decoder(lzma_stream *strm, uint64_t memlimit, uint32_t flags)
 {
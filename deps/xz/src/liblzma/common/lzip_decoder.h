@@ -18,4 +18,8 @@ extern lzma_ret lzma_lzip_decoder_init(
 		lzma_next_coder *next, const lzma_allocator *allocator,
 		uint64_t memlimit, uint32_t flags);
 
+/// Returns the memory usage of the decoder of a .lz member whose header
+/// has the dictionary size field ds, or UINT64_MAX if ds is invalid.
+extern uint64_t lzma_lzip_decoder_memusage(uint8_t ds);
+
 #endif
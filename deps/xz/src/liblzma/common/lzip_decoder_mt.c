@@ -0,0 +1,1327 @@
+// SPDX-License-Identifier: 0BSD
+
+///////////////////////////////////////////////////////////////////////////////
+//
+/// \file       lzip_decoder_mt.c
+/// \brief      Multithreaded .lz (lzip) decoder
+///
+/// The .lz header doesn't store the size of the member, but the footer of
+/// a version 1 member ends with the Member size field. The main thread
+/// buffers the input of the current member and looks for a position P
+/// where the eight bytes before P encode P itself and where the magic
+/// bytes of the next member (or the end of the input) follow. The whole
+/// member is then given to a worker thread which decodes it with a
+/// single-member lzip decoder into an output buffer whose size comes
+/// from the Data size field of the footer.
+///
+/// Members that cannot be located this way (version 0 members, a member
+/// followed by trailing non-.lz data, or members too big for
+/// memlimit_threading) are decoded in the main thread, similarly to
+/// the direct mode of stream_decoder_mt.c.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "common.h"
+#include "lzip_decoder.h"
+#include "outqueue.h"
+
+
+#define LZIP_HEADER_SIZE 6
+#define LZIP_V1_FOOTER_SIZE 20
+
+/// A member cannot be smaller than its header and footer. Positions before
+/// this aren't considered as the end of a member.
+#define LZIP_MEMBER_SIZE_MIN (LZIP_HEADER_SIZE + LZIP_V1_FOOTER_SIZE)
+
+/// Data size fields implying a higher compression ratio are invalid.
+#define LZIP_RATIO_MAX 8192
+
+/// Initial size of the input buffer of a member. The buffer is doubled
+/// when more room is needed.
+#define LZIP_IN_SIZE_MIN (UINT32_C(64) << 10)
+
+
+/// The "ID string" or magic bytes are "LZIP" in US-ASCII.
+static const uint8_t lzip_id_string[4] = { 0x4C, 0x5A, 0x49, 0x50 };
+
+
+typedef enum {
+	/// Waiting for work.
+	/// Main thread may change this to THR_RUN or THR_EXIT.
+	THR_IDLE,
+
+	/// Decoding is in progress.
+	/// Main thread may change this to THR_STOP or THR_EXIT.
+	/// The worker thread may change this to THR_IDLE.
+	THR_RUN,
+
+	/// The main thread wants the thread to stop whatever it was doing
+	/// but not exit. Main thread may change this to THR_EXIT.
+	/// The worker thread may change this to THR_IDLE.
+	THR_STOP,
+
+	/// The main thread wants the thread to exit.
+	THR_EXIT,
+
+} worker_state;
+
+
+struct worker_thread {
+	/// Worker state is protected with our mutex.
+	worker_state state;
+
+	/// Input buffer that contains the whole member
+	uint8_t *in;
+
+	/// Size of the member in "in"
+	size_t in_size;
+
+	/// Amount of memory allocated for "in"
+	size_t in_allocated;
+
+	/// Number of bytes consumed from "in" by the worker thread
+	size_t in_pos;
+
+	/// Amount of uncompressed data that has been decoded
+	size_t out_pos;
+
+	/// Pointer to the main structure is needed to lock the main mutex
+	/// and to put this thread back to the stack of free threads.
+	struct lzma_lzip_coder_mt *coder;
+
+	/// The allocator is set by the main thread. Since a copy of the
+	/// pointer is kept here, the application must not change the
+	/// allocator before calling lzma_end().
+	const lzma_allocator *allocator;
+
+	/// Output queue buffer to which the uncompressed data is written
+	lzma_outbuf *outbuf;
+
+	/// Progress of the member being decoded. These are updated from
+	/// in_pos and out_pos when our mutex is locked.
+	size_t progress_in;
+	size_t progress_out;
+
+	/// Single-member lzip decoder
+	lzma_next_coder lzip_decoder;
+
+	/// Memory usage of lzip_decoder
+	uint64_t mem_filters;
+
+	/// Next structure in the stack of free worker threads
+	struct worker_thread *next;
+
+	mythread_mutex mutex;
+	mythread_cond cond;
+
+	/// The ID of this thread is used to join the thread
+	/// when it's not needed anymore.
+	mythread thread_id;
+};
+
+
+struct lzma_lzip_coder_mt {
+	enum {
+		SEQ_MEMBER_HEADER,
+		SEQ_MEMBER_SCAN,
+		SEQ_MEMBER_THR_INIT,
+		SEQ_MEMBER_DIRECT_INIT,
+		SEQ_MEMBER_DIRECT_RUN,
+		SEQ_FINISH,
+		SEQ_ERROR,
+	} sequence;
+
+	/// Single-member lzip decoder used in direct mode
+	lzma_next_coder lzip_decoder;
+
+	/// Buffered input of the current member. After the end of the
+	/// member has been found, this may also hold the first bytes of
+	/// the next member.
+	uint8_t *in;
+
+	/// Amount of memory allocated for "in"
+	size_t in_allocated;
+
+	/// Number of bytes in "in"
+	size_t in_filled;
+
+	/// In SEQ_MEMBER_SCAN this is the next position in "in" that is
+	/// checked for being the end of the member. In direct mode this
+	/// is the position of the direct mode decoder in "in".
+	size_t in_pos;
+
+	/// Size of the current member once its end has been found
+	size_t member_size;
+
+	/// Maximum wait time if cannot use all the input and cannot
+	/// fill the output buffer. This is in milliseconds.
+	uint32_t timeout;
+
+	/// Error code from a worker thread.
+	///
+	/// \note       Use mutex.
+	lzma_ret thread_error;
+
+	/// Error code to return after pending output has been copied out.
+	/// Like in stream_decoder_mt.c, when set in read_output_and_wait()
+	/// this only works as a flag and the actual error comes from
+	/// the output queue.
+	lzma_ret pending_error;
+
+	/// Number of threads that will be created at maximum
+	uint32_t threads_max;
+
+	/// Number of thread structures that have been initialized from
+	/// "threads", and thus the number of worker threads actually
+	/// created so far.
+	uint32_t threads_initialized;
+
+	/// Array of allocated thread-specific structures. This is NULL
+	/// until the first member is decoded in threaded mode.
+	struct worker_thread *threads;
+
+	/// Stack of free threads
+	///
+	/// \note       Use mutex.
+	struct worker_thread *threads_free;
+
+	/// Output buffer queue for decompressed data from the worker threads
+	///
+	/// \note       Use mutex with operations that need it.
+	lzma_outq outq;
+
+	mythread_mutex mutex;
+	mythread_cond cond;
+
+	/// Memory usage that will not be exceeded in multi-threaded mode.
+	/// Single-threaded mode can exceed this even by a large amount.
+	uint64_t memlimit_threading;
+
+	/// Memory usage limit that should never be exceeded.
+	uint64_t memlimit_stop;
+
+	/// Amount of memory needed by the running worker threads.
+	/// This doesn't include the memory needed by the output buffers.
+	///
+	/// \note       Use mutex.
+	uint64_t mem_in_use;
+
+	/// Amount of memory used by the idle (cached) threads
+	///
+	/// \note       Use mutex.
+	uint64_t mem_cached;
+
+	/// Memory usage of the decoder of the current member
+	uint64_t mem_next_filters;
+
+	/// Amount of memory that must be available below memlimit_threading
+	/// before the main thread can continue. In SEQ_MEMBER_SCAN this is
+	/// the size of the grown input buffer and in SEQ_MEMBER_THR_INIT the
+	/// memory needed to decode the member in a worker thread.
+	uint64_t mem_next;
+
+	/// Amount of compressed and uncompressed data in members that
+	/// have already been finished
+	///
+	/// \note       Use mutex.
+	uint64_t progress_in;
+	uint64_t progress_out;
+
+	/// If true, LZMA_GET_CHECK is returned after decoding the header
+	/// of a member.
+	bool tell_any_check;
+
+	/// If true, we won't calculate or verify the CRC32 of
+	/// the uncompressed data.
+	bool ignore_check;
+
+	/// If true, we will decode concatenated .lz members and stop if
+	/// non-.lz data is seen after at least one member.
+	bool concatenated;
+
+	/// If true, we will return any errors immediately instead of first
+	/// producing all output before the location of the error.
+	bool fail_fast;
+
+	/// This is true as long as we are decoding the first .lz member.
+	bool first_member;
+
+	/// See the same variable in stream_decoder_mt.c.
+	bool out_was_filled;
+};
+
+
+/// Things do to at THR_STOP or when finishing a member.
+/// This is called with thr->coder->mutex locked.
+static void
+worker_stop(struct worker_thread *thr)
+{
+	thr->coder->mem_in_use -= thr->in_allocated;
+	thr->in_allocated = 0;
+
+	thr->coder->mem_in_use -= thr->mem_filters;
+	thr->coder->mem_cached += thr->mem_filters;
+
+	// Put this thread to the stack of free threads.
+	thr->next = thr->coder->threads_free;
+	thr->coder->threads_free = thr;
+
+	mythread_cond_signal(&thr->coder->cond);
+	return;
+}
+
+
+static MYTHREAD_RET_TYPE
+worker_decoder(void *thr_ptr)
+{
+	struct worker_thread *thr = thr_ptr;
+	lzma_ret ret;
+
+next_loop_lock:
+
+	mythread_mutex_lock(&thr->mutex);
+next_loop_unlocked:
+
+	if (thr->state == THR_IDLE) {
+		mythread_cond_wait(&thr->cond, &thr->mutex);
+		goto next_loop_unlocked;
+	}
+
+	if (thr->state == THR_EXIT) {
+		mythread_mutex_unlock(&thr->mutex);
+
+		lzma_free(thr->in, thr->allocator);
+		lzma_next_end(&thr->lzip_decoder, thr->allocator);
+
+		mythread_mutex_destroy(&thr->mutex);
+		mythread_cond_destroy(&thr->cond);
+
+		return MYTHREAD_RET_VALUE;
+	}
+
+	if (thr->state == THR_STOP) {
+		thr->state = THR_IDLE;
+		mythread_mutex_unlock(&thr->mutex);
+
+		lzma_free(thr->in, thr->allocator);
+		thr->in = NULL;
+
+		mythread_sync(thr->coder->mutex) {
+			worker_stop(thr);
+		}
+
+		goto next_loop_lock;
+	}
+
+	assert(thr->state == THR_RUN);
+
+	// Update progress info for get_progress().
+	thr->progress_in = thr->in_pos;
+	thr->progress_out = thr->out_pos;
+
+	mythread_mutex_unlock(&thr->mutex);
+
+	// The whole member is already in the input buffer. Pass it in
+	// small chunks to the decoder so that we react reasonably fast
+	// if we are told to stop or exit.
+	const size_t chunk_size = 16384;
+	const size_t in_old = thr->in_pos;
+	const size_t out_old = thr->out_pos;
+	const size_t in_limit = thr->in_size - thr->in_pos > chunk_size
+			? thr->in_pos + chunk_size : thr->in_size;
+
+	ret = thr->lzip_decoder.code(
+			thr->lzip_decoder.coder, thr->allocator,
+			thr->in, &thr->in_pos, in_limit,
+			thr->outbuf->buf, &thr->out_pos,
+			thr->outbuf->allocated,
+			in_limit == thr->in_size ? LZMA_FINISH : LZMA_RUN);
+
+	if (ret == LZMA_OK) {
+		if (thr->in_pos != in_old || thr->out_pos != out_old)
+			goto next_loop_lock;
+
+		// No progress is possible: either the member is truncated
+		// or it decodes to more data than the Data size field in
+		// the footer says. The main thread found the member from
+		// its footer so in both cases the file is corrupt.
+		ret = LZMA_DATA_ERROR;
+
+	} else if (ret == LZMA_STREAM_END && (thr->in_pos != thr->in_size
+			|| thr->out_pos != thr->outbuf->allocated)) {
+		// The decoder verified the footer against the decoded data
+		// so this can only happen if the member ended before the
+		// position where the main thread found its footer.
+		ret = LZMA_DATA_ERROR;
+	}
+
+	// Either we finished successfully (LZMA_STREAM_END) or an error
+	// occurred. Free the input buffer. Don't update in_allocated as
+	// we need it later to update thr->coder->mem_in_use.
+	lzma_free(thr->in, thr->allocator);
+	thr->in = NULL;
+
+	mythread_sync(thr->mutex) {
+		if (thr->state != THR_EXIT)
+			thr->state = THR_IDLE;
+	}
+
+	mythread_sync(thr->coder->mutex) {
+		// Move our progress info to the main thread.
+		thr->coder->progress_in += thr->in_pos;
+		thr->coder->progress_out += thr->out_pos;
+		thr->progress_in = 0;
+		thr->progress_out = 0;
+
+		// Mark the outbuf as finished.
+		thr->outbuf->pos = thr->out_pos;
+		thr->outbuf->decoder_in_pos = thr->in_pos;
+		thr->outbuf->finished = true;
+		thr->outbuf->finish_ret = ret;
+		thr->outbuf = NULL;
+
+		// If an error occurred, tell it to the main thread.
+		if (ret != LZMA_STREAM_END
+				&& thr->coder->thread_error == LZMA_OK)
+			thr->coder->thread_error = ret;
+
+		worker_stop(thr);
+	}
+
+	goto next_loop_lock;
+}
+
+
+/// Tells the worker threads to exit and waits for them to terminate.
+static void
+threads_end(struct lzma_lzip_coder_mt *coder, const lzma_allocator *allocator)
+{
+	for (uint32_t i = 0; i < coder->threads_initialized; ++i) {
+		mythread_sync(coder->threads[i].mutex) {
+			coder->threads[i].state = THR_EXIT;
+			mythread_cond_signal(&coder->threads[i].cond);
+		}
+	}
+
+	for (uint32_t i = 0; i < coder->threads_initialized; ++i)
+		mythread_join(coder->threads[i].thread_id);
+
+	lzma_free(coder->threads, allocator);
+	coder->threads_initialized = 0;
+	coder->threads = NULL;
+	coder->threads_free = NULL;
+
+	// The threads don't update these when they exit. Do it here.
+	coder->mem_in_use = 0;
+	coder->mem_cached = 0;
+
+	return;
+}
+
+
+static void
+threads_stop(struct lzma_lzip_coder_mt *coder)
+{
+	for (uint32_t i = 0; i < coder->threads_initialized; ++i) {
+		mythread_sync(coder->threads[i].mutex) {
+			// The state must be changed conditionally because
+			// THR_IDLE -> THR_STOP is not a valid state change.
+			if (coder->threads[i].state != THR_IDLE) {
+				coder->threads[i].state = THR_STOP;
+				mythread_cond_signal(&coder->threads[i].cond);
+			}
+		}
+	}
+
+	return;
+}
+
+
+/// Get a free worker thread, creating a new one if needed.
+static lzma_ret
+get_thread(struct lzma_lzip_coder_mt *coder, const lzma_allocator *allocator,
+		struct worker_thread **thr_ptr)
+{
+	struct worker_thread *thr = NULL;
+
+	// If there is a free structure on the stack, use it.
+	mythread_sync(coder->mutex) {
+		if (coder->threads_free != NULL) {
+			thr = coder->threads_free;
+			coder->threads_free = thr->next;
+
+			// The caller adds the memory usage of the decoder
+			// to mem_in_use.
+			coder->mem_cached -= thr->mem_filters;
+		}
+	}
+
+	if (thr == NULL) {
+		// Allocate the coder->threads array if needed. It's done
+		// here instead of when initializing the decoder because
+		// we don't need it if all members are decoded in
+		// direct mode.
+		if (coder->threads == NULL) {
+			coder->threads = lzma_alloc(coder->threads_max
+					* sizeof(struct worker_thread),
+					allocator);
+			if (coder->threads == NULL)
+				return LZMA_MEM_ERROR;
+		}
+
+		assert(coder->threads_initialized < coder->threads_max);
+		thr = &coder->threads[coder->threads_initialized];
+
+		if (mythread_mutex_init(&thr->mutex))
+			return LZMA_MEM_ERROR;
+
+		if (mythread_cond_init(&thr->cond)) {
+			mythread_mutex_destroy(&thr->mutex);
+			return LZMA_MEM_ERROR;
+		}
+
+		thr->state = THR_IDLE;
+		thr->in = NULL;
+		thr->in_allocated = 0;
+		thr->allocator = allocator;
+		thr->coder = coder;
+		thr->outbuf = NULL;
+		thr->lzip_decoder = LZMA_NEXT_CODER_INIT;
+		thr->mem_filters = 0;
+
+		if (mythread_create(&thr->thread_id, worker_decoder, thr)) {
+			mythread_cond_destroy(&thr->cond);
+			mythread_mutex_destroy(&thr->mutex);
+			return LZMA_MEM_ERROR;
+		}
+
+		++coder->threads_initialized;
+	}
+
+	thr->in_pos = 0;
+	thr->out_pos = 0;
+	thr->progress_in = 0;
+	thr->progress_out = 0;
+
+	*thr_ptr = thr;
+	return LZMA_OK;
+}
+
+
+/// This is like read_output_and_wait() in stream_decoder_mt.c. If
+/// can_continue isn't NULL, *can_continue is set to true once coder->mem_next
+/// bytes of memory are available below memlimit_threading. In
+/// SEQ_MEMBER_THR_INIT also a free output queue slot and a free
+/// thread are required.
+static lzma_ret
+read_output_and_wait(struct lzma_lzip_coder_mt *coder,
+		const lzma_allocator *allocator,
+		uint8_t *restrict out, size_t *restrict out_pos,
+		size_t out_size,
+		bool *can_continue,
+		bool waiting_allowed,
+		mythread_condtime *wait_abs, bool *has_blocked)
+{
+	lzma_ret ret = LZMA_OK;
+
+	mythread_sync(coder->mutex) {
+		do {
+			// Get as much output from the queue as is possible
+			// without blocking. Loop also when out is full
+			// because there could be empty members.
+			const size_t out_start = *out_pos;
+			do {
+				ret = lzma_outq_read(&coder->outq, allocator,
+						out, out_pos, out_size,
+						NULL, NULL);
+			} while (ret == LZMA_STREAM_END);
+
+			// Check if lzma_outq_read reported an error from
+			// the decoder of a member.
+			if (ret != LZMA_OK)
+				break;
+
+			if (*out_pos == out_size && *out_pos != out_start)
+				coder->out_was_filled = true;
+
+			// Check if any thread has indicated an error.
+			if (coder->thread_error != LZMA_OK) {
+				if (coder->fail_fast) {
+					ret = coder->thread_error;
+					break;
+				}
+
+				coder->pending_error = LZMA_PROG_ERROR;
+			}
+
+			// Check if the main thread can continue. Since
+			// every running thread has an unfinished buffer in
+			// the output queue, this is always true once
+			// the queue is empty.
+			if (can_continue != NULL
+					&& coder->memlimit_threading
+						- coder->mem_in_use
+						- coder->outq.mem_in_use
+						>= coder->mem_next
+					&& (coder->sequence
+							!= SEQ_MEMBER_THR_INIT
+						|| (lzma_outq_has_buf(&coder->outq)
+						&& (coder->threads_initialized
+							< coder->threads_max
+						|| coder->threads_free
+							!= NULL)))) {
+				*can_continue = true;
+				break;
+			}
+
+			// If the caller doesn't want us to block, return now.
+			if (!waiting_allowed)
+				break;
+
+			// Return if there is no more output coming.
+			if (lzma_outq_is_empty(&coder->outq)) {
+				assert(can_continue == NULL);
+				break;
+			}
+
+			// If there is more data available from the queue,
+			// our out buffer must be full.
+			if (lzma_outq_is_readable(&coder->outq)) {
+				assert(*out_pos == out_size);
+				break;
+			}
+
+			// Unlike in the .xz decoder, the worker threads
+			// always have the whole member so they will finish
+			// without more input from the application.
+			if (coder->timeout != 0) {
+				if (!*has_blocked) {
+					*has_blocked = true;
+					mythread_condtime_set(wait_abs,
+							&coder->cond,
+							coder->timeout);
+				}
+
+				if (mythread_cond_timedwait(&coder->cond,
+						&coder->mutex,
+						wait_abs) != 0) {
+					ret = LZMA_TIMED_OUT;
+					break;
+				}
+			} else {
+				mythread_cond_wait(&coder->cond,
+						&coder->mutex);
+			}
+		} while (ret == LZMA_OK);
+	}
+
+	// If we are returning an error, then the application cannot get
+	// more output from us and thus keeping the threads running is
+	// useless and waste of CPU time.
+	if (ret != LZMA_OK && ret != LZMA_TIMED_OUT)
+		threads_stop(coder);
+
+	return ret;
+}
+
+
+/// Returns true if the Member size field of a footer ending at in[size]
+/// matches the size of the buffered member.
+static bool
+is_member_end(const struct lzma_lzip_coder_mt *coder, size_t size)
+{
+	return size >= LZIP_MEMBER_SIZE_MIN
+			&& read64le(coder->in + size - 8) == size;
+}
+
+
+static lzma_ret
+lzip_decode_mt(void *coder_ptr, const lzma_allocator *allocator,
+		const uint8_t *restrict in, size_t *restrict in_pos,
+		size_t in_size,
+		uint8_t *restrict out, size_t *restrict out_pos,
+		size_t out_size, lzma_action action)
+{
+	struct lzma_lzip_coder_mt *coder = coder_ptr;
+
+	mythread_condtime wait_abs;
+	bool has_blocked = false;
+
+	// See the comment in stream_decode_mt().
+	const bool waiting_allowed = action == LZMA_FINISH
+			|| (*in_pos == in_size && !coder->out_was_filled);
+	coder->out_was_filled = false;
+
+	while (true)
+	switch (coder->sequence) {
+	case SEQ_MEMBER_HEADER: {
+		// The buffer may already contain the beginning of the
+		// member if the end of the previous member was found
+		// by scanning.
+		if (coder->in_filled < LZIP_HEADER_SIZE)
+			lzma_bufcpy(in, in_pos, in_size, coder->in,
+					&coder->in_filled, LZIP_HEADER_SIZE);
+
+		// Check the magic bytes as soon as we have them. Non-.lz
+		// data after at least one member is trailing data which
+		// is ignored like lzma_lzip_decoder() does.
+		if (memcmp(coder->in, lzip_id_string,
+				my_min(coder->in_filled,
+					sizeof(lzip_id_string))) != 0) {
+			if (coder->first_member)
+				return LZMA_FORMAT_ERROR;
+
+			coder->sequence = SEQ_FINISH;
+			break;
+		}
+
+		if (coder->in_filled < LZIP_HEADER_SIZE) {
+			// A partial magic bytes at the end of the input
+			// after the first member are ignored too.
+			if (action == LZMA_FINISH && *in_pos == in_size
+					&& !coder->first_member
+					&& coder->in_filled
+						< sizeof(lzip_id_string)) {
+				coder->sequence = SEQ_FINISH;
+				break;
+			}
+
+			// Copy decoded data to out while waiting for
+			// more input.
+			return_if_error(read_output_and_wait(coder,
+					allocator, out, out_pos, out_size,
+					NULL, waiting_allowed,
+					&wait_abs, &has_blocked));
+
+			if (coder->pending_error != LZMA_OK) {
+				coder->sequence = SEQ_ERROR;
+				break;
+			}
+
+			return LZMA_OK;
+		}
+
+		// Only version 1 members have the Member size field in the
+		// footer. Other versions and invalid dictionary sizes are
+		// handled by the direct mode decoder which will return
+		// the correct error code.
+		const uint8_t version = coder->in[4];
+		coder->mem_next_filters = lzma_lzip_decoder_memusage(
+				coder->in[5]);
+
+		if (coder->concatenated && version == 1
+				&& coder->mem_next_filters != UINT64_MAX) {
+			coder->in_pos = LZIP_MEMBER_SIZE_MIN;
+			coder->sequence = SEQ_MEMBER_SCAN;
+		} else {
+			coder->sequence = SEQ_MEMBER_DIRECT_INIT;
+		}
+
+		// .lz versions 0 and 1 use CRC32 as the integrity check.
+		if (coder->tell_any_check && version <= 1)
+			return LZMA_GET_CHECK;
+
+		break;
+	}
+
+	case SEQ_MEMBER_SCAN: {
+		// Look for the end of the member in the buffered input.
+		// A candidate position needs the magic bytes of the next
+		// member after it. This makes false matches in the middle
+		// of the LZMA data practically impossible.
+		bool found = false;
+		while (coder->in_pos + sizeof(lzip_id_string)
+				<= coder->in_filled) {
+			if (coder->in[coder->in_pos] == lzip_id_string[0]
+					&& is_member_end(coder, coder->in_pos)
+					&& memcmp(coder->in + coder->in_pos,
+						lzip_id_string,
+						sizeof(lzip_id_string)) == 0) {
+				found = true;
+				break;
+			}
+
+			++coder->in_pos;
+		}
+
+		if (!found && *in_pos == in_size
+				&& action == LZMA_FINISH
+				&& is_member_end(coder, coder->in_filled)) {
+			// The last member ends at the end of the input.
+			coder->in_pos = coder->in_filled;
+			found = true;
+		}
+
+		if (found) {
+			coder->member_size = coder->in_pos;
+			coder->sequence = SEQ_MEMBER_THR_INIT;
+			break;
+		}
+
+		if (*in_pos == in_size) {
+			if (action == LZMA_FINISH) {
+				// The footer doesn't match the end of the
+				// input. The member is followed by trailing
+				// data or the file is corrupt or truncated.
+				// The direct mode decoder sorts it out.
+				coder->sequence = SEQ_MEMBER_DIRECT_INIT;
+				break;
+			}
+
+			return_if_error(read_output_and_wait(coder,
+					allocator, out, out_pos, out_size,
+					NULL, waiting_allowed,
+					&wait_abs, &has_blocked));
+
+			if (coder->pending_error != LZMA_OK) {
+				coder->sequence = SEQ_ERROR;
+				break;
+			}
+
+			return LZMA_OK;
+		}
+
+		if (coder->in_filled == coder->in_allocated) {
+			// A member bigger than its share of
+			// memlimit_threading is decoded in direct mode.
+			// This also keeps us from buffering a huge
+			// single-member file before decoding any of it.
+			const uint64_t share = coder->memlimit_threading
+					/ coder->threads_max;
+			if (coder->in_allocated > SIZE_MAX / 2
+					|| coder->in_allocated * 2
+						+ coder->mem_next_filters
+						> share) {
+				coder->sequence = SEQ_MEMBER_DIRECT_INIT;
+				break;
+			}
+
+			// Wait until the running threads have freed
+			// enough memory for the bigger buffer.
+			coder->mem_next = coder->in_allocated * 2;
+
+			bool can_continue = false;
+			return_if_error(read_output_and_wait(coder,
+					allocator, out, out_pos, out_size,
+					&can_continue, true,
+					&wait_abs, &has_blocked));
+
+			if (coder->pending_error != LZMA_OK) {
+				coder->sequence = SEQ_ERROR;
+				break;
+			}
+
+			if (!can_continue)
+				return LZMA_OK;
+
+			uint8_t *buf = lzma_alloc(coder->in_allocated * 2,
+					allocator);
+			if (buf == NULL) {
+				threads_stop(coder);
+				return LZMA_MEM_ERROR;
+			}
+
+			memcpy(buf, coder->in, coder->in_filled);
+			lzma_free(coder->in, allocator);
+			coder->in = buf;
+			coder->in_allocated *= 2;
+		}
+
+		lzma_bufcpy(in, in_pos, in_size, coder->in,
+				&coder->in_filled, coder->in_allocated);
+		break;
+	}
+
+	case SEQ_MEMBER_THR_INIT: {
+		// The Data size field is before the Member size field.
+		const uint64_t data_size = read64le(
+				coder->in + coder->member_size - 16);
+
+		// Use direct mode if the sizes are too big for threaded
+		// mode. This also makes the integer overflows below
+		// impossible. The maximum compression ratio of LZMA is
+		// about 7000:1 so a bigger Data size means that the file
+		// is corrupt. The direct mode decoder reports the error
+		// without allocating a huge output buffer first.
+		if (data_size > SIZE_MAX / 3
+				|| data_size / LZIP_RATIO_MAX
+					> coder->member_size
+				|| coder->mem_next_filters
+					> coder->memlimit_stop) {
+			coder->sequence = SEQ_MEMBER_DIRECT_INIT;
+			break;
+		}
+
+		const uint64_t mem_next_block = coder->in_allocated
+				+ coder->mem_next_filters
+				+ lzma_outq_outbuf_memusage((size_t)data_size);
+		if (mem_next_block > coder->memlimit_threading) {
+			coder->sequence = SEQ_MEMBER_DIRECT_INIT;
+			break;
+		}
+
+		// Free the direct mode decoder in case it has been
+		// initialized.
+		lzma_next_end(&coder->lzip_decoder, allocator);
+
+		// Wait until the memory usage of the active threads has
+		// dropped enough and there is both a free output queue
+		// slot and a free worker thread. This copies decoded
+		// data to out while waiting.
+		coder->mem_next = mem_next_block;
+
+		bool can_continue = false;
+		return_if_error(read_output_and_wait(coder, allocator,
+				out, out_pos, out_size,
+				&can_continue, true,
+				&wait_abs, &has_blocked));
+
+		if (coder->pending_error != LZMA_OK) {
+			coder->sequence = SEQ_ERROR;
+			break;
+		}
+
+		if (!can_continue) {
+			assert(*out_pos == out_size);
+			assert(!lzma_outq_is_empty(&coder->outq));
+			return LZMA_OK;
+		}
+
+		// Free cached memory if it might make us exceed
+		// memlimit_threading. See SEQ_BLOCK_THR_INIT in
+		// stream_decoder_mt.c.
+		uint64_t mem_in_use = 0;
+		uint64_t mem_cached = 0;
+		struct worker_thread *thr = NULL;
+
+		mythread_sync(coder->mutex) {
+			mem_in_use = coder->mem_in_use;
+			mem_cached = coder->mem_cached;
+			thr = coder->threads_free;
+		}
+
+		const uint64_t mem_max = coder->memlimit_threading
+				- mem_next_block;
+
+		if (mem_in_use + mem_cached + coder->outq.mem_allocated
+				> mem_max)
+			lzma_outq_clear_cache2(&coder->outq, allocator,
+					(size_t)data_size);
+
+		uint64_t mem_freed = 0;
+		if (thr != NULL && mem_in_use + mem_cached
+				+ coder->outq.mem_in_use > mem_max) {
+			if (thr->mem_filters <= coder->mem_next_filters)
+				thr = thr->next;
+
+			while (thr != NULL) {
+				lzma_next_end(&thr->lzip_decoder, allocator);
+				mem_freed += thr->mem_filters;
+				thr->mem_filters = 0;
+				thr = thr->next;
+			}
+		}
+
+		mythread_sync(coder->mutex) {
+			coder->mem_cached -= mem_freed;
+			coder->mem_in_use += coder->in_allocated
+					+ coder->mem_next_filters;
+		}
+
+		lzma_ret ret = lzma_outq_prealloc_buf(&coder->outq, allocator,
+				(size_t)data_size);
+		if (ret != LZMA_OK) {
+			threads_stop(coder);
+			return ret;
+		}
+
+		ret = get_thread(coder, allocator, &thr);
+		if (ret != LZMA_OK) {
+			threads_stop(coder);
+			return ret;
+		}
+
+		// The memory usage is already counted in mem_in_use.
+		thr->mem_filters = coder->mem_next_filters;
+		thr->in_allocated = coder->in_allocated;
+
+		// The decoder allocates the dictionary when it starts
+		// decoding, so that happens in the worker thread. The
+		// memory usage was checked above.
+		ret = lzma_lzip_decoder_init(&thr->lzip_decoder, allocator,
+				UINT64_MAX,
+				coder->ignore_check ? LZMA_IGNORE_CHECK : 0);
+		if (ret != LZMA_OK) {
+			mythread_sync(coder->mutex) {
+				worker_stop(thr);
+			}
+
+			threads_stop(coder);
+			return ret;
+		}
+
+		// Bytes after the member belong to the next member.
+		// They are moved to a new buffer and the worker thread
+		// gets the old one.
+		const size_t next_size = coder->in_filled - coder->member_size;
+		const size_t next_allocated = my_max(LZIP_IN_SIZE_MIN,
+				next_size);
+		uint8_t *next_in = lzma_alloc(next_allocated, allocator);
+		if (next_in == NULL) {
+			mythread_sync(coder->mutex) {
+				worker_stop(thr);
+			}
+
+			threads_stop(coder);
+			return LZMA_MEM_ERROR;
+		}
+
+		memcpy(next_in, coder->in + coder->member_size, next_size);
+
+		thr->in = coder->in;
+		thr->in_size = coder->member_size;
+		thr->outbuf = lzma_outq_get_buf(&coder->outq, thr);
+
+		coder->in = next_in;
+		coder->in_allocated = next_allocated;
+		coder->in_filled = next_size;
+		coder->in_pos = 0;
+
+		// Start the decoder.
+		mythread_sync(thr->mutex) {
+			assert(thr->state == THR_IDLE);
+			thr->state = THR_RUN;
+			mythread_cond_signal(&thr->cond);
+		}
+
+		coder->first_member = false;
+		coder->sequence = SEQ_MEMBER_HEADER;
+		break;
+	}
+
+	case SEQ_MEMBER_DIRECT_INIT: {
+		// Copy the output of the earlier members to out and wait
+		// for the worker threads to finish.
+		return_if_error(read_output_and_wait(coder, allocator,
+				out, out_pos, out_size,
+				NULL, true, &wait_abs, &has_blocked));
+
+		if (coder->pending_error != LZMA_OK) {
+			coder->sequence = SEQ_ERROR;
+			break;
+		}
+
+		if (!lzma_outq_is_empty(&coder->outq))
+			return LZMA_OK;
+
+		// Free the memory used by threaded mode.
+		lzma_outq_clear_cache(&coder->outq, allocator);
+		threads_end(coder, allocator);
+
+		// The direct mode decoder checks the memory usage against
+		// memlimit_stop itself, including after lzma_memlimit_set().
+		// LZMA_GET_CHECK was already returned in SEQ_MEMBER_HEADER
+		// so LZMA_TELL_ANY_CHECK isn't passed on.
+		return_if_error(lzma_lzip_decoder_init(&coder->lzip_decoder,
+				allocator, coder->memlimit_stop,
+				coder->ignore_check ? LZMA_IGNORE_CHECK : 0));
+
+		coder->in_pos = 0;
+		coder->sequence = SEQ_MEMBER_DIRECT_RUN;
+	}
+
+	// Fall through
+
+	case SEQ_MEMBER_DIRECT_RUN: {
+		// Decode the buffered input first and then continue with
+		// the input from the application.
+		const bool from_buffer = coder->in_pos < coder->in_filled;
+		const size_t out_old = *out_pos;
+		size_t in_used;
+		lzma_ret ret;
+
+		if (from_buffer) {
+			const size_t in_old = coder->in_pos;
+			ret = coder->lzip_decoder.code(
+					coder->lzip_decoder.coder, allocator,
+					coder->in, &coder->in_pos,
+					coder->in_filled,
+					out, out_pos, out_size, LZMA_RUN);
+			in_used = coder->in_pos - in_old;
+		} else {
+			const size_t in_old = *in_pos;
+			ret = coder->lzip_decoder.code(
+					coder->lzip_decoder.coder, allocator,
+					in, in_pos, in_size,
+					out, out_pos, out_size, action);
+			in_used = *in_pos - in_old;
+		}
+
+		// There are no worker threads in direct mode so the mutex
+		// isn't needed.
+		coder->progress_in += in_used;
+		coder->progress_out += *out_pos - out_old;
+
+		if (ret == LZMA_STREAM_END) {
+			// Keep the bytes after the member in the buffer.
+			coder->in_filled -= coder->in_pos;
+			memmove(coder->in, coder->in + coder->in_pos,
+					coder->in_filled);
+			coder->in_pos = 0;
+
+			if (!coder->concatenated)
+				return LZMA_STREAM_END;
+
+			coder->first_member = false;
+			coder->sequence = SEQ_MEMBER_HEADER;
+			break;
+		}
+
+		if (ret != LZMA_OK)
+			return ret;
+
+		// Continue with the input from the application once all
+		// buffered input has been used.
+		if (from_buffer && coder->in_pos == coder->in_filled) {
+			coder->in_pos = 0;
+			coder->in_filled = 0;
+			break;
+		}
+
+		return LZMA_OK;
+	}
+
+	case SEQ_FINISH:
+		// Non-.lz data or the end of the input was seen at
+		// the beginning of a member. Finish when all output
+		// has been copied to out.
+		return_if_error(read_output_and_wait(coder, allocator,
+				out, out_pos, out_size,
+				NULL, true, &wait_abs, &has_blocked));
+
+		if (coder->pending_error != LZMA_OK) {
+			coder->sequence = SEQ_ERROR;
+			break;
+		}
+
+		if (!lzma_outq_is_empty(&coder->outq))
+			return LZMA_OK;
+
+		return LZMA_STREAM_END;
+
+	case SEQ_ERROR:
+		if (!coder->fail_fast) {
+			// Let the application get all data before the point
+			// where the error was detected. This matches the
+			// behavior of single-threaded use.
+			return_if_error(read_output_and_wait(coder, allocator,
+					out, out_pos, out_size,
+					NULL, true, &wait_abs, &has_blocked));
+
+			if (!lzma_outq_is_empty(&coder->outq))
+				return LZMA_OK;
+		}
+
+		return coder->pending_error;
+
+	default:
+		assert(0);
+		return LZMA_PROG_ERROR;
+	}
+
+	// Never reached
+}
+
+
+static void
+lzip_decoder_mt_end(void *coder_ptr, const lzma_allocator *allocator)
+{
+	struct lzma_lzip_coder_mt *coder = coder_ptr;
+
+	threads_end(coder, allocator);
+	lzma_outq_end(&coder->outq, allocator);
+
+	lzma_next_end(&coder->lzip_decoder, allocator);
+	lzma_free(coder->in, allocator);
+
+	mythread_cond_destroy(&coder->cond);
+	mythread_mutex_destroy(&coder->mutex);
+	lzma_free(coder, allocator);
+	return;
+}
+
+
+static lzma_check
+lzip_decoder_mt_get_check(const void *coder_ptr lzma_attribute((__unused__)))
+{
+	return LZMA_CHECK_CRC32;
+}
+
+
+static lzma_ret
+lzip_decoder_mt_memconfig(void *coder_ptr, uint64_t *memusage,
+		uint64_t *old_memlimit, uint64_t new_memlimit)
+{
+	struct lzma_lzip_coder_mt *coder = coder_ptr;
+
+	// Memory usage of the direct mode decoder
+	uint64_t mem_direct_mode = 0;
+	uint64_t unused;
+	if (coder->lzip_decoder.memconfig != NULL)
+		coder->lzip_decoder.memconfig(coder->lzip_decoder.coder,
+				&mem_direct_mode, &unused, 0);
+
+	mythread_sync(coder->mutex) {
+		*memusage = mem_direct_mode
+				+ coder->in_allocated
+				+ coder->mem_in_use
+				+ coder->mem_cached
+				+ coder->outq.mem_allocated;
+	}
+
+	if (*memusage < LZMA_MEMUSAGE_BASE)
+		*memusage = LZMA_MEMUSAGE_BASE;
+
+	*old_memlimit = coder->memlimit_stop;
+
+	if (new_memlimit != 0) {
+		if (new_memlimit < *memusage)
+			return LZMA_MEMLIMIT_ERROR;
+
+		coder->memlimit_stop = new_memlimit;
+
+		// The direct mode decoder has its own copy of the limit.
+		if (coder->lzip_decoder.memconfig != NULL)
+			return_if_error(coder->lzip_decoder.memconfig(
+					coder->lzip_decoder.coder,
+					&unused, &unused, new_memlimit));
+	}
+
+	return LZMA_OK;
+}
+
+
+static void
+lzip_decoder_mt_get_progress(void *coder_ptr,
+		uint64_t *progress_in, uint64_t *progress_out)
+{
+	struct lzma_lzip_coder_mt *coder = coder_ptr;
+
+	mythread_sync(coder->mutex) {
+		*progress_in = coder->progress_in;
+		*progress_out = coder->progress_out;
+
+		for (size_t i = 0; i < coder->threads_initialized; ++i) {
+			mythread_sync(coder->threads[i].mutex) {
+				*progress_in += coder->threads[i].progress_in;
+				*progress_out += coder->threads[i]
+						.progress_out;
+			}
+		}
+	}
+
+	return;
+}
+
+
+static lzma_ret
+lzip_decoder_mt_init(lzma_next_coder *next, const lzma_allocator *allocator,
+		const lzma_mt *options)
+{
+	if (options->threads == 0 || options->threads > LZMA_THREADS_MAX)
+		return LZMA_OPTIONS_ERROR;
+
+	if (options->flags & ~LZMA_SUPPORTED_FLAGS)
+		return LZMA_OPTIONS_ERROR;
+
+	lzma_next_coder_init(&lzip_decoder_mt_init, next, allocator);
+
+	struct lzma_lzip_coder_mt *coder = next->coder;
+	if (coder == NULL) {
+		coder = lzma_alloc(sizeof(struct lzma_lzip_coder_mt),
+				allocator);
+		if (coder == NULL)
+			return LZMA_MEM_ERROR;
+
+		next->coder = coder;
+
+		if (mythread_mutex_init(&coder->mutex)) {
+			lzma_free(coder, allocator);
+			return LZMA_MEM_ERROR;
+		}
+
+		if (mythread_cond_init(&coder->cond)) {
+			mythread_mutex_destroy(&coder->mutex);
+			lzma_free(coder, allocator);
+			return LZMA_MEM_ERROR;
+		}
+
+		next->code = &lzip_decode_mt;
+		next->end = &lzip_decoder_mt_end;
+		next->get_check = &lzip_decoder_mt_get_check;
+		next->memconfig = &lzip_decoder_mt_memconfig;
+		next->get_progress = &lzip_decoder_mt_get_progress;
+
+		memzero(&coder->outq, sizeof(coder->outq));
+
+		coder->lzip_decoder = LZMA_NEXT_CODER_INIT;
+		coder->in = NULL;
+		coder->in_allocated = 0;
+
+		coder->threads = NULL;
+		coder->threads_free = NULL;
+		coder->threads_initialized = 0;
+	}
+
+	threads_end(coder, allocator);
+	lzma_next_end(&coder->lzip_decoder, allocator);
+
+	if (coder->in == NULL) {
+		coder->in = lzma_alloc(LZIP_IN_SIZE_MIN, allocator);
+		if (coder->in == NULL)
+			return LZMA_MEM_ERROR;
+
+		coder->in_allocated = LZIP_IN_SIZE_MIN;
+	}
+
+	coder->in_filled = 0;
+	coder->in_pos = 0;
+
+	coder->progress_in = 0;
+	coder->progress_out = 0;
+
+	coder->sequence = SEQ_MEMBER_HEADER;
+	coder->thread_error = LZMA_OK;
+	coder->pending_error = LZMA_OK;
+
+	coder->timeout = options->timeout;
+
+	coder->memlimit_threading = my_max(1, options->memlimit_threading);
+	coder->memlimit_stop = my_max(1, options->memlimit_stop);
+	if (coder->memlimit_threading > coder->memlimit_stop)
+		coder->memlimit_threading = coder->memlimit_stop;
+
+	coder->tell_any_check = (options->flags & LZMA_TELL_ANY_CHECK) != 0;
+	coder->ignore_check = (options->flags & LZMA_IGNORE_CHECK) != 0;
+	coder->concatenated = (options->flags & LZMA_CONCATENATED) != 0;
+	coder->fail_fast = (options->flags & LZMA_FAIL_FAST) != 0;
+
+	coder->first_member = true;
+	coder->out_was_filled = false;
+
+	coder->threads_max = options->threads;
+
+	return lzma_outq_init(&coder->outq, allocator, coder->threads_max);
+}
+
+
+extern LZMA_API(lzma_ret)
+lzma_lzip_decoder_mt(lzma_stream *strm, const lzma_mt *options)
+{
+	lzma_next_strm_init(lzip_decoder_mt_init, strm, options);
+
+	strm->internal->supported_actions[LZMA_RUN] = true;
+	strm->internal->supported_actions[LZMA_FINISH] = true;
+
+	return LZMA_OK;
+}
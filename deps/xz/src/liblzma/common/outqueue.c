@@ -21,6 +21,16 @@
 
 extern uint64_t
 lzma_outq_memusage(uint64_t buf_size_max, uint32_t threads)
+{
+	if (threads > LZMA_THREADS_MAX)
+		return UINT64_MAX;
+
+	return lzma_outq_memusage_bufs(buf_size_max, GET_BUFS_LIMIT(threads));
+}
+
+
+extern uint64_t
+lzma_outq_memusage_bufs(uint64_t buf_size_max, uint32_t bufs_limit)
 {
 	// This is to ease integer overflow checking: We may allocate up to
 	// GET_BUFS_LIMIT(LZMA_THREADS_MAX) buffers and we need some extra
@@ -30,11 +40,11 @@ lzma_outq_memusage(uint64_t buf_size_max, uint32_t threads)
 	const uint64_t limit
 			= UINT64_MAX / GET_BUFS_LIMIT(LZMA_THREADS_MAX) / 2;
 
-	if (threads > LZMA_THREADS_MAX || buf_size_max > limit)
+	if (bufs_limit > GET_BUFS_LIMIT(LZMA_THREADS_MAX)
+			|| buf_size_max > limit)
 		return UINT64_MAX;
 
-	return GET_BUFS_LIMIT(threads)
-			* lzma_outq_outbuf_memusage(buf_size_max);
+	return bufs_limit * lzma_outq_outbuf_memusage(buf_size_max);
 }
 
 
@@ -133,6 +143,20 @@ lzma_outq_init(lzma_outq *outq, const lzma_allocator *allocator,
 }
 
 
+extern void
+lzma_outq_set_bufs_limit(lzma_outq *outq, const lzma_allocator *allocator,
+		uint32_t bufs_limit)
+{
+	assert(bufs_limit > 0);
+
+	while (bufs_limit < outq->bufs_allocated && outq->cache != NULL)
+		free_one_cached_buffer(outq, allocator);
+
+	outq->bufs_limit = bufs_limit;
+	return;
+}
+
+
 extern void
 lzma_outq_end(lzma_outq *outq, const lzma_allocator *allocator)
 {
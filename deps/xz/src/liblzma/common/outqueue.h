@@ -110,6 +110,18 @@ typedef struct {
 extern uint64_t lzma_outq_memusage(uint64_t buf_size_max, uint32_t threads);
 
 
+/**
+ * \brief       Calculate the memory usage of an output queue
+ *
+ * This is like lzma_outq_memusage() but takes the maximum number of
+ * buffers instead of the number of threads.
+ *
+ * \return      Approximate memory usage in bytes or UINT64_MAX on error.
+ */
+extern uint64_t lzma_outq_memusage_bufs(uint64_t buf_size_max,
+		uint32_t bufs_limit);
+
+
 /// \brief      Initialize an output queue
 ///
 /// \param      outq            Pointer to an output queue. Before calling
@@ -133,6 +145,21 @@ extern lzma_ret lzma_outq_init(lzma_outq *outq,
 		const lzma_allocator *allocator, uint32_t threads);
 
 
+/// \brief     Change the maximum number of buffers
+///
+/// This can be used between lzma_outq_init() and lzma_outq_end() to change
+/// the limit set by lzma_outq_init(). If the limit is lowered, cached
+/// buffers are freed but the buffers in use are kept. Then no new buffers
+/// can be taken into use until the number of buffers in use has dropped
+/// below the new limit.
+///
+/// \param      outq            Pointer to an output queue
+/// \param      allocator       Pointer to allocator or NULL
+/// \param      bufs_limit      Maximum number of buffers, at least one
+extern void lzma_outq_set_bufs_limit(lzma_outq *outq,
+		const lzma_allocator *allocator, uint32_t bufs_limit);
+
+
 /// \brief      Free the memory associated with the output queue
 extern void lzma_outq_end(lzma_outq *outq, const lzma_allocator *allocator);
 
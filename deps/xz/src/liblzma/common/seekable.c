@@ -0,0 +1,647 @@
+// SPDX-License-Identifier: 0BSD
+
+///////////////////////////////////////////////////////////////////////////////
+//
+/// \file       seekable.c
+/// \brief      Random access reading of .xz files
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "block_decoder.h"
+
+
+/// Size of the buffer used to read compressed data and, when the beginning
+/// of a Block needs to be skipped, to hold the discarded uncompressed data
+#define SEEKABLE_BUF_SIZE (UINT32_C(64) << 10)
+
+/// Base-2 logarithm of the initial number of buckets in the hash table
+/// of cached Blocks. The table is doubled when the cache holds more
+/// Blocks than there are buckets.
+#define SEEKABLE_HASH_BITS_MIN 6
+
+/// The hash table doesn't grow beyond this
+#define SEEKABLE_HASH_BITS_MAX (SIZE_MAX > UINT32_MAX ? 30 : 24)
+
+
+/// Decoded Block in the cache
+typedef struct seekable_block_s seekable_block;
+struct seekable_block_s {
+	/// Cached Blocks are in a doubly-linked list with the most
+	/// recently used Block first.
+	seekable_block *prev;
+	seekable_block *next;
+
+	/// Next Block in the same hash table bucket
+	seekable_block *hash_next;
+
+	/// Uncompressed offset of the Block in the file
+	uint64_t offset;
+
+	/// Uncompressed size of the Block
+	size_t size;
+
+	uint8_t data[];
+};
+
+
+struct lzma_seekable_s {
+	lzma_seekable_source source;
+	const lzma_allocator *allocator;
+
+	/// Indexes of all Streams in the file
+	lzma_index *index;
+
+	/// Uncompressed size of the file
+	uint64_t uncompressed_size;
+
+	/// Memory usage limit of a Block decoder
+	uint64_t memlimit;
+
+	/// Maximum and current amount of decoded data in the cache
+	uint64_t cache_size;
+	uint64_t cache_used;
+
+	/// The most and the least recently used Blocks in the cache
+	seekable_block *head;
+	seekable_block *tail;
+
+	/// Number of Blocks in the cache
+	size_t cache_count;
+
+	/// Cached Blocks hashed by their uncompressed offset so that
+	/// a lookup doesn't need to walk the whole list. The table
+	/// has 1 << hash_bits buckets.
+	seekable_block **hash;
+	uint32_t hash_bits;
+
+#ifdef MYTHREAD_ENABLED
+	/// Protects the cache so that lzma_seekable_read() can be
+	/// called from multiple threads.
+	mythread_mutex mutex;
+#endif
+};
+
+
+static void
+cache_lock(lzma_seekable *seekable)
+{
+#ifdef MYTHREAD_ENABLED
+	mythread_mutex_lock(&seekable->mutex);
+#else
+	(void)seekable;
+#endif
+	return;
+}
+
+
+static void
+cache_unlock(lzma_seekable *seekable)
+{
+#ifdef MYTHREAD_ENABLED
+	mythread_mutex_unlock(&seekable->mutex);
+#else
+	(void)seekable;
+#endif
+	return;
+}
+
+
+/// Remove a Block from the list. The caller must hold the lock.
+static void
+cache_unlink(lzma_seekable *seekable, seekable_block *block)
+{
+	if (block->prev != NULL)
+		block->prev->next = block->next;
+	else
+		seekable->head = block->next;
+
+	if (block->next != NULL)
+		block->next->prev = block->prev;
+	else
+		seekable->tail = block->prev;
+
+	return;
+}
+
+
+/// Put a Block first in the list. The caller must hold the lock.
+static void
+cache_link_first(lzma_seekable *seekable, seekable_block *block)
+{
+	block->prev = NULL;
+	block->next = seekable->head;
+
+	if (seekable->head != NULL)
+		seekable->head->prev = block;
+	else
+		seekable->tail = block;
+
+	seekable->head = block;
+	return;
+}
+
+
+/// Get the hash table bucket of a Block offset. Block offsets tend to be
+/// multiples of the Block size, so all bits of the offset are mixed
+/// (Fibonacci hashing) and the high bits of the product are used.
+static size_t
+cache_hash(const lzma_seekable *seekable, uint64_t offset)
+{
+	return (size_t)((offset * UINT64_C(0x9E3779B97F4A7C15))
+			>> (64 - seekable->hash_bits));
+}
+
+
+/// Find a Block from the cache. The caller must hold the lock.
+static seekable_block *
+cache_find(const lzma_seekable *seekable, uint64_t offset)
+{
+	seekable_block *block = seekable->hash[cache_hash(seekable, offset)];
+
+	while (block != NULL && block->offset != offset)
+		block = block->hash_next;
+
+	return block;
+}
+
+
+/// Put a Block into its hash table bucket. The caller must hold the lock.
+static void
+cache_hash_insert(lzma_seekable *seekable, seekable_block *block)
+{
+	const size_t i = cache_hash(seekable, block->offset);
+	block->hash_next = seekable->hash[i];
+	seekable->hash[i] = block;
+	return;
+}
+
+
+/// Remove a Block from its hash table bucket. The caller must hold
+/// the lock.
+static void
+cache_hash_remove(lzma_seekable *seekable, seekable_block *block)
+{
+	seekable_block **ptr = &seekable->hash[
+			cache_hash(seekable, block->offset)];
+
+	while (*ptr != block)
+		ptr = &(*ptr)->hash_next;
+
+	*ptr = block->hash_next;
+	return;
+}
+
+
+/// Double the size of the hash table. If memory allocation fails,
+/// the old table is kept; the lookups just get slower. The caller must
+/// hold the lock.
+static void
+cache_hash_grow(lzma_seekable *seekable)
+{
+	seekable_block **old = seekable->hash;
+	const size_t old_count = (size_t)1 << seekable->hash_bits;
+
+	seekable_block **hash = lzma_alloc_zero(
+			sizeof(seekable_block *) * old_count * 2,
+			seekable->allocator);
+	if (hash == NULL)
+		return;
+
+	seekable->hash = hash;
+	++seekable->hash_bits;
+
+	for (size_t i = 0; i < old_count; ++i) {
+		seekable_block *block = old[i];
+		while (block != NULL) {
+			seekable_block *next = block->hash_next;
+			cache_hash_insert(seekable, block);
+			block = next;
+		}
+	}
+
+	lzma_free(old, seekable->allocator);
+	return;
+}
+
+
+/// Copy data from a cached Block. Returns true if the Block was
+/// found from the cache.
+static bool
+cache_copy(lzma_seekable *seekable, uint64_t offset,
+		size_t skip, uint8_t *buf, size_t size)
+{
+	cache_lock(seekable);
+
+	seekable_block *block = cache_find(seekable, offset);
+	if (block != NULL) {
+		memcpy(buf, block->data + skip, size);
+
+		cache_unlink(seekable, block);
+		cache_link_first(seekable, block);
+	}
+
+	cache_unlock(seekable);
+
+	return block != NULL;
+}
+
+
+/// Add a decoded Block to the cache, evicting the least recently used
+/// Blocks if needed. If another thread has already added the same Block,
+/// the new copy is freed.
+static void
+cache_add(lzma_seekable *seekable, seekable_block *new_block)
+{
+	cache_lock(seekable);
+
+	if (cache_find(seekable, new_block->offset) != NULL) {
+		cache_unlock(seekable);
+		lzma_free(new_block, seekable->allocator);
+		return;
+	}
+
+	while (seekable->cache_used + new_block->size > seekable->cache_size) {
+		seekable_block *old = seekable->tail;
+		cache_unlink(seekable, old);
+		cache_hash_remove(seekable, old);
+		seekable->cache_used -= old->size;
+		--seekable->cache_count;
+		lzma_free(old, seekable->allocator);
+	}
+
+	if (seekable->cache_count >= ((size_t)1 << seekable->hash_bits)
+			&& seekable->hash_bits < SEEKABLE_HASH_BITS_MAX)
+		cache_hash_grow(seekable);
+
+	cache_link_first(seekable, new_block);
+	cache_hash_insert(seekable, new_block);
+	seekable->cache_used += new_block->size;
+	++seekable->cache_count;
+
+	cache_unlock(seekable);
+	return;
+}
+
+
+/// Decode the Block that iter points to. The first skip bytes of
+/// uncompressed data are discarded and the next out_size bytes are
+/// stored to out[]. If the whole Block is requested, the decoding is
+/// continued to the end of the Block so that the integrity check gets
+/// verified.
+static lzma_ret
+decode_block(lzma_seekable *seekable, const lzma_index_iter *iter,
+		uint64_t skip, uint8_t *out, size_t out_size)
+{
+	const lzma_allocator *allocator = seekable->allocator;
+
+	uint8_t *buf = lzma_alloc(2 * SEEKABLE_BUF_SIZE, allocator);
+	if (buf == NULL)
+		return LZMA_MEM_ERROR;
+
+	uint8_t *discard = buf + SEEKABLE_BUF_SIZE;
+
+	uint64_t in_pos_file = iter->block.compressed_file_offset;
+	const uint64_t in_end_file = in_pos_file + iter->block.total_size;
+
+	lzma_filter filters[LZMA_FILTERS_MAX + 1];
+	lzma_block block;
+	block.version = 1;
+	block.check = iter->stream.flags->check;
+	block.filters = filters;
+
+	lzma_next_coder block_decoder = LZMA_NEXT_CODER_INIT;
+
+	// Read and decode the Block Header.
+	lzma_ret ret = seekable->source.read(seekable->source.opaque,
+			buf, 1, in_pos_file);
+	if (ret != LZMA_OK)
+		goto out;
+
+	block.header_size = lzma_block_header_size_decode(buf[0]);
+	if (buf[0] == 0x00 || block.header_size > iter->block.total_size) {
+		ret = LZMA_DATA_ERROR;
+		goto out;
+	}
+
+	ret = seekable->source.read(seekable->source.opaque,
+			buf, block.header_size, in_pos_file);
+	if (ret != LZMA_OK)
+		goto out;
+
+	in_pos_file += block.header_size;
+
+	// On error, this frees the filter options itself.
+	ret = lzma_block_header_decode(&block, allocator, buf);
+	if (ret != LZMA_OK)
+		goto out;
+
+	// The sizes in the Block Header must match the Index.
+	ret = lzma_block_compressed_size(&block, iter->block.unpadded_size);
+	if (ret != LZMA_OK)
+		goto out_filters;
+
+	if (block.uncompressed_size == LZMA_VLI_UNKNOWN) {
+		block.uncompressed_size = iter->block.uncompressed_size;
+	} else if (block.uncompressed_size
+			!= iter->block.uncompressed_size) {
+		ret = LZMA_DATA_ERROR;
+		goto out_filters;
+	}
+
+	if (lzma_raw_decoder_memusage(filters) > seekable->memlimit) {
+		ret = LZMA_MEMLIMIT_ERROR;
+		goto out_filters;
+	}
+
+	ret = lzma_block_decoder_init(&block_decoder, allocator, &block);
+
+	// The filter options are needed only to initialize the decoder.
+	lzma_filters_free(filters, allocator);
+
+	if (ret != LZMA_OK)
+		goto out;
+
+	const bool whole_block = skip == 0
+			&& out_size == iter->block.uncompressed_size;
+
+	size_t in_pos = 0;
+	size_t in_size = 0;
+	size_t out_pos = 0;
+
+	while (true) {
+		if (in_pos == in_size && in_pos_file < in_end_file) {
+			in_pos = 0;
+			in_size = (size_t)my_min(in_end_file - in_pos_file,
+					SEEKABLE_BUF_SIZE);
+			ret = seekable->source.read(seekable->source.opaque,
+					buf, in_size, in_pos_file);
+			if (ret != LZMA_OK)
+				goto out;
+
+			in_pos_file += in_size;
+		}
+
+		const size_t in_start = in_pos;
+
+		if (skip > 0) {
+			size_t discard_pos = 0;
+			ret = block_decoder.code(block_decoder.coder,
+					allocator, buf, &in_pos, in_size,
+					discard, &discard_pos,
+					(size_t)my_min(skip, SEEKABLE_BUF_SIZE),
+					LZMA_RUN);
+			skip -= discard_pos;
+
+			if (discard_pos == 0 && in_pos == in_start
+					&& ret == LZMA_OK)
+				ret = LZMA_DATA_ERROR;
+		} else {
+			const size_t out_start = out_pos;
+			ret = block_decoder.code(block_decoder.coder,
+					allocator, buf, &in_pos, in_size,
+					out, &out_pos, out_size, LZMA_RUN);
+
+			if (out_pos == out_size && !whole_block
+					&& ret == LZMA_OK)
+				break;
+
+			// If no progress is possible, the input is
+			// truncated or corrupt.
+			if (out_pos == out_start && in_pos == in_start
+					&& ret == LZMA_OK)
+				ret = LZMA_DATA_ERROR;
+		}
+
+		if (ret == LZMA_STREAM_END) {
+			// The Block decoder has verified that the
+			// Uncompressed Size matches the Index.
+			assert(out_pos == out_size);
+			ret = LZMA_OK;
+			break;
+		}
+
+		if (ret != LZMA_OK)
+			goto out;
+	}
+
+out:
+	lzma_next_end(&block_decoder, allocator);
+	lzma_free(buf, allocator);
+	return ret;
+
+out_filters:
+	lzma_filters_free(filters, allocator);
+	lzma_free(buf, allocator);
+	return ret;
+}
+
+
+/// Decode the Indexes of the file with the file info decoder.
+static lzma_ret
+decode_indexes(lzma_seekable *seekable, uint64_t file_size)
+{
+	uint8_t *buf = lzma_alloc(SEEKABLE_BUF_SIZE, seekable->allocator);
+	if (buf == NULL)
+		return LZMA_MEM_ERROR;
+
+	lzma_stream strm = LZMA_STREAM_INIT;
+	strm.allocator = seekable->allocator;
+
+	lzma_ret ret = lzma_file_info_decoder(&strm, &seekable->index,
+			seekable->memlimit, file_size);
+	uint64_t pos = 0;
+
+	while (ret == LZMA_OK) {
+		lzma_action action = LZMA_RUN;
+
+		if (strm.avail_in == 0) {
+			const size_t size = my_min(file_size - pos,
+					SEEKABLE_BUF_SIZE);
+			if (size == 0) {
+				action = LZMA_FINISH;
+			} else {
+				ret = seekable->source.read(
+						seekable->source.opaque,
+						buf, size, pos);
+				if (ret != LZMA_OK)
+					break;
+			}
+
+			strm.next_in = buf;
+			strm.avail_in = size;
+			pos += size;
+		}
+
+		ret = lzma_code(&strm, action);
+
+		if (ret == LZMA_SEEK_NEEDED) {
+			// The file info decoder doesn't ask to seek
+			// past the end of the file.
+			assert(strm.seek_pos <= file_size);
+			pos = strm.seek_pos;
+			strm.avail_in = 0;
+			ret = LZMA_OK;
+		}
+	}
+
+	if (ret == LZMA_STREAM_END)
+		ret = LZMA_OK;
+
+	lzma_end(&strm);
+	lzma_free(buf, seekable->allocator);
+	return ret;
+}
+
+
+extern LZMA_API(lzma_ret)
+lzma_seekable_open(lzma_seekable **seekable_ptr,
+		const lzma_seekable_source *source, uint64_t file_size,
+		uint64_t cache_size, uint64_t memlimit,
+		const lzma_allocator *allocator)
+{
+	if (seekable_ptr == NULL || source == NULL || source->read == NULL)
+		return LZMA_PROG_ERROR;
+
+	lzma_seekable *seekable = lzma_alloc(sizeof(lzma_seekable),
+			allocator);
+	if (seekable == NULL)
+		return LZMA_MEM_ERROR;
+
+	seekable->source = *source;
+	seekable->allocator = allocator;
+	seekable->index = NULL;
+	seekable->memlimit = my_max(1, memlimit);
+	seekable->cache_size = my_min(cache_size, SIZE_MAX / 2);
+	seekable->cache_used = 0;
+	seekable->head = NULL;
+	seekable->tail = NULL;
+	seekable->cache_count = 0;
+	seekable->hash_bits = SEEKABLE_HASH_BITS_MIN;
+	seekable->hash = lzma_alloc_zero(sizeof(seekable_block *)
+			<< SEEKABLE_HASH_BITS_MIN, allocator);
+	if (seekable->hash == NULL) {
+		lzma_free(seekable, allocator);
+		return LZMA_MEM_ERROR;
+	}
+
+	const lzma_ret ret = decode_indexes(seekable, file_size);
+	if (ret != LZMA_OK) {
+		lzma_free(seekable->hash, allocator);
+		lzma_free(seekable, allocator);
+		return ret;
+	}
+
+	seekable->uncompressed_size
+			= lzma_index_uncompressed_size(seekable->index);
+
+#ifdef MYTHREAD_ENABLED
+	if (mythread_mutex_init(&seekable->mutex)) {
+		lzma_index_end(seekable->index, allocator);
+		lzma_free(seekable->hash, allocator);
+		lzma_free(seekable, allocator);
+		return LZMA_MEM_ERROR;
+	}
+#endif
+
+	*seekable_ptr = seekable;
+	return LZMA_OK;
+}
+
+
+extern LZMA_API(const lzma_index *)
+lzma_seekable_index(const lzma_seekable *seekable)
+{
+	return seekable->index;
+}
+
+
+extern LZMA_API(lzma_ret)
+lzma_seekable_read(lzma_seekable *seekable,
+		uint8_t *buf, size_t *size, uint64_t pos)
+{
+	if (seekable == NULL || size == NULL || (buf == NULL && *size > 0))
+		return LZMA_PROG_ERROR;
+
+	lzma_ret ret = LZMA_OK;
+	size_t done = 0;
+
+	while (done < *size && pos < seekable->uncompressed_size) {
+		lzma_index_iter iter;
+		lzma_index_iter_init(&iter, seekable->index);
+		if (lzma_index_iter_locate(&iter, pos)) {
+			ret = LZMA_PROG_ERROR;
+			break;
+		}
+
+		const uint64_t offset = iter.block.uncompressed_file_offset;
+		const uint64_t block_size = iter.block.uncompressed_size;
+		const uint64_t skip = pos - offset;
+		const size_t amount = (size_t)my_min(
+				*size - done, block_size - skip);
+
+		if (block_size <= seekable->cache_size) {
+			if (!cache_copy(seekable, offset, (size_t)skip,
+					buf + done, amount)) {
+				seekable_block *block = lzma_alloc(
+						sizeof(seekable_block)
+						+ (size_t)block_size,
+						seekable->allocator);
+				if (block == NULL) {
+					ret = LZMA_MEM_ERROR;
+					break;
+				}
+
+				block->offset = offset;
+				block->size = (size_t)block_size;
+
+				ret = decode_block(seekable, &iter, 0,
+						block->data, block->size);
+				if (ret != LZMA_OK) {
+					lzma_free(block, seekable->allocator);
+					break;
+				}
+
+				memcpy(buf + done, block->data + (size_t)skip,
+						amount);
+				cache_add(seekable, block);
+			}
+		} else {
+			ret = decode_block(seekable, &iter, skip,
+					buf + done, amount);
+			if (ret != LZMA_OK)
+				break;
+		}
+
+		done += amount;
+		pos += amount;
+	}
+
+	*size = done;
+	return ret;
+}
+
+
+extern LZMA_API(void)
+lzma_seekable_end(lzma_seekable *seekable)
+{
+	if (seekable == NULL)
+		return;
+
+	const lzma_allocator *allocator = seekable->allocator;
+
+	seekable_block *block = seekable->head;
+	while (block != NULL) {
+		seekable_block *next = block->next;
+		lzma_free(block, allocator);
+		block = next;
+	}
+
+#ifdef MYTHREAD_ENABLED
+	mythread_mutex_destroy(&seekable->mutex);
+#endif
+
+	lzma_index_end(seekable->index, allocator);
+	lzma_free(seekable->hash, allocator);
+	lzma_free(seekable, allocator);
+	return;
+}
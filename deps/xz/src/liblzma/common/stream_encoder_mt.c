@@ -21,6 +21,18 @@
 /// overflows if we are given unusually large block size.
 #define BLOCK_SIZE_MAX (UINT64_MAX / LZMA_THREADS_MAX)
 
+/// With LZMA_MT_ADAPTIVE, the Block size isn't reduced below the maximum
+/// Block size divided by ADAPTIVE_BLOCK_SIZE_DIV or ADAPTIVE_BLOCK_SIZE_MIN,
+/// whichever is more. Smaller Blocks would hurt the compression ratio
+/// too much; it's better to use fewer threads then.
+#define ADAPTIVE_BLOCK_SIZE_DIV 4
+#define ADAPTIVE_BLOCK_SIZE_MIN (UINT64_C(1) << 20)
+
+/// With LZMA_MT_ADAPTIVE, the number of threads is reduced only after
+/// this many Blocks in a row have indicated that fewer threads would
+/// keep up with the input.
+#define ADAPTIVE_SHRINK_BLOCKS 4
+
 
 typedef enum {
 	/// Waiting for work.
@@ -45,15 +57,39 @@ typedef enum {
 
 typedef struct lzma_stream_coder_s lzma_stream_coder;
 
+/// Memory budget for LZMA_MT_ADAPTIVE. The other members are needed
+/// for the memory usage calculation without LZMA_MT_ADAPTIVE too.
+typedef struct {
+	/// Memory usage limit from lzma_mt.memlimit_threading
+	uint64_t memlimit;
+
+	/// Memory usage of the filter encoders of one thread
+	uint64_t filters_memusage;
+
+	/// The Block size from the options or the recommended Block size
+	uint64_t block_size_max;
+
+	/// Block size below which the number of threads is reduced instead
+	uint64_t block_size_min;
+
+	/// Number of allocated worker_thread structures
+	uint32_t threads_max;
+} mt_budget;
+
 typedef struct worker_thread_s worker_thread;
 struct worker_thread_s {
 	worker_state state;
 
-	/// Input buffer of coder->block_size bytes. The main thread will
+	/// Input buffer of block_size bytes. The main thread will
 	/// put new input into this and update in_size accordingly. Once
 	/// no more input is coming, state will be set to THR_FINISH.
 	uint8_t *in;
 
+	/// Size of the input buffer. This is the Block size that was
+	/// used when the buffer was allocated. The main thread changes
+	/// this only when the thread is idle.
+	size_t block_size;
+
 	/// Amount of data available in the input buffer. This is modified
 	/// only by the main thread.
 	size_t in_size;
@@ -111,8 +147,26 @@ struct lzma_stream_coder_s {
 
 	/// Start a new Block every block_size bytes of input unless
 	/// LZMA_FULL_FLUSH or LZMA_FULL_BARRIER is used earlier.
+	/// With LZMA_MT_ADAPTIVE this may change between Blocks.
 	size_t block_size;
 
+	/// True if LZMA_MT_ADAPTIVE was used
+	bool adaptive;
+
+	/// Memory budget and Block size limits
+	mt_budget budget;
+
+	/// Maximum number of Blocks that may be encoded at the same time.
+	/// Without LZMA_MT_ADAPTIVE this is always threads_max.
+	uint32_t threads_active;
+
+	/// Number of Blocks in a row that could have been encoded
+	/// with fewer than threads_active threads
+	uint32_t shrink_count;
+
+	/// The highest number of threads that those Blocks needed
+	uint32_t shrink_threads;
+
 	/// The filter chain to use for the next Block.
 	/// This can be updated using lzma_filters_update()
 	/// after LZMA_FULL_BARRIER or LZMA_FULL_FLUSH.
@@ -226,7 +280,7 @@ worker_encode(worker_thread *thr, size_t *out_pos, worker_state state)
 		.version = 0,
 		.check = thr->coder->stream_flags.check,
 		.compressed_size = thr->outbuf->allocated,
-		.uncompressed_size = thr->coder->block_size,
+		.uncompressed_size = thr->block_size,
 		.filters = thr->filters,
 	};
 
@@ -266,7 +320,10 @@ worker_encode(worker_thread *thr, size_t *out_pos, worker_state state)
 			thr->progress_in = in_pos;
 			thr->progress_out = *out_pos;
 
-			while (in_size == thr->in_size
+			// Wait only if all the input has been used.
+			// The main thread may have given more than
+			// in_chunk_max bytes at once.
+			while (in_pos == thr->in_size
 					&& thr->state == THR_RUN)
 				mythread_cond_wait(&thr->cond, &thr->mutex);
 
@@ -502,6 +559,8 @@ initialize_new_thread(lzma_stream_coder *coder,
 	if (thr->in == NULL)
 		return LZMA_MEM_ERROR;
 
+	thr->block_size = coder->block_size;
+
 	if (mythread_mutex_init(&thr->mutex))
 		goto error_mutex;
 
@@ -536,6 +595,239 @@ error_mutex:
 }
 
 
+/// Calculate the memory usage when threads_max worker_thread structures
+/// have been allocated, up to "threads" threads encode Blocks of
+/// block_size bytes, and the output queue has up to "jobs" buffers.
+static uint64_t
+get_memusage(const mt_budget *budget, uint32_t threads, uint32_t jobs,
+		uint64_t block_size)
+{
+	assert(threads <= budget->threads_max);
+	assert(block_size <= BLOCK_SIZE_MAX);
+
+	// Memory usage of the input buffers
+	const uint64_t inbuf_memusage = threads * block_size;
+
+	// Memory usage of the filter encoders
+	const uint64_t filters_memusage = threads * budget->filters_memusage;
+
+	// Memory usage of the output queue
+	const uint64_t outbuf_size_max = lzma_block_buffer_bound64(block_size);
+	if (outbuf_size_max == 0)
+		return UINT64_MAX;
+
+	const uint64_t outq_memusage = lzma_outq_memusage_bufs(
+			outbuf_size_max, jobs);
+	if (outq_memusage == UINT64_MAX)
+		return UINT64_MAX;
+
+	// Sum them with overflow checking.
+	uint64_t total_memusage = LZMA_MEMUSAGE_BASE
+			+ sizeof(lzma_stream_coder)
+			+ budget->threads_max * sizeof(worker_thread);
+
+	if (UINT64_MAX - total_memusage < inbuf_memusage)
+		return UINT64_MAX;
+
+	total_memusage += inbuf_memusage;
+
+	if (UINT64_MAX - total_memusage < filters_memusage)
+		return UINT64_MAX;
+
+	total_memusage += filters_memusage;
+
+	if (UINT64_MAX - total_memusage < outq_memusage)
+		return UINT64_MAX;
+
+	return total_memusage + outq_memusage;
+}
+
+
+/// Find the number of output buffers and the Block size to use with
+/// the given number of threads so that the memory budget is met.
+/// Returns false if it cannot be done.
+static bool
+adaptive_pick(const mt_budget *budget, uint32_t threads,
+		uint32_t *jobs, uint64_t *block_size)
+{
+	// With one output buffer more than there are threads, a thread can
+	// start a new Block while the oldest Block is still being copied
+	// out. The non-adaptive mode uses twice the number of threads.
+	const uint32_t jobs_min = threads + 1;
+	const uint32_t jobs_max = 2 * threads;
+
+	// First try to keep the maximum Block size and reduce only the
+	// number of output buffers. The memory usage is linear in
+	// the number of buffers.
+	const uint64_t fixed = get_memusage(budget, threads, 0,
+			budget->block_size_max);
+	if (fixed < budget->memlimit) {
+		const uint64_t per_job = lzma_outq_memusage_bufs(
+				lzma_block_buffer_bound64(
+					budget->block_size_max), 1);
+		const uint64_t n = (budget->memlimit - fixed) / per_job;
+		if (n >= jobs_min) {
+			*jobs = n < jobs_max ? (uint32_t)(n) : jobs_max;
+			*block_size = budget->block_size_max;
+			return true;
+		}
+	}
+
+	// Find the biggest Block size that fits with the minimum number
+	// of output buffers.
+	uint64_t lo = budget->block_size_min;
+	uint64_t hi = budget->block_size_max;
+	if (get_memusage(budget, threads, jobs_min, lo) > budget->memlimit)
+		return false;
+
+	while (lo < hi) {
+		const uint64_t mid = lo + (hi - lo + 1) / 2;
+		if (get_memusage(budget, threads, jobs_min, mid)
+				<= budget->memlimit)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	*jobs = jobs_min;
+	*block_size = lo;
+	return true;
+}
+
+
+/// Choose the settings for LZMA_MT_ADAPTIVE when at most threads_wanted
+/// threads are useful. Threads are dropped only when the minimum Block
+/// size doesn't fit in the budget.
+static void
+adaptive_choose(const mt_budget *budget, uint32_t threads_wanted,
+		uint32_t *threads, uint32_t *jobs, uint64_t *block_size)
+{
+	for (uint32_t i = threads_wanted; i > 0; --i) {
+		if (adaptive_pick(budget, i, jobs, block_size)) {
+			*threads = i;
+			return;
+		}
+	}
+
+	// Like with the decoder, memlimit_threading never makes encoding
+	// fail. Use the smallest settings even if they exceed the limit.
+	*threads = 1;
+	*jobs = 2;
+	*block_size = budget->block_size_min;
+	return;
+}
+
+
+/// Use the given settings for the Blocks that haven't been started yet.
+static void
+set_config(lzma_stream_coder *coder, const lzma_allocator *allocator,
+		uint32_t threads, uint32_t jobs, uint64_t block_size)
+{
+	assert(block_size <= coder->budget.block_size_max);
+
+	coder->threads_active = threads;
+	coder->block_size = (size_t)(block_size);
+	coder->outbuf_alloc_size
+			= (size_t)(lzma_block_buffer_bound64(block_size));
+	lzma_outq_set_bufs_limit(&coder->outq, allocator, jobs);
+	return;
+}
+
+
+/// Adjust the settings with LZMA_MT_ADAPTIVE after a worker thread has
+/// got a full Block of input. By then the thread had compressed in_done
+/// bytes of the in_size bytes, so about in_size / in_done threads are
+/// needed to keep up with the speed at which the application provides
+/// the input. If fewer threads than threads_active would be enough,
+/// their memory is better spent on bigger Blocks.
+static void
+adaptive_update(lzma_stream_coder *coder, const lzma_allocator *allocator,
+		uint64_t in_done, uint64_t in_size)
+{
+	uint32_t wanted = coder->budget.threads_max;
+	if (in_done > 0 && in_size / in_done < wanted)
+		wanted = (uint32_t)((in_size + in_done - 1) / in_done);
+
+	if (wanted < coder->threads_active) {
+		// Don't reduce the number of threads because of
+		// one Block; the speed of the input can vary a lot.
+		if (coder->shrink_count == 0
+				|| wanted > coder->shrink_threads)
+			coder->shrink_threads = wanted;
+
+		if (++coder->shrink_count < ADAPTIVE_SHRINK_BLOCKS)
+			return;
+
+		wanted = coder->shrink_threads;
+	}
+
+	coder->shrink_count = 0;
+
+	if (wanted == coder->threads_active)
+		return;
+
+	uint32_t threads;
+	uint32_t jobs;
+	uint64_t block_size;
+	adaptive_choose(&coder->budget, wanted, &threads, &jobs, &block_size);
+
+	if (threads != coder->threads_active
+			|| block_size != coder->block_size)
+		set_config(coder, allocator, threads, jobs, block_size);
+
+	return;
+}
+
+
+/// Get the number of Blocks that are being encoded. This includes
+/// coder->thr. coder->mutex must be locked.
+static uint32_t
+get_blocks_in_progress(const lzma_stream_coder *coder)
+{
+	uint32_t count = 0;
+
+	for (const lzma_outbuf *buf = coder->outq.head; buf != NULL;
+			buf = buf->next)
+		if (!buf->finished)
+			++count;
+
+	return count;
+}
+
+
+/// Return true if no more Blocks may be started before one of the
+/// running Blocks has finished. coder->mutex must be locked.
+static bool
+threads_all_busy(const lzma_stream_coder *coder)
+{
+	if (coder->threads_free == NULL)
+		return true;
+
+	return coder->adaptive && get_blocks_in_progress(coder)
+			>= coder->threads_active;
+}
+
+
+/// Free the input buffers of the idle threads if their size differs
+/// from the current Block size. When the Block size has been increased,
+/// this keeps the unused threads from holding on to memory.
+/// coder->mutex must be locked.
+static void
+free_idle_buffers(lzma_stream_coder *coder, const lzma_allocator *allocator)
+{
+	for (worker_thread *thr = coder->threads_free; thr != NULL;
+			thr = thr->next) {
+		if (thr->block_size != coder->block_size) {
+			lzma_free(thr->in, allocator);
+			thr->in = NULL;
+			thr->block_size = 0;
+		}
+	}
+
+	return;
+}
+
+
 static lzma_ret
 get_thread(lzma_stream_coder *coder, const lzma_allocator *allocator)
 {
@@ -556,14 +848,27 @@ get_thread(lzma_stream_coder *coder, const lzma_allocator *allocator)
 		return_if_error(lzma_filters_copy(
 			coder->filters, coder->filters_cache, allocator));
 
+	// With LZMA_MT_ADAPTIVE, no more than threads_active Blocks
+	// may be encoded at the same time.
+	bool may_start = true;
+
 	// If there is a free structure on the stack, use it.
 	mythread_sync(coder->mutex) {
-		if (coder->threads_free != NULL) {
+		if (coder->adaptive) {
+			may_start = get_blocks_in_progress(coder)
+					< coder->threads_active;
+			free_idle_buffers(coder, allocator);
+		}
+
+		if (may_start && coder->threads_free != NULL) {
 			coder->thr = coder->threads_free;
 			coder->threads_free = coder->threads_free->next;
 		}
 	}
 
+	if (!may_start)
+		return LZMA_OK;
+
 	if (coder->thr == NULL) {
 		// If there are no uninitialized structures left, return.
 		if (coder->threads_initialized == coder->threads_max)
@@ -571,6 +876,28 @@ get_thread(lzma_stream_coder *coder, const lzma_allocator *allocator)
 
 		// Initialize a new thread.
 		return_if_error(initialize_new_thread(coder, allocator));
+
+	} else if (coder->thr->block_size != coder->block_size) {
+		// The Block size has changed since the input buffer of
+		// this thread was allocated. The thread is idle so
+		// the buffer can be replaced.
+		lzma_free(coder->thr->in, allocator);
+		coder->thr->in = lzma_alloc(coder->block_size, allocator);
+		if (coder->thr->in == NULL) {
+			coder->thr->block_size = 0;
+
+			// Put the thread back to the stack so that it
+			// can be used again after the error.
+			mythread_sync(coder->mutex) {
+				coder->thr->next = coder->threads_free;
+				coder->threads_free = coder->thr;
+			}
+
+			coder->thr = NULL;
+			return LZMA_MEM_ERROR;
+		}
+
+		coder->thr->block_size = coder->block_size;
 	}
 
 	// Reset the parts of the thread state that have to be done
@@ -612,7 +939,7 @@ stream_encode_in(lzma_stream_coder *coder, const lzma_allocator *allocator,
 		// Copy the input data to thread's buffer.
 		size_t thr_in_size = coder->thr->in_size;
 		lzma_bufcpy(in, in_pos, in_size, coder->thr->in,
-				&thr_in_size, coder->block_size);
+				&thr_in_size, coder->thr->block_size);
 
 		// Tell the Block encoder to finish if
 		//  - it has got block_size bytes of input; or
@@ -620,11 +947,15 @@ stream_encode_in(lzma_stream_coder *coder, const lzma_allocator *allocator,
 		//    or LZMA_FULL_BARRIER was used.
 		//
 		// TODO: LZMA_SYNC_FLUSH and LZMA_SYNC_BARRIER.
-		const bool finish = thr_in_size == coder->block_size
+		const bool full = thr_in_size == coder->thr->block_size;
+		const bool finish = full
 				|| (*in_pos == in_size && action != LZMA_RUN);
 
 		bool block_error = false;
 
+		// How much the thread had compressed by now
+		uint64_t thr_in_done = 0;
+
 		mythread_sync(coder->thr->mutex) {
 			if (coder->thr->state == THR_IDLE) {
 				// Something has gone wrong with the Block
@@ -635,6 +966,7 @@ stream_encode_in(lzma_stream_coder *coder, const lzma_allocator *allocator,
 				// Tell the Block encoder its new amount
 				// of input and update the state if needed.
 				coder->thr->in_size = thr_in_size;
+				thr_in_done = coder->thr->progress_in;
 
 				if (finish)
 					coder->thr->state = THR_FINISH;
@@ -653,8 +985,13 @@ stream_encode_in(lzma_stream_coder *coder, const lzma_allocator *allocator,
 			return ret;
 		}
 
-		if (finish)
+		if (finish) {
 			coder->thr = NULL;
+
+			if (coder->adaptive && full)
+				adaptive_update(coder, allocator,
+						thr_in_done, thr_in_size);
+		}
 	}
 
 	return LZMA_OK;
@@ -694,7 +1031,7 @@ wait_for_work(lzma_stream_coder *coder, mythread_condtime *wait_abs,
 		//  - Data ready to be read from the output queue.
 		//  - A worker thread indicates an error.
 		//  - Time out occurs.
-		while ((!has_input || coder->threads_free == NULL
+		while ((!has_input || threads_all_busy(coder)
 					|| !lzma_outq_has_buf(&coder->outq))
 				&& !lzma_outq_is_readable(&coder->outq)
 				&& coder->thread_error == LZMA_OK
@@ -933,7 +1270,8 @@ stream_encoder_mt_update(void *coder_ptr, const lzma_allocator *allocator,
 
 	// Check if the filter chain seems mostly valid. See the comment
 	// in stream_encoder_mt_init().
-	if (lzma_raw_encoder_memusage(filters) == UINT64_MAX)
+	const uint64_t filters_memusage = lzma_raw_encoder_memusage(filters);
+	if (filters_memusage == UINT64_MAX)
 		return LZMA_OPTIONS_ERROR;
 
 	// Make a copy to a temporary buffer first. This way the encoder
@@ -948,6 +1286,18 @@ stream_encoder_mt_update(void *coder_ptr, const lzma_allocator *allocator,
 	// Copy the new filter chain in place.
 	memcpy(coder->filters, temp, sizeof(temp));
 
+	// The new filters may need a different amount of memory.
+	coder->budget.filters_memusage = filters_memusage;
+	if (coder->adaptive) {
+		uint32_t threads;
+		uint32_t jobs;
+		uint64_t block_size;
+		adaptive_choose(&coder->budget, coder->threads_active,
+				&threads, &jobs, &block_size);
+		set_config(coder, allocator, threads, jobs, block_size);
+		coder->shrink_count = 0;
+	}
+
 	return LZMA_OK;
 }
 
@@ -963,7 +1313,7 @@ get_options(const lzma_mt *options, lzma_options_easy *opt_easy,
 	if (options == NULL)
 		return LZMA_PROG_ERROR;
 
-	if (options->flags != 0 || options->threads == 0
+	if ((options->flags & ~LZMA_MT_ADAPTIVE) != 0 || options->threads == 0
 			|| options->threads > LZMA_THREADS_MAX)
 		return LZMA_OPTIONS_ERROR;
 
@@ -1002,6 +1352,51 @@ get_options(const lzma_mt *options, lzma_options_easy *opt_easy,
 }
 
 
+/// Set up the memory budget. Without LZMA_MT_ADAPTIVE only
+/// the filters_memusage and threads_max members matter.
+static lzma_ret
+get_budget(const lzma_mt *options, const lzma_filter *filters,
+		uint64_t block_size, mt_budget *budget)
+{
+	// The memory usage calculation verifies the filter chain
+	// as a side effect.
+	budget->filters_memusage = lzma_raw_encoder_memusage(filters);
+	if (budget->filters_memusage == UINT64_MAX)
+		return LZMA_OPTIONS_ERROR;
+
+	budget->memlimit = options->memlimit_threading;
+	budget->block_size_max = block_size;
+	budget->threads_max = options->threads;
+
+	budget->block_size_min = my_max(
+			block_size / ADAPTIVE_BLOCK_SIZE_DIV,
+			ADAPTIVE_BLOCK_SIZE_MIN);
+	if (budget->block_size_min > block_size)
+		budget->block_size_min = block_size;
+
+	return LZMA_OK;
+}
+
+
+/// Get the initial number of threads, number of output buffers,
+/// and the Block size.
+static void
+get_config(const lzma_mt *options, const mt_budget *budget,
+		uint32_t *threads, uint32_t *jobs, uint64_t *block_size)
+{
+	if (options->flags & LZMA_MT_ADAPTIVE) {
+		adaptive_choose(budget, budget->threads_max,
+				threads, jobs, block_size);
+	} else {
+		*threads = budget->threads_max;
+		*jobs = 2 * budget->threads_max;
+		*block_size = budget->block_size_max;
+	}
+
+	return;
+}
+
+
 static void
 get_progress(void *coder_ptr, uint64_t *progress_in, uint64_t *progress_out)
 {
@@ -1051,8 +1446,8 @@ stream_encoder_mt_init(lzma_next_coder *next, const lzma_allocator *allocator,
 	// a side effect so we take advantage of that. It's not a perfect
 	// check though as raw encoder allows LZMA1 too but such problems
 	// will be caught eventually with Block Header encoder.
-	if (lzma_raw_encoder_memusage(filters) == UINT64_MAX)
-		return LZMA_OPTIONS_ERROR;
+	mt_budget budget;
+	return_if_error(get_budget(options, filters, block_size, &budget));
 
 	// Validate the Check ID.
 	if ((unsigned int)(options->check) > LZMA_CHECK_ID_MAX)
@@ -1104,8 +1499,9 @@ stream_encoder_mt_init(lzma_next_coder *next, const lzma_allocator *allocator,
 
 	// Basic initializations
 	coder->sequence = SEQ_STREAM_HEADER;
-	coder->block_size = (size_t)(block_size);
-	coder->outbuf_alloc_size = (size_t)(outbuf_size_max);
+	coder->adaptive = (options->flags & LZMA_MT_ADAPTIVE) != 0;
+	coder->budget = budget;
+	coder->shrink_count = 0;
 	coder->thread_error = LZMA_OK;
 	coder->thr = NULL;
 
@@ -1137,6 +1533,12 @@ stream_encoder_mt_init(lzma_next_coder *next, const lzma_allocator *allocator,
 	return_if_error(lzma_outq_init(&coder->outq, allocator,
 			options->threads));
 
+	// Threads, output buffers, and Block size
+	uint32_t threads;
+	uint32_t jobs;
+	get_config(options, &budget, &threads, &jobs, &block_size);
+	set_config(coder, allocator, threads, jobs, block_size);
+
 	// Timeout
 	coder->timeout = options->timeout;
 
@@ -1242,39 +1644,38 @@ lzma_stream_encoder_mt_memusage(const lzma_mt *options)
 			&outbuf_size_max) != LZMA_OK)
 		return UINT64_MAX;
 
-	// Memory usage of the input buffers
-	const uint64_t inbuf_memusage = options->threads * block_size;
-
-	// Memory usage of the filter encoders
-	uint64_t filters_memusage = lzma_raw_encoder_memusage(filters);
-	if (filters_memusage == UINT64_MAX)
+	mt_budget budget;
+	if (get_budget(options, filters, block_size, &budget) != LZMA_OK)
 		return UINT64_MAX;
 
-	filters_memusage *= options->threads;
+	uint32_t threads;
+	uint32_t jobs;
+	get_config(options, &budget, &threads, &jobs, &block_size);
 
-	// Memory usage of the output queue
-	const uint64_t outq_memusage = lzma_outq_memusage(
-			outbuf_size_max, options->threads);
-	if (outq_memusage == UINT64_MAX)
-		return UINT64_MAX;
-
-	// Sum them with overflow checking.
-	uint64_t total_memusage = LZMA_MEMUSAGE_BASE
-			+ sizeof(lzma_stream_coder)
-			+ options->threads * sizeof(worker_thread);
-
-	if (UINT64_MAX - total_memusage < inbuf_memusage)
-		return UINT64_MAX;
+	return get_memusage(&budget, threads, jobs, block_size);
+}
 
-	total_memusage += inbuf_memusage;
 
-	if (UINT64_MAX - total_memusage < filters_memusage)
-		return UINT64_MAX;
+extern LZMA_API(lzma_ret)
+lzma_stream_encoder_mt_get(const lzma_stream *strm, lzma_mt *options)
+{
+	if (strm == NULL || strm->internal == NULL || options == NULL
+			|| strm->internal->next.init
+				!= (uintptr_t)(&stream_encoder_mt_init))
+		return LZMA_PROG_ERROR;
 
-	total_memusage += filters_memusage;
+	const lzma_stream_coder *coder = strm->internal->next.coder;
 
-	if (UINT64_MAX - total_memusage < outq_memusage)
-		return UINT64_MAX;
+	options->flags = coder->adaptive ? LZMA_MT_ADAPTIVE : 0;
+	options->threads = coder->threads_active;
+	options->jobs = coder->outq.bufs_limit;
+	options->block_size = coder->block_size;
+	options->timeout = coder->timeout;
+	options->check = coder->stream_flags.check;
+	options->memlimit_threading = coder->budget.memlimit;
+	options->memusage = get_memusage(&coder->budget,
+			coder->threads_active, coder->outq.bufs_limit,
+			coder->block_size);
 
-	return total_memusage + outq_memusage;
+	return LZMA_OK;
 }
@@ -1048,7 +1048,10 @@ strfy_filter(lzma_str *dest, const char *delimiter,
 			= (const char *)filter_options + optmap[i].offset;
 		switch (optmap[i].type) {
 			case OPTMAP_TYPE_LZMA_MODE:
-				v = *(const lzma_mode *)ptr;
+				// LZMA_MODE_MF_THREADS doesn't affect
+				// the output and has no string form.
+				v = *(const lzma_mode *)ptr
+						& ~(uint32_t)LZMA_MODE_MF_THREADS;
 				break;
 
 			case OPTMAP_TYPE_LZMA_MATCH_FINDER:
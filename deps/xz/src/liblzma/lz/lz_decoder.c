@@ -23,6 +23,13 @@ typedef struct {
 	/// Dictionary (history buffer)
 	lzma_dict dict;
 
+	/// Allocated size of dict.buf. When the decoder is reinitialized
+	/// (the lzma_stream is reused), the old buffer is kept if it is
+	/// big enough for the new dictionary. Then dict.size is smaller
+	/// than this so that distances are still validated against the
+	/// dictionary size from the headers.
+	size_t dict_alloc_size;
+
 	/// The actual LZ-based decoder e.g. LZMA
 	lzma_lz_decoder lz;
 
@@ -236,6 +243,7 @@ lzma_lz_decoder_init(lzma_next_coder *next, const lzma_allocator *allocator,
 
 		coder->dict.buf = NULL;
 		coder->dict.size = 0;
+		coder->dict_alloc_size = 0;
 		coder->lz = LZMA_LZ_DECODER_INIT;
 		coder->next = LZMA_NEXT_CODER_INIT;
 	}
@@ -274,19 +282,27 @@ lzma_lz_decoder_init(lzma_next_coder *next, const lzma_allocator *allocator,
 	const size_t alloc_size
 			= lz_options.dict_size + 2 * LZ_DICT_REPEAT_MAX;
 
-	// Allocate and initialize the dictionary.
-	if (coder->dict.size != alloc_size) {
+	// Allocate the dictionary unless the buffer from the previous
+	// initialization is big enough. Reusing it avoids allocating and
+	// page faulting a possibly multi-megabyte buffer for every Stream
+	// when an application decodes many small Streams with the same
+	// lzma_stream. The buffer keeps its old contents but
+	// lz_decoder_reset() below makes them unreachable.
+	if (coder->dict_alloc_size < alloc_size) {
 		lzma_free(coder->dict.buf, allocator);
+		coder->dict_alloc_size = 0;
 		coder->dict.buf = lzma_alloc(alloc_size, allocator);
 		if (coder->dict.buf == NULL)
 			return LZMA_MEM_ERROR;
 
-		// NOTE: Yes, alloc_size, not lz_options.dict_size. The way
-		// coder->dict.full is updated will take care that we will
-		// still reject distances larger than lz_options.dict_size.
-		coder->dict.size = alloc_size;
+		coder->dict_alloc_size = alloc_size;
 	}
 
+	// NOTE: Yes, alloc_size, not lz_options.dict_size. The way
+	// coder->dict.full is updated will take care that we will
+	// still reject distances larger than lz_options.dict_size.
+	coder->dict.size = alloc_size;
+
 	lz_decoder_reset(next->coder);
 
 	// Use the preset dictionary if it was given to us.
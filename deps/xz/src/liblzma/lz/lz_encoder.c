@@ -57,6 +57,12 @@ move_window(lzma_mf *mf)
 
 	assert(move_offset + move_size <= mf->size);
 
+#ifdef MYTHREAD_ENABLED
+	// The helper thread of the match finder reads the buffer.
+	if (mf->mt != NULL)
+		lzma_mf_mt_move(mf, move_offset);
+#endif
+
 	memmove(mf->buffer, mf->buffer + move_offset, move_size);
 
 	mf->offset += move_offset;
@@ -151,6 +157,13 @@ fill_window(lzma_coder *coder, const lzma_allocator *allocator,
 		coder->mf.skip(&coder->mf, pending);
 	}
 
+#ifdef MYTHREAD_ENABLED
+	// Let the helper thread of the match finder continue
+	// with the new input.
+	if (coder->mf.mt != NULL)
+		lzma_mf_mt_resume(&coder->mf);
+#endif
+
 	return ret;
 }
 
@@ -478,8 +491,15 @@ lzma_lz_encoder_memusage(const lzma_lz_options *lz_options)
 		return UINT64_MAX;
 
 	// Calculate the memory usage.
-	return ((uint64_t)(mf.hash_count) + mf.sons_count) * sizeof(uint32_t)
-			+ mf.size + sizeof(lzma_coder);
+	uint64_t memusage = ((uint64_t)(mf.hash_count) + mf.sons_count)
+			* sizeof(uint32_t) + mf.size + sizeof(lzma_coder);
+
+#ifdef MYTHREAD_ENABLED
+	if (lz_options->mf_threads > 0)
+		memusage += lzma_mf_mt_memusage();
+#endif
+
+	return memusage;
 }
 
 
@@ -490,6 +510,10 @@ lz_encoder_end(void *coder_ptr, const lzma_allocator *allocator)
 
 	lzma_next_end(&coder->next, allocator);
 
+#ifdef MYTHREAD_ENABLED
+	lzma_mf_mt_end(&coder->mf, allocator);
+#endif
+
 	lzma_free(coder->mf.son, allocator);
 	lzma_free(coder->mf.hash, allocator);
 	lzma_free(coder->mf.buffer, allocator);
@@ -578,10 +602,18 @@ lzma_lz_encoder_init(lzma_next_coder *next, const lzma_allocator *allocator,
 		coder->mf.son = NULL;
 		coder->mf.hash_count = 0;
 		coder->mf.sons_count = 0;
+		coder->mf.mt = NULL;
 
 		coder->next = LZMA_NEXT_CODER_INIT;
 	}
 
+#ifdef MYTHREAD_ENABLED
+	// The helper thread of the match finder must not touch
+	// the buffers while they are reallocated and reset.
+	if (coder->mf.mt != NULL)
+		lzma_mf_mt_reset(&coder->mf);
+#endif
+
 	// Initialize the LZ-based encoder.
 	lzma_lz_options lz_options;
 	return_if_error(lz_init(&coder->lz, allocator,
@@ -597,6 +629,16 @@ lzma_lz_encoder_init(lzma_next_coder *next, const lzma_allocator *allocator,
 	if (lz_encoder_init(&coder->mf, allocator, &lz_options))
 		return LZMA_MEM_ERROR;
 
+#ifdef MYTHREAD_ENABLED
+	// Start or stop the helper thread of the match finder.
+	if (lz_options.mf_threads > 0) {
+		if (lzma_mf_mt_init(&coder->mf, allocator))
+			return LZMA_MEM_ERROR;
+	} else {
+		lzma_mf_mt_end(&coder->mf, allocator);
+	}
+#endif
+
 	// Initialize the next filter in the chain, if any.
 	return lzma_next_filter_init(&coder->next, allocator, filters + 1);
 }
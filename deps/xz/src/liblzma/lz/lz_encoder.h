@@ -32,6 +32,10 @@ typedef struct {
 } lzma_match;
 
 
+/// Match finder running in a helper thread (see lz_encoder_mt.c)
+typedef struct lzma_mf_mt_s lzma_mf_mt;
+
+
 typedef struct lzma_mf_s lzma_mf;
 struct lzma_mf_s {
 	///////////////
@@ -130,6 +134,12 @@ struct lzma_mf_s {
 
 	/// Number of elements in son[]
 	uint32_t sons_count;
+
+	/// Helper thread that runs the match finder ahead of the LZ-based
+	/// encoder, or NULL if the match finder runs in the calling thread.
+	/// While the helper thread is in use, find() and skip() hand over
+	/// the matches it has found instead of searching themselves.
+	lzma_mf_mt *mt;
 };
 
 
@@ -169,6 +179,10 @@ typedef struct {
 	/// the dict_size sized tail of the preset_dict will be used.
 	uint32_t preset_dict_size;
 
+	/// Number of helper threads for the match finder. Currently
+	/// at most one is used.
+	uint32_t mf_threads;
+
 } lzma_lz_options;
 
 
@@ -349,4 +363,13 @@ extern void lzma_mf_bt3_skip(lzma_mf *dict, uint32_t amount);
 extern uint32_t lzma_mf_bt4_find(lzma_mf *dict, lzma_match *matches);
 extern void lzma_mf_bt4_skip(lzma_mf *dict, uint32_t amount);
 
+#ifdef MYTHREAD_ENABLED
+extern uint64_t lzma_mf_mt_memusage(void);
+extern bool lzma_mf_mt_init(lzma_mf *mf, const lzma_allocator *allocator);
+extern void lzma_mf_mt_reset(lzma_mf *mf);
+extern void lzma_mf_mt_move(lzma_mf *mf, uint32_t move_offset);
+extern void lzma_mf_mt_resume(lzma_mf *mf);
+extern void lzma_mf_mt_end(lzma_mf *mf, const lzma_allocator *allocator);
+#endif
+
 #endif
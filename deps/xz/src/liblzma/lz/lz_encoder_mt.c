@@ -0,0 +1,402 @@
+// SPDX-License-Identifier: 0BSD
+
+///////////////////////////////////////////////////////////////////////////////
+//
+/// \file       lz_encoder_mt.c
+/// \brief      Match finder running in a helper thread
+///
+/// The hash chain and binary tree match finders update their hash tables
+/// and trees in the same way no matter if a byte is run through find()
+/// or skip(). Thus a helper thread can run find() for every byte ahead of
+/// the LZ-based encoder and queue the matches, and the encoder gets the
+/// same matches it would have found itself. Skipping only discards the
+/// queued matches.
+///
+/// The helper thread works on its own copy of lzma_mf. It only runs the
+/// match finder at positions that have at least nice_len bytes (and the
+/// bytes read by lzma_memcmplen()) of input available, because only then
+/// the result doesn't depend on how much input there is or on flushing.
+/// When the encoder needs matches past the positions that the helper
+/// thread has done, the state of the match finder is copied back and
+/// the encoder runs the match finder itself until more input arrives.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "lz_encoder.h"
+#include "memcmplen.h"
+
+
+/// Number of entries in a block of queued matches
+#define MF_MT_BLOCK_SIZE (UINT32_C(1) << 13)
+
+/// Number of blocks of queued matches
+#define MF_MT_BLOCKS 32
+
+
+/// Queued matches for consecutive positions. The matches of each
+/// position are preceded by an entry whose len is the number of matches.
+typedef struct {
+	uint32_t size;
+	lzma_match matches[MF_MT_BLOCK_SIZE];
+} mf_mt_block;
+
+
+struct lzma_mf_mt_s {
+	/// Match finder state of the helper thread. Its read_pos is ahead
+	/// of the read_pos of the encoder by the number of queued positions.
+	lzma_mf mf;
+
+	/// The actual find and skip functions of the match finder
+	uint32_t (*find)(lzma_mf *mf, lzma_match *matches);
+	void (*skip)(lzma_mf *mf, uint32_t num);
+
+	mythread thread_id;
+	mythread_mutex mutex;
+	mythread_cond cond;
+
+	/// True when the helper thread owns the state of the match finder,
+	/// that is, mf above is in use instead of the lzma_mf of the
+	/// encoder. Only the encoder thread changes this.
+	bool active;
+
+	/// True while the helper thread is running the match finder
+	bool working;
+
+	/// True when the encoder thread needs the helper thread to not
+	/// start working (the window is being moved or the state reset).
+	bool paused;
+
+	/// True when the helper thread should exit
+	bool exit;
+
+	/// The helper thread may run the match finder at positions
+	/// before limit.
+	uint32_t limit;
+
+	/// Value of write_pos for the helper thread
+	uint32_t write_pos;
+
+	/// Position of the helper thread after the last filled block
+	uint32_t pos;
+
+	/// Number of blocks filled and released (modulo 2^32)
+	uint32_t produced;
+	uint32_t consumed;
+
+	/// Queued matches left in the block being read by the encoder.
+	/// These are used only by the encoder thread.
+	const lzma_match *next;
+	const lzma_match *end;
+	bool have_block;
+
+	mf_mt_block blocks[MF_MT_BLOCKS];
+};
+
+
+static MYTHREAD_RET_TYPE
+mf_mt_thread(void *mt_ptr)
+{
+	lzma_mf_mt *mt = mt_ptr;
+
+	while (true) {
+		mf_mt_block *block = NULL;
+		uint32_t limit = 0;
+
+		mythread_sync(mt->mutex) {
+			while (!mt->exit && (mt->paused || !mt->active
+					|| mt->mf.read_pos >= mt->limit
+					|| mt->produced - mt->consumed
+						== MF_MT_BLOCKS))
+				mythread_cond_wait(&mt->cond, &mt->mutex);
+
+			if (mt->exit)
+				break;
+
+			mt->working = true;
+			mt->mf.write_pos = mt->write_pos;
+			limit = mt->limit;
+			block = &mt->blocks[mt->produced % MF_MT_BLOCKS];
+		}
+
+		if (block == NULL)
+			break;
+
+		// A position can have at most nice_len matches since
+		// the lengths of the matches are increasing.
+		const uint32_t room = MF_MT_BLOCK_SIZE - 1 - mt->mf.nice_len;
+		uint32_t size = 0;
+
+		do {
+			lzma_match *count = block->matches + size;
+			count->len = mt->find(&mt->mf, count + 1);
+			size += 1 + count->len;
+		} while (mt->mf.read_pos < limit && size <= room);
+
+		block->size = size;
+
+		mythread_sync(mt->mutex) {
+			++mt->produced;
+			mt->pos = mt->mf.read_pos;
+			mt->working = false;
+			mythread_cond_signal(&mt->cond);
+		}
+	}
+
+	return MYTHREAD_RET_VALUE;
+}
+
+
+/// Get the next block of queued matches. Returns false if there are no
+/// more queued matches, in which case the state of the match finder has
+/// been copied back to *mf and the encoder has to run the match finder
+/// itself.
+static bool
+mf_mt_next_block(lzma_mf *mf)
+{
+	lzma_mf_mt *mt = mf->mt;
+
+	if (!mt->active)
+		return false;
+
+	bool found = false;
+
+	mythread_sync(mt->mutex) {
+		if (mt->have_block) {
+			mt->have_block = false;
+			++mt->consumed;
+			mythread_cond_signal(&mt->cond);
+		}
+
+		while (mt->produced == mt->consumed && (mt->working
+				|| (!mt->paused && mt->pos < mt->limit)))
+			mythread_cond_wait(&mt->cond, &mt->mutex);
+
+		if (mt->produced != mt->consumed) {
+			const mf_mt_block *block = &mt->blocks[
+					mt->consumed % MF_MT_BLOCKS];
+			mt->next = block->matches;
+			mt->end = block->matches + block->size;
+			mt->have_block = true;
+			found = true;
+			break;
+		}
+
+		// All queued positions have been read, so the read_pos
+		// of both states is the same.
+		assert(mf->read_pos == mt->mf.read_pos);
+		mf->cyclic_pos = mt->mf.cyclic_pos;
+		mf->offset = mt->mf.offset;
+		mf->pending = mt->mf.pending;
+		mt->active = false;
+	}
+
+	return found;
+}
+
+
+static uint32_t
+mf_mt_find(lzma_mf *mf, lzma_match *matches)
+{
+	lzma_mf_mt *mt = mf->mt;
+
+	if (mt->next == mt->end && !mf_mt_next_block(mf))
+		return mt->find(mf, matches);
+
+	const uint32_t count = mt->next->len;
+	memcpy(matches, mt->next + 1, count * sizeof(lzma_match));
+	mt->next += 1 + count;
+	++mf->read_pos;
+
+	return count;
+}
+
+
+static void
+mf_mt_skip(lzma_mf *mf, uint32_t amount)
+{
+	lzma_mf_mt *mt = mf->mt;
+
+	do {
+		if (mt->next == mt->end && !mf_mt_next_block(mf)) {
+			mt->skip(mf, amount);
+			return;
+		}
+
+		mt->next += 1 + mt->next->len;
+		++mf->read_pos;
+	} while (--amount != 0);
+}
+
+
+/// Wait until the helper thread isn't working and keep it that way
+/// until lzma_mf_mt_resume().
+static void
+mf_mt_pause(lzma_mf_mt *mt)
+{
+	mythread_sync(mt->mutex) {
+		mt->paused = true;
+		while (mt->working)
+			mythread_cond_wait(&mt->cond, &mt->mutex);
+	}
+}
+
+
+extern uint64_t
+lzma_mf_mt_memusage(void)
+{
+	return sizeof(lzma_mf_mt);
+}
+
+
+extern bool
+lzma_mf_mt_init(lzma_mf *mf, const lzma_allocator *allocator)
+{
+	lzma_mf_mt *mt = mf->mt;
+
+	if (mt == NULL) {
+		mt = lzma_alloc(sizeof(lzma_mf_mt), allocator);
+		if (mt == NULL)
+			return true;
+
+		if (mythread_mutex_init(&mt->mutex))
+			goto error_mutex;
+
+		if (mythread_cond_init(&mt->cond))
+			goto error_cond;
+
+		mt->active = false;
+		mt->working = false;
+		mt->paused = true;
+		mt->exit = false;
+		mt->produced = 0;
+		mt->consumed = 0;
+		mt->next = NULL;
+		mt->end = NULL;
+		mt->have_block = false;
+
+		if (mythread_create(&mt->thread_id, &mf_mt_thread, mt))
+			goto error_thread;
+
+		mf->mt = mt;
+	}
+
+	// lz_encoder_prepare() has set the functions of the match finder.
+	mt->find = mf->find;
+	mt->skip = mf->skip;
+	mf->find = &mf_mt_find;
+	mf->skip = &mf_mt_skip;
+
+	return false;
+
+error_thread:
+	mythread_cond_destroy(&mt->cond);
+
+error_cond:
+	mythread_mutex_destroy(&mt->mutex);
+
+error_mutex:
+	lzma_free(mt, allocator);
+	return true;
+}
+
+
+extern void
+lzma_mf_mt_reset(lzma_mf *mf)
+{
+	lzma_mf_mt *mt = mf->mt;
+
+	mf_mt_pause(mt);
+
+	// The encoder is being reinitialized so the queued matches and
+	// the state of the helper thread can be dropped.
+	mythread_sync(mt->mutex) {
+		mt->active = false;
+		mt->consumed = mt->produced;
+	}
+
+	mt->next = NULL;
+	mt->end = NULL;
+	mt->have_block = false;
+	return;
+}
+
+
+extern void
+lzma_mf_mt_move(lzma_mf *mf, uint32_t move_offset)
+{
+	lzma_mf_mt *mt = mf->mt;
+
+	mf_mt_pause(mt);
+
+	if (mt->active) {
+		mt->mf.offset += move_offset;
+		mt->mf.read_pos -= move_offset;
+		mt->mf.write_pos -= move_offset;
+		mt->pos -= move_offset;
+		mt->limit -= move_offset;
+		mt->write_pos -= move_offset;
+	}
+
+	return;
+}
+
+
+extern void
+lzma_mf_mt_resume(lzma_mf *mf)
+{
+	lzma_mf_mt *mt = mf->mt;
+
+	// The helper thread must not read the bytes that the next call
+	// to fill_window() may write, including the bytes past nice_len
+	// that lzma_memcmplen() may read.
+	const uint32_t reserve = mf->nice_len + LZMA_MEMCMPLEN_EXTRA;
+	const uint32_t limit = mf->write_pos > reserve
+			? mf->write_pos - reserve : 0;
+
+	mythread_sync(mt->mutex) {
+		// The pending bytes are hashed by the encoder thread
+		// when new input arrives, so the helper thread can take
+		// the match finder over only when there are none.
+		if (!mt->active && mf->pending == 0 && limit > mf->read_pos) {
+			mt->mf = *mf;
+			mt->mf.find = mt->find;
+			mt->mf.skip = mt->skip;
+			mt->mf.mt = NULL;
+			mt->mf.action = LZMA_RUN;
+			mt->pos = mf->read_pos;
+			mt->active = true;
+		}
+
+		if (mt->active) {
+			mt->limit = limit;
+			mt->write_pos = mf->write_pos;
+		}
+
+		mt->paused = false;
+		mythread_cond_signal(&mt->cond);
+	}
+
+	return;
+}
+
+
+extern void
+lzma_mf_mt_end(lzma_mf *mf, const lzma_allocator *allocator)
+{
+	lzma_mf_mt *mt = mf->mt;
+	if (mt == NULL)
+		return;
+
+	mythread_sync(mt->mutex) {
+		mt->exit = true;
+		mythread_cond_signal(&mt->cond);
+	}
+
+	mythread_join(mt->thread_id);
+	mythread_cond_destroy(&mt->cond);
+	mythread_mutex_destroy(&mt->mutex);
+	lzma_free(mt, allocator);
+
+	mf->mt = NULL;
+	return;
+}
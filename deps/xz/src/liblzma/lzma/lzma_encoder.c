@@ -478,8 +478,8 @@ is_options_valid(const lzma_options_lzma *options)
 	return is_lclppb_valid(options)
 			&& options->nice_len >= MATCH_LEN_MIN
 			&& options->nice_len <= MATCH_LEN_MAX
-			&& (options->mode == LZMA_MODE_FAST
-				|| options->mode == LZMA_MODE_NORMAL);
+			&& lzma_mode_is_supported(
+				options->mode & ~LZMA_MODE_MF_THREADS);
 }
 
 
@@ -498,6 +498,8 @@ set_lz_options(lzma_lz_options *lz_options, const lzma_options_lzma *options)
 	lz_options->depth = options->depth;
 	lz_options->preset_dict = options->preset_dict;
 	lz_options->preset_dict_size = options->preset_dict_size;
+	lz_options->mf_threads = (options->mode & LZMA_MODE_MF_THREADS)
+			? options->mf_threads : 0;
 	return;
 }
 
@@ -618,7 +620,7 @@ lzma_lzma_encoder_create(void **coder_ptr, const lzma_allocator *allocator,
 	// Set compression mode. Note that we haven't validated the options
 	// yet. Invalid options will get rejected by lzma_lzma_encoder_reset()
 	// call at the end of this function.
-	switch (options->mode) {
+	switch (options->mode & ~LZMA_MODE_MF_THREADS) {
 		case LZMA_MODE_FAST:
 			coder->fast_mode = true;
 			break;
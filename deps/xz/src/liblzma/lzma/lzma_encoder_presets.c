@@ -30,6 +30,8 @@ lzma_lzma_preset(lzma_options_lzma *options, uint32_t preset)
 	options->lp = LZMA_LP_DEFAULT;
 	options->pb = LZMA_PB_DEFAULT;
 
+	options->mf_threads = 0;
+
 	static const uint8_t dict_pow2[]
 			= { 18, 20, 21, 22, 22, 23, 23, 24, 25, 26 };
 	options->dict_size = UINT32_C(1) << dict_pow2[level];
@@ -166,6 +166,27 @@ parse_block_list(const char *str_const)
 }
 
 
+/// Parse OFFSET:LEN given to --range.
+static void
+parse_range(const char *str)
+{
+	const char *colon = strchr(str, ':');
+	if (colon == NULL)
+		message_fatal(_("%s: Invalid argument to --range"), str);
+
+	// Make a copy so that the colon can be replaced without
+	// modifying argv[].
+	char *offset = xstrdup(str);
+	offset[colon - str] = '\0';
+	opt_range_offset = str_to_uint64("range", offset, 0, UINT64_MAX);
+	free(offset);
+
+	opt_range_size = str_to_uint64("range", colon + 1, 0, UINT64_MAX);
+	opt_range = true;
+	return;
+}
+
+
 static void
 parse_real(args_info *args, int argc, char **argv)
 {
@@ -196,6 +217,7 @@ parse_real(args_info *args, int argc, char **argv)
 
 		OPT_SINGLE_STREAM,
 		OPT_NO_SPARSE,
+		OPT_IO_BUFFER_SIZE,
 		OPT_FILES,
 		OPT_FILES0,
 		OPT_BLOCK_SIZE,
@@ -204,10 +226,12 @@ parse_real(args_info *args, int argc, char **argv)
 		OPT_MEM_DECOMPRESS,
 		OPT_MEM_MT_DECOMPRESS,
 		OPT_NO_ADJUST,
+		OPT_ADAPTIVE_THREADS,
 		OPT_INFO_MEMORY,
 		OPT_ROBOT,
 		OPT_FLUSH_TIMEOUT,
 		OPT_IGNORE_CHECK,
+		OPT_RANGE,
 	};
 
 	static const char short_opts[]
@@ -228,6 +252,8 @@ parse_real(args_info *args, int argc, char **argv)
 		{ "to-stdout",    no_argument,       NULL,  'c' },
 		{ "single-stream", no_argument,      NULL,  OPT_SINGLE_STREAM },
 		{ "no-sparse",    no_argument,       NULL,  OPT_NO_SPARSE },
+		{ "io-buffer-size", required_argument, NULL, OPT_IO_BUFFER_SIZE },
+		{ "range",        required_argument, NULL,  OPT_RANGE },
 		{ "suffix",       required_argument, NULL,  'S' },
 		// { "recursive",      no_argument,       NULL,  'r' }, // TODO
 		{ "files",        optional_argument, NULL,  OPT_FILES },
@@ -246,6 +272,7 @@ parse_real(args_info *args, int argc, char **argv)
 		{ "memory",       required_argument, NULL,  'M' }, // Old alias
 		{ "no-adjust",    no_argument,       NULL,  OPT_NO_ADJUST },
 		{ "threads",      required_argument, NULL,  'T' },
+		{ "adaptive-threads", no_argument,   NULL,  OPT_ADAPTIVE_THREADS },
 		{ "flush-timeout", required_argument, NULL, OPT_FLUSH_TIMEOUT },
 
 		{ "extreme",      no_argument,       NULL,  'e' },
@@ -596,6 +623,16 @@ parse_real(args_info *args, int argc, char **argv)
 			io_no_sparse();
 			break;
 
+		case OPT_IO_BUFFER_SIZE:
+			io_set_thread_buffer_size(str_to_uint64(
+					"io-buffer-size", optarg,
+					0, UINT32_C(1) << 30));
+			break;
+
+		case OPT_RANGE:
+			parse_range(optarg);
+			break;
+
 		case OPT_FILES:
 			args->files_delim = '\n';
 
@@ -628,6 +665,10 @@ parse_real(args_info *args, int argc, char **argv)
 			opt_auto_adjust = false;
 			break;
 
+		case OPT_ADAPTIVE_THREADS:
+			opt_mt_adaptive = true;
+			break;
+
 		case OPT_FLUSH_TIMEOUT:
 			opt_flush_timeout = str_to_uint64("flush-timeout",
 					optarg, 0, UINT64_MAX);
@@ -793,6 +834,21 @@ args_parse(args_info *args, int argc, char **argv)
 				"is not supported"));
 #endif
 
+	// --range needs random access to the Blocks of .xz files. The
+	// source file is kept because the output has only a part of
+	// the uncompressed data.
+	if (opt_range) {
+		if (opt_mode != MODE_DECOMPRESS)
+			message_fatal(_("--range is supported only "
+					"when decompressing"));
+
+		if (opt_format != FORMAT_AUTO && opt_format != FORMAT_XZ)
+			message_fatal(_("--range is supported only "
+					"with .xz files"));
+
+		opt_keep_original = true;
+	}
+
 	// Never remove the source file when the destination is not on disk.
 	// In test mode the data is written nowhere, but setting opt_stdout
 	// will make the rest of the code behave well.
@@ -24,9 +24,13 @@ enum coder_init_ret {
 enum operation_mode opt_mode = MODE_COMPRESS;
 enum format_type opt_format = FORMAT_AUTO;
 bool opt_auto_adjust = true;
+bool opt_mt_adaptive = false;
 bool opt_single_stream = false;
 uint64_t opt_block_size = 0;
 block_list_entry *opt_block_list = NULL;
+bool opt_range = false;
+uint64_t opt_range_offset = 0;
+uint64_t opt_range_size = 0;
 
 /// Stream used to communicate with liblzma
 static lzma_stream strm = LZMA_STREAM_INIT;
@@ -55,10 +59,14 @@ static uint32_t filters_used_mask = 1;
 static uint64_t filter_memusages[ARRAY_SIZE(filters)];
 #endif
 
-/// Input and output buffers
+/// Input and output buffers for --range. Otherwise the buffers come
+/// from io_read_chunk() and io_write_chunk_buf().
 static io_buf in_buf;
 static io_buf out_buf;
 
+/// Size of the current output buffer from io_write_chunk_buf()
+static size_t out_chunk_size;
+
 /// Number of filters in the default filter chain. Zero indicates that
 /// we are using a preset.
 static uint32_t filters_count = 0;
@@ -509,6 +517,17 @@ coder_set_compression_settings(void)
 			mt_options.block_size = block_size;
 			mt_options.check = check;
 
+			// With --adaptive-threads, let liblzma trade the
+			// Block size against the number of threads within
+			// the memory usage limit. This makes the output
+			// depend on timing, so it is never done by default.
+			// An explicit Block size or --block-list wins.
+			if (opt_mt_adaptive && opt_block_size == 0
+					&& opt_block_list == NULL) {
+				mt_options.flags = LZMA_MT_ADAPTIVE;
+				mt_options.memlimit_threading = memory_limit;
+			}
+
 			memory_usage = filters_memusage_max(
 						&mt_options, true);
 			if (memory_usage != UINT64_MAX)
@@ -568,6 +587,20 @@ coder_set_compression_settings(void)
 #ifdef HAVE_ENCODERS
 #	ifdef MYTHREAD_ENABLED
 	if (opt_format == FORMAT_XZ && hardware_threads_is_mt()) {
+		// Not even one thread fits in the adaptive mode. Fall back
+		// to the fixed Block size so that the code below can
+		// reduce the number of threads and the dictionary size.
+		if (mt_options.flags & LZMA_MT_ADAPTIVE) {
+			mt_options.flags = 0;
+			memory_usage = filters_memusage_max(
+					&mt_options, true);
+			if (memory_usage == UINT64_MAX)
+				message_bug();
+
+			if (memory_usage <= memory_limit)
+				return;
+		}
+
 		// Try to reduce the number of threads before
 		// adjusting the compression settings down.
 		while (mt_options.threads > 1) {
@@ -791,18 +824,18 @@ coder_set_compression_settings(void)
 
 
 #ifdef HAVE_DECODERS
-/// Return true if the data in in_buf seems to be in the .xz format.
+/// Return true if the data in strm.next_in seems to be in the .xz format.
 static bool
 is_format_xz(void)
 {
 	// Specify the magic as hex to be compatible with EBCDIC systems.
 	static const uint8_t magic[6] = { 0xFD, 0x37, 0x7A, 0x58, 0x5A, 0x00 };
 	return strm.avail_in >= sizeof(magic)
-			&& memcmp(in_buf.u8, magic, sizeof(magic)) == 0;
+			&& memcmp(strm.next_in, magic, sizeof(magic)) == 0;
 }
 
 
-/// Return true if the data in in_buf seems to be in the .lzma format.
+/// Return true if the data in strm.next_in seems to be in the .lzma format.
 static bool
 is_format_lzma(void)
 {
@@ -812,7 +845,8 @@ is_format_lzma(void)
 
 	// Decode the LZMA1 properties.
 	lzma_filter filter = { .id = LZMA_FILTER_LZMA1 };
-	if (lzma_properties_decode(&filter, NULL, in_buf.u8, 5) != LZMA_OK)
+	if (lzma_properties_decode(&filter, NULL, strm.next_in, 5)
+			!= LZMA_OK)
 		return false;
 
 	// A hack to ditch tons of false positives: We allow only dictionary
@@ -840,7 +874,8 @@ is_format_lzma(void)
 	// Again, if someone complains, this will be reconsidered.
 	uint64_t uncompressed_size = 0;
 	for (size_t i = 0; i < 8; ++i)
-		uncompressed_size |= (uint64_t)(in_buf.u8[5 + i]) << (i * 8);
+		uncompressed_size |= (uint64_t)(strm.next_in[5 + i])
+				<< (i * 8);
 
 	if (uncompressed_size != UINT64_MAX
 			&& uncompressed_size > (UINT64_C(1) << 38))
@@ -851,13 +886,13 @@ is_format_lzma(void)
 
 
 #ifdef HAVE_LZIP_DECODER
-/// Return true if the data in in_buf seems to be in the .lz format.
+/// Return true if the data in strm.next_in seems to be in the .lz format.
 static bool
 is_format_lzip(void)
 {
 	static const uint8_t magic[4] = { 0x4C, 0x5A, 0x49, 0x50 };
 	return strm.avail_in >= sizeof(magic)
-			&& memcmp(in_buf.u8, magic, sizeof(magic)) == 0;
+			&& memcmp(strm.next_in, magic, sizeof(magic)) == 0;
 }
 #endif
 #endif
@@ -868,6 +903,93 @@ is_format_lzip(void)
 /// liblzma-based coder was initialized (CODER_INIT_NORMAL), if passthru
 /// mode should be used (CODER_INIT_PASSTHRU), or if an error occurred
 /// (CODER_INIT_ERROR).
+#if defined(HAVE_ENCODERS) && defined(MYTHREAD_ENABLED)
+/// Set the mf_threads option of the LZMA1 and LZMA2 filters for the file
+/// being compressed. A match finder thread is useful only when there are
+/// threads that wouldn't be used otherwise: with .lzma and raw streams,
+/// and with .xz when the file has at most half as many Blocks as there
+/// are threads. The match finder thread doesn't affect the output.
+static void
+coder_set_mf_threads(const file_pair *pair)
+{
+	uint32_t mf_threads = 0;
+
+	if (opt_format != FORMAT_XZ) {
+		if (hardware_threads_get() > 1)
+			mf_threads = 1;
+
+	} else if (hardware_threads_is_mt() && opt_block_list == NULL
+			&& pair->src_st.st_size > 0) {
+		// When reading from stdin, st_size is zero and the number
+		// of Blocks isn't known.
+		const uint64_t blocks = ((uint64_t)pair->src_st.st_size
+				+ mt_options.block_size - 1)
+				/ mt_options.block_size;
+		if (blocks <= mt_options.threads / 2)
+			mf_threads = 1;
+	}
+
+	while (true) {
+		uint64_t memory_usage = 0;
+		lzma_mt mt_local = mt_options;
+
+		for (uint32_t i = 0; i < ARRAY_SIZE(filters); i++) {
+			if (!(filters_used_mask & (1U << i)))
+				continue;
+
+			for (size_t j = 0; filters[i][j].id
+					!= LZMA_VLI_UNKNOWN; j++) {
+				if (filters[i][j].id == LZMA_FILTER_LZMA1
+						|| filters[i][j].id
+						== LZMA_FILTER_LZMA2
+						|| filters[i][j].id
+						== LZMA_FILTER_LZMA1EXT) {
+					lzma_options_lzma *opt
+						= filters[i][j].options;
+					opt->mf_threads = mf_threads;
+					if (mf_threads > 0)
+						opt->mode |= LZMA_MODE_MF_THREADS;
+					else
+						opt->mode &= ~LZMA_MODE_MF_THREADS;
+				}
+			}
+
+			uint64_t memusage;
+			if (opt_format == FORMAT_XZ
+					&& hardware_threads_is_mt()) {
+				mt_local.filters = filters[i];
+				memusage = lzma_stream_encoder_mt_memusage(
+						&mt_local);
+			} else {
+				memusage = lzma_raw_encoder_memusage(
+						filters[i]);
+			}
+
+			if (memusage > memory_usage)
+				memory_usage = memusage;
+		}
+
+		// The thread needs a little memory. Don't use it if
+		// that would exceed the memory usage limit.
+		const uint64_t memory_limit = opt_format == FORMAT_XZ
+					&& hardware_threads_is_mt()
+				? hardware_memlimit_mtenc_get()
+				: hardware_memlimit_get(MODE_COMPRESS);
+		if (mf_threads == 0 || memory_usage <= memory_limit)
+			break;
+
+		mf_threads = 0;
+	}
+
+	if (mf_threads > 0)
+		message(V_DEBUG, _("Using a separate thread "
+				"for the match finder"));
+
+	return;
+}
+#endif
+
+
 static enum coder_init_ret
 coder_init(file_pair *pair)
 {
@@ -888,6 +1010,10 @@ coder_init(file_pair *pair)
 
 	if (opt_mode == MODE_COMPRESS) {
 #ifdef HAVE_ENCODERS
+#	ifdef MYTHREAD_ENABLED
+		coder_set_mf_threads(pair);
+#	endif
+
 		switch (opt_format) {
 		case FORMAT_AUTO:
 			// args.c ensures this.
@@ -897,10 +1023,31 @@ coder_init(file_pair *pair)
 		case FORMAT_XZ:
 #	ifdef MYTHREAD_ENABLED
 			mt_options.filters = active_filters;
-			if (hardware_threads_is_mt())
+			if (hardware_threads_is_mt()) {
 				ret = lzma_stream_encoder_mt(
 						&strm, &mt_options);
-			else
+
+				lzma_mt mt_used;
+				if (ret == LZMA_OK && (mt_options.flags
+						& LZMA_MT_ADAPTIVE)
+						&& lzma_stream_encoder_mt_get(
+							&strm, &mt_used)
+							== LZMA_OK)
+					message(V_DEBUG, _("Starting with %s "
+						"threads and a Block size "
+						"of %s; %s MiB of memory "
+						"is needed"),
+						uint64_to_str(
+							mt_used.threads, 0),
+						uint64_to_nicestr(
+							mt_used.block_size,
+							NICESTR_B,
+							NICESTR_TIB,
+							true, 1),
+						uint64_to_str(round_up_to_mib(
+							mt_used.memusage),
+							2));
+			} else
 #	endif
 				ret = lzma_stream_encoder(
 						&strm, active_filters, check);
@@ -1035,6 +1182,24 @@ coder_init(file_pair *pair)
 #	ifdef HAVE_LZIP_DECODER
 		case FORMAT_LZIP:
 			allow_trailing_input = true;
+#		ifdef MYTHREAD_ENABLED
+			// Files made of many members (plzip) can be
+			// decoded in parallel. The memory usage limits
+			// are the same as with the .xz format.
+			if (hardware_threads_is_mt()) {
+				mt_options.flags = flags;
+				mt_options.threads = hardware_threads_get();
+				mt_options.memlimit_stop
+					= hardware_memlimit_get(
+						MODE_DECOMPRESS);
+				mt_options.memlimit_threading
+					= hardware_memlimit_mtdec_get();
+				ret = lzma_lzip_decoder_mt(&strm,
+						&mt_options);
+				break;
+			}
+#		endif
+
 			ret = lzma_lzip_decoder(&strm,
 					hardware_memlimit_get(
 						MODE_DECOMPRESS), flags);
@@ -1093,6 +1258,140 @@ coder_init(file_pair *pair)
 
 
 #ifdef HAVE_ENCODERS
+#ifdef HAVE_DECODERS
+typedef struct {
+	file_pair *pair;
+
+	/// Set if reading failed. io_pread() has already displayed
+	/// an error message.
+	bool io_error;
+} range_source;
+
+
+/// lzma_seekable_source.read() for coder_range()
+static lzma_ret LZMA_API_CALL
+range_read(void *source_ptr, uint8_t *buf, size_t size, uint64_t pos)
+{
+	range_source *source = source_ptr;
+
+	while (size > 0) {
+		const size_t amount = my_min(size, IO_BUFFER_SIZE);
+		if (io_pread(source->pair, &in_buf, amount, pos)) {
+			source->io_error = true;
+			return LZMA_DATA_ERROR;
+		}
+
+		memcpy(buf, in_buf.u8, amount);
+		buf += amount;
+		size -= amount;
+		pos += amount;
+	}
+
+	return LZMA_OK;
+}
+
+
+/// Decompress only the uncompressed range given with --range. Only
+/// the Blocks that overlap the range are read and decompressed.
+///
+/// \return     On success, true is returned. On error, false is returned.
+static bool
+coder_range(file_pair *pair)
+{
+	range_source source = { pair, false };
+	const lzma_seekable_source seekable_source = { &range_read, &source };
+
+	// Like the threaded decoder, keep whole decompressed Blocks in
+	// memory within the limit for threaded decompression. Half of it
+	// is for the cache of Blocks and half for the output buffer below.
+	const uint64_t cache_size = my_max(IO_BUFFER_SIZE,
+			my_min(hardware_memlimit_mtdec_get() / 2, SIZE_MAX));
+
+	lzma_seekable *seekable;
+	lzma_ret ret = lzma_seekable_open(&seekable, &seekable_source,
+			(uint64_t)pair->src_st.st_size, cache_size,
+			hardware_memlimit_get(MODE_DECOMPRESS), NULL);
+	if (ret != LZMA_OK) {
+		if (!source.io_error)
+			message_error(_("%s: %s"), pair->src_name,
+					message_strm(ret));
+
+		return false;
+	}
+
+	const lzma_index *idx = lzma_seekable_index(seekable);
+	const uint64_t uncompressed_size = lzma_index_uncompressed_size(idx);
+
+	// The range is silently truncated to the end of the data.
+	uint64_t pos = my_min(opt_range_offset, uncompressed_size);
+	const uint64_t end = uncompressed_size - pos < opt_range_size
+			? uncompressed_size : pos + opt_range_size;
+
+	uint8_t *big_buf = NULL;
+	size_t big_buf_size = 0;
+	bool success = false;
+
+	while (pos < end) {
+		if (user_abort)
+			goto out;
+
+		lzma_index_iter iter;
+		lzma_index_iter_init(&iter, idx);
+		if (lzma_index_iter_locate(&iter, pos))
+			message_bug();
+
+		uint8_t *buf = out_buf.u8;
+		size_t size = (size_t)my_min(end - pos, IO_BUFFER_SIZE);
+
+		// A Block that doesn't fit in the cache is decompressed
+		// from its beginning on every read. Read as much as
+		// the memory usage limit allows to do it as few times
+		// as possible.
+		if (iter.block.uncompressed_size > cache_size) {
+			size = (size_t)my_min(end - pos, cache_size);
+			if (size > big_buf_size) {
+				free(big_buf);
+				big_buf = xmalloc(size);
+				big_buf_size = size;
+			}
+
+			buf = big_buf;
+		}
+
+		ret = lzma_seekable_read(seekable, buf, &size, pos);
+		if (ret != LZMA_OK) {
+			if (!source.io_error)
+				message_error(_("%s: %s"), pair->src_name,
+						message_strm(ret));
+
+			goto out;
+		}
+
+		pos += size;
+
+		while (size > 0) {
+			const size_t amount = my_min(size, IO_BUFFER_SIZE);
+			if (buf != out_buf.u8)
+				memcpy(out_buf.u8, buf, amount);
+
+			if (io_write(pair, &out_buf, amount))
+				goto out;
+
+			buf += amount;
+			size -= amount;
+		}
+	}
+
+	success = true;
+
+out:
+	free(big_buf);
+	lzma_seekable_end(seekable);
+	return success;
+}
+#endif
+
+
 /// Resolve conflicts between opt_block_size and opt_block_list in single
 /// threaded mode. We want to default to opt_block_list, except when it is
 /// larger than opt_block_size. If this is the case for the current Block
@@ -1175,12 +1474,12 @@ static bool
 coder_write_output(file_pair *pair)
 {
 	if (opt_mode != MODE_TEST) {
-		if (io_write(pair, &out_buf, IO_BUFFER_SIZE - strm.avail_out))
+		if (io_write_chunk(pair, out_chunk_size - strm.avail_out))
 			return true;
 	}
 
-	strm.next_out = out_buf.u8;
-	strm.avail_out = IO_BUFFER_SIZE;
+	strm.next_out = io_write_chunk_buf(pair, &out_chunk_size);
+	strm.avail_out = out_chunk_size;
 	return false;
 }
 
@@ -1248,21 +1547,21 @@ coder_normal(file_pair *pair)
 	}
 #endif
 
-	strm.next_out = out_buf.u8;
-	strm.avail_out = IO_BUFFER_SIZE;
+	strm.next_out = io_write_chunk_buf(pair, &out_chunk_size);
+	strm.avail_out = out_chunk_size;
 
 	while (!user_abort) {
 		// Fill the input buffer if it is empty and we aren't
 		// flushing or finishing.
 		if (strm.avail_in == 0 && action == LZMA_RUN) {
-			strm.next_in = in_buf.u8;
 #ifdef HAVE_ENCODERS
-			const size_t read_size = my_min(block_remaining,
-					IO_BUFFER_SIZE);
+			const size_t read_size = (size_t)my_min(
+					block_remaining, SIZE_MAX);
 #else
-			const size_t read_size = IO_BUFFER_SIZE;
+			const size_t read_size = SIZE_MAX;
 #endif
-			strm.avail_in = io_read(pair, &in_buf, read_size);
+			strm.avail_in = io_read_chunk(pair, &strm.next_in,
+					read_size);
 
 			if (strm.avail_in == SIZE_MAX)
 				break;
@@ -1357,8 +1656,9 @@ coder_normal(file_pair *pair)
 					// Hopefully we don't get any more
 					// input, and thus pair->src_eof
 					// becomes true.
-					strm.avail_in = io_read(
-							pair, &in_buf, 1);
+					strm.avail_in = io_read_chunk(
+							pair, &strm.next_in,
+							1);
 					if (strm.avail_in == SIZE_MAX)
 						break;
 
@@ -1421,16 +1721,26 @@ coder_passthru(file_pair *pair)
 		if (user_abort)
 			return false;
 
-		if (io_write(pair, &in_buf, strm.avail_in))
+		size_t size;
+		uint8_t *buf = io_write_chunk_buf(pair, &size);
+		size = my_min(size, strm.avail_in);
+		memcpy(buf, strm.next_in, size);
+
+		if (io_write_chunk(pair, size))
 			return false;
 
-		strm.total_in += strm.avail_in;
+		strm.next_in += size;
+		strm.avail_in -= size;
+		strm.total_in += size;
 		strm.total_out = strm.total_in;
 		message_progress_update();
 
-		strm.avail_in = io_read(pair, &in_buf, IO_BUFFER_SIZE);
-		if (strm.avail_in == SIZE_MAX)
-			return false;
+		if (strm.avail_in == 0) {
+			strm.avail_in = io_read_chunk(
+					pair, &strm.next_in, SIZE_MAX);
+			if (strm.avail_in == SIZE_MAX)
+				return false;
+		}
 	}
 
 	return true;
@@ -1443,22 +1753,44 @@ coder_run(const char *filename)
 	// Set and possibly print the filename for the progress message.
 	message_filename(filename);
 
+#ifdef HAVE_DECODERS
+	if (opt_range && filename == stdin_filename) {
+		message_error(_("--range does not support reading from "
+				"standard input"));
+		return;
+	}
+#endif
+
 	// Try to open the input file.
 	file_pair *pair = io_open_src(filename);
 	if (pair == NULL)
 		return;
 
+#ifdef HAVE_DECODERS
+	if (opt_range) {
+		const bool success = !io_open_dest(pair)
+				&& coder_range(pair);
+		io_close(pair, success);
+		return;
+	}
+#endif
+
 	// Assume that something goes wrong.
 	bool success = false;
 
+	// In multi-threaded mode, overlap reading and writing of regular
+	// files with the coding.
+	const bool io_threads = hardware_threads_is_mt();
+	if (io_threads)
+		io_start_threads(pair);
+
 	if (opt_mode == MODE_COMPRESS) {
 		strm.next_in = NULL;
 		strm.avail_in = 0;
 	} else {
 		// Read the first chunk of input data. This is needed
 		// to detect the input file type.
-		strm.next_in = in_buf.u8;
-		strm.avail_in = io_read(pair, &in_buf, IO_BUFFER_SIZE);
+		strm.avail_in = io_read_chunk(pair, &strm.next_in, SIZE_MAX);
 	}
 
 	if (strm.avail_in != SIZE_MAX) {
@@ -1474,6 +1806,9 @@ coder_run(const char *filename)
 			// Don't open the destination file when --test
 			// is used.
 			if (opt_mode == MODE_TEST || !io_open_dest(pair)) {
+				if (io_threads)
+					io_start_threads(pair);
+
 				// Remember the current time. It is needed
 				// for progress indicator.
 				mytime_set_start_time();
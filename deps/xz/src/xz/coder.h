@@ -55,6 +55,10 @@ extern enum format_type opt_format;
 /// they exceed the memory usage limit.
 extern bool opt_auto_adjust;
 
+/// If true, the multi-threaded encoder may change the Block size and
+/// the number of threads to fit the memory usage limit (LZMA_MT_ADAPTIVE).
+extern bool opt_mt_adaptive;
+
 /// If true, stop after decoding the first stream.
 extern bool opt_single_stream;
 
@@ -65,6 +69,12 @@ extern uint64_t opt_block_size;
 /// List of block size and filter chain pointer pairs.
 extern block_list_entry *opt_block_list;
 
+/// If true, decompress only the uncompressed range given with --range.
+/// opt_range_size may extend past the end of the uncompressed data.
+extern bool opt_range;
+extern uint64_t opt_range_offset;
+extern uint64_t opt_range_size;
+
 /// Set the integrity check type used when compressing
 extern void coder_set_check(lzma_check check);
 
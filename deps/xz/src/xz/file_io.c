@@ -29,6 +29,7 @@ static bool warn_fchown;
 #endif
 
 #include "tuklib_open_stdxxx.h"
+#include "tuklib_integer.h"
 
 #ifdef _MSC_VER
 #	ifdef _WIN64
@@ -83,6 +84,65 @@ typedef enum {
 /// If true, try to create sparse files when decompressing.
 static bool try_sparse = true;
 
+/// Size of the buffers of the read-ahead and write-behind threads.
+/// Zero disables the threads.
+static size_t thread_buffer_size = IO_THREAD_BUFFER_SIZE;
+
+/// Buffers for io_read_chunk() and io_write_chunk_buf() when the file
+/// isn't accessed in a thread. Only one file pair is open at a time.
+static io_buf src_buf;
+static io_buf dest_buf;
+
+#ifdef MYTHREAD_ENABLED
+/// Number of buffers per I/O thread
+#define IO_THREAD_BUFFERS 4
+
+struct io_thread_s {
+	/// The file pair whose src_fd or dest_fd is used by the thread
+	file_pair *pair;
+
+	mythread thread;
+	mythread_mutex mutex;
+
+	/// Signaled by both the main thread and the I/O thread whenever
+	/// the state changes. There is only one waiter at a time.
+	mythread_cond cond;
+
+	/// Buffers of buffer_size bytes each
+	uint8_t *buf[IO_THREAD_BUFFERS];
+	size_t buffer_size;
+
+	/// Amount of data in each buffer
+	size_t size[IO_THREAD_BUFFERS];
+
+	/// The buffers form a ring. The count buffers starting from
+	/// buf[first] contain data. The main thread reads from buf[first]
+	/// (read-ahead) or the I/O thread writes it out (write-behind).
+	/// The other buffers are free for the reader thread or for
+	/// the main thread, respectively.
+	unsigned first;
+	unsigned count;
+
+	/// Read-ahead: Position of the main thread in buf[first]
+	size_t pos;
+
+	/// Read-ahead: End of file has been reached.
+	bool eof;
+
+	/// Set by the main thread to tell the thread to exit. The
+	/// write-behind thread writes the queued buffers first.
+	bool stop;
+
+	/// errno from the failed system call or zero if no errors have
+	/// occurred. The error message is printed by the main thread.
+	int error;
+
+	/// Write-behind: True if the error came from lseek() when
+	/// creating a sparse file.
+	bool seek_failed;
+};
+#endif
+
 #ifndef TUKLIB_DOSLIKE
 /// File status flags of standard input. This is used by io_open_src()
 /// and io_close_src().
@@ -102,6 +162,12 @@ static int user_abort_pipe[2];
 
 static bool io_write_buf(file_pair *pair, const uint8_t *buf, size_t size);
 
+#ifdef MYTHREAD_ENABLED
+static int io_thread_end(io_thread **thr_ptr, bool *seek_failed);
+static void io_thread_write_error(const file_pair *pair, int error,
+		bool seek_failed);
+#endif
+
 
 extern void
 io_init(void)
@@ -167,6 +233,20 @@ io_no_sparse(void)
 }
 
 
+extern void
+io_set_thread_buffer_size(uint64_t size)
+{
+	// The write-behind thread looks for sparse blocks in pieces of
+	// IO_BUFFER_SIZE bytes. Use a multiple of that so that the pieces
+	// stay aligned with the file offsets.
+	if (size != 0 && size < IO_BUFFER_SIZE)
+		size = IO_BUFFER_SIZE;
+
+	thread_buffer_size = (size_t)(size) / IO_BUFFER_SIZE * IO_BUFFER_SIZE;
+	return;
+}
+
+
 #ifndef TUKLIB_DOSLIKE
 /// \brief      Waits for input or output to become available or for a signal
 ///
@@ -712,6 +792,8 @@ io_open_src(const char *src_name)
 		.flush_needed = false,
 		.dest_try_sparse = false,
 		.dest_pending_sparse = 0,
+		.src_thread = NULL,
+		.dest_thread = NULL,
 	};
 
 	// Block the signals, for which we have a custom signal handler, so
@@ -1028,6 +1110,25 @@ io_close_dest(file_pair *pair, bool success)
 extern void
 io_close(file_pair *pair, bool success)
 {
+#ifdef MYTHREAD_ENABLED
+	// Stop the I/O threads. The queued output is written first.
+	// If writing failed, the error may have been reported already
+	// by io_write_chunk() in which case success is false.
+	bool seek_failed;
+
+	if (pair->src_thread != NULL)
+		(void)io_thread_end(&pair->src_thread, &seek_failed);
+
+	if (pair->dest_thread != NULL) {
+		const int error = io_thread_end(
+				&pair->dest_thread, &seek_failed);
+		if (error != 0 && success) {
+			io_thread_write_error(pair, error, seek_failed);
+			success = false;
+		}
+	}
+#endif
+
 	// Take care of sparseness at the end of the output file.
 	if (success && pair->dest_try_sparse
 			&& pair->dest_pending_sparse > 0) {
@@ -1077,6 +1178,12 @@ io_close(file_pair *pair, bool success)
 extern void
 io_fix_src_pos(file_pair *pair, size_t rewind_size)
 {
+	// The read-ahead thread isn't used with standard input, and with
+	// other files the position doesn't matter. Seeking while the thread
+	// is reading would break it.
+	if (pair->src_thread != NULL)
+		return;
+
 	assert(rewind_size <= IO_BUFFER_SIZE);
 
 	if (rewind_size > 0) {
@@ -1093,6 +1200,7 @@ extern size_t
 io_read(file_pair *pair, io_buf *buf, size_t size)
 {
 	assert(size <= IO_BUFFER_SIZE);
+	assert(pair->src_thread == NULL);
 
 	size_t pos = 0;
 
@@ -1203,13 +1311,15 @@ io_pread(file_pair *pair, io_buf *buf, size_t size, uint64_t pos)
 }
 
 
+/// buf must be aligned to eight bytes and size must be a multiple of eight.
 static bool
-is_sparse(const io_buf *buf)
+is_sparse(const uint8_t *buf, size_t size)
 {
 	assert(IO_BUFFER_SIZE % sizeof(uint64_t) == 0);
+	assert(size % sizeof(uint64_t) == 0);
 
-	for (size_t i = 0; i < ARRAY_SIZE(buf->u64); ++i)
-		if (buf->u64[i] != 0)
+	for (size_t i = 0; i < size; i += sizeof(uint64_t))
+		if (aligned_read64ne(buf + i) != 0)
 			return false;
 
 	return true;
@@ -1271,6 +1381,7 @@ extern bool
 io_write(file_pair *pair, const io_buf *buf, size_t size)
 {
 	assert(size <= IO_BUFFER_SIZE);
+	assert(pair->dest_thread == NULL);
 
 	if (pair->dest_try_sparse) {
 		// Check if the block is sparse (contains only zeros). If it
@@ -1288,7 +1399,8 @@ io_write(file_pair *pair, const io_buf *buf, size_t size)
 			// on 32-bit systems where off_t isn't always 64 bits.
 			const off_t pending_max
 				= (off_t)(1) << (sizeof(off_t) * CHAR_BIT - 2);
-			if (is_sparse(buf) && pair->dest_pending_sparse
+			if (is_sparse(buf->u8, size)
+					&& pair->dest_pending_sparse
 					< pending_max) {
 				pair->dest_pending_sparse += (off_t)(size);
 				return false;
@@ -1315,3 +1427,414 @@ io_write(file_pair *pair, const io_buf *buf, size_t size)
 
 	return io_write_buf(pair, buf->u8, size);
 }
+
+
+#ifdef MYTHREAD_ENABLED
+static MYTHREAD_RET_TYPE
+io_read_thread(void *thr_ptr)
+{
+	io_thread *thr = thr_ptr;
+	const int fd = thr->pair->src_fd;
+
+	mythread_mutex_lock(&thr->mutex);
+
+	while (true) {
+		while (thr->count == IO_THREAD_BUFFERS && !thr->stop)
+			mythread_cond_wait(&thr->cond, &thr->mutex);
+
+		if (thr->stop)
+			break;
+
+		const unsigned i = (thr->first + thr->count)
+				% IO_THREAD_BUFFERS;
+		mythread_mutex_unlock(&thr->mutex);
+
+		// Fill the whole buffer so that the coder gets as big
+		// chunks as possible. The source is a regular file so
+		// read() doesn't block for long and EAGAIN isn't possible.
+		size_t size = 0;
+		bool eof = false;
+		int error = 0;
+
+		while (size < thr->buffer_size) {
+			const ssize_t amount = read(fd, thr->buf[i] + size,
+					thr->buffer_size - size);
+
+			if (amount > 0) {
+				size += (size_t)(amount);
+			} else if (amount == 0) {
+				eof = true;
+				break;
+			} else if (errno != EINTR) {
+				error = errno;
+				break;
+			}
+		}
+
+		mythread_mutex_lock(&thr->mutex);
+
+		thr->size[i] = size;
+		if (size > 0)
+			++thr->count;
+
+		thr->eof = eof;
+		thr->error = error;
+		mythread_cond_signal(&thr->cond);
+
+		if (eof || error != 0)
+			break;
+	}
+
+	mythread_mutex_unlock(&thr->mutex);
+	return MYTHREAD_RET_VALUE;
+}
+
+
+/// Write a buffer in the write-behind thread. The sparse file handling
+/// is the same as in io_write() with the buffer split into blocks of
+/// IO_BUFFER_SIZE bytes, but the consecutive non-sparse blocks are
+/// written with one write() call. Instead of printing error messages,
+/// errno is returned. On success, zero is returned.
+static int
+io_thread_write(file_pair *pair, const uint8_t *buf, size_t size,
+		bool *seek_failed)
+{
+	const off_t pending_max
+			= (off_t)(1) << (sizeof(off_t) * CHAR_BIT - 2);
+
+	while (size > 0) {
+		size_t amount = size;
+
+		if (pair->dest_try_sparse) {
+			if (size >= IO_BUFFER_SIZE
+					&& is_sparse(buf, IO_BUFFER_SIZE)
+					&& pair->dest_pending_sparse
+						< pending_max) {
+				pair->dest_pending_sparse
+						+= (off_t)(IO_BUFFER_SIZE);
+				buf += IO_BUFFER_SIZE;
+				size -= IO_BUFFER_SIZE;
+				continue;
+			}
+
+			if (pair->dest_pending_sparse > 0) {
+				if (lseek(pair->dest_fd,
+						pair->dest_pending_sparse,
+						SEEK_CUR) == -1) {
+					*seek_failed = true;
+					return errno;
+				}
+
+				pair->dest_pending_sparse = 0;
+			}
+
+			// Write up to the next sparse block. A partial
+			// block at the end is never sparse.
+			amount = my_min(size, IO_BUFFER_SIZE);
+			while (size - amount >= IO_BUFFER_SIZE
+					&& !is_sparse(buf + amount,
+						IO_BUFFER_SIZE))
+				amount += IO_BUFFER_SIZE;
+
+			if (size - amount < IO_BUFFER_SIZE)
+				amount = size;
+		}
+
+		size -= amount;
+
+		while (amount > 0) {
+			const ssize_t written = write(
+					pair->dest_fd, buf, amount);
+			if (written == -1) {
+				if (errno == EINTR)
+					continue;
+
+				return errno;
+			}
+
+			buf += (size_t)(written);
+			amount -= (size_t)(written);
+		}
+	}
+
+	return 0;
+}
+
+
+static MYTHREAD_RET_TYPE
+io_write_thread(void *thr_ptr)
+{
+	io_thread *thr = thr_ptr;
+
+	mythread_mutex_lock(&thr->mutex);
+
+	while (true) {
+		while (thr->count == 0 && !thr->stop)
+			mythread_cond_wait(&thr->cond, &thr->mutex);
+
+		// Stop only after the queued buffers have been written.
+		if (thr->count == 0)
+			break;
+
+		const unsigned i = thr->first;
+		mythread_mutex_unlock(&thr->mutex);
+
+		bool seek_failed = false;
+		const int error = io_thread_write(thr->pair, thr->buf[i],
+				thr->size[i], &seek_failed);
+
+		mythread_mutex_lock(&thr->mutex);
+
+		thr->first = (thr->first + 1) % IO_THREAD_BUFFERS;
+		--thr->count;
+		thr->error = error;
+		thr->seek_failed = seek_failed;
+		mythread_cond_signal(&thr->cond);
+
+		if (error != 0)
+			break;
+	}
+
+	mythread_mutex_unlock(&thr->mutex);
+	return MYTHREAD_RET_VALUE;
+}
+
+
+/// Create a thread that runs func. On error, NULL is returned and
+/// the file will be accessed without a thread.
+static io_thread *
+io_thread_create(file_pair *pair, MYTHREAD_RET_TYPE (*func)(void *))
+{
+	io_thread *thr = xmalloc(sizeof(io_thread));
+	*thr = (io_thread){
+		.pair = pair,
+		.buffer_size = thread_buffer_size,
+		.first = 0,
+		.count = 0,
+		.pos = 0,
+		.eof = false,
+		.stop = false,
+		.error = 0,
+		.seek_failed = false,
+	};
+
+	for (unsigned i = 0; i < IO_THREAD_BUFFERS; ++i)
+		thr->buf[i] = xmalloc(thr->buffer_size);
+
+	if (mythread_mutex_init(&thr->mutex))
+		goto error_mutex;
+
+	if (mythread_cond_init(&thr->cond))
+		goto error_cond;
+
+	if (mythread_create(&thr->thread, func, thr))
+		goto error_thread;
+
+	return thr;
+
+error_thread:
+	mythread_cond_destroy(&thr->cond);
+error_cond:
+	mythread_mutex_destroy(&thr->mutex);
+error_mutex:
+	for (unsigned i = 0; i < IO_THREAD_BUFFERS; ++i)
+		free(thr->buf[i]);
+
+	free(thr);
+	return NULL;
+}
+
+
+/// Stop the thread and free *thr_ptr. The write-behind thread finishes
+/// writing the queued data first. The return value is the errno of
+/// the first error or zero if there were no errors.
+static int
+io_thread_end(io_thread **thr_ptr, bool *seek_failed)
+{
+	io_thread *thr = *thr_ptr;
+	*thr_ptr = NULL;
+
+	mythread_sync(thr->mutex) {
+		thr->stop = true;
+		mythread_cond_signal(&thr->cond);
+	}
+
+	(void)mythread_join(thr->thread);
+
+	const int error = thr->error;
+	*seek_failed = thr->seek_failed;
+
+	mythread_cond_destroy(&thr->cond);
+	mythread_mutex_destroy(&thr->mutex);
+
+	for (unsigned i = 0; i < IO_THREAD_BUFFERS; ++i)
+		free(thr->buf[i]);
+
+	free(thr);
+	return error;
+}
+
+
+/// Print the error message for an error from the write-behind thread.
+static void
+io_thread_write_error(const file_pair *pair, int error, bool seek_failed)
+{
+	if (seek_failed)
+		message_error(_("%s: Seeking failed when trying to create "
+				"a sparse file: %s"), pair->dest_name,
+				strerror(error));
+	else
+		message_error(_("%s: Write error: %s"),
+				pair->dest_name, strerror(error));
+
+	return;
+}
+#endif
+
+
+extern void
+io_start_threads(file_pair *pair)
+{
+#ifdef MYTHREAD_ENABLED
+	if (thread_buffer_size == 0)
+		return;
+
+	// src_st is all zeros when reading from standard input.
+	if (pair->src_thread == NULL && pair->src_fd != -1
+			&& pair->src_fd != STDIN_FILENO
+			&& S_ISREG(pair->src_st.st_mode))
+		pair->src_thread = io_thread_create(pair, &io_read_thread);
+
+	if (pair->dest_thread == NULL && pair->dest_fd != -1
+			&& S_ISREG(pair->dest_st.st_mode))
+		pair->dest_thread = io_thread_create(pair, &io_write_thread);
+#else
+	(void)pair;
+#endif
+
+	return;
+}
+
+
+extern size_t
+io_read_chunk(file_pair *pair, const uint8_t **buf, size_t size)
+{
+#ifdef MYTHREAD_ENABLED
+	io_thread *thr = pair->src_thread;
+	if (thr != NULL) {
+		size_t amount = 0;
+		int error = 0;
+
+		mythread_sync(thr->mutex) {
+			// Give the buffer back to the thread once all of
+			// it has been returned to the caller.
+			if (thr->count > 0
+					&& thr->pos == thr->size[thr->first]) {
+				thr->first = (thr->first + 1)
+						% IO_THREAD_BUFFERS;
+				--thr->count;
+				thr->pos = 0;
+				mythread_cond_signal(&thr->cond);
+			}
+
+			while (thr->count == 0 && !thr->eof
+					&& thr->error == 0)
+				mythread_cond_wait(&thr->cond, &thr->mutex);
+
+			if (thr->count == 0) {
+				error = thr->error;
+				pair->src_eof = error == 0;
+				break;
+			}
+
+			amount = my_min(size,
+					thr->size[thr->first] - thr->pos);
+			*buf = thr->buf[thr->first] + thr->pos;
+			thr->pos += amount;
+
+			// Tell about the end of file already with the last
+			// chunk so that the coder can use LZMA_FINISH.
+			if (thr->eof && thr->count == 1
+					&& thr->pos == thr->size[thr->first])
+				pair->src_eof = true;
+		}
+
+		if (error != 0) {
+			message_error(_("%s: Read error: %s"),
+					pair->src_name, strerror(error));
+			return SIZE_MAX;
+		}
+
+		return amount;
+	}
+#endif
+
+	*buf = src_buf.u8;
+	return io_read(pair, &src_buf, my_min(size, IO_BUFFER_SIZE));
+}
+
+
+extern uint8_t *
+io_write_chunk_buf(file_pair *pair, size_t *size)
+{
+#ifdef MYTHREAD_ENABLED
+	io_thread *thr = pair->dest_thread;
+	if (thr != NULL) {
+		unsigned i;
+
+		mythread_sync(thr->mutex) {
+			// If the thread has stopped due to an error, any
+			// buffer will do. The error is reported by
+			// io_write_chunk().
+			while (thr->count == IO_THREAD_BUFFERS
+					&& thr->error == 0)
+				mythread_cond_wait(&thr->cond, &thr->mutex);
+
+			i = (thr->first + thr->count) % IO_THREAD_BUFFERS;
+		}
+
+		*size = thr->buffer_size;
+		return thr->buf[i];
+	}
+#endif
+
+	*size = IO_BUFFER_SIZE;
+	return dest_buf.u8;
+}
+
+
+extern bool
+io_write_chunk(file_pair *pair, size_t size)
+{
+#ifdef MYTHREAD_ENABLED
+	io_thread *thr = pair->dest_thread;
+	if (thr != NULL) {
+		int error = 0;
+		bool seek_failed = false;
+
+		mythread_sync(thr->mutex) {
+			error = thr->error;
+			seek_failed = thr->seek_failed;
+			if (error != 0 || size == 0)
+				break;
+
+			// io_write_chunk_buf() has waited for a free buffer.
+			assert(thr->count < IO_THREAD_BUFFERS);
+			const unsigned i = (thr->first + thr->count)
+					% IO_THREAD_BUFFERS;
+			thr->size[i] = size;
+			++thr->count;
+			mythread_cond_signal(&thr->cond);
+		}
+
+		if (error != 0) {
+			io_thread_write_error(pair, error, seek_failed);
+			return true;
+		}
+
+		return false;
+	}
+#endif
+
+	return io_write(pair, &dest_buf, size);
+}
@@ -17,6 +17,11 @@
 #	define IO_BUFFER_SIZE (BUFSIZ & ~7U)
 #endif
 
+// Default size of the buffers used by the read-ahead and write-behind
+// threads. These are used only with regular files. Bigger buffers mean
+// fewer system calls and fewer lzma_code() calls per megabyte.
+#define IO_THREAD_BUFFER_SIZE (UINT32_C(1) << 20)
+
 #ifdef _MSC_VER
 	// The first one renames both "struct stat" -> "struct _stat64"
 	// and stat() -> _stat64(). The documentation mentions only
@@ -28,11 +33,11 @@
 #endif
 
 
-/// is_sparse() accesses the buffer as uint64_t for maximum speed.
-/// The u32 and u64 members must only be access through this union
-/// to avoid strict aliasing violations. Taking a pointer of u8
-/// should be fine as long as uint8_t maps to unsigned char which
-/// can alias anything.
+/// The union keeps the buffer aligned for is_sparse() which reads it
+/// eight bytes at a time. The u32 and u64 members must only be access
+/// through this union to avoid strict aliasing violations. Taking
+/// a pointer of u8 should be fine as long as uint8_t maps to unsigned
+/// char which can alias anything.
 typedef union {
 	uint8_t u8[IO_BUFFER_SIZE];
 	uint32_t u32[IO_BUFFER_SIZE / sizeof(uint32_t)];
@@ -40,6 +45,10 @@ typedef union {
 } io_buf;
 
 
+/// Read-ahead or write-behind thread; see io_start_threads()
+typedef struct io_thread_s io_thread;
+
+
 typedef struct {
 	/// Name of the source filename (as given on the command line) or
 	/// pointer to static "(stdin)" when reading from standard input.
@@ -80,6 +89,13 @@ typedef struct {
 	/// Stat of the destination file.
 	struct stat dest_st;
 
+	/// Thread reading src_fd ahead of the coder or NULL if the source
+	/// file is read directly with read().
+	io_thread *src_thread;
+
+	/// Thread writing to dest_fd or NULL if write() is called directly.
+	io_thread *dest_thread;
+
 } file_pair;
 
 
@@ -99,6 +115,12 @@ extern void io_write_to_user_abort_pipe(void);
 extern void io_no_sparse(void);
 
 
+/// \brief      Set the size of the buffers used by the I/O threads
+///
+/// Zero disables the I/O threads.
+extern void io_set_thread_buffer_size(uint64_t size);
+
+
 /// \brief      Open the source file
 extern file_pair *io_open_src(const char *src_name);
 
@@ -107,6 +129,20 @@ extern file_pair *io_open_src(const char *src_name);
 extern bool io_open_dest(file_pair *pair);
 
 
+/// \brief      Start the read-ahead and write-behind threads
+///
+/// This is called after io_open_src() and again after io_open_dest().
+/// A thread is started for each of the source and destination files
+/// that is a regular file and doesn't have a thread yet. Standard input
+/// is never read in a thread because its file position must be correct
+/// after --single-stream. If threads aren't supported or cannot be
+/// created, the files are accessed directly.
+///
+/// The threads are used only via io_read_chunk(), io_write_chunk_buf(),
+/// and io_write_chunk(). They are stopped by io_close().
+extern void io_start_threads(file_pair *pair);
+
+
 /// \brief      Closes the file descriptors and frees possible allocated memory
 ///
 /// The success argument determines if source or destination file gets
@@ -129,6 +165,27 @@ extern void io_close(file_pair *pair, bool success);
 extern size_t io_read(file_pair *pair, io_buf *buf, size_t size);
 
 
+/// \brief      Get the next chunk of input data
+///
+/// Unlike io_read(), this doesn't copy the data when the source file is
+/// read in a thread. Without a thread, up to IO_BUFFER_SIZE bytes are
+/// read into an internal buffer.
+///
+/// \param      pair    File pair having the source file open for reading
+/// \param      buf     The location of the data is stored here. It
+///                     remains valid until the next call.
+/// \param      size    Maximum number of bytes to return
+///
+/// \return     On success, number of bytes available in *buf is returned.
+///             It may be less than size even if end of file wasn't
+///             reached. On end of file zero is returned and
+///             pair->src_eof set to true; pair->src_eof may be set
+///             already with the last chunk of data. On error, SIZE_MAX
+///             is returned and error message printed.
+extern size_t io_read_chunk(file_pair *pair, const uint8_t **buf,
+		size_t size);
+
+
 /// \brief      Fix the position in src_fd
 ///
 /// This is used when --single-thream has been specified and decompression
@@ -180,3 +237,31 @@ extern bool io_pread(file_pair *pair, io_buf *buf, size_t size, uint64_t pos);
 /// \return     On success, zero is returned. On error, -1 is returned
 ///             and error message printed.
 extern bool io_write(file_pair *pair, const io_buf *buf, size_t size);
+
+
+/// \brief      Get a buffer for the next chunk of output data
+///
+/// With a write-behind thread, this waits until one of its buffers is
+/// free. Otherwise an internal buffer of IO_BUFFER_SIZE bytes is used.
+/// Calling this again without io_write_chunk() in between returns the
+/// same buffer.
+///
+/// \param      pair    File pair
+/// \param      size    The size of the buffer is stored here.
+///
+/// \return     Pointer to the buffer
+extern uint8_t *io_write_chunk_buf(file_pair *pair, size_t *size);
+
+
+/// \brief      Write the data in the buffer from io_write_chunk_buf()
+///
+/// With a write-behind thread, this only queues the buffer and returns.
+/// A write error is then reported by a later call or by io_close().
+/// Creation of sparse files works like with io_write().
+///
+/// \param      pair    File pair having the destination file open
+/// \param      size    Number of bytes to write from the buffer
+///
+/// \return     On success, false is returned. On error, error message
+///             is printed and true is returned.
+extern bool io_write_chunk(file_pair *pair, size_t size);
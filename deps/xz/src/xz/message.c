@@ -975,6 +975,12 @@ message_help(bool long_help)
 "                      ignore possible remaining input data"));
 		puts(_(
 "      --no-sparse     do not create sparse files when decompressing\n"
+"      --io-buffer-size=SIZE\n"
+"                      in multi-threaded mode, read and write regular files\n"
+"                      in separate threads using SIZE-byte buffers (0 = off)\n"
+"      --range=OFFSET:LEN\n"
+"                      decompress only LEN bytes starting at the uncompressed\n"
+"                      offset OFFSET; only the needed .xz blocks are read\n"
 "  -S, --suffix=.SUF   use the suffix '.SUF' on compressed files\n"
 "      --files[=FILE]  read filenames to process from FILE; if FILE is\n"
 "                      omitted, filenames are read from the standard input;\n"
@@ -1017,6 +1023,11 @@ message_help(bool long_help)
 "                      filter chain number (0-9) followed by a ':' before the\n"
 "                      uncompressed data size"));
 		puts(_(
+"      --adaptive-threads\n"
+"                      in threaded compression, let the block size and the\n"
+"                      number of threads change to fit the memory usage limit;\n"
+"                      the output then depends on timing"));
+		puts(_(
 "      --flush-timeout=TIMEOUT\n"
 "                      when compressing, if more than TIMEOUT milliseconds has\n"
 "                      passed since the previous flush and reading more input\n"
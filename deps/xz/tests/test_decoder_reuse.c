@@ -0,0 +1,186 @@
+// SPDX-License-Identifier: 0BSD
+
+///////////////////////////////////////////////////////////////////////////////
+//
+/// \file       test_decoder_reuse.c
+/// \brief      Tests decoding many files with one lzma_stream
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tests.h"
+
+
+// The second half of the data repeats the first half, so the encoded
+// data has matches at the distance of HALF_SIZE.
+#define HALF_SIZE (UINT32_C(200) << 10)
+#define IN_SIZE (2 * HALF_SIZE)
+#define FILE_BUF_SIZE (IN_SIZE + (IN_SIZE >> 2))
+
+#define DICT_BIG (UINT32_C(1) << 20)
+#define DICT_SMALL (UINT32_C(64) << 10)
+
+
+static uint8_t *in;
+static uint8_t *out;
+
+
+#if defined(HAVE_ENCODER_LZMA1) && defined(HAVE_DECODER_LZMA1)
+// Encode size bytes of in[] to a .lzma file with the given dictionary size.
+static uint8_t *
+encode_alone(uint32_t dict_size, size_t size, size_t *file_size)
+{
+	lzma_options_lzma opt;
+	assert_false(lzma_lzma_preset(&opt, 1));
+	opt.dict_size = dict_size;
+
+	lzma_stream strm = LZMA_STREAM_INIT;
+	assert_lzma_ret(lzma_alone_encoder(&strm, &opt), LZMA_OK);
+
+	uint8_t *file = tuktest_malloc(FILE_BUF_SIZE);
+	strm.next_in = in;
+	strm.avail_in = size;
+	strm.next_out = file;
+	strm.avail_out = FILE_BUF_SIZE;
+	assert_lzma_ret(lzma_code(&strm, LZMA_FINISH), LZMA_STREAM_END);
+
+	*file_size = (size_t)strm.total_out;
+	lzma_end(&strm);
+	return file;
+}
+
+
+static lzma_ret
+decode_alone(lzma_stream *strm, const uint8_t *file, size_t file_size)
+{
+	assert_lzma_ret(lzma_alone_decoder(strm, UINT64_MAX), LZMA_OK);
+
+	strm->next_in = file;
+	strm->avail_in = file_size;
+	strm->next_out = out;
+	strm->avail_out = IN_SIZE;
+	return lzma_code(strm, LZMA_FINISH);
+}
+#endif
+
+
+static void
+test_reuse_alone(void)
+{
+#if !defined(HAVE_ENCODER_LZMA1) || !defined(HAVE_DECODER_LZMA1)
+	assert_skip("LZMA1 encoder or decoder support disabled");
+#else
+	size_t big_size;
+	uint8_t *big = encode_alone(DICT_BIG, IN_SIZE, &big_size);
+
+	size_t small_size;
+	uint8_t *small = encode_alone(DICT_SMALL, HALF_SIZE, &small_size);
+
+	// The same data with a dictionary too small for the matches
+	uint8_t *bad = tuktest_malloc(big_size);
+	memcpy(bad, big, big_size);
+	write32le(bad + 1, DICT_SMALL);
+
+	lzma_stream strm = LZMA_STREAM_INIT;
+
+	// Grow the dictionary buffer, keep it, and then grow it again.
+	// Decode each file twice in a row to reuse the same buffer too.
+	static const int order[] = { 0, 0, 1, 1, 0, 1 };
+	for (size_t i = 0; i < ARRAY_SIZE(order); ++i) {
+		if (order[i] == 0) {
+			assert_lzma_ret(decode_alone(&strm, small, small_size),
+					LZMA_STREAM_END);
+			assert_uint_eq(strm.total_out, HALF_SIZE);
+		} else {
+			assert_lzma_ret(decode_alone(&strm, big, big_size),
+					LZMA_STREAM_END);
+			assert_uint_eq(strm.total_out, IN_SIZE);
+		}
+
+		assert_array_eq(out, in, (size_t)strm.total_out);
+	}
+
+	// The kept buffer is big enough for the matches in the bad file
+	// but the distances must still be checked against the dictionary
+	// size in the header.
+	assert_lzma_ret(decode_alone(&strm, bad, big_size), LZMA_DATA_ERROR);
+
+	// A fresh lzma_stream gives the same result.
+	lzma_end(&strm);
+	assert_lzma_ret(decode_alone(&strm, bad, big_size), LZMA_DATA_ERROR);
+
+	// The error doesn't break the next file.
+	assert_lzma_ret(decode_alone(&strm, big, big_size), LZMA_STREAM_END);
+	assert_array_eq(out, in, IN_SIZE);
+
+	lzma_end(&strm);
+#endif
+}
+
+
+static void
+test_reuse_stream(void)
+{
+#if !defined(HAVE_ENCODERS) || !defined(HAVE_ENCODER_LZMA2)
+	assert_skip("LZMA2 encoder support disabled");
+#elif !defined(HAVE_DECODERS) || !defined(HAVE_DECODER_LZMA2)
+	assert_skip("LZMA2 decoder support disabled");
+#else
+	// Many small .xz files that use different presets and thus
+	// different dictionary sizes
+	static const uint32_t presets[] = { 6, 0, 1, 6, 3, 0, 7 };
+
+	uint8_t *file = tuktest_malloc(FILE_BUF_SIZE);
+	lzma_stream strm = LZMA_STREAM_INIT;
+
+	for (size_t i = 0; i < 50; ++i) {
+		const size_t size = 1 + (i * 997) % 5000;
+		const uint8_t *data = in + i * 313;
+
+		size_t file_size = 0;
+		assert_lzma_ret(lzma_easy_buffer_encode(
+				presets[i % ARRAY_SIZE(presets)],
+				LZMA_CHECK_CRC32, NULL, data, size,
+				file, &file_size, FILE_BUF_SIZE), LZMA_OK);
+
+		assert_lzma_ret(lzma_stream_decoder(&strm, UINT64_MAX, 0),
+				LZMA_OK);
+
+		strm.next_in = file;
+		strm.avail_in = file_size;
+		strm.next_out = out;
+		strm.avail_out = IN_SIZE;
+		assert_lzma_ret(lzma_code(&strm, LZMA_FINISH),
+				LZMA_STREAM_END);
+
+		assert_uint_eq(strm.total_in, file_size);
+		assert_uint_eq(strm.total_out, size);
+		assert_array_eq(out, data, size);
+	}
+
+	lzma_end(&strm);
+#endif
+}
+
+
+extern int
+main(int argc, char **argv)
+{
+	tuktest_start(argc, argv);
+
+	in = tuktest_malloc(IN_SIZE);
+	out = tuktest_malloc(IN_SIZE);
+
+	// Random first half that doesn't compress
+	uint32_t x = 1;
+	for (size_t i = 0; i < HALF_SIZE; ++i) {
+		x = x * 1103515245 + 12345;
+		in[i] = (uint8_t)(x >> 23);
+	}
+
+	memcpy(in + HALF_SIZE, in, HALF_SIZE);
+
+	tuktest_run(test_reuse_alone);
+	tuktest_run(test_reuse_stream);
+
+	return tuktest_end();
+}
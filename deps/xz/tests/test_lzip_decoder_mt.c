@@ -0,0 +1,385 @@
+// SPDX-License-Identifier: 0BSD
+
+///////////////////////////////////////////////////////////////////////////////
+//
+/// \file       test_lzip_decoder_mt.c
+/// \brief      Tests the multithreaded lzip decoder against the normal one
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tests.h"
+#include "mythread.h"
+
+
+#define IN_SIZE (UINT32_C(700) << 10)
+#define FILE_BUF_SIZE (IN_SIZE + (UINT32_C(64) << 10))
+#define MEMBERS 9
+
+// Dictionary size 64 KiB in the .lz header
+#define DICT_SIZE (UINT32_C(64) << 10)
+#define DICT_SIZE_BYTE 0x10
+
+
+#if defined(HAVE_LZIP_DECODER) && defined(MYTHREAD_ENABLED) \
+		&& defined(HAVE_ENCODER_LZMA1)
+static uint8_t *in;
+static uint8_t *file;
+static size_t file_size;
+static uint8_t *out;
+
+
+// Append in[first..last) as one .lz member to file[file_size].
+static void
+encode_member(size_t first, size_t last)
+{
+	lzma_options_lzma opt;
+	assert_false(lzma_lzma_preset(&opt, 1));
+	opt.dict_size = DICT_SIZE;
+	opt.lc = 3;
+	opt.lp = 0;
+	opt.pb = 2;
+
+	const lzma_filter filters[2] = {
+		{ .id = LZMA_FILTER_LZMA1, .options = &opt },
+		{ .id = LZMA_VLI_UNKNOWN, .options = NULL },
+	};
+
+	uint8_t *member = file + file_size;
+	const uint8_t header[6] = {
+		0x4C, 0x5A, 0x49, 0x50, 1, DICT_SIZE_BYTE
+	};
+	memcpy(member, header, sizeof(header));
+
+	// The raw LZMA1 encoder writes the end of payload marker
+	// which is required in the .lz format.
+	lzma_stream strm = LZMA_STREAM_INIT;
+	assert_lzma_ret(lzma_raw_encoder(&strm, filters), LZMA_OK);
+	strm.next_in = in + first;
+	strm.avail_in = last - first;
+	strm.next_out = member + sizeof(header);
+	strm.avail_out = FILE_BUF_SIZE - file_size - sizeof(header) - 20;
+	assert_lzma_ret(lzma_code(&strm, LZMA_FINISH), LZMA_STREAM_END);
+
+	const size_t member_size = sizeof(header) + (size_t)strm.total_out
+			+ 20;
+	lzma_end(&strm);
+
+	uint8_t *footer = member + member_size - 20;
+	write32le(footer, lzma_crc32(in + first, last - first, 0));
+	write64le(footer + 4, last - first);
+	write64le(footer + 12, member_size);
+
+	file_size += member_size;
+}
+
+
+// Decode buf[0..size) single-shot with lzma_lzip_decoder() into dest[].
+static lzma_ret
+decode_st(const uint8_t *buf, size_t size, uint8_t *dest, size_t *out_size)
+{
+	lzma_stream strm = LZMA_STREAM_INIT;
+	assert_lzma_ret(lzma_lzip_decoder(&strm, UINT64_MAX,
+			LZMA_CONCATENATED), LZMA_OK);
+	strm.next_in = buf;
+	strm.avail_in = size;
+	strm.next_out = dest;
+	strm.avail_out = IN_SIZE;
+
+	lzma_ret ret;
+	do {
+		ret = lzma_code(&strm, LZMA_FINISH);
+	} while (ret == LZMA_OK);
+
+	*out_size = (size_t)strm.total_out;
+	lzma_end(&strm);
+	return ret;
+}
+
+
+// Decode buf[0..size) with lzma_lzip_decoder_mt() into out[]. Input is
+// given in pieces of chunk bytes. Zero chunk means single-shot decoding.
+// The uncompressed size is stored in *out_size.
+static lzma_ret
+decode_mt(const uint8_t *buf, size_t size, const lzma_mt *mt, size_t chunk,
+		size_t *out_size)
+{
+	lzma_stream strm = LZMA_STREAM_INIT;
+	assert_lzma_ret(lzma_lzip_decoder_mt(&strm, mt), LZMA_OK);
+
+	strm.next_in = buf;
+	strm.next_out = out;
+	strm.avail_out = IN_SIZE;
+
+	lzma_ret ret;
+	do {
+		const size_t in_used = (size_t)strm.total_in;
+		const size_t avail = size - in_used;
+		strm.avail_in = chunk == 0 ? avail : my_min(chunk, avail);
+
+		ret = lzma_code(&strm, strm.avail_in == avail
+				? LZMA_FINISH : LZMA_RUN);
+	} while (ret == LZMA_OK);
+
+	*out_size = (size_t)strm.total_out;
+	lzma_end(&strm);
+	return ret;
+}
+
+
+static void
+test_lzip_mt_options(void)
+{
+	lzma_mt mt;
+	memzero(&mt, sizeof(mt));
+	mt.memlimit_stop = UINT64_MAX;
+
+	lzma_stream strm = LZMA_STREAM_INIT;
+	assert_lzma_ret(lzma_lzip_decoder_mt(&strm, &mt), LZMA_OPTIONS_ERROR);
+
+	mt.threads = 2;
+	mt.flags = UINT32_MAX;
+	assert_lzma_ret(lzma_lzip_decoder_mt(&strm, &mt), LZMA_OPTIONS_ERROR);
+
+	lzma_end(&strm);
+}
+
+
+static void
+test_lzip_mt_members(void)
+{
+	lzma_mt mt;
+	memzero(&mt, sizeof(mt));
+	mt.flags = LZMA_CONCATENATED;
+	mt.threads = 3;
+	mt.memlimit_threading = UINT64_MAX;
+	mt.memlimit_stop = UINT64_MAX;
+
+	// Single-shot decoding and input in pieces, including pieces
+	// smaller than the .lz header and footer
+	static const size_t chunks[] = { 0, 1, 13, 4096, 100000 };
+
+	for (size_t i = 0; i < ARRAY_SIZE(chunks); ++i) {
+		// One byte at a time is slow so do only a part of the file.
+		const size_t size = chunks[i] == 1 ? 2000 : file_size;
+
+		size_t out_size;
+		const lzma_ret ret = decode_mt(file, size, &mt, chunks[i],
+				&out_size);
+		if (size == file_size) {
+			assert_lzma_ret(ret, LZMA_STREAM_END);
+			assert_uint_eq(out_size, IN_SIZE);
+		} else {
+			assert_lzma_ret(ret, LZMA_BUF_ERROR);
+		}
+
+		assert_array_eq(out, in, out_size);
+	}
+
+	// Without LZMA_CONCATENATED only the first member is decoded.
+	mt.flags = 0;
+	size_t out_size;
+	assert_lzma_ret(decode_mt(file, file_size, &mt, 0, &out_size),
+			LZMA_STREAM_END);
+	assert_uint(out_size, <, IN_SIZE);
+	assert_array_eq(out, in, out_size);
+
+	// Trailing data after the last member is ignored.
+	mt.flags = LZMA_CONCATENATED;
+	memcpy(file + file_size, "Trailing data", 13);
+	assert_lzma_ret(decode_mt(file, file_size + 13, &mt, 4096,
+			&out_size), LZMA_STREAM_END);
+	assert_uint_eq(out_size, IN_SIZE);
+	assert_array_eq(out, in, IN_SIZE);
+}
+
+
+static void
+test_lzip_mt_memlimit(void)
+{
+	lzma_mt mt;
+	memzero(&mt, sizeof(mt));
+	mt.flags = LZMA_CONCATENATED;
+	mt.threads = 4;
+	mt.memlimit_stop = UINT64_MAX;
+
+	// A memlimit_threading that allows threaded decoding of one or
+	// two members at a time, and one so low that all members are
+	// decoded in direct mode
+	static const uint64_t limits[] = { 2 << 20, 600 << 10, 1 };
+
+	for (size_t i = 0; i < ARRAY_SIZE(limits); ++i) {
+		mt.memlimit_threading = limits[i];
+
+		size_t out_size;
+		assert_lzma_ret(decode_mt(file, file_size, &mt, 30000,
+				&out_size), LZMA_STREAM_END);
+		assert_uint_eq(out_size, IN_SIZE);
+		assert_array_eq(out, in, IN_SIZE);
+	}
+
+	// Too low memlimit_stop. The limit can be increased to continue.
+	mt.memlimit_threading = UINT64_MAX;
+	mt.memlimit_stop = 1 << 10;
+
+	lzma_stream strm = LZMA_STREAM_INIT;
+	assert_lzma_ret(lzma_lzip_decoder_mt(&strm, &mt), LZMA_OK);
+	strm.next_in = file;
+	strm.avail_in = file_size;
+	strm.next_out = out;
+	strm.avail_out = IN_SIZE;
+
+	assert_lzma_ret(lzma_code(&strm, LZMA_FINISH), LZMA_MEMLIMIT_ERROR);
+	assert_uint(lzma_memusage(&strm), >, DICT_SIZE);
+	assert_lzma_ret(lzma_memlimit_set(&strm, UINT64_MAX), LZMA_OK);
+	assert_lzma_ret(lzma_code(&strm, LZMA_FINISH), LZMA_STREAM_END);
+	assert_uint_eq(strm.total_out, IN_SIZE);
+	assert_array_eq(out, in, IN_SIZE);
+
+	lzma_end(&strm);
+}
+
+
+static void
+test_lzip_mt_corrupt(void)
+{
+	lzma_mt mt;
+	memzero(&mt, sizeof(mt));
+	mt.flags = LZMA_CONCATENATED;
+	mt.threads = 3;
+	mt.memlimit_threading = UINT64_MAX;
+	mt.memlimit_stop = UINT64_MAX;
+
+	// All output up to the point where the error is detected is
+	// available like with the single-threaded decoder. With
+	// LZMA_FAIL_FAST the error may be returned earlier.
+	uint8_t *expected = tuktest_malloc(IN_SIZE);
+	const size_t corrupt_pos = file_size / 2;
+	file[corrupt_pos] ^= 0x01;
+
+	size_t expected_size;
+	assert_lzma_ret(decode_st(file, file_size, expected, &expected_size),
+			LZMA_DATA_ERROR);
+
+	size_t out_size;
+	assert_lzma_ret(decode_mt(file, file_size, &mt, 0, &out_size),
+			LZMA_DATA_ERROR);
+	assert_uint_eq(out_size, expected_size);
+	assert_array_eq(out, expected, out_size);
+
+	mt.flags |= LZMA_FAIL_FAST;
+	assert_lzma_ret(decode_mt(file, file_size, &mt, 4096, &out_size),
+			LZMA_DATA_ERROR);
+	assert_uint(out_size, <=, expected_size);
+	assert_array_eq(out, expected, out_size);
+
+	file[corrupt_pos] ^= 0x01;
+	tuktest_free(expected);
+
+	// Truncated file
+	mt.flags = LZMA_CONCATENATED;
+	assert_lzma_ret(decode_mt(file, file_size - 1, &mt, 0, &out_size),
+			LZMA_BUF_ERROR);
+	assert_array_eq(out, in, out_size);
+}
+
+
+// Decode a test file with both decoders and compare the results.
+static void
+test_lzip_mt_files(void)
+{
+	static const char *const names[] = {
+		"files/good-1-v0.lz",
+		"files/good-1-v1.lz",
+		"files/good-1-v0-trailing-1.lz",
+		"files/good-1-v1-trailing-1.lz",
+		"files/good-1-v1-trailing-2.lz",
+		"files/good-2-v0-v1.lz",
+		"files/good-2-v1-v0.lz",
+		"files/good-2-v1-v1.lz",
+		"files/bad-1-v0-uncomp-size.lz",
+		"files/bad-1-v1-crc32.lz",
+		"files/bad-1-v1-dict-1.lz",
+		"files/bad-1-v1-dict-2.lz",
+		"files/bad-1-v1-magic-1.lz",
+		"files/bad-1-v1-magic-2.lz",
+		"files/bad-1-v1-member-size.lz",
+		"files/bad-1-v1-trailing-magic.lz",
+		"files/bad-1-v1-uncomp-size.lz",
+		"files/unsupported-1-v234.lz",
+	};
+
+	lzma_mt mt;
+	memzero(&mt, sizeof(mt));
+	mt.flags = LZMA_CONCATENATED;
+	mt.threads = 2;
+	mt.memlimit_threading = UINT64_MAX;
+	mt.memlimit_stop = UINT64_MAX;
+
+	uint8_t *expected = tuktest_malloc(IN_SIZE);
+
+	for (size_t i = 0; i < ARRAY_SIZE(names); ++i) {
+		size_t size;
+		uint8_t *data = tuktest_file_from_srcdir(names[i], &size);
+
+		size_t expected_size;
+		const lzma_ret expected_ret = decode_st(data, size, expected,
+				&expected_size);
+
+		for (size_t chunk = 0; chunk <= 7; chunk += 7) {
+			size_t out_size;
+			assert_lzma_ret(decode_mt(data, size, &mt, chunk,
+					&out_size), expected_ret);
+			assert_uint_eq(out_size, expected_size);
+			assert_array_eq(out, expected, out_size);
+		}
+
+		tuktest_free(data);
+	}
+
+	tuktest_free(expected);
+}
+#endif
+
+
+extern int
+main(int argc, char **argv)
+{
+	tuktest_start(argc, argv);
+
+#ifndef HAVE_LZIP_DECODER
+	tuktest_early_skip("lzip decoder support disabled");
+#elif !defined(HAVE_ENCODER_LZMA1)
+	tuktest_early_skip("LZMA1 encoder support disabled");
+#elif !defined(MYTHREAD_ENABLED)
+	tuktest_early_skip("Threading support disabled");
+#else
+	in = tuktest_malloc(IN_SIZE);
+	file = tuktest_malloc(FILE_BUF_SIZE);
+	out = tuktest_malloc(IN_SIZE);
+
+	// Text-like data that compresses reasonably well
+	uint32_t x = 1;
+	for (size_t i = 0; i < IN_SIZE; ++i) {
+		x = x * 1103515245 + 12345;
+		in[i] = (uint8_t)('a' + (x >> 16) % ((x >> 30) + 3));
+	}
+
+	// Members of varying sizes like plzip would create, and one
+	// empty member
+	size_t pos = 0;
+	for (uint32_t i = 0; i < MEMBERS; ++i) {
+		const size_t size = i == 3 ? 0 : i == MEMBERS - 1
+				? IN_SIZE - pos : (i + 1) * (UINT32_C(13) << 10);
+		encode_member(pos, pos + size);
+		pos += size;
+	}
+
+	tuktest_run(test_lzip_mt_options);
+	tuktest_run(test_lzip_mt_members);
+	tuktest_run(test_lzip_mt_memlimit);
+	tuktest_run(test_lzip_mt_corrupt);
+	tuktest_run(test_lzip_mt_files);
+#endif
+
+	return tuktest_end();
+}
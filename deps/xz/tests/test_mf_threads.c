@@ -0,0 +1,292 @@
+// SPDX-License-Identifier: 0BSD
+
+///////////////////////////////////////////////////////////////////////////////
+//
+/// \file       test_mf_threads.c
+/// \brief      Tests that a match finder thread doesn't change the output
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tests.h"
+#include "mythread.h"
+
+
+// The dictionary is small so that the input window gets moved several
+// times, and the input is given in pieces of varying size with a few
+// LZMA_SYNC_FLUSHes in between.
+#define DICT_SIZE (UINT32_C(64) << 10)
+#define IN_SIZE (UINT32_C(1536) << 10)
+#define OUT_SIZE (IN_SIZE + IN_SIZE / 8)
+#define SYNC_FLUSH_INTERVAL (UINT32_C(400) << 10)
+
+
+static uint8_t *in;
+static uint8_t *out_ref;
+static uint8_t *out_mt;
+static uint8_t *decoded;
+
+
+// Fill buf with text-like data that has long matches, some of them
+// further away than the dictionary size, and some noise.
+static void
+fill(uint8_t *buf, size_t size)
+{
+	uint32_t x = 1;
+	size_t i = 0;
+
+	while (i < size) {
+		x = x * 1103515245 + 12345;
+		size_t n = 1 + (x >> 8) % 300;
+		if (n > size - i)
+			n = size - i;
+
+		if ((x >> 20) % 4 == 0 || i < 1000) {
+			while (n-- > 0) {
+				x = x * 1103515245 + 12345;
+				buf[i++] = (uint8_t)('a' + (x >> 16) % 26);
+			}
+		} else {
+			const size_t dist = (x >> 22) % 8 == 0
+					? 1 + (x >> 4) % my_min(i, 200000)
+					: 1 + (x >> 4) % my_min(i, 999);
+			while (n-- > 0) {
+				buf[i] = buf[i - dist];
+				++i;
+			}
+		}
+	}
+}
+
+
+#if defined(HAVE_ENCODER_LZMA2) && defined(HAVE_DECODER_LZMA2)
+// Encode in[] with the raw encoder and return the compressed size.
+static size_t
+encode_raw(const lzma_filter *filters, uint8_t *out)
+{
+	lzma_stream strm = LZMA_STREAM_INIT;
+	assert_lzma_ret(lzma_raw_encoder(&strm, filters), LZMA_OK);
+
+	strm.next_out = out;
+	strm.avail_out = OUT_SIZE;
+
+	uint32_t x = 7;
+	size_t in_pos = 0;
+	size_t flush_pos = SYNC_FLUSH_INTERVAL;
+
+	while (in_pos < IN_SIZE) {
+		x = x * 1103515245 + 12345;
+		size_t n = my_min(1 + (x >> 8) % 70000, IN_SIZE - in_pos);
+
+		lzma_action action = LZMA_RUN;
+		if (in_pos + n >= flush_pos) {
+			n = flush_pos - in_pos;
+			flush_pos += SYNC_FLUSH_INTERVAL;
+			action = LZMA_SYNC_FLUSH;
+		}
+
+		strm.next_in = in + in_pos;
+		strm.avail_in = n;
+		in_pos += n;
+
+		assert_lzma_ret(lzma_code(&strm, action),
+				action == LZMA_RUN ? LZMA_OK : LZMA_STREAM_END);
+		assert_uint_eq(strm.avail_in, 0);
+	}
+
+	assert_lzma_ret(lzma_code(&strm, LZMA_FINISH), LZMA_STREAM_END);
+
+	const size_t out_size = (size_t)strm.total_out;
+	lzma_end(&strm);
+	return out_size;
+}
+#endif
+
+
+static void
+test_mf_threads_raw(void)
+{
+#if !defined(HAVE_ENCODER_LZMA2) || !defined(HAVE_DECODER_LZMA2)
+	assert_skip("LZMA2 encoder or decoder support disabled");
+#else
+	static const lzma_match_finder mfs[] = {
+		LZMA_MF_HC3,
+		LZMA_MF_HC4,
+		LZMA_MF_BT2,
+		LZMA_MF_BT3,
+		LZMA_MF_BT4,
+	};
+
+	for (size_t i = 0; i < ARRAY_SIZE(mfs); ++i) {
+		if (!lzma_mf_is_supported(mfs[i]))
+			continue;
+
+		lzma_options_lzma opt;
+		assert_false(lzma_lzma_preset(&opt, 6));
+		assert_uint_eq(opt.mf_threads, 0);
+		opt.dict_size = DICT_SIZE;
+		opt.mf = mfs[i];
+		opt.nice_len = i == ARRAY_SIZE(mfs) - 1 ? 273 : 64;
+
+		// Use a preset dictionary with the last match finder.
+		if (i == ARRAY_SIZE(mfs) - 1) {
+			opt.preset_dict = in + IN_SIZE - 20000;
+			opt.preset_dict_size = 20000;
+		}
+
+		lzma_filter filters[2] = {
+			{ .id = LZMA_FILTER_LZMA2, .options = &opt },
+			{ .id = LZMA_VLI_UNKNOWN, .options = NULL },
+		};
+
+		const size_t ref_size = encode_raw(filters, out_ref);
+
+		opt.mode |= LZMA_MODE_MF_THREADS;
+		opt.mf_threads = 1;
+		const size_t mt_size = encode_raw(filters, out_mt);
+
+		assert_uint_eq(mt_size, ref_size);
+		assert_array_eq(out_mt, out_ref, ref_size);
+
+		// Check that the output decodes correctly.
+		lzma_stream strm = LZMA_STREAM_INIT;
+		assert_lzma_ret(lzma_raw_decoder(&strm, filters), LZMA_OK);
+		strm.next_in = out_mt;
+		strm.avail_in = mt_size;
+		strm.next_out = decoded;
+		strm.avail_out = IN_SIZE;
+		assert_lzma_ret(lzma_code(&strm, LZMA_FINISH), LZMA_STREAM_END);
+		assert_uint_eq(strm.total_out, IN_SIZE);
+		assert_array_eq(decoded, in, IN_SIZE);
+		lzma_end(&strm);
+	}
+#endif
+}
+
+
+static void
+test_mf_threads_stream(void)
+{
+#ifndef HAVE_ENCODER_LZMA2
+	assert_skip("LZMA2 encoder support disabled");
+#else
+	// Every Block reinitializes the encoder, which keeps
+	// the match finder thread.
+	lzma_options_lzma opt;
+	assert_false(lzma_lzma_preset(&opt, 9));
+	opt.mode |= LZMA_MODE_MF_THREADS;
+	opt.dict_size = DICT_SIZE;
+
+	lzma_filter filters[2] = {
+		{ .id = LZMA_FILTER_LZMA2, .options = &opt },
+		{ .id = LZMA_VLI_UNKNOWN, .options = NULL },
+	};
+
+	uint8_t *outs[2] = { out_ref, out_mt };
+	size_t sizes[2];
+
+	for (uint32_t i = 0; i < 2; ++i) {
+		opt.mf_threads = i;
+
+		lzma_stream strm = LZMA_STREAM_INIT;
+		assert_lzma_ret(lzma_stream_encoder(&strm, filters,
+				LZMA_CHECK_CRC32), LZMA_OK);
+
+		strm.next_out = outs[i];
+		strm.avail_out = OUT_SIZE;
+
+		for (size_t pos = 0; pos < IN_SIZE; pos += IN_SIZE / 3) {
+			strm.next_in = in + pos;
+			strm.avail_in = IN_SIZE / 3;
+			assert_lzma_ret(lzma_code(&strm, LZMA_FULL_FLUSH),
+					LZMA_STREAM_END);
+		}
+
+		assert_lzma_ret(lzma_code(&strm, LZMA_FINISH),
+				LZMA_STREAM_END);
+		sizes[i] = (size_t)strm.total_out;
+		lzma_end(&strm);
+	}
+
+	assert_uint_eq(sizes[1], sizes[0]);
+	assert_array_eq(out_mt, out_ref, sizes[0]);
+#endif
+}
+
+
+static void
+test_mf_threads_stream_mt(void)
+{
+#ifndef MYTHREAD_ENABLED
+	assert_skip("Threading support disabled");
+#elif !defined(HAVE_ENCODER_LZMA2)
+	assert_skip("LZMA2 encoder support disabled");
+#else
+	lzma_options_lzma opt;
+	assert_false(lzma_lzma_preset(&opt, 7));
+	opt.dict_size = DICT_SIZE;
+
+	lzma_filter filters[2] = {
+		{ .id = LZMA_FILTER_LZMA2, .options = &opt },
+		{ .id = LZMA_VLI_UNKNOWN, .options = NULL },
+	};
+
+	lzma_mt mt = {
+		.flags = 0,
+		.threads = 2,
+		.block_size = IN_SIZE / 2 + 1,
+		.timeout = 0,
+		.filters = filters,
+		.check = LZMA_CHECK_CRC64,
+	};
+
+	// mf_threads is ignored without LZMA_MODE_MF_THREADS.
+	// The match finder thread needs a little memory.
+	const uint64_t memusage = lzma_stream_encoder_mt_memusage(&mt);
+	opt.mf_threads = 1;
+	assert_uint_eq(lzma_stream_encoder_mt_memusage(&mt), memusage);
+	opt.mode |= LZMA_MODE_MF_THREADS;
+	assert_uint(lzma_stream_encoder_mt_memusage(&mt), >, memusage);
+
+	uint8_t *outs[2] = { out_ref, out_mt };
+	size_t sizes[2];
+
+	for (uint32_t i = 0; i < 2; ++i) {
+		opt.mf_threads = i;
+
+		lzma_stream strm = LZMA_STREAM_INIT;
+		assert_lzma_ret(lzma_stream_encoder_mt(&strm, &mt), LZMA_OK);
+
+		strm.next_in = in;
+		strm.avail_in = IN_SIZE;
+		strm.next_out = outs[i];
+		strm.avail_out = OUT_SIZE;
+
+		assert_lzma_ret(lzma_code(&strm, LZMA_FINISH),
+				LZMA_STREAM_END);
+		sizes[i] = (size_t)strm.total_out;
+		lzma_end(&strm);
+	}
+
+	assert_uint_eq(sizes[1], sizes[0]);
+	assert_array_eq(out_mt, out_ref, sizes[0]);
+#endif
+}
+
+
+extern int
+main(int argc, char **argv)
+{
+	tuktest_start(argc, argv);
+
+	in = tuktest_malloc(IN_SIZE);
+	out_ref = tuktest_malloc(OUT_SIZE);
+	out_mt = tuktest_malloc(OUT_SIZE);
+	decoded = tuktest_malloc(IN_SIZE);
+	fill(in, IN_SIZE);
+
+	tuktest_run(test_mf_threads_raw);
+	tuktest_run(test_mf_threads_stream);
+	tuktest_run(test_mf_threads_stream_mt);
+
+	return tuktest_end();
+}
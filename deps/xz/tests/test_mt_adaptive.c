@@ -0,0 +1,293 @@
+// SPDX-License-Identifier: 0BSD
+
+///////////////////////////////////////////////////////////////////////////////
+//
+/// \file       test_mt_adaptive.c
+/// \brief      Tests LZMA_MT_ADAPTIVE of the multithreaded .xz encoder
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tests.h"
+#include "mythread.h"
+
+
+#define THREADS 4
+#define BLOCK_SIZE_MAX (UINT32_C(2) << 20)
+#define BLOCK_SIZE_MIN (UINT32_C(1) << 20)
+
+// The first part of the input is given slowly so that the worker threads
+// have compressed almost all of it by the time the next part is given.
+#define SLOW_SIZE (UINT32_C(8) << 20)
+#define SLOW_CHUNK (UINT32_C(64) << 10)
+#define IN_SIZE (UINT32_C(16) << 20)
+#define OUT_SIZE (IN_SIZE + IN_SIZE / 8)
+
+
+static uint8_t *in;
+static uint8_t *out;
+static uint8_t *decoded;
+
+
+#if defined(MYTHREAD_ENABLED) && defined(HAVE_ENCODER_LZMA2)
+static lzma_mt
+get_mt_options(uint32_t flags, uint32_t threads, uint64_t memlimit)
+{
+	lzma_mt mt;
+	memzero(&mt, sizeof(mt));
+	mt.flags = flags;
+	mt.threads = threads;
+	mt.block_size = BLOCK_SIZE_MAX;
+	mt.preset = 0;
+	mt.check = LZMA_CHECK_CRC32;
+	mt.memlimit_threading = memlimit;
+	return mt;
+}
+
+
+// Initialize the encoder and check that lzma_stream_encoder_mt_get()
+// agrees with lzma_stream_encoder_mt_memusage().
+static lzma_mt
+init_and_get(lzma_stream *strm, const lzma_mt *mt)
+{
+	assert_lzma_ret(lzma_stream_encoder_mt(strm, mt), LZMA_OK);
+
+	lzma_mt got;
+	memzero(&got, sizeof(got));
+	assert_lzma_ret(lzma_stream_encoder_mt_get(strm, &got), LZMA_OK);
+
+	assert_uint_eq(got.flags, mt->flags);
+	assert_uint_eq(got.check, mt->check);
+	assert_uint_eq(got.memlimit_threading, mt->memlimit_threading);
+	assert_uint_eq(got.memusage, lzma_stream_encoder_mt_memusage(mt));
+	assert_true(got.threads >= 1);
+	assert_true(got.threads <= mt->threads);
+	assert_true(got.jobs > got.threads);
+	assert_true(got.jobs <= 2 * got.threads);
+
+	return got;
+}
+#endif
+
+
+static void
+test_mt_adaptive_config(void)
+{
+#ifndef MYTHREAD_ENABLED
+	assert_skip("Threading support disabled");
+#elif !defined(HAVE_ENCODER_LZMA2)
+	assert_skip("LZMA2 encoder support disabled");
+#else
+	lzma_stream strm = LZMA_STREAM_INIT;
+
+	// Unknown encoder flags are rejected.
+	lzma_mt mt = get_mt_options(LZMA_CONCATENATED, THREADS, UINT64_MAX);
+	assert_lzma_ret(lzma_stream_encoder_mt(&strm, &mt),
+			LZMA_OPTIONS_ERROR);
+	assert_uint_eq(lzma_stream_encoder_mt_memusage(&mt), UINT64_MAX);
+
+	// Without LZMA_MT_ADAPTIVE the options are used as is.
+	mt = get_mt_options(0, THREADS, 1);
+	const uint64_t full = lzma_stream_encoder_mt_memusage(&mt);
+	lzma_mt got = init_and_get(&strm, &mt);
+	assert_uint_eq(got.threads, THREADS);
+	assert_uint_eq(got.jobs, 2 * THREADS);
+	assert_uint_eq(got.block_size, BLOCK_SIZE_MAX);
+	assert_uint_eq(got.memusage, full);
+
+	// A big enough budget doesn't change anything either.
+	mt = get_mt_options(LZMA_MT_ADAPTIVE, THREADS, full);
+	got = init_and_get(&strm, &mt);
+	assert_uint_eq(got.threads, THREADS);
+	assert_uint_eq(got.jobs, 2 * THREADS);
+	assert_uint_eq(got.block_size, BLOCK_SIZE_MAX);
+
+	// Slightly too small budget reduces only the number of Blocks
+	// in flight.
+	mt = get_mt_options(LZMA_MT_ADAPTIVE, THREADS, full - 1);
+	got = init_and_get(&strm, &mt);
+	assert_uint_eq(got.threads, THREADS);
+	assert_uint_eq(got.jobs, 2 * THREADS - 1);
+	assert_uint_eq(got.block_size, BLOCK_SIZE_MAX);
+	assert_true(got.memusage <= mt.memlimit_threading);
+
+	// The smallest settings
+	mt = get_mt_options(LZMA_MT_ADAPTIVE, THREADS, 1);
+	const uint64_t smallest = lzma_stream_encoder_mt_memusage(&mt);
+
+	// Going through smaller budgets, the Block size is reduced before
+	// the number of threads, and the budget is always met.
+	uint32_t prev_threads = THREADS;
+	uint64_t prev_block_size = BLOCK_SIZE_MAX;
+	bool block_size_reduced = false;
+	for (uint64_t limit = full; limit >= smallest; limit -= full / 64) {
+		mt = get_mt_options(LZMA_MT_ADAPTIVE, THREADS, limit);
+		got = init_and_get(&strm, &mt);
+
+		assert_true(got.memusage <= limit);
+		assert_true(got.block_size >= BLOCK_SIZE_MIN);
+		assert_true(got.block_size <= BLOCK_SIZE_MAX);
+		assert_true(got.threads <= prev_threads);
+
+		if (got.threads == prev_threads) {
+			assert_true(got.block_size <= prev_block_size);
+		} else {
+			// The previous number of threads didn't fit even
+			// with the smallest Blocks.
+			assert_true(block_size_reduced);
+		}
+
+		if (got.block_size < BLOCK_SIZE_MAX)
+			block_size_reduced = true;
+
+		prev_threads = got.threads;
+		prev_block_size = got.block_size;
+	}
+
+	assert_true(prev_threads < THREADS);
+
+	// If one thread doesn't fit, the smallest settings are used
+	// anyway and the initialization doesn't fail.
+	mt = get_mt_options(LZMA_MT_ADAPTIVE, THREADS, smallest - 1);
+	got = init_and_get(&strm, &mt);
+	assert_uint_eq(got.threads, 1);
+	assert_uint_eq(got.jobs, 2);
+	assert_uint_eq(got.block_size, BLOCK_SIZE_MIN);
+	assert_uint_eq(got.memusage, smallest);
+
+	lzma_end(&strm);
+
+	// The function works only with the multithreaded encoder.
+	assert_lzma_ret(lzma_easy_encoder(&strm, 0, LZMA_CHECK_CRC32),
+			LZMA_OK);
+	assert_lzma_ret(lzma_stream_encoder_mt_get(&strm, &got),
+			LZMA_PROG_ERROR);
+	lzma_end(&strm);
+	assert_lzma_ret(lzma_stream_encoder_mt_get(&strm, &got),
+			LZMA_PROG_ERROR);
+#endif
+}
+
+
+static void
+test_mt_adaptive_encode(void)
+{
+#ifndef MYTHREAD_ENABLED
+	assert_skip("Threading support disabled");
+#elif !defined(HAVE_ENCODER_LZMA2)
+	assert_skip("LZMA2 encoder support disabled");
+#elif !defined(HAVE_DECODERS) || !defined(HAVE_DECODER_LZMA2)
+	assert_skip("LZMA2 decoder support disabled");
+#else
+	// The budget fits two threads with the biggest Blocks.
+	lzma_mt mt = get_mt_options(0, 2, 0);
+	const uint64_t memlimit = lzma_stream_encoder_mt_memusage(&mt);
+	mt = get_mt_options(LZMA_MT_ADAPTIVE, THREADS, memlimit);
+
+	lzma_stream strm = LZMA_STREAM_INIT;
+	const lzma_mt first = init_and_get(&strm, &mt);
+	assert_true(first.threads > 2);
+	assert_true(first.block_size < BLOCK_SIZE_MAX);
+
+	strm.next_in = in;
+	strm.next_out = out;
+	strm.avail_out = OUT_SIZE;
+
+	// Give the input in small chunks and wait until the threads
+	// have caught up after each chunk. Then fewer threads with
+	// bigger Blocks are enough.
+	while (strm.total_in < SLOW_SIZE) {
+		strm.avail_in = SLOW_CHUNK;
+		assert_lzma_ret(lzma_code(&strm, LZMA_RUN), LZMA_OK);
+		assert_uint_eq(strm.avail_in, 0);
+
+		uint64_t progress_in;
+		uint64_t progress_out;
+		do {
+			lzma_get_progress(&strm, &progress_in, &progress_out);
+		} while (progress_in < strm.total_in);
+	}
+
+	lzma_mt got;
+	assert_lzma_ret(lzma_stream_encoder_mt_get(&strm, &got), LZMA_OK);
+	assert_true(got.threads < first.threads);
+	assert_uint_eq(got.block_size, BLOCK_SIZE_MAX);
+	assert_true(got.memusage <= memlimit);
+
+	// Give the rest at once. More threads are needed again.
+	strm.avail_in = IN_SIZE - SLOW_SIZE;
+	assert_lzma_ret(lzma_code(&strm, LZMA_RUN), LZMA_OK);
+	assert_uint_eq(strm.avail_in, 0);
+
+	assert_lzma_ret(lzma_stream_encoder_mt_get(&strm, &got), LZMA_OK);
+	assert_uint_eq(got.threads, first.threads);
+	assert_uint_eq(got.block_size, first.block_size);
+
+	assert_lzma_ret(lzma_code(&strm, LZMA_FINISH), LZMA_STREAM_END);
+	const size_t out_size = (size_t)strm.total_out;
+	lzma_end(&strm);
+
+	// Check that the Blocks have both sizes.
+	lzma_index *idx = NULL;
+	uint64_t memlimit_idx = UINT64_MAX;
+	size_t out_pos = out_size - LZMA_STREAM_HEADER_SIZE;
+	lzma_stream_flags footer;
+	assert_lzma_ret(lzma_stream_footer_decode(&footer, out + out_pos),
+			LZMA_OK);
+	out_pos -= footer.backward_size;
+	assert_lzma_ret(lzma_index_buffer_decode(&idx, &memlimit_idx, NULL,
+			out, &out_pos, out_size - LZMA_STREAM_HEADER_SIZE),
+			LZMA_OK);
+
+	bool seen_first = false;
+	bool seen_max = false;
+	lzma_index_iter iter;
+	lzma_index_iter_init(&iter, idx);
+	while (!lzma_index_iter_next(&iter, LZMA_INDEX_ITER_BLOCK)) {
+		const lzma_vli size = iter.block.uncompressed_size;
+		if (size == first.block_size)
+			seen_first = true;
+		else if (size == BLOCK_SIZE_MAX)
+			seen_max = true;
+		else
+			assert_true(size < BLOCK_SIZE_MAX);
+	}
+
+	lzma_index_end(idx, NULL);
+	assert_true(seen_first);
+	assert_true(seen_max);
+
+	// Decompress and compare.
+	assert_lzma_ret(lzma_stream_decoder(&strm, UINT64_MAX, 0), LZMA_OK);
+	strm.next_in = out;
+	strm.avail_in = out_size;
+	strm.next_out = decoded;
+	strm.avail_out = IN_SIZE;
+	assert_lzma_ret(lzma_code(&strm, LZMA_FINISH), LZMA_STREAM_END);
+	assert_uint_eq(strm.total_out, IN_SIZE);
+	assert_array_eq(decoded, in, IN_SIZE);
+	lzma_end(&strm);
+#endif
+}
+
+
+extern int
+main(int argc, char **argv)
+{
+	tuktest_start(argc, argv);
+
+	in = tuktest_malloc(IN_SIZE);
+	out = tuktest_malloc(OUT_SIZE);
+	decoded = tuktest_malloc(IN_SIZE);
+
+	// Text-like data that compresses somewhat
+	uint32_t x = 1;
+	for (size_t i = 0; i < IN_SIZE; ++i) {
+		x = x * 1103515245 + 12345;
+		in[i] = (uint8_t)('a' + (x >> 16) % ((x >> 30) + 3));
+	}
+
+	tuktest_run(test_mt_adaptive_config);
+	tuktest_run(test_mt_adaptive_encode);
+
+	return tuktest_end();
+}
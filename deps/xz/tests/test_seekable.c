@@ -0,0 +1,378 @@
+// SPDX-License-Identifier: 0BSD
+
+///////////////////////////////////////////////////////////////////////////////
+//
+/// \file       test_seekable.c
+/// \brief      Tests random access reading with lzma_seekable
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tests.h"
+#include "mythread.h"
+
+
+#define IN_SIZE (UINT32_C(600) << 10)
+#define FILE_BUF_SIZE (2 * IN_SIZE)
+
+// The two Streams are split at this uncompressed offset.
+#define STREAM_SPLIT (UINT32_C(350) << 10)
+
+
+static uint8_t *in;
+static uint8_t *file;
+static size_t file_size;
+
+
+static lzma_ret LZMA_API_CALL
+mem_read(void *opaque, uint8_t *buf, size_t size, uint64_t pos)
+{
+	(void)opaque;
+
+	if (pos > file_size || size > file_size - pos)
+		return LZMA_DATA_ERROR;
+
+	memcpy(buf, file + pos, size);
+	return LZMA_OK;
+}
+
+
+static const lzma_seekable_source source = { &mem_read, NULL };
+
+
+#if defined(HAVE_ENCODERS) && defined(HAVE_ENCODER_LZMA2)
+// Encode in[first..last) as one Stream to file[file_size]. Blocks are
+// cut at varying sizes, and some of the Blocks are empty.
+static void
+encode_stream(size_t first, size_t last, lzma_check check)
+{
+	lzma_stream strm = LZMA_STREAM_INIT;
+	assert_lzma_ret(lzma_easy_encoder(&strm, 1, check), LZMA_OK);
+
+	strm.next_out = file + file_size;
+	strm.avail_out = FILE_BUF_SIZE - file_size;
+
+	uint32_t x = 12345;
+	size_t pos = first;
+
+	while (pos < last) {
+		x = x * 1103515245 + 12345;
+		const size_t n = my_min((x >> 8) % 70000, last - pos);
+
+		strm.next_in = in + pos;
+		strm.avail_in = n;
+		pos += n;
+
+		assert_lzma_ret(lzma_code(&strm, LZMA_FULL_FLUSH),
+				LZMA_STREAM_END);
+	}
+
+	assert_lzma_ret(lzma_code(&strm, LZMA_FINISH), LZMA_STREAM_END);
+
+	file_size += (size_t)strm.total_out;
+	lzma_end(&strm);
+}
+#endif
+
+
+static void
+test_seekable_open(void)
+{
+	lzma_seekable *seekable;
+
+	assert_lzma_ret(lzma_seekable_open(NULL, &source, file_size,
+			0, UINT64_MAX, NULL), LZMA_PROG_ERROR);
+	assert_lzma_ret(lzma_seekable_open(&seekable, NULL, file_size,
+			0, UINT64_MAX, NULL), LZMA_PROG_ERROR);
+
+	// The uncompressed data isn't in the .xz format.
+	uint8_t *saved_file = file;
+	file = in;
+	assert_lzma_ret(lzma_seekable_open(&seekable, &source, 1000,
+			0, UINT64_MAX, NULL), LZMA_FORMAT_ERROR);
+	file = saved_file;
+
+	// Too low memory usage limit for the Indexes
+	assert_lzma_ret(lzma_seekable_open(&seekable, &source, file_size,
+			0, 1, NULL), LZMA_MEMLIMIT_ERROR);
+
+	// Truncated file
+	assert_lzma_ret(lzma_seekable_open(&seekable, &source, file_size - 1,
+			0, UINT64_MAX, NULL), LZMA_DATA_ERROR);
+
+	assert_lzma_ret(lzma_seekable_open(&seekable, &source, file_size,
+			0, UINT64_MAX, NULL), LZMA_OK);
+
+	const lzma_index *idx = lzma_seekable_index(seekable);
+	assert_uint_eq(lzma_index_uncompressed_size(idx), IN_SIZE);
+	assert_uint_eq(lzma_index_stream_count(idx), 2);
+	assert_uint(lzma_index_block_count(idx), >, 10);
+
+	lzma_seekable_end(seekable);
+	lzma_seekable_end(NULL);
+}
+
+
+// Read ranges of various sizes at pseudo-random offsets and compare
+// them to the original data. This returns true on failure instead of
+// using assertions because this is also run in multiple threads.
+static bool
+read_ranges(lzma_seekable *seekable, uint8_t *out,
+		uint32_t seed, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; ++i) {
+		seed = seed * 1103515245 + 12345;
+		const size_t pos = (seed >> 4) % IN_SIZE;
+
+		seed = seed * 1103515245 + 12345;
+		size_t size = (seed >> 4) % (i % 4 == 0 ? IN_SIZE : 5000);
+
+		const size_t expected = my_min(size, IN_SIZE - pos);
+		if (lzma_seekable_read(seekable, out, &size, pos) != LZMA_OK
+				|| size != expected
+				|| memcmp(out, in + pos, size) != 0)
+			return true;
+	}
+
+	return false;
+}
+
+
+static void
+test_seekable_read(void)
+{
+	static const uint64_t cache_sizes[] = {
+		0,
+		80000,
+		UINT64_MAX,
+	};
+
+	for (size_t i = 0; i < ARRAY_SIZE(cache_sizes); ++i) {
+		lzma_seekable *seekable;
+		assert_lzma_ret(lzma_seekable_open(&seekable, &source,
+				file_size, cache_sizes[i], UINT64_MAX, NULL),
+				LZMA_OK);
+
+		uint8_t *out = tuktest_malloc(IN_SIZE);
+		assert_false(read_ranges(seekable, out, (uint32_t)i, 200));
+
+		// Whole file
+		size_t size = IN_SIZE + 1;
+		assert_lzma_ret(lzma_seekable_read(seekable, out, &size, 0),
+				LZMA_OK);
+		assert_uint_eq(size, IN_SIZE);
+		assert_array_eq(out, in, IN_SIZE);
+
+		// Reading at the end gives nothing.
+		size = 10;
+		assert_lzma_ret(lzma_seekable_read(seekable, out, &size,
+				IN_SIZE), LZMA_OK);
+		assert_uint_eq(size, 0);
+
+		size = 0;
+		assert_lzma_ret(lzma_seekable_read(seekable, NULL, &size, 0),
+				LZMA_OK);
+
+		size = 1;
+		assert_lzma_ret(lzma_seekable_read(seekable, NULL, &size, 0),
+				LZMA_PROG_ERROR);
+
+		tuktest_free(out);
+		lzma_seekable_end(seekable);
+	}
+}
+
+
+#if defined(HAVE_ENCODERS) && defined(HAVE_ENCODER_LZMA2)
+// A file with many small Blocks so that the cache holds hundreds of them.
+// The Blocks are also evicted and decoded again with a smaller cache.
+static void
+test_seekable_many_blocks(void)
+{
+	const size_t block_size = 1000;
+
+	uint8_t *saved_file = file;
+	const size_t saved_file_size = file_size;
+	file = tuktest_malloc(FILE_BUF_SIZE);
+
+	lzma_stream strm = LZMA_STREAM_INIT;
+	assert_lzma_ret(lzma_easy_encoder(&strm, 0, LZMA_CHECK_CRC32),
+			LZMA_OK);
+	strm.next_out = file;
+	strm.avail_out = FILE_BUF_SIZE;
+
+	for (size_t pos = 0; pos < IN_SIZE; pos += block_size) {
+		strm.next_in = in + pos;
+		strm.avail_in = my_min(block_size, IN_SIZE - pos);
+		assert_lzma_ret(lzma_code(&strm, LZMA_FULL_FLUSH),
+				LZMA_STREAM_END);
+	}
+
+	assert_lzma_ret(lzma_code(&strm, LZMA_FINISH), LZMA_STREAM_END);
+	file_size = (size_t)strm.total_out;
+	lzma_end(&strm);
+
+	static const uint64_t cache_sizes[] = {
+		100000,
+		UINT64_MAX,
+	};
+
+	uint8_t *out = tuktest_malloc(IN_SIZE);
+
+	for (size_t i = 0; i < ARRAY_SIZE(cache_sizes); ++i) {
+		lzma_seekable *seekable;
+		assert_lzma_ret(lzma_seekable_open(&seekable, &source,
+				file_size, cache_sizes[i], UINT64_MAX, NULL),
+				LZMA_OK);
+		assert_uint_eq(lzma_index_block_count(
+				lzma_seekable_index(seekable)),
+				(IN_SIZE + block_size - 1) / block_size);
+
+		// Twice so that the second pass hits the cache
+		// when it is large enough.
+		for (uint32_t pass = 0; pass < 2; ++pass) {
+			size_t size = IN_SIZE;
+			assert_lzma_ret(lzma_seekable_read(seekable, out,
+					&size, 0), LZMA_OK);
+			assert_uint_eq(size, IN_SIZE);
+			assert_array_eq(out, in, IN_SIZE);
+
+			assert_false(read_ranges(seekable, out, pass, 500));
+		}
+
+		lzma_seekable_end(seekable);
+	}
+
+	tuktest_free(out);
+	tuktest_free(file);
+	file = saved_file;
+	file_size = saved_file_size;
+}
+#endif
+
+
+static void
+test_seekable_corrupt(void)
+{
+	lzma_seekable *seekable;
+
+	// The memory usage limit applies to the Block decoders too.
+	assert_lzma_ret(lzma_seekable_open(&seekable, &source, file_size,
+			0, 1 << 20, NULL), LZMA_OK);
+
+	uint8_t out[100];
+	size_t size = sizeof(out);
+	assert_lzma_ret(lzma_seekable_read(seekable, out, &size, 0),
+			LZMA_MEMLIMIT_ERROR);
+	assert_uint_eq(size, 0);
+	lzma_seekable_end(seekable);
+
+	// Corrupt a byte in the middle of the file. With the cache, the
+	// whole Block is decoded and the error is always detected.
+	assert_lzma_ret(lzma_seekable_open(&seekable, &source, file_size,
+			UINT64_MAX, UINT64_MAX, NULL), LZMA_OK);
+
+	file[file_size / 4] ^= 0x40;
+
+	uint8_t *whole = tuktest_malloc(IN_SIZE);
+	size = IN_SIZE;
+	assert_lzma_ret(lzma_seekable_read(seekable, whole, &size, 0),
+			LZMA_DATA_ERROR);
+	assert_uint(size, <, IN_SIZE);
+	assert_array_eq(whole, in, size);
+
+	file[file_size / 4] ^= 0x40;
+
+	tuktest_free(whole);
+	lzma_seekable_end(seekable);
+}
+
+
+#ifdef MYTHREAD_ENABLED
+typedef struct {
+	lzma_seekable *seekable;
+	uint8_t *out;
+	uint32_t seed;
+	bool failed;
+} thread_data;
+
+
+static MYTHREAD_RET_TYPE
+read_thread(void *data_ptr)
+{
+	thread_data *data = data_ptr;
+	data->failed = read_ranges(data->seekable, data->out,
+			data->seed, 50);
+	return MYTHREAD_RET_VALUE;
+}
+#endif
+
+
+static void
+test_seekable_threads(void)
+{
+#ifndef MYTHREAD_ENABLED
+	assert_skip("Threading support disabled");
+#else
+	// A small cache makes the threads evict each other's Blocks.
+	lzma_seekable *seekable;
+	assert_lzma_ret(lzma_seekable_open(&seekable, &source,
+			file_size, 150000, UINT64_MAX, NULL), LZMA_OK);
+
+	mythread threads[4];
+	thread_data data[ARRAY_SIZE(threads)];
+
+	for (uint32_t i = 0; i < ARRAY_SIZE(threads); ++i) {
+		data[i].seekable = seekable;
+		data[i].out = tuktest_malloc(IN_SIZE);
+		data[i].seed = 100 + i;
+		data[i].failed = true;
+		assert_false(mythread_create(&threads[i], &read_thread,
+				&data[i]));
+	}
+
+	for (uint32_t i = 0; i < ARRAY_SIZE(threads); ++i) {
+		assert_false(mythread_join(threads[i]));
+		assert_false(data[i].failed);
+		tuktest_free(data[i].out);
+	}
+
+	lzma_seekable_end(seekable);
+#endif
+}
+
+
+extern int
+main(int argc, char **argv)
+{
+	tuktest_start(argc, argv);
+
+#if !defined(HAVE_ENCODERS) || !defined(HAVE_ENCODER_LZMA2)
+	tuktest_early_skip("LZMA2 encoder support disabled");
+#elif !defined(HAVE_DECODERS) || !defined(HAVE_DECODER_LZMA2)
+	tuktest_early_skip("LZMA2 decoder support disabled");
+#else
+	in = tuktest_malloc(IN_SIZE);
+	file = tuktest_malloc(FILE_BUF_SIZE);
+
+	// Text-like data that compresses reasonably well
+	uint32_t x = 1;
+	for (size_t i = 0; i < IN_SIZE; ++i) {
+		x = x * 1103515245 + 12345;
+		in[i] = (uint8_t)('a' + (x >> 16) % ((x >> 30) + 3));
+	}
+
+	// Two Streams with Stream Padding in between
+	encode_stream(0, STREAM_SPLIT, LZMA_CHECK_CRC32);
+	memzero(file + file_size, 8);
+	file_size += 8;
+	encode_stream(STREAM_SPLIT, IN_SIZE, LZMA_CHECK_SHA256);
+
+	tuktest_run(test_seekable_open);
+	tuktest_run(test_seekable_read);
+	tuktest_run(test_seekable_many_blocks);
+	tuktest_run(test_seekable_corrupt);
+	tuktest_run(test_seekable_threads);
+#endif
+
+	return tuktest_end();
+}
@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: 0BSD
+
+///////////////////////////////////////////////////////////////////////////////
+//
+/// \file       test_stream_encoder_mt.c
+/// \brief      Tests the multithreaded .xz encoder
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tests.h"
+#include "mythread.h"
+
+
+#define BLOCK_SIZE (UINT32_C(1) << 20)
+#define IN_SIZE (UINT32_C(512) << 10)
+
+// The worker threads give at most this much input to the Block encoder
+// at once (in_chunk_max in stream_encoder_mt.c).
+#define IN_CHUNK_MAX 16384
+
+// How long to wait for the worker thread before giving up
+#define TIMEOUT_MS 10000
+
+
+static uint8_t in[IN_SIZE];
+static uint8_t out[IN_SIZE + IN_SIZE / 8 + 1024];
+
+
+// A worker thread must compress all the input it has been given,
+// not only the first in_chunk_max bytes. Give less than a Block at once
+// and check that the worker gets through it without more input
+// and without LZMA_FINISH.
+static void
+test_worker_uses_all_input(void)
+{
+#ifndef MYTHREAD_ENABLED
+	assert_skip("Threading support disabled");
+#elif !defined(HAVE_ENCODER_LZMA2)
+	assert_skip("LZMA2 encoder support disabled");
+#else
+	lzma_mt mt;
+	memzero(&mt, sizeof(mt));
+	mt.threads = 2;
+	mt.block_size = BLOCK_SIZE;
+	mt.preset = 0;
+	mt.check = LZMA_CHECK_CRC32;
+
+	lzma_stream strm = LZMA_STREAM_INIT;
+	assert_lzma_ret(lzma_stream_encoder_mt(&strm, &mt), LZMA_OK);
+
+	strm.next_in = in;
+	strm.avail_in = IN_SIZE;
+	strm.next_out = out;
+	strm.avail_out = sizeof(out);
+	assert_lzma_ret(lzma_code(&strm, LZMA_RUN), LZMA_OK);
+	assert_uint_eq(strm.avail_in, 0);
+
+	// There is no portable sleep, so wait on a condition variable
+	// that is never signaled.
+	mythread_mutex mutex;
+	mythread_cond cond;
+	assert_false(mythread_mutex_init(&mutex));
+	assert_false(mythread_cond_init(&cond));
+
+	uint64_t progress_in = 0;
+	uint64_t progress_out = 0;
+	for (unsigned i = 0; i < TIMEOUT_MS / 10; ++i) {
+		lzma_get_progress(&strm, &progress_in, &progress_out);
+		if (progress_in == IN_SIZE)
+			break;
+
+		mythread_condtime wait;
+		mythread_condtime_set(&wait, &cond, 10);
+		mythread_sync(mutex) {
+			mythread_cond_timedwait(&cond, &mutex, &wait);
+		}
+	}
+
+	mythread_cond_destroy(&cond);
+	mythread_mutex_destroy(&mutex);
+
+	// Without the fix the worker stops after the first chunk.
+	assert_true(progress_in > IN_CHUNK_MAX);
+	assert_uint_eq(progress_in, IN_SIZE);
+
+	// Finish the Stream and check that it decodes.
+	lzma_ret ret;
+	do {
+		ret = lzma_code(&strm, LZMA_FINISH);
+	} while (ret == LZMA_OK);
+	assert_lzma_ret(ret, LZMA_STREAM_END);
+
+	const size_t out_size = (size_t)strm.total_out;
+	lzma_end(&strm);
+
+	uint8_t *decoded = tuktest_malloc(IN_SIZE);
+	size_t in_pos = 0;
+	size_t out_pos = 0;
+	uint64_t memlimit = UINT64_MAX;
+	assert_lzma_ret(lzma_stream_buffer_decode(&memlimit, 0, NULL,
+			out, &in_pos, out_size, decoded, &out_pos, IN_SIZE),
+			LZMA_OK);
+	assert_uint_eq(out_pos, IN_SIZE);
+	assert_array_eq(decoded, in, IN_SIZE);
+#endif
+}
+
+
+extern int
+main(int argc, char **argv)
+{
+	tuktest_start(argc, argv);
+
+	// Text-like data that compresses somewhat
+	uint32_t x = 1;
+	for (size_t i = 0; i < IN_SIZE; ++i) {
+		x = x * 1103515245 + 12345;
+		in[i] = (uint8_t)('a' + (x >> 16) % ((x >> 30) + 3));
+	}
+
+	tuktest_run(test_worker_uses_all_input);
+
+	return tuktest_end();
+}
@@ -57,11 +57,288 @@
 #  define MOD63(a) a %= BASE
 #endif
 
+/*
+  Use vector instructions where available: SSSE3 or AVX2 on x86, checked at
+  run time and compiled with function target attributes so that no special
+  compiler flags are needed, and NEON on ARM, which is checked at compile time.
+  Define NO_ADLER32_SIMD to leave them out.
+
+  Each vector routine sums whole blocks of bytes, at most NMAX bytes between
+  modulo operations. For a block of B bytes b[0..B-1] added to sums (a, s2):
+
+      a' = a + sum b[i],   s2' = s2 + B a + sum (B - i) b[i]
+
+  so s2 is accumulated from the running a at the start of each block, scaled
+  by B at the end, plus a weighted sum of the bytes in each block.
+ */
+#if !defined(NO_ADLER32_SIMD) && defined(STDC) && \
+    (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || __GNUC__ > 4 || \
+     (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#  define X86_ADLER32_SIMD
+#  include <immintrin.h>
+#  include <cpuid.h>
+#elif !defined(NO_ADLER32_SIMD) && defined(__GNUC__) && \
+      (defined(__aarch64__) || defined(__ARM_NEON))
+#  define NEON_ADLER32_SIMD
+#  include <arm_neon.h>
+#endif
+
+#ifdef X86_ADLER32_SIMD
+
+/* Add the four 32-bit lanes of v. */
+#define Z_HSUM128(v) \
+    (v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1))), \
+     v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2))), \
+     (unsigned long)(unsigned)_mm_cvtsi128_si32(v))
+
+/* Return the Adler-32 of len bytes at buf, where len is a multiple of 32. */
+local __attribute__((target("ssse3"))) uLong adler32_ssse3(uLong adler,
+                                                         const Bytef *buf,
+                                                         z_size_t len) {
+    const __m128i tap1 = _mm_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25,
+                                       24, 23, 22, 21, 20, 19, 18, 17);
+    const __m128i tap2 = _mm_setr_epi8(16, 15, 14, 13, 12, 11, 10, 9,
+                                       8, 7, 6, 5, 4, 3, 2, 1);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(1);
+    unsigned long sum2 = (adler >> 16) & 0xffff;
+    z_size_t blocks = len / 32;
+    unsigned n;
+
+    adler &= 0xffff;
+    while (blocks) {
+        __m128i v_ps, v_s1, v_s2, b1, b2;
+
+        n = NMAX / 32;
+        if (n > blocks)
+            n = (unsigned)blocks;
+        blocks -= n;
+        v_ps = _mm_cvtsi32_si128((int)(adler * n));
+        v_s2 = _mm_cvtsi32_si128((int)sum2);
+        v_s1 = zero;
+        do {
+            b1 = _mm_loadu_si128((const __m128i *)buf);
+            b2 = _mm_loadu_si128((const __m128i *)(buf + 16));
+            v_ps = _mm_add_epi32(v_ps, v_s1);
+            v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(b1, zero));
+            v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(b2, zero));
+            v_s2 = _mm_add_epi32(v_s2, _mm_madd_epi16(
+                                     _mm_maddubs_epi16(b1, tap1), ones));
+            v_s2 = _mm_add_epi32(v_s2, _mm_madd_epi16(
+                                     _mm_maddubs_epi16(b2, tap2), ones));
+            buf += 32;
+        } while (--n);
+        v_s2 = _mm_add_epi32(v_s2, _mm_slli_epi32(v_ps, 5));
+        adler += Z_HSUM128(v_s1);
+        sum2 = Z_HSUM128(v_s2);
+        MOD(adler);
+        MOD(sum2);
+    }
+    return adler | (sum2 << 16);
+}
+
+/* Return the Adler-32 of len bytes at buf, where len is a multiple of 64. */
+local __attribute__((target("avx2"))) uLong adler32_avx2(uLong adler,
+                                                       const Bytef *buf,
+                                                       z_size_t len) {
+    const __m256i tap1 = _mm256_setr_epi8(64, 63, 62, 61, 60, 59, 58, 57,
+                                          56, 55, 54, 53, 52, 51, 50, 49,
+                                          48, 47, 46, 45, 44, 43, 42, 41,
+                                          40, 39, 38, 37, 36, 35, 34, 33);
+    const __m256i tap2 = _mm256_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25,
+                                          24, 23, 22, 21, 20, 19, 18, 17,
+                                          16, 15, 14, 13, 12, 11, 10, 9,
+                                          8, 7, 6, 5, 4, 3, 2, 1);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi16(1);
+    unsigned long sum2 = (adler >> 16) & 0xffff;
+    z_size_t blocks = len / 64;
+    unsigned n;
+
+    adler &= 0xffff;
+    while (blocks) {
+        __m256i v_ps, v_s1, v_s2, b1, b2;
+        __m128i v;
+
+        n = NMAX / 64;
+        if (n > blocks)
+            n = (unsigned)blocks;
+        blocks -= n;
+        v_ps = _mm256_setr_epi32((int)(adler * n), 0, 0, 0, 0, 0, 0, 0);
+        v_s2 = _mm256_setr_epi32((int)sum2, 0, 0, 0, 0, 0, 0, 0);
+        v_s1 = zero;
+        do {
+            b1 = _mm256_loadu_si256((const __m256i *)buf);
+            b2 = _mm256_loadu_si256((const __m256i *)(buf + 32));
+            v_ps = _mm256_add_epi32(v_ps, v_s1);
+            v_s1 = _mm256_add_epi32(v_s1, _mm256_sad_epu8(b1, zero));
+            v_s1 = _mm256_add_epi32(v_s1, _mm256_sad_epu8(b2, zero));
+            v_s2 = _mm256_add_epi32(v_s2, _mm256_madd_epi16(
+                                     _mm256_maddubs_epi16(b1, tap1), ones));
+            v_s2 = _mm256_add_epi32(v_s2, _mm256_madd_epi16(
+                                     _mm256_maddubs_epi16(b2, tap2), ones));
+            buf += 64;
+        } while (--n);
+        v_s2 = _mm256_add_epi32(v_s2, _mm256_slli_epi32(v_ps, 6));
+        v = _mm_add_epi32(_mm256_castsi256_si128(v_s1),
+                          _mm256_extracti128_si256(v_s1, 1));
+        adler += Z_HSUM128(v);
+        v = _mm_add_epi32(_mm256_castsi256_si128(v_s2),
+                          _mm256_extracti128_si256(v_s2, 1));
+        sum2 = Z_HSUM128(v);
+        MOD(adler);
+        MOD(sum2);
+    }
+    return adler | (sum2 << 16);
+}
+
+/*
+  Return the highest level of vector support on this processor: 0 for none,
+  1 for SSSE3, 2 for AVX2 enabled by the operating system.
+ */
+local int x86_adler32_level(void) {
+    unsigned eax, ebx, ecx, edx, xcr0;
+    int level = 0;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return 0;
+    if (ecx & (1 << 9))                             /* SSSE3 */
+        level = 1;
+    if (level && (ecx & (1 << 27)) && __get_cpuid_max(0, 0) >= 7) {
+        /* OSXSAVE is set: check that the OS saves the YMM state. */
+        __asm__ volatile(".byte 0x0f, 0x01, 0xd0"   /* xgetbv */
+                         : "=a"(xcr0), "=d"(edx) : "c"(0));
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        if ((xcr0 & 6) == 6 && (ebx & (1 << 5)))    /* AVX2 */
+            level = 2;
+    }
+    return level;
+}
+
+/* Processor support, -1 until checked. Races on these are benign. */
+local volatile int simd_cpu = -1;
+local volatile int simd_max = 2;
+
+#endif /* X86_ADLER32_SIMD */
+
+#ifdef NEON_ADLER32_SIMD
+
+/* Return the Adler-32 of len bytes at buf, where len is a multiple of 32. */
+local uLong adler32_neon(uLong adler, const Bytef *buf, z_size_t len) {
+    static const uint16_t taps[32] = {
+        32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17,
+        16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1
+    };
+    unsigned long sum2 = (adler >> 16) & 0xffff;
+    z_size_t blocks = len / 32;
+    unsigned n;
+
+    adler &= 0xffff;
+    while (blocks) {
+        uint32x4_t v_s1, v_s2;
+        uint16x8_t c1, c2, c3, c4;
+        uint32x2_t s;
+
+        n = NMAX / 32;
+        if (n > blocks)
+            n = (unsigned)blocks;
+        blocks -= n;
+        v_s2 = vsetq_lane_u32((uint32_t)(adler * n), vdupq_n_u32(0), 0);
+        v_s1 = vdupq_n_u32(0);
+        c1 = c2 = c3 = c4 = vdupq_n_u16(0);
+        do {
+            /* Sum the bytes in each column, and weight them at the end. */
+            const uint8x16_t b1 = vld1q_u8(buf);
+            const uint8x16_t b2 = vld1q_u8(buf + 16);
+
+            v_s2 = vaddq_u32(v_s2, v_s1);
+            v_s1 = vpadalq_u16(v_s1, vpadalq_u8(vpaddlq_u8(b1), b2));
+            c1 = vaddw_u8(c1, vget_low_u8(b1));
+            c2 = vaddw_u8(c2, vget_high_u8(b1));
+            c3 = vaddw_u8(c3, vget_low_u8(b2));
+            c4 = vaddw_u8(c4, vget_high_u8(b2));
+            buf += 32;
+        } while (--n);
+        v_s2 = vshlq_n_u32(v_s2, 5);
+        v_s2 = vmlal_u16(v_s2, vget_low_u16(c1), vld1_u16(taps));
+        v_s2 = vmlal_u16(v_s2, vget_high_u16(c1), vld1_u16(taps + 4));
+        v_s2 = vmlal_u16(v_s2, vget_low_u16(c2), vld1_u16(taps + 8));
+        v_s2 = vmlal_u16(v_s2, vget_high_u16(c2), vld1_u16(taps + 12));
+        v_s2 = vmlal_u16(v_s2, vget_low_u16(c3), vld1_u16(taps + 16));
+        v_s2 = vmlal_u16(v_s2, vget_high_u16(c3), vld1_u16(taps + 20));
+        v_s2 = vmlal_u16(v_s2, vget_low_u16(c4), vld1_u16(taps + 24));
+        v_s2 = vmlal_u16(v_s2, vget_high_u16(c4), vld1_u16(taps + 28));
+        s = vpadd_u32(vpadd_u32(vget_low_u32(v_s1), vget_high_u32(v_s1)),
+                      vpadd_u32(vget_low_u32(v_s2), vget_high_u32(v_s2)));
+        adler += vget_lane_u32(s, 0);
+        sum2 += vget_lane_u32(s, 1);
+        MOD(adler);
+        MOD(sum2);
+    }
+    return adler | (sum2 << 16);
+}
+
+/* Zero to disable. */
+local volatile int simd_max = 1;
+
+#endif /* NEON_ADLER32_SIMD */
+
+/* ========================================================================= */
+int ZLIB_INTERNAL adler32_simd_level(int max) {
+#if defined(X86_ADLER32_SIMD)
+    int cpu = simd_cpu;
+
+    if (cpu < 0)
+        simd_cpu = cpu = x86_adler32_level();
+    if (max >= 0)
+        simd_max = max;
+    return cpu < simd_max ? cpu : simd_max;
+#elif defined(NEON_ADLER32_SIMD)
+    if (max >= 0)
+        simd_max = max;
+    return simd_max ? 1 : 0;
+#else
+    (void)max;
+    return 0;
+#endif
+}
+
 /* ========================================================================= */
 uLong ZEXPORT adler32_z(uLong adler, const Bytef *buf, z_size_t len) {
     unsigned long sum2;
     unsigned n;
 
+#if defined(X86_ADLER32_SIMD) || defined(NEON_ADLER32_SIMD)
+    /* Sum as many whole vector blocks as possible, and the rest below. */
+    if (buf != Z_NULL && len >= 64) {
+        int level = adler32_simd_level(-1);
+        z_size_t blk;
+
+#  ifdef X86_ADLER32_SIMD
+        if (level >= 2) {
+            blk = len & ~(z_size_t)63;
+            adler = adler32_avx2(adler, buf, blk);
+        }
+        else if (level == 1) {
+            blk = len & ~(z_size_t)31;
+            adler = adler32_ssse3(adler, buf, blk);
+        }
+#  else
+        if (level) {
+            blk = len & ~(z_size_t)31;
+            adler = adler32_neon(adler, buf, blk);
+        }
+#  endif
+        else
+            blk = 0;
+        buf += blk;
+        len -= blk;
+        if (len == 0)
+            return adler;
+    }
+#endif
+
     /* split Adler-32 into component sums */
     sum2 = (adler >> 16) & 0xffff;
     adler &= 0xffff;
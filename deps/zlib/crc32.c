@@ -103,6 +103,26 @@
 #  define ARMCRC32
 #endif
 
+/*
+  On x86, use carry-less multiplication when the processor supports it. The
+  code is compiled with function target attributes and selected at run time,
+  so no special compiler flags are needed. Define NO_CRC32_CLMUL to leave it
+  out, or NO_CRC32_VPCLMUL to leave out only the AVX-512 version.
+ */
+#if !defined(ARMCRC32) && !defined(MAKECRCH) && !defined(NO_CRC32_CLMUL) && \
+    (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || __GNUC__ > 4 || \
+     (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#  define X86_CRC32_CLMUL
+#  include <immintrin.h>
+#  include <cpuid.h>
+#  if !defined(NO_CRC32_VPCLMUL) && \
+      ((defined(__clang__) && __clang_major__ >= 6) || \
+       (!defined(__clang__) && __GNUC__ >= 8))
+#    define X86_CRC32_VPCLMUL
+#  endif
+#endif
+
 #if defined(W) && (!defined(ARMCRC32) || defined(DYNAMIC_CRC_TABLE))
 /*
   Swap the bytes in a z_word_t to convert between little and big endian. Any
@@ -553,6 +573,215 @@ const z_crc_t FAR * ZEXPORT get_crc_table(void) {
     return (const z_crc_t FAR *)crc_table;
 }
 
+#ifdef X86_CRC32_CLMUL
+
+/* =========================================================================
+ * Use the x86 carry-less multiply instruction PCLMULQDQ, and its 512-bit
+ * VPCLMULQDQ form if available, to fold the message into a 128-bit remainder
+ * four 128-bit (or four 512-bit) blocks at a time, and then to reduce that to
+ * the CRC with a Barrett reduction. This is the method of Gopal et al., "Fast
+ * CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction", Intel
+ * (2009), applied to the reflected polynomial. Each folding constant is
+ * x^(d+32) or x^(d-32) modulo the polynomial, bit reflected and shifted left
+ * one bit, for a folding distance of d bits. The presence of the instructions
+ * is checked at run time.
+ */
+
+#define Z_TARGET_CLMUL __attribute__((target("pclmul,sse4.1")))
+
+/* Multiply both halves of x by the constants in k and add them. */
+#define Z_FOLD128(x, k) _mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00), \
+                                      _mm_clmulepi64_si128(x, k, 0x11))
+
+/*
+  Fold the four consecutive 128-bit blocks x0..x3 into one, fold in the len
+  remaining bytes at buf (a multiple of 16), and reduce to the CRC.
+ */
+local Z_TARGET_CLMUL z_crc_t crc32_clmul_reduce(__m128i x0, __m128i x1,
+                                                __m128i x2, __m128i x3,
+                                                const unsigned char FAR *buf,
+                                                z_size_t len) {
+    const __m128i mask32 = _mm_setr_epi32(-1, 0, 0, 0);
+    __m128i k, t;
+
+    /* Fold 128 bits at a time. */
+    k = _mm_set_epi64x(0x0ccaa009e, 0x1751997d0);
+    x0 = _mm_xor_si128(Z_FOLD128(x0, k), x1);
+    x0 = _mm_xor_si128(Z_FOLD128(x0, k), x2);
+    x0 = _mm_xor_si128(Z_FOLD128(x0, k), x3);
+    while (len >= 16) {
+        x0 = _mm_xor_si128(Z_FOLD128(x0, k),
+                           _mm_loadu_si128((const __m128i *)buf));
+        buf += 16;
+        len -= 16;
+    }
+
+    /* Fold 128 bits to 64, appending 32 zero bits. */
+    t = _mm_clmulepi64_si128(k, x0, 0x01);
+    x0 = _mm_xor_si128(_mm_srli_si128(x0, 8), t);
+
+    /* Fold 64 bits to 32 + 32. */
+    t = _mm_srli_si128(x0, 4);
+    x0 = _mm_and_si128(x0, mask32);
+    k = _mm_set_epi64x(0, 0x163cd6124);
+    x0 = _mm_xor_si128(_mm_clmulepi64_si128(x0, k, 0x00), t);
+
+    /* Barrett reduction to 32 bits. */
+    k = _mm_set_epi64x(0x1f7011641, 0x1db710641);
+    t = x0;
+    x0 = _mm_and_si128(x0, mask32);
+    x0 = _mm_clmulepi64_si128(x0, k, 0x10);
+    x0 = _mm_and_si128(x0, mask32);
+    x0 = _mm_clmulepi64_si128(x0, k, 0x00);
+    x0 = _mm_xor_si128(x0, t);
+    return (z_crc_t)_mm_extract_epi32(x0, 1);
+}
+
+/*
+  Return the CRC of len bytes at buf, where len is a multiple of 16 and at
+  least 64, without any pre or post conditioning of crc.
+ */
+local Z_TARGET_CLMUL z_crc_t crc32_clmul(z_crc_t crc,
+                                         const unsigned char FAR *buf,
+                                         z_size_t len) {
+    __m128i x0, x1, x2, x3, k;
+
+    x0 = _mm_loadu_si128((const __m128i *)buf);
+    x1 = _mm_loadu_si128((const __m128i *)buf + 1);
+    x2 = _mm_loadu_si128((const __m128i *)buf + 2);
+    x3 = _mm_loadu_si128((const __m128i *)buf + 3);
+    x0 = _mm_xor_si128(x0, _mm_cvtsi32_si128((int)crc));
+    buf += 64;
+    len -= 64;
+
+    /* Fold 512 bits at a time. */
+    k = _mm_set_epi64x(0x1c6e41596, 0x154442bd4);
+    while (len >= 64) {
+        x0 = _mm_xor_si128(Z_FOLD128(x0, k),
+                           _mm_loadu_si128((const __m128i *)buf));
+        x1 = _mm_xor_si128(Z_FOLD128(x1, k),
+                           _mm_loadu_si128((const __m128i *)buf + 1));
+        x2 = _mm_xor_si128(Z_FOLD128(x2, k),
+                           _mm_loadu_si128((const __m128i *)buf + 2));
+        x3 = _mm_xor_si128(Z_FOLD128(x3, k),
+                           _mm_loadu_si128((const __m128i *)buf + 3));
+        buf += 64;
+        len -= 64;
+    }
+    return crc32_clmul_reduce(x0, x1, x2, x3, buf, len);
+}
+
+#ifdef X86_CRC32_VPCLMUL
+
+#define Z_TARGET_VPCLMUL \
+    __attribute__((target("avx512f,avx512vl,vpclmulqdq,pclmul,sse4.1")))
+
+/* Fold each 128-bit lane of x by the constants in k and add in y. */
+#define Z_FOLD512(x, k, y) _mm512_ternarylogic_epi64( \
+    _mm512_clmulepi64_epi128(x, k, 0x00), \
+    _mm512_clmulepi64_epi128(x, k, 0x11), y, 0x96)
+
+/*
+  Same as crc32_clmul(), but at least 256 bytes, and using four 512-bit
+  registers.
+ */
+local Z_TARGET_VPCLMUL z_crc_t crc32_vpclmul(z_crc_t crc,
+                                            const unsigned char FAR *buf,
+                                            z_size_t len) {
+    __m512i z0, z1, z2, z3, k;
+
+    z0 = _mm512_loadu_si512((const void *)buf);
+    z1 = _mm512_loadu_si512((const void *)(buf + 64));
+    z2 = _mm512_loadu_si512((const void *)(buf + 128));
+    z3 = _mm512_loadu_si512((const void *)(buf + 192));
+    z0 = _mm512_xor_si512(z0, _mm512_inserti32x4(_mm512_setzero_si512(),
+                                  _mm_cvtsi32_si128((int)crc), 0));
+    buf += 256;
+    len -= 256;
+
+    /* Fold 2048 bits at a time. */
+    k = _mm512_set_epi64(0x1322d1430, 0x11542778a, 0x1322d1430, 0x11542778a,
+                         0x1322d1430, 0x11542778a, 0x1322d1430, 0x11542778a);
+    while (len >= 256) {
+        z0 = Z_FOLD512(z0, k, _mm512_loadu_si512((const void *)buf));
+        z1 = Z_FOLD512(z1, k, _mm512_loadu_si512((const void *)(buf + 64)));
+        z2 = Z_FOLD512(z2, k, _mm512_loadu_si512((const void *)(buf + 128)));
+        z3 = Z_FOLD512(z3, k, _mm512_loadu_si512((const void *)(buf + 192)));
+        buf += 256;
+        len -= 256;
+    }
+
+    /* Fold into one register, then continue 512 bits at a time. */
+    k = _mm512_set_epi64(0x1c6e41596, 0x154442bd4, 0x1c6e41596, 0x154442bd4,
+                         0x1c6e41596, 0x154442bd4, 0x1c6e41596, 0x154442bd4);
+    z1 = Z_FOLD512(z0, k, z1);
+    z2 = Z_FOLD512(z1, k, z2);
+    z0 = Z_FOLD512(z2, k, z3);
+    while (len >= 64) {
+        z0 = Z_FOLD512(z0, k, _mm512_loadu_si512((const void *)buf));
+        buf += 64;
+        len -= 64;
+    }
+    return crc32_clmul_reduce(_mm512_extracti32x4_epi32(z0, 0),
+                              _mm512_extracti32x4_epi32(z0, 1),
+                              _mm512_extracti32x4_epi32(z0, 2),
+                              _mm512_extracti32x4_epi32(z0, 3), buf, len);
+}
+
+#endif /* X86_CRC32_VPCLMUL */
+
+/*
+  Return the highest level of carry-less multiply support on this processor:
+  0 for none, 1 for PCLMULQDQ with SSE4.1, 2 for VPCLMULQDQ with AVX-512
+  enabled by the operating system.
+ */
+local int x86_clmul_level(void) {
+    unsigned eax, ebx, ecx, edx, xcr0;
+    int level = 0;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return 0;
+    if ((ecx & (1 << 1)) && (ecx & (1 << 19)))      /* PCLMULQDQ, SSE4.1 */
+        level = 1;
+#ifdef X86_CRC32_VPCLMUL
+    if (level && (ecx & (1 << 27)) && __get_cpuid_max(0, 0) >= 7) {
+        /* OSXSAVE is set: check that the OS saves the opmask and ZMM state. */
+        __asm__ volatile(".byte 0x0f, 0x01, 0xd0"   /* xgetbv */
+                         : "=a"(xcr0), "=d"(edx) : "c"(0));
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        if ((xcr0 & 0xe6) == 0xe6 &&
+            (ebx & (1 << 16)) && (ebx & (1U << 31)) &&  /* AVX512F, VL */
+            (ecx & (1 << 10)))                          /* VPCLMULQDQ */
+            level = 2;
+    }
+#else
+    (void)xcr0;
+#endif
+    return level;
+}
+
+/* Processor support, -1 until checked. Races on these are benign. */
+local volatile int clmul_cpu = -1;
+local volatile int clmul_max = 2;
+
+#endif /* X86_CRC32_CLMUL */
+
+/* ========================================================================= */
+int ZLIB_INTERNAL crc32_simd_level(int max) {
+#ifdef X86_CRC32_CLMUL
+    int cpu = clmul_cpu;
+
+    if (cpu < 0)
+        clmul_cpu = cpu = x86_clmul_level();
+    if (max >= 0)
+        clmul_max = max;
+    return cpu < clmul_max ? cpu : clmul_max;
+#else
+    (void)max;
+    return 0;
+#endif
+}
+
 /* =========================================================================
  * Use ARM machine instructions if available. This will compute the CRC about
  * ten times faster than the braided calculation. This code does not check for
@@ -691,8 +920,8 @@ local z_word_t crc_word_big(z_word_t data) {
 #endif
 
 /* ========================================================================= */
-unsigned long ZEXPORT crc32_z(unsigned long crc, const unsigned char FAR *buf,
-                              z_size_t len) {
+local unsigned long crc32_braid(unsigned long crc,
+                                const unsigned char FAR *buf, z_size_t len) {
     /* Return initial CRC, if requested. */
     if (buf == Z_NULL) return 0;
 
@@ -1009,6 +1238,33 @@ unsigned long ZEXPORT crc32_z(unsigned long crc, const unsigned char FAR *buf,
     return crc ^ 0xffffffff;
 }
 
+/* ========================================================================= */
+unsigned long ZEXPORT crc32_z(unsigned long crc, const unsigned char FAR *buf,
+                              z_size_t len) {
+#ifdef X86_CRC32_CLMUL
+    /* Fold as many 16-byte blocks as possible, and let the braided code do
+       the rest. Below 64 bytes the setup costs more than it saves. */
+    if (buf != Z_NULL && len >= 64) {
+        int level = crc32_simd_level(-1);
+        z_size_t blk = len & ~(z_size_t)15;
+
+        if (level) {
+            crc = (~crc) & 0xffffffff;
+#ifdef X86_CRC32_VPCLMUL
+            if (level >= 2 && blk >= 256)
+                crc = crc32_vpclmul((z_crc_t)crc, buf, blk);
+            else
+#endif
+                crc = crc32_clmul((z_crc_t)crc, buf, blk);
+            crc ^= 0xffffffff;
+            buf += blk;
+            len -= blk;
+        }
+    }
+#endif
+    return crc32_braid(crc, buf, len);
+}
+
 #endif
 
 /* ========================================================================= */
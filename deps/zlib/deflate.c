@@ -51,6 +51,15 @@
 
 #include "deflate.h"
 
+#if defined(DEFLATE_HASH4) && defined(__SSE4_2__)
+#  include <nmmintrin.h>
+#elif defined(DEFLATE_HASH4) && defined(__ARM_FEATURE_CRC32)
+#  include <arm_acle.h>
+#endif
+#if defined(DEFLATE_WIDE_MATCH) && defined(__SSE2__)
+#  include <emmintrin.h>
+#endif
+
 const char deflate_copyright[] =
    " deflate 1.3.0.1 Copyright 1995-2023 Jean-loup Gailly and Mark Adler ";
 /*
@@ -140,6 +149,31 @@ local const config configuration_table[10] = {
  */
 #define UPDATE_HASH(s,h,c) (h = (((h) << s->hash_shift) ^ (c)) & s->hash_mask)
 
+/* ===========================================================================
+ * Set s->ins_h to the hash key of the string at str. Unless DEFLATE_HASH4 is
+ * defined, this updates the rolling hash, so s->ins_h must be the hash key of
+ * the string at str - 1, or have been started with the first MIN_MATCH-1
+ * bytes at str.
+ */
+#ifdef DEFLATE_HASH4
+local uInt hash4(deflate_state *s, const Bytef *str) {
+    ulg val = (ulg)str[0] | ((ulg)str[1] << 8) | ((ulg)str[2] << 16) |
+              ((ulg)str[3] << 24);
+
+#  if defined(__SSE4_2__)
+    return (uInt)_mm_crc32_u32(0, (unsigned)val) & s->hash_mask;
+#  elif defined(__ARM_FEATURE_CRC32)
+    return (uInt)__crc32cw(0, (unsigned)val) & s->hash_mask;
+#  else
+    return (uInt)(((val * 2654435761UL) & 0xffffffff) >> (32 - s->hash_bits));
+#  endif
+}
+#  define STRING_HASH(s, str) (s->ins_h = hash4(s, s->window + (str)))
+#else
+#  define STRING_HASH(s, str) \
+    UPDATE_HASH(s, s->ins_h, s->window[(str) + (MIN_MATCH-1)])
+#endif
+
 
 /* ===========================================================================
  * Insert string str in the dictionary and set match_head to the previous head
@@ -158,7 +192,7 @@ local const config configuration_table[10] = {
     s->head[s->ins_h] = (Pos)(str))
 #else
 #define INSERT_STRING(s, str, match_head) \
-   (UPDATE_HASH(s, s->ins_h, s->window[(str) + (MIN_MATCH-1)]), \
+   (STRING_HASH(s, str), \
     match_head = s->prev[(str) & s->w_mask] = s->head[s->ins_h], \
     s->head[s->ins_h] = (Pos)(str))
 #endif
@@ -312,7 +346,7 @@ local void fill_window(deflate_state *s) {
             Call UPDATE_HASH() MIN_MATCH-3 more times
 #endif
             while (s->insert) {
-                UPDATE_HASH(s, s->ins_h, s->window[str + MIN_MATCH-1]);
+                STRING_HASH(s, str);
 #ifndef FASTEST
                 s->prev[str & s->w_mask] = s->head[s->ins_h];
 #endif
@@ -446,7 +480,7 @@ int ZEXPORT deflateInit2_(z_streamp strm, int level, int method,
     s->hash_mask = s->hash_size - 1;
     s->hash_shift =  ((s->hash_bits + MIN_MATCH-1) / MIN_MATCH);
 
-    s->window = (Bytef *) ZALLOC(strm, s->w_size, 2*sizeof(Byte));
+    s->window = (Bytef *) ZALLOC(strm, s->w_size + WIN_PAD/2, 2*sizeof(Byte));
     s->prev   = (Posf *)  ZALLOC(strm, s->w_size, sizeof(Pos));
     s->head   = (Posf *)  ZALLOC(strm, s->hash_size, sizeof(Pos));
 
@@ -507,6 +541,9 @@ int ZEXPORT deflateInit2_(z_streamp strm, int level, int method,
         deflateEnd (strm);
         return Z_MEM_ERROR;
     }
+#if WIN_PAD
+    zmemzero(s->window + 2 * s->w_size, WIN_PAD);
+#endif
 #ifdef LIT_MEM
     s->d_buf = (ushf *)(s->pending_buf + (s->lit_bufsize << 1));
     s->l_buf = s->pending_buf + (s->lit_bufsize << 2);
@@ -593,7 +630,7 @@ int ZEXPORT deflateSetDictionary(z_streamp strm, const Bytef *dictionary,
         str = s->strstart;
         n = s->lookahead - (MIN_MATCH-1);
         do {
-            UPDATE_HASH(s, s->ins_h, s->window[str + MIN_MATCH-1]);
+            STRING_HASH(s, str);
 #ifndef FASTEST
             s->prev[str & s->w_mask] = s->head[s->ins_h];
 #endif
@@ -1307,7 +1344,7 @@ int ZEXPORT deflateCopy(z_streamp dest, z_streamp source) {
     zmemcpy((voidpf)ds, (voidpf)ss, sizeof(deflate_state));
     ds->strm = dest;
 
-    ds->window = (Bytef *) ZALLOC(dest, ds->w_size, 2*sizeof(Byte));
+    ds->window = (Bytef *) ZALLOC(dest, ds->w_size + WIN_PAD/2, 2*sizeof(Byte));
     ds->prev   = (Posf *)  ZALLOC(dest, ds->w_size, sizeof(Pos));
     ds->head   = (Posf *)  ZALLOC(dest, ds->hash_size, sizeof(Pos));
     ds->pending_buf = (uchf *) ZALLOC(dest, ds->lit_bufsize, 4);
@@ -1318,7 +1355,7 @@ int ZEXPORT deflateCopy(z_streamp dest, z_streamp source) {
         return Z_MEM_ERROR;
     }
     /* following zmemcpy do not work for 16-bit MSDOS */
-    zmemcpy(ds->window, ss->window, ds->w_size * 2 * sizeof(Byte));
+    zmemcpy(ds->window, ss->window, ds->w_size * 2 * sizeof(Byte) + WIN_PAD);
     zmemcpy((voidpf)ds->prev, (voidpf)ss->prev, ds->w_size * sizeof(Pos));
     zmemcpy((voidpf)ds->head, (voidpf)ss->head, ds->hash_size * sizeof(Pos));
     zmemcpy(ds->pending_buf, ss->pending_buf, (uInt)ds->pending_buf_size);
@@ -1340,6 +1377,54 @@ int ZEXPORT deflateCopy(z_streamp dest, z_streamp source) {
 }
 
 #ifndef FASTEST
+#ifdef DEFLATE_WIDE_MATCH
+/* ===========================================================================
+ * Load two bytes from a possibly unaligned address.
+ */
+local ush load16(const Bytef *p) {
+    ush val;
+
+    __builtin_memcpy(&val, p, 2);
+    return val;
+}
+
+/* ===========================================================================
+ * Return the number of bytes at the start of scan and match that are the
+ * same, up to MAX_MATCH. This reads up to 271 bytes from scan, so the window
+ * has WIN_PAD bytes after it.
+ */
+local int match_len(const Bytef *scan, const Bytef *match) {
+    int len = 0;
+#ifdef __SSE2__
+    unsigned neq;
+
+    do {
+        neq = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(
+                  _mm_loadu_si128((const __m128i *)(scan + len)),
+                  _mm_loadu_si128((const __m128i *)(match + len)))) ^ 0xffff;
+        if (neq) {
+            len += __builtin_ctz(neq);
+            return len < MAX_MATCH ? len : MAX_MATCH;
+        }
+        len += 16;
+    } while (len < MAX_MATCH);
+#else
+    Z_U8 a, b;
+
+    do {
+        __builtin_memcpy(&a, scan + len, 8);
+        __builtin_memcpy(&b, match + len, 8);
+        if (a != b) {
+            len += __builtin_ctzll(a ^ b) >> 3;
+            return len < MAX_MATCH ? len : MAX_MATCH;
+        }
+        len += 8;
+    } while (len < MAX_MATCH);
+#endif
+    return MAX_MATCH;
+}
+#endif
+
 /* ===========================================================================
  * Set match_start to the longest match starting at the given string and
  * return its length. Matches shorter or equal to prev_length are discarded,
@@ -1364,7 +1449,10 @@ local uInt longest_match(deflate_state *s, IPos cur_match) {
     Posf *prev = s->prev;
     uInt wmask = s->w_mask;
 
-#ifdef UNALIGNED_OK
+#if defined(DEFLATE_WIDE_MATCH)
+    register ush scan_start = load16(scan);
+    register ush scan_end   = load16(scan + best_len - 1);
+#elif defined(UNALIGNED_OK)
     /* Compare two bytes at a time. Note: this is not always beneficial.
      * Try with and without -DUNALIGNED_OK to check.
      */
@@ -1406,12 +1494,25 @@ local uInt longest_match(deflate_state *s, IPos cur_match) {
          * However the length of the match is limited to the lookahead, so
          * the output of deflate is not affected by the uninitialized values.
          */
-#if (defined(UNALIGNED_OK) && MAX_MATCH == 258)
+#if defined(DEFLATE_WIDE_MATCH)
+        if (load16(match + best_len - 1) != scan_end ||
+            load16(match) != scan_start) continue;
+
+        /* All of the match is compared, since a hash collision can leave
+         * scan[2] and match[2] different with DEFLATE_HASH4. Bytes past
+         * the lookahead may be compared, as below.
+         */
+        len = match_len(scan, match);
+
+#elif (defined(UNALIGNED_OK) && MAX_MATCH == 258)
         /* This code assumes sizeof(unsigned short) == 2. Do not use
          * UNALIGNED_OK if your compiler uses a different size.
          */
         if (*(ushf*)(match + best_len - 1) != scan_end ||
             *(ushf*)match != scan_start) continue;
+#ifdef DEFLATE_HASH4
+        if (match[2] != scan[2]) continue;
+#endif
 
         /* It is not necessary to compare scan[2] and match[2] since they are
          * always equal when the other bytes match, given that the hash keys
@@ -1446,12 +1547,16 @@ local uInt longest_match(deflate_state *s, IPos cur_match) {
             match[best_len - 1] != scan_end1 ||
             *match              != *scan     ||
             *++match            != scan[1])      continue;
+#ifdef DEFLATE_HASH4
+        if (match[1] != scan[2]) continue;
+#endif
 
         /* The check at best_len - 1 can be removed because it will be made
          * again later. (This heuristic is not always a win.)
          * It is not necessary to compare scan[2] and match[2] since they
          * are always equal when the other bytes match, given that
-         * the hash keys are equal and that HASH_BITS >= 8.
+         * the hash keys are equal and that HASH_BITS >= 8 (unless
+         * DEFLATE_HASH4, checked above).
          */
         scan += 2, match++;
         Assert(*scan == *match, "match[2]?");
@@ -1478,7 +1583,9 @@ local uInt longest_match(deflate_state *s, IPos cur_match) {
             s->match_start = cur_match;
             best_len = len;
             if (len >= nice_match) break;
-#ifdef UNALIGNED_OK
+#if defined(DEFLATE_WIDE_MATCH)
+            scan_end = load16(scan + best_len - 1);
+#elif defined(UNALIGNED_OK)
             scan_end = *(ushf*)(scan + best_len - 1);
 #else
             scan_end1  = scan[best_len - 1];
@@ -295,7 +295,39 @@ typedef struct internal_state {
  * distances are limited to MAX_DIST instead of WSIZE.
  */
 
-#define WIN_INIT MAX_MATCH
+/* DEFLATE_WIDE_MATCH, if defined, has longest_match() compare strings eight
+   bytes at a time (sixteen with SSE2), finding the first difference with a
+   count of trailing zeros. This needs GCC or clang and a 64-bit
+   little-endian processor. Define NO_DEFLATE_WIDE_MATCH to compare a byte at
+   a time. The output is the same either way.
+ */
+#if !defined(NO_DEFLATE_WIDE_MATCH) && !defined(FASTEST) && \
+    defined(__GNUC__) && defined(Z_U8) && \
+    defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#  define DEFLATE_WIDE_MATCH
+#endif
+
+/* DEFLATE_HASH4, if defined at compile time, has deflate hash the four bytes
+   at each position as a whole, with a CRC-32C instruction when the target has
+   one (SSE4.2 or ARMv8 CRC) and a multiplication otherwise, instead of
+   updating a rolling hash of three bytes. This spreads the hash chains over
+   the table better, at the cost of not finding most three-byte matches. The
+   output is valid deflate, but is not the same as without DEFLATE_HASH4, and
+   with a CRC-32C instruction depends on the target. Not used with FASTEST.
+ */
+#ifdef FASTEST
+#  undef DEFLATE_HASH4
+#endif
+
+#ifdef DEFLATE_WIDE_MATCH
+#  define WIN_PAD 16
+#else
+#  define WIN_PAD 0
+#endif
+/* Number of bytes allocated after the end of the window, so that
+   longest_match() can read a word past the longest match. */
+
+#define WIN_INIT (MAX_MATCH + WIN_PAD)
 /* Number of bytes after end of data in window to initialize in order to avoid
    memory checker errors from longest match routines */
 
@@ -154,6 +154,20 @@
    twice this must be able to fit in an unsigned type) */
 #define GZBUFSIZE 8192
 
+/* seek in the file, for gzseek() and to jump to index access points */
+#if defined(_WIN32) && !defined(__BORLANDC__)
+#  define LSEEK _lseeki64
+#else
+#if defined(_LARGEFILE64_SOURCE) && _LFS64_LARGEFILE-0
+#  define LSEEK lseek64
+#else
+#  define LSEEK lseek
+#endif
+#endif
+
+/* deflate window size, saved with each random access point */
+#define GZWINSIZE 32768U
+
 /* gzip modes, also provide a little integrity check on the passed structure */
 #define GZ_NONE 0
 #define GZ_READ 7247
@@ -165,6 +179,25 @@
 #define COPY 1      /* copy input directly */
 #define GZIP 2      /* decompress a gzip stream */
 
+/* random access index access point (see zlib.h and gzindex.c) */
+typedef struct {
+    z_off64_t out;          /* offset in uncompressed data */
+    z_off64_t in;           /* offset in file of first full byte */
+    int bits;               /* 0, or number of bits (1-7) from byte at in-1 */
+    unsigned wsize;         /* uncompressed data before out, up to 32K */
+    unsigned wlen;          /* length of window */
+    unsigned char *window;  /* the wsize bytes before out, compressed */
+} gz_point;
+
+/* random access index */
+struct gz_index_s {
+    z_off64_t span;         /* minimum distance between access points */
+    z_off64_t length;       /* total uncompressed length, -1 if incomplete */
+    int have;               /* number of access points in list */
+    int size;               /* number of access points allocated */
+    gz_point *list;         /* access points in increasing out order */
+};
+
 /* internal gzip file state data structure */
 typedef struct {
         /* exposed contents for gzgetc() macro */
@@ -186,6 +219,10 @@ typedef struct {
     z_off64_t start;        /* where the gzip data started, for rewinding */
     int eof;                /* true if end of input file reached */
     int past;               /* true if read requested past end */
+    z_off64_t raw;          /* file offset after the input read so far */
+    gzIndex index;          /* access points for seeking, or NULL */
+    int resumed;            /* true if inflating raw from an access point */
+    unsigned trail;         /* gzip trailer bytes left to skip */
         /* just for writing */
     int level;              /* compression level */
     int strategy;           /* compression strategy */
@@ -203,6 +240,10 @@ typedef gz_state FAR *gz_statep;
 
 /* shared functions */
 void ZLIB_INTERNAL gz_error(gz_statep, int, const char *);
+int ZLIB_INTERNAL gz_index_add(gzIndex, z_off64_t, z_off64_t, int,
+                               const unsigned char *, unsigned);
+gz_point ZLIB_INTERNAL *gz_index_find(gzIndex, z_off64_t);
+int ZLIB_INTERNAL gz_index_window(const gz_point *, unsigned char *);
 #if defined UNDER_CE
 char ZLIB_INTERNAL *gz_strwinerror(DWORD error);
 #endif
@@ -0,0 +1,328 @@
+/* gzindex.c -- zlib random access index for gzip files
+ * Copyright (C) 2005, 2012, 2018, 2023 Mark Adler
+ * For conditions of distribution and use, see copyright notice in zlib.h
+ */
+
+/* An access point can be made at the start of any deflate block, by saving
+   the offset in the file and the bit in that byte where the block starts, and
+   the 32K of uncompressed data that precede it.  Decompression can then
+   resume there with inflatePrime() and inflateSetDictionary() on a raw
+   inflate stream, as in examples/zran.c.  gzread.c adds access points to an
+   index while decompressing, and uses them to skip ahead when seeking.  The
+   windows are kept compressed, since a large file can have many of them.
+
+   The sidecar file written by gzindex_save() is, with all integers
+   little-endian:
+
+     8 bytes  "gzindex" and a version byte of 1
+     8 bytes  span
+     8 bytes  total uncompressed length, or all ones if incomplete
+     4 bytes  number of access points
+     for each access point:
+       8 bytes  offset in uncompressed data
+       8 bytes  offset in file of the first full byte
+       1 byte   number of bits (0-7) used from the byte before that
+       4 bytes  length of the uncompressed window (0-32768)
+       4 bytes  length of the compressed window
+       ...      the window, compressed in zlib format
+     4 bytes  CRC-32 of all of the above
+ */
+
+#include "gzguts.h"
+
+#define GZINDEX_MAGIC "gzindex\001"
+
+/* -- see zlib.h -- */
+gzIndex ZEXPORT gzindex_new(z_off64_t span) {
+    gzIndex index;
+
+    if (span <= 0)
+        return NULL;
+    index = (gzIndex)malloc(sizeof(struct gz_index_s));
+    if (index == NULL)
+        return NULL;
+    index->span = span;
+    index->length = -1;
+    index->have = 0;
+    index->size = 0;
+    index->list = NULL;
+    return index;
+}
+
+/* -- see zlib.h -- */
+void ZEXPORT gzindex_free(gzIndex index) {
+    int n;
+
+    if (index == NULL)
+        return;
+    for (n = 0; n < index->have; n++)
+        free(index->list[n].window);
+    free(index->list);
+    free(index);
+}
+
+/* -- see zlib.h -- */
+z_off64_t ZEXPORT gzindex_length(gzIndex index) {
+    return index == NULL ? -1 : index->length;
+}
+
+/* -- see zlib.h -- */
+int ZEXPORT gzuseindex(gzFile file, gzIndex index) {
+    gz_statep state;
+
+    /* get internal structure and check integrity */
+    if (file == NULL)
+        return -1;
+    state = (gz_statep)file;
+    if (state->mode != GZ_READ)
+        return -1;
+
+    state->index = index;
+    return 0;
+}
+
+/* Append an access point to index, taking ownership of its compressed
+   window. Return Z_OK, Z_MEM_ERROR if out of memory, or Z_STREAM_ERROR if the
+   access point is not valid or not after the last one. */
+local int add_point(gzIndex index, z_off64_t out, z_off64_t in, int bits,
+                    unsigned wsize, unsigned wlen, unsigned char *window) {
+    gz_point *point;
+
+    if (bits < 0 || bits > 7 || wsize > GZWINSIZE || in < (bits ? 1 : 0) ||
+            (index->have ? out <= index->list[index->have - 1].out :
+                           out != 0)) {
+        free(window);
+        return Z_STREAM_ERROR;
+    }
+
+    /* make room for another access point */
+    if (index->have == index->size) {
+        int size = index->size ? index->size << 1 : 8;
+
+        point = size < 0 || (size_t)size > (size_t)-1 / sizeof(gz_point) ?
+                NULL :
+                (gz_point *)realloc(index->list, size * sizeof(gz_point));
+        if (point == NULL) {
+            free(window);
+            return Z_MEM_ERROR;
+        }
+        index->list = point;
+        index->size = size;
+    }
+
+    point = index->list + index->have++;
+    point->out = out;
+    point->in = in;
+    point->bits = bits;
+    point->wsize = wsize;
+    point->wlen = wlen;
+    point->window = window;
+    return Z_OK;
+}
+
+/* Append an access point to index at uncompressed offset out, with the first
+   full byte at offset in in the file, bits bits from the byte before that,
+   and the wsize bytes of uncompressed data at window before it. Return Z_OK,
+   Z_MEM_ERROR if out of memory, or Z_STREAM_ERROR if the access point is not
+   after the last one. */
+int ZLIB_INTERNAL gz_index_add(gzIndex index, z_off64_t out, z_off64_t in,
+                               int bits, const unsigned char *window,
+                               unsigned wsize) {
+    unsigned char *comp = NULL;
+    uLongf len = 0;
+    int ret;
+
+    if (wsize > GZWINSIZE)
+        return Z_STREAM_ERROR;
+    if (wsize) {
+        len = compressBound(wsize);
+        comp = (unsigned char *)malloc(len);
+        if (comp == NULL)
+            return Z_MEM_ERROR;
+        ret = compress2(comp, &len, window, wsize, Z_BEST_SPEED);
+        if (ret != Z_OK) {
+            free(comp);
+            return ret;
+        }
+    }
+    return add_point(index, out, in, bits, wsize, (unsigned)len, comp);
+}
+
+/* Return the last access point in index at or before uncompressed offset out,
+   or NULL if there is none. */
+gz_point ZLIB_INTERNAL *gz_index_find(gzIndex index, z_off64_t out) {
+    int lo = -1, hi = index->have, mid;
+
+    while (hi - lo > 1) {
+        mid = lo + ((hi - lo) >> 1);
+        if (out < index->list[mid].out)
+            hi = mid;
+        else
+            lo = mid;
+    }
+    return lo < 0 ? NULL : index->list + lo;
+}
+
+/* Decompress the window of point into window, which has room for 32K bytes.
+   Return Z_OK, or a zlib error if the window is not valid. */
+int ZLIB_INTERNAL gz_index_window(const gz_point *point,
+                                  unsigned char *window) {
+    uLongf len = GZWINSIZE;
+    int ret;
+
+    ret = uncompress(window, &len, point->window, point->wlen);
+    if (ret == Z_OK && len != point->wsize)
+        ret = Z_DATA_ERROR;
+    return ret == Z_BUF_ERROR ? Z_DATA_ERROR : ret;
+}
+
+/* Write the low bytes bytes of val to out little-endian, updating the CRC at
+   *crc. A negative val is written as all ones. Return 0 on success, -1 on a
+   write error. */
+local int put_le(FILE *out, z_off64_t val, int bytes, uLong *crc) {
+    unsigned char buf[8];
+    int n;
+
+    for (n = 0; n < bytes; n++) {
+        buf[n] = val < 0 ? 0xff : (unsigned char)val;
+        val = val < 0 ? val : val >> 8;
+    }
+    *crc = crc32(*crc, buf, (uInt)bytes);
+    return fwrite(buf, 1, (size_t)bytes, out) == (size_t)bytes ? 0 : -1;
+}
+
+/* Read bytes bytes from in as a little-endian value into *val, updating the
+   CRC at *crc. Eight ones bytes are read as -1. Return 0 on success, or -1 on
+   error, end of file, or a value too large for z_off64_t. */
+local int get_le(FILE *in, z_off64_t *val, int bytes, uLong *crc) {
+    unsigned char buf[8];
+    z_off64_t got = 0;
+    int n;
+
+    if (fread(buf, 1, (size_t)bytes, in) != (size_t)bytes)
+        return -1;
+    *crc = crc32(*crc, buf, (uInt)bytes);
+    for (n = 0; n < bytes && buf[n] == 0xff; n++)
+        ;
+    if (bytes == 8 && n == 8) {
+        *val = -1;
+        return 0;
+    }
+    for (n = bytes - 1; n >= 0; n--) {
+        if (got >> (sizeof(z_off64_t) * 8 - 9))
+            return -1;
+        got = (got << 8) + buf[n];
+    }
+    *val = got;
+    return 0;
+}
+
+/* -- see zlib.h -- */
+int ZEXPORT gzindex_save(gzIndex index, const char *path) {
+    FILE *out;
+    uLong crc = crc32(0, Z_NULL, 0);
+    int n, ret = 0;
+    gz_point *point;
+
+    if (index == NULL || path == NULL)
+        return -1;
+    out = fopen(path, "wb");
+    if (out == NULL)
+        return -1;
+    crc = crc32(crc, (const Bytef *)GZINDEX_MAGIC, 8);
+    if (fwrite(GZINDEX_MAGIC, 1, 8, out) != 8 ||
+            put_le(out, index->span, 8, &crc) ||
+            put_le(out, index->length, 8, &crc) ||
+            put_le(out, index->have, 4, &crc))
+        ret = -1;
+    for (n = 0; ret == 0 && n < index->have; n++) {
+        point = index->list + n;
+        if (put_le(out, point->out, 8, &crc) ||
+                put_le(out, point->in, 8, &crc) ||
+                put_le(out, point->bits, 1, &crc) ||
+                put_le(out, point->wsize, 4, &crc) ||
+                put_le(out, point->wlen, 4, &crc) ||
+                (point->wlen &&
+                 fwrite(point->window, 1, point->wlen, out) != point->wlen))
+            ret = -1;
+        else if (point->wlen)
+            crc = crc32(crc, point->window, point->wlen);
+    }
+    if (ret == 0) {
+        unsigned char check[4];
+
+        for (n = 0; n < 4; n++)
+            check[n] = (unsigned char)(crc >> (n << 3));
+        if (fwrite(check, 1, 4, out) != 4)
+            ret = -1;
+    }
+    if (fclose(out))
+        ret = -1;
+    return ret;
+}
+
+/* -- see zlib.h -- */
+gzIndex ZEXPORT gzindex_load(const char *path) {
+    FILE *in;
+    unsigned char magic[8];
+    uLong crc = crc32(0, Z_NULL, 0), check = 0;
+    z_off64_t span, length, have, out, pos, bits, wsize, wlen;
+    gzIndex index = NULL;
+    unsigned char *plain = NULL, *window;
+    int n, ok = 0;
+
+    if (path == NULL)
+        return NULL;
+    in = fopen(path, "rb");
+    if (in == NULL)
+        return NULL;
+    if (fread(magic, 1, 8, in) != 8 || memcmp(magic, GZINDEX_MAGIC, 8))
+        goto done;
+    crc = crc32(crc, magic, 8);
+    if (get_le(in, &span, 8, &crc) || get_le(in, &length, 8, &crc) ||
+            get_le(in, &have, 4, &crc) || have > INT_MAX || length < -1 ||
+            (index = gzindex_new(span)) == NULL ||
+            (plain = (unsigned char *)malloc(GZWINSIZE)) == NULL)
+        goto done;
+    while (index->have < have) {
+        if (get_le(in, &out, 8, &crc) || get_le(in, &pos, 8, &crc) ||
+                get_le(in, &bits, 1, &crc) || get_le(in, &wsize, 4, &crc) ||
+                get_le(in, &wlen, 4, &crc) || wsize > GZWINSIZE ||
+                wlen > (z_off64_t)compressBound(GZWINSIZE) ||
+                (wsize == 0) != (wlen == 0))
+            goto done;
+        window = NULL;
+        if (wlen) {
+            window = (unsigned char *)malloc((size_t)wlen);
+            if (window == NULL)
+                goto done;
+            if (fread(window, 1, (size_t)wlen, in) != (size_t)wlen) {
+                free(window);
+                goto done;
+            }
+            crc = crc32(crc, window, (uInt)wlen);
+        }
+        if (add_point(index, out, pos, (int)bits, (unsigned)wsize,
+                      (unsigned)wlen, window) != Z_OK ||
+                (wsize && gz_index_window(index->list + index->have - 1,
+                                          plain) != Z_OK))
+            goto done;
+    }
+    if (fread(magic, 1, 4, in) != 4 || getc(in) != EOF)
+        goto done;
+    for (n = 0; n < 4; n++)
+        check += (uLong)magic[n] << (n << 3);
+    if (check != crc)
+        goto done;
+    index->length = length;
+    ok = 1;
+
+  done:
+    free(plain);
+    fclose(in);
+    if (!ok) {
+        gzindex_free(index);
+        return NULL;
+    }
+    return index;
+}
@@ -5,16 +5,6 @@
 
 #include "gzguts.h"
 
-#if defined(_WIN32) && !defined(__BORLANDC__)
-#  define LSEEK _lseeki64
-#else
-#if defined(_LARGEFILE64_SOURCE) && _LFS64_LARGEFILE-0
-#  define LSEEK lseek64
-#else
-#  define LSEEK lseek
-#endif
-#endif
-
 #if defined UNDER_CE
 
 /* Map the Windows error number in ERROR to a locale-dependent error message
@@ -72,6 +62,9 @@ local void gz_reset(gz_statep state) {
         state->eof = 0;             /* not at end of file */
         state->past = 0;            /* have not read past end yet */
         state->how = LOOK;          /* look for gzip header */
+        state->raw = state->start;  /* reading from the start */
+        state->resumed = 0;         /* not from an access point */
+        state->trail = 0;           /* no gzip trailer to skip */
     }
     else                            /* for writing ... */
         state->reset = 0;           /* no deflateReset pending */
@@ -104,6 +97,7 @@ local gzFile gz_open(const void *path, int fd, const char *mode) {
     state->size = 0;            /* no buffers allocated yet */
     state->want = GZBUFSIZE;    /* requested buffer size */
     state->msg = NULL;          /* no error message yet */
+    state->index = NULL;        /* no random access index */
 
     /* interpret mode */
     state->mode = GZ_NONE;
@@ -369,6 +363,7 @@ z_off64_t ZEXPORT gzseek64(gzFile file, z_off64_t offset, int whence) {
         ret = LSEEK(state->fd, offset - (z_off64_t)state->x.have, SEEK_CUR);
         if (ret == -1)
             return -1;
+        state->raw = ret;
         state->x.have = 0;
         state->eof = 0;
         state->past = 0;
@@ -24,6 +24,7 @@ local int gz_load(gz_statep state, unsigned char *buf, unsigned len,
             break;
         *have += (unsigned)ret;
     } while (*have < len);
+    state->raw += *have;
     if (ret < 0) {
         gz_error(state, Z_ERRNO, zstrerror());
         return -1;
@@ -75,6 +76,7 @@ local int gz_avail(gz_statep state) {
    gz_look() will return 0 on success or -1 on failure. */
 local int gz_look(gz_statep state) {
     z_streamp strm = &(state->strm);
+    unsigned n;
 
     /* allocate read buffers and inflate memory */
     if (state->size == 0) {
@@ -104,6 +106,22 @@ local int gz_look(gz_statep state) {
         }
     }
 
+    /* skip the trailer of a gzip member that was entered at an access point,
+       since its check value cannot be verified */
+    while (state->trail) {
+        if (strm->avail_in == 0 && gz_avail(state) == -1)
+            return -1;
+        if (strm->avail_in == 0) {
+            gz_error(state, Z_BUF_ERROR, "unexpected end of file");
+            state->trail = 0;
+            return 0;
+        }
+        n = strm->avail_in < state->trail ? strm->avail_in : state->trail;
+        strm->next_in += n;
+        strm->avail_in -= n;
+        state->trail -= n;
+    }
+
     /* get at least the magic bytes in the input buffer */
     if (strm->avail_in < 2) {
         if (gz_avail(state) == -1)
@@ -121,7 +139,7 @@ local int gz_look(gz_statep state) {
        single byte is sufficient indication that it is not a gzip file) */
     if (strm->avail_in > 1 &&
             strm->next_in[0] == 31 && strm->next_in[1] == 139) {
-        inflateReset(strm);
+        inflateReset2(strm, 15 + 16);   /* gunzip, also after raw inflate */
         state->how = GZIP;
         state->direct = 0;
         return 0;
@@ -148,15 +166,58 @@ local int gz_look(gz_statep state) {
     return 0;
 }
 
+/* Add an access point to the index being built for state at uncompressed
+   offset pos, if pos is far enough past the last one, or is the start for an
+   empty index. The inflate state must be at a deflate block boundary or the
+   end of a gzip header. Return -1 on failure, 0 on success. */
+local int gz_point_at(gz_statep state, z_off64_t pos) {
+    gzIndex index = state->index;
+    z_streamp strm = &(state->strm);
+    unsigned char *window;
+    uInt len;
+    int ret;
+
+    if (index->have ? pos - index->list[index->have - 1].out < index->span :
+                      pos != 0)
+        return 0;
+    window = (unsigned char *)malloc(GZWINSIZE);
+    if (window == NULL) {
+        gz_error(state, Z_MEM_ERROR, "out of memory");
+        return -1;
+    }
+    len = GZWINSIZE;
+    inflateGetDictionary(strm, window, &len);
+    ret = gz_index_add(index, pos, state->raw - strm->avail_in,
+                       strm->data_type & 7, window, len);
+    free(window);
+    if (ret != Z_OK) {
+        gz_error(state, ret, ret == Z_MEM_ERROR ? "out of memory" :
+                 "internal error: bad access point");
+        return -1;
+    }
+    return 0;
+}
+
+/* Mark an index being built for state as complete, having decompressed all of
+   the gzip data from the start, now that the end of the data has been
+   reached. */
+local void gz_index_end(gz_statep state) {
+    if (state->index != NULL && state->index->length == -1 &&
+            state->index->have && state->direct == 0 && state->err == Z_OK)
+        state->index->length = state->x.pos + state->x.have;
+}
+
 /* Decompress from input to the provided next_out and avail_out in the state.
    On return, state->x.have and state->x.next point to the just decompressed
    data.  If the gzip stream completes, state->how is reset to LOOK to look for
-   the next gzip stream or raw data, once state->x.have is depleted.  Returns 0
-   on success, -1 on failure. */
+   the next gzip stream or raw data, once state->x.have is depleted.  If an
+   index is being built, inflate() stops at each block boundary to consider an
+   access point there.  Returns 0 on success, -1 on failure. */
 local int gz_decomp(gz_statep state) {
     int ret = Z_OK;
     unsigned had;
     z_streamp strm = &(state->strm);
+    int build = state->index != NULL && state->index->length == -1;
 
     /* fill output buffer up to end of deflate stream */
     had = strm->avail_out;
@@ -170,7 +231,7 @@ local int gz_decomp(gz_statep state) {
         }
 
         /* decompress and handle errors */
-        ret = inflate(strm, Z_NO_FLUSH);
+        ret = inflate(strm, build ? Z_BLOCK : Z_NO_FLUSH);
         if (ret == Z_STREAM_ERROR || ret == Z_NEED_DICT) {
             gz_error(state, Z_STREAM_ERROR,
                      "internal error: inflate stream corrupt");
@@ -185,15 +246,29 @@ local int gz_decomp(gz_statep state) {
                      strm->msg == NULL ? "compressed data error" : strm->msg);
             return -1;
         }
+
+        /* consider an access point at the end of a header or block */
+        if (build && (strm->data_type & 0xc0) == 0x80 &&
+                gz_point_at(state, state->x.pos + (had - strm->avail_out))
+                    == -1)
+            return -1;
     } while (strm->avail_out && ret != Z_STREAM_END);
 
     /* update available output */
     state->x.have = had - strm->avail_out;
     state->x.next = strm->next_out - state->x.have;
 
-    /* if the gzip stream completed successfully, look for another */
-    if (ret == Z_STREAM_END)
+    /* if the gzip stream completed successfully, look for another, first
+       skipping the trailer if this member was entered at an access point */
+    if (ret == Z_STREAM_END) {
         state->how = LOOK;
+        if (state->resumed) {
+            state->resumed = 0;
+            state->trail = 8;
+        }
+        else if (state->eof && strm->avail_in == 0)
+            gz_index_end(state);
+    }
 
     /* good decompression */
     return 0;
@@ -213,8 +288,10 @@ local int gz_fetch(gz_statep state) {
         case LOOK:      /* -> LOOK, COPY (only if never GZIP), or GZIP */
             if (gz_look(state) == -1)
                 return -1;
-            if (state->how == LOOK)
+            if (state->how == LOOK) {
+                gz_index_end(state);
                 return 0;
+            }
             break;
         case COPY:      /* -> COPY */
             if (gz_load(state, state->out, state->size << 1, &(state->x.have))
@@ -232,10 +309,81 @@ local int gz_fetch(gz_statep state) {
     return 0;
 }
 
+/* If the index has an access point at or before the uncompressed offset
+   state->x.pos + *len that is past the data decompressed so far, then resume
+   decompression there, and reduce *len to the distance from there.  Return -1
+   on error, 0 on success whether or not an access point was used. */
+local int gz_jump(gz_statep state, z_off64_t *len) {
+    z_streamp strm = &(state->strm);
+    z_off64_t target = state->x.pos + *len;
+    gz_point *point;
+    unsigned char *window;
+    int ret;
+
+    /* find out if this is gzip data, for an index to apply */
+    if (state->how == LOOK && state->x.have == 0 && gz_look(state) == -1)
+        return -1;
+    if (state->how != GZIP || state->index->have == 0)
+        return 0;
+    point = gz_index_find(state->index, target);
+    if (point == NULL || point->out <= state->x.pos + (z_off64_t)state->x.have)
+        return 0;
+
+    /* position the file and inflate at the access point */
+    if (LSEEK(state->fd, point->in - (point->bits ? 1 : 0), SEEK_SET) == -1) {
+        gz_error(state, Z_ERRNO, zstrerror());
+        return -1;
+    }
+    state->raw = point->in - (point->bits ? 1 : 0);
+    state->eof = 0;
+    state->past = 0;
+    state->x.have = 0;
+    state->x.pos = point->out;
+    state->trail = 0;
+    strm->avail_in = 0;
+    inflateReset2(strm, -15);
+    state->resumed = 1;
+    if (point->bits) {
+        if (gz_avail(state) == -1)
+            return -1;
+        if (strm->avail_in == 0) {
+            gz_error(state, Z_BUF_ERROR, "unexpected end of file");
+            return -1;
+        }
+        inflatePrime(strm, point->bits, strm->next_in[0] >> (8 - point->bits));
+        strm->next_in++;
+        strm->avail_in--;
+    }
+    if (point->wsize) {
+        window = (unsigned char *)malloc(GZWINSIZE);
+        if (window == NULL) {
+            gz_error(state, Z_MEM_ERROR, "out of memory");
+            return -1;
+        }
+        ret = gz_index_window(point, window);
+        if (ret == Z_OK)
+            ret = inflateSetDictionary(strm, window, point->wsize);
+        free(window);
+        if (ret != Z_OK) {
+            gz_error(state, ret == Z_MEM_ERROR ? Z_MEM_ERROR : Z_DATA_ERROR,
+                     ret == Z_MEM_ERROR ? "out of memory" :
+                     "invalid index access point");
+            return -1;
+        }
+    }
+    state->how = GZIP;
+    *len = target - point->out;
+    return 0;
+}
+
 /* Skip len uncompressed bytes of output.  Return -1 on error, 0 on success. */
 local int gz_skip(gz_statep state, z_off64_t len) {
     unsigned n;
 
+    /* use an access point to get there faster if possible */
+    if (state->index != NULL && gz_jump(state, &len) == -1)
+        return -1;
+
     /* skip over len bytes or reach end-of-file, whichever comes first */
     while (len)
         /* skip over whatever is in output buffer */
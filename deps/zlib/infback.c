@@ -57,6 +57,7 @@ int ZEXPORT inflateBackInit_(z_streamp strm, int windowBits,
     state->wbits = (uInt)windowBits;
     state->wsize = 1U << windowBits;
     state->window = window;
+    state->wpad = 0;            /* the application's window is not padded */
     state->wnext = 0;
     state->whave = 0;
     state->sane = 1;
@@ -468,7 +469,8 @@ int ZEXPORT inflateBack(z_streamp strm, in_func in, void FAR *in_desc,
 
         case LEN:
             /* use inflate_fast() if we have enough input and output */
-            if (have >= 6 && left >= 258) {
+            if (have >= INFLATE_FAST_MIN_INPUT &&
+                left >= INFLATE_FAST_MIN_OUTPUT) {
                 RESTORE();
                 if (state->whave < state->wsize)
                     state->whave = state->wsize - left;
@@ -12,6 +12,59 @@
 #  pragma message("Assembler code may have bugs -- use at your own risk")
 #else
 
+#ifdef INFLATE_CHUNK_SIZE
+
+/*
+   Copy len bytes from from to out and return out + len. from must be in a
+   different buffer than out, or at least INFLATE_CHUNK_SIZE bytes before out,
+   so that each chunk is read only after it has been written. Up to
+   INFLATE_CHUNK_SIZE - 1 bytes past out + len are overwritten, and as many
+   past from + len are read.
+ */
+local unsigned char FAR *chunk_copy(unsigned char FAR *out,
+                                    const unsigned char FAR *from,
+                                    unsigned len) {
+    unsigned char FAR *end = out + len;
+
+    do {
+        memcpy(out, from, INFLATE_CHUNK_SIZE);
+        out += INFLATE_CHUNK_SIZE;
+        from += INFLATE_CHUNK_SIZE;
+    } while (out < end);
+    return end;
+}
+
+/*
+   Copy a match of len bytes from dist bytes back in the output, where dist
+   may be less than the length or the chunk size. For a short distance, enough
+   bytes are copied one at a time to extend the repeating pattern to at least
+   a chunk, which then can be copied from a multiple of dist back.
+ */
+local unsigned char FAR *chunk_copy_lapped(unsigned char FAR *out,
+                                           unsigned dist, unsigned len) {
+    unsigned char FAR *from = out - dist;
+    unsigned period, n;
+
+    if (dist >= INFLATE_CHUNK_SIZE)
+        return chunk_copy(out, from, len);
+    if (dist == 1) {                    /* run of one byte */
+        memset(out, *from, len);
+        return out + len;
+    }
+    period = dist;
+    while (period < INFLATE_CHUNK_SIZE)
+        period += dist;
+    n = period - dist;
+    if (n > len)
+        n = len;
+    len -= n;
+    while (n--)
+        *out++ = *from++;
+    return len ? chunk_copy(out, out - period, len) : out;
+}
+
+#endif /* INFLATE_CHUNK_SIZE */
+
 /*
    Decode literal, length, and distance codes and write out the resulting
    literal and match bytes until either not enough input or output is
@@ -23,8 +76,8 @@
    Entry assumptions:
 
         state->mode == LEN
-        strm->avail_in >= 6
-        strm->avail_out >= 258
+        strm->avail_in >= INFLATE_FAST_MIN_INPUT
+        strm->avail_out >= INFLATE_FAST_MIN_OUTPUT
         start >= strm->avail_out
         state->bits < 8
 
@@ -46,6 +99,15 @@
       bytes, which is the maximum length that can be coded.  inflate_fast()
       requires strm->avail_out >= 258 for each loop to avoid checking for
       output space.
+
+    - With INFLATE_FAST_WIDE, the bit buffer is refilled to at least 56 bits
+      at the top of each loop by loading eight bytes, which covers the 48
+      bits of a length/distance pair.  So strm->avail_in >= 8 is required.
+
+    - With INFLATE_CHUNK_SIZE, a match copy may write up to that many bytes
+      less one past its end, so that much more output space is required.
+      Those bytes are overwritten by later output, or lie past the output
+      that is reported.
  */
 void ZLIB_INTERNAL inflate_fast(z_streamp strm, unsigned start) {
     struct inflate_state FAR *state;
@@ -77,10 +139,10 @@ void ZLIB_INTERNAL inflate_fast(z_streamp strm, unsigned start) {
     /* copy state to local variables */
     state = (struct inflate_state FAR *)strm->state;
     in = strm->next_in;
-    last = in + (strm->avail_in - 5);
+    last = in + (strm->avail_in - (INFLATE_FAST_MIN_INPUT - 1));
     out = strm->next_out;
     beg = out - (start - strm->avail_out);
-    end = out + (strm->avail_out - 257);
+    end = out + (strm->avail_out - (INFLATE_FAST_MIN_OUTPUT - 1));
 #ifdef INFLATE_STRICT
     dmax = state->dmax;
 #endif
@@ -98,12 +160,25 @@ void ZLIB_INTERNAL inflate_fast(z_streamp strm, unsigned start) {
     /* decode literals and length/distances until end-of-block or not enough
        input data or output space */
     do {
+#ifdef INFLATE_FAST_WIDE
+        {
+            /* Bytes past those that fit are loaded again next time, and the
+               or leaves the bits already there unchanged. */
+            Z_U8 word;
+
+            memcpy(&word, in, 8);
+            hold |= (unsigned long)word << bits;
+            in += (63 - bits) >> 3;
+            bits |= 56;
+        }
+#else
         if (bits < 15) {
             hold += (unsigned long)(*in++) << bits;
             bits += 8;
             hold += (unsigned long)(*in++) << bits;
             bits += 8;
         }
+#endif
         here = lcode + (hold & lmask);
       dolen:
         op = (unsigned)(here->bits);
@@ -193,6 +268,33 @@ void ZLIB_INTERNAL inflate_fast(z_streamp strm, unsigned start) {
                         }
 #endif
                     }
+#ifdef INFLATE_CHUNK_SIZE
+                    if (state->wpad >= INFLATE_CHUNK_SIZE) {
+                        /* window is apart from the output and padded, so
+                           its runs can be copied a chunk at a time */
+                        if (wnext == 0 || wnext >= op) {
+                            from = window + (wnext ? wnext : wsize) - op;
+                            if (op > len) op = len;
+                            out = chunk_copy(out, from, op);
+                            len -= op;
+                        }
+                        else {                  /* wrap around window */
+                            from = window + wsize + wnext - op;
+                            op -= wnext;
+                            if (op > len) op = len;
+                            out = chunk_copy(out, from, op);
+                            len -= op;
+                            if (len) {          /* some from start of window */
+                                op = wnext < len ? wnext : len;
+                                out = chunk_copy(out, window, op);
+                                len -= op;
+                            }
+                        }
+                        if (len)                /* rest from output */
+                            out = chunk_copy_lapped(out, dist, len);
+                        continue;
+                    }
+#endif
                     from = window;
                     if (wnext == 0) {           /* very common case */
                         from += wsize - op;
@@ -246,6 +348,9 @@ void ZLIB_INTERNAL inflate_fast(z_streamp strm, unsigned start) {
                     }
                 }
                 else {
+#ifdef INFLATE_CHUNK_SIZE
+                    out = chunk_copy_lapped(out, dist, len);
+#else
                     from = out - dist;          /* copy direct from output */
                     do {                        /* minimum length is three */
                         *out++ = *from++;
@@ -258,6 +363,7 @@ void ZLIB_INTERNAL inflate_fast(z_streamp strm, unsigned start) {
                         if (len > 1)
                             *out++ = *from++;
                     }
+#endif
                 }
             }
             else if ((op & 64) == 0) {          /* 2nd level distance code */
@@ -295,9 +401,12 @@ void ZLIB_INTERNAL inflate_fast(z_streamp strm, unsigned start) {
     /* update state and return */
     strm->next_in = in;
     strm->next_out = out;
-    strm->avail_in = (unsigned)(in < last ? 5 + (last - in) : 5 - (in - last));
+    strm->avail_in = (unsigned)(in < last ?
+                                (INFLATE_FAST_MIN_INPUT - 1) + (last - in) :
+                                (INFLATE_FAST_MIN_INPUT - 1) - (in - last));
     strm->avail_out = (unsigned)(out < end ?
-                                 257 + (end - out) : 257 - (out - end));
+                                 (INFLATE_FAST_MIN_OUTPUT - 1) + (end - out) :
+                                 (INFLATE_FAST_MIN_OUTPUT - 1) - (out - end));
     state->hold = hold;
     state->bits = bits;
     return;
@@ -8,4 +8,45 @@
    subject to change. Applications should only use zlib.h.
  */
 
+/*
+   INFLATE_CHUNK_SIZE, if defined, is the number of bytes inflate_fast() copies
+   at a time for matches. A chunked copy may store up to INFLATE_CHUNK_SIZE - 1
+   bytes beyond the end of the match, and may read as far beyond the end of the
+   window. The extra output space is required on entry, and a window allocated
+   by inflate() has INFLATE_WINDOW_PAD readable bytes after it. Define
+   NO_INFLATE_CHUNK to copy a byte at a time.
+
+   INFLATE_FAST_WIDE, if defined, has inflate_fast() refill its 64-bit bit
+   buffer with one unaligned eight-byte load per length/distance pair instead
+   of one or two bytes at a time. This needs a little-endian processor.
+ */
+#if defined(STDC) && !defined(Z_SOLO) && !defined(NO_INFLATE_CHUNK)
+#  ifdef __AVX__
+#    define INFLATE_CHUNK_SIZE 32
+#  else
+#    define INFLATE_CHUNK_SIZE 16
+#  endif
+#  define INFLATE_WINDOW_PAD INFLATE_CHUNK_SIZE
+#else
+#  define INFLATE_WINDOW_PAD 0
+#endif
+
+#if !defined(NO_INFLATE_FAST_WIDE) && defined(Z_U8) && \
+    ULONG_MAX == 0xffffffffffffffff && \
+    defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#  define INFLATE_FAST_WIDE
+#endif
+
+/* inflate_fast() requires this much input and output to be available. */
+#ifdef INFLATE_FAST_WIDE
+#  define INFLATE_FAST_MIN_INPUT 8
+#else
+#  define INFLATE_FAST_MIN_INPUT 6
+#endif
+#ifdef INFLATE_CHUNK_SIZE
+#  define INFLATE_FAST_MIN_OUTPUT (258 + INFLATE_CHUNK_SIZE - 1)
+#else
+#  define INFLATE_FAST_MIN_OUTPUT 258
+#endif
+
 void ZLIB_INTERNAL inflate_fast(z_streamp strm, unsigned start);
@@ -206,6 +206,7 @@ int ZEXPORT inflateInit2_(z_streamp strm, int windowBits,
     strm->state = (struct internal_state FAR *)state;
     state->strm = strm;
     state->window = Z_NULL;
+    state->wpad = INFLATE_WINDOW_PAD;
     state->mode = HEAD;     /* to pass state test in inflateReset2() */
     ret = inflateReset2(strm, windowBits);
     if (ret != Z_OK) {
@@ -371,12 +372,16 @@ local int updatewindow(z_streamp strm, const Bytef *end, unsigned copy) {
 
     state = (struct inflate_state FAR *)strm->state;
 
-    /* if it hasn't been done already, allocate space for the window */
+    /* if it hasn't been done already, allocate space for the window, with
+       zeroed padding that inflate_fast() may read past its end */
     if (state->window == Z_NULL) {
         state->window = (unsigned char FAR *)
-                        ZALLOC(strm, 1U << state->wbits,
+                        ZALLOC(strm, (1U << state->wbits) + INFLATE_WINDOW_PAD,
                                sizeof(unsigned char));
         if (state->window == Z_NULL) return 1;
+#if INFLATE_WINDOW_PAD
+        zmemzero(state->window + (1U << state->wbits), INFLATE_WINDOW_PAD);
+#endif
     }
 
     /* if window not in use yet, initialize */
@@ -1024,7 +1029,8 @@ int ZEXPORT inflate(z_streamp strm, int flush) {
             state->mode = LEN;
                 /* fallthrough */
         case LEN:
-            if (have >= 6 && left >= 258) {
+            if (have >= INFLATE_FAST_MIN_INPUT &&
+                left >= INFLATE_FAST_MIN_OUTPUT) {
                 RESTORE();
                 inflate_fast(strm, out);
                 LOAD();
@@ -1454,7 +1460,8 @@ int ZEXPORT inflateCopy(z_streamp dest, z_streamp source) {
     window = Z_NULL;
     if (state->window != Z_NULL) {
         window = (unsigned char FAR *)
-                 ZALLOC(source, 1U << state->wbits, sizeof(unsigned char));
+                 ZALLOC(source, (1U << state->wbits) + INFLATE_WINDOW_PAD,
+                        sizeof(unsigned char));
         if (window == Z_NULL) {
             ZFREE(source, copy);
             return Z_MEM_ERROR;
@@ -1472,7 +1479,7 @@ int ZEXPORT inflateCopy(z_streamp dest, z_streamp source) {
     }
     copy->next = copy->codes + (state->next - state->codes);
     if (window != Z_NULL) {
-        wsize = 1U << state->wbits;
+        wsize = (1U << state->wbits) + INFLATE_WINDOW_PAD;
         zmemcpy(window, state->window, wsize);
     }
     copy->window = window;
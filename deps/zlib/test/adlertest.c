@@ -0,0 +1,130 @@
+/* adlertest.c -- check the processor-specific Adler-32 code against the scalar
+ * For conditions of distribution and use, see copyright notice in zlib.h
+ */
+
+/* adler32_z() may use SSSE3 or AVX2 code on x86, or NEON code on ARM. This
+   checks that every level available on the running processor gives the same
+   results as the portable code, which in turn is checked against a
+   byte-at-a-time reference, for all alignments, a wide range of lengths, and
+   starting values that include sums near the modulus. Link with the static
+   library to reach adler32_simd_level(). */
+
+#include "zutil.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SIZE 70000
+
+/* Byte-at-a-time reference Adler-32. */
+local unsigned long adler_ref(unsigned long adler, const unsigned char *buf,
+                              size_t len) {
+    unsigned long a = adler & 0xffff, b = adler >> 16;
+
+    while (len--) {
+        a = (a + *buf++) % 65521;
+        b = (b + a) % 65521;
+    }
+    return (b << 16) | a;
+}
+
+local int fails = 0;
+
+local void check(const char *what, int level, size_t off, size_t len,
+                 unsigned long got, unsigned long want) {
+    if (got != want) {
+        fprintf(stderr, "%s: level %d, offset %lu, length %lu: "
+                "got %08lx, want %08lx\n", what, level, (unsigned long)off,
+                (unsigned long)len, got, want);
+        if (++fails > 20)
+            exit(1);
+    }
+}
+
+int main(void) {
+    static const size_t big[] = {
+        1024, 1025, 1039, 4096, 5552, 5553, 8191, 65535, 65536, SIZE - 64
+    };
+    static const unsigned long inits[] = {
+        1, 0, 0xfff0fff0, 0xffedfff0, 0x12345678
+    };
+    unsigned char *buf, *ones;
+    unsigned long x = 1, init, want, got;
+    size_t off, len, i, cut;
+    int level, max;
+
+    buf = malloc(SIZE);
+    ones = malloc(SIZE);
+    if (buf == NULL || ones == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (i = 0; i < SIZE; i++) {
+        x = x * 1103515245 + 12345;
+        buf[i] = (unsigned char)(x >> 16);
+        ones[i] = 0xff;
+    }
+
+    /* The portable code against the reference. */
+    adler32_simd_level(0);
+    for (off = 0; off < 8; off++)
+        for (len = 0; len < 600; len++) {
+            init = len * 0x9e3779b9UL % 65521;
+            check("scalar", 0, off, len, adler32_z(init, buf + off, len),
+                  adler_ref(init, buf + off, len));
+        }
+    check("scalar", 0, 0, SIZE, adler32_z(1, buf, SIZE),
+          adler_ref(1, buf, SIZE));
+    check("scalar", 0, 0, SIZE, adler32_z(0xffeffff0, ones, SIZE),
+          adler_ref(0xffeffff0, ones, SIZE));
+
+    /* Every available processor-specific level against the portable code. */
+    max = adler32_simd_level(2);
+    printf("adler32_z processor-specific level: %d\n", max);
+    for (level = 1; level <= max; level++) {
+        for (off = 0; off < 64; off++) {
+            for (len = 0; len < 1024; len++) {
+                init = ((len + off) * 0x9e3779b9UL % 65521) << 16 | 1;
+                adler32_simd_level(0);
+                want = adler32_z(init, buf + off, len);
+                adler32_simd_level(level);
+                check("adler32_z", level, off, len,
+                      adler32_z(init, buf + off, len), want);
+            }
+            for (i = 0; i < sizeof(big) / sizeof(big[0]); i++) {
+                len = big[i];
+                init = inits[i % (sizeof(inits) / sizeof(inits[0]))];
+                adler32_simd_level(0);
+                want = adler32_z(init, buf + off, len);
+                adler32_simd_level(level);
+                check("adler32_z", level, off, len,
+                      adler32_z(init, buf + off, len), want);
+
+                /* all-ones input gives the largest sums */
+                adler32_simd_level(0);
+                want = adler32_z(init, ones + off, len);
+                adler32_simd_level(level);
+                check("adler32_z ones", level, off, len,
+                      adler32_z(init, ones + off, len), want);
+            }
+        }
+
+        /* Chained calls, and adler32() against adler32_z(). */
+        adler32_simd_level(0);
+        want = adler32_z(1, buf, SIZE);
+        adler32_simd_level(level);
+        for (cut = 0; cut < SIZE; cut += 4999) {
+            got = adler32_z(1, buf, cut);
+            got = adler32(got, buf + cut, (uInt)(SIZE - cut));
+            check("chained", level, 0, cut, got, want);
+        }
+    }
+    adler32_simd_level(2);
+    free(ones);
+    free(buf);
+    if (fails) {
+        fprintf(stderr, "%d failures\n", fails);
+        return 1;
+    }
+    printf("adler32_z tests passed\n");
+    return 0;
+}
@@ -0,0 +1,62 @@
+/* crcbench.c -- measure CRC-32 throughput of each crc32_z() implementation
+ * For conditions of distribution and use, see copyright notice in zlib.h
+ */
+
+/* Usage: crcbench [seconds]. For each processor-specific level available
+   (0 is the portable braid) and a range of buffer sizes, report the speed of
+   crc32_z() in MB/s. Link with the static library to reach
+   crc32_simd_level(). */
+
+#include "zutil.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define MAXLEN (1L << 20)
+
+int main(int argc, char **argv) {
+    static const long sizes[] = { 64, 256, 1024, 4096, 16384, 65536, MAXLEN };
+    static const char *names[] = { "braid", "pclmul", "vpclmul" };
+    double secs = argc > 1 ? atof(argv[1]) : 0.25;
+    unsigned char *buf;
+    unsigned long crc = 0;
+    int level, max;
+    size_t i;
+    long n;
+
+    buf = malloc(MAXLEN);
+    if (buf == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (n = 0; n < MAXLEN; n++)
+        buf[n] = (unsigned char)(n * 2654435761UL >> 13);
+
+    max = crc32_simd_level(2);
+    printf("%-8s", "size");
+    for (level = 0; level <= max; level++)
+        printf(" %10s", names[level]);
+    printf("   (MB/s)\n");
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        printf("%-8ld", sizes[i]);
+        for (level = 0; level <= max; level++) {
+            clock_t start, end;
+            double bytes = 0;
+
+            crc32_simd_level(level);
+            start = clock();
+            do {
+                for (n = 0; n < MAXLEN; n += sizes[i])
+                    crc = crc32_z(crc, buf + n, (z_size_t)sizes[i]);
+                bytes += MAXLEN;
+                end = clock();
+            } while (end - start < secs * CLOCKS_PER_SEC);
+            printf(" %10.0f", bytes / 1e6 /
+                   ((double)(end - start) / CLOCKS_PER_SEC));
+        }
+        printf("\n");
+    }
+    crc32_simd_level(2);
+    free(buf);
+    return crc == 0x12345678;       /* use crc so the loop is not removed */
+}
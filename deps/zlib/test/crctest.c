@@ -0,0 +1,115 @@
+/* crctest.c -- check the processor-specific CRC-32 code against the braid
+ * For conditions of distribution and use, see copyright notice in zlib.h
+ */
+
+/* crc32_z() may use PCLMULQDQ or VPCLMULQDQ code on x86. This checks that
+   every level available on the running processor gives bit-exact results
+   against the portable braided calculation, which in turn is checked against
+   a bit-at-a-time reference, for all alignments and a wide range of lengths
+   and starting CRCs. Link with the static library to reach
+   crc32_simd_level(). */
+
+#include "zutil.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SIZE 70000
+
+/* Bit-at-a-time reference CRC-32. */
+local unsigned long crc_ref(unsigned long crc, const unsigned char *buf,
+                            size_t len) {
+    int k;
+
+    crc = (~crc) & 0xffffffff;
+    while (len--) {
+        crc ^= *buf++;
+        for (k = 0; k < 8; k++)
+            crc = crc & 1 ? (crc >> 1) ^ 0xedb88320 : crc >> 1;
+    }
+    return crc ^ 0xffffffff;
+}
+
+local int fails = 0;
+
+local void check(const char *what, int level, size_t off, size_t len,
+                 unsigned long got, unsigned long want) {
+    if (got != want) {
+        fprintf(stderr, "%s: level %d, offset %lu, length %lu: "
+                "got %08lx, want %08lx\n", what, level, (unsigned long)off,
+                (unsigned long)len, got, want);
+        if (++fails > 20)
+            exit(1);
+    }
+}
+
+int main(void) {
+    static const size_t big[] = {
+        1024, 1025, 1039, 4096, 4111, 8191, 65535, 65536, 65600, SIZE - 64
+    };
+    unsigned char *buf;
+    unsigned long x = 1, init, want, got;
+    size_t off, len, i, cut;
+    int level, max;
+
+    buf = malloc(SIZE);
+    if (buf == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (i = 0; i < SIZE; i++) {
+        x = x * 1103515245 + 12345;
+        buf[i] = (unsigned char)(x >> 16);
+    }
+
+    /* The braid against the reference. */
+    crc32_simd_level(0);
+    for (off = 0; off < 8; off++)
+        for (len = 0; len < 600; len++) {
+            init = len * 0x9e3779b9UL & 0xffffffff;
+            check("braid", 0, off, len, crc32_z(init, buf + off, len),
+                  crc_ref(init, buf + off, len));
+        }
+    check("braid", 0, 0, SIZE, crc32_z(0, buf, SIZE), crc_ref(0, buf, SIZE));
+
+    /* Every available processor-specific level against the braid. */
+    max = crc32_simd_level(2);
+    printf("crc32_z processor-specific level: %d\n", max);
+    for (level = 1; level <= max; level++) {
+        for (off = 0; off < 64; off++) {
+            for (len = 0; len < 1024; len++) {
+                init = (len + off) * 0x9e3779b9UL & 0xffffffff;
+                crc32_simd_level(0);
+                want = crc32_z(init, buf + off, len);
+                crc32_simd_level(level);
+                check("crc32_z", level, off, len,
+                      crc32_z(init, buf + off, len), want);
+            }
+            for (i = 0; i < sizeof(big) / sizeof(big[0]); i++) {
+                len = big[i];
+                crc32_simd_level(0);
+                want = crc32_z(off, buf + off, len);
+                crc32_simd_level(level);
+                check("crc32_z", level, off, len,
+                      crc32_z(off, buf + off, len), want);
+            }
+        }
+
+        /* Chained calls, and crc32() against crc32_z(). */
+        crc32_simd_level(0);
+        want = crc32_z(0, buf, SIZE);
+        crc32_simd_level(level);
+        for (cut = 0; cut < SIZE; cut += 4999) {
+            got = crc32_z(0, buf, cut);
+            got = crc32(got, buf + cut, (uInt)(SIZE - cut));
+            check("chained", level, 0, cut, got, want);
+        }
+    }
+    crc32_simd_level(2);
+    free(buf);
+    if (fails) {
+        fprintf(stderr, "%d failures\n", fails);
+        return 1;
+    }
+    printf("crc32_z tests passed\n");
+    return 0;
+}
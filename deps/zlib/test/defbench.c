@@ -0,0 +1,163 @@
+/* defbench.c -- measure deflate() ratio and speed at levels 1, 6, and 9
+ * For conditions of distribution and use, see copyright notice in zlib.h
+ */
+
+/* Usage: defbench [seconds [file ...]]. Compress each file, or generated
+   data with a mix of text, records, and noise if none are given, at levels
+   1, 6, and 9, check that it inflates back to the original, and report the
+   compression ratio and the deflate and inflate speeds in MB/s. Compare
+   builds with and without -DDEFLATE_HASH4 or -DNO_DEFLATE_WIDE_MATCH. */
+
+#include "zlib.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAXLEN (64L << 20)
+
+static double rate(double bytes, clock_t start, clock_t end) {
+    return bytes / 1e6 / ((double)(end - start) / CLOCKS_PER_SEC);
+}
+
+/* Read up to MAXLEN bytes of name into a new buffer. */
+static unsigned char *load(const char *name, size_t *len) {
+    FILE *in = fopen(name, "rb");
+    unsigned char *buf;
+
+    if (in == NULL)
+        return NULL;
+    buf = malloc(MAXLEN);
+    if (buf != NULL)
+        *len = fread(buf, 1, MAXLEN, in);
+    fclose(in);
+    return buf;
+}
+
+/* Generate len bytes in 64K pieces of text, fixed-size records with small
+   numbers, and noise, roughly in the proportions of a mixed corpus. */
+static unsigned char *make(size_t len) {
+    static const char *words[] = {
+        "the ", "of ", "and ", "compression ", "window ", "match ",
+        "length ", "distance ", "code ", "table ", "stream ", ". ", "\n",
+        "data ", "a ", "buffer ", "in ", "is ", "for ", "hash "
+    };
+    unsigned char *buf = malloc(len);
+    unsigned long x = 1;
+    size_t i = 0, end;
+    const char *w;
+
+    if (buf == NULL)
+        return NULL;
+    while (i < len) {
+        x = x * 1103515245 + 12345;
+        end = i + 65536 < len ? i + 65536 : len;
+        switch ((x >> 16) % 5) {
+        case 0: case 1: case 2:         /* text */
+            while (i < end) {
+                x = x * 1103515245 + 12345;
+                for (w = words[(x >> 16) % 20]; *w && i < end; w++)
+                    buf[i++] = (unsigned char)*w;
+            }
+            break;
+        case 3:                         /* records */
+            while (i < end) {
+                x = x * 1103515245 + 12345;
+                buf[i] = (unsigned char)(i >> 4);
+                if (i + 1 < end) buf[i + 1] = 0;
+                if (i + 2 < end) buf[i + 2] = (unsigned char)((x >> 16) & 7);
+                if (i + 3 < end) buf[i + 3] = 0x80;
+                i += 4;
+            }
+            i = end;
+            break;
+        default:                        /* noise */
+            while (i < end) {
+                x = x * 1103515245 + 12345;
+                buf[i++] = (unsigned char)(x >> 16);
+            }
+        }
+    }
+    return buf;
+}
+
+static int bench(const char *name, const unsigned char *data, size_t len,
+                 double secs) {
+    static const int levels[] = { 1, 6, 9 };
+    uLongf bound = compressBound(len), clen = 0, got;
+    unsigned char *comp = malloc(bound), *out = malloc(len ? len : 1);
+    size_t i;
+
+    if (comp == NULL || out == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (i = 0; i < sizeof(levels) / sizeof(levels[0]); i++) {
+        clock_t start, end;
+        double dbytes = 0, ibytes = 0, dtime, itime;
+
+        start = clock();
+        do {
+            clen = bound;
+            if (compress2(comp, &clen, data, len, levels[i]) != Z_OK) {
+                fprintf(stderr, "%s: compress2 failed\n", name);
+                return 1;
+            }
+            dbytes += len;
+            end = clock();
+        } while (end - start < secs * CLOCKS_PER_SEC);
+        dtime = rate(dbytes, start, end);
+
+        start = clock();
+        do {
+            got = len;
+            if (uncompress(out, &got, comp, clen) != Z_OK || got != len ||
+                memcmp(out, data, len)) {
+                fprintf(stderr, "%s: level %d did not round trip\n", name,
+                        levels[i]);
+                return 1;
+            }
+            ibytes += len;
+            end = clock();
+        } while (end - start < secs * CLOCKS_PER_SEC);
+        itime = rate(ibytes, start, end);
+
+        printf("%-24s %5d %12lu %12lu %8.3f %10.1f %10.1f\n", name,
+               levels[i], (unsigned long)len, (unsigned long)clen,
+               clen ? (double)len / clen : 0.0, dtime, itime);
+    }
+    free(out);
+    free(comp);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    double secs = argc > 1 ? atof(argv[1]) : 0.5;
+    unsigned char *data;
+    size_t len = 16L << 20;
+    int i, ret = 0;
+
+    printf("%-24s %5s %12s %12s %8s %10s %10s\n", "input", "level", "bytes",
+           "compressed", "ratio", "deflate", "inflate");
+    if (argc <= 2) {
+        data = make(len);
+        if (data == NULL) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+        ret = bench("(generated)", data, len, secs);
+        free(data);
+        return ret;
+    }
+    for (i = 2; i < argc; i++) {
+        data = load(argv[i], &len);
+        if (data == NULL) {
+            fprintf(stderr, "%s: could not read\n", argv[i]);
+            ret = 1;
+            continue;
+        }
+        ret |= bench(argv[i], data, len, secs);
+        free(data);
+    }
+    return ret;
+}
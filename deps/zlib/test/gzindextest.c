@@ -0,0 +1,272 @@
+/* gzindextest.c -- check gzseek() and gzread() with a random access index
+ * For conditions of distribution and use, see copyright notice in zlib.h
+ */
+
+/* This writes a gzip file of several members, some with stored blocks and
+   some that end mid-byte, then builds an index for it by reading it through,
+   and checks that seeks forward and backward with the index give the same
+   data as without one. It also saves and loads the index, continues building
+   a partial index after loading it, shares a complete index between two
+   gzFile objects, and checks that an index does not disturb reading a file
+   that is not gzip. */
+
+#include "zlib.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIZE 3000000L
+#define SPAN 65536
+#define NAME "gzindextest.gz"
+#define INDEX "gzindextest.gzi"
+#define PLAIN "gzindextest.txt"
+
+static int fails = 0;
+
+static void fail(const char *what, long pos) {
+    fprintf(stderr, "%s at offset %ld\n", what, pos);
+    if (++fails > 20)
+        exit(1);
+}
+
+/* Fill buf with text-like data that has long matches, and some noise. */
+static void fill(unsigned char *buf, long len) {
+    unsigned long x = 1;
+    long i = 0, n;
+
+    while (i < len) {
+        x = x * 1103515245 + 12345;
+        n = 1 + (long)((x >> 8) % 200);
+        if (n > len - i)
+            n = len - i;
+        if (((x >> 20) & 3) == 0 || i < 1000)
+            while (n--) {
+                x = x * 1103515245 + 12345;
+                buf[i++] = (unsigned char)('a' + (x >> 16) % 26);
+            }
+        else
+            while (n--) {
+                buf[i] = buf[i - 1 - (long)((x >> 4) % 999)];
+                i++;
+            }
+    }
+}
+
+/* Write data to NAME in four gzip members with different settings. */
+static int write_gz(const unsigned char *data, long len) {
+    static const char *modes[] = { "wb6", "ab1", "ab0", "ab9f" };
+    long at = 0, n;
+    gzFile gz;
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        gz = gzopen(NAME, modes[i]);
+        if (gz == NULL)
+            return -1;
+        n = i == 3 ? len - at : len / 4;
+        if (gzwrite(gz, data + at, (unsigned)n) != n || gzclose(gz) != Z_OK)
+            return -1;
+        at += n;
+    }
+    return 0;
+}
+
+/* Read all of file into buf, and return the number of bytes read. */
+static long read_all(gzFile gz, unsigned char *buf, long len) {
+    long got = 0;
+    int n;
+
+    while (got < len &&
+           (n = gzread(gz, buf + got,
+                       (unsigned)(len - got < 99999 ? len - got : 99999))) > 0)
+        got += n;
+    return got;
+}
+
+/* Seek to pos in gz and check that reading len bytes there matches want. */
+static void check_at(gzFile gz, const unsigned char *want, long size,
+                     long pos, long len, unsigned char *buf) {
+    int got;
+
+    if (gzseek(gz, pos, SEEK_SET) != pos) {
+        fail("gzseek", pos);
+        return;
+    }
+    if (len > size - pos)
+        len = size - pos;
+    got = gzread(gz, buf, (unsigned)len);
+    if (got != len || memcmp(buf, want + pos, (size_t)len))
+        fail("gzread after gzseek", pos);
+    if (gztell(gz) != pos + len)
+        fail("gztell", pos);
+}
+
+/* Check a series of forward and backward seeks in the file with index. */
+static void check_seeks(gzIndex index, const unsigned char *data,
+                        unsigned char *buf, int count) {
+    unsigned long x = 7;
+    gzFile gz;
+    long pos;
+    int i;
+
+    gz = gzopen(NAME, "rb");
+    if (gz == NULL || gzuseindex(gz, index)) {
+        fail("gzopen", 0);
+        return;
+    }
+    check_at(gz, data, SIZE, SIZE - 10, 100, buf);
+    check_at(gz, data, SIZE, 0, 5000, buf);
+    check_at(gz, data, SIZE, SIZE / 4, 5000, buf);
+    check_at(gz, data, SIZE, SIZE / 4 - 1, 2, buf);
+    for (i = 0; i < count; i++) {
+        x = x * 1103515245 + 12345;
+        pos = (long)((x >> 4) % SIZE);
+        check_at(gz, data, SIZE, pos, 1 + (long)((x >> 8) % 70000), buf);
+    }
+    if (gzseek(gz, SIZE + 10, SEEK_SET) != SIZE + 10 ||
+            gzread(gz, buf, 1) != 0 || !gzeof(gz))
+        fail("read past end", SIZE);
+    gzclose(gz);
+}
+
+int main(void) {
+    unsigned char *data, *buf, *buf2;
+    gzIndex index, loaded, partial;
+    gzFile gz, gz2;
+    FILE *out;
+    long pos;
+    int i;
+
+    data = malloc(SIZE);
+    buf = malloc(SIZE);
+    buf2 = malloc(SIZE);
+    if (data == NULL || buf == NULL || buf2 == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    fill(data, SIZE);
+    if (write_gz(data, SIZE)) {
+        fprintf(stderr, "could not write %s\n", NAME);
+        return 1;
+    }
+
+    /* Build an index by reading through, in odd-sized pieces. */
+    index = gzindex_new(SPAN);
+    gz = gzopen(NAME, "rb");
+    if (index == NULL || gz == NULL || gzuseindex(gz, index)) {
+        fprintf(stderr, "could not set up index\n");
+        return 1;
+    }
+    if (gzindex_length(index) != -1)
+        fail("new index not incomplete", 0);
+    gzbuffer(gz, 1000);
+    if (read_all(gz, buf, SIZE) != SIZE || memcmp(buf, data, SIZE))
+        fail("read while building index", 0);
+    if (gzread(gz, buf, 1) != 0 || gzindex_length(index) != SIZE)
+        fail("index not complete at end", SIZE);
+    gzclose(gz);
+
+    /* Seeks with the complete index, and with a loaded copy of it. */
+    check_seeks(index, data, buf, 200);
+    if (gzindex_save(index, INDEX)) {
+        fprintf(stderr, "could not write %s\n", INDEX);
+        return 1;
+    }
+    loaded = gzindex_load(INDEX);
+    if (loaded == NULL || gzindex_length(loaded) != SIZE)
+        fail("gzindex_load", 0);
+    else
+        check_seeks(loaded, data, buf, 50);
+
+    /* A corrupted sidecar is rejected. */
+    out = fopen(INDEX, "r+b");
+    if (out != NULL) {
+        fseek(out, 60, SEEK_SET);
+        putc(getc(out) ^ 1, out);
+        fclose(out);
+    }
+    partial = gzindex_load(INDEX);
+    if (partial != NULL) {
+        fail("corrupt index loaded", 0);
+        gzindex_free(partial);
+    }
+
+    /* Build part of an index, save it, load it, and complete it with seeks. */
+    partial = gzindex_new(SPAN);
+    gz = gzopen(NAME, "rb");
+    if (partial == NULL || gz == NULL || gzuseindex(gz, partial)) {
+        fprintf(stderr, "could not set up partial index\n");
+        return 1;
+    }
+    if (gzread(gz, buf, SIZE / 3) != SIZE / 3 || memcmp(buf, data, SIZE / 3))
+        fail("partial read", 0);
+    gzclose(gz);
+    if (gzindex_length(partial) != -1 || gzindex_save(partial, INDEX))
+        fail("partial index", SIZE / 3);
+    gzindex_free(partial);
+    partial = gzindex_load(INDEX);
+    if (partial == NULL || gzindex_length(partial) != -1) {
+        fail("partial index load", 0);
+        return 1;
+    }
+    gz = gzopen(NAME, "rb");
+    if (gz == NULL || gzuseindex(gz, partial)) {
+        fprintf(stderr, "could not reopen %s\n", NAME);
+        return 1;
+    }
+    check_at(gz, data, SIZE, SIZE / 2, 1000, buf);
+    check_at(gz, data, SIZE, SIZE / 5, 1000, buf);
+    if (read_all(gz, buf, SIZE) != SIZE - SIZE / 5 - 1000 ||
+            memcmp(buf, data + SIZE / 5 + 1000, SIZE - SIZE / 5 - 1000) ||
+            gzindex_length(partial) != SIZE)
+        fail("completing partial index", SIZE / 5);
+    gzclose(gz);
+    check_seeks(partial, data, buf, 50);
+    gzindex_free(partial);
+
+    /* Two readers interleaved with one complete index. */
+    gz = gzopen(NAME, "rb");
+    gz2 = gzopen(NAME, "rb");
+    if (gz == NULL || gz2 == NULL || gzuseindex(gz, index) ||
+            gzuseindex(gz2, index)) {
+        fprintf(stderr, "could not open two readers\n");
+        return 1;
+    }
+    for (i = 0; i < 40; i++) {
+        pos = (long)(((unsigned long)i * 2654435761UL) % SIZE);
+        check_at(gz, data, SIZE, pos, 3000, buf);
+        check_at(gz2, data, SIZE, SIZE - 1 - pos, 3000, buf2);
+    }
+    gzclose(gz2);
+    gzclose(gz);
+
+    /* A file that is not gzip is read as is. */
+    out = fopen(PLAIN, "wb");
+    if (out == NULL || fwrite(data, 1, 200000, out) != 200000 || fclose(out)) {
+        fprintf(stderr, "could not write %s\n", PLAIN);
+        return 1;
+    }
+    gz = gzopen(PLAIN, "rb");
+    if (gz == NULL || gzuseindex(gz, index)) {
+        fprintf(stderr, "could not open %s\n", PLAIN);
+        return 1;
+    }
+    check_at(gz, data, 200000, 150000, 1000, buf);
+    check_at(gz, data, 200000, 10, 1000, buf);
+    gzclose(gz);
+
+    gzindex_free(loaded);
+    gzindex_free(index);
+    remove(PLAIN);
+    remove(INDEX);
+    remove(NAME);
+    free(buf2);
+    free(buf);
+    free(data);
+    if (fails) {
+        fprintf(stderr, "%d failures\n", fails);
+        return 1;
+    }
+    printf("gzip index tests passed\n");
+    return 0;
+}
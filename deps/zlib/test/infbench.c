@@ -0,0 +1,149 @@
+/* infbench.c -- measure Adler-32 and inflate() throughput
+ * For conditions of distribution and use, see copyright notice in zlib.h
+ */
+
+/* Usage: infbench [seconds [file]]. Report the speed of adler32_z() in MB/s
+   for each processor-specific level available (0 is the portable code), then
+   the speed of inflate() on zlib streams of the file, or of generated data,
+   compressed at levels 1, 6, and 9. Link with the static library to reach
+   adler32_simd_level(). */
+
+#include "zutil.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define MAXLEN (1L << 20)
+
+local double rate(double bytes, clock_t start, clock_t end) {
+    return bytes / 1e6 / ((double)(end - start) / CLOCKS_PER_SEC);
+}
+
+/* Read up to MAXLEN * 16 bytes of name into a new buffer. */
+local unsigned char *load(const char *name, size_t *len) {
+    FILE *in = fopen(name, "rb");
+    unsigned char *buf;
+
+    if (in == NULL)
+        return NULL;
+    buf = malloc(MAXLEN * 16);
+    if (buf != NULL)
+        *len = fread(buf, 1, MAXLEN * 16, in);
+    fclose(in);
+    return buf;
+}
+
+/* Generate len bytes of text-like data with plenty of matches. */
+local unsigned char *make(size_t len) {
+    static const char *words[] = {
+        "the ", "of ", "inflate ", "window ", "match ", "length ",
+        "distance ", "code ", "table ", "stream ", "\n", "zlib ", "a ",
+        "buffer ", "copy ", "bits "
+    };
+    unsigned char *buf = malloc(len);
+    unsigned long x = 1;
+    size_t i = 0;
+    const char *w;
+
+    if (buf == NULL)
+        return NULL;
+    while (i < len) {
+        x = x * 1103515245 + 12345;
+        for (w = words[(x >> 16) & 15]; *w && i < len; w++)
+            buf[i++] = (unsigned char)*w;
+        if (((x >> 24) & 7) == 0 && i < len)
+            buf[i++] = (unsigned char)('0' + (x >> 8) % 10);
+    }
+    return buf;
+}
+
+int main(int argc, char **argv) {
+    static const long sizes[] = { 64, 256, 4096, 65536, MAXLEN };
+    static const char *names[] = { "scalar", "ssse3", "avx2" };
+    double secs = argc > 1 ? atof(argv[1]) : 0.25;
+    unsigned char *buf, *data, *comp, *out;
+    unsigned long adler = 1;
+    size_t len = MAXLEN * 8, i;
+    uLongf clen;
+    int level, max;
+    long n;
+
+    buf = malloc(MAXLEN);
+    if (buf == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (n = 0; n < MAXLEN; n++)
+        buf[n] = (unsigned char)(n * 2654435761UL >> 13);
+
+    max = adler32_simd_level(2);
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    names[1] = "neon";
+#endif
+    printf("adler32_z\n%-8s", "size");
+    for (level = 0; level <= max; level++)
+        printf(" %10s", names[level]);
+    printf("   (MB/s)\n");
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        printf("%-8ld", sizes[i]);
+        for (level = 0; level <= max; level++) {
+            clock_t start, end;
+            double bytes = 0;
+
+            adler32_simd_level(level);
+            start = clock();
+            do {
+                for (n = 0; n < MAXLEN; n += sizes[i])
+                    adler = adler32_z(adler, buf + n, (z_size_t)sizes[i]);
+                bytes += MAXLEN;
+                end = clock();
+            } while (end - start < secs * CLOCKS_PER_SEC);
+            printf(" %10.0f", rate(bytes, start, end));
+        }
+        printf("\n");
+    }
+    adler32_simd_level(2);
+    free(buf);
+
+    data = argc > 2 ? load(argv[2], &len) : make(len);
+    if (data == NULL) {
+        fprintf(stderr, "could not %s\n", argc > 2 ? "read file" :
+                "allocate memory");
+        return 1;
+    }
+    comp = malloc(compressBound(len));
+    out = malloc(len);
+    if (comp == NULL || out == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    printf("\ninflate, %lu bytes\n%-8s %10s %10s   (MB/s of output)\n",
+           (unsigned long)len, "level", "ratio", "inflate");
+    for (level = 1; level <= 9; level += level == 1 ? 5 : 3) {
+        clock_t start, end;
+        double bytes = 0;
+        uLongf got;
+
+        clen = compressBound(len);
+        if (compress2(comp, &clen, data, len, level) != Z_OK) {
+            fprintf(stderr, "compress2 failed\n");
+            return 1;
+        }
+        start = clock();
+        do {
+            got = len;
+            if (uncompress(out, &got, comp, clen) != Z_OK || got != len) {
+                fprintf(stderr, "uncompress failed\n");
+                return 1;
+            }
+            bytes += len;
+            end = clock();
+        } while (end - start < secs * CLOCKS_PER_SEC);
+        printf("%-8d %10.3f %10.0f\n", level, (double)len / clen,
+               rate(bytes, start, end));
+    }
+    free(out);
+    free(comp);
+    free(data);
+    return adler == 0x12345678;     /* use adler so the loop is not removed */
+}
@@ -0,0 +1,254 @@
+/* inftest.c -- check inflate() and inflateBack() round trips
+ * For conditions of distribution and use, see copyright notice in zlib.h
+ */
+
+/* inflate_fast() copies matches in chunks and refills its bit buffer eight
+   bytes at a time where it can. This compresses data full of short-distance
+   and window-wrapping matches with every window size, and checks that
+   inflate() gives it back exactly for a range of input and output buffer
+   sizes, including through inflateCopy() and inflateBack(). Output bytes
+   past those reported must not be written to beyond what avail_out allows,
+   which is checked with a guard after the output buffer. */
+
+#include "zlib.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIZE 300000
+#define GUARD 64
+
+static int fails = 0;
+
+static void fail(const char *what, int wbits, unsigned in, unsigned out) {
+    fprintf(stderr, "%s: window bits %d, input chunk %u, output chunk %u\n",
+            what, wbits, in, out);
+    if (++fails > 20)
+        exit(1);
+}
+
+/* Fill buf with a mix of literals, runs, and copies from short and long
+   distances back. */
+static void fill(unsigned char *buf, size_t len) {
+    unsigned long x = 1;
+    size_t i = 0, n, dist;
+
+    while (i < len) {
+        x = x * 1103515245 + 12345;
+        n = 3 + (x >> 8) % 300;
+        if (n > len - i)
+            n = len - i;
+        switch ((x >> 20) % 4) {
+        case 0:                         /* literals */
+            while (n--) {
+                x = x * 1103515245 + 12345;
+                buf[i++] = (unsigned char)(x >> 16);
+            }
+            break;
+        case 1:                         /* short distance */
+            dist = 1 + (x >> 24) % 40;
+            goto copy;
+        default:                        /* long distance */
+            dist = 1 + (x >> 12) % 40000;
+        copy:
+            if (dist > i) {
+                buf[i++] = (unsigned char)x;
+                break;
+            }
+            while (n--) {
+                buf[i] = buf[i - dist];
+                i++;
+            }
+        }
+    }
+}
+
+static size_t deflate_all(unsigned char *dst, size_t room,
+                          const unsigned char *src, size_t len, int level,
+                          int wbits, int strategy) {
+    z_stream strm;
+    size_t got;
+
+    memset(&strm, 0, sizeof(strm));
+    if (deflateInit2(&strm, level, Z_DEFLATED, wbits, 8, strategy) != Z_OK)
+        return 0;
+    strm.next_in = (z_const Bytef *)src;
+    strm.avail_in = (uInt)len;
+    strm.next_out = dst;
+    strm.avail_out = (uInt)room;
+    if (deflate(&strm, Z_FINISH) != Z_STREAM_END)
+        got = 0;
+    else
+        got = strm.total_out;
+    deflateEnd(&strm);
+    return got;
+}
+
+/* Inflate comp feeding inchunk bytes and offering outchunk bytes at a time,
+   optionally switching to a copy of the stream half way. */
+static void inflate_check(const unsigned char *comp, size_t clen,
+                          const unsigned char *want, size_t len,
+                          unsigned char *out, int wbits, unsigned inchunk,
+                          unsigned outchunk, int copy) {
+    z_stream streams[2], *strm = streams;
+    size_t have = 0, fed = 0, room;
+    int ret = Z_OK, copied = 0;
+
+    memset(strm, 0, sizeof(z_stream));
+    if (inflateInit2(strm, wbits) != Z_OK) {
+        fail("inflateInit2", wbits, inchunk, outchunk);
+        return;
+    }
+    memset(out, 0xa5, len + GUARD);
+    while (ret == Z_OK) {
+        if (strm->avail_in == 0) {
+            strm->next_in = (z_const Bytef *)comp + fed;
+            strm->avail_in = (uInt)(clen - fed < inchunk ? clen - fed :
+                                    inchunk);
+            fed += strm->avail_in;
+        }
+        room = len - have < outchunk ? len - have : outchunk;
+        strm->next_out = out + have;
+        strm->avail_out = (uInt)room;
+        ret = inflate(strm, Z_NO_FLUSH);
+        have += room - strm->avail_out;
+        if (ret == Z_BUF_ERROR && room == 0)
+            break;
+        if (copy && !copied && have >= len / 2) {
+            if (inflateCopy(streams + 1, strm) != Z_OK) {
+                fail("inflateCopy", wbits, inchunk, outchunk);
+                break;
+            }
+            inflateEnd(strm);
+            strm = streams + 1;
+            copied = 1;
+        }
+    }
+    inflateEnd(strm);
+    if (ret != Z_STREAM_END || have != len || memcmp(out, want, len))
+        fail(copy ? "inflate after copy" : "inflate", wbits, inchunk,
+             outchunk);
+    for (room = 0; room < GUARD; room++)
+        if (out[len + room] != 0xa5) {
+            fail("inflate wrote past avail_out", wbits, inchunk, outchunk);
+            break;
+        }
+}
+
+struct back {
+    const unsigned char *next;
+    size_t left;
+    unsigned chunk;
+    unsigned char *out;
+    size_t have;
+};
+
+static unsigned back_in(void FAR *desc, z_const unsigned char FAR **buf) {
+    struct back *b = desc;
+    unsigned n = b->left < b->chunk ? (unsigned)b->left : b->chunk;
+
+    *buf = (z_const unsigned char FAR *)b->next;
+    b->next += n;
+    b->left -= n;
+    return n;
+}
+
+static int back_out(void FAR *desc, unsigned char FAR *buf, unsigned len) {
+    struct back *b = desc;
+
+    memcpy(b->out + b->have, buf, len);
+    b->have += len;
+    return 0;
+}
+
+static void back_check(const unsigned char *raw, size_t rlen,
+                       const unsigned char *want, size_t len,
+                       unsigned char *out, unsigned inchunk) {
+    static unsigned char window[32768];
+    z_stream strm;
+    struct back b;
+    int ret;
+
+    memset(&strm, 0, sizeof(strm));
+    if (inflateBackInit(&strm, 15, window) != Z_OK) {
+        fail("inflateBackInit", 15, inchunk, 32768);
+        return;
+    }
+    b.next = raw;
+    b.left = rlen;
+    b.chunk = inchunk;
+    b.out = out;
+    b.have = 0;
+    ret = inflateBack(&strm, back_in, &b, back_out, &b);
+    inflateBackEnd(&strm);
+    if (ret != Z_STREAM_END || b.have != len || memcmp(out, want, len))
+        fail("inflateBack", -15, inchunk, 32768);
+}
+
+int main(void) {
+    static const unsigned ins[] = { 1, 7, 1000, SIZE * 2 };
+    static const unsigned outs[] = { 1, 259, 290, 4096, SIZE + 1 };
+    unsigned char *data, *comp, *out;
+    size_t room = SIZE * 2, clen;
+    int wbits, level;
+    size_t i, j;
+
+    data = malloc(SIZE);
+    comp = malloc(room);
+    out = malloc(SIZE + GUARD);
+    if (data == NULL || comp == NULL || out == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    fill(data, SIZE);
+
+    for (wbits = 9; wbits <= 15; wbits++)
+        for (level = 1; level <= 9; level += 4) {
+            clen = deflate_all(comp, room, data, SIZE, level, wbits,
+                               Z_DEFAULT_STRATEGY);
+            if (clen == 0) {
+                fail("deflate", wbits, 0, 0);
+                continue;
+            }
+            for (i = 0; i < sizeof(ins) / sizeof(ins[0]); i++)
+                for (j = 0; j < sizeof(outs) / sizeof(outs[0]); j++) {
+                    if (ins[i] == 1 && outs[j] == 1)
+                        continue;       /* slow, and no different */
+                    inflate_check(comp, clen, data, SIZE, out, wbits,
+                                  ins[i], outs[j], 0);
+                }
+            inflate_check(comp, clen, data, SIZE, out, wbits, 1000, 290, 1);
+            inflate_check(comp, clen, data, SIZE, out, wbits + 32, 7, 4096,
+                          0);
+        }
+
+    /* Runs of one byte, and a gzip stream. */
+    clen = deflate_all(comp, room, data, SIZE, 9, 31, Z_RLE);
+    if (clen == 0)
+        fail("deflate", 31, 0, 0);
+    else
+        inflate_check(comp, clen, data, SIZE, out, 31, 1000, 4096, 0);
+
+    /* inflateBack() writes into its window, which has no padding. */
+    for (level = 1; level <= 9; level += 4) {
+        clen = deflate_all(comp, room, data, SIZE, level, -15,
+                           Z_DEFAULT_STRATEGY);
+        if (clen == 0) {
+            fail("deflate", -15, 0, 0);
+            continue;
+        }
+        back_check(comp, clen, data, SIZE, out, 1);
+        back_check(comp, clen, data, SIZE, out, 1000);
+        back_check(comp, clen, data, SIZE, out, SIZE * 2);
+    }
+
+    free(out);
+    free(comp);
+    free(data);
+    if (fails) {
+        fprintf(stderr, "%d failures\n", fails);
+        return 1;
+    }
+    printf("inflate tests passed\n");
+    return 0;
+}
@@ -63,6 +63,9 @@
 #  define get_crc_table         z_get_crc_table
 #  ifndef Z_SOLO
 #    define gz_error              z_gz_error
+#    define gz_index_add          z_gz_index_add
+#    define gz_index_find         z_gz_index_find
+#    define gz_index_window       z_gz_index_window
 #    define gz_intmax             z_gz_intmax
 #    define gz_strwinerror        z_gz_strwinerror
 #    define gzbuffer              z_gzbuffer
@@ -80,6 +83,11 @@
 #    define gzgetc                z_gzgetc
 #    define gzgetc_               z_gzgetc_
 #    define gzgets                z_gzgets
+#    define gzindex_free          z_gzindex_free
+#    define gzindex_length        z_gzindex_length
+#    define gzindex_load          z_gzindex_load
+#    define gzindex_new           z_gzindex_new
+#    define gzindex_save          z_gzindex_save
 #    define gzoffset              z_gzoffset
 #    define gzoffset64            z_gzoffset64
 #    define gzopen                z_gzopen
@@ -98,6 +106,7 @@
 #    define gztell                z_gztell
 #    define gztell64              z_gztell64
 #    define gzungetc              z_gzungetc
+#    define gzuseindex            z_gzuseindex
 #    define gzvprintf             z_gzvprintf
 #    define gzwrite               z_gzwrite
 #  endif
@@ -148,6 +157,7 @@
 #  define free_func             z_free_func
 #  ifndef Z_SOLO
 #    define gzFile                z_gzFile
+#    define gzIndex               z_gzIndex
 #  endif
 #  define gz_header             z_gz_header
 #  define gz_headerp            z_gz_headerp
@@ -164,6 +174,7 @@
 
 /* all zlib structs in zlib.h and zconf.h */
 #  define gz_header_s           z_gz_header_s
+#  define gz_index_s            z_gz_index_s
 #  define internal_state        z_internal_state
 
 #endif
@@ -1303,6 +1303,7 @@ ZEXTERN int ZEXPORT uncompress2(Bytef *dest,   uLongf *destLen,
 */
 
 typedef struct gzFile_s *gzFile;    /* semi-opaque gzip file descriptor */
+typedef struct gz_index_s *gzIndex; /* opaque gzip random access index */
 
 /*
 ZEXTERN gzFile ZEXPORT gzopen(const char *path, const char *mode);
@@ -1679,6 +1680,81 @@ ZEXTERN void ZEXPORT gzclearerr(gzFile file);
    file that is being written concurrently.
 */
 
+                        /* gzip random access */
+
+/*
+     A gzip index is a list of access points in the uncompressed data of a
+   gzip file, at deflate block boundaries about span bytes apart, each with the
+   32K of uncompressed data that precedes it (stored compressed).  With an
+   index, gzseek() can resume decompression at the last access point before the
+   requested offset, instead of decompressing from the start of the file or
+   through all of the data in between.  This makes reading a small range of a
+   very large gzip file take time proportional to span.  The index is built
+   while a gzFile is read sequentially, can be saved to and loaded from a
+   sidecar file, and can be shared by several gzFile objects reading the same
+   file.  This is based on examples/zran.c.
+*/
+
+ZEXTERN gzIndex ZEXPORT gzindex_new(z_off64_t span);
+/*
+     Return a new, empty index that will have access points about every span
+   bytes of uncompressed data, or NULL if span is not positive or there is not
+   enough memory.  Each access point takes about 10K to 32K of memory,
+   depending on how compressible the data is.  A span of a few megabytes is a
+   reasonable choice for very large files.
+*/
+
+ZEXTERN int ZEXPORT gzuseindex(gzFile file, gzIndex index);
+/*
+     Use index to seek in file, which must be open for reading, replacing any
+   index used before.  A NULL index stops the use of an index.  The gzFile does
+   not take ownership of index, which must not be freed until file is closed
+   or another index is used.
+
+     If the index is not complete, then access points are added to it as file
+   is decompressed past the last one, whether by gzread() and the like or by
+   gzseek() skipping forward.  Attaching an empty index before the first read
+   and then reading the file to the end builds a complete index.  An index
+   that is not complete must not be used by more than one gzFile at a time.  A
+   complete index is not modified, and can be used by any number of gzFile
+   objects at the same time, including from different threads, so long as
+   each thread uses its own gzFile.
+
+     An index must only be used with the file it was built from.  The data
+   after an access point is not checked against the gzip trailer's CRC-32 and
+   length, since decompression did not start at the beginning of the member.
+
+     gzuseindex returns 0 on success, or -1 if file is not valid or is not
+   open for reading.
+*/
+
+ZEXTERN z_off64_t ZEXPORT gzindex_length(gzIndex index);
+/*
+     Return the total length of the uncompressed data if index is complete,
+   having seen the end of the file, or -1 if it is not complete or not valid.
+*/
+
+ZEXTERN int ZEXPORT gzindex_save(gzIndex index, const char *path);
+/*
+     Write index to the file at path, replacing the file if it exists.  An
+   index that is not complete can be saved, and access points will continue
+   to be added after it is loaded.  gzindex_save returns 0 on success, or -1
+   if index is not valid or there was an error writing the file, in which
+   case errno can be consulted.
+*/
+
+ZEXTERN gzIndex ZEXPORT gzindex_load(const char *path);
+/*
+     Read an index written by gzindex_save() from the file at path.  Return
+   the index, or NULL if the file could not be read, is not a valid index
+   (which includes a failed integrity check), or there is not enough memory.
+*/
+
+ZEXTERN void ZEXPORT gzindex_free(gzIndex index);
+/*
+     Free index and all of its access points.  index may be NULL.
+*/
+
 #endif /* !Z_SOLO */
 
                         /* checksum functions */
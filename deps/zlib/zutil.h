@@ -263,6 +263,15 @@ extern z_const char * const z_errmsg[10]; /* indexed by 2-zlib_error */
    void ZLIB_INTERNAL zcfree(voidpf opaque, voidpf ptr);
 #endif
 
+/* Limit the processor-specific CRC-32 code crc32_z() may use to max (0 for
+   none, 1 for PCLMULQDQ, 2 for VPCLMULQDQ), or leave it as is if max is
+   negative. Return the level that will be used on this processor. This is for
+   testing and benchmarking; the default is to use the fastest available. */
+int ZLIB_INTERNAL crc32_simd_level(int max);
+
+/* The same for adler32_z() (0 for none, 1 for SSSE3 or NEON, 2 for AVX2). */
+int ZLIB_INTERNAL adler32_simd_level(int max);
+
 #define ZALLOC(strm, items, size) \
            (*((strm)->zalloc))((strm)->opaque, (items), (size))
 #define ZFREE(strm, addr)  (*((strm)->zfree))((strm)->opaque, (voidpf)(addr))
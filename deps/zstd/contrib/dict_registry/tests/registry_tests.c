@@ -0,0 +1,270 @@
+#include <stddef.h>
+#include <stdlib.h>  // malloc
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+
+#ifdef ZSTD_MULTITHREAD
+#include <pthread.h>
+#endif
+
+#define ZDICT_STATIC_LINKING_ONLY
+#include "zdict.h"
+#include "zstd_errors.h"
+#include "../zstd_dict_registry.h"
+
+#define NB_DICTS 4
+#define DICT_CAPACITY 16000
+#define MSG_SIZE 700
+#define NB_SAMPLES 300
+
+/* Fill buf with text drawn from a vocabulary that depends on `variant`, so
+ * that each dictionary suits its own messages best. */
+static void fillText(char* buf, size_t size, unsigned variant, unsigned seed)
+{
+    static const char* const words[] = {
+        "request ", "user ", "session ", "id=", "status ", "ok ", "error ",
+        "latency ", "bytes ", "region ", "cache ", "miss ", "hit ", "\n",
+        "timestamp ", "path=/api/", "v1 ", "v2 ", "token ", "retry "
+    };
+    unsigned x = seed * 2654435761U + variant;
+    size_t pos = 0;
+    while (pos < size) {
+        const char* w;
+        x = x * 1103515245 + 12345;
+        w = words[((x >> 16) + variant * 7) % (variant + 12)];
+        while (*w && pos < size) buf[pos++] = *w++;
+    }
+}
+
+/* A zstd-format dictionary with ID `dictID`, trained on text of `variant`. */
+static size_t makeDict(void* dict, unsigned dictID, unsigned variant)
+{
+    char* const samples = (char*)malloc(NB_SAMPLES * MSG_SIZE);
+    size_t sizes[NB_SAMPLES];
+    char content[4000];
+    ZDICT_params_t params;
+    size_t result;
+    unsigned n;
+    assert(samples != NULL);
+    for (n = 0; n < NB_SAMPLES; n++) {
+        fillText(samples + n * MSG_SIZE, MSG_SIZE, variant, n + 1000);
+        sizes[n] = MSG_SIZE;
+    }
+    fillText(content, sizeof(content), variant, 1);
+    memset(&params, 0, sizeof(params));
+    params.dictID = dictID;
+    result = ZDICT_finalizeDictionary(dict, DICT_CAPACITY, content, sizeof(content),
+                                      samples, sizes, NB_SAMPLES, params);
+    free(samples);
+    return result;
+}
+
+typedef struct {
+    ZSTD_dictRegistry* reg;
+    unsigned seed;
+    int failed;
+} registryWork_t;
+
+/* Compress and decompress messages with random dictionaries and levels. */
+static void* registryWork(void* opaque)
+{
+    registryWork_t* const w = (registryWork_t*)opaque;
+    ZSTD_CCtx* const cctx = ZSTD_createCCtx();
+    ZSTD_DCtx* const dctx = ZSTD_createDCtx();
+    char msg[MSG_SIZE], comp[MSG_SIZE * 2], back[MSG_SIZE];
+    unsigned x = w->seed;
+    int n;
+    for (n = 0; n < 2000 && !w->failed; n++) {
+        unsigned variant;
+        size_t cSize, dSize;
+        x = x * 1103515245 + 12345;
+        variant = (x >> 16) % NB_DICTS;
+        fillText(msg, sizeof(msg), variant, x);
+        cSize = ZSTD_dictRegistry_compress(w->reg, cctx, comp, sizeof(comp), msg, sizeof(msg),
+                                           variant + 1, 1 + (int)((x >> 8) % 3));
+        dSize = ZSTD_dictRegistry_decompress(w->reg, dctx, back, sizeof(back), comp, cSize);
+        if (ZSTD_isError(cSize) || dSize != sizeof(msg) || memcmp(msg, back, sizeof(msg)))
+            w->failed = 1;
+    }
+    ZSTD_freeCCtx(cctx);
+    ZSTD_freeDCtx(dctx);
+    return NULL;
+}
+
+/* Basic unit tests for the dictionary registry */
+int main(int argc, const char** argv)
+{
+    unsigned testNb = 1;
+    char* dicts[NB_DICTS];
+    size_t dictSizes[NB_DICTS];
+    unsigned d;
+    (void)argc; (void)argv;
+    printf("Beginning zstd dictionary registry tests...\n");
+
+    for (d = 0; d < NB_DICTS; d++) {
+        dicts[d] = (char*)malloc(DICT_CAPACITY);
+        assert(dicts[d] != NULL);
+        dictSizes[d] = makeDict(dicts[d], d + 1, d);
+        if (ZDICT_isError(dictSizes[d])) {
+            printf("could not build dictionaries: %s\n", ZDICT_getErrorName(dictSizes[d]));
+            return 1;
+        }
+    }
+
+    printf("Test %u - adding dictionaries: ", testNb++);
+    {   ZSTD_dictRegistry* const reg = ZSTD_dictRegistry_create((size_t)1 << 30);
+        ZSTD_dictRegistry_stats stats;
+        if (reg == NULL) goto _test_error;
+        for (d = 0; d < NB_DICTS; d++) {
+            if (ZSTD_dictRegistry_add(reg, dicts[d], dictSizes[d]) != d + 1) goto _test_error;
+        }
+        /* again, with a separate copy */
+        {   char* const copy = (char*)malloc(dictSizes[0]);
+            assert(copy != NULL);
+            memcpy(copy, dicts[0], dictSizes[0]);
+            if (ZSTD_dictRegistry_add(reg, copy, dictSizes[0]) != 1) goto _test_error;
+            free(copy);
+        }
+        /* raw content has no ID, and an ID can't be reused for other content */
+        if (ZSTD_getErrorCode(ZSTD_dictRegistry_add(reg, "raw content, no header", 22)) != ZSTD_error_dictionary_wrong) goto _test_error;
+        {   char* const other = (char*)malloc(DICT_CAPACITY);
+            size_t const otherSize = makeDict(other, 2, 3);
+            assert(other != NULL && !ZDICT_isError(otherSize));
+            if (ZSTD_getErrorCode(ZSTD_dictRegistry_add(reg, other, otherSize)) != ZSTD_error_dictionary_wrong) goto _test_error;
+            free(other);
+        }
+        ZSTD_dictRegistry_getStats(reg, &stats);
+        if (stats.nbDicts != NB_DICTS || stats.nbDigested != NB_DICTS || stats.hits || stats.misses) goto _test_error;
+        ZSTD_dictRegistry_free(reg);
+    }
+    printf("Success!\n");
+
+    printf("Test %u - frames pick their own dictionary: ", testNb++);
+    {   ZSTD_dictRegistry* const reg = ZSTD_dictRegistry_create((size_t)1 << 30);
+        ZSTD_CCtx* const cctx = ZSTD_createCCtx();
+        ZSTD_DCtx* const dctx = ZSTD_createDCtx();
+        char msg[NB_DICTS + 1][MSG_SIZE];
+        char comp[(NB_DICTS + 1) * MSG_SIZE * 2];
+        char back[(NB_DICTS + 1) * MSG_SIZE];
+        size_t cSize = 0;
+        ZSTD_dictRegistry_stats stats;
+        if (reg == NULL || cctx == NULL || dctx == NULL) goto _test_error;
+        for (d = 0; d < NB_DICTS; d++) {
+            if (ZSTD_isError(ZSTD_dictRegistry_add(reg, dicts[d], dictSizes[d]))) goto _test_error;
+        }
+        /* in reverse order, and a last frame without a dictionary */
+        for (d = 0; d <= NB_DICTS; d++) {
+            size_t result;
+            fillText(msg[d], MSG_SIZE, d % NB_DICTS, d);
+            if (d < NB_DICTS) {
+                result = ZSTD_dictRegistry_compress(reg, cctx, comp + cSize, sizeof(comp) - cSize,
+                                                    msg[d], MSG_SIZE, NB_DICTS - d, 3);
+            } else {
+                result = ZSTD_compressCCtx(cctx, comp + cSize, sizeof(comp) - cSize, msg[d], MSG_SIZE, 3);
+            }
+            if (ZSTD_isError(result)) goto _test_error;
+            cSize += result;
+        }
+        {   size_t const result = ZSTD_dictRegistry_decompress(reg, dctx, back, sizeof(back), comp, cSize);
+            if (result != sizeof(back)) goto _test_error;
+        }
+        for (d = 0; d <= NB_DICTS; d++) {
+            if (memcmp(back + d * MSG_SIZE, msg[d], MSG_SIZE)) goto _test_error;
+        }
+        /* the DDicts were digested by add(), the CDicts on first use */
+        ZSTD_dictRegistry_getStats(reg, &stats);
+        if (stats.misses != NB_DICTS || stats.hits != NB_DICTS || stats.nbDigested != 2 * NB_DICTS) goto _test_error;
+
+        {   const ZSTD_DDict* const ddict = ZSTD_dictRegistry_acquireDDictForFrame(reg, comp, cSize);
+            if (ddict == NULL || ZSTD_getDictID_fromDDict(ddict) != NB_DICTS) goto _test_error;
+            ZSTD_dictRegistry_releaseDDict(reg, ddict);
+        }
+        if (ZSTD_getErrorCode(ZSTD_dictRegistry_compress(reg, cctx, comp, sizeof(comp), msg[0], MSG_SIZE, 99, 3))
+                != ZSTD_error_dictionary_wrong) goto _test_error;
+        ZSTD_freeCCtx(cctx);
+        ZSTD_freeDCtx(dctx);
+        ZSTD_dictRegistry_free(reg);
+    }
+    printf("Success!\n");
+
+    printf("Test %u - budget and removal: ", testNb++);
+    {   ZSTD_dictRegistry* const reg = ZSTD_dictRegistry_create(0);
+        ZSTD_dictRegistry_stats stats;
+        const ZSTD_CDict* cdict;
+        const ZSTD_DDict* ddict;
+        if (reg == NULL) goto _test_error;
+        for (d = 0; d < NB_DICTS; d++) {
+            if (ZSTD_isError(ZSTD_dictRegistry_add(reg, dicts[d], dictSizes[d]))) goto _test_error;
+        }
+        ZSTD_dictRegistry_getStats(reg, &stats);
+        if (stats.nbDigested != 0 || stats.digestedBytes != 0 || stats.evictions != NB_DICTS) goto _test_error;
+
+        /* acquired digests stay over budget until released */
+        cdict = ZSTD_dictRegistry_acquireCDict(reg, 1, 5);
+        ddict = ZSTD_dictRegistry_acquireDDict(reg, 1);
+        if (cdict == NULL || ddict == NULL) goto _test_error;
+        ZSTD_dictRegistry_getStats(reg, &stats);
+        if (stats.nbDigested != 2 || stats.digestedBytes == 0) goto _test_error;
+        if (ZSTD_getErrorCode(ZSTD_dictRegistry_remove(reg, 1)) != ZSTD_error_stage_wrong) goto _test_error;
+        ZSTD_dictRegistry_releaseCDict(reg, cdict);
+        ZSTD_dictRegistry_releaseDDict(reg, ddict);
+        ZSTD_dictRegistry_getStats(reg, &stats);
+        if (stats.nbDigested != 0 || stats.digestedBytes != 0) goto _test_error;
+
+        if (ZSTD_dictRegistry_remove(reg, 1) != 0) goto _test_error;
+        if (ZSTD_getErrorCode(ZSTD_dictRegistry_remove(reg, 1)) != ZSTD_error_dictionary_wrong) goto _test_error;
+        if (ZSTD_dictRegistry_acquireDDict(reg, 1) != NULL) goto _test_error;
+        ZSTD_dictRegistry_getStats(reg, &stats);
+        if (stats.nbDicts != NB_DICTS - 1 || stats.contentBytes == 0) goto _test_error;
+        ZSTD_dictRegistry_free(reg);
+    }
+    printf("Success!\n");
+
+    printf("Test %u - concurrent use with a small budget: ", testNb++);
+    {   ZSTD_dictRegistry* reg;
+        ZSTD_dictRegistry_stats stats;
+        registryWork_t work[4];
+        size_t budget;
+        unsigned t;
+        /* room for about three CDicts at level 3 */
+        {   ZSTD_CDict* const cdict = ZSTD_createCDict(dicts[0], dictSizes[0], 3);
+            budget = 3 * ZSTD_sizeof_CDict(cdict);
+            ZSTD_freeCDict(cdict);
+        }
+        reg = ZSTD_dictRegistry_create(budget);
+        if (reg == NULL) goto _test_error;
+        for (d = 0; d < NB_DICTS; d++) {
+            if (ZSTD_isError(ZSTD_dictRegistry_add(reg, dicts[d], dictSizes[d]))) goto _test_error;
+        }
+        for (t = 0; t < 4; t++) {
+            registryWork_t const w = { reg, t + 1, 0 };
+            work[t] = w;
+        }
+#ifdef ZSTD_MULTITHREAD
+        {   pthread_t threads[4];
+            for (t = 0; t < 4; t++) {
+                if (pthread_create(&threads[t], NULL, registryWork, &work[t])) goto _test_error;
+            }
+            for (t = 0; t < 4; t++) pthread_join(threads[t], NULL);
+        }
+#else
+        for (t = 0; t < 4; t++) registryWork(&work[t]);
+#endif
+        for (t = 0; t < 4; t++) {
+            if (work[t].failed) goto _test_error;
+        }
+        ZSTD_dictRegistry_getStats(reg, &stats);
+        if (stats.hits == 0 || stats.evictions == 0 || stats.digestedBytes > budget) goto _test_error;
+        ZSTD_dictRegistry_free(reg);
+    }
+    printf("Success!\n");
+
+    for (d = 0; d < NB_DICTS; d++) free(dicts[d]);
+    printf("Finished tests\n");
+    return 0;
+
+_test_error:
+    printf("test failed! Exiting..\n");
+    return 1;
+}
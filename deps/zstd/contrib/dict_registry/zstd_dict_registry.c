@@ -0,0 +1,511 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#include <stdlib.h>   /* malloc, calloc, free */
+#include <string.h>   /* memcpy, memcmp, memset */
+#include <assert.h>
+
+#define ZSTD_STATIC_LINKING_ONLY
+#include "zstd.h"
+#include "zstd_errors.h"
+#include "mem.h"         /* U32, BYTE */
+#include "threading.h"   /* ZSTD_pthread_mutex_t */
+#include "zstd_dict_registry.h"
+
+#undef ERROR
+#define ERROR(name) ((size_t)-ZSTD_error_##name)
+
+#define DICT_REGISTRY_HASHLOG_MIN 6
+
+typedef struct registryDict_s registryDict_t;
+typedef struct registryDigest_s registryDigest_t;
+
+/* A digested dictionary, either a DDict or a CDict for one level.  Both are
+ * created by reference to the content of their dictionary. */
+struct registryDigest_s {
+    registryDict_t* dict;
+    ZSTD_DDict* ddict;
+    ZSTD_CDict* cdict;
+    int compressionLevel;           /* of cdict */
+    size_t size;
+    U32 refs;                       /* acquisitions not yet released */
+    registryDigest_t* next;         /* dict->cdicts */
+    registryDigest_t* newer;        /* LRU list of digests */
+    registryDigest_t* older;
+};
+
+/* A registered dictionary.  `refs` counts its acquired digests, as well as
+ * digests being created, which need its content to stay in place. */
+struct registryDict_s {
+    U32 dictID;
+    U32 refs;
+    void* content;
+    size_t size;
+    registryDigest_t* ddict;
+    registryDigest_t* cdicts;
+    registryDict_t* hashNext;
+};
+
+struct ZSTD_dictRegistry_s {
+    ZSTD_pthread_mutex_t mutex;     /* protects everything below */
+
+    registryDict_t** hashTable;
+    U32 hashLog;
+    U32 nbDicts;
+    size_t contentBytes;
+
+    registryDigest_t* newest;
+    registryDigest_t* oldest;
+    size_t budget;
+    size_t digestedBytes;
+    unsigned nbDigested;
+
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long evictions;
+};
+
+static U32 ZSTD_dictRegistry_hash(U32 dictID, U32 hashLog)
+{
+    return (dictID * 2654435761U) >> (32 - hashLog);
+}
+
+ZSTD_dictRegistry* ZSTD_dictRegistry_create(size_t budget)
+{
+    ZSTD_dictRegistry* const reg = (ZSTD_dictRegistry*)malloc(sizeof(ZSTD_dictRegistry));
+    if (reg == NULL) return NULL;
+    memset(reg, 0, sizeof(*reg));
+    reg->budget = budget;
+    reg->hashLog = DICT_REGISTRY_HASHLOG_MIN;
+    reg->hashTable = (registryDict_t**)calloc((size_t)1 << reg->hashLog, sizeof(registryDict_t*));
+    if (reg->hashTable == NULL || ZSTD_pthread_mutex_init(&reg->mutex, NULL)) {
+        free(reg->hashTable);
+        free(reg);
+        return NULL;
+    }
+    return reg;
+}
+
+static void ZSTD_dictRegistry_freeDigest(registryDigest_t* digest)
+{
+    ZSTD_freeDDict(digest->ddict);
+    ZSTD_freeCDict(digest->cdict);
+    free(digest);
+}
+
+static void ZSTD_dictRegistry_lruUnlink(ZSTD_dictRegistry* reg, registryDigest_t* digest)
+{
+    if (digest->newer != NULL) digest->newer->older = digest->older;
+    else reg->newest = digest->older;
+    if (digest->older != NULL) digest->older->newer = digest->newer;
+    else reg->oldest = digest->newer;
+}
+
+static void ZSTD_dictRegistry_lruPush(ZSTD_dictRegistry* reg, registryDigest_t* digest)
+{
+    digest->newer = NULL;
+    digest->older = reg->newest;
+    if (reg->newest != NULL) reg->newest->newer = digest;
+    else reg->oldest = digest;
+    reg->newest = digest;
+}
+
+/* Take `digest` off its dictionary and the LRU list, and free it. */
+static void ZSTD_dictRegistry_dropDigest(ZSTD_dictRegistry* reg, registryDigest_t* digest)
+{
+    registryDict_t* const dict = digest->dict;
+    assert(digest->refs == 0);
+    if (digest->ddict != NULL) {
+        assert(dict->ddict == digest);
+        dict->ddict = NULL;
+    } else {
+        registryDigest_t** link = &dict->cdicts;
+        while (*link != digest) link = &(*link)->next;
+        *link = digest->next;
+    }
+    ZSTD_dictRegistry_lruUnlink(reg, digest);
+    reg->digestedBytes -= digest->size;
+    reg->nbDigested--;
+    ZSTD_dictRegistry_freeDigest(digest);
+}
+
+/* Drop the least recently used digests until they fit the budget.
+ * Digests that are acquired are skipped. */
+static void ZSTD_dictRegistry_evict(ZSTD_dictRegistry* reg)
+{
+    registryDigest_t* digest = reg->oldest;
+    while (reg->digestedBytes > reg->budget && digest != NULL) {
+        registryDigest_t* const newer = digest->newer;
+        if (digest->refs == 0) {
+            ZSTD_dictRegistry_dropDigest(reg, digest);
+            reg->evictions++;
+        }
+        digest = newer;
+    }
+}
+
+static void ZSTD_dictRegistry_freeDict(registryDict_t* dict)
+{
+    while (dict->cdicts != NULL) {
+        registryDigest_t* const next = dict->cdicts->next;
+        ZSTD_dictRegistry_freeDigest(dict->cdicts);
+        dict->cdicts = next;
+    }
+    if (dict->ddict != NULL) ZSTD_dictRegistry_freeDigest(dict->ddict);
+    free(dict->content);
+    free(dict);
+}
+
+size_t ZSTD_dictRegistry_free(ZSTD_dictRegistry* reg)
+{
+    U32 n;
+    if (reg == NULL) return 0; /* support free on null */
+    for (n = 0; n < (1U << reg->hashLog); n++) {
+        registryDict_t* dict = reg->hashTable[n];
+        while (dict != NULL) {
+            registryDict_t* const next = dict->hashNext;
+            assert(dict->refs == 0);
+            ZSTD_dictRegistry_freeDict(dict);
+            dict = next;
+        }
+    }
+    free(reg->hashTable);
+    ZSTD_pthread_mutex_destroy(&reg->mutex);
+    free(reg);
+    return 0;
+}
+
+static registryDict_t* ZSTD_dictRegistry_find(ZSTD_dictRegistry* reg, U32 dictID)
+{
+    registryDict_t* dict = reg->hashTable[ZSTD_dictRegistry_hash(dictID, reg->hashLog)];
+    while (dict != NULL && dict->dictID != dictID) dict = dict->hashNext;
+    return dict;
+}
+
+static void ZSTD_dictRegistry_hashInsert(ZSTD_dictRegistry* reg, registryDict_t* dict)
+{
+    /* keep chains short by doubling the table as it fills, unless the
+     * allocation fails, which only makes chains longer */
+    if (reg->nbDicts >= (1U << reg->hashLog) && reg->hashLog < 30) {
+        U32 const newLog = reg->hashLog + 1;
+        registryDict_t** const newTable =
+                (registryDict_t**)calloc((size_t)1 << newLog, sizeof(registryDict_t*));
+        if (newTable != NULL) {
+            U32 n;
+            for (n = 0; n < (1U << reg->hashLog); n++) {
+                registryDict_t* d = reg->hashTable[n];
+                while (d != NULL) {
+                    registryDict_t* const next = d->hashNext;
+                    U32 const h = ZSTD_dictRegistry_hash(d->dictID, newLog);
+                    d->hashNext = newTable[h];
+                    newTable[h] = d;
+                    d = next;
+                }
+            }
+            free(reg->hashTable);
+            reg->hashTable = newTable;
+            reg->hashLog = newLog;
+        }
+    }
+    {   U32 const h = ZSTD_dictRegistry_hash(dict->dictID, reg->hashLog);
+        dict->hashNext = reg->hashTable[h];
+        reg->hashTable[h] = dict;
+        reg->nbDicts++;
+        reg->contentBytes += dict->size;
+    }
+}
+
+static void ZSTD_dictRegistry_hashRemove(ZSTD_dictRegistry* reg, registryDict_t* dict)
+{
+    registryDict_t** link = &reg->hashTable[ZSTD_dictRegistry_hash(dict->dictID, reg->hashLog)];
+    while (*link != dict) link = &(*link)->hashNext;
+    *link = dict->hashNext;
+    reg->nbDicts--;
+    reg->contentBytes -= dict->size;
+}
+
+/* Add a digest, holding one reference, to `dict` and the LRU list. */
+static void ZSTD_dictRegistry_insertDigest(ZSTD_dictRegistry* reg, registryDigest_t* digest)
+{
+    registryDict_t* const dict = digest->dict;
+    if (digest->ddict != NULL) {
+        assert(dict->ddict == NULL);
+        dict->ddict = digest;
+    } else {
+        digest->next = dict->cdicts;
+        dict->cdicts = digest;
+    }
+    digest->refs = 1;
+    ZSTD_dictRegistry_lruPush(reg, digest);
+    reg->digestedBytes += digest->size;
+    reg->nbDigested++;
+}
+
+static registryDigest_t* ZSTD_dictRegistry_createDigest(registryDict_t* dict, int isCDict, int compressionLevel)
+{
+    registryDigest_t* const digest = (registryDigest_t*)calloc(1, sizeof(registryDigest_t));
+    if (digest == NULL) return NULL;
+    digest->dict = dict;
+    if (isCDict) {
+        digest->cdict = ZSTD_createCDict_byReference(dict->content, dict->size, compressionLevel);
+        digest->compressionLevel = compressionLevel;
+        digest->size = ZSTD_sizeof_CDict(digest->cdict);
+    } else {
+        digest->ddict = ZSTD_createDDict_byReference(dict->content, dict->size);
+        digest->size = ZSTD_sizeof_DDict(digest->ddict);
+    }
+    if (digest->cdict == NULL && digest->ddict == NULL) {
+        free(digest);
+        return NULL;
+    }
+    return digest;
+}
+
+size_t ZSTD_dictRegistry_add(ZSTD_dictRegistry* reg, const void* dict, size_t dictSize)
+{
+    U32 const dictID = (U32)ZSTD_getDictID_fromDict(dict, dictSize);
+    registryDict_t* entry;
+    registryDigest_t* digest;
+
+    if (dictID == 0) return ERROR(dictionary_wrong);
+    ZSTD_pthread_mutex_lock(&reg->mutex);
+    entry = ZSTD_dictRegistry_find(reg, dictID);
+    if (entry != NULL) {
+        int const same = entry->size == dictSize && !memcmp(entry->content, dict, dictSize);
+        ZSTD_pthread_mutex_unlock(&reg->mutex);
+        return same ? dictID : ERROR(dictionary_wrong);
+    }
+    ZSTD_pthread_mutex_unlock(&reg->mutex);
+
+    entry = (registryDict_t*)calloc(1, sizeof(registryDict_t));
+    if (entry == NULL) return ERROR(memory_allocation);
+    entry->dictID = dictID;
+    entry->size = dictSize;
+    entry->content = malloc(dictSize);
+    if (entry->content == NULL) {
+        free(entry);
+        return ERROR(memory_allocation);
+    }
+    memcpy(entry->content, dict, dictSize);
+
+    /* the DDict checks the entropy tables, and is likely to be needed */
+    digest = ZSTD_dictRegistry_createDigest(entry, 0, 0);
+    if (digest == NULL) {
+        free(entry->content);
+        free(entry);
+        return ERROR(dictionary_corrupted);
+    }
+
+    ZSTD_pthread_mutex_lock(&reg->mutex);
+    {   registryDict_t* const other = ZSTD_dictRegistry_find(reg, dictID);
+        if (other != NULL) {
+            /* another thread added it first */
+            int const same = other->size == dictSize && !memcmp(other->content, dict, dictSize);
+            ZSTD_pthread_mutex_unlock(&reg->mutex);
+            ZSTD_dictRegistry_freeDigest(digest);
+            ZSTD_dictRegistry_freeDict(entry);
+            return same ? dictID : ERROR(dictionary_wrong);
+        }
+    }
+    ZSTD_dictRegistry_hashInsert(reg, entry);
+    ZSTD_dictRegistry_insertDigest(reg, digest);
+    digest->refs = 0;
+    ZSTD_dictRegistry_evict(reg);
+    ZSTD_pthread_mutex_unlock(&reg->mutex);
+    return dictID;
+}
+
+size_t ZSTD_dictRegistry_remove(ZSTD_dictRegistry* reg, unsigned dictID)
+{
+    registryDict_t* dict;
+    ZSTD_pthread_mutex_lock(&reg->mutex);
+    dict = ZSTD_dictRegistry_find(reg, dictID);
+    if (dict == NULL || dict->refs != 0) {
+        ZSTD_pthread_mutex_unlock(&reg->mutex);
+        return dict == NULL ? ERROR(dictionary_wrong) : ERROR(stage_wrong);
+    }
+    ZSTD_dictRegistry_hashRemove(reg, dict);
+    while (dict->cdicts != NULL) ZSTD_dictRegistry_dropDigest(reg, dict->cdicts);
+    if (dict->ddict != NULL) ZSTD_dictRegistry_dropDigest(reg, dict->ddict);
+    ZSTD_pthread_mutex_unlock(&reg->mutex);
+    ZSTD_dictRegistry_freeDict(dict);
+    return 0;
+}
+
+static registryDigest_t* ZSTD_dictRegistry_findDigest(const registryDict_t* dict, int isCDict, int compressionLevel)
+{
+    registryDigest_t* digest;
+    if (!isCDict) return dict->ddict;
+    for (digest = dict->cdicts; digest != NULL; digest = digest->next) {
+        if (digest->compressionLevel == compressionLevel) return digest;
+    }
+    return NULL;
+}
+
+/* Get a reference to a digest of dictionary `dictID`, creating it outside of
+ * the lock if it isn't there.  When two threads create the same digest at
+ * once, the one that finishes second uses the first one's. */
+static registryDigest_t* ZSTD_dictRegistry_acquire(ZSTD_dictRegistry* reg, U32 dictID, int isCDict, int compressionLevel)
+{
+    registryDict_t* dict;
+    registryDigest_t* digest;
+    registryDigest_t* created;
+
+    ZSTD_pthread_mutex_lock(&reg->mutex);
+    dict = ZSTD_dictRegistry_find(reg, dictID);
+    if (dict == NULL) {
+        ZSTD_pthread_mutex_unlock(&reg->mutex);
+        return NULL;
+    }
+    digest = ZSTD_dictRegistry_findDigest(dict, isCDict, compressionLevel);
+    if (digest != NULL) {
+        digest->refs++;
+        dict->refs++;
+        reg->hits++;
+        ZSTD_dictRegistry_lruUnlink(reg, digest);
+        ZSTD_dictRegistry_lruPush(reg, digest);
+        ZSTD_pthread_mutex_unlock(&reg->mutex);
+        return digest;
+    }
+    dict->refs++;  /* keeps the content while it is digested */
+    ZSTD_pthread_mutex_unlock(&reg->mutex);
+
+    created = ZSTD_dictRegistry_createDigest(dict, isCDict, compressionLevel);
+
+    ZSTD_pthread_mutex_lock(&reg->mutex);
+    digest = ZSTD_dictRegistry_findDigest(dict, isCDict, compressionLevel);
+    if (digest != NULL) {
+        digest->refs++;
+        reg->hits++;
+        ZSTD_dictRegistry_lruUnlink(reg, digest);
+        ZSTD_dictRegistry_lruPush(reg, digest);
+    } else if (created != NULL) {
+        digest = created;
+        created = NULL;
+        ZSTD_dictRegistry_insertDigest(reg, digest);
+        reg->misses++;
+        ZSTD_dictRegistry_evict(reg);
+    } else {
+        dict->refs--;
+    }
+    ZSTD_pthread_mutex_unlock(&reg->mutex);
+    if (created != NULL) ZSTD_dictRegistry_freeDigest(created);
+    return digest;
+}
+
+static void ZSTD_dictRegistry_release(ZSTD_dictRegistry* reg, registryDigest_t* digest)
+{
+    assert(digest->refs > 0 && digest->dict->refs > 0);
+    digest->dict->refs--;
+    if (--digest->refs == 0) ZSTD_dictRegistry_evict(reg);
+}
+
+const ZSTD_DDict* ZSTD_dictRegistry_acquireDDict(ZSTD_dictRegistry* reg, unsigned dictID)
+{
+    registryDigest_t* const digest = ZSTD_dictRegistry_acquire(reg, dictID, 0, 0);
+    return digest == NULL ? NULL : digest->ddict;
+}
+
+const ZSTD_DDict* ZSTD_dictRegistry_acquireDDictForFrame(ZSTD_dictRegistry* reg, const void* src, size_t srcSize)
+{
+    unsigned const dictID = ZSTD_getDictID_fromFrame(src, srcSize);
+    if (dictID == 0) return NULL;
+    return ZSTD_dictRegistry_acquireDDict(reg, dictID);
+}
+
+const ZSTD_CDict* ZSTD_dictRegistry_acquireCDict(ZSTD_dictRegistry* reg, unsigned dictID, int compressionLevel)
+{
+    registryDigest_t* digest;
+    if (compressionLevel == 0) compressionLevel = ZSTD_CLEVEL_DEFAULT;
+    digest = ZSTD_dictRegistry_acquire(reg, dictID, 1, compressionLevel);
+    return digest == NULL ? NULL : digest->cdict;
+}
+
+void ZSTD_dictRegistry_releaseDDict(ZSTD_dictRegistry* reg, const ZSTD_DDict* ddict)
+{
+    registryDict_t* dict;
+    if (ddict == NULL) return;
+    ZSTD_pthread_mutex_lock(&reg->mutex);
+    dict = ZSTD_dictRegistry_find(reg, ZSTD_getDictID_fromDDict(ddict));
+    assert(dict != NULL && dict->ddict != NULL && dict->ddict->ddict == ddict);
+    ZSTD_dictRegistry_release(reg, dict->ddict);
+    ZSTD_pthread_mutex_unlock(&reg->mutex);
+}
+
+void ZSTD_dictRegistry_releaseCDict(ZSTD_dictRegistry* reg, const ZSTD_CDict* cdict)
+{
+    registryDict_t* dict;
+    registryDigest_t* digest;
+    if (cdict == NULL) return;
+    ZSTD_pthread_mutex_lock(&reg->mutex);
+    dict = ZSTD_dictRegistry_find(reg, ZSTD_getDictID_fromCDict(cdict));
+    assert(dict != NULL);
+    digest = dict->cdicts;
+    while (digest->cdict != cdict) digest = digest->next;
+    ZSTD_dictRegistry_release(reg, digest);
+    ZSTD_pthread_mutex_unlock(&reg->mutex);
+}
+
+size_t ZSTD_dictRegistry_compress(ZSTD_dictRegistry* reg, ZSTD_CCtx* cctx,
+                                  void* dst, size_t dstCapacity,
+                                  const void* src, size_t srcSize,
+                                  unsigned dictID, int compressionLevel)
+{
+    const ZSTD_CDict* const cdict = ZSTD_dictRegistry_acquireCDict(reg, dictID, compressionLevel);
+    size_t result;
+    if (cdict == NULL) return ERROR(dictionary_wrong);
+    result = ZSTD_compress_usingCDict(cctx, dst, dstCapacity, src, srcSize, cdict);
+    ZSTD_dictRegistry_releaseCDict(reg, cdict);
+    return result;
+}
+
+size_t ZSTD_dictRegistry_decompress(ZSTD_dictRegistry* reg, ZSTD_DCtx* dctx,
+                                    void* dst, size_t dstCapacity,
+                                    const void* src, size_t srcSize)
+{
+    const BYTE* ip = (const BYTE*)src;
+    BYTE* const ostart = (BYTE*)dst;
+    BYTE* op = ostart;
+
+    while (srcSize > 0) {
+        size_t const frameSize = ZSTD_findFrameCompressedSize(ip, srcSize);
+        unsigned dictID;
+        size_t result;
+        if (ZSTD_isError(frameSize)) return frameSize;
+        dictID = ZSTD_getDictID_fromFrame(ip, frameSize);
+        if (dictID == 0) {
+            result = ZSTD_decompressDCtx(dctx, op, dstCapacity, ip, frameSize);
+        } else {
+            const ZSTD_DDict* const ddict = ZSTD_dictRegistry_acquireDDict(reg, dictID);
+            if (ddict == NULL) return ERROR(dictionary_wrong);
+            result = ZSTD_decompress_usingDDict(dctx, op, dstCapacity, ip, frameSize, ddict);
+            ZSTD_dictRegistry_releaseDDict(reg, ddict);
+        }
+        if (ZSTD_isError(result)) return result;
+        op += result;
+        dstCapacity -= result;
+        ip += frameSize;
+        srcSize -= frameSize;
+    }
+    return (size_t)(op - ostart);
+}
+
+void ZSTD_dictRegistry_getStats(ZSTD_dictRegistry* reg, ZSTD_dictRegistry_stats* stats)
+{
+    ZSTD_pthread_mutex_lock(&reg->mutex);
+    stats->hits = reg->hits;
+    stats->misses = reg->misses;
+    stats->evictions = reg->evictions;
+    stats->digestedBytes = reg->digestedBytes;
+    stats->contentBytes = reg->contentBytes;
+    stats->nbDicts = reg->nbDicts;
+    stats->nbDigested = reg->nbDigested;
+    ZSTD_pthread_mutex_unlock(&reg->mutex);
+}
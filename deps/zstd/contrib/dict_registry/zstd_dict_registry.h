@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#ifndef ZSTD_DICT_REGISTRY_H
+#define ZSTD_DICT_REGISTRY_H
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+#include "zstd.h"   /* ZSTDLIB_API, ZSTD_CDict, ZSTD_DDict */
+
+
+/*-****************************************************************************
+*  Dictionary registry
+*
+*  Digesting a dictionary into a ZSTD_CDict or ZSTD_DDict costs far more than
+*  compressing or decompressing a small message with it, so services that use
+*  many dictionaries want to digest each one once and share it.  A
+*  ZSTD_dictRegistry holds the content of any number of dictionaries, keyed by
+*  their dictionary ID, and digests them on first use.  Digested dictionaries
+*  are kept up to a memory budget, and the least recently used ones are
+*  dropped beyond it, to be digested again from the content when next needed.
+*
+*  All functions can be called concurrently on the same registry, when built
+*  with ZSTD_MULTITHREAD.  Digesting happens outside of the registry's lock.
+******************************************************************************/
+
+typedef struct ZSTD_dictRegistry_s ZSTD_dictRegistry;
+
+/*===== Registry management =====*/
+
+/*! ZSTD_dictRegistry_create() :
+ *  `budget` bounds the memory used by digested dictionaries, not counting
+ *  dictionary contents, which are kept until removed.  Digested dictionaries
+ *  still in use are never dropped, so the budget can be exceeded while they
+ *  are. */
+ZSTDLIB_API ZSTD_dictRegistry* ZSTD_dictRegistry_create(size_t budget);
+
+/*! ZSTD_dictRegistry_free() :
+ *  No dictionary may still be acquired. */
+ZSTDLIB_API size_t ZSTD_dictRegistry_free(ZSTD_dictRegistry* reg);
+
+/*! ZSTD_dictRegistry_add() :
+ *  Copy a dictionary in zstd format into the registry, and check that it can
+ *  be digested.  Adding the same dictionary twice has no effect.
+ * @return : the dictionary ID, or an error code, which can be tested with
+ *           ZSTD_isError().  Dictionaries without an ID, such as raw content,
+ *           and dictionaries whose ID is registered with different content,
+ *           are rejected with ZSTD_error_dictionary_wrong. */
+ZSTDLIB_API size_t ZSTD_dictRegistry_add(ZSTD_dictRegistry* reg, const void* dict, size_t dictSize);
+
+/*! ZSTD_dictRegistry_remove() :
+ *  Drop a dictionary and its digested forms.
+ * @return : 0, or an error code : ZSTD_error_dictionary_wrong if it is not
+ *           registered, ZSTD_error_stage_wrong if it is acquired. */
+ZSTDLIB_API size_t ZSTD_dictRegistry_remove(ZSTD_dictRegistry* reg, unsigned dictID);
+
+
+/*===== One-shot operations =====*/
+
+/*! ZSTD_dictRegistry_compress() :
+ *  Compress `src` with dictionary `dictID` at `compressionLevel`, as
+ *  ZSTD_compress_usingCDict() does.  A CDict is digested for each level used.
+ * @return : compressed size, or an error code */
+ZSTDLIB_API size_t ZSTD_dictRegistry_compress(ZSTD_dictRegistry* reg, ZSTD_CCtx* cctx,
+                                              void* dst, size_t dstCapacity,
+                                              const void* src, size_t srcSize,
+                                              unsigned dictID, int compressionLevel);
+
+/*! ZSTD_dictRegistry_decompress() :
+ *  Decompress one or more frames, each with the dictionary whose ID its header
+ *  records, or without a dictionary if it records none.
+ * @return : decompressed size, or an error code :
+ *           ZSTD_error_dictionary_wrong if a dictionary is not registered */
+ZSTDLIB_API size_t ZSTD_dictRegistry_decompress(ZSTD_dictRegistry* reg, ZSTD_DCtx* dctx,
+                                                void* dst, size_t dstCapacity,
+                                                const void* src, size_t srcSize);
+
+
+/*===== Digested dictionaries =====*/
+
+/*! ZSTD_dictRegistry_acquireDDict(), ZSTD_dictRegistry_acquireCDict() :
+ *  Get the digested form of dictionary `dictID`, for streaming or for
+ *  ZSTD_DCtx_refDDict() / ZSTD_CCtx_refCDict().  It stays valid until it is
+ *  released, and must be released exactly once per acquisition.
+ *  ZSTD_dictRegistry_acquireDDictForFrame() picks the dictionary recorded in
+ *  the header of the frame starting at `src`.
+ * @return : the digested dictionary, or NULL if it is not registered or can't
+ *           be allocated */
+ZSTDLIB_API const ZSTD_DDict* ZSTD_dictRegistry_acquireDDict(ZSTD_dictRegistry* reg, unsigned dictID);
+ZSTDLIB_API const ZSTD_DDict* ZSTD_dictRegistry_acquireDDictForFrame(ZSTD_dictRegistry* reg, const void* src, size_t srcSize);
+ZSTDLIB_API const ZSTD_CDict* ZSTD_dictRegistry_acquireCDict(ZSTD_dictRegistry* reg, unsigned dictID, int compressionLevel);
+ZSTDLIB_API void ZSTD_dictRegistry_releaseDDict(ZSTD_dictRegistry* reg, const ZSTD_DDict* ddict);
+ZSTDLIB_API void ZSTD_dictRegistry_releaseCDict(ZSTD_dictRegistry* reg, const ZSTD_CDict* cdict);
+
+
+/*===== Statistics =====*/
+
+typedef struct {
+    unsigned long long hits;       /* acquisitions of an already digested dictionary */
+    unsigned long long misses;     /* acquisitions that had to digest it */
+    unsigned long long evictions;  /* digested dictionaries dropped to fit the budget */
+    size_t digestedBytes;          /* memory of digested dictionaries */
+    size_t contentBytes;           /* memory of dictionary contents */
+    unsigned nbDicts;
+    unsigned nbDigested;
+} ZSTD_dictRegistry_stats;
+
+ZSTDLIB_API void ZSTD_dictRegistry_getStats(ZSTD_dictRegistry* reg, ZSTD_dictRegistry_stats* stats);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif
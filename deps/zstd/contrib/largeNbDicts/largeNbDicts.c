@@ -13,7 +13,9 @@
  * dedicated to the specific case of dictionary decompression
  * using a very large nb of dictionaries
  * thus suffering latency from lots of cache misses.
- * It's created in a bid to investigate performance and find optimizations. */
+ * It's created in a bid to investigate performance and find optimizations.
+ * With --registry, dictionaries are found by ID in a ZSTD_dictRegistry,
+ * which digests them on demand within a memory budget. */
 
 
 /*---  Dependencies  ---*/
@@ -29,6 +31,7 @@
 #define ZSTD_STATIC_LINKING_ONLY
 #include "zstd.h"
 #include "zdict.h"
+#include "zstd_dict_registry.h"
 
 
 /*---  Constants  --- */
@@ -49,6 +52,8 @@
 
 #define BENCH_SIZE_MAX (1200 MB)
 
+#define REGISTRY_BUDGET_DEFAULT ((size_t)-1)  /* keep all digested dictionaries */
+
 
 /*---  Macros  ---*/
 
@@ -529,6 +534,40 @@ void shuffleDDictionaries(ddict_collection_t dicts)
 }
 
 
+/*---  dictionary registry  ---*/
+
+/* createRegistry() :
+ * registers nbDicts copies of a zstd-format dictionary, with IDs 1 to nbDicts,
+ * so that each block can be compressed with a different dictionary,
+ * which the registry then finds from the frame header when decompressing.
+ * Raw content dictionaries have no ID, and can't be registered. */
+static ZSTD_dictRegistry* createRegistry(const void* dictBuffer, size_t dictSize, size_t nbDicts, size_t budget)
+{
+    CONTROL(ZSTD_getDictID_fromDict(dictBuffer, dictSize) != 0);
+    CONTROL(nbDicts < UINT_MAX);
+    ZSTD_dictRegistry* const registry = ZSTD_dictRegistry_create(budget);
+    CONTROL(registry != NULL);
+    char* const dict = malloc(dictSize);
+    CONTROL(dict != NULL);
+    memcpy(dict, dictBuffer, dictSize);
+    for (size_t dictNb=0; dictNb < nbDicts; dictNb++) {
+        MEM_writeLE32(dict + 4, (U32)dictNb + 1);   /* dictID follows the magic number */
+        CONTROL(ZSTD_dictRegistry_add(registry, dict, dictSize) == dictNb + 1);
+    }
+    free(dict);
+    return registry;
+}
+
+static void displayRegistryStats(ZSTD_dictRegistry* registry)
+{
+    ZSTD_dictRegistry_stats stats;
+    ZSTD_dictRegistry_getStats(registry, &stats);
+    DISPLAYLEVEL(2, "registry : %llu hits, %llu misses, %llu evictions, %u digested dictionaries using %.1f MB \n",
+                    stats.hits, stats.misses, stats.evictions,
+                    stats.nbDigested, (double)stats.digestedBytes / (1 MB));
+}
+
+
 /* ---   Compression  --- */
 
 /* compressBlocks() :
@@ -567,6 +606,34 @@ static size_t compressBlocks(size_t* cSizes,   /* optional (can be NULL). If pre
     return totalCSize;
 }
 
+/* compressBlocks_withRegistry() :
+ * compresses block n with dictionary ID (n % nbDicts) + 1.
+ * @return : total compressed size of all blocks */
+static size_t compressBlocks_withRegistry(size_t* cSizes,
+                             slice_collection_t dstBlockBuffers,
+                             slice_collection_t srcBlockBuffers,
+                             ZSTD_dictRegistry* registry, size_t nbDicts, int cLevel)
+{
+    size_t const nbBlocks = srcBlockBuffers.nbSlices;
+    assert(dstBlockBuffers.nbSlices == srcBlockBuffers.nbSlices);
+
+    ZSTD_CCtx* const cctx = ZSTD_createCCtx();
+    CONTROL(cctx != NULL);
+
+    size_t totalCSize = 0;
+    for (size_t blockNb=0; blockNb < nbBlocks; blockNb++) {
+        size_t const cBlockSize = ZSTD_dictRegistry_compress(registry, cctx,
+                            dstBlockBuffers.slicePtrs[blockNb], dstBlockBuffers.capacities[blockNb],
+                            srcBlockBuffers.slicePtrs[blockNb], srcBlockBuffers.capacities[blockNb],
+                            (unsigned)(blockNb % nbDicts) + 1, cLevel);
+        CONTROL(!ZSTD_isError(cBlockSize));
+        cSizes[blockNb] = cBlockSize;
+        totalCSize += cBlockSize;
+    }
+    ZSTD_freeCCtx(cctx);
+    return totalCSize;
+}
+
 
 /* ---  Benchmark  --- */
 
@@ -618,6 +685,35 @@ void freeDecompressInstructions(decompressInstructions di)
     ZSTD_freeDCtx(di.dctx);
 }
 
+typedef struct {
+    ZSTD_dictRegistry* registry;
+    ZSTD_CCtx* cctx;
+    ZSTD_DCtx* dctx;
+    size_t nbDicts;
+    size_t dictNb;
+    int cLevel;
+} registryInstructions;
+
+registryInstructions createRegistryInstructions(ZSTD_dictRegistry* registry, size_t nbDicts, int cLevel)
+{
+    registryInstructions ri;
+    ri.registry = registry;
+    ri.cctx = ZSTD_createCCtx();
+    CONTROL(ri.cctx != NULL);
+    ri.dctx = ZSTD_createDCtx();
+    CONTROL(ri.dctx != NULL);
+    ri.nbDicts = nbDicts;
+    ri.dictNb = 0;
+    ri.cLevel = cLevel;
+    return ri;
+}
+
+void freeRegistryInstructions(registryInstructions ri)
+{
+    ZSTD_freeCCtx(ri.cctx);
+    ZSTD_freeDCtx(ri.dctx);
+}
+
 /* benched function */
 size_t compress(const void* src, size_t srcSize, void* dst, size_t dstCapacity, void* payload)
 {
@@ -651,6 +747,33 @@ size_t decompress(const void* src, size_t srcSize, void* dst, size_t dstCapacity
     return result;
 }
 
+/* benched function */
+size_t compressWithRegistry(const void* src, size_t srcSize, void* dst, size_t dstCapacity, void* payload)
+{
+    registryInstructions* const ri = (registryInstructions*) payload;
+    (void)dstCapacity;
+
+    ZSTD_dictRegistry_compress(ri->registry, ri->cctx,
+            dst, srcSize,
+            src, srcSize,
+            (unsigned)ri->dictNb + 1, ri->cLevel);
+
+    ri->dictNb = ri->dictNb + 1;
+    if (ri->dictNb >= ri->nbDicts) ri->dictNb = 0;
+
+    return srcSize;
+}
+
+/* benched function : the dictionary is selected from the frame header */
+size_t decompressWithRegistry(const void* src, size_t srcSize, void* dst, size_t dstCapacity, void* payload)
+{
+    registryInstructions* const ri = (registryInstructions*) payload;
+
+    return ZSTD_dictRegistry_decompress(ri->registry, ri->dctx,
+                                        dst, dstCapacity,
+                                        src, srcSize);
+}
+
 typedef enum {
   fastest = 0,
   median = 1,
@@ -681,7 +804,9 @@ double aggregateData(double *data, size_t size,
 
 static int benchMem(slice_collection_t dstBlocks, slice_collection_t srcBlocks,
                     ddict_collection_t ddictionaries,
-                    cdict_collection_t cdictionaries, unsigned nbRounds,
+                    cdict_collection_t cdictionaries,
+                    registryInstructions* ri,  /* optional : use a registry instead of collections */
+                    unsigned nbRounds,
                     int benchCompression, const char *exeName,
                     ZSTD_CCtx_params *cctxParams,
                     metricAggregatePref_e metricAggregatePref)
@@ -701,8 +826,13 @@ static int benchMem(slice_collection_t dstBlocks, slice_collection_t srcBlocks,
     compressInstructions ci =
         createCompressInstructions(cdictionaries, cctxParams);
     void* payload = benchCompression ? (void*)&ci : (void*)&di;
+    BMK_benchFn_t benchFn = benchCompression ? compress : decompress;
+    if (ri) {
+        payload = ri;
+        benchFn = benchCompression ? compressWithRegistry : decompressWithRegistry;
+    }
     BMK_benchParams_t const bp = {
-        .benchFn = benchCompression ? compress : decompress,
+        .benchFn = benchFn,
         .benchPayload = payload,
         .initFn = NULL,
         .initPayload = NULL,
@@ -772,7 +902,7 @@ static int benchMem(slice_collection_t dstBlocks, slice_collection_t srcBlocks,
     }
     fprintf(csvFile, "%s,%d,%ld,%d,%d,%.1f\n",
             benchCompression ? "Compression" : "Decompression", cLevel,
-            benchCompression ? ci.nbDicts : di.nbDicts, dictAttachPref,
+            ri ? ri->nbDicts : benchCompression ? ci.nbDicts : di.nbDicts, dictAttachPref,
             metricAggregatePref, speedAggregated);
     fclose(csvFile);
     free(csvFileName);
@@ -789,12 +919,15 @@ static int benchMem(slice_collection_t dstBlocks, slice_collection_t srcBlocks,
  *  fileName : file to load for benchmarking purpose
  *  dictionary : optional (can be NULL), file to load as dictionary,
  *              if none provided : will be calculated on the fly by the program.
+ *  useRegistry : compress each block with its own copy of the dictionary,
+ *              and look them up in a registry limited to registryBudget bytes.
  * @return : 0 is success, 1+ otherwise */
 int bench(const char **fileNameTable, unsigned nbFiles, const char *dictionary,
           size_t blockSize, int clevel, unsigned nbDictMax, unsigned nbBlocks,
           unsigned nbRounds, int benchCompression,
           ZSTD_dictContentType_e dictContentType, ZSTD_CCtx_params *cctxParams,
-          const char *exeName, metricAggregatePref_e metricAggregatePref)
+          const char *exeName, metricAggregatePref_e metricAggregatePref,
+          int useRegistry, size_t registryBudget)
 {
     int result = 0;
 
@@ -861,7 +994,20 @@ int bench(const char **fileNameTable, unsigned nbFiles, const char *dictionary,
     size_t* const cSizes = malloc(nbBlocks * sizeof(size_t));
     CONTROL(cSizes != NULL);
 
-    size_t const cTotalSize = compressBlocks(cSizes, dstSlices, srcSlices, cdict, clevel);
+    unsigned const nbDicts = nbDictMax ? nbDictMax : nbBlocks;
+
+    ZSTD_dictRegistry* registry = NULL;
+    if (useRegistry) {
+        DISPLAYLEVEL(3, "registering %u dictionaries", nbDicts);
+        if (registryBudget != REGISTRY_BUDGET_DEFAULT)
+            DISPLAYLEVEL(3, ", keeping up to %.1f MB digested", (double)registryBudget / (1 MB));
+        DISPLAYLEVEL(3, " \n");
+        registry = createRegistry(dictBuffer.ptr, dictBuffer.size, nbDicts, registryBudget);
+    }
+
+    size_t const cTotalSize = registry ?
+        compressBlocks_withRegistry(cSizes, dstSlices, srcSlices, registry, nbDicts, clevel) :
+        compressBlocks(cSizes, dstSlices, srcSlices, cdict, clevel);
     CONTROL(cTotalSize != 0);
     DISPLAYLEVEL(3, "compressed using a %u bytes dictionary : Ratio=%.2f  (%u bytes) \n",
                     (unsigned)dictBuffer.size,
@@ -870,15 +1016,32 @@ int bench(const char **fileNameTable, unsigned nbFiles, const char *dictionary,
     /* now dstSlices contain the real compressed size of each block, instead of the maximum capacity */
     shrinkSizes(dstSlices, cSizes);
 
-    unsigned const nbDicts = nbDictMax ? nbDictMax : nbBlocks;
+    if (registry) {
+        registryInstructions ri = createRegistryInstructions(registry, nbDicts, clevel);
+
+        buffer_collection_t resultCollection = benchCompression ?
+            createBufferCollection_fromSliceCollection(srcSlices) :
+            createBufferCollection_fromSliceCollectionSizes(srcSlices);
+        CONTROL(resultCollection.buffer.ptr != NULL);
 
-    cdict_collection_t const cdictionaries = createCDictCollection(dictBuffer.ptr, dictBuffer.size, nbDicts, dictContentType, cctxParams);
-    CONTROL(cdictionaries.cdicts != NULL);
+        if (benchCompression) {
+            result = benchMem(dstSlices, resultCollection.slices, kNullDDictCollection,
+                              kNullCDictCollection, &ri, nbRounds, benchCompression, exeName,
+                              cctxParams, metricAggregatePref);
+        } else {
+            result = benchMem(resultCollection.slices, dstSlices, kNullDDictCollection,
+                              kNullCDictCollection, &ri, nbRounds, benchCompression, exeName,
+                              NULL, metricAggregatePref);
+        }
+        displayRegistryStats(registry);
 
-    ddict_collection_t const ddictionaries = createDDictCollection(dictBuffer.ptr, dictBuffer.size, nbDicts);
-    CONTROL(ddictionaries.ddicts != NULL);
+        freeBufferCollection(resultCollection);
+        freeRegistryInstructions(ri);
+        ZSTD_dictRegistry_free(registry);
+    } else if (benchCompression) {
+        cdict_collection_t const cdictionaries = createCDictCollection(dictBuffer.ptr, dictBuffer.size, nbDicts, dictContentType, cctxParams);
+        CONTROL(cdictionaries.cdicts != NULL);
 
-    if (benchCompression) {
         size_t const dictMem = ZSTD_sizeof_CDict(cdictionaries.cdicts[0]);
         size_t const allDictMem = dictMem * nbDicts;
         DISPLAYLEVEL(3, "generating %u dictionaries, using %.1f MB of memory \n",
@@ -889,12 +1052,16 @@ int bench(const char **fileNameTable, unsigned nbFiles, const char *dictionary,
         buffer_collection_t resultCollection = createBufferCollection_fromSliceCollection(srcSlices);
         CONTROL(resultCollection.buffer.ptr != NULL);
 
-        result = benchMem(dstSlices, resultCollection.slices, ddictionaries,
-                          cdictionaries, nbRounds, benchCompression, exeName,
+        result = benchMem(dstSlices, resultCollection.slices, kNullDDictCollection,
+                          cdictionaries, NULL, nbRounds, benchCompression, exeName,
                           cctxParams, metricAggregatePref);
 
         freeBufferCollection(resultCollection);
+        freeCDictCollection(cdictionaries);
     } else {
+        ddict_collection_t const ddictionaries = createDDictCollection(dictBuffer.ptr, dictBuffer.size, nbDicts);
+        CONTROL(ddictionaries.ddicts != NULL);
+
         size_t const dictMem = ZSTD_estimateDDictSize(dictBuffer.size, DICT_LOAD_METHOD);
         size_t const allDictMem = dictMem * nbDicts;
         DISPLAYLEVEL(3, "generating %u dictionaries, using %.1f MB of memory \n",
@@ -906,15 +1073,14 @@ int bench(const char **fileNameTable, unsigned nbFiles, const char *dictionary,
         CONTROL(resultCollection.buffer.ptr != NULL);
 
         result = benchMem(resultCollection.slices, dstSlices, ddictionaries,
-                          cdictionaries, nbRounds, benchCompression, exeName,
+                          kNullCDictCollection, NULL, nbRounds, benchCompression, exeName,
                           NULL, metricAggregatePref);
 
         freeBufferCollection(resultCollection);
+        freeDDictCollection(ddictionaries);
     }
 
     /* free all heap objects in reverse order */
-    freeCDictCollection(cdictionaries);
-    freeDDictCollection(ddictionaries);
     free(cSizes);
     ZSTD_freeCDict(cdict);
     freeBuffer(dictBuffer);
@@ -988,6 +1154,8 @@ int usage(const char* exeName)
     DISPLAY ("-p#         : print speed for all rounds 0=fastest 1=median (default: 0) \n");
     DISPLAY ("--nbBlocks=#: use # blocks for bench (default: one per file) \n");
     DISPLAY ("--nbDicts=# : create # dictionaries for bench (default: one per block) \n");
+    DISPLAY ("--registry  : look dictionaries up by ID in a ZSTD_dictRegistry \n");
+    DISPLAY ("--budget=#  : keep up to # bytes of digested dictionaries in the registry (default: all) \n");
     DISPLAY ("-h          : help (this text) \n");
     DISPLAY (" \n");
     DISPLAY ("Advanced Options (see zstd.h for documentation) : \n");
@@ -1027,6 +1195,8 @@ int main (int argc, const char** argv)
     ZSTD_dictAttachPref_e dictAttachPref = ZSTD_dictDefaultAttach;
     ZSTD_paramSwitch_e prefetchCDictTables = ZSTD_ps_auto;
     metricAggregatePref_e metricAggregatePref = fastest;
+    int useRegistry = 0;
+    size_t registryBudget = REGISTRY_BUDGET_DEFAULT;
 
     for (int argNb = 1; argNb < argc ; argNb++) {
         const char* argument = argv[argNb];
@@ -1043,6 +1213,8 @@ int main (int argc, const char** argv)
         if (longCommandWArg(&argument, "--nbDicts=")) { nbDicts = readU32FromChar(&argument); continue; }
         if (longCommandWArg(&argument, "--nbBlocks=")) { nbBlocks = readU32FromChar(&argument); continue; }
         if (longCommandWArg(&argument, "--clevel=")) { cLevel = (int)readU32FromChar(&argument); continue; }
+        if (!strcmp(argument, "--registry")) { useRegistry = 1; continue; }
+        if (longCommandWArg(&argument, "--budget=")) { useRegistry = 1; registryBudget = readU32FromChar(&argument); continue; }
         if (longCommandWArg(&argument, "--dedicated-dict-search")) { dedicatedDictSearch = 1; continue; }
         if (longCommandWArg(&argument, "--dict-content-type=")) { dictContentType = (int)readU32FromChar(&argument); continue; }
         if (longCommandWArg(&argument, "--dict-attach-pref=")) { dictAttachPref = (int)readU32FromChar(&argument); continue; }
@@ -1075,7 +1247,7 @@ int main (int argc, const char** argv)
         bench(filenameTable->fileNames, (unsigned)filenameTable->tableSize,
               dictionary, blockSize, cLevel, nbDicts, nbBlocks, nbRounds,
               benchCompression, dictContentType, cctxParams, exeName,
-              metricAggregatePref);
+              metricAggregatePref, useRegistry, registryBudget);
 
     UTIL_freeFileNamesTable(filenameTable);
     free(nameTable);
@@ -5,9 +5,15 @@
 #include <assert.h>
 #include <string.h>
 
+#ifdef ZSTD_MULTITHREAD
+#include <pthread.h>
+#endif
+
 #include "../zstd_seekable.h"
 
 
+#define MIN_SIZE(a, b) ((a) < (b) ? (a) : (b))
+
 /* ZSTD_seekable_customFile implementation that reads/seeks a buffer while keeping track of total bytes read */
 typedef struct {
     const void *ptr;
@@ -53,6 +59,34 @@ static int seekBuffWithTotal(void* opaque, long long offset, int origin)
     return 0;
 }
 
+/* Random small reads through a shared decompressor, checked against the input */
+typedef struct {
+    ZSTD_seekableShared* ss;
+    const char* expected;
+    size_t size;
+    unsigned seed;
+    int failed;
+} sharedReads_t;
+
+static void* sharedReads(void* opaque)
+{
+    sharedReads_t* const r = (sharedReads_t*)opaque;
+    char buffer[5000];
+    unsigned x = r->seed;
+    int n;
+    for (n = 0; n < 3000 && !r->failed; n++) {
+        size_t offset, len, got;
+        x = x * 1103515245 + 12345;
+        /* mostly in a hot region a few frames long, so that the cache hits */
+        offset = (x >> 8) % ((x & 3) ? 100000 : r->size);
+        len = 1 + (x >> 4) % sizeof(buffer);
+        got = ZSTD_seekableShared_decompress(r->ss, buffer, len, offset);
+        len = MIN_SIZE(len, r->size - offset);
+        if (got != len || memcmp(buffer, r->expected + offset, len) != 0) r->failed = 1;
+    }
+    return NULL;
+}
+
 /* Basic unit tests for zstd seekable format */
 int main(int argc, const char** argv)
 {
@@ -353,6 +387,244 @@ int main(int argc, const char** argv)
     }
     printf("Success!\n");
 
+    printf("Test %u - multithreaded compression and range decompression: ", testNb++);
+    {   size_t const inSize = 3000000;
+        unsigned const maxFrameSize = 65536;
+        char* const inBuffer = malloc(inSize);
+        size_t const seekCapacity = ZSTD_compressBound(inSize) + 100000;
+        void* const seekBuffer = malloc(seekCapacity);
+        char* const outBuffer = malloc(inSize);
+        size_t seekSize = 0;
+        size_t i;
+        assert(inBuffer != NULL && seekBuffer != NULL && outBuffer != NULL);
+        for (i = 0; i < inSize; i++) {
+            inBuffer[i] = (char)((i % 1000 < 300) ? (i * 2654435761U) >> 24 : 'a' + (i / 7) % 26);
+        }
+
+        ZSTD_seekable_CStream* const zscs = ZSTD_seekable_createCStream();
+        assert(zscs != NULL);
+        { size_t const initStatus = ZSTD_seekable_initCStreamMT(zscs, 3, 1 /* checksumFlag */, maxFrameSize, 4 /* nbWorkers */);
+          assert(!ZSTD_isError(initStatus)); }
+
+        {   /* feed odd-sized input and small output buffers, with one manual frame end */
+            size_t pos = 0;
+            while (pos < inSize) {
+                size_t const chunk = MIN_SIZE(inSize - pos, 77777);
+                ZSTD_inBuffer inb = { .src=inBuffer + pos, .pos=0, .size=chunk };
+                while (inb.pos < inb.size) {
+                    ZSTD_outBuffer outb = { .dst=(char*)seekBuffer + seekSize, .pos=0, .size=MIN_SIZE(seekCapacity - seekSize, 10000) };
+                    size_t const cStatus = ZSTD_seekable_compressStream(zscs, &outb, &inb);
+                    if (ZSTD_isError(cStatus)) goto _test_error;
+                    seekSize += outb.pos;
+                }
+                pos += chunk;
+                if (pos == 777770) {
+                    size_t remaining;
+                    do {
+                        ZSTD_outBuffer outb = { .dst=(char*)seekBuffer + seekSize, .pos=0, .size=MIN_SIZE(seekCapacity - seekSize, 10000) };
+                        remaining = ZSTD_seekable_endFrame(zscs, &outb);
+                        if (ZSTD_isError(remaining)) goto _test_error;
+                        seekSize += outb.pos;
+                    } while (remaining);
+                }
+            }
+            {   size_t remaining;
+                do {
+                    ZSTD_outBuffer outb = { .dst=(char*)seekBuffer + seekSize, .pos=0, .size=MIN_SIZE(seekCapacity - seekSize, 10000) };
+                    remaining = ZSTD_seekable_endStream(zscs, &outb);
+                    if (ZSTD_isError(remaining)) goto _test_error;
+                    seekSize += outb.pos;
+                } while (remaining);
+            }
+        }
+
+        /* the whole thing is a valid zstd stream */
+        {   size_t const dSize = ZSTD_decompress(outBuffer, inSize, seekBuffer, seekSize);
+            if (dSize != inSize || memcmp(outBuffer, inBuffer, inSize) != 0) goto _test_error;
+        }
+
+        ZSTD_seekable* const stream = ZSTD_seekable_create();
+        assert(stream != NULL);
+        {   buffWrapperWithTotal_t buffWrapper = {seekBuffer, seekSize, 0, 0};
+            ZSTD_seekable_customFile srcFile = {&buffWrapper, &readBuffWithTotal, &seekBuffWithTotal};
+            if (ZSTD_isError(ZSTD_seekable_initAdvanced(stream, srcFile))) goto _test_error;
+            /* 777770 is not a multiple of the frame size, so the manual end adds a short frame */
+            if (ZSTD_seekable_getNumFrames(stream) != (777770 / maxFrameSize + 1) + (inSize - 777770 + maxFrameSize - 1) / maxFrameSize)
+                goto _test_error;
+
+            /* ranges: whole, aligned, unaligned at both ends, inside one frame, and past the end */
+            {   struct { size_t offset; size_t size; } const ranges[] = {
+                    { 0, inSize }, { 65536, 65536 * 5 }, { 1000, 500000 }, { 777000, 100000 },
+                    { 70000, 100 }, { inSize - 200000, 300000 }, { 65535, 65538 }
+                };
+                unsigned nbWorkers;
+                for (nbWorkers = 0; nbWorkers <= 3; nbWorkers++) {
+                    for (i = 0; i < sizeof(ranges) / sizeof(ranges[0]); i++) {
+                        size_t const want = MIN_SIZE(ranges[i].size, inSize - ranges[i].offset);
+                        size_t const got = ZSTD_seekable_decompressMT(stream, outBuffer, ranges[i].size, ranges[i].offset, nbWorkers);
+                        if (got != want || memcmp(outBuffer, inBuffer + ranges[i].offset, want) != 0) goto _test_error;
+                    }
+                }
+                /* serial reads still work after parallel ones */
+                {   size_t const got = ZSTD_seekable_decompress(stream, outBuffer, 1000, 5000);
+                    if (got != 1000 || memcmp(outBuffer, inBuffer + 5000, 1000) != 0) goto _test_error; }
+            }
+        }
+
+        /* in-memory source, and a corrupted frame is reported */
+        {   ZSTD_seekable* const mstream = ZSTD_seekable_create();
+            assert(mstream != NULL);
+            if (ZSTD_isError(ZSTD_seekable_initBuff(mstream, seekBuffer, seekSize))) goto _test_error;
+            {   size_t const got = ZSTD_seekable_decompressMT(mstream, outBuffer, inSize, 0, 4);
+                if (got != inSize || memcmp(outBuffer, inBuffer, inSize) != 0) goto _test_error; }
+            {   unsigned long long const at = ZSTD_seekable_getFrameCompressedOffset(mstream, 5) + 20;
+                ((char*)seekBuffer)[at] ^= 0x55;
+                if (!ZSTD_isError(ZSTD_seekable_decompressMT(mstream, outBuffer, inSize, 0, 4))) goto _test_error;
+                ((char*)seekBuffer)[at] ^= 0x55;
+            }
+            ZSTD_seekable_free(mstream);
+        }
+
+        /* reuse the compressor for a serial stream, then an empty multithreaded one */
+        {   ZSTD_outBuffer outb = { .dst=seekBuffer, .pos=0, .size=seekCapacity };
+            ZSTD_inBuffer inb = { .src=inBuffer, .pos=0, .size=1000 };
+            if (ZSTD_isError(ZSTD_seekable_initCStream(zscs, 3, 0, 0))) goto _test_error;
+            if (ZSTD_isError(ZSTD_seekable_compressStream(zscs, &outb, &inb))) goto _test_error;
+            if (ZSTD_seekable_endStream(zscs, &outb) != 0) goto _test_error;
+            if (ZSTD_decompress(outBuffer, inSize, seekBuffer, outb.pos) != 1000) goto _test_error;
+
+            outb.pos = 0;
+            if (ZSTD_isError(ZSTD_seekable_initCStreamMT(zscs, 3, 0, 0, 2))) goto _test_error;
+            if (ZSTD_seekable_endStream(zscs, &outb) != 0) goto _test_error;
+            if (ZSTD_decompress(outBuffer, inSize, seekBuffer, outb.pos) != 0) goto _test_error;
+        }
+
+        ZSTD_seekable_free(stream);
+        ZSTD_seekable_freeCStream(zscs);
+        free(inBuffer);
+        free(seekBuffer);
+        free(outBuffer);
+    }
+    printf("Success!\n");
+
+    printf("Test %u - shared decompression with a frame cache: ", testNb++);
+    {   size_t const inSize = 1000000;
+        unsigned const frameSize = 16384;
+        size_t const cacheSize = 8 * frameSize;
+        char* const inBuffer = malloc(inSize);
+        size_t const seekCapacity = ZSTD_compressBound(inSize) + 100000;
+        char* const seekBuffer = malloc(seekCapacity);
+        char* const outBuffer = malloc(inSize);
+        size_t seekSize;
+        size_t i;
+        ZSTD_seekable_cacheStats stats;
+        assert(inBuffer != NULL && seekBuffer != NULL && outBuffer != NULL);
+        for (i = 0; i < inSize; i++) {
+            inBuffer[i] = (char)((i % 700 < 200) ? (i * 2654435761U) >> 24 : 'a' + (i / 5) % 26);
+        }
+
+        {   ZSTD_seekable_CStream* const zscs = ZSTD_seekable_createCStream();
+            ZSTD_outBuffer outb = { .dst=seekBuffer, .pos=0, .size=seekCapacity };
+            ZSTD_inBuffer inb = { .src=inBuffer, .pos=0, .size=inSize };
+            assert(zscs != NULL);
+            if (ZSTD_isError(ZSTD_seekable_initCStream(zscs, 3, 1 /* checksumFlag */, frameSize))) goto _test_error;
+            while (inb.pos < inb.size) {
+                if (ZSTD_isError(ZSTD_seekable_compressStream(zscs, &outb, &inb))) goto _test_error;
+            }
+            if (ZSTD_seekable_endStream(zscs, &outb) != 0) goto _test_error;
+            seekSize = outb.pos;
+            ZSTD_seekable_freeCStream(zscs);
+        }
+
+        {   ZSTD_seekable* const stream = ZSTD_seekable_create();
+            ZSTD_seekableShared* ss;
+            assert(stream != NULL);
+            if (ZSTD_isError(ZSTD_seekable_initBuff(stream, seekBuffer, seekSize))) goto _test_error;
+            ss = ZSTD_seekableShared_create(stream, cacheSize);
+            if (ss == NULL) goto _test_error;
+
+            /* a second read in the same frame is a hit, a read across frames uses both */
+            if (ZSTD_seekableShared_decompress(ss, outBuffer, 100, 1000) != 100 ||
+                memcmp(outBuffer, inBuffer + 1000, 100) != 0) goto _test_error;
+            if (ZSTD_seekableShared_decompress(ss, outBuffer, 100, 2000) != 100 ||
+                memcmp(outBuffer, inBuffer + 2000, 100) != 0) goto _test_error;
+            if (ZSTD_seekableShared_decompress(ss, outBuffer, 10, frameSize - 5) != 10 ||
+                memcmp(outBuffer, inBuffer + frameSize - 5, 10) != 0) goto _test_error;
+            ZSTD_seekableShared_getStats(ss, &stats);
+            if (stats.hits != 2 || stats.misses != 2 || stats.cachedFrames != 2) goto _test_error;
+
+            /* whole frames bypass the cache, and the budget is kept */
+            if (ZSTD_seekableShared_decompress(ss, outBuffer, inSize, 0) != inSize ||
+                memcmp(outBuffer, inBuffer, inSize) != 0) goto _test_error;
+            for (i = 0; i < 20; i++) {
+                size_t const offset = i * frameSize + 7;
+                if (ZSTD_seekableShared_decompress(ss, outBuffer, 3, offset) != 3 ||
+                    memcmp(outBuffer, inBuffer + offset, 3) != 0) goto _test_error;
+            }
+            ZSTD_seekableShared_getStats(ss, &stats);
+            if (stats.cachedFrames != 8 || stats.cachedBytes != cacheSize || stats.evictions != 12) goto _test_error;
+
+            /* past the end */
+            if (ZSTD_seekableShared_decompress(ss, outBuffer, 100, inSize - 10) != 10 ||
+                memcmp(outBuffer, inBuffer + inSize - 10, 10) != 0) goto _test_error;
+            if (ZSTD_seekableShared_decompress(ss, outBuffer, 100, inSize + 10) != 0) goto _test_error;
+
+            /* a corrupted frame is reported, and not cached */
+            {   unsigned long long const at = ZSTD_seekable_getFrameCompressedOffset(stream, 40) + 30;
+                seekBuffer[at] ^= 0x55;
+                if (!ZSTD_isError(ZSTD_seekableShared_decompress(ss, outBuffer, 10, 40 * frameSize + 100))) goto _test_error;
+                seekBuffer[at] ^= 0x55;
+                if (ZSTD_seekableShared_decompress(ss, outBuffer, 10, 40 * frameSize + 100) != 10 ||
+                    memcmp(outBuffer, inBuffer + 40 * frameSize + 100, 10) != 0) goto _test_error;
+            }
+            ZSTD_seekableShared_free(ss);
+
+            /* the seekable can be used directly again */
+            if (ZSTD_seekable_decompress(stream, outBuffer, 1000, 50000) != 1000 ||
+                memcmp(outBuffer, inBuffer + 50000, 1000) != 0) goto _test_error;
+            ZSTD_seekable_free(stream);
+        }
+
+        /* concurrent readers, through a custom source */
+        {   buffWrapperWithTotal_t buffWrapper = {seekBuffer, seekSize, 0, 0};
+            ZSTD_seekable_customFile srcFile = {&buffWrapper, &readBuffWithTotal, &seekBuffWithTotal};
+            ZSTD_seekable* const stream = ZSTD_seekable_create();
+            ZSTD_seekableShared* ss;
+            sharedReads_t readers[4];
+            unsigned t;
+            assert(stream != NULL);
+            if (ZSTD_isError(ZSTD_seekable_initAdvanced(stream, srcFile))) goto _test_error;
+            ss = ZSTD_seekableShared_create(stream, cacheSize);
+            if (ss == NULL) goto _test_error;
+            for (t = 0; t < 4; t++) {
+                sharedReads_t const r = { ss, inBuffer, inSize, t + 1, 0 };
+                readers[t] = r;
+            }
+#ifdef ZSTD_MULTITHREAD
+            {   pthread_t threads[4];
+                for (t = 0; t < 4; t++) {
+                    if (pthread_create(&threads[t], NULL, sharedReads, &readers[t])) goto _test_error;
+                }
+                for (t = 0; t < 4; t++) pthread_join(threads[t], NULL);
+            }
+#else
+            for (t = 0; t < 4; t++) sharedReads(&readers[t]);
+#endif
+            for (t = 0; t < 4; t++) {
+                if (readers[t].failed) goto _test_error;
+            }
+            ZSTD_seekableShared_getStats(ss, &stats);
+            if (stats.hits == 0 || stats.misses == 0 || stats.cachedBytes > cacheSize) goto _test_error;
+            ZSTD_seekableShared_free(ss);
+            ZSTD_seekable_free(stream);
+        }
+
+        free(inBuffer);
+        free(seekBuffer);
+        free(outBuffer);
+    }
+    printf("Success!\n");
+
     /* TODO: Add more tests */
     printf("Finished tests\n");
     return 0;
@@ -18,6 +18,10 @@ extern "C" {
 /* Limit maximum size to avoid potential issues storing the compressed size */
 #define ZSTD_SEEKABLE_MAX_FRAME_DECOMPRESSED_SIZE 0x40000000U
 
+/* Limits and defaults for multithreaded compression and decompression */
+#define ZSTD_SEEKABLE_NBWORKERS_MAX 200
+#define ZSTD_SEEKABLE_MT_FRAMESIZE_DEFAULT (4U << 20)
+
 /*-****************************************************************************
 *  Seekable Format
 *
@@ -30,6 +34,7 @@ extern "C" {
 typedef struct ZSTD_seekable_CStream_s ZSTD_seekable_CStream;
 typedef struct ZSTD_seekable_s ZSTD_seekable;
 typedef struct ZSTD_seekTable_s ZSTD_seekTable;
+typedef struct ZSTD_seekableShared_s ZSTD_seekableShared;
 
 /*-****************************************************************************
 *  Seekable compression - HowTo
@@ -94,6 +99,29 @@ ZSTDLIB_API size_t ZSTD_seekable_compressStream(ZSTD_seekable_CStream* zcs, ZSTD
 ZSTDLIB_API size_t ZSTD_seekable_endFrame(ZSTD_seekable_CStream* zcs, ZSTD_outBuffer* output);
 ZSTDLIB_API size_t ZSTD_seekable_endStream(ZSTD_seekable_CStream* zcs, ZSTD_outBuffer* output);
 
+/*= Multithreaded compression
+ *  Since seekable frames are independent, up to `nbWorkers` of them can be
+ *  compressed at the same time.  ZSTD_seekable_initCStreamMT() starts a new
+ *  compression operation like ZSTD_seekable_initCStream(), after which
+ *  ZSTD_seekable_compressStream(), ZSTD_seekable_endFrame() and
+ *  ZSTD_seekable_endStream() are used as usual.  Input is copied into a
+ *  frame buffer, and each full frame is handed to a worker thread.  Frames
+ *  are written to `output` and logged in the seek table in input order, so the
+ *  result is a regular seekable stream.
+ *
+ *  - `maxFrameSize == 0` selects ZSTD_SEEKABLE_MT_FRAMESIZE_DEFAULT rather
+ *    than the 1 GB serial default, since frames are the unit of parallelism.
+ *  - Up to 2 * `nbWorkers` frames are buffered, each needing about
+ *    `maxFrameSize` of input and its compressed size of output.
+ *  - ZSTD_seekable_compressStream() only blocks when all frame buffers are
+ *    busy, and ZSTD_seekable_endFrame() waits for every pending frame.
+ *  - Frames record their content size in the frame header, so output is not
+ *    byte-identical to the serial compressor, but decodes identically.
+ *  - `nbWorkers == 0` is the same as ZSTD_seekable_initCStream().  Values
+ *    above ZSTD_SEEKABLE_NBWORKERS_MAX are clamped.  Without
+ *    ZSTD_MULTITHREAD, frames are compressed on the calling thread. */
+ZSTDLIB_API size_t ZSTD_seekable_initCStreamMT(ZSTD_seekable_CStream* zcs, int compressionLevel, int checksumFlag, unsigned maxFrameSize, unsigned nbWorkers);
+
 /*= Raw seek table API
  *  These functions allow for the seek table to be constructed directly.
  *  This table can then be appended to a file of concatenated frames.
@@ -171,6 +199,21 @@ ZSTDLIB_API size_t ZSTD_seekable_initFile(ZSTD_seekable* zs, FILE* src);
 ZSTDLIB_API size_t ZSTD_seekable_decompress(ZSTD_seekable* zs, void* dst, size_t dstSize, unsigned long long offset);
 ZSTDLIB_API size_t ZSTD_seekable_decompressFrame(ZSTD_seekable* zs, void* dst, size_t dstSize, unsigned frameIndex);
 
+/*= Multithreaded decompression
+ *  ZSTD_seekable_decompressMT() has the same contract as
+ *  ZSTD_seekable_decompress(), but decompresses the frames that lie entirely
+ *  inside the requested range on up to `nbWorkers` threads, directly into
+ *  `dst`.  The calling thread reads compressed frames from the source while
+ *  the workers decode, so custom read and seek callbacks are still only ever
+ *  called from the calling thread.  With ZSTD_seekable_initBuff(), frames are
+ *  decoded in place without copying.  Partial frames at either end of the
+ *  range, and ranges covering fewer than two whole frames, go through
+ *  ZSTD_seekable_decompress().  Frame checksums are verified when present.
+ *  Threads and per-worker contexts are kept in `zs` for reuse, and released
+ *  by ZSTD_seekable_free().  `nbWorkers == 0` is the same as
+ *  ZSTD_seekable_decompress(). */
+ZSTDLIB_API size_t ZSTD_seekable_decompressMT(ZSTD_seekable* zs, void* dst, size_t dstSize, unsigned long long offset, unsigned nbWorkers);
+
 #define ZSTD_SEEKABLE_FRAMEINDEX_TOOLARGE (0ULL-2)
 /*===== Seekable seek table access functions =====*/
 ZSTDLIB_API unsigned ZSTD_seekable_getNumFrames(const ZSTD_seekable* zs);
@@ -219,6 +262,49 @@ typedef struct {
 } ZSTD_seekable_customFile;
 ZSTDLIB_API size_t ZSTD_seekable_initAdvanced(ZSTD_seekable* zs, ZSTD_seekable_customFile src);
 
+
+/*-****************************************************************************
+*  Shared decompression with a frame cache
+*
+*  A ZSTD_seekable decodes through a single stream and only remembers the
+*  frame it is in, so interleaved small reads at random offsets decode the
+*  same frames again and again, and it can't be used by two threads at once.
+*
+*  A ZSTD_seekableShared wraps an initialized ZSTD_seekable so that any number
+*  of threads can call ZSTD_seekableShared_decompress() on it at the same
+*  time.  It keeps up to `cacheSize` bytes of decoded frames, dropping the
+*  least recently used first, so that reads landing in a frame that was read
+*  recently are served with a copy.  Frames that are read whole, or that are
+*  larger than the cache, are decoded straight to `dst` without being cached.
+*  Each concurrent caller decodes with its own decompression context, which
+*  is kept for reuse until the shared object is freed.  Frame checksums are
+*  verified when present.
+*
+*  `zs` is not owned: it must outlive the shared object, and must not be used
+*  directly until the shared object is freed.  Reads from a source set with
+*  ZSTD_seekable_initFile() or ZSTD_seekable_initAdvanced() are serialized by
+*  a lock, and only the decoding runs in parallel; with ZSTD_seekable_initBuff()
+*  nothing is copied or locked except cache bookkeeping.  Thread safety
+*  requires a build with ZSTD_MULTITHREAD.
+*
+*  ZSTD_seekableShared_getStats() reports how many frames were served from the
+*  cache (`hits`, including readers that waited for another thread to decode
+*  the frame), how many were decoded (`misses`), and how many were evicted.
+******************************************************************************/
+
+typedef struct {
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long evictions;
+    size_t cachedBytes;
+    unsigned cachedFrames;
+} ZSTD_seekable_cacheStats;
+
+ZSTDLIB_API ZSTD_seekableShared* ZSTD_seekableShared_create(ZSTD_seekable* zs, size_t cacheSize);
+ZSTDLIB_API size_t ZSTD_seekableShared_free(ZSTD_seekableShared* ss);
+ZSTDLIB_API size_t ZSTD_seekableShared_decompress(ZSTD_seekableShared* ss, void* dst, size_t dstSize, unsigned long long offset);
+ZSTDLIB_API void ZSTD_seekableShared_getStats(ZSTD_seekableShared* ss, ZSTD_seekable_cacheStats* stats);
+
 #if defined (__cplusplus)
 }
 #endif
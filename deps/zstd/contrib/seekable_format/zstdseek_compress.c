@@ -18,6 +18,8 @@
 #include "zstd.h"
 #include "zstd_errors.h"
 #include "mem.h"
+#include "pool.h"        /* POOL_ctx, POOL_create, POOL_add */
+#include "threading.h"   /* ZSTD_pthread_mutex_t, ZSTD_pthread_cond_t */
 
 #include "zstd_seekable.h"
 
@@ -49,6 +51,43 @@ struct ZSTD_frameLog_s {
     U32 seekTableIndex;
 } framelog_t;
 
+typedef struct seekableMT_s seekableMT_t;
+
+/* One frame of the multithreaded compressor.  A job is filled with input on
+ * the caller's thread, compressed by a worker, then flushed in order. */
+typedef struct {
+    seekableMT_t* mt;
+    ZSTD_CCtx* cctx;
+
+    BYTE* src;
+    size_t srcSize;
+    size_t srcCapacity;
+
+    BYTE* dst;
+    size_t dstCapacity;
+    size_t cSize;      /* compressed size or error code, valid once done */
+    size_t flushed;    /* bytes of dst already written to output */
+
+    U32 checksum;
+    int done;          /* protected by mt->mutex */
+} seekableJob_t;
+
+struct seekableMT_s {
+    POOL_ctx* pool;    /* NULL without ZSTD_MULTITHREAD */
+    ZSTD_pthread_mutex_t mutex;
+    ZSTD_pthread_cond_t cond;
+
+    seekableJob_t* jobs;
+    U32 nbJobs;        /* ring of jobs, 2 per worker */
+    U32 nbWorkers;
+
+    U32 jobDispatched; /* jobs handed to workers so far */
+    U32 jobFlushed;    /* jobs written out and logged so far */
+
+    int compressionLevel;
+    int checksumFlag;
+};
+
 struct ZSTD_seekable_CStream_s {
     ZSTD_CStream* cstream;
     ZSTD_frameLog framelog;
@@ -61,6 +100,9 @@ struct ZSTD_seekable_CStream_s {
     U32 maxFrameSize;
 
     int writingSeekTable;
+
+    U32 nbWorkers;     /* 0 for serial compression */
+    seekableMT_t* mt;
 };
 
 static size_t ZSTD_seekable_frameLog_allocVec(ZSTD_frameLog* fl)
@@ -126,9 +168,12 @@ failed1:
     return NULL;
 }
 
+static void ZSTD_seekable_freeMT(seekableMT_t* mt);
+
 size_t ZSTD_seekable_freeCStream(ZSTD_seekable_CStream* zcs)
 {
     if (zcs == NULL) return 0; /* support free on null */
+    ZSTD_seekable_freeMT(zcs->mt);
     ZSTD_freeCStream(zcs->cstream);
     ZSTD_seekable_frameLog_freeVec(&zcs->framelog);
     free(zcs);
@@ -160,10 +205,255 @@ size_t ZSTD_seekable_initCStream(ZSTD_seekable_CStream* zcs,
     zcs->framelog.seekTablePos = 0;
     zcs->framelog.seekTableIndex = 0;
     zcs->writingSeekTable = 0;
+    zcs->nbWorkers = 0;
 
     return ZSTD_initCStream(zcs->cstream, compressionLevel);
 }
 
+/*===== Multithreaded compression =====*/
+
+static void ZSTD_seekable_freeMT(seekableMT_t* mt)
+{
+    U32 n;
+    if (mt == NULL) return;
+    POOL_free(mt->pool);  /* waits for queued jobs */
+    for (n = 0; n < mt->nbJobs; n++) {
+        ZSTD_freeCCtx(mt->jobs[n].cctx);
+        free(mt->jobs[n].src);
+        free(mt->jobs[n].dst);
+    }
+    free(mt->jobs);
+    ZSTD_pthread_mutex_destroy(&mt->mutex);
+    ZSTD_pthread_cond_destroy(&mt->cond);
+    free(mt);
+}
+
+static seekableMT_t* ZSTD_seekable_createMT(U32 nbWorkers)
+{
+    seekableMT_t* const mt = (seekableMT_t*)malloc(sizeof(seekableMT_t));
+    U32 n;
+    if (mt == NULL) return NULL;
+    memset(mt, 0, sizeof(*mt));
+    if (ZSTD_pthread_mutex_init(&mt->mutex, NULL)) {
+        free(mt);
+        return NULL;
+    }
+    if (ZSTD_pthread_cond_init(&mt->cond, NULL)) {
+        ZSTD_pthread_mutex_destroy(&mt->mutex);
+        free(mt);
+        return NULL;
+    }
+    mt->nbWorkers = nbWorkers;
+    mt->nbJobs = nbWorkers * 2;
+    mt->jobs = (seekableJob_t*)calloc(mt->nbJobs, sizeof(seekableJob_t));
+    if (mt->jobs == NULL) goto failed;
+    for (n = 0; n < mt->nbJobs; n++) mt->jobs[n].mt = mt;
+#ifdef ZSTD_MULTITHREAD
+    mt->pool = POOL_create(nbWorkers, mt->nbJobs);
+    if (mt->pool == NULL) goto failed;
+#endif
+    return mt;
+
+failed:
+    ZSTD_seekable_freeMT(mt);
+    return NULL;
+}
+
+/* Wait for job to be compressed. */
+static void ZSTD_seekable_waitJob(seekableJob_t* job)
+{
+    ZSTD_pthread_mutex_lock(&job->mt->mutex);
+    while (!job->done) ZSTD_pthread_cond_wait(&job->mt->cond, &job->mt->mutex);
+    ZSTD_pthread_mutex_unlock(&job->mt->mutex);
+}
+
+static int ZSTD_seekable_jobDone(seekableJob_t* job)
+{
+    int done;
+    ZSTD_pthread_mutex_lock(&job->mt->mutex);
+    done = job->done;
+    ZSTD_pthread_mutex_unlock(&job->mt->mutex);
+    return done;
+}
+
+static void ZSTD_seekable_compressJob(void* opaque)
+{
+    seekableJob_t* const job = (seekableJob_t*)opaque;
+    seekableMT_t* const mt = job->mt;
+    size_t const cSize = ZSTD_compress2(job->cctx, job->dst, job->dstCapacity,
+                                        job->src, job->srcSize);
+    U32 const checksum = mt->checksumFlag
+            ? (U32)(XXH64(job->src, job->srcSize, 0) & 0xFFFFFFFFU)
+            : 0;
+
+    ZSTD_pthread_mutex_lock(&mt->mutex);
+    job->cSize = cSize;
+    job->checksum = checksum;
+    job->done = 1;
+    ZSTD_pthread_cond_broadcast(&mt->cond);
+    ZSTD_pthread_mutex_unlock(&mt->mutex);
+}
+
+/* Hand the job being filled to a worker. */
+static size_t ZSTD_seekable_dispatchJob(seekableMT_t* mt)
+{
+    seekableJob_t* const job = &mt->jobs[mt->jobDispatched % mt->nbJobs];
+    size_t const bound = ZSTD_compressBound(job->srcSize);
+
+    if (job->cctx == NULL) {
+        job->cctx = ZSTD_createCCtx();
+        if (job->cctx == NULL) return ERROR(memory_allocation);
+    }
+    ZSTD_CCtx_reset(job->cctx, ZSTD_reset_session_only);
+    {   size_t const ret = ZSTD_CCtx_setParameter(job->cctx, ZSTD_c_compressionLevel, mt->compressionLevel);
+        if (ZSTD_isError(ret)) return ret; }
+
+    if (job->dstCapacity < bound) {
+        free(job->dst);
+        job->dst = (BYTE*)malloc(bound);
+        job->dstCapacity = job->dst == NULL ? 0 : bound;
+        if (job->dst == NULL) return ERROR(memory_allocation);
+    }
+    job->flushed = 0;
+    job->done = 0;  /* no worker holds this job yet */
+    mt->jobDispatched++;
+
+    if (mt->pool != NULL) {
+        POOL_add(mt->pool, ZSTD_seekable_compressJob, job);
+    } else {
+        ZSTD_seekable_compressJob(job);
+    }
+    return 0;
+}
+
+/* Write finished frames to output in order and log them, waiting for all
+ * jobs before `waitUntil` to finish.
+ * @return : bytes left to flush from finished jobs, or an error code */
+static size_t ZSTD_seekable_flushMT(ZSTD_seekable_CStream* zcs,
+                                    ZSTD_outBuffer* output, U32 waitUntil)
+{
+    seekableMT_t* const mt = zcs->mt;
+
+    while (mt->jobFlushed < mt->jobDispatched) {
+        seekableJob_t* const job = &mt->jobs[mt->jobFlushed % mt->nbJobs];
+        size_t toFlush;
+
+        if (mt->jobFlushed < waitUntil) {
+            ZSTD_seekable_waitJob(job);
+        } else if (!ZSTD_seekable_jobDone(job)) {
+            break;
+        }
+        if (ZSTD_isError(job->cSize)) return job->cSize;
+
+        toFlush = MIN(job->cSize - job->flushed, output->size - output->pos);
+        if (toFlush) {
+            memcpy((BYTE*)output->dst + output->pos, job->dst + job->flushed, toFlush);
+            output->pos += toFlush;
+            job->flushed += toFlush;
+        }
+        if (job->flushed < job->cSize) return job->cSize - job->flushed;
+
+        CHECK_Z(ZSTD_seekable_logFrame(&zcs->framelog, (U32)job->cSize,
+                                       (U32)job->srcSize, job->checksum));
+        job->srcSize = 0;
+        mt->jobFlushed++;
+    }
+    return 0;
+}
+
+size_t ZSTD_seekable_initCStreamMT(ZSTD_seekable_CStream* zcs,
+                                   int compressionLevel,
+                                   int checksumFlag,
+                                   unsigned maxFrameSize,
+                                   unsigned nbWorkers)
+{
+    seekableMT_t* mt = zcs->mt;
+
+    {   size_t const ret = ZSTD_seekable_initCStream(zcs, compressionLevel,
+                                                     checksumFlag, maxFrameSize);
+        if (ZSTD_isError(ret)) return ret; }
+    if (nbWorkers == 0) return 0;
+    nbWorkers = MIN(nbWorkers, ZSTD_SEEKABLE_NBWORKERS_MAX);
+
+    if (mt != NULL && mt->nbWorkers != nbWorkers) {
+        ZSTD_seekable_freeMT(mt);
+        zcs->mt = mt = NULL;
+    }
+    if (mt == NULL) {
+        zcs->mt = mt = ZSTD_seekable_createMT(nbWorkers);
+        if (mt == NULL) return ERROR(memory_allocation);
+    } else {
+        /* drop anything left over from an abandoned operation */
+        U32 n;
+        for ( ; mt->jobFlushed < mt->jobDispatched; mt->jobFlushed++)
+            ZSTD_seekable_waitJob(&mt->jobs[mt->jobFlushed % mt->nbJobs]);
+        for (n = 0; n < mt->nbJobs; n++) mt->jobs[n].srcSize = 0;
+    }
+    mt->jobDispatched = 0;
+    mt->jobFlushed = 0;
+    mt->compressionLevel = compressionLevel;
+    mt->checksumFlag = checksumFlag;
+
+    zcs->maxFrameSize = maxFrameSize ? maxFrameSize : ZSTD_SEEKABLE_MT_FRAMESIZE_DEFAULT;
+    zcs->nbWorkers = nbWorkers;
+    return 0;
+}
+
+static size_t ZSTD_seekable_compressStreamMT(ZSTD_seekable_CStream* zcs, ZSTD_outBuffer* output, ZSTD_inBuffer* input)
+{
+    seekableMT_t* const mt = zcs->mt;
+
+    while (input->pos < input->size) {
+        seekableJob_t* job;
+        size_t toCopy;
+
+        if (mt->jobDispatched - mt->jobFlushed == mt->nbJobs) {
+            /* every job is busy: wait for the oldest, and stop if it can't
+             * be flushed for lack of output space */
+            size_t const ret = ZSTD_seekable_flushMT(zcs, output, mt->jobFlushed + 1);
+            if (ZSTD_isError(ret)) return ret;
+            if (mt->jobDispatched - mt->jobFlushed == mt->nbJobs) break;
+        }
+
+        job = &mt->jobs[mt->jobDispatched % mt->nbJobs];
+        toCopy = MIN(input->size - input->pos, zcs->maxFrameSize - job->srcSize);
+        if (job->srcSize + toCopy > job->srcCapacity) {
+            size_t const capacity = MIN((size_t)zcs->maxFrameSize,
+                                        MAX(job->srcSize + toCopy, job->srcCapacity * 2));
+            BYTE* const src = (BYTE*)realloc(job->src, capacity);
+            if (src == NULL) return ERROR(memory_allocation);
+            job->src = src;
+            job->srcCapacity = capacity;
+        }
+        memcpy(job->src + job->srcSize, (const BYTE*)input->src + input->pos, toCopy);
+        job->srcSize += toCopy;
+        input->pos += toCopy;
+
+        if (job->srcSize == zcs->maxFrameSize) CHECK_Z(ZSTD_seekable_dispatchJob(mt));
+    }
+
+    {   size_t const ret = ZSTD_seekable_flushMT(zcs, output, 0);
+        if (ZSTD_isError(ret)) return ret; }
+
+    if (mt->jobDispatched - mt->jobFlushed == mt->nbJobs) return zcs->maxFrameSize;
+    return zcs->maxFrameSize - mt->jobs[mt->jobDispatched % mt->nbJobs].srcSize;
+}
+
+/* Send off the frame being filled, if any, and wait for all frames to be
+ * compressed and flushed.  An empty frame is only sent if `lastFrame` is set
+ * and nothing has been written yet, so that there is always one frame. */
+static size_t ZSTD_seekable_endFrameMT(ZSTD_seekable_CStream* zcs, ZSTD_outBuffer* output, int lastFrame)
+{
+    seekableMT_t* const mt = zcs->mt;
+
+    if (mt->jobDispatched - mt->jobFlushed < mt->nbJobs) {
+        seekableJob_t* const job = &mt->jobs[mt->jobDispatched % mt->nbJobs];
+        if (job->srcSize > 0 || (lastFrame && mt->jobDispatched == 0))
+            CHECK_Z(ZSTD_seekable_dispatchJob(mt));
+    }
+    return ZSTD_seekable_flushMT(zcs, output, mt->jobDispatched);
+}
+
 size_t ZSTD_seekable_logFrame(ZSTD_frameLog* fl,
                               unsigned compressedSize,
                               unsigned decompressedSize,
@@ -197,8 +487,11 @@ size_t ZSTD_seekable_logFrame(ZSTD_frameLog* fl,
 size_t ZSTD_seekable_endFrame(ZSTD_seekable_CStream* zcs, ZSTD_outBuffer* output)
 {
     size_t const prevOutPos = output->pos;
+    size_t ret;
+    if (zcs->nbWorkers) return ZSTD_seekable_endFrameMT(zcs, output, 0);
+
     /* end the frame */
-    size_t ret = ZSTD_endStream(zcs->cstream, output);
+    ret = ZSTD_endStream(zcs->cstream, output);
 
     zcs->frameCSize += (U32)(output->pos - prevOutPos);
 
@@ -230,6 +523,8 @@ size_t ZSTD_seekable_compressStream(ZSTD_seekable_CStream* zcs, ZSTD_outBuffer*
     const BYTE* const inBase = (const BYTE*) input->src + input->pos;
     size_t inLen = input->size - input->pos;
 
+    if (zcs->nbWorkers) return ZSTD_seekable_compressStreamMT(zcs, output, input);
+
     assert(zcs->maxFrameSize < INT_MAX);
     ZSTD_CCtx_setParameter(zcs->cstream, ZSTD_c_srcSizeHint, (int)zcs->maxFrameSize);
     inLen = MIN(inLen, (size_t)(zcs->maxFrameSize - zcs->frameDSize));
@@ -353,7 +648,9 @@ size_t ZSTD_seekable_writeSeekTable(ZSTD_frameLog* fl, ZSTD_outBuffer* output)
 size_t ZSTD_seekable_endStream(ZSTD_seekable_CStream* zcs, ZSTD_outBuffer* output)
 {
     if (!zcs->writingSeekTable) {
-        const size_t endFrame = ZSTD_seekable_endFrame(zcs, output);
+        const size_t endFrame = zcs->nbWorkers
+                              ? ZSTD_seekable_endFrameMT(zcs, output, 1)
+                              : ZSTD_seekable_endFrame(zcs, output);
         if (ZSTD_isError(endFrame)) return endFrame;
         /* return an accurate size hint */
         if (endFrame) return endFrame + ZSTD_seekable_seekTableSize(&zcs->framelog);
@@ -117,6 +117,8 @@
 #include "zstd.h"
 #include "zstd_errors.h"
 #include "mem.h"
+#include "pool.h"        /* POOL_ctx, POOL_create, POOL_add */
+#include "threading.h"   /* ZSTD_pthread_mutex_t, ZSTD_pthread_cond_t */
 #include "zstd_seekable.h"
 
 #undef ERROR
@@ -206,6 +208,39 @@ struct ZSTD_seekTable_s {
 
 #define SEEKABLE_BUFF_SIZE ZSTD_BLOCKSIZE_MAX
 
+typedef struct seekableDMT_s seekableDMT_t;
+
+/* One frame decoded by ZSTD_seekable_decompressMT().  The compressed frame
+ * is read on the caller's thread, then decoded by a worker straight into the
+ * caller's buffer. */
+typedef struct {
+    seekableDMT_t* mt;
+    ZSTD_DCtx* dctx;
+
+    BYTE* inBuff;      /* owned copy of the frame, unless in memory */
+    size_t inCapacity;
+    const BYTE* src;
+    size_t cSize;
+
+    BYTE* dst;
+    size_t dSize;
+
+    int checksumFlag;
+    U32 checksum;
+    size_t result;     /* protected by mt->mutex, valid once done */
+    int done;
+} seekableDJob_t;
+
+struct seekableDMT_s {
+    POOL_ctx* pool;    /* NULL without ZSTD_MULTITHREAD */
+    ZSTD_pthread_mutex_t mutex;
+    ZSTD_pthread_cond_t cond;
+
+    seekableDJob_t* jobs;
+    U32 nbJobs;        /* ring of jobs, 2 per worker */
+    U32 nbWorkers;
+};
+
 struct ZSTD_seekable_s {
     ZSTD_DStream* dstream;
     ZSTD_seekTable seekTable;
@@ -222,8 +257,12 @@ struct ZSTD_seekable_s {
     buffWrapper_t buffWrapper; /* for `src.opaque` in in-memory mode */
 
     XXH64_state_t xxhState;
+
+    seekableDMT_t* mt; /* created by the first ZSTD_seekable_decompressMT() */
 };
 
+static void ZSTD_seekable_freeDMT(seekableDMT_t* mt);
+
 ZSTD_seekable* ZSTD_seekable_create(void)
 {
     ZSTD_seekable* const zs = (ZSTD_seekable*)malloc(sizeof(ZSTD_seekable));
@@ -244,6 +283,7 @@ ZSTD_seekable* ZSTD_seekable_create(void)
 size_t ZSTD_seekable_free(ZSTD_seekable* zs)
 {
     if (zs == NULL) return 0; /* support free on null */
+    ZSTD_seekable_freeDMT(zs->mt);
     ZSTD_freeDStream(zs->dstream);
     free(zs->seekTable.entries);
     free(zs);
@@ -593,3 +633,671 @@ size_t ZSTD_seekable_decompressFrame(ZSTD_seekable* zs, void* dst, size_t dstSiz
                 zs->seekTable.entries[frameIndex].dOffset);
     }
 }
+
+/*===== Multithreaded decompression =====*/
+
+/* Get the sizes of frame `frameIndex`, rejecting sizes no zstd frame could
+ * have, so that they are safe to allocate for. */
+static size_t ZSTD_seekable_frameSizes(const ZSTD_seekTable* st, U32 frameIndex,
+                                       size_t* cSizePtr, size_t* dSizePtr)
+{
+    seekEntry_t const* const entry = st->entries + frameIndex;
+    U64 const cSize = entry[1].cOffset - entry[0].cOffset;
+    U64 const dSize = entry[1].dOffset - entry[0].dOffset;
+
+    if (dSize > ZSTD_SEEKABLE_MAX_FRAME_DECOMPRESSED_SIZE ||
+        cSize > ZSTD_compressBound((size_t)dSize)) {
+        return ERROR(corruption_detected);
+    }
+    *cSizePtr = (size_t)cSize;
+    *dSizePtr = (size_t)dSize;
+    return 0;
+}
+
+/* Decode one whole frame of exactly `dSize` bytes, checking its checksum.
+ * @return : dSize, or an error code */
+static size_t ZSTD_seekable_decodeFrame(ZSTD_DCtx* dctx, BYTE* dst, size_t dSize,
+                                        const BYTE* src, size_t cSize,
+                                        int checksumFlag, U32 checksum)
+{
+    size_t const result = ZSTD_decompressDCtx(dctx, dst, dSize, src, cSize);
+    if (ZSTD_isError(result)) return result;
+    if (result != dSize) return ERROR(corruption_detected);
+    if (checksumFlag && (XXH64(dst, dSize, 0) & 0xFFFFFFFFU) != checksum) {
+        return ERROR(corruption_detected);
+    }
+    return dSize;
+}
+
+static void ZSTD_seekable_freeDMT(seekableDMT_t* mt)
+{
+    U32 n;
+    if (mt == NULL) return;
+    POOL_free(mt->pool);  /* waits for queued jobs */
+    for (n = 0; n < mt->nbJobs; n++) {
+        ZSTD_freeDCtx(mt->jobs[n].dctx);
+        free(mt->jobs[n].inBuff);
+    }
+    free(mt->jobs);
+    ZSTD_pthread_mutex_destroy(&mt->mutex);
+    ZSTD_pthread_cond_destroy(&mt->cond);
+    free(mt);
+}
+
+static seekableDMT_t* ZSTD_seekable_createDMT(U32 nbWorkers)
+{
+    seekableDMT_t* const mt = (seekableDMT_t*)malloc(sizeof(seekableDMT_t));
+    U32 n;
+    if (mt == NULL) return NULL;
+    memset(mt, 0, sizeof(*mt));
+    if (ZSTD_pthread_mutex_init(&mt->mutex, NULL)) {
+        free(mt);
+        return NULL;
+    }
+    if (ZSTD_pthread_cond_init(&mt->cond, NULL)) {
+        ZSTD_pthread_mutex_destroy(&mt->mutex);
+        free(mt);
+        return NULL;
+    }
+    mt->nbWorkers = nbWorkers;
+    mt->nbJobs = nbWorkers * 2;
+    mt->jobs = (seekableDJob_t*)calloc(mt->nbJobs, sizeof(seekableDJob_t));
+    if (mt->jobs == NULL) goto failed;
+    for (n = 0; n < mt->nbJobs; n++) {
+        mt->jobs[n].mt = mt;
+        mt->jobs[n].dctx = ZSTD_createDCtx();
+        if (mt->jobs[n].dctx == NULL) goto failed;
+    }
+#ifdef ZSTD_MULTITHREAD
+    mt->pool = POOL_create(nbWorkers, mt->nbJobs);
+    if (mt->pool == NULL) goto failed;
+#endif
+    return mt;
+
+failed:
+    ZSTD_seekable_freeDMT(mt);
+    return NULL;
+}
+
+static void ZSTD_seekable_decompressJob(void* opaque)
+{
+    seekableDJob_t* const job = (seekableDJob_t*)opaque;
+    seekableDMT_t* const mt = job->mt;
+    size_t const result = ZSTD_seekable_decodeFrame(job->dctx, job->dst, job->dSize,
+                                                    job->src, job->cSize,
+                                                    job->checksumFlag, job->checksum);
+
+    ZSTD_pthread_mutex_lock(&mt->mutex);
+    job->result = result;
+    job->done = 1;
+    ZSTD_pthread_cond_broadcast(&mt->cond);
+    ZSTD_pthread_mutex_unlock(&mt->mutex);
+}
+
+/* Wait for job to be decoded.
+ * @return : its decompressed size, or an error code */
+static size_t ZSTD_seekable_waitDJob(seekableDJob_t* job)
+{
+    size_t result;
+    ZSTD_pthread_mutex_lock(&job->mt->mutex);
+    while (!job->done) ZSTD_pthread_cond_wait(&job->mt->cond, &job->mt->mutex);
+    result = job->result;
+    ZSTD_pthread_mutex_unlock(&job->mt->mutex);
+    return result;
+}
+
+/* Set up job to decode frame `frameIndex` into `dst`, reading it from the
+ * source unless the source is in memory. */
+static size_t ZSTD_seekable_loadDJob(ZSTD_seekable* zs, seekableDJob_t* job,
+                                     U32 frameIndex, BYTE* dst)
+{
+    seekEntry_t const* const entry = zs->seekTable.entries + frameIndex;
+    size_t cSize, dSize;
+    {   size_t const err = ZSTD_seekable_frameSizes(&zs->seekTable, frameIndex, &cSize, &dSize);
+        if (err) return err;
+    }
+
+    if (zs->src.opaque == &zs->buffWrapper) {
+        if (entry[1].cOffset > zs->buffWrapper.size) return ERROR(seekableIO);
+        job->src = (const BYTE*)zs->buffWrapper.ptr + entry[0].cOffset;
+    } else {
+        if (job->inCapacity < cSize) {
+            free(job->inBuff);
+            job->inBuff = (BYTE*)malloc(cSize);
+            job->inCapacity = job->inBuff == NULL ? 0 : cSize;
+            if (job->inBuff == NULL) return ERROR(memory_allocation);
+        }
+        CHECK_IO(zs->src.read(zs->src.opaque, job->inBuff, cSize));
+        job->src = job->inBuff;
+    }
+    job->cSize = cSize;
+    job->dst = dst;
+    job->dSize = dSize;
+    job->checksumFlag = zs->seekTable.checksumFlag;
+    job->checksum = entry[0].checksum;
+    job->done = 0;
+    return 0;
+}
+
+/* Decode whole frames [first, last) into dst, which starts at decompressed
+ * offset `offset`, with at most 2 frames per worker in flight. */
+static size_t ZSTD_seekable_decompressFramesMT(ZSTD_seekable* zs, BYTE* dst,
+                                               unsigned long long offset,
+                                               U32 first, U32 last)
+{
+    seekableDMT_t* const mt = zs->mt;
+    U32 next = first;     /* next frame to hand out */
+    U32 waiting = first;  /* oldest frame in flight */
+    size_t err = 0;
+
+    assert(zs->seekTable.entries[first].cOffset < LLONG_MAX);
+    if (zs->src.opaque != &zs->buffWrapper) {
+        CHECK_IO(zs->src.seek(zs->src.opaque,
+                              (long long)zs->seekTable.entries[first].cOffset,
+                              SEEK_SET));
+    }
+
+    while (waiting < next || (!err && next < last)) {
+        if (!err && next < last && next - waiting < mt->nbJobs) {
+            seekableDJob_t* const job = &mt->jobs[next % mt->nbJobs];
+            err = ZSTD_seekable_loadDJob(zs, job, next,
+                    dst + (zs->seekTable.entries[next].dOffset - offset));
+            if (err) continue;
+            next++;
+            if (mt->pool != NULL) {
+                POOL_add(mt->pool, ZSTD_seekable_decompressJob, job);
+            } else {
+                ZSTD_seekable_decompressJob(job);
+            }
+        } else {
+            size_t const result = ZSTD_seekable_waitDJob(&mt->jobs[waiting % mt->nbJobs]);
+            if (ZSTD_isError(result) && !err) err = result;
+            waiting++;
+        }
+    }
+    return err;
+}
+
+size_t ZSTD_seekable_decompressMT(ZSTD_seekable* zs, void* dst, size_t len, unsigned long long offset, unsigned nbWorkers)
+{
+    unsigned long long const eos = zs->seekTable.entries[zs->seekTable.tableLen].dOffset;
+    unsigned long long end;
+    U32 first, last;
+
+    if (nbWorkers == 0) return ZSTD_seekable_decompress(zs, dst, len, offset);
+    nbWorkers = MIN(nbWorkers, ZSTD_SEEKABLE_NBWORKERS_MAX);
+    if (offset + len > eos) {
+        len = eos - offset;
+    }
+    end = offset + len;
+
+    /* whole frames in [offset, end) are [first, last) */
+    first = ZSTD_seekable_offsetToFrameIndex(zs, offset);
+    if (first < zs->seekTable.tableLen && zs->seekTable.entries[first].dOffset < offset) first++;
+    last = ZSTD_seekable_offsetToFrameIndex(zs, end);
+    if (last < first + 2) return ZSTD_seekable_decompress(zs, dst, len, offset);
+
+    if (zs->mt != NULL && zs->mt->nbWorkers != nbWorkers) {
+        ZSTD_seekable_freeDMT(zs->mt);
+        zs->mt = NULL;
+    }
+    if (zs->mt == NULL) {
+        zs->mt = ZSTD_seekable_createDMT(nbWorkers);
+        if (zs->mt == NULL) return ERROR(memory_allocation);
+    }
+
+    /* partial frame at the start */
+    if (offset < zs->seekTable.entries[first].dOffset) {
+        size_t const head = (size_t)(zs->seekTable.entries[first].dOffset - offset);
+        size_t const ret = ZSTD_seekable_decompress(zs, dst, head, offset);
+        if (ZSTD_isError(ret)) return ret;
+    }
+
+    {   size_t const ret = ZSTD_seekable_decompressFramesMT(zs, (BYTE*)dst, offset, first, last);
+        /* the source has moved, so the streaming state can't be resumed */
+        zs->curFrame = (U32)-1;
+        if (ZSTD_isError(ret)) return ret;
+    }
+
+    /* partial frame at the end */
+    if (zs->seekTable.entries[last].dOffset < end) {
+        unsigned long long const tailOffset = zs->seekTable.entries[last].dOffset;
+        size_t const ret = ZSTD_seekable_decompress(zs, (BYTE*)dst + (tailOffset - offset),
+                                                    (size_t)(end - tailOffset), tailOffset);
+        if (ZSTD_isError(ret)) return ret;
+    }
+
+    return len;
+}
+
+/*===== Shared decompression with a frame cache =====*/
+
+typedef struct seekableCacheEntry_s seekableCacheEntry_t;
+
+/* A decoded frame.  Until `done` is set, the frame is being decoded by the
+ * thread that inserted the entry, and other readers of it wait on ss->cond. */
+struct seekableCacheEntry_s {
+    U32 frameIndex;
+    U32 refs;                       /* readers copying from or waiting on it */
+    int done;
+    size_t result;                  /* error code if the frame failed to decode */
+    BYTE* data;
+    size_t size;
+    seekableCacheEntry_t* hashNext;
+    seekableCacheEntry_t* newer;    /* LRU list of decoded frames */
+    seekableCacheEntry_t* older;
+};
+
+/* Decompression context for one reader, kept on a free list between calls so
+ * that each thread decoding at the same time has its own. */
+typedef struct seekableReader_s seekableReader_t;
+struct seekableReader_s {
+    ZSTD_DCtx* dctx;
+    BYTE* inBuff;
+    size_t inCapacity;
+    seekableReader_t* next;
+};
+
+#define SEEKABLE_CACHE_HASHLOG_MIN 6
+
+struct ZSTD_seekableShared_s {
+    ZSTD_seekable* zs;              /* seek table and source, not owned */
+    ZSTD_pthread_mutex_t ioMutex;   /* serializes use of zs->src */
+    ZSTD_pthread_mutex_t mutex;     /* protects everything below */
+    ZSTD_pthread_cond_t cond;       /* signalled when a frame is decoded */
+
+    seekableCacheEntry_t** hashTable;
+    U32 hashLog;
+    U32 nbEntries;                  /* in hashTable, decoded or not */
+    seekableCacheEntry_t* newest;
+    seekableCacheEntry_t* oldest;
+    size_t cacheSize;
+    size_t cachedBytes;
+    unsigned cachedFrames;
+
+    seekableReader_t* readers;      /* idle readers */
+
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long evictions;
+};
+
+static U32 ZSTD_seekableShared_hash(U32 frameIndex, U32 hashLog)
+{
+    return (frameIndex * 2654435761U) >> (32 - hashLog);
+}
+
+ZSTD_seekableShared* ZSTD_seekableShared_create(ZSTD_seekable* zs, size_t cacheSize)
+{
+    ZSTD_seekableShared* ss;
+    if (zs == NULL || zs->seekTable.entries == NULL) return NULL;
+    ss = (ZSTD_seekableShared*)malloc(sizeof(ZSTD_seekableShared));
+    if (ss == NULL) return NULL;
+    memset(ss, 0, sizeof(*ss));
+    ss->zs = zs;
+    ss->cacheSize = cacheSize;
+    ss->hashLog = SEEKABLE_CACHE_HASHLOG_MIN;
+    ss->hashTable = (seekableCacheEntry_t**)calloc((size_t)1 << ss->hashLog, sizeof(seekableCacheEntry_t*));
+    if (ss->hashTable == NULL) {
+        free(ss);
+        return NULL;
+    }
+    if (ZSTD_pthread_mutex_init(&ss->ioMutex, NULL)) goto failed_io;
+    if (ZSTD_pthread_mutex_init(&ss->mutex, NULL)) goto failed_mutex;
+    if (ZSTD_pthread_cond_init(&ss->cond, NULL)) goto failed_cond;
+    return ss;
+
+failed_cond:
+    ZSTD_pthread_mutex_destroy(&ss->mutex);
+failed_mutex:
+    ZSTD_pthread_mutex_destroy(&ss->ioMutex);
+failed_io:
+    free(ss->hashTable);
+    free(ss);
+    return NULL;
+}
+
+size_t ZSTD_seekableShared_free(ZSTD_seekableShared* ss)
+{
+    U32 n;
+    if (ss == NULL) return 0; /* support free on null */
+    for (n = 0; n < (1U << ss->hashLog); n++) {
+        seekableCacheEntry_t* entry = ss->hashTable[n];
+        while (entry != NULL) {
+            seekableCacheEntry_t* const next = entry->hashNext;
+            assert(entry->refs == 0);
+            free(entry->data);
+            free(entry);
+            entry = next;
+        }
+    }
+    while (ss->readers != NULL) {
+        seekableReader_t* const next = ss->readers->next;
+        ZSTD_freeDCtx(ss->readers->dctx);
+        free(ss->readers->inBuff);
+        free(ss->readers);
+        ss->readers = next;
+    }
+    free(ss->hashTable);
+    ZSTD_pthread_mutex_destroy(&ss->ioMutex);
+    ZSTD_pthread_mutex_destroy(&ss->mutex);
+    ZSTD_pthread_cond_destroy(&ss->cond);
+    /* the source has moved, so zs can't resume its own streaming state */
+    ss->zs->curFrame = (U32)-1;
+    free(ss);
+    return 0;
+}
+
+void ZSTD_seekableShared_getStats(ZSTD_seekableShared* ss, ZSTD_seekable_cacheStats* stats)
+{
+    ZSTD_pthread_mutex_lock(&ss->mutex);
+    stats->hits = ss->hits;
+    stats->misses = ss->misses;
+    stats->evictions = ss->evictions;
+    stats->cachedBytes = ss->cachedBytes;
+    stats->cachedFrames = ss->cachedFrames;
+    ZSTD_pthread_mutex_unlock(&ss->mutex);
+}
+
+static seekableReader_t* ZSTD_seekableShared_getReader(ZSTD_seekableShared* ss)
+{
+    seekableReader_t* reader;
+    ZSTD_pthread_mutex_lock(&ss->mutex);
+    reader = ss->readers;
+    if (reader != NULL) ss->readers = reader->next;
+    ZSTD_pthread_mutex_unlock(&ss->mutex);
+    if (reader != NULL) return reader;
+
+    reader = (seekableReader_t*)calloc(1, sizeof(seekableReader_t));
+    if (reader == NULL) return NULL;
+    reader->dctx = ZSTD_createDCtx();
+    if (reader->dctx == NULL) {
+        free(reader);
+        return NULL;
+    }
+    return reader;
+}
+
+static void ZSTD_seekableShared_releaseReader(ZSTD_seekableShared* ss, seekableReader_t* reader)
+{
+    ZSTD_pthread_mutex_lock(&ss->mutex);
+    reader->next = ss->readers;
+    ss->readers = reader;
+    ZSTD_pthread_mutex_unlock(&ss->mutex);
+}
+
+/* Decode frame `frameIndex` into `dst`, which has room for exactly its
+ * decompressed size.  Only the read from a source that is not in memory is
+ * serialized; decoding runs in parallel with other readers. */
+static size_t ZSTD_seekableShared_decodeFrame(ZSTD_seekableShared* ss, seekableReader_t* reader,
+                                              U32 frameIndex, BYTE* dst)
+{
+    ZSTD_seekable* const zs = ss->zs;
+    seekEntry_t const* const entry = zs->seekTable.entries + frameIndex;
+    const BYTE* src;
+    size_t cSize, dSize;
+    {   size_t const err = ZSTD_seekable_frameSizes(&zs->seekTable, frameIndex, &cSize, &dSize);
+        if (err) return err;
+    }
+
+    if (zs->src.opaque == &zs->buffWrapper) {
+        if (entry[1].cOffset > zs->buffWrapper.size) return ERROR(seekableIO);
+        src = (const BYTE*)zs->buffWrapper.ptr + entry[0].cOffset;
+    } else {
+        int ret;
+        if (reader->inCapacity < cSize) {
+            free(reader->inBuff);
+            reader->inBuff = (BYTE*)malloc(cSize);
+            reader->inCapacity = reader->inBuff == NULL ? 0 : cSize;
+            if (reader->inBuff == NULL) return ERROR(memory_allocation);
+        }
+        assert(entry[0].cOffset < LLONG_MAX);
+        ZSTD_pthread_mutex_lock(&ss->ioMutex);
+        ret = zs->src.seek(zs->src.opaque, (long long)entry[0].cOffset, SEEK_SET);
+        if (ret >= 0) ret = zs->src.read(zs->src.opaque, reader->inBuff, cSize);
+        ZSTD_pthread_mutex_unlock(&ss->ioMutex);
+        if (ret < 0) return ERROR(seekableIO);
+        src = reader->inBuff;
+    }
+    return ZSTD_seekable_decodeFrame(reader->dctx, dst, dSize, src, cSize,
+                                     zs->seekTable.checksumFlag, entry[0].checksum);
+}
+
+/* The functions below are called with ss->mutex held */
+
+static seekableCacheEntry_t* ZSTD_seekableShared_find(ZSTD_seekableShared* ss, U32 frameIndex)
+{
+    seekableCacheEntry_t* entry = ss->hashTable[ZSTD_seekableShared_hash(frameIndex, ss->hashLog)];
+    while (entry != NULL && entry->frameIndex != frameIndex) entry = entry->hashNext;
+    return entry;
+}
+
+static void ZSTD_seekableShared_hashInsert(ZSTD_seekableShared* ss, seekableCacheEntry_t* entry)
+{
+    /* keep chains short by doubling the table as it fills, unless the
+     * allocation fails, which only makes chains longer */
+    if (ss->nbEntries >= (1U << ss->hashLog) && ss->hashLog < 30) {
+        U32 const newLog = ss->hashLog + 1;
+        seekableCacheEntry_t** const newTable =
+                (seekableCacheEntry_t**)calloc((size_t)1 << newLog, sizeof(seekableCacheEntry_t*));
+        if (newTable != NULL) {
+            U32 n;
+            for (n = 0; n < (1U << ss->hashLog); n++) {
+                seekableCacheEntry_t* e = ss->hashTable[n];
+                while (e != NULL) {
+                    seekableCacheEntry_t* const next = e->hashNext;
+                    U32 const h = ZSTD_seekableShared_hash(e->frameIndex, newLog);
+                    e->hashNext = newTable[h];
+                    newTable[h] = e;
+                    e = next;
+                }
+            }
+            free(ss->hashTable);
+            ss->hashTable = newTable;
+            ss->hashLog = newLog;
+        }
+    }
+    {   U32 const h = ZSTD_seekableShared_hash(entry->frameIndex, ss->hashLog);
+        entry->hashNext = ss->hashTable[h];
+        ss->hashTable[h] = entry;
+        ss->nbEntries++;
+    }
+}
+
+static void ZSTD_seekableShared_hashRemove(ZSTD_seekableShared* ss, seekableCacheEntry_t* entry)
+{
+    seekableCacheEntry_t** link = &ss->hashTable[ZSTD_seekableShared_hash(entry->frameIndex, ss->hashLog)];
+    while (*link != entry) link = &(*link)->hashNext;
+    *link = entry->hashNext;
+    ss->nbEntries--;
+}
+
+static void ZSTD_seekableShared_lruUnlink(ZSTD_seekableShared* ss, seekableCacheEntry_t* entry)
+{
+    if (entry->newer != NULL) entry->newer->older = entry->older;
+    else ss->newest = entry->older;
+    if (entry->older != NULL) entry->older->newer = entry->newer;
+    else ss->oldest = entry->newer;
+}
+
+static void ZSTD_seekableShared_lruPush(ZSTD_seekableShared* ss, seekableCacheEntry_t* entry)
+{
+    entry->newer = NULL;
+    entry->older = ss->newest;
+    if (ss->newest != NULL) ss->newest->newer = entry;
+    else ss->oldest = entry;
+    ss->newest = entry;
+}
+
+/* Drop the least recently used frames until the cache fits its budget.
+ * Frames that readers are still copying from are skipped. */
+static void ZSTD_seekableShared_evict(ZSTD_seekableShared* ss)
+{
+    seekableCacheEntry_t* entry = ss->oldest;
+    while (ss->cachedBytes > ss->cacheSize && entry != NULL) {
+        seekableCacheEntry_t* const newer = entry->newer;
+        if (entry->refs == 0) {
+            ZSTD_seekableShared_lruUnlink(ss, entry);
+            ZSTD_seekableShared_hashRemove(ss, entry);
+            ss->cachedBytes -= entry->size;
+            ss->cachedFrames--;
+            ss->evictions++;
+            free(entry->data);
+            free(entry);
+        }
+        entry = newer;
+    }
+}
+
+static void ZSTD_seekableShared_release(ZSTD_seekableShared* ss, seekableCacheEntry_t* entry)
+{
+    assert(entry->refs > 0);
+    if (--entry->refs) return;
+    if (ZSTD_isError(entry->result)) {
+        free(entry);  /* already out of the table */
+    } else {
+        ZSTD_seekableShared_evict(ss);
+    }
+}
+
+/* Get frame `frameIndex` from the cache, decoding it with `reader` if no other
+ * thread has it or is decoding it.  On success, *entryPtr holds a reference
+ * that must be dropped with ZSTD_seekableShared_release(). */
+static size_t ZSTD_seekableShared_acquire(ZSTD_seekableShared* ss, seekableReader_t* reader,
+                                          U32 frameIndex, seekableCacheEntry_t** entryPtr)
+{
+    seekableCacheEntry_t* entry;
+    size_t const dSize = (size_t)(ss->zs->seekTable.entries[frameIndex + 1].dOffset -
+                                  ss->zs->seekTable.entries[frameIndex].dOffset);
+    BYTE* data;
+    size_t result;
+
+    ZSTD_pthread_mutex_lock(&ss->mutex);
+    entry = ZSTD_seekableShared_find(ss, frameIndex);
+    if (entry != NULL) {
+        ss->hits++;
+        entry->refs++;
+        if (entry->done) {
+            ZSTD_seekableShared_lruUnlink(ss, entry);
+            ZSTD_seekableShared_lruPush(ss, entry);
+        }
+        while (!entry->done) ZSTD_pthread_cond_wait(&ss->cond, &ss->mutex);
+        result = entry->result;
+        if (ZSTD_isError(result)) ZSTD_seekableShared_release(ss, entry);
+        ZSTD_pthread_mutex_unlock(&ss->mutex);
+        *entryPtr = entry;
+        return result;
+    }
+    ss->misses++;
+    entry = (seekableCacheEntry_t*)calloc(1, sizeof(seekableCacheEntry_t));
+    if (entry == NULL) {
+        ZSTD_pthread_mutex_unlock(&ss->mutex);
+        return ERROR(memory_allocation);
+    }
+    entry->frameIndex = frameIndex;
+    entry->refs = 1;
+    ZSTD_seekableShared_hashInsert(ss, entry);
+    ZSTD_pthread_mutex_unlock(&ss->mutex);
+
+    data = (BYTE*)malloc(dSize ? dSize : 1);
+    result = data == NULL ? ERROR(memory_allocation)
+                          : ZSTD_seekableShared_decodeFrame(ss, reader, frameIndex, data);
+
+    ZSTD_pthread_mutex_lock(&ss->mutex);
+    entry->done = 1;
+    entry->result = result;
+    if (ZSTD_isError(result)) {
+        free(data);
+        ZSTD_seekableShared_hashRemove(ss, entry);
+        ZSTD_seekableShared_release(ss, entry);
+    } else {
+        entry->data = data;
+        entry->size = dSize;
+        ZSTD_seekableShared_lruPush(ss, entry);
+        ss->cachedBytes += dSize;
+        ss->cachedFrames++;
+    }
+    ZSTD_pthread_cond_broadcast(&ss->cond);
+    ZSTD_pthread_mutex_unlock(&ss->mutex);
+    *entryPtr = entry;
+    return result;
+}
+
+/* Copy [offset, offset + len) from frame `frameIndex` to dst.  Frames that
+ * don't fit in the cache, and frames that are wanted whole and are not
+ * cached already, are decoded without going through the cache, so that
+ * long sequential reads don't flush it. */
+static size_t ZSTD_seekableShared_readFrame(ZSTD_seekableShared* ss, seekableReader_t* reader,
+                                            U32 frameIndex, BYTE* dst, size_t len,
+                                            unsigned long long offset)
+{
+    seekEntry_t const* const entry = ss->zs->seekTable.entries + frameIndex;
+    size_t const dSize = (size_t)(entry[1].dOffset - entry[0].dOffset);
+    size_t const pos = (size_t)(offset - entry[0].dOffset);
+    int const whole = pos == 0 && len == dSize;
+
+    if (dSize > ss->cacheSize || whole) {
+        int cached = 0;
+        if (dSize <= ss->cacheSize) {
+            ZSTD_pthread_mutex_lock(&ss->mutex);
+            cached = ZSTD_seekableShared_find(ss, frameIndex) != NULL;
+            ZSTD_pthread_mutex_unlock(&ss->mutex);
+        }
+        if (!cached) {
+            BYTE* const tmp = whole ? dst : (BYTE*)malloc(dSize);
+            size_t result;
+            if (tmp == NULL) return ERROR(memory_allocation);
+            ZSTD_pthread_mutex_lock(&ss->mutex);
+            ss->misses++;
+            ZSTD_pthread_mutex_unlock(&ss->mutex);
+            result = ZSTD_seekableShared_decodeFrame(ss, reader, frameIndex, tmp);
+            if (!whole) {
+                if (!ZSTD_isError(result)) memcpy(dst, tmp + pos, len);
+                free(tmp);
+            }
+            return ZSTD_isError(result) ? result : 0;
+        }
+    }
+
+    {   seekableCacheEntry_t* cached = NULL;
+        size_t const result = ZSTD_seekableShared_acquire(ss, reader, frameIndex, &cached);
+        if (ZSTD_isError(result)) return result;
+        memcpy(dst, cached->data + pos, len);
+        ZSTD_pthread_mutex_lock(&ss->mutex);
+        ZSTD_seekableShared_release(ss, cached);
+        ZSTD_pthread_mutex_unlock(&ss->mutex);
+    }
+    return 0;
+}
+
+size_t ZSTD_seekableShared_decompress(ZSTD_seekableShared* ss, void* dst, size_t len, unsigned long long offset)
+{
+    const ZSTD_seekTable* const st = &ss->zs->seekTable;
+    unsigned long long const eos = st->entries[st->tableLen].dOffset;
+    seekableReader_t* reader;
+    size_t done = 0;
+    U32 frameIndex;
+
+    if (offset >= eos) return 0;
+    if (offset + len > eos) {
+        len = (size_t)(eos - offset);
+    }
+    reader = ZSTD_seekableShared_getReader(ss);
+    if (reader == NULL) return ERROR(memory_allocation);
+
+    frameIndex = ZSTD_seekTable_offsetToFrameIndex(st, offset);
+    while (done < len) {
+        unsigned long long const frameEnd = st->entries[frameIndex + 1].dOffset;
+        size_t const toCopy = (size_t)MIN(frameEnd - (offset + done), len - done);
+        size_t const err = ZSTD_seekableShared_readFrame(ss, reader, frameIndex,
+                                                         (BYTE*)dst + done, toCopy, offset + done);
+        if (ZSTD_isError(err)) {
+            ZSTD_seekableShared_releaseReader(ss, reader);
+            return err;
+        }
+        done += toCopy;
+        frameIndex++;
+    }
+    ZSTD_seekableShared_releaseReader(ss, reader);
+    return len;
+}
@@ -309,6 +309,81 @@ int POOL_tryAdd(POOL_ctx* ctx, POOL_function function, void* opaque)
     return 1;
 }
 
+size_t POOL_threadCount(POOL_ctx* ctx)
+{
+    size_t threadLimit;
+    if (ctx == NULL) return 0;
+    ZSTD_pthread_mutex_lock(&ctx->queueMutex);
+    threadLimit = ctx->threadLimit;
+    ZSTD_pthread_mutex_unlock(&ctx->queueMutex);
+    return threadLimit;
+}
+
+
+/* A job of POOL_runJobs(), which counts down the pending jobs once done */
+typedef struct {
+    POOL_function function;
+    void* opaque;
+    ZSTD_pthread_mutex_t* mutex;
+    ZSTD_pthread_cond_t* cond;
+    size_t* nbPending;
+} POOL_countedJob;
+
+static void POOL_runCountedJob(void* opaque)
+{
+    POOL_countedJob* const job = (POOL_countedJob*)opaque;
+    job->function(job->opaque);
+    ZSTD_pthread_mutex_lock(job->mutex);
+    if (--*job->nbPending == 0) ZSTD_pthread_cond_signal(job->cond);
+    ZSTD_pthread_mutex_unlock(job->mutex);
+}
+
+void POOL_runJobs(POOL_ctx* ctx, POOL_function function,
+                  void* jobs, size_t jobSize, size_t nbJobs)
+{
+    char* const start = (char*)jobs;
+    POOL_countedJob* counted = NULL;
+    ZSTD_pthread_mutex_t mutex;
+    ZSTD_pthread_cond_t cond;
+    size_t nbPending = nbJobs - 1;
+    size_t n;
+
+    if (nbJobs == 0) return;
+    if (ctx != NULL && nbJobs > 1)
+        counted = (POOL_countedJob*)ZSTD_customMalloc((nbJobs-1) * sizeof(POOL_countedJob), ctx->customMem);
+    if (counted != NULL && ZSTD_pthread_mutex_init(&mutex, NULL)) {
+        ZSTD_customFree(counted, ctx->customMem);
+        counted = NULL;
+    }
+    if (counted != NULL && ZSTD_pthread_cond_init(&cond, NULL)) {
+        ZSTD_pthread_mutex_destroy(&mutex);
+        ZSTD_customFree(counted, ctx->customMem);
+        counted = NULL;
+    }
+    if (counted == NULL) {
+        for (n = 0; n < nbJobs; n++) function(start + n * jobSize);
+        return;
+    }
+
+    for (n = 1; n < nbJobs; n++) {
+        POOL_countedJob* const job = counted + (n-1);
+        job->function = function;
+        job->opaque = start + n * jobSize;
+        job->mutex = &mutex;
+        job->cond = &cond;
+        job->nbPending = &nbPending;
+        POOL_add(ctx, POOL_runCountedJob, job);
+    }
+    function(start);
+
+    ZSTD_pthread_mutex_lock(&mutex);
+    while (nbPending > 0) ZSTD_pthread_cond_wait(&cond, &mutex);
+    ZSTD_pthread_mutex_unlock(&mutex);
+    ZSTD_pthread_cond_destroy(&cond);
+    ZSTD_pthread_mutex_destroy(&mutex);
+    ZSTD_customFree(counted, ctx->customMem);
+}
+
 
 #else  /* ZSTD_MULTITHREAD  not defined */
 
@@ -368,4 +443,16 @@ size_t POOL_sizeof(const POOL_ctx* ctx) {
     return sizeof(*ctx);
 }
 
+size_t POOL_threadCount(POOL_ctx* ctx) {
+    (void)ctx;
+    return 0;
+}
+
+void POOL_runJobs(POOL_ctx* ctx, POOL_function function,
+                  void* jobs, size_t jobSize, size_t nbJobs) {
+    size_t n;
+    (void)ctx;
+    for (n = 0; n < nbJobs; n++) function((char*)jobs + n * jobSize);
+}
+
 #endif  /* ZSTD_MULTITHREAD */
@@ -82,6 +82,22 @@ void POOL_add(POOL_ctx* ctx, POOL_function function, void* opaque);
  */
 int POOL_tryAdd(POOL_ctx* ctx, POOL_function function, void* opaque);
 
+/*! POOL_threadCount() :
+ * @return : the number of threads the pool currently runs jobs on,
+ *           or 0 when `ctx` is NULL or in single-threaded builds.
+ */
+size_t POOL_threadCount(POOL_ctx* ctx);
+
+/*! POOL_runJobs() :
+ *  Run `function` on each of the `nbJobs` objects of `jobSize` bytes
+ *  starting at `jobs`: the first one on the calling thread,
+ *  the others in the pool, and return once all of them are completed.
+ *  All jobs run on the calling thread when `ctx` is NULL,
+ *  or when the bookkeeping can't be allocated.
+ */
+void POOL_runJobs(POOL_ctx* ctx, POOL_function function,
+                  void* jobs, size_t jobSize, size_t nbJobs);
+
 
 #if defined (__cplusplus)
 }
@@ -385,6 +385,45 @@ MEM_STATIC int ZSTD_cpuSupportsBmi2(void)
     return ZSTD_cpuid_bmi1(cpuid) && ZSTD_cpuid_bmi2(cpuid);
 }
 
+/* Below this amount of input per thread,
+ * a batch isn't worth dispatching to a thread pool */
+#define ZSTD_BATCH_JOBSIZE_MIN (32 KB)
+
+/*! ZSTD_batchSplit() :
+ *  Split `buffers` into at most `nbJobsMax` contiguous ranges of similar total srcSize,
+ *  of at least ZSTD_BATCH_JOBSIZE_MIN bytes each, one range per job.
+ *  Job j covers buffers [starts[j], starts[j+1]) ; `starts` has room for nbJobsMax+1 values.
+ *  Used by: ZSTD_compressBatch(), ZSTD_decompressBatch()
+ * @return : the number of jobs, at least 1 */
+MEM_STATIC size_t ZSTD_batchSplit(const ZSTD_batchBuffer* buffers, size_t nbBuffers,
+                                  size_t nbJobsMax, size_t* starts)
+{
+    size_t total = 0;
+    size_t sum = 0;
+    size_t nbJobs, n, j = 1;
+    for (n = 0; n < nbBuffers; n++) total += buffers[n].srcSize;
+    nbJobs = MIN(MIN(nbJobsMax, nbBuffers), total / ZSTD_BATCH_JOBSIZE_MIN);
+    starts[0] = 0;
+    /* cut after each buffer which reaches the next share, but never after the last one */
+    for (n = 0; n + 1 < nbBuffers && j < nbJobs; n++) {
+        sum += buffers[n].srcSize;
+        if (sum >= total / nbJobs * j) starts[j++] = n + 1;
+    }
+    starts[j] = nbBuffers;
+    return j;
+}
+
+/*! ZSTD_batchResult() :
+ * @return : 0, or the error code of the first buffer of the batch which failed */
+MEM_STATIC size_t ZSTD_batchResult(const ZSTD_batchBuffer* buffers, size_t nbBuffers)
+{
+    size_t n;
+    for (n = 0; n < nbBuffers; n++) {
+        if (ZSTD_isError(buffers[n].result)) return buffers[n].result;
+    }
+    return 0;
+}
+
 #if defined (__cplusplus)
 }
 #endif
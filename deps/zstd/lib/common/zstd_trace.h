@@ -45,6 +45,12 @@ extern "C" {
 #  define ZSTD_TRACE ZSTD_HAVE_WEAK_SYMBOLS
 #endif
 
+/* Per-block decompression tracing reads a cycle counter around each phase
+ * of every compressed block, so it must be requested at compile time. */
+#ifndef ZSTD_TRACE_BLOCKS
+#  define ZSTD_TRACE_BLOCKS 0
+#endif
+
 #if ZSTD_TRACE
 
 struct ZSTD_CCtx_s;
@@ -154,6 +160,67 @@ ZSTD_WEAK_ATTR void ZSTD_trace_decompress_end(
     ZSTD_TraceCtx ctx,
     ZSTD_Trace const* trace);
 
+#if ZSTD_TRACE_BLOCKS
+
+typedef struct {
+    /**
+     * ZSTD_VERSION_NUMBER, first member as in ZSTD_Trace.
+     */
+    unsigned version;
+    /**
+     * How literals are encoded, as a symbolEncodingType_e :
+     * 0 raw, 1 RLE, 2 Huffman, 3 Huffman with the previous block's table.
+     */
+    unsigned literalsType;
+    /**
+     * Number of literals, and size of the literals section, header included.
+     */
+    size_t literalsSize;
+    size_t literalsSectionSize;
+    /**
+     * Number of sequences.
+     */
+    unsigned nbSequences;
+    /**
+     * Share of the offset decoding table producing offsets of more than 22 bits,
+     * out of 256 : the heuristic that selects the prefetching sequence decoder.
+     */
+    unsigned longOffsetShare;
+    /**
+     * Non-zero if the prefetching sequence decoder was used.
+     */
+    unsigned prefetchDecoder;
+    /**
+     * Bytes copied from earlier output by matches.
+     */
+    size_t matchSize;
+    /**
+     * The compressed and decompressed sizes of the block.
+     */
+    size_t compressedSize;
+    size_t uncompressedSize;
+    /**
+     * Timestamp counter ticks spent decoding literals, building the sequence
+     * decoding tables, and decoding and executing sequences. These last two
+     * are interleaved and can't be timed apart.
+     * All zero where no timestamp counter is cheaply readable.
+     */
+    unsigned long long literalsCycles;
+    unsigned long long tablesCycles;
+    unsigned long long sequencesCycles;
+} ZSTD_TraceBlock;
+
+/**
+ * Trace a compressed block, while tracing the decompression it belongs to.
+ * @param ctx The return value of ZSTD_trace_decompress_begin().
+ * @param block The block tracing info.
+ */
+ZSTD_WEAK_ATTR void ZSTD_trace_decompress_block(
+    ZSTD_TraceCtx ctx,
+    ZSTD_TraceBlock const* block);
+
+#endif /* ZSTD_TRACE_BLOCKS */
+
 #endif /* ZSTD_TRACE */
 
 #if defined (__cplusplus)
@@ -18,6 +18,7 @@
 #define FSE_STATIC_LINKING_ONLY   /* FSE_encodeSymbol */
 #include "../common/fse.h"
 #include "../common/huf.h"
+#include "../common/pool.h"      /* POOL_threadCount, POOL_runJobs */
 #include "zstd_compress_internal.h"
 #include "zstd_compress_sequences.h"
 #include "zstd_compress_literals.h"
@@ -172,6 +173,11 @@ static void ZSTD_freeCCtxContent(ZSTD_CCtx* cctx)
     ZSTD_clearAllDicts(cctx);
 #ifdef ZSTD_MULTITHREAD
     ZSTDMT_freeCCtx(cctx->mtctx); cctx->mtctx = NULL;
+    {   size_t n;
+        for (n = 0; n < cctx->nbBatchCCtxs; n++) ZSTD_freeCCtx(cctx->batchCCtxs[n]);
+        ZSTD_customFree(cctx->batchCCtxs, cctx->customMem);
+        cctx->batchCCtxs = NULL; cctx->nbBatchCCtxs = 0;
+    }
 #endif
     ZSTD_cwksp_free(&cctx->workspace, cctx->customMem);
 }
@@ -193,7 +199,10 @@ size_t ZSTD_freeCCtx(ZSTD_CCtx* cctx)
 static size_t ZSTD_sizeof_mtctx(const ZSTD_CCtx* cctx)
 {
 #ifdef ZSTD_MULTITHREAD
-    return ZSTDMT_sizeof_CCtx(cctx->mtctx);
+    size_t batchSize = cctx->nbBatchCCtxs * sizeof(ZSTD_CCtx*);
+    size_t n;
+    for (n = 0; n < cctx->nbBatchCCtxs; n++) batchSize += ZSTD_sizeof_CCtx(cctx->batchCCtxs[n]);
+    return ZSTDMT_sizeof_CCtx(cctx->mtctx) + batchSize;
 #else
     (void)cctx;
     return 0;
@@ -512,6 +521,15 @@ ZSTD_bounds ZSTD_cParam_getBounds(ZSTD_cParameter param)
 #endif
         return bounds;
 
+    case ZSTD_c_maxMemory:
+        bounds.lowerBound = 0;
+#ifdef ZSTD_MULTITHREAD
+        bounds.upperBound = INT_MAX;
+#else
+        bounds.upperBound = 0;
+#endif
+        return bounds;
+
     case ZSTD_c_enableDedicatedDictSearch:
         bounds.lowerBound = 0;
         bounds.upperBound = 1;
@@ -679,6 +697,7 @@ static int ZSTD_isUpdateAuthorized(ZSTD_cParameter param)
     case ZSTD_c_jobSize:
     case ZSTD_c_overlapLog:
     case ZSTD_c_rsyncable:
+    case ZSTD_c_maxMemory:
     case ZSTD_c_enableDedicatedDictSearch:
     case ZSTD_c_enableLongDistanceMatching:
     case ZSTD_c_ldmHashLog:
@@ -741,6 +760,7 @@ size_t ZSTD_CCtx_setParameter(ZSTD_CCtx* cctx, ZSTD_cParameter param, int value)
     case ZSTD_c_jobSize:
     case ZSTD_c_overlapLog:
     case ZSTD_c_rsyncable:
+    case ZSTD_c_maxMemory:
     case ZSTD_c_enableDedicatedDictSearch:
     case ZSTD_c_enableLongDistanceMatching:
     case ZSTD_c_ldmHashLog:
@@ -906,6 +926,16 @@ size_t ZSTD_CCtxParams_setParameter(ZSTD_CCtx_params* CCtxParams,
         return CCtxParams->rsyncable;
 #endif
 
+    case ZSTD_c_maxMemory :
+#ifndef ZSTD_MULTITHREAD
+        RETURN_ERROR_IF(value!=0, parameter_unsupported, "not compiled with multithreading");
+        return 0;
+#else
+        FORWARD_IF_ERROR(ZSTD_cParam_clampBounds(ZSTD_c_maxMemory, &value), "");
+        CCtxParams->maxMemory = value;
+        return (size_t)CCtxParams->maxMemory;
+#endif
+
     case ZSTD_c_enableDedicatedDictSearch :
         CCtxParams->enableDedicatedDictSearch = (value!=0);
         return (size_t)CCtxParams->enableDedicatedDictSearch;
@@ -1093,6 +1123,13 @@ size_t ZSTD_CCtxParams_getParameter(
 #else
         *value = CCtxParams->rsyncable;
         break;
+#endif
+    case ZSTD_c_maxMemory :
+#ifndef ZSTD_MULTITHREAD
+        RETURN_ERROR(parameter_unsupported, "not compiled with multithreading");
+#else
+        *value = CCtxParams->maxMemory;
+        break;
 #endif
     case ZSTD_c_enableDedicatedDictSearch :
         *value = CCtxParams->enableDedicatedDictSearch;
@@ -6169,6 +6206,31 @@ static size_t ZSTD_checkBufferStability(ZSTD_CCtx const* cctx,
     return 0;
 }
 
+/* ZSTD_CCtx_resolveFrameParams() :
+ * select the compression parameters of a frame of `pledgedSrcSize` bytes
+ * with `cdict` or `prefixDict`, and resolve the modes which depend on them */
+static void ZSTD_CCtx_resolveFrameParams(ZSTD_CCtx_params* params,
+                                         const ZSTD_CDict* cdict,
+                                         const ZSTD_prefixDict* prefixDict,
+                                         U64 pledgedSrcSize)
+{
+    {   size_t const dictSize = prefixDict->dict
+                ? prefixDict->dictSize
+                : (cdict ? cdict->dictContentSize : 0);
+        ZSTD_cParamMode_e const mode = ZSTD_getCParamMode(cdict, params, pledgedSrcSize);
+        params->cParams = ZSTD_getCParamsFromCCtxParams(
+                params, pledgedSrcSize,
+                dictSize, mode);
+    }
+
+    params->useBlockSplitter = ZSTD_resolveBlockSplitterMode(params->useBlockSplitter, &params->cParams);
+    params->ldmParams.enableLdm = ZSTD_resolveEnableLdm(params->ldmParams.enableLdm, &params->cParams);
+    params->useRowMatchFinder = ZSTD_resolveRowMatchFinderMode(params->useRowMatchFinder, &params->cParams);
+    params->validateSequences = ZSTD_resolveExternalSequenceValidation(params->validateSequences);
+    params->maxBlockSize = ZSTD_resolveMaxBlockSize(params->maxBlockSize);
+    params->searchForExternalRepcodes = ZSTD_resolveExternalRepcodeSearch(params->searchForExternalRepcodes, params->compressionLevel);
+}
+
 static size_t ZSTD_CCtx_init_compressStream2(ZSTD_CCtx* cctx,
                                              ZSTD_EndDirective endOp,
                                              size_t inSize)
@@ -6188,21 +6250,7 @@ static size_t ZSTD_CCtx_init_compressStream2(ZSTD_CCtx* cctx,
     DEBUGLOG(4, "ZSTD_compressStream2 : transparent init stage");
     if (endOp == ZSTD_e_end) cctx->pledgedSrcSizePlusOne = inSize + 1;  /* auto-determine pledgedSrcSize */
 
-    {   size_t const dictSize = prefixDict.dict
-                ? prefixDict.dictSize
-                : (cctx->cdict ? cctx->cdict->dictContentSize : 0);
-        ZSTD_cParamMode_e const mode = ZSTD_getCParamMode(cctx->cdict, &params, cctx->pledgedSrcSizePlusOne - 1);
-        params.cParams = ZSTD_getCParamsFromCCtxParams(
-                &params, cctx->pledgedSrcSizePlusOne-1,
-                dictSize, mode);
-    }
-
-    params.useBlockSplitter = ZSTD_resolveBlockSplitterMode(params.useBlockSplitter, &params.cParams);
-    params.ldmParams.enableLdm = ZSTD_resolveEnableLdm(params.ldmParams.enableLdm, &params.cParams);
-    params.useRowMatchFinder = ZSTD_resolveRowMatchFinderMode(params.useRowMatchFinder, &params.cParams);
-    params.validateSequences = ZSTD_resolveExternalSequenceValidation(params.validateSequences);
-    params.maxBlockSize = ZSTD_resolveMaxBlockSize(params.maxBlockSize);
-    params.searchForExternalRepcodes = ZSTD_resolveExternalRepcodeSearch(params.searchForExternalRepcodes, params.compressionLevel);
+    ZSTD_CCtx_resolveFrameParams(&params, cctx->cdict, &prefixDict, cctx->pledgedSrcSizePlusOne-1);
 
 #ifdef ZSTD_MULTITHREAD
     /* If external matchfinder is enabled, make sure to fail before checking job size (for consistency) */
@@ -6419,6 +6467,118 @@ size_t ZSTD_compress2(ZSTD_CCtx* cctx,
     }
 }
 
+/*=====   Batches of small messages   =====*/
+
+typedef struct {
+    ZSTD_CCtx* cctx;
+    const ZSTD_CCtx_params* params;
+    const ZSTD_CDict* cdict;
+    const ZSTD_prefixDict* prefixDict;
+    ZSTD_batchBuffer* buffers;
+    size_t nbBuffers;
+} ZSTD_compressBatchJob;
+
+static size_t ZSTD_compressBatchBuffer(const ZSTD_compressBatchJob* job, const ZSTD_batchBuffer* buffer)
+{
+    ZSTD_CCtx_params params = *job->params;
+    ZSTD_CCtx_resolveFrameParams(&params, job->cdict, job->prefixDict, buffer->srcSize);
+    FORWARD_IF_ERROR( ZSTD_compressBegin_internal(job->cctx,
+            job->prefixDict->dict, job->prefixDict->dictSize, job->prefixDict->dictContentType, ZSTD_dtlm_fast,
+            job->cdict,
+            &params, buffer->srcSize,
+            ZSTDb_not_buffered) , "");
+    return ZSTD_compressEnd_public(job->cctx, buffer->dst, buffer->dstCapacity, buffer->src, buffer->srcSize);
+}
+
+static void ZSTD_compressBatchJob_run(void* opaque)
+{
+    ZSTD_compressBatchJob* const job = (ZSTD_compressBatchJob*)opaque;
+    size_t n;
+    for (n = 0; n < job->nbBuffers; n++) {
+        job->buffers[n].result = ZSTD_compressBatchBuffer(job, job->buffers + n);
+    }
+}
+
+#ifdef ZSTD_MULTITHREAD
+/* ZSTD_CCtx_reserveBatchCCtxs() :
+ * make sure cctx keeps at least `nbCCtxs` contexts for batch jobs */
+static size_t ZSTD_CCtx_reserveBatchCCtxs(ZSTD_CCtx* cctx, size_t nbCCtxs)
+{
+    if (nbCCtxs > cctx->nbBatchCCtxs) {
+        ZSTD_CCtx** const cctxs = (ZSTD_CCtx**)ZSTD_customCalloc(nbCCtxs * sizeof(ZSTD_CCtx*), cctx->customMem);
+        RETURN_ERROR_IF(cctxs == NULL, memory_allocation, "");
+        if (cctx->nbBatchCCtxs)
+            ZSTD_memcpy(cctxs, cctx->batchCCtxs, cctx->nbBatchCCtxs * sizeof(ZSTD_CCtx*));
+        ZSTD_customFree(cctx->batchCCtxs, cctx->customMem);
+        cctx->batchCCtxs = cctxs;
+        for ( ; cctx->nbBatchCCtxs < nbCCtxs; cctx->nbBatchCCtxs++) {
+            cctxs[cctx->nbBatchCCtxs] = ZSTD_createCCtx_advanced(cctx->customMem);
+            RETURN_ERROR_IF(cctxs[cctx->nbBatchCCtxs] == NULL, memory_allocation, "");
+        }
+    }
+    return 0;
+}
+#endif
+
+size_t ZSTD_compressBatch(ZSTD_CCtx* cctx, ZSTD_batchBuffer* buffers, size_t nbBuffers)
+{
+    ZSTD_CCtx_params params = cctx->requestedParams;
+    ZSTD_prefixDict const prefixDict = cctx->prefixDict;
+    ZSTD_compressBatchJob job;
+    DEBUGLOG(4, "ZSTD_compressBatch (nbBuffers=%u)", (unsigned)nbBuffers);
+    ZSTD_CCtx_reset(cctx, ZSTD_reset_session_only);
+    FORWARD_IF_ERROR( ZSTD_initLocalDict(cctx) , ""); /* Init the local dict if present. */
+    ZSTD_memset(&cctx->prefixDict, 0, sizeof(cctx->prefixDict));   /* single usage */
+    assert(prefixDict.dict==NULL || cctx->cdict==NULL);    /* only one can be set */
+    if (cctx->cdict && !cctx->localDict.cdict) {
+        /* same as ZSTD_CCtx_init_compressStream2() */
+        params.compressionLevel = cctx->cdict->compressionLevel;
+    }
+    params.nbWorkers = 0;   /* each message is compressed by a single thread */
+
+    job.cctx = cctx;
+    job.params = &params;
+    job.cdict = cctx->cdict;
+    job.prefixDict = &prefixDict;
+    job.buffers = buffers;
+    job.nbBuffers = nbBuffers;
+
+#ifdef ZSTD_MULTITHREAD
+    {   size_t nbJobsMax = 1;
+        if (cctx->pool != NULL && cctx->staticSize == 0) {
+            RETURN_ERROR_IF(params.useSequenceProducer == 1, parameter_combination_unsupported,
+                            "External sequence producer isn't supported with a thread pool");
+            nbJobsMax += POOL_threadCount(cctx->pool);
+        }
+        if (nbJobsMax > 1 && nbBuffers > 1) {
+            ZSTD_compressBatchJob* const jobs = (ZSTD_compressBatchJob*)ZSTD_customMalloc(
+                    nbJobsMax * sizeof(ZSTD_compressBatchJob) + (nbJobsMax+1) * sizeof(size_t), cctx->customMem);
+            size_t* const starts = (size_t*)(void*)(jobs + nbJobsMax);
+            size_t nbJobs, j;
+            RETURN_ERROR_IF(jobs == NULL, memory_allocation, "");
+            nbJobs = ZSTD_batchSplit(buffers, nbBuffers, nbJobsMax, starts);
+            {   size_t const err = ZSTD_CCtx_reserveBatchCCtxs(cctx, nbJobs-1);
+                if (ZSTD_isError(err)) {
+                    ZSTD_customFree(jobs, cctx->customMem);
+                    return err;
+            }   }
+            DEBUGLOG(4, "ZSTD_compressBatch: %u jobs", (unsigned)nbJobs);
+            for (j = 0; j < nbJobs; j++) {
+                jobs[j] = job;
+                jobs[j].cctx = j ? cctx->batchCCtxs[j-1] : cctx;
+                jobs[j].buffers = buffers + starts[j];
+                jobs[j].nbBuffers = starts[j+1] - starts[j];
+            }
+            POOL_runJobs(cctx->pool, ZSTD_compressBatchJob_run, jobs, sizeof(ZSTD_compressBatchJob), nbJobs);
+            ZSTD_customFree(jobs, cctx->customMem);
+            return ZSTD_batchResult(buffers, nbBuffers);
+        }
+    }
+#endif
+    ZSTD_compressBatchJob_run(&job);
+    return ZSTD_batchResult(buffers, nbBuffers);
+}
+
 /* ZSTD_validateSequence() :
  * @offCode : is presumed to follow format required by ZSTD_storeSeq()
  * @returns a ZSTD error code if sequence is not valid
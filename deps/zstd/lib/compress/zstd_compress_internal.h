@@ -326,6 +326,7 @@ struct ZSTD_CCtx_params_s {
     size_t jobSize;
     int overlapLog;
     int rsyncable;
+    int maxMemory;             /* in KB, 0 means no budget */
 
     /* Long distance matching parameters */
     ldmParams_t ldmParams;
@@ -469,6 +470,8 @@ struct ZSTD_CCtx_s {
     /* Multi-threading */
 #ifdef ZSTD_MULTITHREAD
     ZSTDMT_CCtx* mtctx;
+    ZSTD_CCtx** batchCCtxs;   /* contexts of the ZSTD_compressBatch() jobs run in the pool */
+    size_t nbBatchCCtxs;
 #endif
 
     /* Tracing */
@@ -851,7 +851,15 @@ struct ZSTDMT_CCtx_s {
     ZSTD_CCtx_params params;
     size_t targetSectionSize;
     size_t targetPrefixSize;
+    size_t minSectionSize;   /* bounds of targetSectionSize while it adapts to the memory budget */
+    size_t maxSectionSize;
+    size_t jobCCtxSize;      /* estimated size of the CCtx of a job */
+    unsigned maxJobsInFlight;
+    unsigned prevMaxJobsInFlight;   /* still applies while jobs from before the last size change are in flight */
+    unsigned sizeChangeJobID;
     int jobReady;        /* 1 => one job is already prepared, but pool has shortage of workers. Don't create a new job. */
+    int jobThrottled;    /* 1 => a job was held back by maxJobsInFlight since last job creation */
+    unsigned nbDrainedJobs;   /* consecutive jobs created while no other job was in flight */
     inBuff_t inBuff;
     roundBuff_t roundBuff;
     serialState_t serial;
@@ -1221,6 +1229,119 @@ static size_t ZSTDMT_computeOverlapSize(const ZSTD_CCtx_params* params)
     return (ovLog==0) ? 0 : (size_t)1 << ovLog;
 }
 
+/* ZSTDMT_roundBuffSize() :
+ * @return : round buffer capacity needed to fill `nbJobs` jobs of `sectionSize` bytes */
+static size_t ZSTDMT_roundBuffSize(const ZSTDMT_CCtx* mtctx, size_t sectionSize, unsigned nbJobs)
+{
+    /* If ldm is enabled we need windowSize space. */
+    size_t const windowSize = mtctx->params.ldmParams.enableLdm == ZSTD_ps_enable ? (1U << mtctx->params.cParams.windowLog) : 0;
+    /* Two buffers of slack, plus extra space for the overlap
+     * This is the minimum slack that LDM works with. One extra because
+     * flush might waste up to targetSectionSize-1 bytes. Another extra
+     * for the overlap (if > 0), then one to fill which doesn't overlap
+     * with the LDM window.
+     */
+    size_t const nbSlackBuffers = 2 + (mtctx->targetPrefixSize > 0);
+    size_t const slackSize = sectionSize * nbSlackBuffers;
+    /* Compute the total size, and always have enough slack */
+    size_t const sectionsSize = sectionSize * MAX(nbJobs, 1);
+    return MAX(windowSize, sectionsSize) + slackSize;
+}
+
+/* ZSTDMT_maxJobsInFlight() :
+ * Memory of a job in flight is its dst buffer, the CCtx compressing it, and its LDM sequences.
+ * When `roundBuffCapacity` is not 0, the round buffer is already allocated, and jobs must fit in it.
+ * @return : largest number of jobs of `sectionSize` bytes, up to nbWorkers,
+ *           that fit within the memory budget, or 0 if not even one does */
+static unsigned ZSTDMT_maxJobsInFlight(const ZSTDMT_CCtx* mtctx, size_t sectionSize, size_t roundBuffCapacity)
+{
+    U64 const budget = (U64)mtctx->params.maxMemory << 10;
+    unsigned const nbWorkers = (unsigned)MAX(mtctx->params.nbWorkers, 1);
+    ldmParams_t ldmParams = mtctx->params.ldmParams;
+    U64 fixedSize, jobSize;
+    unsigned nbJobs;
+    if (ldmParams.enableLdm == ZSTD_ps_enable)
+        ZSTD_ldm_adjustParameters(&ldmParams, &mtctx->params.cParams);   /* as the serial state does */
+    fixedSize = sizeof(*mtctx) + POOL_sizeof(mtctx->factory)
+              + (mtctx->jobIDMask+1) * sizeof(ZSTDMT_jobDescription)
+              + ZSTD_ldm_getTableSize(ldmParams) + ZSTD_sizeof_CDict(mtctx->cdictLocal);
+    jobSize = mtctx->jobCCtxSize + ZSTD_compressBound(sectionSize)
+            + ZSTD_ldm_getMaxNbSeq(ldmParams, sectionSize) * sizeof(rawSeq);
+    for (nbJobs = 1; nbJobs <= nbWorkers; nbJobs++) {
+        size_t const roundBuffSize = ZSTDMT_roundBuffSize(mtctx, sectionSize, nbJobs);
+        if (roundBuffCapacity && roundBuffSize > roundBuffCapacity) break;
+        if (fixedSize + MAX(roundBuffSize, roundBuffCapacity) + nbJobs * jobSize > budget) break;
+    }
+    return nbJobs - 1;
+}
+
+/* ZSTDMT_fitMemoryBudget() :
+ * Select the number of jobs in flight, and the size they start from, within the memory budget.
+ * Job size can only adapt when it is not set by the user, nor tied to rsyncable synchronization points. */
+static void ZSTDMT_fitMemoryBudget(ZSTDMT_CCtx* mtctx)
+{
+    ZSTD_CCtx_params jobParams = mtctx->params;
+    size_t sectionSize = mtctx->targetSectionSize;
+    jobParams.nbWorkers = 0;
+    jobParams.ldmParams.enableLdm = ZSTD_ps_disable;   /* LDM runs in the serial state, not in jobs */
+    {   size_t const cctxSize = ZSTD_estimateCCtxSize_usingCCtxParams(&jobParams);
+        mtctx->jobCCtxSize = ZSTD_isError(cctxSize) ? 0 : cctxSize;
+    }
+    if (mtctx->params.jobSize == 0 && !mtctx->params.rsyncable)
+        mtctx->minSectionSize = MIN(sectionSize, MAX((size_t)ZSTDMT_JOBSIZE_MIN, 2 * mtctx->targetPrefixSize));
+    while ( (ZSTDMT_maxJobsInFlight(mtctx, sectionSize, 0) == 0)
+         && (sectionSize / 2 >= mtctx->minSectionSize) ) {
+        sectionSize /= 2;
+    }
+    mtctx->targetSectionSize = mtctx->maxSectionSize = sectionSize;
+    mtctx->maxJobsInFlight = MAX(ZSTDMT_maxJobsInFlight(mtctx, sectionSize, 0), 1);
+    DEBUGLOG(4, "memory budget %u KB : %u jobs of %u KB in flight (CCtx : %u KB)",
+                (U32)mtctx->params.maxMemory, mtctx->maxJobsInFlight,
+                (U32)(sectionSize >> 10), (U32)(mtctx->jobCCtxSize >> 10));
+}
+
+#define ZSTDMT_GROW_DRAINED_JOBS 4
+
+/* ZSTDMT_adaptSectionSize() :
+ * Invoked between two jobs, while the input buffer is empty.
+ * When the budget held back a job while some workers were idle,
+ * smaller jobs let more of them run within the same memory.
+ * When workers drained all jobs before each of the last few ones was filled,
+ * input is the bottleneck, and jobs grow back, since larger jobs compress better. */
+static void ZSTDMT_adaptSectionSize(ZSTDMT_CCtx* mtctx)
+{
+    size_t const sectionSize = mtctx->targetSectionSize;
+    size_t newSectionSize = sectionSize;
+    if (mtctx->minSectionSize == mtctx->maxSectionSize) return;   /* fixed job size */
+    if (mtctx->jobThrottled) {
+        if ( (mtctx->maxJobsInFlight < (unsigned)mtctx->params.nbWorkers)
+          && (sectionSize / 2 >= mtctx->minSectionSize)
+          && (ZSTDMT_maxJobsInFlight(mtctx, sectionSize / 2, mtctx->roundBuff.capacity) > mtctx->maxJobsInFlight) )
+            newSectionSize = sectionSize / 2;
+        mtctx->nbDrainedJobs = 0;
+    } else if (mtctx->doneJobID == mtctx->nextJobID) {
+        if ( (++mtctx->nbDrainedJobs >= ZSTDMT_GROW_DRAINED_JOBS)
+          && (sectionSize < mtctx->maxSectionSize) ) {
+            newSectionSize = sectionSize * 2;
+            mtctx->nbDrainedJobs = 0;
+        }
+    } else {
+        mtctx->nbDrainedJobs = 0;
+    }
+    mtctx->jobThrottled = 0;
+    if (newSectionSize != sectionSize) {
+        mtctx->prevMaxJobsInFlight = (mtctx->doneJobID < mtctx->sizeChangeJobID) ?
+                                     MIN(mtctx->prevMaxJobsInFlight, mtctx->maxJobsInFlight) :
+                                     mtctx->maxJobsInFlight;
+        mtctx->sizeChangeJobID = mtctx->nextJobID + 1;   /* the job being created still has the previous size */
+        mtctx->targetSectionSize = newSectionSize;
+        mtctx->maxJobsInFlight = MAX(ZSTDMT_maxJobsInFlight(mtctx, newSectionSize, mtctx->roundBuff.capacity), 1);
+        ZSTDMT_setBufferSize(mtctx->bufPool, ZSTD_compressBound(newSectionSize));
+        DEBUGLOG(4, "ZSTDMT_adaptSectionSize: %u jobs of %u KB in flight",
+                    mtctx->maxJobsInFlight, (U32)(newSectionSize >> 10));
+    }
+}
+
 /* ====================================== */
 /* =======      Streaming API     ======= */
 /* ====================================== */
@@ -1289,25 +1410,20 @@ size_t ZSTDMT_initCStream_internal(
         mtctx->rsync.primePower = ZSTD_rollingHash_primePower(RSYNC_LENGTH);
     }
     if (mtctx->targetSectionSize < mtctx->targetPrefixSize) mtctx->targetSectionSize = mtctx->targetPrefixSize;  /* job size must be >= overlap size */
+    mtctx->minSectionSize = mtctx->maxSectionSize = mtctx->targetSectionSize;
+    mtctx->maxJobsInFlight = mtctx->jobIDMask + 1;   /* without budget, only the jobs table limits jobs in flight */
+    mtctx->sizeChangeJobID = 0;
+    mtctx->jobThrottled = 0;
+    mtctx->nbDrainedJobs = 0;
+    if (params.maxMemory) ZSTDMT_fitMemoryBudget(mtctx);
     DEBUGLOG(4, "Job Size : %u KB (note : set to %u)", (U32)(mtctx->targetSectionSize>>10), (U32)params.jobSize);
     DEBUGLOG(4, "inBuff Size : %u KB", (U32)(mtctx->targetSectionSize>>10));
     ZSTDMT_setBufferSize(mtctx->bufPool, ZSTD_compressBound(mtctx->targetSectionSize));
-    {
-        /* If ldm is enabled we need windowSize space. */
-        size_t const windowSize = mtctx->params.ldmParams.enableLdm == ZSTD_ps_enable ? (1U << mtctx->params.cParams.windowLog) : 0;
-        /* Two buffers of slack, plus extra space for the overlap
-         * This is the minimum slack that LDM works with. One extra because
-         * flush might waste up to targetSectionSize-1 bytes. Another extra
-         * for the overlap (if > 0), then one to fill which doesn't overlap
-         * with the LDM window.
-         */
-        size_t const nbSlackBuffers = 2 + (mtctx->targetPrefixSize > 0);
-        size_t const slackSize = mtctx->targetSectionSize * nbSlackBuffers;
-        /* Compute the total size, and always have enough slack */
-        size_t const nbWorkers = MAX(mtctx->params.nbWorkers, 1);
-        size_t const sectionsSize = mtctx->targetSectionSize * nbWorkers;
-        size_t const capacity = MAX(windowSize, sectionsSize) + slackSize;
-        if (mtctx->roundBuff.capacity < capacity) {
+    {   unsigned const nbJobs = MIN((unsigned)mtctx->params.nbWorkers, mtctx->maxJobsInFlight);
+        size_t const capacity = ZSTDMT_roundBuffSize(mtctx, mtctx->targetSectionSize, nbJobs);
+        /* within a budget, an oversized round buffer is not kept around */
+        if ( (mtctx->roundBuff.capacity < capacity)
+          || (params.maxMemory && mtctx->roundBuff.capacity > capacity) ) {
             if (mtctx->roundBuff.buffer)
                 ZSTD_customFree(mtctx->roundBuff.buffer, mtctx->cMem);
             mtctx->roundBuff.buffer = (BYTE*)ZSTD_customMalloc(capacity, mtctx->cMem);
@@ -1370,6 +1486,17 @@ static size_t ZSTDMT_createCompressionJob(ZSTDMT_CCtx* mtctx, size_t srcSize, ZS
         return 0;
     }
 
+    {   /* jobs of the previous size still hold their memory */
+        unsigned const maxJobsInFlight = (mtctx->doneJobID < mtctx->sizeChangeJobID) ?
+                                         MIN(mtctx->maxJobsInFlight, mtctx->prevMaxJobsInFlight) :
+                                         mtctx->maxJobsInFlight;
+        if (mtctx->nextJobID - mtctx->doneJobID >= maxJobsInFlight) {
+            DEBUGLOG(5, "ZSTDMT_createCompressionJob: will not create new job : %u jobs in flight fill the memory budget",
+                        maxJobsInFlight);
+            mtctx->jobThrottled = 1;
+            return 0;
+    }   }
+
     if (!mtctx->jobReady) {
         BYTE const* src = (BYTE const*)mtctx->inBuff.buffer.start;
         DEBUGLOG(5, "ZSTDMT_createCompressionJob: preparing job %u to compress %u bytes with %u preload ",
@@ -1398,6 +1525,7 @@ static size_t ZSTDMT_createCompressionJob(ZSTDMT_CCtx* mtctx, size_t srcSize, ZS
         mtctx->roundBuff.pos += srcSize;
         mtctx->inBuff.buffer = g_nullBuffer;
         mtctx->inBuff.filled = 0;
+        ZSTDMT_adaptSectionSize(mtctx);
         /* Set the prefix */
         if (!endFrame) {
             size_t const newPrefixSize = MIN(srcSize, mtctx->targetPrefixSize);
@@ -1509,7 +1637,13 @@ static size_t ZSTDMT_flushProduced(ZSTDMT_CCtx* mtctx, ZSTD_outBuffer* output, u
               && (mtctx->jobs[wJobID].dstFlushed == cSize) ) {   /* output buffer fully flushed => free this job position */
                 DEBUGLOG(5, "Job %u completed (%u bytes), moving to next one",
                         mtctx->doneJobID, (U32)mtctx->jobs[wJobID].dstFlushed);
-                ZSTDMT_releaseBuffer(mtctx->bufPool, mtctx->jobs[wJobID].dstBuff);
+                if ( mtctx->params.maxMemory
+                  && (mtctx->jobs[wJobID].dstBuff.capacity > ZSTD_compressBound(mtctx->targetSectionSize)) ) {
+                    /* sized for larger jobs than current ones : don't keep it within the budget */
+                    ZSTD_customFree(mtctx->jobs[wJobID].dstBuff.start, mtctx->cMem);
+                } else {
+                    ZSTDMT_releaseBuffer(mtctx->bufPool, mtctx->jobs[wJobID].dstBuff);
+                }
                 DEBUGLOG(5, "dstBuffer released");
                 mtctx->jobs[wJobID].dstBuff = g_nullBuffer;
                 mtctx->jobs[wJobID].cSize = 0;   /* ensure this job slot is considered "not started" in future check */
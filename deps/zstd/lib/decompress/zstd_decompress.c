@@ -62,6 +62,7 @@
 #include "../common/fse.h"
 #include "../common/huf.h"
 #include "../common/xxhash.h" /* XXH64_reset, XXH64_update, XXH64_digest, XXH64 */
+#include "../common/pool.h"   /* POOL_threadCount, POOL_runJobs */
 #include "../common/zstd_internal.h"  /* blockProperties_t */
 #include "zstd_decompress_internal.h"   /* ZSTD_DCtx */
 #include "zstd_ddict.h"  /* ZSTD_DDictDictContent */
@@ -219,10 +220,14 @@ static size_t ZSTD_DDictHashSet_addDDict(ZSTD_DDictHashSet* hashSet, const ZSTD_
 ***************************************************************/
 size_t ZSTD_sizeof_DCtx (const ZSTD_DCtx* dctx)
 {
+    size_t batchSize, n;
     if (dctx==NULL) return 0;   /* support sizeof NULL */
+    batchSize = dctx->nbBatchDCtxs * sizeof(ZSTD_DCtx*);
+    for (n = 0; n < dctx->nbBatchDCtxs; n++) batchSize += ZSTD_sizeof_DCtx(dctx->batchDCtxs[n]);
     return sizeof(*dctx)
            + ZSTD_sizeof_DDict(dctx->ddictLocal)
-           + dctx->inBuffSize + dctx->outBuffSize;
+           + dctx->inBuffSize + dctx->outBuffSize
+           + batchSize;
 }
 
 size_t ZSTD_estimateDCtxSize(void) { return sizeof(ZSTD_DCtx); }
@@ -271,6 +276,9 @@ static void ZSTD_initDCtx_internal(ZSTD_DCtx* dctx)
     dctx->bmi2 = ZSTD_cpuSupportsBmi2();
 #endif
     dctx->ddictSet = NULL;
+    dctx->pool = NULL;
+    dctx->batchDCtxs = NULL;
+    dctx->nbBatchDCtxs = 0;
     ZSTD_DCtx_resetParameters(dctx);
 #ifdef FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
     dctx->dictContentEndForFuzzing = NULL;
@@ -336,6 +344,10 @@ size_t ZSTD_freeDCtx(ZSTD_DCtx* dctx)
             ZSTD_freeDDictHashSet(dctx->ddictSet, cMem);
             dctx->ddictSet = NULL;
         }
+        {   size_t n;
+            for (n = 0; n < dctx->nbBatchDCtxs; n++) ZSTD_freeDCtx(dctx->batchDCtxs[n]);
+            ZSTD_customFree(dctx->batchDCtxs, cMem);
+        }
         ZSTD_customFree(dctx, cMem);
         return 0;
     }
@@ -1184,6 +1196,103 @@ size_t ZSTD_decompressDCtx(ZSTD_DCtx* dctx, void* dst, size_t dstCapacity, const
 }
 
 
+
+/*=====   Batches of small messages   =====*/
+
+typedef struct {
+    ZSTD_DCtx* dctx;
+    const ZSTD_DDict* ddict;
+    ZSTD_batchBuffer* buffers;
+    size_t nbBuffers;
+} ZSTD_decompressBatchJob;
+
+static void ZSTD_decompressBatchJob_run(void* opaque)
+{
+    ZSTD_decompressBatchJob* const job = (ZSTD_decompressBatchJob*)opaque;
+    size_t n;
+    for (n = 0; n < job->nbBuffers; n++) {
+        ZSTD_batchBuffer* const buffer = job->buffers + n;
+        buffer->result = ZSTD_decompress_usingDDict(job->dctx,
+                                buffer->dst, buffer->dstCapacity,
+                                buffer->src, buffer->srcSize,
+                                job->ddict);
+    }
+}
+
+#ifdef ZSTD_MULTITHREAD
+/* ZSTD_DCtx_reserveBatchDCtxs() :
+ * make sure dctx keeps at least `nbDCtxs` contexts for batch jobs,
+ * with the same parameters as dctx */
+static size_t ZSTD_DCtx_reserveBatchDCtxs(ZSTD_DCtx* dctx, size_t nbDCtxs)
+{
+    size_t n;
+    if (nbDCtxs > dctx->nbBatchDCtxs) {
+        ZSTD_DCtx** const dctxs = (ZSTD_DCtx**)ZSTD_customCalloc(nbDCtxs * sizeof(ZSTD_DCtx*), dctx->customMem);
+        RETURN_ERROR_IF(dctxs == NULL, memory_allocation, "");
+        if (dctx->nbBatchDCtxs)
+            ZSTD_memcpy(dctxs, dctx->batchDCtxs, dctx->nbBatchDCtxs * sizeof(ZSTD_DCtx*));
+        ZSTD_customFree(dctx->batchDCtxs, dctx->customMem);
+        dctx->batchDCtxs = dctxs;
+        for ( ; dctx->nbBatchDCtxs < nbDCtxs; dctx->nbBatchDCtxs++) {
+            dctxs[dctx->nbBatchDCtxs] = ZSTD_createDCtx_internal(dctx->customMem);
+            RETURN_ERROR_IF(dctxs[dctx->nbBatchDCtxs] == NULL, memory_allocation, "");
+        }
+    }
+    for (n = 0; n < nbDCtxs; n++) {
+        ZSTD_DCtx* const worker = dctx->batchDCtxs[n];
+        worker->format = dctx->format;
+        worker->maxWindowSize = dctx->maxWindowSize;
+        worker->forceIgnoreChecksum = dctx->forceIgnoreChecksum;
+        worker->disableHufAsm = dctx->disableHufAsm;
+        worker->maxBlockSizeParam = dctx->maxBlockSizeParam;
+    }
+    return 0;
+}
+#endif
+
+size_t ZSTD_decompressBatch(ZSTD_DCtx* dctx, ZSTD_batchBuffer* buffers, size_t nbBuffers)
+{
+    ZSTD_decompressBatchJob job;
+    DEBUGLOG(4, "ZSTD_decompressBatch (nbBuffers=%u)", (unsigned)nbBuffers);
+    job.dctx = dctx;
+    job.ddict = ZSTD_getDDict(dctx);
+    job.buffers = buffers;
+    job.nbBuffers = nbBuffers;
+
+#ifdef ZSTD_MULTITHREAD
+    {   size_t nbJobsMax = 1;
+        if (dctx->pool != NULL && dctx->staticSize == 0)
+            nbJobsMax += POOL_threadCount(dctx->pool);
+        if (nbJobsMax > 1 && nbBuffers > 1) {
+            ZSTD_decompressBatchJob* const jobs = (ZSTD_decompressBatchJob*)ZSTD_customMalloc(
+                    nbJobsMax * sizeof(ZSTD_decompressBatchJob) + (nbJobsMax+1) * sizeof(size_t), dctx->customMem);
+            size_t* const starts = (size_t*)(void*)(jobs + nbJobsMax);
+            size_t nbJobs, j;
+            RETURN_ERROR_IF(jobs == NULL, memory_allocation, "");
+            nbJobs = ZSTD_batchSplit(buffers, nbBuffers, nbJobsMax, starts);
+            {   size_t const err = ZSTD_DCtx_reserveBatchDCtxs(dctx, nbJobs-1);
+                if (ZSTD_isError(err)) {
+                    ZSTD_customFree(jobs, dctx->customMem);
+                    return err;
+            }   }
+            DEBUGLOG(4, "ZSTD_decompressBatch: %u jobs", (unsigned)nbJobs);
+            for (j = 0; j < nbJobs; j++) {
+                jobs[j] = job;
+                jobs[j].dctx = j ? dctx->batchDCtxs[j-1] : dctx;
+                jobs[j].buffers = buffers + starts[j];
+                jobs[j].nbBuffers = starts[j+1] - starts[j];
+            }
+            POOL_runJobs(dctx->pool, ZSTD_decompressBatchJob_run, jobs, sizeof(ZSTD_decompressBatchJob), nbJobs);
+            ZSTD_customFree(jobs, dctx->customMem);
+            return ZSTD_batchResult(buffers, nbBuffers);
+        }
+    }
+#endif
+    ZSTD_decompressBatchJob_run(&job);
+    return ZSTD_batchResult(buffers, nbBuffers);
+}
+
+
 size_t ZSTD_decompress(void* dst, size_t dstCapacity, const void* src, size_t srcSize)
 {
 #if defined(ZSTD_HEAPMODE) && (ZSTD_HEAPMODE>=1)
@@ -1781,6 +1890,14 @@ size_t ZSTD_DCtx_refDDict(ZSTD_DCtx* dctx, const ZSTD_DDict* ddict)
     return 0;
 }
 
+size_t ZSTD_DCtx_refThreadPool(ZSTD_DCtx* dctx, ZSTD_threadPool* pool)
+{
+    RETURN_ERROR_IF(dctx->streamStage != zdss_init, stage_wrong,
+                    "Can't ref a pool when ctx not in init stage.");
+    dctx->pool = pool;
+    return 0;
+}
+
 /* ZSTD_DCtx_setMaxWindowSize() :
  * note : no direct equivalence in ZSTD_DCtx_setParameter,
  * since this version sets windowSize, and the other sets windowLog */
@@ -2062,12 +2062,43 @@ static size_t ZSTD_maxShortOffset(void)
     }
 }
 
-size_t
-ZSTD_decompressBlock_internal(ZSTD_DCtx* dctx,
-                              void* dst, size_t dstCapacity,
-                        const void* src, size_t srcSize, const streaming_operation streaming)
+#if ZSTD_TRACE && ZSTD_TRACE_BLOCKS
+/* ZSTD_traceCycles() :
+ * @return : the timestamp counter, where it can be read in a single instruction, or 0 */
+static U64 ZSTD_traceCycles(void)
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    return __builtin_ia32_rdtsc();
+#elif defined(__GNUC__) && defined(__aarch64__)
+    U64 ticks;
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return 0;
+#endif
+}
+
+#  define ZSTD_TRACE_BLOCK_PHASE(dctx, field, start)                \
+    do {                                                            \
+        if ((dctx)->traceCtx) {                                     \
+            U64 const now_ = ZSTD_traceCycles();                    \
+            (dctx)->traceBlock.field = now_ - (start);              \
+            (start) = now_;                                         \
+        }                                                           \
+    } while (0)
+#else
+#  define ZSTD_TRACE_BLOCK_PHASE(dctx, field, start) do { } while (0)
+#endif
+
+static size_t
+ZSTD_decompressBlock_body(ZSTD_DCtx* dctx,
+                          void* dst, size_t dstCapacity,
+                    const void* src, size_t srcSize, const streaming_operation streaming)
 {   /* blockType == blockCompressed */
     const BYTE* ip = (const BYTE*)src;
+#if ZSTD_TRACE && ZSTD_TRACE_BLOCKS
+    U64 phaseStart = dctx->traceCtx ? ZSTD_traceCycles() : 0;
+#endif
     DEBUGLOG(5, "ZSTD_decompressBlock_internal (size : %u)", (U32)srcSize);
 
     /* Note : the wording of the specification
@@ -2086,6 +2117,10 @@ ZSTD_decompressBlock_internal(ZSTD_DCtx* dctx,
         if (ZSTD_isError(litCSize)) return litCSize;
         ip += litCSize;
         srcSize -= litCSize;
+        ZSTD_TRACE_BLOCK_PHASE(dctx, literalsCycles, phaseStart);
+#if ZSTD_TRACE && ZSTD_TRACE_BLOCKS
+        dctx->traceBlock.literalsSectionSize = litCSize;
+#endif
     }
 
     /* Build Decoding Tables */
@@ -2150,6 +2185,20 @@ ZSTD_decompressBlock_internal(ZSTD_DCtx* dctx,
         }
 
         dctx->ddictIsCold = 0;
+        ZSTD_TRACE_BLOCK_PHASE(dctx, tablesCycles, phaseStart);
+#if ZSTD_TRACE && ZSTD_TRACE_BLOCKS
+        if (dctx->traceCtx) {
+            dctx->traceBlock.nbSequences = (unsigned)nbSeq;
+            dctx->traceBlock.longOffsetShare = ZSTD_getOffsetInfo(dctx->OFTptr, nbSeq).longOffsetShare;
+#  if defined(ZSTD_FORCE_DECOMPRESS_SEQUENCES_SHORT)
+            dctx->traceBlock.prefetchDecoder = 0;
+#  elif defined(ZSTD_FORCE_DECOMPRESS_SEQUENCES_LONG)
+            dctx->traceBlock.prefetchDecoder = 1;
+#  else
+            dctx->traceBlock.prefetchDecoder = (unsigned)usePrefetchDecoder;
+#  endif
+        }
+#endif
 
 #if !defined(ZSTD_FORCE_DECOMPRESS_SEQUENCES_SHORT) && \
     !defined(ZSTD_FORCE_DECOMPRESS_SEQUENCES_LONG)
@@ -2173,6 +2222,34 @@ ZSTD_decompressBlock_internal(ZSTD_DCtx* dctx,
     }
 }
 
+size_t
+ZSTD_decompressBlock_internal(ZSTD_DCtx* dctx,
+                              void* dst, size_t dstCapacity,
+                        const void* src, size_t srcSize, const streaming_operation streaming)
+{
+#if ZSTD_TRACE && ZSTD_TRACE_BLOCKS
+    if (dctx->traceCtx && ZSTD_trace_decompress_block != NULL) {
+        U64 const start = ZSTD_traceCycles();
+        size_t dSize;
+        ZSTD_memset(&dctx->traceBlock, 0, sizeof(dctx->traceBlock));
+        dSize = ZSTD_decompressBlock_body(dctx, dst, dstCapacity, src, srcSize, streaming);
+        if (ZSTD_isError(dSize)) return dSize;
+        dctx->traceBlock.version = ZSTD_VERSION_NUMBER;
+        dctx->traceBlock.literalsType = srcSize ? (((const BYTE*)src)[0] & 3) : 0;
+        dctx->traceBlock.literalsSize = dctx->litSize;
+        dctx->traceBlock.matchSize = dSize - dctx->litSize;   /* whatever literals don't produce, matches copy */
+        dctx->traceBlock.compressedSize = srcSize;
+        dctx->traceBlock.uncompressedSize = dSize;
+        dctx->traceBlock.sequencesCycles = ZSTD_traceCycles() - start
+                                         - dctx->traceBlock.literalsCycles
+                                         - dctx->traceBlock.tablesCycles;
+        ZSTD_trace_decompress_block(dctx->traceCtx, &dctx->traceBlock);
+        return dSize;
+    }
+#endif
+    return ZSTD_decompressBlock_body(dctx, dst, dstCapacity, src, srcSize, streaming);
+}
+
 
 ZSTD_ALLOW_POINTER_OVERFLOW_ATTR
 void ZSTD_checkContinuity(ZSTD_DCtx* dctx, const void* dst, size_t dstSize)
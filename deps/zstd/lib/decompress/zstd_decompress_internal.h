@@ -199,6 +199,11 @@ struct ZSTD_DCtx_s
 
     size_t oversizedDuration;
 
+    /* batches */
+    ZSTD_threadPool* pool;        /* set by ZSTD_DCtx_refThreadPool() */
+    ZSTD_DCtx** batchDCtxs;       /* contexts of the ZSTD_decompressBatch() jobs run in the pool */
+    size_t nbBatchDCtxs;
+
 #ifdef FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
     void const* dictContentBeginForFuzzing;
     void const* dictContentEndForFuzzing;
@@ -207,6 +212,9 @@ struct ZSTD_DCtx_s
     /* Tracing */
 #if ZSTD_TRACE
     ZSTD_TraceCtx traceCtx;
+#if ZSTD_TRACE_BLOCKS
+    ZSTD_TraceBlock traceBlock;   /* collected while decoding the current block */
+#endif
 #endif
 };  /* typedef'd to ZSTD_DCtx within "zstd.h" */
 
@@ -278,10 +278,10 @@ FASTCOVER_ctx_destroy(FASTCOVER_ctx_t* ctx)
 
 
 /**
- * Calculate for frequency of hash value of each dmer in ctx->samples
+ * Calculate for frequency of hash value of each dmer in training samples [begin, end)
  */
 static void
-FASTCOVER_computeFrequency(U32* freqs, const FASTCOVER_ctx_t* ctx)
+FASTCOVER_computeFrequency(U32* freqs, const FASTCOVER_ctx_t* ctx, size_t begin, size_t end)
 {
     const unsigned f = ctx->f;
     const unsigned d = ctx->d;
@@ -290,7 +290,8 @@ FASTCOVER_computeFrequency(U32* freqs, const FASTCOVER_ctx_t* ctx)
     size_t i;
     assert(ctx->nbTrainSamples >= 5);
     assert(ctx->nbTrainSamples <= ctx->nbSamples);
-    for (i = 0; i < ctx->nbTrainSamples; i++) {
+    assert(begin <= end && end <= ctx->nbTrainSamples);
+    for (i = begin; i < end; i++) {
         size_t start = ctx->offsets[i];  /* start of current dmer */
         size_t const currSampleEnd = ctx->offsets[i+1];
         while (start + readLength <= currSampleEnd) {
@@ -302,6 +303,97 @@ FASTCOVER_computeFrequency(U32* freqs, const FASTCOVER_ctx_t* ctx)
 }
 
 
+/**
+ * Frequencies can be counted in parallel, each thread counting the dmers of
+ * a shard of the training samples into its own table, then each thread summing
+ * a slice of the tables. Result is identical to a serial count.
+ * A shard is only worth its table if it counts at least as many dmers
+ * as the table has entries.
+ */
+typedef struct {
+    const FASTCOVER_ctx_t* ctx;
+    U32* freqs;
+    U32* const* shardFreqs;   /* tables of shards 1 and up, added into freqs */
+    size_t nbShards;
+    size_t begin;             /* training samples of this shard */
+    size_t end;
+    size_t sliceBegin;        /* slice of the tables summed by this job */
+    size_t sliceEnd;
+} FASTCOVER_countJob_t;
+
+static void FASTCOVER_countShard(void* opaque)
+{
+    FASTCOVER_countJob_t* const job = (FASTCOVER_countJob_t*)opaque;
+    FASTCOVER_computeFrequency(job->freqs, job->ctx, job->begin, job->end);
+}
+
+static void FASTCOVER_sumShards(void* opaque)
+{
+    FASTCOVER_countJob_t const* const job = (FASTCOVER_countJob_t const*)opaque;
+    size_t s, i;
+    for (s = 1; s < job->nbShards; s++) {
+        U32 const* const shard = job->shardFreqs[s-1];
+        for (i = job->sliceBegin; i < job->sliceEnd; i++)
+            job->freqs[i] += shard[i];
+    }
+}
+
+#define FASTCOVER_MAX_COUNT_SHARDS 64
+
+/**
+ * Count frequencies into ctx->freqs, sharded over the threads of `pool`, if any.
+ * Falls back to a serial count if shard tables can't be allocated.
+ */
+static void
+FASTCOVER_countFrequencies(FASTCOVER_ctx_t* ctx, POOL_ctx* pool)
+{
+    size_t const tableSize = (size_t)1 << ctx->f;
+    size_t const trainingSize = ctx->offsets[ctx->nbTrainSamples];
+    size_t nbShards = MIN(POOL_threadCount(pool), FASTCOVER_MAX_COUNT_SHARDS);
+    U32* shardFreqs[FASTCOVER_MAX_COUNT_SHARDS - 1];
+    FASTCOVER_countJob_t jobs[FASTCOVER_MAX_COUNT_SHARDS];
+    size_t s;
+
+    nbShards = MIN(nbShards, trainingSize / ((size_t)ctx->accelParams.skip + 1) / tableSize);
+    nbShards = MIN(nbShards, ctx->nbTrainSamples);
+    for (s = 1; s < nbShards; s++) {
+        shardFreqs[s-1] = (U32*)calloc(tableSize, sizeof(U32));
+        if (shardFreqs[s-1] == NULL) break;
+    }
+    nbShards = MAX(s, 1);   /* as many shards as allocated tables */
+    if (nbShards == 1) {
+        FASTCOVER_computeFrequency(ctx->freqs, ctx, 0, ctx->nbTrainSamples);
+        return;
+    }
+    DISPLAYLEVEL(3, "Counting frequencies on %u threads\n", (unsigned)nbShards);
+
+    /* cut training samples into shards of about the same size */
+    {   size_t sample = 0;
+        for (s = 0; s < nbShards; s++) {
+            size_t const shardEnd = (s + 1 == nbShards) ? trainingSize : trainingSize / nbShards * (s + 1);
+            jobs[s].ctx = ctx;
+            jobs[s].freqs = (s == 0) ? ctx->freqs : shardFreqs[s-1];
+            jobs[s].begin = sample;
+            while (sample < ctx->nbTrainSamples && ctx->offsets[sample + 1] <= shardEnd) sample++;
+            jobs[s].end = sample;
+        }
+        assert(sample == ctx->nbTrainSamples);
+    }
+    POOL_runJobs(pool, FASTCOVER_countShard, jobs, sizeof(jobs[0]), nbShards);
+
+    for (s = 0; s < nbShards; s++) {
+        jobs[s].freqs = ctx->freqs;
+        jobs[s].shardFreqs = shardFreqs;
+        jobs[s].nbShards = nbShards;
+        jobs[s].sliceBegin = tableSize / nbShards * s;
+        jobs[s].sliceEnd = (s + 1 == nbShards) ? tableSize : tableSize / nbShards * (s + 1);
+    }
+    POOL_runJobs(pool, FASTCOVER_sumShards, jobs, sizeof(jobs[0]), nbShards);
+
+    for (s = 1; s < nbShards; s++) free(shardFreqs[s-1]);
+}
+
+
 /**
  * Prepare a context for dictionary building.
  * The context is only dependent on the parameter `d` and can be used multiple
@@ -314,7 +406,7 @@ FASTCOVER_ctx_init(FASTCOVER_ctx_t* ctx,
                    const void* samplesBuffer,
                    const size_t* samplesSizes, unsigned nbSamples,
                    unsigned d, double splitPoint, unsigned f,
-                   FASTCOVER_accel_t accelParams)
+                   FASTCOVER_accel_t accelParams, POOL_ctx* pool)
 {
     const BYTE* const samples = (const BYTE*)samplesBuffer;
     const size_t totalSamplesSize = COVER_sum(samplesSizes, nbSamples);
@@ -387,7 +479,7 @@ FASTCOVER_ctx_init(FASTCOVER_ctx_t* ctx,
     }
 
     DISPLAYLEVEL(2, "Computing frequencies\n");
-    FASTCOVER_computeFrequency(ctx->freqs, ctx);
+    FASTCOVER_countFrequencies(ctx, pool);
 
     return 0;
 }
@@ -555,6 +647,7 @@ ZDICT_trainFromBuffer_fastCover(void* dictBuffer, size_t dictBufferCapacity,
     FASTCOVER_ctx_t ctx;
     ZDICT_cover_params_t coverParams;
     FASTCOVER_accel_t accelParams;
+    POOL_ctx* pool = NULL;
     /* Initialize global data */
     g_displayLevel = (int)parameters.zParams.notificationLevel;
     /* Assign splitPoint and f if not provided */
@@ -581,11 +674,18 @@ ZDICT_trainFromBuffer_fastCover(void* dictBuffer, size_t dictBufferCapacity,
     }
     /* Assign corresponding FASTCOVER_accel_t to accelParams*/
     accelParams = FASTCOVER_defaultAccelParameters[parameters.accel];
-    /* Initialize context */
+    /* Initialize context, counting frequencies on nbThreads */
+    if (parameters.nbThreads > 1) {
+      pool = POOL_create(parameters.nbThreads, 1);
+      if (!pool) {
+        return ERROR(memory_allocation);
+      }
+    }
     {
       size_t const initVal = FASTCOVER_ctx_init(&ctx, samplesBuffer, samplesSizes, nbSamples,
                             coverParams.d, parameters.splitPoint, parameters.f,
-                            accelParams);
+                            accelParams, pool);
+      POOL_free(pool);
       if (ZSTD_isError(initVal)) {
         DISPLAYLEVEL(1, "Failed to initialize context\n");
         return initVal;
@@ -689,7 +789,7 @@ ZDICT_optimizeTrainFromBuffer_fastCover(
       FASTCOVER_ctx_t ctx;
       LOCALDISPLAYLEVEL(displayLevel, 3, "d=%u\n", d);
       {
-        size_t const initVal = FASTCOVER_ctx_init(&ctx, samplesBuffer, samplesSizes, nbSamples, d, splitPoint, f, accelParams);
+        size_t const initVal = FASTCOVER_ctx_init(&ctx, samplesBuffer, samplesSizes, nbSamples, d, splitPoint, f, accelParams, pool);
         if (ZSTD_isError(initVal)) {
           LOCALDISPLAYLEVEL(displayLevel, 1, "Failed to initialize context\n");
           COVER_best_destroy(&best);
@@ -503,7 +503,8 @@ typedef enum {
      ZSTD_c_experimentalParam16=1013,
      ZSTD_c_experimentalParam17=1014,
      ZSTD_c_experimentalParam18=1015,
-     ZSTD_c_experimentalParam19=1016
+     ZSTD_c_experimentalParam19=1016,
+     ZSTD_c_experimentalParam20=1017
 } ZSTD_cParameter;
 
 typedef struct {
@@ -1789,6 +1790,35 @@ typedef struct POOL_ctx_s ZSTD_threadPool;
 ZSTDLIB_STATIC_API ZSTD_threadPool* ZSTD_createThreadPool(size_t numThreads);
 ZSTDLIB_STATIC_API void ZSTD_freeThreadPool (ZSTD_threadPool* pool);  /* accept NULL pointer */
 ZSTDLIB_STATIC_API size_t ZSTD_CCtx_refThreadPool(ZSTD_CCtx* cctx, ZSTD_threadPool* pool);
+ZSTDLIB_STATIC_API size_t ZSTD_DCtx_refThreadPool(ZSTD_DCtx* dctx, ZSTD_threadPool* pool);
+
+/*! Batches of small messages :
+ *  ZSTD_compressBatch() compresses each `src` of the `nbBuffers` buffers into its own frame in `dst`,
+ *  and ZSTD_decompressBatch() decompresses each one, as many calls to ZSTD_compress2() or
+ *  ZSTD_decompressDCtx() would, with the parameters and dictionary of the context.
+ *  Each `result` receives the compressed or decompressed size of its buffer, or an error code.
+ *  The dictionary is resolved once for the whole batch, and frames are identical to those of ZSTD_compress2().
+ *  A prefix referenced with ZSTD_CCtx_refPrefix() or ZSTD_DCtx_refPrefix() applies to every buffer
+ *  of the batch, and is then dropped. ZSTD_c_nbWorkers is ignored.
+ *  When a thread pool is referenced with ZSTD_CCtx_refThreadPool() or ZSTD_DCtx_refThreadPool(),
+ *  buffers are processed in parallel, on the pool's threads and the calling thread,
+ *  each using its own context, which the context keeps for later batches.
+ *  A thread pool can't be combined with an external sequence producer.
+ *  Buffers must not overlap.
+ * @return : 0 when all buffers succeeded, or the error code of the first buffer which failed,
+ *           or an error code if the batch couldn't be started at all,
+ *           in which case no `result` is written.
+ */
+typedef struct {
+    const void* src;
+    size_t srcSize;
+    void* dst;
+    size_t dstCapacity;
+    size_t result;     /* output : size written into dst, or an error code */
+} ZSTD_batchBuffer;
+
+ZSTDLIB_STATIC_API size_t ZSTD_compressBatch(ZSTD_CCtx* cctx, ZSTD_batchBuffer* buffers, size_t nbBuffers);
+ZSTDLIB_STATIC_API size_t ZSTD_decompressBatch(ZSTD_DCtx* dctx, ZSTD_batchBuffer* buffers, size_t nbBuffers);
 
 
 /*
@@ -2218,6 +2248,23 @@ ZSTDLIB_STATIC_API size_t ZSTD_CCtx_refPrefix_advanced(ZSTD_CCtx* cctx, const vo
  */
 #define ZSTD_c_searchForExternalRepcodes ZSTD_c_experimentalParam19
 
+/* ZSTD_c_maxMemory
+ * Memory budget of multithreaded compression, in KB.
+ * The default, 0, means no budget. Only has an effect when ZSTD_c_nbWorkers >= 1.
+ *
+ * The number of jobs in flight is limited so that their buffers and
+ * compression contexts, plus the round buffer holding their input, fit within
+ * the budget. When ZSTD_c_jobSize is left to 0, jobs are also made smaller
+ * while the budget keeps some workers idle, and larger again once workers
+ * catch up with the input. Job boundaries then depend on thread scheduling,
+ * so the compressed result is not reproducible. Setting ZSTD_c_jobSize keeps it
+ * reproducible, by only limiting jobs in flight.
+ *
+ * The budget is an estimate, which does not cover the ZSTD_CCtx itself. It is
+ * exceeded when even a single job of the smallest size does not fit.
+ */
+#define ZSTD_c_maxMemory ZSTD_c_experimentalParam20
+
 /*! ZSTD_CCtx_getParameter() :
  *  Get the requested compression parameter value, selected by enum ZSTD_cParameter,
  *  and store it into int* value.
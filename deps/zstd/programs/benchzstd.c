@@ -137,7 +137,8 @@ BMK_advancedParams_t BMK_initAdvancedParams(void) {
         0, /* ldmBuckSizeLog */
         0,  /* ldmHashRateLog */
         ZSTD_ps_auto, /* literalCompressionMode */
-        0 /* useRowMatchFinder */
+        0, /* useRowMatchFinder */
+        0 /* batch */
     };
     return res;
 }
@@ -237,6 +238,47 @@ static size_t local_defaultCompress(
     return ZSTD_compress2(cctx, dstBuffer, dstSize, srcBuffer, srcSize);
 }
 
+typedef struct {
+    ZSTD_CCtx* cctx;
+    ZSTD_DCtx* dctx;
+    ZSTD_batchBuffer* buffers;
+    size_t nbBuffers;
+} BMK_batchArgs;
+
+/* `addArgs` is the batch, which covers all blocks :
+ * the block given as argument is ignored */
+static size_t local_batchCompress(
+                    const void* srcBuffer, size_t srcSize,
+                    void* dstBuffer, size_t dstSize,
+                    void* addArgs)
+{
+    BMK_batchArgs* const ba = (BMK_batchArgs*)addArgs;
+    size_t total = 0;
+    size_t n;
+    (void)srcBuffer; (void)srcSize; (void)dstBuffer; (void)dstSize;
+    {   size_t const err = ZSTD_compressBatch(ba->cctx, ba->buffers, ba->nbBuffers);
+        if (ZSTD_isError(err)) return err;
+    }
+    for (n = 0; n < ba->nbBuffers; n++) total += ba->buffers[n].result;
+    return total;
+}
+
+static size_t local_batchDecompress(
+                    const void* srcBuffer, size_t srcSize,
+                    void* dstBuffer, size_t dstCapacity,
+                    void* addArgs)
+{
+    BMK_batchArgs* const ba = (BMK_batchArgs*)addArgs;
+    size_t total = 0;
+    size_t n;
+    (void)srcBuffer; (void)srcSize; (void)dstBuffer; (void)dstCapacity;
+    {   size_t const err = ZSTD_decompressBatch(ba->dctx, ba->buffers, ba->nbBuffers);
+        if (ZSTD_isError(err)) return err;
+    }
+    for (n = 0; n < ba->nbBuffers; n++) total += ba->buffers[n].result;
+    return total;
+}
+
 /* `addArgs` is the context */
 static size_t local_defaultDecompress(
                     const void* srcBuffer, size_t srcSize,
@@ -303,6 +345,7 @@ BMK_benchMemAdvancedNoAlloc(
                     void** resPtrs, size_t* resSizes,
                     void** resultBufferPtr, void* compressedBuffer,
                     size_t maxCompressedSize,
+                    ZSTD_batchBuffer* batchBuffers,
                     BMK_timedFnState_t* timeStateCompress,
                     BMK_timedFnState_t* timeStateDecompress,
 
@@ -406,6 +449,7 @@ BMK_benchMemAdvancedNoAlloc(
         BMK_benchParams_t cbp, dbp;
         BMK_initCCtxArgs cctxprep;
         BMK_initDCtxArgs dctxprep;
+        BMK_batchArgs cBatch, dBatch;
 
         cbp.benchFn = local_defaultCompress;   /* ZSTD_compress2 */
         cbp.benchPayload = cctx;
@@ -442,6 +486,34 @@ BMK_benchMemAdvancedNoAlloc(
         dctxprep.dictBuffer = dictBuffer;
         dctxprep.dictBufferSize = dictBufferSize;
 
+        if (adv->batch) {
+            /* one call for all blocks : batchBuffers holds the compression batch,
+             * followed by the decompression batch */
+            U32 n;
+            assert(batchBuffers != NULL);
+            cBatch.cctx = cctx; cBatch.dctx = NULL;
+            cBatch.buffers = batchBuffers; cBatch.nbBuffers = nbBlocks;
+            dBatch.cctx = NULL; dBatch.dctx = dctx;
+            dBatch.buffers = batchBuffers + nbBlocks; dBatch.nbBuffers = nbBlocks;
+            for (n = 0; n < nbBlocks; n++) {
+                cBatch.buffers[n].src = srcPtrs[n];
+                cBatch.buffers[n].srcSize = srcSizes[n];
+                cBatch.buffers[n].dst = cPtrs[n];
+                cBatch.buffers[n].dstCapacity = cCapacities[n];
+                dBatch.buffers[n].src = cPtrs[n];
+                dBatch.buffers[n].srcSize = cSizes[n];   /* updated after each compression */
+                dBatch.buffers[n].dst = resPtrs[n];
+                dBatch.buffers[n].dstCapacity = resSizes[n];
+            }
+            cbp.benchFn = local_batchCompress;
+            cbp.benchPayload = &cBatch;
+            cbp.blockCount = 1;
+            cbp.blockResults = NULL;
+            dbp.benchFn = local_batchDecompress;
+            dbp.benchPayload = &dBatch;
+            dbp.blockCount = 1;
+        }
+
         OUTPUTLEVEL(2, "\r%70s\r", "");   /* blank line */
         assert(srcSize < UINT_MAX);
         OUTPUTLEVEL(2, "%2s-%-17.17s :%10u -> \r", marks[markNb], displayName, (unsigned)srcSize);
@@ -454,6 +526,12 @@ BMK_benchMemAdvancedNoAlloc(
                     RETURN_ERROR(30, BMK_benchOutcome_t, "compression error");
                 }
 
+                if (adv->batch) {
+                    U32 n;
+                    for (n = 0; n < nbBlocks; n++)
+                        cSizes[n] = dBatch.buffers[n].srcSize = cBatch.buffers[n].result;
+                }
+
                 {   BMK_runTime_t const cResult = BMK_extract_runTime(cOutcome);
                     cSize = cResult.sumOfReturn;
                     ratio = (double)srcSize / (double)cSize;
@@ -603,11 +681,22 @@ BMK_benchOutcome_t BMK_benchMemAdvanced(const void* srcBuffer, size_t srcSize,
 
     void* resultBuffer = srcSize ? malloc(srcSize) : NULL;
 
+    /* batch mode : compression then decompression batch, run on nbWorkers threads, including the calling one */
+    ZSTD_batchBuffer* const batchBuffers = adv->batch ? (ZSTD_batchBuffer*)malloc(2 * maxNbBlocks * sizeof(ZSTD_batchBuffer)) : NULL;
+    ZSTD_threadPool* const pool = (adv->batch && adv->nbWorkers > 1) ? ZSTD_createThreadPool((size_t)adv->nbWorkers - 1) : NULL;
+
     int const allocationincomplete = !srcPtrs || !srcSizes || !cPtrs ||
         !cSizes || !cCapacities || !resPtrs || !resSizes ||
         !timeStateCompress || !timeStateDecompress ||
         !cctx || !dctx ||
-        !compressedBuffer || !resultBuffer;
+        !compressedBuffer || !resultBuffer ||
+        (adv->batch && !batchBuffers) ||
+        (adv->batch && adv->nbWorkers > 1 && !pool);
+
+    if (!allocationincomplete && pool != NULL) {
+        CHECK_Z(ZSTD_CCtx_refThreadPool(cctx, pool));
+        CHECK_Z(ZSTD_DCtx_refThreadPool(dctx, pool));
+    }
 
 
     if (!allocationincomplete && !dstParamsError) {
@@ -616,6 +705,7 @@ BMK_benchOutcome_t BMK_benchMemAdvanced(const void* srcBuffer, size_t srcSize,
                                             resPtrs, resSizes,
                                             &resultBuffer,
                                             compressedBuffer, maxCompressedSize,
+                                            batchBuffers,
                                             timeStateCompress, timeStateDecompress,
                                             srcBuffer, srcSize,
                                             fileSizes, nbFiles,
@@ -631,6 +721,8 @@ BMK_benchOutcome_t BMK_benchMemAdvanced(const void* srcBuffer, size_t srcSize,
 
     ZSTD_freeCCtx(cctx);
     ZSTD_freeDCtx(dctx);
+    ZSTD_freeThreadPool(pool);
+    free(batchBuffers);
 
     free(internalDstBuffer);
     free(resultBuffer);
@@ -110,6 +110,7 @@ typedef struct {
     int ldmHashRateLog;
     ZSTD_paramSwitch_e literalCompressionMode;
     int useRowMatchFinder;  /* use row-based matchfinder if possible */
+    int batch;              /* process all blocks with one ZSTD_compressBatch() / ZSTD_decompressBatch() call, on nbWorkers threads */
 } BMK_advancedParams_t;
 
 /* returns default parameters used by nonAdvanced functions */
@@ -88,6 +88,8 @@ static UTIL_time_t g_displayClock = UTIL_TIME_INITIALIZER;
 **********************************************************/
 #undef MIN
 #define MIN(a,b)    ((a) < (b) ? (a) : (b))
+#undef MAX
+#define MAX(a,b)    ((a) > (b) ? (a) : (b))
 
 /**
   Returns the size of a file.
@@ -208,6 +210,224 @@ static void DiB_shuffle(const char** fileNamesTable, unsigned nbFiles) {
 }
 
 
+/*-********************************************************
+*  Reservoir sampling
+**********************************************************/
+/* When the samples don't all fit in memory, a uniform random subset of them
+ * is streamed in : each sample gets a random key, and the reservoir keeps those
+ * with the lowest keys that fit. When it is full, the samples with the highest
+ * keys are evicted until it is a quarter empty, and later samples with a higher
+ * key than an evicted one are skipped without being read. Holes left by
+ * evictions are compacted away when the end of the buffer is reached,
+ * which thus happens at most once per quarter of the buffer. */
+typedef struct {
+    U64 key;
+    size_t pos;
+    size_t size;
+} DiB_sample;
+
+typedef struct {
+    char* buffer;
+    size_t capacity;      /* memory budget, for sample contents and DiB_sample entries */
+    size_t used;          /* part of capacity in use */
+    size_t end;           /* end of the last sample in buffer */
+    DiB_sample* heap;     /* max-heap on key */
+    size_t nbSamples;
+    size_t heapSize;
+    U64 maxKey;           /* samples with a larger key are not admitted */
+    U64 seed;
+} DiB_reservoir;
+
+#define DiB_SAMPLE_COST(size) ((size) + sizeof(DiB_sample))
+
+static U64 DiB_rand64(U64* seed)
+{
+    U64 z = (*seed += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static void DiB_heapSiftDown(DiB_sample* heap, size_t nb, size_t n)
+{
+    for (;;) {
+        size_t largest = n;
+        size_t const left = 2*n + 1;
+        size_t const right = left + 1;
+        if (left < nb && heap[left].key > heap[largest].key) largest = left;
+        if (right < nb && heap[right].key > heap[largest].key) largest = right;
+        if (largest == n) return;
+        {   DiB_sample const tmp = heap[n];
+            heap[n] = heap[largest];
+            heap[largest] = tmp;
+        }
+        n = largest;
+    }
+}
+
+static void DiB_heapSiftUp(DiB_sample* heap, size_t n)
+{
+    while (n > 0 && heap[(n-1)/2].key < heap[n].key) {
+        DiB_sample const tmp = heap[n];
+        heap[n] = heap[(n-1)/2];
+        heap[(n-1)/2] = tmp;
+        n = (n-1)/2;
+    }
+}
+
+static int DiB_cmpSamplePos(const void* a, const void* b)
+{
+    size_t const posA = ((const DiB_sample*)a)->pos;
+    size_t const posB = ((const DiB_sample*)b)->pos;
+    return (posA > posB) - (posA < posB);
+}
+
+/* DiB_reservoirCompact() :
+ * moves samples to the start of the buffer, in their order of arrival.
+ * Leaves them sorted by position : the heap must be rebuilt before use. */
+static void DiB_reservoirCompact(DiB_reservoir* res)
+{
+    size_t pos = 0;
+    size_t n;
+    qsort(res->heap, res->nbSamples, sizeof(DiB_sample), DiB_cmpSamplePos);
+    for (n = 0; n < res->nbSamples; n++) {
+        memmove(res->buffer + pos, res->buffer + res->heap[n].pos, res->heap[n].size);
+        res->heap[n].pos = pos;
+        pos += res->heap[n].size;
+    }
+    res->end = pos;
+}
+
+static void DiB_reservoirHeapify(DiB_reservoir* res)
+{
+    size_t n = res->nbSamples / 2;
+    while (n-- > 0)
+        DiB_heapSiftDown(res->heap, res->nbSamples, n);
+}
+
+/* DiB_reservoirReserve() :
+ * draws the key of the next sample, and makes room for it if it is admitted.
+ * @return : the position at which to load the sample, or NULL if it is skipped */
+static char* DiB_reservoirReserve(DiB_reservoir* res, size_t size)
+{
+    U64 const key = DiB_rand64(&res->seed);
+    size_t const cost = DiB_SAMPLE_COST(size);
+    if (key >= res->maxKey || cost > res->capacity) return NULL;
+    if (res->used + cost > res->capacity) {
+        size_t const lowWater = res->capacity - res->capacity / 4;
+        while ( res->nbSamples > 0
+             && res->used + cost > lowWater
+             && res->heap[0].key > key ) {
+            res->maxKey = res->heap[0].key;
+            res->used -= DiB_SAMPLE_COST(res->heap[0].size);
+            res->heap[0] = res->heap[--res->nbSamples];
+            DiB_heapSiftDown(res->heap, res->nbSamples, 0);
+        }
+        if (res->used + cost > res->capacity) {
+            res->maxKey = key;
+            return NULL;
+        }
+    }
+    if (res->nbSamples == res->heapSize) {
+        size_t const newSize = res->heapSize ? res->heapSize * 2 : 1024;
+        DiB_sample* const newHeap = (DiB_sample*)realloc(res->heap, newSize * sizeof(DiB_sample));
+        if (newHeap == NULL)
+            EXM_THROW(12, "not enough memory for DiB_trainFiles");
+        res->heap = newHeap;
+        res->heapSize = newSize;
+    }
+    if (res->end + size > res->capacity) {
+        DiB_reservoirCompact(res);
+        DiB_reservoirHeapify(res);
+    }
+    assert(res->end + size <= res->capacity);
+    res->heap[res->nbSamples].key = key;
+    res->heap[res->nbSamples].pos = res->end;
+    res->heap[res->nbSamples].size = size;
+    DiB_heapSiftUp(res->heap, res->nbSamples++);
+    res->used += cost;
+    res->end += size;
+    return res->buffer + res->end - size;
+}
+
+/** DiB_sampleFiles() :
+ *  stream all samples from files listed in fileNamesTable through a reservoir
+ *  held in `buffer`, of size *bufferSizePtr, which keeps a uniform random subset
+ *  of them in bounded memory, and load it at the start of `buffer`.
+ *  Samples are cut from files as DiB_loadFiles() does.
+ * @return : nb of samples loaded into `buffer`
+ * *bufferSizePtr is modified, it provides the amount data loaded within buffer.
+ * *sampleSizesPtr is allocated, and filled with the size of each sample.
+ */
+static int DiB_sampleFiles(
+    void* buffer, size_t* bufferSizePtr, size_t** sampleSizesPtr,
+    const char** fileNamesTable, int nbFiles,
+    size_t targetChunkSize, int displayLevel )
+{
+    DiB_reservoir res;
+    U64 nbSamplesSeen = 0;
+    int fileIndex;
+
+    assert(targetChunkSize <= SAMPLESIZE_MAX);
+    memset(&res, 0, sizeof(res));
+    res.buffer = (char*)buffer;
+    res.capacity = *bufferSizePtr;
+    res.maxKey = (U64)-1;
+    res.seed = 0xFD2FB528;
+
+    for (fileIndex = 0; fileIndex < nbFiles; fileIndex++) {
+        S64 const fileSize = DiB_getFileSize(fileNamesTable[fileIndex]);
+        size_t const firstChunkSize = targetChunkSize > 0 ?
+                            (size_t)MIN(fileSize, (S64)targetChunkSize) :
+                            (size_t)MIN(fileSize, SAMPLESIZE_MAX );
+        S64 const sampledSize = targetChunkSize > 0 ? fileSize : (S64)firstChunkSize;
+        S64 filePos = 0;
+        S64 readPos = 0;
+        FILE* f = NULL;
+        if (fileSize <= 0) continue;   /* skip if zero-size or file error */
+
+        DISPLAYUPDATE(2, "Sampling %s...       \r", fileNamesTable[fileIndex]);
+        while (filePos < sampledSize) {
+            size_t const chunkSize = filePos == 0 ? firstChunkSize : (size_t)MIN(sampledSize - filePos, (S64)targetChunkSize);
+            char* const dst = DiB_reservoirReserve(&res, chunkSize);
+            nbSamplesSeen++;
+            if (dst != NULL) {
+                if (f == NULL) {
+                    f = fopen(fileNamesTable[fileIndex], "rb");
+                    if (f == NULL)
+                        EXM_THROW(10, "zstd: dictBuilder: %s %s ", fileNamesTable[fileIndex], strerror(errno));
+                }
+                if (readPos != filePos && UTIL_fseek(f, filePos, SEEK_SET) != 0)
+                    EXM_THROW(11, "Pb reading %s", fileNamesTable[fileIndex]);
+                if (fread(dst, 1, chunkSize, f) != chunkSize)
+                    EXM_THROW(11, "Pb reading %s", fileNamesTable[fileIndex]);
+                readPos = filePos + (S64)chunkSize;
+            }
+            filePos += (S64)chunkSize;
+        }
+        if (f != NULL)
+            fclose(f);
+    }
+
+    DiB_reservoirCompact(&res);
+    {   size_t* const sampleSizes = (size_t*)malloc(MAX(res.nbSamples, 1) * sizeof(size_t));
+        size_t n;
+        if (sampleSizes == NULL)
+            EXM_THROW(12, "not enough memory for DiB_trainFiles");
+        for (n = 0; n < res.nbSamples; n++)
+            sampleSizes[n] = res.heap[n].size;
+        *sampleSizesPtr = sampleSizes;
+    }
+    free(res.heap);
+
+    DISPLAYLEVEL(2, "\r%79s\r", "");
+    DISPLAYLEVEL(2, "Sampled %u of %llu samples, %d KB of training data \n",
+        (unsigned)res.nbSamples, (unsigned long long)nbSamplesSeen, (int)(res.end / (1 KB)));
+    *bufferSizePtr = res.end;
+    return (int)res.nbSamples;
+}
+
+
 /*-********************************************************
 *  Dictionary training functions
 **********************************************************/
@@ -320,6 +540,7 @@ int DiB_trainFromFiles(const char* dictFileName, size_t maxDictSize,
     size_t loadedSize; /* total data loaded in srcBuffer for all samples */
     void* srcBuffer /* contiguous buffer with training data/samples */;
     void* const dictBuffer = malloc(maxDictSize);
+    int sampling; /* samples don't all fit : stream them through a reservoir */
     int result = 0;
 
     int const displayLevel = params ? params->zParams.notificationLevel :
@@ -349,12 +570,14 @@ int DiB_trainFromFiles(const char* dictFileName, size_t maxDictSize,
                 (unsigned)(memLimit / (1 MB)));
             loadedSize = (size_t)MIN(loadedSize, memLimit);
         }
+        sampling = (S64)loadedSize < fs.totalSizeToLoad;
         srcBuffer = malloc(loadedSize+NOISELENGTH);
-        sampleSizes = (size_t*)malloc(fs.nbSamples * sizeof(size_t));
+        /* when sampling, the table is sized by DiB_sampleFiles() */
+        sampleSizes = sampling ? NULL : (size_t*)malloc(fs.nbSamples * sizeof(size_t));
     }
 
     /* Checks */
-    if ((fs.nbSamples && !sampleSizes) || (!srcBuffer) || (!dictBuffer))
+    if ((fs.nbSamples && !sampling && !sampleSizes) || (!srcBuffer) || (!dictBuffer))
         EXM_THROW(12, "not enough memory for DiB_trainFiles");   /* should not happen */
     if (fs.oneSampleTooLarge) {
         DISPLAYLEVEL(2, "!  Warning : some sample(s) are very large \n");
@@ -373,15 +596,21 @@ int DiB_trainFromFiles(const char* dictFileName, size_t maxDictSize,
     }
 
     /* init */
-    if ((S64)loadedSize < fs.totalSizeToLoad)
+    if (sampling)
         DISPLAYLEVEL(1, "Training samples set too large (%u MB); training on %u MB only...\n",
             (unsigned)(fs.totalSizeToLoad / (1 MB)),
             (unsigned)(loadedSize / (1 MB)));
 
     /* Load input buffer */
-    nbSamplesLoaded = DiB_loadFiles(
-        srcBuffer, &loadedSize, sampleSizes, fs.nbSamples, fileNamesTable,
-        nbFiles, chunkSize, displayLevel);
+    if (sampling) {
+        nbSamplesLoaded = DiB_sampleFiles(
+            srcBuffer, &loadedSize, &sampleSizes, fileNamesTable,
+            nbFiles, chunkSize, displayLevel);
+    } else {
+        nbSamplesLoaded = DiB_loadFiles(
+            srcBuffer, &loadedSize, sampleSizes, fs.nbSamples, fileNamesTable,
+            nbFiles, chunkSize, displayLevel);
+    }
 
     {   size_t dictSize = ZSTD_error_GENERIC;
         if (params) {
@@ -287,6 +287,7 @@ FIO_prefs_t* FIO_createPreferences(void)
     ret->checksumFlag = 1;
     ret->removeSrcFile = 0;
     ret->memLimit = 0;
+    ret->compressMemLimit = 0;
     ret->nbWorkers = 1;
     ret->blockSize = 0;
     ret->overlapLog = FIO_OVERLAP_LOG_NOTSET;
@@ -405,6 +406,12 @@ void FIO_setRsyncable(FIO_prefs_t* const prefs, int rsyncable) {
     prefs->rsyncable = rsyncable;
 }
 
+void FIO_setCompressMemLimit(FIO_prefs_t* const prefs, size_t compressMemLimit) {
+    if ((compressMemLimit>0) && (prefs->nbWorkers==0))
+        EXM_THROW(1, "Compression memory limit is not compatible with single thread mode \n");
+    prefs->compressMemLimit = compressMemLimit;
+}
+
 void FIO_setStreamSrcSize(FIO_prefs_t* const prefs, size_t streamSrcSize) {
     prefs->streamSrcSize = streamSrcSize;
 }
@@ -1188,6 +1195,11 @@ static cRess_t FIO_createCResources(FIO_prefs_t* const prefs,
         CHECK( ZSTD_CCtx_setParameter(ress.cctx, ZSTD_c_overlapLog, prefs->overlapLog) );
     }
     CHECK( ZSTD_CCtx_setParameter(ress.cctx, ZSTD_c_rsyncable, prefs->rsyncable) );
+    if (prefs->compressMemLimit) {
+        int const limitKB = (int)MIN((size_t)INT_MAX, (prefs->compressMemLimit + (1 KB - 1)) >> 10);
+        DISPLAYLEVEL(3,"set compression memory limit = %d KB \n", limitKB);
+        CHECK( ZSTD_CCtx_setParameter(ress.cctx, ZSTD_c_maxMemory, limitKB) );
+    }
 #endif
     /* dictionary */
     if (prefs->patchFromMode) {
@@ -2020,6 +2032,8 @@ void FIO_displayCompressionParameters(const FIO_prefs_t* prefs)
         DISPLAY(" --adapt=min=%d,max=%d", prefs->minAdaptLevel, prefs->maxAdaptLevel);
     DISPLAY("%s", INDEX(rowMatchFinderOptions, prefs->useRowMatchFinder));
     DISPLAY("%s", prefs->rsyncable ? " --rsyncable" : "");
+    if (prefs->compressMemLimit)
+        DISPLAY(" --memlimit-compress=%u", (unsigned) prefs->compressMemLimit);
     if (prefs->streamSrcSize)
         DISPLAY(" --stream-size=%u", (unsigned) prefs->streamSrcSize);
     if (prefs->srcSizeHint)
@@ -2209,13 +2223,119 @@ int FIO_compressMultipleFilenames(FIO_ctx_t* const fCtx,
 /* **************************************************************************
  *  Decompression
  ***************************************************************************/
+typedef struct FIO_DMT_s FIO_DMT_t;
+
+#define FIO_DECOMPRESS_NBWORKERS_MAX 256   /* same cap as compression */
+
 typedef struct {
     FIO_Dict_t dict;
     ZSTD_DStream* dctx;
     WritePoolCtx_t *writeCtx;
     ReadPoolCtx_t *readCtx;
+    FIO_DMT_t* mt;   /* NULL unless decoding frames on several workers */
 } dRess_t;
 
+/* Multithreaded decompression : when the input is a sequence of independent
+ * frames that declare their decompressed size, each frame is read whole,
+ * decoded by a worker into its own buffer, and written out in order.
+ * Other frames are decoded by the streaming path.
+ * The buffers of all jobs together stay within the --memory limit : a frame
+ * is only handed out when its decoded size fits next to the frames in flight,
+ * which may exceed the limit by the compressed size of the last frame. */
+typedef struct {
+    FIO_DMT_t* mt;
+    ZSTD_DCtx* dctx;
+    BYTE* src;
+    size_t srcCapacity;
+    size_t srcSize;
+    BYTE* dst;
+    size_t dstCapacity;
+    size_t dstSize;
+    size_t result;     /* protected by mt->mutex, valid once done */
+    int done;
+} FIO_DJob_t;
+
+struct FIO_DMT_s {
+    POOL_ctx* pool;
+    ZSTD_pthread_mutex_t mutex;
+    ZSTD_pthread_cond_t cond;
+    ZSTD_DDict* ddict;
+    FIO_DJob_t* jobs;
+    unsigned nbJobs;   /* ring of jobs, 2 per worker */
+    size_t memLimit;
+    size_t keepSize;   /* larger job buffers are released once written */
+    size_t held;       /* sum of the capacities of the job buffers */
+    size_t heldMax;
+};
+
+static void FIO_releaseDJobBuffers(FIO_DJob_t* job, size_t keepSize)
+{
+    FIO_DMT_t* const mt = job->mt;
+    if (job->dstCapacity > keepSize) {
+        free(job->dst);
+        job->dst = NULL;
+        mt->held -= job->dstCapacity;
+        job->dstCapacity = 0;
+    }
+    if (job->srcCapacity > keepSize) {
+        free(job->src);
+        job->src = NULL;
+        mt->held -= job->srcCapacity;
+        job->srcCapacity = 0;
+    }
+}
+
+static void FIO_freeDMT(FIO_DMT_t* mt)
+{
+    unsigned n;
+    if (mt == NULL) return;
+    POOL_free(mt->pool);
+    for (n = 0; n < mt->nbJobs; n++) {
+        ZSTD_freeDCtx(mt->jobs[n].dctx);
+        free(mt->jobs[n].src);
+        free(mt->jobs[n].dst);
+    }
+    free(mt->jobs);
+    ZSTD_freeDDict(mt->ddict);
+    ZSTD_pthread_mutex_destroy(&mt->mutex);
+    ZSTD_pthread_cond_destroy(&mt->cond);
+    free(mt);
+}
+
+static FIO_DMT_t* FIO_createDMT(const FIO_prefs_t* const prefs, const FIO_Dict_t* dict)
+{
+    unsigned const nbWorkers = (unsigned)MIN(prefs->nbWorkers, FIO_DECOMPRESS_NBWORKERS_MAX);
+    FIO_DMT_t* mt;
+    unsigned n;
+
+    if (nbWorkers < 2) return NULL;
+    mt = (FIO_DMT_t*)calloc(1, sizeof(FIO_DMT_t));
+    if (mt == NULL) EXM_THROW(60, "Error: not enough memory for decompression threads");
+    if (ZSTD_pthread_mutex_init(&mt->mutex, NULL) || ZSTD_pthread_cond_init(&mt->cond, NULL))
+        EXM_THROW(60, "Error: can't create decompression threads");
+    mt->nbJobs = nbWorkers * 2;
+    mt->memLimit = prefs->memLimit;
+    mt->keepSize = prefs->memLimit / (2 * mt->nbJobs);
+    mt->jobs = (FIO_DJob_t*)calloc(mt->nbJobs, sizeof(FIO_DJob_t));
+    mt->pool = POOL_create(nbWorkers, mt->nbJobs);
+    if (mt->jobs == NULL || mt->pool == NULL)
+        EXM_THROW(60, "Error: can't create decompression threads");
+    if (dict->dictBufferSize) {
+        mt->ddict = ZSTD_createDDict_byReference(dict->dictBuffer, dict->dictBufferSize);
+        if (mt->ddict == NULL) EXM_THROW(60, "Error: can't load dictionary for decompression threads");
+    }
+    for (n = 0; n < mt->nbJobs; n++) {
+        FIO_DJob_t* const job = &mt->jobs[n];
+        job->mt = mt;
+        job->dctx = ZSTD_createDCtx();
+        if (job->dctx == NULL)
+            EXM_THROW(60, "Error: %s : can't create ZSTD_DCtx", strerror(errno));
+        CHECK( ZSTD_DCtx_setParameter(job->dctx, ZSTD_d_forceIgnoreChecksum, !prefs->checksumFlag) );
+        CHECK( ZSTD_DCtx_refDDict(job->dctx, mt->ddict) );
+    }
+    return mt;
+}
+
 static dRess_t FIO_createDResources(FIO_prefs_t* const prefs, const char* dictFileName)
 {
     int useMMap = prefs->mmapDict == ZSTD_ps_enable;
@@ -2254,6 +2374,10 @@ static dRess_t FIO_createDResources(FIO_prefs_t* const prefs, const char* dictFi
         }
     }
 
+    /* patch-from references are single-use, so they stay on the streaming path */
+    if (!prefs->patchFromMode)
+        ress.mt = FIO_createDMT(prefs, &ress.dict);
+
     ress.writeCtx = AIO_WritePool_create(prefs, ZSTD_DStreamOutSize());
     ress.readCtx = AIO_ReadPool_create(prefs, ZSTD_DStreamInSize());
     return ress;
@@ -2261,6 +2385,7 @@ static dRess_t FIO_createDResources(FIO_prefs_t* const prefs, const char* dictFi
 
 static void FIO_freeDResources(dRess_t ress)
 {
+    FIO_freeDMT(ress.mt);
     FIO_freeDict(&(ress.dict));
     CHECK( ZSTD_freeDStream(ress.dctx) );
     AIO_WritePool_free(ress.writeCtx);
@@ -2324,6 +2449,27 @@ FIO_zstdErrorHelp(const FIO_prefs_t* const prefs,
                     srcFileName, ZSTD_WINDOWLOG_MAX);
 }
 
+static void FIO_displayDecompressionProgress(const FIO_ctx_t* const fCtx,
+                                             const char* srcFileName, U64 decoded)
+{
+    UTIL_HumanReadableSize_t const hrs = UTIL_makeHumanReadableSize(decoded);
+    if (fCtx->nbFilesTotal > 1) {
+        size_t srcFileNameSize = strlen(srcFileName);
+        if (srcFileNameSize > 18) {
+            const char* truncatedSrcFileName = srcFileName + srcFileNameSize - 15;
+            DISPLAYUPDATE_PROGRESS(
+                    "\rDecompress: %2u/%2u files. Current: ...%s : %.*f%s...    ",
+                    fCtx->currFileIdx+1, fCtx->nbFilesTotal, truncatedSrcFileName, hrs.precision, hrs.value, hrs.suffix);
+        } else {
+            DISPLAYUPDATE_PROGRESS("\rDecompress: %2u/%2u files. Current: %s : %.*f%s...    ",
+                        fCtx->currFileIdx+1, fCtx->nbFilesTotal, srcFileName, hrs.precision, hrs.value, hrs.suffix);
+        }
+    } else {
+        DISPLAYUPDATE_PROGRESS("\r%-20.20s : %.*f%s...     ",
+                        srcFileName, hrs.precision, hrs.value, hrs.suffix);
+    }
+}
+
 /** FIO_decompressFrame() :
  *  @return : size of decoded zstd frame, or an error code
  */
@@ -2352,7 +2498,6 @@ FIO_decompressZstdFrame(FIO_ctx_t* const fCtx, dRess_t* ress,
         ZSTD_inBuffer  inBuff = setInBuffer( ress->readCtx->srcBuffer, ress->readCtx->srcBufferLoaded, 0 );
         ZSTD_outBuffer outBuff= setOutBuffer( writeJob->buffer, writeJob->bufferSize, 0 );
         size_t const readSizeHint = ZSTD_decompressStream(ress->dctx, &outBuff, &inBuff);
-        UTIL_HumanReadableSize_t const hrs = UTIL_makeHumanReadableSize(alreadyDecoded+frameSize);
         if (ZSTD_isError(readSizeHint)) {
             DISPLAYLEVEL(1, "%s : Decoding error (36) : %s \n",
                             srcFileName, ZSTD_getErrorName(readSizeHint));
@@ -2365,21 +2510,7 @@ FIO_decompressZstdFrame(FIO_ctx_t* const fCtx, dRess_t* ress,
         writeJob->usedBufferSize = outBuff.pos;
         AIO_WritePool_enqueueAndReacquireWriteJob(&writeJob);
         frameSize += outBuff.pos;
-        if (fCtx->nbFilesTotal > 1) {
-            size_t srcFileNameSize = strlen(srcFileName);
-            if (srcFileNameSize > 18) {
-                const char* truncatedSrcFileName = srcFileName + srcFileNameSize - 15;
-                DISPLAYUPDATE_PROGRESS(
-                        "\rDecompress: %2u/%2u files. Current: ...%s : %.*f%s...    ",
-                        fCtx->currFileIdx+1, fCtx->nbFilesTotal, truncatedSrcFileName, hrs.precision, hrs.value, hrs.suffix);
-            } else {
-                DISPLAYUPDATE_PROGRESS("\rDecompress: %2u/%2u files. Current: %s : %.*f%s...    ",
-                            fCtx->currFileIdx+1, fCtx->nbFilesTotal, srcFileName, hrs.precision, hrs.value, hrs.suffix);
-            }
-        } else {
-            DISPLAYUPDATE_PROGRESS("\r%-20.20s : %.*f%s...     ",
-                            srcFileName, hrs.precision, hrs.value, hrs.suffix);
-        }
+        FIO_displayDecompressionProgress(fCtx, srcFileName, alreadyDecoded+frameSize);
 
         AIO_ReadPool_consumeBytes(ress->readCtx, inBuff.pos);
 
@@ -2403,6 +2534,318 @@ FIO_decompressZstdFrame(FIO_ctx_t* const fCtx, dRess_t* ress,
     return frameSize;
 }
 
+static void FIO_decompressDJob(void* opaque)
+{
+    FIO_DJob_t* const job = (FIO_DJob_t*)opaque;
+    size_t const result = ZSTD_decompressDCtx(job->dctx, job->dst, job->dstSize,
+                                              job->src, job->srcSize);
+    ZSTD_pthread_mutex_lock(&job->mt->mutex);
+    job->result = result;
+    job->done = 1;
+    ZSTD_pthread_cond_broadcast(&job->mt->cond);
+    ZSTD_pthread_mutex_unlock(&job->mt->mutex);
+}
+
+#define FIO_DJOB_WAIT 2
+
+/** FIO_readZstdFrameMT() :
+ *  Check whether the next frame can be decoded by a worker : a zstd frame
+ *  which declares its decompressed size, within the memory limit.
+ *  If so, move it whole from the read pool into `job`.
+ *  `alone` tells that no other frame is in flight.
+ * @return : 1 if the frame was read, 0 if it is left in the read pool,
+ *           FIO_DJOB_WAIT if it is left until frames in flight are written,
+ *           -1 if it is truncated or corrupted */
+static int FIO_readZstdFrameMT(dRess_t* ress, const FIO_prefs_t* const prefs,
+                               FIO_DJob_t* job, int alone, const char* srcFileName)
+{
+    ReadPoolCtx_t* const readCtx = ress->readCtx;
+    FIO_DMT_t* const mt = job->mt;
+    ZSTD_frameHeader header;
+    size_t prior = 0;
+
+    AIO_ReadPool_fillBuffer(readCtx, ZSTD_FRAMEHEADERSIZE_MAX);
+    if (readCtx->srcBufferLoaded < 4
+      || !ZSTD_isFrame(readCtx->srcBuffer, readCtx->srcBufferLoaded)
+      || ZSTD_getFrameHeader(&header, readCtx->srcBuffer, readCtx->srcBufferLoaded) != 0
+      || header.frameType != ZSTD_frame
+      || header.frameContentSize == ZSTD_CONTENTSIZE_UNKNOWN
+      || header.frameContentSize > prefs->memLimit
+      || header.windowSize > prefs->memLimit)
+        return 0;
+
+    job->dstSize = (size_t)header.frameContentSize;
+    if (job->dstCapacity < job->dstSize) {
+        if (mt->held - job->dstCapacity + job->dstSize > mt->memLimit) {
+            unsigned n;
+            if (!alone) return FIO_DJOB_WAIT;
+            /* all jobs are idle : their buffers can go */
+            for (n = 0; n < mt->nbJobs; n++)
+                FIO_releaseDJobBuffers(&mt->jobs[n], 0);
+        }
+        free(job->dst);
+        mt->held -= job->dstCapacity;
+        job->dst = (BYTE*)malloc(job->dstSize);
+        if (job->dst == NULL) EXM_THROW(61, "Allocation error : not enough memory");
+        job->dstCapacity = job->dstSize;
+        mt->held += job->dstCapacity;
+    }
+
+    /* append input until the whole frame is there, and leave what follows it */
+    for ( ; ; ) {
+        size_t const loaded = readCtx->srcBufferLoaded;
+        size_t frameSize;
+        if (loaded == 0) {
+            DISPLAYLEVEL(1, "%s : Read error (39) : premature end \n", srcFileName);
+            return -1;
+        }
+        if (job->srcCapacity < prior + loaded) {
+            size_t const capacity = MAX(prior + loaded, job->srcCapacity * 2);
+            BYTE* const src = (BYTE*)realloc(job->src, capacity);
+            if (src == NULL) EXM_THROW(61, "Allocation error : not enough memory");
+            job->src = src;
+            mt->held += capacity - job->srcCapacity;
+            job->srcCapacity = capacity;
+        }
+        mt->heldMax = MAX(mt->heldMax, mt->held);
+        memcpy(job->src + prior, readCtx->srcBuffer, loaded);
+        frameSize = ZSTD_findFrameCompressedSize(job->src, prior + loaded);
+        if (!ZSTD_isError(frameSize)) {
+            assert(frameSize > prior);
+            AIO_ReadPool_consumeBytes(readCtx, frameSize - prior);
+            job->srcSize = frameSize;
+            return 1;
+        }
+        if (ZSTD_getErrorCode(frameSize) != ZSTD_error_srcSize_wrong) {
+            DISPLAYLEVEL(1, "%s : Decoding error (36) : %s \n",
+                            srcFileName, ZSTD_getErrorName(frameSize));
+            return -1;
+        }
+        AIO_ReadPool_consumeBytes(readCtx, loaded);
+        prior += loaded;
+        AIO_ReadPool_fillBuffer(readCtx, readCtx->base.jobBufferSize);
+    }
+}
+
+static void FIO_writeDJob(dRess_t* ress, const FIO_DJob_t* job)
+{
+    IOJob_t* writeJob = AIO_WritePool_acquireJob(ress->writeCtx);
+    size_t pos = 0;
+    while (pos < job->dstSize) {
+        size_t const size = MIN(writeJob->bufferSize, job->dstSize - pos);
+        memcpy(writeJob->buffer, job->dst + pos, size);
+        writeJob->usedBufferSize = size;
+        AIO_WritePool_enqueueAndReacquireWriteJob(&writeJob);
+        pos += size;
+    }
+    AIO_WritePool_releaseIoJob(writeJob);
+}
+
+/** FIO_decompressZstdFramesMT() :
+ *  Decode the run of frames at the current input position which workers can
+ *  decode (see FIO_readZstdFrameMT()), with up to 2 frames per worker in
+ *  flight, and write them in order.  If the first frame is not one of them,
+ *  decode it with FIO_decompressZstdFrame() instead.
+ *  @return : size of decoded frames, or FIO_ERROR_FRAME_DECODING */
+static unsigned long long
+FIO_decompressZstdFramesMT(FIO_ctx_t* const fCtx, dRess_t* ress,
+                           const FIO_prefs_t* const prefs,
+                           const char* srcFileName,
+                           U64 alreadyDecoded)
+{
+    FIO_DMT_t* const mt = ress->mt;
+    const char* const fullSrcFileName = srcFileName;
+    unsigned next = 0;     /* frames handed out */
+    unsigned waiting = 0;  /* frames written */
+    int more = 1;
+    int full = 0;         /* the next frame waits for memory */
+    int readError = 0;    /* the frames before it are still written */
+    int error = 0;
+    U64 decoded = 0;
+
+    /* display last 20 characters only */
+    {   size_t const srcFileLength = strlen(srcFileName);
+        if (srcFileLength>20) srcFileName += srcFileLength-20;
+    }
+
+    while (waiting < next || (more && !error)) {
+        if (more && !error && !full && next - waiting < mt->nbJobs) {
+            FIO_DJob_t* const job = &mt->jobs[next % mt->nbJobs];
+            int const ret = FIO_readZstdFrameMT(ress, prefs, job, next == waiting, srcFileName);
+            if (ret == FIO_DJOB_WAIT) {
+                full = 1;
+                continue;
+            }
+            if (ret <= 0) {
+                more = 0;
+                readError = ret < 0;
+                continue;
+            }
+            job->done = 0;
+            next++;
+            POOL_add(mt->pool, FIO_decompressDJob, job);
+        } else {
+            FIO_DJob_t* const job = &mt->jobs[waiting % mt->nbJobs];
+            size_t result;
+            ZSTD_pthread_mutex_lock(&mt->mutex);
+            while (!job->done) ZSTD_pthread_cond_wait(&mt->cond, &mt->mutex);
+            result = job->result;
+            ZSTD_pthread_mutex_unlock(&mt->mutex);
+            waiting++;
+            full = 0;
+            if (!error && ZSTD_isError(result)) {
+                DISPLAYLEVEL(1, "%s : Decoding error (36) : %s \n",
+                                srcFileName, ZSTD_getErrorName(result));
+                error = 1;
+            }
+            if (!error) FIO_writeDJob(ress, job);
+            FIO_releaseDJobBuffers(job, mt->keepSize);
+            if (error) continue;
+            decoded += job->dstSize;
+            FIO_displayDecompressionProgress(fCtx, srcFileName, alreadyDecoded+decoded);
+        }
+    }
+    AIO_WritePool_sparseWriteEnd(ress->writeCtx);
+    if (next)
+        DISPLAYLEVEL(4, "%s : %u frames decoded by workers, %u KB of buffers at most \n",
+                        srcFileName, next, (unsigned)(mt->heldMax >> 10));
+
+    if (error || readError) return FIO_ERROR_FRAME_DECODING;
+    if (next == 0)
+        return FIO_decompressZstdFrame(fCtx, ress, prefs, fullSrcFileName, alreadyDecoded);
+    return decoded;
+}
+
+
+/** FIO_decompressStoredFrame() :
+ *  Frames made only of raw and RLE blocks, as produced for incompressible data, don't need
+ *  a decoder when no checksum has to be verified (no checksum, or --no-check) : raw blocks
+ *  are copied from the source file to the destination within the kernel when both support
+ *  it (copy_file_range), and RLE blocks are expanded directly.  Such frames are recognized
+ *  by reading their block headers at explicit offsets, so only seekable sources qualify.
+ *  @return : size of decoded frame, FIO_ERROR_FRAME_DECODING,
+ *            or FIO_FRAME_NOT_STORED, in which case nothing was consumed nor written */
+#define FIO_FRAME_NOT_STORED   ((unsigned long long)(-3))
+static unsigned long long
+FIO_decompressStoredFrame(FIO_ctx_t* const fCtx, dRess_t* ress,
+                          const FIO_prefs_t* const prefs,
+                          const char* srcFileName,
+                          U64 alreadyDecoded)
+{
+    ReadPoolCtx_t* const readCtx = ress->readCtx;
+    U64 const frameStart = AIO_ReadPool_tell(readCtx);
+    ZSTD_frameHeader header;
+    U64 frameEnd = 0;
+    U64 frameSize = 0;
+    int pass;
+
+    if (prefs->testMode || !readCtx->seekable)
+        return FIO_FRAME_NOT_STORED;
+    AIO_ReadPool_fillBuffer(readCtx, ZSTD_FRAMEHEADERSIZE_MAX);
+    if ( ZSTD_getFrameHeader(&header, readCtx->srcBuffer, readCtx->srcBufferLoaded) != 0
+      || header.frameType != ZSTD_frame
+      || header.dictID != 0
+      || header.windowSize > prefs->memLimit
+      || (header.checksumFlag && prefs->checksumFlag) )
+        return FIO_FRAME_NOT_STORED;
+
+    /* display last 20 characters only */
+    {   size_t const srcFileLength = strlen(srcFileName);
+        if (srcFileLength>20) srcFileName += srcFileLength-20;
+    }
+
+    /* pass 0 checks that all blocks are raw or RLE, pass 1 writes them */
+    for (pass = 0; pass < 2; pass++) {
+        IOJob_t* writeJob = pass ? AIO_WritePool_acquireJob(ress->writeCtx) : NULL;
+        int kernelCopy = 1;
+        int lastBlock = 0;
+        U64 pos = frameStart + header.headerSize;
+        frameSize = 0;
+        while (!lastBlock) {
+            BYTE blockHeader[4];   /* 3-byte block header, and the byte of RLE blocks */
+            size_t const headerRead = AIO_ReadPool_readAt(readCtx, blockHeader, sizeof(blockHeader), pos);
+            U32 bh;
+            size_t blockSize;
+            if (headerRead < 3) {
+                assert(pass == 0);
+                return FIO_FRAME_NOT_STORED;
+            }
+            bh = MEM_readLE24(blockHeader);
+            lastBlock = bh & 1;
+            blockSize = bh >> 3;
+            if (blockSize > header.blockSizeMax) {
+                assert(pass == 0);
+                return FIO_FRAME_NOT_STORED;
+            }
+            switch ((bh >> 1) & 3) {
+            case 0:  /* raw */
+                if (pass) {
+                    U64 const src = pos + 3;
+                    size_t done = 0;
+                    if (kernelCopy && blockSize > 0) {
+                        if (writeJob->usedBufferSize > 0)
+                            AIO_WritePool_enqueueAndReacquireWriteJob(&writeJob);
+                        done = AIO_WritePool_copyFromFile(ress->writeCtx, readCtx, src, blockSize);
+                        kernelCopy = (done == blockSize);
+                    }
+                    while (done < blockSize) {
+                        size_t const size = MIN(blockSize - done, writeJob->bufferSize - writeJob->usedBufferSize);
+                        if (AIO_ReadPool_readAt(readCtx, (BYTE*)writeJob->buffer + writeJob->usedBufferSize, size, src + done) != size) {
+                            DISPLAYLEVEL(1, "%s : Read error (39) : premature end \n", srcFileName);
+                            AIO_WritePool_releaseIoJob(writeJob);
+                            return FIO_ERROR_FRAME_DECODING;
+                        }
+                        writeJob->usedBufferSize += size;
+                        done += size;
+                        if (writeJob->usedBufferSize == writeJob->bufferSize)
+                            AIO_WritePool_enqueueAndReacquireWriteJob(&writeJob);
+                }   }
+                pos += 3 + blockSize;
+                break;
+            case 1:  /* RLE */
+                if (headerRead < 4) {
+                    assert(pass == 0);
+                    return FIO_FRAME_NOT_STORED;
+                }
+                if (pass) {
+                    size_t done = 0;
+                    while (done < blockSize) {
+                        size_t const size = MIN(blockSize - done, writeJob->bufferSize - writeJob->usedBufferSize);
+                        memset((BYTE*)writeJob->buffer + writeJob->usedBufferSize, blockHeader[3], size);
+                        writeJob->usedBufferSize += size;
+                        done += size;
+                        if (writeJob->usedBufferSize == writeJob->bufferSize)
+                            AIO_WritePool_enqueueAndReacquireWriteJob(&writeJob);
+                }   }
+                pos += 3 + 1;
+                break;
+            default:  /* compressed or reserved : needs the decoder */
+                assert(pass == 0);
+                return FIO_FRAME_NOT_STORED;
+            }
+            frameSize += blockSize;
+            if (pass) FIO_displayDecompressionProgress(fCtx, srcFileName, alreadyDecoded+frameSize);
+        }
+        if (header.checksumFlag) pos += 4;
+        frameEnd = pos;
+
+        if (pass == 0) {
+            /* leave truncated and inconsistent frames to the decoder, to report them */
+            if ( (header.frameContentSize != ZSTD_CONTENTSIZE_UNKNOWN && header.frameContentSize != frameSize)
+              || readCtx->fileStart + frameEnd > readCtx->fileSize )
+                return FIO_FRAME_NOT_STORED;
+            DISPLAYLEVEL(6, "FIO_decompressStoredFrame: %s : frame of raw and RLE blocks \n", srcFileName);
+        } else {
+            if (writeJob->usedBufferSize > 0)
+                AIO_WritePool_enqueueAndReacquireWriteJob(&writeJob);
+            AIO_WritePool_releaseIoJob(writeJob);
+        }
+    }
+
+    AIO_WritePool_sparseWriteEnd(ress->writeCtx);
+    AIO_ReadPool_skipBytes(readCtx, frameEnd - frameStart);
+    return frameSize;
+}
 
 #ifdef ZSTD_GZDECOMPRESS
 static unsigned long long
@@ -2660,7 +3103,11 @@ static int FIO_decompressFrames(FIO_ctx_t* const fCtx,
             return 1;
         }
         if (ZSTD_isFrame(buf, ress.readCtx->srcBufferLoaded)) {
-            unsigned long long const frameSize = FIO_decompressZstdFrame(fCtx, &ress, prefs, srcFileName, filesize);
+            unsigned long long frameSize = FIO_decompressStoredFrame(fCtx, &ress, prefs, srcFileName, filesize);
+            if (frameSize == FIO_FRAME_NOT_STORED)
+                frameSize = ress.mt != NULL ?
+                    FIO_decompressZstdFramesMT(fCtx, &ress, prefs, srcFileName, filesize) :
+                    FIO_decompressZstdFrame(fCtx, &ress, prefs, srcFileName, filesize);
             if (frameSize == FIO_ERROR_FRAME_DECODING) return 1;
             filesize += frameSize;
         } else if (buf[0] == 31 && buf[1] == 139) { /* gz magic number */
@@ -8,6 +8,9 @@
  * You may select, at your option, one of the above-listed licenses.
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#  define _GNU_SOURCE   /* syscall(), MAP_POPULATE, SEEK_DATA, loff_t */
+#endif
 #include "platform.h"
 #include <stdio.h>      /* fprintf, open, fdopen, fread, _fileno, stdin, stdout */
 #include <stdlib.h>     /* malloc, free */
@@ -125,6 +128,83 @@ AIO_fwriteSparseEnd(const FIO_prefs_t* const prefs, FILE* file, unsigned storedS
 }
 
 
+/* **********************************************************************
+ *  Positioned and sparse reads
+ ************************************************************************/
+
+#if !defined(_WIN32) && (PLATFORM_POSIX_VERSION >= 200112L)
+#  include <unistd.h>      /* pread, lseek */
+#  define AIO_PREAD 1
+#else
+#  define AIO_PREAD 0
+#endif
+
+#if AIO_PREAD && defined(SEEK_DATA) && defined(SEEK_HOLE)
+#  define AIO_SPARSE_READ 1
+#else
+#  define AIO_SPARSE_READ 0
+#endif
+
+#if AIO_PREAD && defined(__linux__)
+#  include <sys/syscall.h>  /* __NR_copy_file_range */
+#  ifdef __NR_copy_file_range
+#    define AIO_COPY_FILE_RANGE 1
+#  endif
+#endif
+#ifndef AIO_COPY_FILE_RANGE
+#  define AIO_COPY_FILE_RANGE 0
+#endif
+
+#if AIO_PREAD
+/** AIO_pread() :
+ *  Reads up to size bytes at offset, fewer only at end of file.
+ *  @return : number of bytes read */
+static size_t AIO_pread(int fd, void* buffer, size_t size, U64 offset)
+{
+    size_t done = 0;
+    while (done < size) {
+        ssize_t const ret = pread(fd, (char*)buffer + done, size - done, (off_t)(offset + done));
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            EXM_THROW(37, "Read error : %s", strerror(errno));
+        }
+        if (ret == 0) break;
+        done += (size_t)ret;
+    }
+    return done;
+}
+#endif
+
+#if AIO_SPARSE_READ
+/** AIO_preadSparse() :
+ *  Same as AIO_pread() on a file of fileSize bytes, except that holes are filled with zeros
+ *  instead of being read, so that sparse disk images don't cost a read for each zero page.
+ *  @return : number of bytes read */
+static size_t AIO_preadSparse(int fd, void* buffer, size_t size, U64 offset, U64 fileSize)
+{
+    size_t done = 0;
+    while (done < size) {
+        U64 const pos = offset + done;
+        off_t data = lseek(fd, (off_t)pos, SEEK_DATA);
+        if (data < 0)   /* ENXIO : only a hole up to the end of file after pos */
+            data = (off_t)((errno == ENXIO) ? MAX(fileSize, pos) : pos);
+        if ((U64)data > pos) {
+            size_t const holeSize = (size_t)MIN((U64)(size - done), (U64)data - pos);
+            memset((char*)buffer + done, 0, holeSize);
+            done += holeSize;
+        } else {
+            off_t const hole = lseek(fd, (off_t)pos, SEEK_HOLE);
+            size_t const dataSize = (hole > data) ? (size_t)MIN((U64)(size - done), (U64)hole - pos) : size - done;
+            size_t const readSize = AIO_pread(fd, (char*)buffer + done, dataSize, pos);
+            done += readSize;
+            if (readSize < dataSize) break;
+        }
+    }
+    return done;
+}
+#endif
+
+
 /* **********************************************************************
  *  AsyncIO functionality
  ************************************************************************/
@@ -139,6 +219,422 @@ int AIO_supported(void) {
 #endif
 }
 
+/* **********************************************************************
+ *  io_uring backend
+ ************************************************************************/
+
+#if defined(__linux__) && defined(ZSTD_MULTITHREAD) && !defined(ZSTD_NO_IO_URING) && defined(__has_include)
+#  if __has_include(<linux/io_uring.h>)
+#    include <linux/io_uring.h>
+#    include <sys/mman.h>       /* mmap, munmap */
+#    include <sys/syscall.h>    /* __NR_io_uring_setup, __NR_io_uring_enter, __NR_io_uring_register */
+#    include <sys/uio.h>        /* struct iovec */
+#    include <sys/stat.h>       /* fstat, S_ISREG */
+#    include <fcntl.h>          /* fcntl, O_APPEND */
+#    include <unistd.h>         /* syscall, pread, close */
+#    if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(__NR_io_uring_register)
+#      define AIO_IO_URING 1
+#    endif
+#  endif
+#endif
+#ifndef AIO_IO_URING
+#  define AIO_IO_URING 0
+#endif
+
+#if AIO_IO_URING
+
+/* The thread pool implementation serializes all I/O of a pool on its worker thread.
+ * With io_uring, jobs are submitted from the calling thread at explicit file offsets,
+ * into buffers registered once with the kernel, and reaped whenever the caller needs a
+ * buffer back. Read completions can come in any order, which the ReadPool already
+ * supports. Writes in sparse mode skip all-zero 32 KB segments, as AIO_fwriteSparse()
+ * does, so a job can be split in several operations. */
+
+#define AIO_URING_SEGMENT_SIZE (32 KB)
+
+struct AIO_uring_s {
+    int fd;
+    int isWrite;
+    WritePoolCtx_t* writePool;   /* the pool that owns the ring, for writes */
+    ReadPoolCtx_t* readPool;     /* the pool that owns the ring, for reads */
+    unsigned sqEntries;
+    unsigned* sqHead;
+    unsigned* sqTail;
+    unsigned* sqMask;
+    unsigned* sqArray;
+    struct io_uring_sqe* sqes;
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned* cqMask;
+    struct io_uring_cqe* cqes;
+    void* sqRing;
+    size_t sqRingSize;
+    void* cqRing;
+    size_t cqRingSize;
+    size_t sqesSize;
+    unsigned toSubmit;
+    unsigned inFlight;
+
+    /* Jobs of the pool. The index of a job is the index of its registered buffer. */
+    IOJob_t* jobs[MAX_IO_JOBS];
+    int nbJobs;
+    unsigned pendingOps[MAX_IO_JOBS];
+
+    /* State of the current file, set on the first submission and reset once drained */
+    int started;
+    int fileFd;
+    U64 base;        /* reads : file position of the pool's offset 0 */
+    U64 cursor;      /* writes : file position after the last queued byte */
+    U64 writtenEnd;  /* writes : file position after the last byte actually written */
+};
+
+static void AIO_IOPool_releaseIoJob(IOJob_t* job);
+static void AIO_ReadPool_addJobToCompleted(IOJob_t* job);
+
+static int AIO_uring_enter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, NULL, 0);
+}
+
+static void AIO_uring_free(struct AIO_uring_s* ring) {
+    if (!ring) return;
+    if (ring->sqes) munmap(ring->sqes, ring->sqesSize);
+    if (ring->cqRing && ring->cqRing != ring->sqRing) munmap(ring->cqRing, ring->cqRingSize);
+    if (ring->sqRing) munmap(ring->sqRing, ring->sqRingSize);
+    close(ring->fd);
+    free(ring);
+}
+
+static void* AIO_uring_mmap(int fd, size_t size, off_t offset) {
+    void* const ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+    return ptr == MAP_FAILED ? NULL : ptr;
+}
+
+/* AIO_uring_create:
+ * Sets up an io_uring instance for the pool and registers the buffers of all its jobs,
+ * which must all be available. Returns NULL if the kernel doesn't allow it, in which
+ * case the pool keeps using its thread pool. `ctx` is the base of the owning pool,
+ * which is either `writePool` or `readPool`; the other one is NULL. */
+static struct AIO_uring_s* AIO_uring_create(IOPoolCtx_t* ctx, WritePoolCtx_t* writePool, ReadPoolCtx_t* readPool) {
+    int const isWrite = writePool != NULL;
+    struct AIO_uring_s* ring;
+    struct io_uring_params params;
+    struct iovec iov[MAX_IO_JOBS];
+    /* In sparse mode, a job is written in at most one operation per two segments */
+    unsigned const opsPerJob = (unsigned)(ctx->jobBufferSize / (2 * AIO_URING_SEGMENT_SIZE)) + 1;
+    unsigned entries = (unsigned)ctx->totalIoJobs * opsPerJob;
+    int fd;
+    int i;
+
+    assert(ctx->availableJobsCount == ctx->totalIoJobs);
+    if (entries > 4096) entries = 4096;
+    memset(&params, 0, sizeof(params));
+    fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (fd < 0) return NULL;
+
+    ring = (struct AIO_uring_s*)malloc(sizeof(*ring));
+    if (!ring) EXM_THROW(100, "Allocation error : not enough memory");
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = fd;
+    ring->isWrite = isWrite;
+    ring->writePool = writePool;
+    ring->readPool = readPool;
+    ring->sqEntries = params.sq_entries;
+    ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cqRingSize > ring->sqRingSize) ring->sqRingSize = ring->cqRingSize;
+        ring->cqRingSize = ring->sqRingSize;
+    }
+    ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqRing = AIO_uring_mmap(fd, ring->sqRingSize, IORING_OFF_SQ_RING);
+    ring->cqRing = (params.features & IORING_FEAT_SINGLE_MMAP) ? ring->sqRing
+                 : AIO_uring_mmap(fd, ring->cqRingSize, IORING_OFF_CQ_RING);
+    ring->sqes = (struct io_uring_sqe*)AIO_uring_mmap(fd, ring->sqesSize, IORING_OFF_SQES);
+    if (!ring->sqRing || !ring->cqRing || !ring->sqes) {
+        AIO_uring_free(ring);
+        return NULL;
+    }
+    {   char* const sq = (char*)ring->sqRing;
+        char* const cq = (char*)ring->cqRing;
+        ring->sqHead = (unsigned*)(void*)(sq + params.sq_off.head);
+        ring->sqTail = (unsigned*)(void*)(sq + params.sq_off.tail);
+        ring->sqMask = (unsigned*)(void*)(sq + params.sq_off.ring_mask);
+        ring->sqArray = (unsigned*)(void*)(sq + params.sq_off.array);
+        ring->cqHead = (unsigned*)(void*)(cq + params.cq_off.head);
+        ring->cqTail = (unsigned*)(void*)(cq + params.cq_off.tail);
+        ring->cqMask = (unsigned*)(void*)(cq + params.cq_off.ring_mask);
+        ring->cqes = (struct io_uring_cqe*)(void*)(cq + params.cq_off.cqes);
+    }
+
+    ring->nbJobs = ctx->totalIoJobs;
+    for (i = 0; i < ring->nbJobs; i++) {
+        IOJob_t* const job = (IOJob_t*)ctx->availableJobs[i];
+        ring->jobs[i] = job;
+        iov[i].iov_base = job->buffer;
+        iov[i].iov_len = job->bufferSize;
+    }
+    if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, iov, (unsigned)ring->nbJobs) < 0) {
+        AIO_uring_free(ring);
+        return NULL;
+    }
+    DISPLAYLEVEL(6, "AIO_uring_create: io_uring enabled for %s \n", isWrite ? "writes" : "reads");
+    return ring;
+}
+
+/* AIO_uring_supportsFile:
+ * Returns 1 if the file can be accessed at explicit offsets : a regular file, not in append mode. */
+static int AIO_uring_supportsFile(FILE* file) {
+    int const fd = fileno(file);
+    struct stat st;
+    int flags;
+    if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) return 0;
+    flags = fcntl(fd, F_GETFL);
+    return flags >= 0 && !(flags & O_APPEND);
+}
+
+static int AIO_uring_jobIndex(const struct AIO_uring_s* ring, const IOJob_t* job) {
+    int i;
+    for (i = 0; i < ring->nbJobs; i++)
+        if (ring->jobs[i] == job) return i;
+    assert(0);
+    return -1;
+}
+
+static void AIO_uring_submit(struct AIO_uring_s* ring) {
+    while (ring->toSubmit > 0) {
+        int const ret = AIO_uring_enter(ring->fd, ring->toSubmit, 0, 0);
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            EXM_THROW(105, "io_uring submission error : %s", strerror(errno));
+        }
+        ring->toSubmit -= (unsigned)ret;
+    }
+}
+
+/* AIO_uring_prep:
+ * Queues an operation on the registered buffer of job `index`. Submitted on the next AIO_uring_submit(). */
+static void AIO_uring_prep(struct AIO_uring_s* ring, U8 opcode, int index,
+                           const void* buffer, size_t size, U64 offset) {
+    unsigned const tail = *ring->sqTail;
+    unsigned const idx = tail & *ring->sqMask;
+    struct io_uring_sqe* const sqe = &ring->sqes[idx];
+    if (tail - __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE) >= ring->sqEntries)
+        AIO_uring_submit(ring);
+    assert(tail - __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE) < ring->sqEntries);
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = ring->fileFd;
+    sqe->off = offset;
+    sqe->addr = (U64)(size_t)buffer;
+    sqe->len = (U32)size;
+    sqe->buf_index = (U16)index;
+    /* The operation's size is needed to detect short reads and writes on completion */
+    sqe->user_data = ((U64)size << 8) | (U64)index;
+    ring->sqArray[idx] = idx;
+    __atomic_store_n(ring->sqTail, tail + 1, __ATOMIC_RELEASE);
+    ring->toSubmit++;
+    ring->inFlight++;
+}
+
+/* AIO_uring_readCompleted:
+ * Completes a short read synchronously, as a regular file only reads short at its end. */
+static void AIO_uring_readCompleted(ReadPoolCtx_t* ctx, IOJob_t* job, int res, size_t size) {
+    const struct AIO_uring_s* const ring = ctx->base.uring;
+    size_t done;
+    if (res < 0) EXM_THROW(37, "Read error : %s", strerror(-res));
+    done = (size_t)res;
+    if (done < size)
+        done += AIO_pread(ring->fileFd, (char*)job->buffer + done, size - done, ring->base + job->offset + done);
+    if (done < size) ctx->reachedEof = 1;
+    job->usedBufferSize = done;
+    AIO_ReadPool_addJobToCompleted(job);
+}
+
+static void AIO_uring_writeCompleted(WritePoolCtx_t* ctx, int index, int res, size_t size) {
+    struct AIO_uring_s* const ring = ctx->base.uring;
+    if (res < 0)
+        EXM_THROW(70, "Write error : cannot write block : %s", strerror(-res));
+    if ((size_t)res != size)
+        EXM_THROW(70, "Write error : cannot write block : short write");
+    assert(ring->pendingOps[index] > 0);
+    if (--ring->pendingOps[index] == 0)
+        AIO_IOPool_releaseIoJob(ring->jobs[index]);
+}
+
+/* AIO_uring_reap:
+ * Processes all available completions. If `wait` is set and none is available,
+ * blocks until at least one operation completes, unless none is in flight. */
+static void AIO_uring_reap(IOPoolCtx_t* ctx, int wait) {
+    struct AIO_uring_s* const ring = ctx->uring;
+    for (;;) {
+        unsigned head = *ring->cqHead;
+        unsigned const tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+        if (head != tail) {
+            for ( ; head != tail; head++) {
+                const struct io_uring_cqe* const cqe = &ring->cqes[head & *ring->cqMask];
+                U64 const userData = cqe->user_data;
+                int const res = cqe->res;
+                int const index = (int)(userData & 0xFF);
+                size_t const size = (size_t)(userData >> 8);
+                __atomic_store_n(ring->cqHead, head + 1, __ATOMIC_RELEASE);
+                ring->inFlight--;
+                if (ring->isWrite)
+                    AIO_uring_writeCompleted(ring->writePool, index, res, size);
+                else
+                    AIO_uring_readCompleted(ring->readPool, ring->jobs[index], res, size);
+            }
+            return;
+        }
+        if (!wait || ring->inFlight == 0) return;
+        {   int const ret = AIO_uring_enter(ring->fd, ring->toSubmit, 1, IORING_ENTER_GETEVENTS);
+            if (ret < 0) {
+                if (errno == EINTR) continue;
+                EXM_THROW(105, "io_uring wait error : %s", strerror(errno));
+            }
+            ring->toSubmit -= (unsigned)ret;
+    }   }
+}
+
+/* AIO_uring_drain:
+ * Waits for all operations in flight, then leaves the file position where the thread pool
+ * implementation would have it, so that synchronous I/O can take over. */
+static void AIO_uring_drain(IOPoolCtx_t* ctx) {
+    struct AIO_uring_s* const ring = ctx->uring;
+    while (ring->inFlight > 0)
+        AIO_uring_reap(ctx, 1);
+    if (!ring->started) return;
+    ring->started = 0;
+    if (ring->isWrite) {
+        /* Bytes skipped at the end become pending skips of the sparse writer */
+        U64 skip = ring->cursor - ring->writtenEnd;
+        if (skip > 1 GB) skip = 1 GB;
+        if (LONG_SEEK(ctx->file, (off_t)(ring->cursor - skip), SEEK_SET) != 0)
+            EXM_THROW(92, "Sparse skip error ; try --no-sparse");
+        ring->writePool->storedSkips += (unsigned)skip;
+    } else {
+        if (LONG_SEEK(ctx->file, (off_t)(ring->base + ring->readPool->nextReadOffset), SEEK_SET) != 0)
+            EXM_THROW(37, "Seek error : %s", strerror(errno));
+    }
+}
+
+static U64 AIO_uring_filePosition(FILE* file) {
+    off_t const pos = LONG_TELL(file);
+    if (pos < 0) EXM_THROW(37, "Seek error : %s", strerror(errno));
+    return (U64)pos;
+}
+
+/* AIO_uring_read:
+ * Submits a read of a full job buffer at the job's offset.
+ * Jobs entirely within a hole of a sparse file are completed right away. */
+static void AIO_uring_read(ReadPoolCtx_t* ctx, IOJob_t* job) {
+    struct AIO_uring_s* const ring = ctx->base.uring;
+    if (!ring->started) {
+        ring->fileFd = fileno(job->file);
+        ring->base = AIO_uring_filePosition(job->file) - job->offset;
+        ring->started = 1;
+    }
+#if AIO_SPARSE_READ
+    if (ctx->srcHoles) {
+        U64 const offset = ring->base + job->offset;
+        off_t const data = lseek(ring->fileFd, (off_t)offset, SEEK_DATA);
+        if ((data < 0 && errno == ENXIO) || (data >= 0 && (U64)data >= offset + job->bufferSize)) {
+            job->usedBufferSize = AIO_preadSparse(ring->fileFd, job->buffer, job->bufferSize, offset, ctx->fileSize);
+            if (job->usedBufferSize < job->bufferSize) ctx->reachedEof = 1;
+            AIO_ReadPool_addJobToCompleted(job);
+            return;
+    }   }
+#endif
+    AIO_uring_prep(ring, IORING_OP_READ_FIXED, AIO_uring_jobIndex(ring, job),
+                   job->buffer, job->bufferSize, ring->base + job->offset);
+    AIO_uring_submit(ring);
+}
+
+static int AIO_uring_isZeroes(const void* buffer, size_t size) {
+    const size_t* const bufferT = (const size_t*)buffer;   /* Buffer is supposed malloc'ed, hence aligned on size_t */
+    size_t const sizeT = size / sizeof(size_t);
+    const char* const rest = (const char*)(bufferT + sizeT);
+    size_t i;
+    for (i = 0; i < sizeT; i++)
+        if (bufferT[i]) return 0;
+    for (i = 0; i < size % sizeof(size_t); i++)
+        if (rest[i]) return 0;
+    return 1;
+}
+
+/* AIO_uring_write:
+ * Submits the writes of a job, skipping its all-zero segments in sparse mode.
+ * The job is released once all of them complete. */
+static void AIO_uring_write(WritePoolCtx_t* ctx, IOJob_t* job) {
+    struct AIO_uring_s* const ring = ctx->base.uring;
+    int const index = AIO_uring_jobIndex(ring, job);
+    const U8* const buffer = (const U8*)job->buffer;
+    size_t const size = job->usedBufferSize;
+    unsigned nbOps = 0;
+
+    if (!ring->started) {
+        /* Take over the position and pending skips of the synchronous writer */
+        if (fflush(job->file) != 0)
+            EXM_THROW(70, "Write error : cannot write block : %s", strerror(errno));
+        ring->fileFd = fileno(job->file);
+        ring->writtenEnd = AIO_uring_filePosition(job->file);
+        ring->cursor = ring->writtenEnd + ctx->storedSkips;
+        ctx->storedSkips = 0;
+        ring->started = 1;
+    }
+
+    if (!ctx->base.prefs->sparseFileSupport) {
+        if (size > 0) {
+            AIO_uring_prep(ring, IORING_OP_WRITE_FIXED, index, job->buffer, size, ring->cursor);
+            ring->writtenEnd = ring->cursor + size;
+            nbOps++;
+        }
+    } else {
+        size_t pos = 0;
+        size_t runStart = 0;
+        int inRun = 0;
+        while (pos < size) {
+            size_t const segSize = MIN(AIO_URING_SEGMENT_SIZE, size - pos);
+            if (!AIO_uring_isZeroes(buffer + pos, segSize)) {
+                if (!inRun) runStart = pos;
+                inRun = 1;
+            } else if (inRun) {
+                AIO_uring_prep(ring, IORING_OP_WRITE_FIXED, index, buffer + runStart, pos - runStart, ring->cursor + runStart);
+                ring->writtenEnd = ring->cursor + pos;
+                nbOps++;
+                inRun = 0;
+            }
+            pos += segSize;
+        }
+        if (inRun) {
+            AIO_uring_prep(ring, IORING_OP_WRITE_FIXED, index, buffer + runStart, size - runStart, ring->cursor + runStart);
+            ring->writtenEnd = ring->cursor + size;
+            nbOps++;
+        }
+    }
+    ring->cursor += size;
+
+    ring->pendingOps[index] = nbOps;
+    if (nbOps == 0) {
+        AIO_IOPool_releaseIoJob(job);
+        return;
+    }
+    AIO_uring_submit(ring);
+}
+
+#else  /* !AIO_IO_URING */
+
+struct AIO_uring_s { int unused; };
+
+static struct AIO_uring_s* AIO_uring_create(IOPoolCtx_t* ctx, WritePoolCtx_t* writePool, ReadPoolCtx_t* readPool) { (void)ctx; (void)writePool; (void)readPool; return NULL; }
+static void AIO_uring_free(struct AIO_uring_s* ring) { (void)ring; }
+static int AIO_uring_supportsFile(FILE* file) { (void)file; return 0; }
+static void AIO_uring_reap(IOPoolCtx_t* ctx, int wait) { (void)ctx; (void)wait; assert(0); }
+static void AIO_uring_drain(IOPoolCtx_t* ctx) { (void)ctx; assert(0); }
+static void AIO_uring_read(ReadPoolCtx_t* ctx, IOJob_t* job) { (void)ctx; (void)job; assert(0); }
+static void AIO_uring_write(WritePoolCtx_t* ctx, IOJob_t* job) { (void)ctx; (void)job; assert(0); }
+
+#endif  /* AIO_IO_URING */
+
 /* ***********************************
  *  Generic IoPool implementation
  *************************************/
@@ -191,6 +687,8 @@ static void AIO_IOPool_init(IOPoolCtx_t* ctx, const FIO_prefs_t* prefs, POOL_fun
     }
     ctx->jobBufferSize = bufferSize;
     ctx->file = NULL;
+    ctx->uring = NULL;
+    ctx->uringFile = 0;
 }
 
 
@@ -198,7 +696,14 @@ static void AIO_IOPool_init(IOPoolCtx_t* ctx, const FIO_prefs_t* prefs, POOL_fun
  * Check if current operation uses thread pool.
  * Note that in some cases we have a thread pool initialized but choose not to use it. */
 static int AIO_IOPool_threadPoolActive(IOPoolCtx_t* ctx) {
-    return ctx->threadPool && ctx->threadPoolActive;
+    return ctx->threadPool && ctx->threadPoolActive && !ctx->uringFile;
+}
+
+/* AIO_IOPool_uringActive:
+ * Check if current operation uses io_uring instead of the thread pool.
+ * Async mode toggles both the same way. */
+static int AIO_IOPool_uringActive(IOPoolCtx_t* ctx) {
+    return ctx->uring && ctx->uringFile && ctx->threadPoolActive;
 }
 
 
@@ -231,6 +736,8 @@ static void AIO_IOPool_releaseIoJob(IOJob_t* job) {
 static void AIO_IOPool_join(IOPoolCtx_t* ctx) {
     if(AIO_IOPool_threadPoolActive(ctx))
         POOL_joinJobs(ctx->threadPool);
+    else if(AIO_IOPool_uringActive(ctx))
+        AIO_uring_drain(ctx);
 }
 
 /* AIO_IOPool_setThreaded:
@@ -257,6 +764,7 @@ static void AIO_IOPool_destroy(IOPoolCtx_t* ctx) {
         POOL_free(ctx->threadPool);
         ZSTD_pthread_mutex_destroy(&ctx->ioJobsMutex);
     }
+    AIO_uring_free(ctx->uring);
     assert(ctx->file == NULL);
     for(i=0; i<ctx->availableJobsCount; i++) {
         IOJob_t* job = (IOJob_t*) ctx->availableJobs[i];
@@ -270,6 +778,9 @@ static void AIO_IOPool_destroy(IOPoolCtx_t* ctx) {
 static IOJob_t* AIO_IOPool_acquireJob(IOPoolCtx_t* ctx) {
     IOJob_t *job;
     assert(ctx->file != NULL || ctx->prefs->testMode);
+    /* io_uring jobs are only released when their completion is reaped */
+    while (ctx->availableJobsCount == 0 && AIO_IOPool_uringActive(ctx))
+        AIO_uring_reap(ctx, 1);
     AIO_IOPool_lockJobsMutex(ctx);
     assert(ctx->availableJobsCount > 0);
     job = (IOJob_t*) ctx->availableJobs[--ctx->availableJobsCount];
@@ -289,6 +800,7 @@ static void AIO_IOPool_setFile(IOPoolCtx_t* ctx, FILE* file) {
     AIO_IOPool_join(ctx);
     assert(ctx->availableJobsCount == ctx->totalIoJobs);
     ctx->file = file;
+    ctx->uringFile = (ctx->uring && file) ? AIO_uring_supportsFile(file) : 0;
 }
 
 static FILE* AIO_IOPool_getFile(const IOPoolCtx_t* ctx) {
@@ -322,8 +834,12 @@ IOJob_t* AIO_WritePool_acquireJob(WritePoolCtx_t* ctx) {
  * Make sure to set `usedBufferSize` to the wanted length before call.
  * The queued job shouldn't be used directly after queueing it. */
 void AIO_WritePool_enqueueAndReacquireWriteJob(IOJob_t **job) {
-    AIO_IOPool_enqueueJob(*job);
-    *job = AIO_IOPool_acquireJob((IOPoolCtx_t *)(*job)->ctx);
+    WritePoolCtx_t* const ctx = (WritePoolCtx_t*)(*job)->ctx;
+    if(AIO_IOPool_uringActive(&ctx->base))
+        AIO_uring_write(ctx, *job);
+    else
+        AIO_IOPool_enqueueJob(*job);
+    *job = AIO_IOPool_acquireJob(&ctx->base);
 }
 
 /* AIO_WritePool_sparseWriteEnd:
@@ -368,6 +884,43 @@ int AIO_WritePool_closeFile(WritePoolCtx_t* ctx) {
     return fclose(dstFile);
 }
 
+/* AIO_WritePool_copyFromFile:
+ * Writes up to size bytes of the read pool's file, at an offset as for AIO_ReadPool_readAt(),
+ * copying them within the kernel (copy_file_range) after completing all queued writes.
+ * Returns the number of bytes copied, less than size if either file doesn't support it. */
+size_t AIO_WritePool_copyFromFile(WritePoolCtx_t* ctx, ReadPoolCtx_t* src, U64 offset, size_t size) {
+#if AIO_COPY_FILE_RANGE
+    FILE* const dstFile = ctx->base.file;
+    size_t done = 0;
+    off_t pos;
+    loff_t inPos, outPos;
+    if (dstFile == NULL || !src->seekable) return 0;
+    AIO_IOPool_join(&ctx->base);
+    if (fflush(dstFile) != 0)
+        EXM_THROW(70, "Write error : cannot write block : %s", strerror(errno));
+    pos = LONG_TELL(dstFile);
+    if (pos < 0) return 0;
+    inPos = (loff_t)(src->fileStart + offset);
+    outPos = (loff_t)pos + ctx->storedSkips;
+    while (done < size) {
+        ssize_t const ret = (ssize_t)syscall(__NR_copy_file_range, fileno(src->base.file), &inPos,
+                                             fileno(dstFile), &outPos, size - done, 0u);
+        if (ret < 0 && errno == EINTR) continue;
+        if (ret <= 0) break;   /* not supported between these files, or end of source */
+        done += (size_t)ret;
+    }
+    if (done > 0) {
+        ctx->storedSkips = 0;
+        if (LONG_SEEK(dstFile, (off_t)outPos, SEEK_SET) != 0)
+            EXM_THROW(70, "Write error : cannot seek : %s", strerror(errno));
+    }
+    return done;
+#else
+    (void)ctx; (void)src; (void)offset; (void)size;
+    return 0;
+#endif
+}
+
 /* AIO_WritePool_executeWriteJob:
  * Executes a write job synchronously. Can be used as a function for a thread pool. */
 static void AIO_WritePool_executeWriteJob(void* opaque){
@@ -383,6 +936,8 @@ WritePoolCtx_t* AIO_WritePool_create(const FIO_prefs_t* prefs, size_t bufferSize
     WritePoolCtx_t* const ctx = (WritePoolCtx_t*) malloc(sizeof(WritePoolCtx_t));
     if(!ctx) EXM_THROW(100, "Allocation error : not enough memory");
     AIO_IOPool_init(&ctx->base, prefs, AIO_WritePool_executeWriteJob, bufferSize);
+    if(ctx->base.threadPool)
+        ctx->base.uring = AIO_uring_create(&ctx->base, ctx, NULL);
     ctx->storedSkips = 0;
     return ctx;
 }
@@ -469,7 +1024,10 @@ static IOJob_t* AIO_ReadPool_getNextCompletedJob(ReadPoolCtx_t* ctx) {
     /* As long as we didn't find the job matching the next read, and we have some reads in flight continue waiting */
     while (!job && (AIO_ReadPool_numReadsInFlight(ctx) > 0)) {
         assert(ctx->base.threadPool != NULL); /* we shouldn't be here if we work in sync mode */
-        ZSTD_pthread_cond_wait(&ctx->jobCompletedCond, &ctx->base.ioJobsMutex);
+        if(AIO_IOPool_uringActive(&ctx->base))
+            AIO_uring_reap(&ctx->base, 1);
+        else
+            ZSTD_pthread_cond_wait(&ctx->jobCompletedCond, &ctx->base.ioJobsMutex);
         job = AIO_ReadPool_findNextWaitingOffsetCompletedJob_locked(ctx);
     }
 
@@ -493,6 +1051,19 @@ static void AIO_ReadPool_executeReadJob(void* opaque){
         AIO_ReadPool_addJobToCompleted(job);
         return;
     }
+#if AIO_SPARSE_READ
+    if(ctx->srcHoles) {
+        /* Jobs run in order : leave the file position where fread() would have */
+        U64 const offset = ctx->fileStart + job->offset;
+        job->usedBufferSize = AIO_preadSparse(fileno(job->file), job->buffer, job->bufferSize, offset, ctx->fileSize);
+        if (LONG_SEEK(job->file, (off_t)(offset + job->usedBufferSize), SEEK_SET) != 0)
+            EXM_THROW(37, "Seek error : %s", strerror(errno));
+        if(job->usedBufferSize < job->bufferSize)
+            ctx->reachedEof = 1;
+        AIO_ReadPool_addJobToCompleted(job);
+        return;
+    }
+#endif
     job->usedBufferSize = fread(job->buffer, 1, job->bufferSize, job->file);
     if(job->usedBufferSize < job->bufferSize) {
         if(ferror(job->file)) {
@@ -510,7 +1081,16 @@ static void AIO_ReadPool_enqueueRead(ReadPoolCtx_t* ctx) {
     IOJob_t* const job = AIO_IOPool_acquireJob(&ctx->base);
     job->offset = ctx->nextReadOffset;
     ctx->nextReadOffset += job->bufferSize;
-    AIO_IOPool_enqueueJob(job);
+    if(AIO_IOPool_uringActive(&ctx->base)) {
+        if(ctx->reachedEof) {
+            job->usedBufferSize = 0;
+            AIO_ReadPool_addJobToCompleted(job);
+        } else {
+            AIO_uring_read(ctx, job);
+        }
+    } else {
+        AIO_IOPool_enqueueJob(job);
+    }
 }
 
 static void AIO_ReadPool_startReading(ReadPoolCtx_t* ctx) {
@@ -520,27 +1100,66 @@ static void AIO_ReadPool_startReading(ReadPoolCtx_t* ctx) {
     }
 }
 
-/* AIO_ReadPool_setFile:
- * Sets the source file for future read in the pool. Initiates reading immediately if file is not NULL.
- * Waits for all current enqueued tasks to complete if a previous file was set. */
-void AIO_ReadPool_setFile(ReadPoolCtx_t* ctx, FILE* file) {
-    assert(ctx!=NULL);
+/* AIO_ReadPool_releaseAllJobs:
+ * Waits for all current enqueued tasks to complete and releases all jobs. */
+static void AIO_ReadPool_releaseAllJobs(ReadPoolCtx_t* ctx) {
     AIO_IOPool_join(&ctx->base);
     AIO_ReadPool_releaseAllCompletedJobs(ctx);
     if (ctx->currentJobHeld) {
         AIO_IOPool_releaseIoJob((IOJob_t *)ctx->currentJobHeld);
         ctx->currentJobHeld = NULL;
     }
-    AIO_IOPool_setFile(&ctx->base, file);
-    ctx->nextReadOffset = 0;
-    ctx->waitingOnOffset = 0;
+}
+
+/* AIO_ReadPool_restartAt:
+ * Resets the read state, and initiates reading at offset if a file is set. */
+static void AIO_ReadPool_restartAt(ReadPoolCtx_t* ctx, U64 offset) {
+    ctx->nextReadOffset = offset;
+    ctx->waitingOnOffset = offset;
     ctx->srcBuffer = ctx->coalesceBuffer;
     ctx->srcBufferLoaded = 0;
     ctx->reachedEof = 0;
-    if(file != NULL)
+    if(ctx->base.file != NULL)
         AIO_ReadPool_startReading(ctx);
 }
 
+/* AIO_ReadPool_initFileAccess:
+ * Checks whether the file can be read at explicit offsets, and whether it has holes. */
+static void AIO_ReadPool_initFileAccess(ReadPoolCtx_t* ctx, FILE* file) {
+    ctx->seekable = 0;
+    ctx->srcHoles = 0;
+    ctx->fileStart = 0;
+    ctx->fileSize = 0;
+#if AIO_PREAD
+    if (file != NULL) {
+        stat_t statbuf;
+        if (UTIL_fstat(fileno(file), "", &statbuf) && UTIL_isRegularFileStat(&statbuf)) {
+            off_t const pos = LONG_TELL(file);
+            if (pos >= 0) {
+                ctx->seekable = 1;
+                ctx->fileStart = (U64)pos;
+                ctx->fileSize = (U64)statbuf.st_size;
+#if AIO_SPARSE_READ
+                /* st_blocks counts 512-byte units */
+                ctx->srcHoles = (U64)statbuf.st_blocks * 512 < (U64)statbuf.st_size;
+#endif
+    }   }   }
+#else
+    (void)file;
+#endif
+}
+
+/* AIO_ReadPool_setFile:
+ * Sets the source file for future read in the pool. Initiates reading immediately if file is not NULL.
+ * Waits for all current enqueued tasks to complete if a previous file was set. */
+void AIO_ReadPool_setFile(ReadPoolCtx_t* ctx, FILE* file) {
+    assert(ctx!=NULL);
+    AIO_ReadPool_releaseAllJobs(ctx);
+    AIO_IOPool_setFile(&ctx->base, file);
+    AIO_ReadPool_initFileAccess(ctx, file);
+    AIO_ReadPool_restartAt(ctx, 0);
+}
+
 /* AIO_ReadPool_create:
  * Allocates and sets and a new readPool including its included jobs.
  * bufferSize should be set to the maximal buffer we want to read at a time, will also be used
@@ -556,6 +1175,10 @@ ReadPoolCtx_t* AIO_ReadPool_create(const FIO_prefs_t* prefs, size_t bufferSize)
     ctx->srcBufferLoaded = 0;
     ctx->completedJobsCount = 0;
     ctx->currentJobHeld = NULL;
+    AIO_ReadPool_initFileAccess(ctx, NULL);
+
+    if(ctx->base.threadPool)
+        ctx->base.uring = AIO_uring_create(&ctx->base, NULL, ctx);
 
     if(ctx->base.threadPool)
         if (ZSTD_pthread_cond_init(&ctx->jobCompletedCond, NULL))
@@ -642,6 +1265,47 @@ size_t AIO_ReadPool_consumeAndRefill(ReadPoolCtx_t* ctx) {
     return AIO_ReadPool_fillBuffer(ctx, ctx->base.jobBufferSize);
 }
 
+/* AIO_ReadPool_tell:
+ * Returns the offset of srcBuffer's first byte, relative to where the file was when set. */
+U64 AIO_ReadPool_tell(const ReadPoolCtx_t* ctx) {
+    assert(ctx->waitingOnOffset >= ctx->srcBufferLoaded);
+    return ctx->waitingOnOffset - ctx->srcBufferLoaded;
+}
+
+/* AIO_ReadPool_readAt:
+ * Reads up to size bytes at an offset relative to where the file was when set, without
+ * changing the state of the pool. Returns the number of bytes read, 0 if the file isn't seekable. */
+size_t AIO_ReadPool_readAt(ReadPoolCtx_t* ctx, void* dst, size_t size, U64 offset) {
+#if AIO_PREAD
+    if (!ctx->seekable) return 0;
+    return AIO_pread(fileno(ctx->base.file), dst, size, ctx->fileStart + offset);
+#else
+    (void)ctx; (void)dst; (void)size; (void)offset;
+    return 0;
+#endif
+}
+
+/* AIO_ReadPool_skipBytes:
+ * Consumes n bytes, which may be more than srcBufferLoaded if the file is seekable,
+ * in which case reading restarts right after them. */
+void AIO_ReadPool_skipBytes(ReadPoolCtx_t* ctx, U64 n) {
+    if (n > ctx->srcBufferLoaded && ctx->seekable) {
+        U64 const offset = AIO_ReadPool_tell(ctx) + n;
+        AIO_ReadPool_releaseAllJobs(ctx);
+        if (LONG_SEEK(ctx->base.file, (off_t)(ctx->fileStart + offset), SEEK_SET) != 0)
+            EXM_THROW(37, "Seek error : %s", strerror(errno));
+        AIO_ReadPool_restartAt(ctx, offset);
+        return;
+    }
+    while (n > 0) {
+        size_t const skipped = (size_t)MIN(n, (U64)ctx->srcBufferLoaded);
+        AIO_ReadPool_consumeBytes(ctx, skipped);
+        n -= skipped;
+        if (n > 0 && AIO_ReadPool_fillBuffer(ctx, ctx->base.jobBufferSize) == 0)
+            break;
+    }
+}
+
 /* AIO_ReadPool_getFile:
  * Returns the current file set for the read pool. */
 FILE* AIO_ReadPool_getFile(const ReadPoolCtx_t* ctx) {
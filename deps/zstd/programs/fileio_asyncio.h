@@ -14,9 +14,11 @@
   * writes.
   * Each IO pool supports up to `MAX_IO_JOBS` that can be enqueued for work, but
   * are performed serially by the appropriate worker thread.
-  * Most systems exposes better primitives to perform asynchronous IO, such as
-  * io_uring on newer linux systems. The API is built in such a way that in the
-  * future we could replace the threads with better solutions when available.
+  * On Linux, regular files are instead served through io_uring when the kernel
+  * allows it : jobs are submitted from the calling thread with registered
+  * buffers, at explicit file offsets, and can complete in any order.
+  * Pipes, consoles, files opened in append mode, and kernels without io_uring
+  * fall back to the worker thread. Define ZSTD_NO_IO_URING to disable it.
   */
 
 #ifndef ZSTD_FILEIO_ASYNCIO_H
@@ -43,6 +45,11 @@ typedef struct {
     const FIO_prefs_t* prefs;
     POOL_function poolFunction;
 
+    /* io_uring instance, NULL if unavailable. Used in place of the thread pool when
+     * uringFile is set, which is decided for each file by AIO_IOPool_setFile(). */
+    struct AIO_uring_s* uring;
+    int uringFile;
+
     /* Controls the file we currently write to, make changes only by using provided utility functions */
     FILE* file;
 
@@ -79,6 +86,13 @@ typedef struct {
     void* completedJobs[MAX_IO_JOBS];
     int completedJobsCount;
     ZSTD_pthread_cond_t jobCompletedCond;
+
+    /* Regular files can also be accessed at explicit offsets, relative to fileStart, the position
+     * the file was at when set. Holes of sparse ones are filled with zeros instead of being read. */
+    int seekable;
+    int srcHoles;
+    U64 fileStart;
+    U64 fileSize;
 } ReadPoolCtx_t;
 
 typedef struct {
@@ -139,6 +153,12 @@ FILE* AIO_WritePool_getFile(const WritePoolCtx_t* ctx);
  * Requires completion of all queues write jobs and release of all otherwise acquired jobs.  */
 int AIO_WritePool_closeFile(WritePoolCtx_t *ctx);
 
+/* AIO_WritePool_copyFromFile:
+ * Writes up to size bytes of the read pool's file, at an offset as for AIO_ReadPool_readAt(),
+ * copying them within the kernel (copy_file_range) after completing all queued writes.
+ * Returns the number of bytes copied, less than size if either file doesn't support it. */
+size_t AIO_WritePool_copyFromFile(WritePoolCtx_t *ctx, ReadPoolCtx_t *src, U64 offset, size_t size);
+
 /* AIO_WritePool_create:
  * Allocates and sets and a new write pool including its included jobs.
  * bufferSize should be set to the maximal buffer we want to write to at a time. */
@@ -183,6 +203,20 @@ size_t AIO_ReadPool_fillBuffer(ReadPoolCtx_t *ctx, size_t n);
  * Consumes the current buffer and refills it with bufferSize bytes. */
 size_t AIO_ReadPool_consumeAndRefill(ReadPoolCtx_t *ctx);
 
+/* AIO_ReadPool_tell:
+ * Returns the offset of srcBuffer's first byte, relative to where the file was when set. */
+U64 AIO_ReadPool_tell(const ReadPoolCtx_t *ctx);
+
+/* AIO_ReadPool_readAt:
+ * Reads up to size bytes at an offset relative to where the file was when set, without
+ * changing the state of the pool. Returns the number of bytes read, 0 if the file isn't seekable. */
+size_t AIO_ReadPool_readAt(ReadPoolCtx_t *ctx, void* dst, size_t size, U64 offset);
+
+/* AIO_ReadPool_skipBytes:
+ * Consumes n bytes, which may be more than srcBufferLoaded if the file is seekable,
+ * in which case reading restarts right after them. */
+void AIO_ReadPool_skipBytes(ReadPoolCtx_t *ctx, U64 n);
+
 /* AIO_ReadPool_setFile:
  * Sets the source file for future read in the pool. Initiates reading immediately if file is not NULL.
  * Waits for all current enqueued tasks to complete if a previous file was set. */
@@ -62,6 +62,7 @@ typedef struct FIO_prefs_s {
 
     /* Computation resources preferences */
     unsigned memLimit;
+    size_t compressMemLimit;
     int nbWorkers;
 
     int excludeCompressedFiles;
@@ -187,6 +187,7 @@ static void usage_advanced(const char* programName)
     DISPLAYOUT("  -q, --quiet                   Suppress warnings; pass twice to suppress errors.\n");
 #ifndef ZSTD_NOTRACE
     DISPLAYOUT("  --trace LOG                   Log tracing information to LOG.\n");
+    DISPLAYOUT("  --trace-blocks                Report literals, sequences, matches and cycles of decoded blocks.\n");
 #endif
     DISPLAYOUT("\n");
     DISPLAYOUT("  --[no-]progress               Forcibly show/hide the progress counter. NOTE: Any (de)compressed\n");
@@ -234,11 +235,13 @@ static void usage_advanced(const char* programName)
     DISPLAYOUT("  --patch-from=REF              Use REF as the reference point for Zstandard's diff engine. \n\n");
 # ifdef ZSTD_MULTITHREAD
     DISPLAYOUT("  -T#                           Spawn # compression threads. [Default: 1; pass 0 for core count.]\n");
+    DISPLAYOUT("                                With -d, decode independent frames on # threads.\n");
     DISPLAYOUT("  --single-thread               Share a single thread for I/O and compression (slightly different than `-T1`).\n");
     DISPLAYOUT("  --auto-threads={physical|logical}\n");
     DISPLAYOUT("                                Use physical/logical cores when using `-T0`. [Default: Physical]\n\n");
     DISPLAYOUT("  -B#                           Set job size to #. [Default: 0 (automatic)]\n");
     DISPLAYOUT("  --rsyncable                   Compress using a rsync-friendly method (`-B` sets block size). \n");
+    DISPLAYOUT("  --memlimit-compress=#         Keep multithreaded compression memory within #, adapting job size unless `-B` is set.\n");
     DISPLAYOUT("\n");
 # endif
     DISPLAYOUT("  --exclude-compressed          Only compress files that are not already compressed.\n\n");
@@ -312,6 +315,7 @@ static void usage_advanced(const char* programName)
     DISPLAYOUT("  -B#                           Cut file into independent chunks of size #. [Default: No chunking]\n");
     DISPLAYOUT("  -S                            Output one benchmark result per input file. [Default: Consolidated result]\n");
     DISPLAYOUT("  --priority=rt                 Set process priority to real-time.\n");
+    DISPLAYOUT("  --batch                       Process all chunks with one batch call, on -T# threads.\n");
 #endif
 
 }
@@ -846,6 +850,7 @@ int main(int argCount, const char* argv[])
         operationResult = 0,
         separateFiles = 0,
         setRealTimePrio = 0,
+        benchBatch = 0,
         singleThread = 0,
         defaultLogicalCores = 0,
         showDefaultCParams = 0,
@@ -881,6 +886,7 @@ int main(int argCount, const char* argv[])
     unsigned maxDictSize = g_defaultMaxDictSize;
     unsigned dictID = 0;
     size_t streamSrcSize = 0;
+    size_t compressMemLimit = 0;
     size_t targetCBlockSize = 0;
     size_t srcSizeHint = 0;
     size_t nbInputFileNames = 0;
@@ -977,6 +983,7 @@ int main(int argCount, const char* argv[])
                 if (!strcmp(argument, "--keep")) { removeSrcFile=0; continue; }
                 if (!strcmp(argument, "--rm")) { removeSrcFile=1; continue; }
                 if (!strcmp(argument, "--priority=rt")) { setRealTimePrio = 1; continue; }
+                if (!strcmp(argument, "--batch")) { benchBatch = 1; continue; }
                 if (!strcmp(argument, "--show-default-cparams")) { showDefaultCParams = 1; continue; }
                 if (!strcmp(argument, "--content-size")) { contentSize = 1; continue; }
                 if (!strcmp(argument, "--no-content-size")) { contentSize = 0; continue; }
@@ -1050,6 +1057,7 @@ int main(int argCount, const char* argv[])
                 }
 #endif
                 if (longCommandWArg(&argument, "--threads")) { NEXT_UINT32(nbWorkers); continue; }
+                if (longCommandWArg(&argument, "--memlimit-compress")) { NEXT_TSIZE(compressMemLimit); continue; }
                 if (longCommandWArg(&argument, "--memlimit")) { NEXT_UINT32(memLimit); continue; }
                 if (longCommandWArg(&argument, "--memory")) { NEXT_UINT32(memLimit); continue; }
                 if (longCommandWArg(&argument, "--memlimit-decompress")) { NEXT_UINT32(memLimit); continue; }
@@ -1086,6 +1094,7 @@ int main(int argCount, const char* argv[])
                 }
 #endif
 #ifndef ZSTD_NOTRACE
+                if (!strcmp(argument, "--trace-blocks")) { TRACE_enableBlockReport(); continue; }
                 if (longCommandWArg(&argument, "--trace")) { char const* traceFile; NEXT_FIELD(traceFile); TRACE_enable(traceFile); continue; }
 #endif
                 if (longCommandWArg(&argument, "--patch-from")) { NEXT_FIELD(patchFromDictFileName); continue; }
@@ -1291,9 +1300,6 @@ int main(int argCount, const char* argv[])
     DISPLAYLEVEL(3, WELCOME_MESSAGE);
 
 #ifdef ZSTD_MULTITHREAD
-    if ((operation==zom_decompress) && (!singleThread) && (nbWorkers > 1)) {
-        DISPLAYLEVEL(2, "Warning : decompression does not support multi-threading\n");
-    }
     if ((nbWorkers==0) && (!singleThread)) {
         /* automatically set # workers based on # of reported cpus */
         if (defaultLogicalCores) {
@@ -1370,6 +1376,7 @@ int main(int argCount, const char* argv[])
         benchParams.blockSize = blockSize;
         benchParams.nbWorkers = (int)nbWorkers;
         benchParams.realTime = (unsigned)setRealTimePrio;
+        benchParams.batch = benchBatch;
         benchParams.nbSeconds = bench_nbSeconds;
         benchParams.ldmFlag = ldmFlag;
         benchParams.ldmMinMatch = (int)g_ldmMinMatch;
@@ -1554,6 +1561,7 @@ int main(int argCount, const char* argv[])
         FIO_setAdaptMin(prefs, adaptMin);
         FIO_setAdaptMax(prefs, adaptMax);
         FIO_setRsyncable(prefs, rsyncable);
+        FIO_setCompressMemLimit(prefs, compressMemLimit);
         FIO_setStreamSrcSize(prefs, streamSrcSize);
         FIO_setTargetCBlockSize(prefs, targetCBlockSize);
         FIO_setSrcSizeHint(prefs, srcSizeHint);
@@ -1585,7 +1593,7 @@ int main(int argCount, const char* argv[])
             operationResult = FIO_compressMultipleFilenames(fCtx, prefs, filenames->fileNames, outMirroredDirName, outDirName, outFileName, suffix, dictFileName, cLevel, compressionParams);
 #else
         /* these variables are only used when compression mode is enabled */
-        (void)contentSize; (void)suffix; (void)adapt; (void)rsyncable;
+        (void)contentSize; (void)suffix; (void)adapt; (void)rsyncable; (void)compressMemLimit;
         (void)ultra; (void)cLevel; (void)ldmFlag; (void)literalCompressionMode;
         (void)targetCBlockSize; (void)streamSrcSize; (void)srcSizeHint;
         (void)ZSTD_strategyMap; (void)useRowMatchFinder; (void)cType;
@@ -1593,6 +1601,7 @@ int main(int argCount, const char* argv[])
 #endif
     } else {  /* decompression or test */
 #ifndef ZSTD_NODECOMPRESS
+        FIO_setNbWorkers(prefs, (int)nbWorkers);
         if (filenames->tableSize == 1 && outFileName) {
             operationResult = FIO_decompressFilename(fCtx, prefs, outFileName, filenames->fileNames[0], dictFileName);
         } else {
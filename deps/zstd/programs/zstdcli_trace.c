@@ -31,6 +31,18 @@ static FILE* g_traceFile = NULL;
 static int g_mutexInit = 0;
 static ZSTD_pthread_mutex_t g_mutex;
 static UTIL_time_t g_enableTime = UTIL_TIME_INITIALIZER;
+static int g_blockReport = 0;
+
+static void TRACE_initMutex(void)
+{
+    if (!g_mutexInit) {
+        if (!ZSTD_pthread_mutex_init(&g_mutex, NULL)) {
+            g_mutexInit = 1;
+        } else {
+            TRACE_finish();
+        }
+    }
+}
 
 void TRACE_enable(char const* filename)
 {
@@ -56,17 +68,109 @@ void TRACE_enable(char const* filename)
         fprintf(g_traceFile, "Algorithm, Version, Method, Mode, Level, Workers, Dictionary Size, Uncompressed Size, Compressed Size, Duration Nanos, Compression Ratio, Speed MB/s\n");
     }
     g_enableTime = UTIL_getTime();
-    if (!g_mutexInit) {
-        if (!ZSTD_pthread_mutex_init(&g_mutex, NULL)) {
-            g_mutexInit = 1;
-        } else {
-            TRACE_finish();
-        }
+    TRACE_initMutex();
+}
+
+#if ZSTD_TRACE_BLOCKS
+
+static struct {
+    unsigned long long nbBlocks;
+    unsigned long long literalsTypeBlocks[4];
+    unsigned long long literalsSize;
+    unsigned long long literalsSectionSize;
+    unsigned long long nbSequences;
+    unsigned long long longOffsetShares;   /* sum of longOffsetShare, weighted by nbSequences */
+    unsigned long long prefetchBlocks;
+    unsigned long long matchSize;
+    unsigned long long compressedSize;
+    unsigned long long uncompressedSize;
+    unsigned long long literalsCycles;
+    unsigned long long tablesCycles;
+    unsigned long long sequencesCycles;
+} g_blockStats;
+
+void TRACE_enableBlockReport(void)
+{
+    g_blockReport = 1;
+    g_enableTime = UTIL_getTime();
+    TRACE_initMutex();
+}
+
+static double TRACE_percent(unsigned long long part, unsigned long long total)
+{
+    return total ? (double)part * 100. / (double)total : 0.;
+}
+
+static void TRACE_reportBlocks(void)
+{
+    unsigned long long const cycles = g_blockStats.literalsCycles + g_blockStats.tablesCycles + g_blockStats.sequencesCycles;
+    fprintf(stderr, "Decompressed %llu compressed blocks : %llu -> %llu bytes \n",
+            g_blockStats.nbBlocks, g_blockStats.compressedSize, g_blockStats.uncompressedSize);
+    if (g_blockStats.nbBlocks == 0) return;
+    fprintf(stderr, "  literals  : %llu bytes from %llu (%.1f%% of output) ; blocks : %llu raw, %llu RLE, %llu Huffman, %llu Huffman repeat \n",
+            g_blockStats.literalsSize, g_blockStats.literalsSectionSize,
+            TRACE_percent(g_blockStats.literalsSize, g_blockStats.uncompressedSize),
+            g_blockStats.literalsTypeBlocks[0], g_blockStats.literalsTypeBlocks[1],
+            g_blockStats.literalsTypeBlocks[2], g_blockStats.literalsTypeBlocks[3]);
+    fprintf(stderr, "  sequences : %llu, long offset share %.2f%% ; %llu blocks with prefetching decoder \n",
+            g_blockStats.nbSequences,
+            TRACE_percent(g_blockStats.longOffsetShares, g_blockStats.nbSequences * 256),
+            g_blockStats.prefetchBlocks);
+    fprintf(stderr, "  matches   : %llu bytes copied (%.1f%% of output), %.1f bytes per sequence \n",
+            g_blockStats.matchSize,
+            TRACE_percent(g_blockStats.matchSize, g_blockStats.uncompressedSize),
+            g_blockStats.nbSequences ? (double)g_blockStats.matchSize / (double)g_blockStats.nbSequences : 0.);
+    if (cycles == 0) {
+        fprintf(stderr, "  cycles    : no timestamp counter on this platform \n");
+        return;
     }
+    fprintf(stderr, "  cycles    : %.2f per byte ; literals %.1f%%, tables %.1f%%, sequences and matches %.1f%% \n",
+            (double)cycles / (double)g_blockStats.uncompressedSize,
+            TRACE_percent(g_blockStats.literalsCycles, cycles),
+            TRACE_percent(g_blockStats.tablesCycles, cycles),
+            TRACE_percent(g_blockStats.sequencesCycles, cycles));
+}
+
+void ZSTD_trace_decompress_block(ZSTD_TraceCtx ctx, ZSTD_TraceBlock const* block)
+{
+    (void)ctx;
+    assert(block->version == ZSTD_VERSION_NUMBER); /* CLI version must match. */
+    if (!g_blockReport)
+        return;
+    ZSTD_pthread_mutex_lock(&g_mutex);
+    g_blockStats.nbBlocks++;
+    g_blockStats.literalsTypeBlocks[block->literalsType & 3]++;
+    g_blockStats.literalsSize += block->literalsSize;
+    g_blockStats.literalsSectionSize += block->literalsSectionSize;
+    g_blockStats.nbSequences += block->nbSequences;
+    g_blockStats.longOffsetShares += (unsigned long long)block->longOffsetShare * block->nbSequences;
+    g_blockStats.prefetchBlocks += block->prefetchDecoder != 0;
+    g_blockStats.matchSize += block->matchSize;
+    g_blockStats.compressedSize += block->compressedSize;
+    g_blockStats.uncompressedSize += block->uncompressedSize;
+    g_blockStats.literalsCycles += block->literalsCycles;
+    g_blockStats.tablesCycles += block->tablesCycles;
+    g_blockStats.sequencesCycles += block->sequencesCycles;
+    ZSTD_pthread_mutex_unlock(&g_mutex);
 }
 
+#else /* ZSTD_TRACE_BLOCKS */
+
+void TRACE_enableBlockReport(void)
+{
+    fprintf(stderr, "Warning : block report requires a build with ZSTD_TRACE_BLOCKS \n");
+}
+
+#endif /* ZSTD_TRACE_BLOCKS */
+
 void TRACE_finish(void)
 {
+#if ZSTD_TRACE_BLOCKS
+    if (g_blockReport) {
+        TRACE_reportBlocks();
+        g_blockReport = 0;
+    }
+#endif
     if (g_traceFile) {
         fclose(g_traceFile);
     }
@@ -145,7 +249,7 @@ void ZSTD_trace_compress_end(ZSTD_TraceCtx ctx, ZSTD_Trace const* trace)
 ZSTD_TraceCtx ZSTD_trace_decompress_begin(ZSTD_DCtx const* dctx)
 {
     (void)dctx;
-    if (g_traceFile == NULL)
+    if (g_traceFile == NULL && !g_blockReport)
         return 0;
     return (ZSTD_TraceCtx)UTIL_clockSpanNano(g_enableTime);
 }
@@ -155,8 +259,9 @@ void ZSTD_trace_decompress_end(ZSTD_TraceCtx ctx, ZSTD_Trace const* trace)
     PTime const beginNanos = (PTime)ctx;
     PTime const endNanos = UTIL_clockSpanNano(g_enableTime);
     PTime const durationNanos = endNanos > beginNanos ? endNanos - beginNanos : 0;
-    assert(g_traceFile != NULL);
     assert(trace->version == ZSTD_VERSION_NUMBER); /* CLI version must match. */
+    if (g_traceFile == NULL)
+        return;   /* block report only */
     TRACE_log("decompress", durationNanos, trace);
 }
 
@@ -167,6 +272,8 @@ void TRACE_enable(char const* filename)
     (void)filename;
 }
 
+void TRACE_enableBlockReport(void) {}
+
 void TRACE_finish(void) {}
 
 #endif /* ZSTD_TRACE */
@@ -16,6 +16,13 @@
  */
 void TRACE_enable(char const* filename);
 
+/**
+ * Collect statistics on each compressed block decoded,
+ * and report them to stderr on TRACE_finish().
+ * Requires a library built with ZSTD_TRACE_BLOCKS.
+ */
+void TRACE_enableBlockReport(void);
+
 /**
  * Shut down the tracing library.
  */
@@ -559,6 +559,202 @@ static void test_setCParams(unsigned tnb)
     DISPLAYLEVEL(3, "OK \n");
 }
 
+static void test_batch(unsigned tnb)
+{
+    size_t const nbBuffers = 200;
+    size_t const srcCapacity = 1 MB;
+    size_t const dictSize = 16 KB;
+    BYTE* const src = (BYTE*)malloc(srcCapacity);
+    BYTE* const dict = (BYTE*)malloc(dictSize);
+    size_t const cCapacity = ZSTD_compressBound(srcCapacity) + nbBuffers * ZSTD_COMPRESSBOUND(0);
+    BYTE* const cBatch = (BYTE*)malloc(cCapacity);
+    BYTE* const cRef = (BYTE*)malloc(cCapacity);
+    BYTE* const decoded = (BYTE*)malloc(srcCapacity);
+    ZSTD_batchBuffer* const buffers = (ZSTD_batchBuffer*)malloc(nbBuffers * sizeof(ZSTD_batchBuffer));
+    size_t* const cSizes = (size_t*)malloc(nbBuffers * sizeof(size_t));
+    ZSTD_CCtx* const cctx = ZSTD_createCCtx();
+    ZSTD_DCtx* const dctx = ZSTD_createDCtx();
+    ZSTD_threadPool* const pool = ZSTD_createThreadPool(3);
+    int withDict, withPool;
+    size_t n;
+
+    DISPLAYLEVEL(3, "test%3u : compress and decompress batches : ", tnb);
+    CHECK(src && dict && cBatch && cRef && decoded && buffers && cSizes && cctx && dctx && pool);
+    RDG_genBuffer(dict, dictSize, 0.5, 0.5, tnb);
+    RDG_genBuffer(src, srcCapacity, 0.5, 0.5, tnb + 1);
+
+    for (withDict = 0; withDict < 2; withDict++) {
+        /* reference : one ZSTD_compress2() per message, messages of 0 to 4 KB, and a few larger ones */
+        size_t srcPos = 0, cPos = 0;
+        CHECK_Z( ZSTD_CCtx_reset(cctx, ZSTD_reset_session_and_parameters) );
+        CHECK_Z( ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, 3) );
+        CHECK_Z( ZSTD_CCtx_setParameter(cctx, ZSTD_c_checksumFlag, 1) );
+        CHECK_Z( ZSTD_CCtx_loadDictionary(cctx, withDict ? dict : NULL, withDict ? dictSize : 0) );
+        CHECK_Z( ZSTD_DCtx_reset(dctx, ZSTD_reset_session_and_parameters) );
+        CHECK_Z( ZSTD_DCtx_loadDictionary(dctx, withDict ? dict : NULL, withDict ? dictSize : 0) );
+        for (n = 0; n < nbBuffers; n++) {
+            size_t const srcSize = (n % 50 == 7) ? 100 KB : (n * 2654435761U) % (4 KB);
+            CHECK(srcPos + srcSize <= srcCapacity);
+            buffers[n].src = src + srcPos;
+            buffers[n].srcSize = srcSize;
+            buffers[n].dst = cBatch + cPos;
+            buffers[n].dstCapacity = ZSTD_compressBound(srcSize);
+            CHECK_VAR(cSizes[n], ZSTD_compress2(cctx, cRef + cPos, buffers[n].dstCapacity, buffers[n].src, srcSize));
+            srcPos += srcSize;
+            cPos += buffers[n].dstCapacity;
+        }
+
+        for (withPool = 0; withPool < 2; withPool++) {
+            CHECK_Z( ZSTD_CCtx_refThreadPool(cctx, withPool ? pool : NULL) );
+            CHECK_Z( ZSTD_DCtx_refThreadPool(dctx, withPool ? pool : NULL) );
+
+            /* the same frames as ZSTD_compress2() */
+            memset(cBatch, 0, cCapacity);
+            CHECK_Z( ZSTD_compressBatch(cctx, buffers, nbBuffers) );
+            for (n = 0; n < nbBuffers; n++) {
+                size_t const cOffset = (size_t)((BYTE*)buffers[n].dst - cBatch);
+                CHECK_EQ(buffers[n].result, cSizes[n]);
+                CHECK(!memcmp(cBatch + cOffset, cRef + cOffset, cSizes[n]));
+            }
+
+            /* and back */
+            {   ZSTD_batchBuffer* const dBuffers = (ZSTD_batchBuffer*)malloc(nbBuffers * sizeof(ZSTD_batchBuffer));
+                CHECK(dBuffers != NULL);
+                memset(decoded, 0, srcCapacity);
+                for (n = 0; n < nbBuffers; n++) {
+                    dBuffers[n].src = buffers[n].dst;
+                    dBuffers[n].srcSize = cSizes[n];
+                    dBuffers[n].dst = decoded + ((const BYTE*)buffers[n].src - src);
+                    dBuffers[n].dstCapacity = buffers[n].srcSize;
+                }
+                CHECK_Z( ZSTD_decompressBatch(dctx, dBuffers, nbBuffers) );
+                for (n = 0; n < nbBuffers; n++) CHECK_EQ(dBuffers[n].result, buffers[n].srcSize);
+                CHECK(!memcmp(decoded, src, srcPos));
+
+                /* a failing buffer reports its own error, the others still succeed */
+                dBuffers[nbBuffers/2].dstCapacity = 0;
+                CHECK_EQ(ZSTD_getErrorCode(ZSTD_decompressBatch(dctx, dBuffers, nbBuffers)), ZSTD_error_dstSize_tooSmall);
+                for (n = 0; n < nbBuffers; n++) {
+                    if (n == nbBuffers/2 && buffers[n].srcSize > 0) {
+                        CHECK(ZSTD_isError(dBuffers[n].result));
+                    } else {
+                        CHECK_EQ(dBuffers[n].result, buffers[n].srcSize);
+                }   }
+                free(dBuffers);
+            }
+            {   size_t const dstCapacity = buffers[3].dstCapacity;
+                buffers[3].dstCapacity = 1;
+                CHECK_EQ(ZSTD_getErrorCode(ZSTD_compressBatch(cctx, buffers, nbBuffers)), ZSTD_error_dstSize_tooSmall);
+                CHECK(ZSTD_isError(buffers[3].result));
+                CHECK_EQ(buffers[4].result, cSizes[4]);
+                buffers[3].dstCapacity = dstCapacity;
+            }
+        }
+    }
+
+    /* a prefix applies to all messages of the batch, and to that batch only */
+    CHECK_Z( ZSTD_CCtx_reset(cctx, ZSTD_reset_session_and_parameters) );
+    {   size_t const srcSize = 8 KB;
+        size_t withPrefix, withoutPrefix;
+        CHECK_VAR(withoutPrefix, ZSTD_compress2(cctx, cRef, cCapacity, src, srcSize));
+        CHECK_Z( ZSTD_CCtx_refPrefix(cctx, src, srcSize) );
+        CHECK_VAR(withPrefix, ZSTD_compress2(cctx, cRef, cCapacity, src, srcSize));
+        CHECK_LT(withPrefix, withoutPrefix);
+        for (n = 0; n < 2; n++) {
+            buffers[n].src = src;
+            buffers[n].srcSize = srcSize;
+            buffers[n].dst = cBatch + n * ZSTD_compressBound(srcSize);
+            buffers[n].dstCapacity = ZSTD_compressBound(srcSize);
+        }
+        CHECK_Z( ZSTD_CCtx_refPrefix(cctx, src, srcSize) );
+        CHECK_Z( ZSTD_compressBatch(cctx, buffers, 2) );
+        CHECK_EQ(buffers[0].result, withPrefix);
+        CHECK_EQ(buffers[1].result, withPrefix);
+        CHECK_Z( ZSTD_compressBatch(cctx, buffers, 1) );
+        CHECK_EQ(buffers[0].result, withoutPrefix);
+    }
+
+    ZSTD_freeThreadPool(pool);
+    ZSTD_freeDCtx(dctx);
+    ZSTD_freeCCtx(cctx);
+    free(cSizes);
+    free(buffers);
+    free(decoded);
+    free(cRef);
+    free(cBatch);
+    free(dict);
+    free(src);
+    DISPLAYLEVEL(3, "OK \n");
+}
+
+#ifdef ZSTD_MULTITHREAD
+static void test_maxMemory(unsigned tnb)
+{
+    size_t const srcSize = 5 MB;
+    size_t const cCapacity = ZSTD_compressBound(srcSize);
+    int const budgetKB = 8 MB >> 10;
+    BYTE* const src = (BYTE*)malloc(srcSize);
+    BYTE* const cRef = (BYTE*)malloc(cCapacity);
+    BYTE* const cBudget = (BYTE*)malloc(cCapacity);
+    BYTE* const decoded = (BYTE*)malloc(srcSize);
+    ZSTD_CCtx* const cctx = ZSTD_createCCtx();
+    ZSTD_CCtx* const cctxBudget = ZSTD_createCCtx();
+    size_t const baseSize = ZSTD_sizeof_CCtx(cctxBudget);
+    size_t refSize, cSize, dSize, pos;
+    int value;
+
+    DISPLAYLEVEL(3, "test%3u : multithreaded compression within a memory budget : ", tnb);
+    CHECK(src && cRef && cBudget && decoded && cctx && cctxBudget);
+    RDG_genBuffer(src, srcSize, 0.5, 0.5, tnb);
+
+    CHECK_Z( ZSTD_CCtx_getParameter(cctxBudget, ZSTD_c_maxMemory, &value) );
+    CHECK_EQ(value, 0);
+    CHECK_Z( ZSTD_CCtx_setParameter(cctxBudget, ZSTD_c_maxMemory, budgetKB) );
+    CHECK_Z( ZSTD_CCtx_getParameter(cctxBudget, ZSTD_c_maxMemory, &value) );
+    CHECK_EQ(value, budgetKB);
+
+    /* with a set job size, only jobs in flight are limited : result is unchanged */
+    CHECK_Z( ZSTD_CCtx_setParameter(cctx, ZSTD_c_nbWorkers, 4) );
+    CHECK_Z( ZSTD_CCtx_setParameter(cctx, ZSTD_c_jobSize, 512 KB) );
+    CHECK_Z( ZSTD_CCtx_setParameter(cctxBudget, ZSTD_c_nbWorkers, 4) );
+    CHECK_Z( ZSTD_CCtx_setParameter(cctxBudget, ZSTD_c_jobSize, 512 KB) );
+    CHECK_VAR(refSize, ZSTD_compress2(cctx, cRef, cCapacity, src, srcSize));
+    CHECK_VAR(cSize, ZSTD_compress2(cctxBudget, cBudget, cCapacity, src, srcSize));
+    CHECK_EQ(cSize, refSize);
+    CHECK(!memcmp(cBudget, cRef, cSize));
+    CHECK_LT(ZSTD_sizeof_CCtx(cctxBudget), baseSize + ((size_t)budgetKB << 10));
+
+    /* with an automatic job size, jobs adapt : stream it in small pieces */
+    CHECK_Z( ZSTD_CCtx_setParameter(cctxBudget, ZSTD_c_jobSize, 0) );
+    CHECK_Z( ZSTD_CCtx_setParameter(cctxBudget, ZSTD_c_compressionLevel, 5) );
+    {   ZSTD_outBuffer out = { cBudget, cCapacity, 0 };
+        for (pos = 0; pos < srcSize; pos += 100 KB) {
+            ZSTD_inBuffer in = { src + pos, MIN(100 KB, srcSize - pos), 0 };
+            while (in.pos < in.size) CHECK_Z( ZSTD_compressStream2(cctxBudget, &out, &in, ZSTD_e_continue) );
+        }
+        {   ZSTD_inBuffer in = { NULL, 0, 0 };
+            size_t remaining;
+            do {
+                CHECK_VAR(remaining, ZSTD_compressStream2(cctxBudget, &out, &in, ZSTD_e_end));
+            } while (remaining != 0);
+        }
+        cSize = out.pos;
+    }
+    CHECK_LT(ZSTD_sizeof_CCtx(cctxBudget), baseSize + ((size_t)budgetKB << 10));
+    CHECK_VAR(dSize, ZSTD_decompress(decoded, srcSize, cBudget, cSize));
+    CHECK_EQ(dSize, srcSize);
+    CHECK(!memcmp(decoded, src, srcSize));
+
+    ZSTD_freeCCtx(cctxBudget);
+    ZSTD_freeCCtx(cctx);
+    free(decoded);
+    free(cBudget);
+    free(cRef);
+    free(src);
+    DISPLAYLEVEL(3, "OK \n");
+}
+#endif
+
 static int basicUnitTests(U32 const seed, double compressibility)
 {
     size_t const CNBuffSize = 5 MB;
@@ -611,6 +807,12 @@ static int basicUnitTests(U32 const seed, double compressibility)
 
     test_setCParams(testNb++);
 
+    test_batch(testNb++);
+
+#ifdef ZSTD_MULTITHREAD
+    test_maxMemory(testNb++);
+#endif
+
     DISPLAYLEVEL(3, "test%3u : ZSTD_adjustCParams : ", testNb++);
     {
         ZSTD_compressionParameters params;
@@ -933,6 +933,24 @@ zstd -d -v -f tmpSparseCompressed -o tmpSparseRegenerated
 zstd -d -v -f tmpSparseCompressed -c >> tmpSparseRegenerated
 ls -ls tmpSparse*  # look at file size and block size on disk
 $DIFF tmpSparse2M tmpSparseRegenerated
+println "\n Sparse source files :"
+datagen -g1M > tmpSparseData
+dd if=tmpSparseData of=tmpSparseHoles bs=65536 seek=40 conv=notrunc 2>$INTOVOID  # 1 MB of data after a 2.5 MB hole
+dd if=/dev/null of=tmpSparseHoles bs=65536 seek=80 2>$INTOVOID                  # and a trailing hole
+zstd -f tmpSparseHoles -o tmpSparseCompressed
+zstd -d -f --sparse tmpSparseCompressed -o tmpSparseRegenerated
+$DIFF -s tmpSparseHoles tmpSparseRegenerated
+zstd -f -T2 tmpSparseHoles -c | zstd -d -c | $DIFF -s tmpSparseHoles -
+println "\n Frames of stored blocks :"
+datagen -g3M -P0 > tmpSparseStored
+zstd -f --no-check tmpSparseStored -o tmpSparseCompressed
+zstd -d -f tmpSparseCompressed -o tmpSparseRegenerated
+$DIFF -s tmpSparseStored tmpSparseRegenerated
+zstd -f tmpSparseStored -o tmpSparseCompressed
+zstd -d -f --no-check tmpSparseCompressed -o tmpSparseRegenerated
+$DIFF -s tmpSparseStored tmpSparseRegenerated
+zstd -d -f --no-check -c tmpSparseCompressed tmpSparseCompressed > tmpSparseRegenerated
+cat tmpSparseStored tmpSparseStored | $DIFF -s - tmpSparseRegenerated
 rm -f tmpSparse*
 
 
@@ -1101,6 +1119,10 @@ zstd --train -B2K tmpCorpusHighCompress -o tmpDictHighCompress --memory=5MB 2> z
 cat zstTrainWithMemLimitStdErr | grep "setting manual memory limit for dictionary training data at 5 MB"
 cat zstTrainWithMemLimitStdErr | grep "Training samples set too large (12 MB); training on 5 MB only..."
 rm zstTrainWithMemLimitStdErr
+println "- Test sampling is reproducible"
+zstd --train -B2K tmpCorpusHighCompress -o tmpDictSampled --memory=5MB
+$DIFF tmpDictHighCompress tmpDictSampled
+rm -f tmp*
 
 println "\n===>  fastCover dictionary builder : advanced options "
 TESTFILE="$PRGDIR"/zstdcli.c
@@ -1136,6 +1158,13 @@ println "- Create dictionary using accel=10"
 zstd --train-fastcover=k=56,d=8,accel=10 -r "$TESTDIR"/*.c "$PRGDIR"/*.c
 println "- Create dictionary with multithreading"
 zstd --train-fastcover -T4 -r "$TESTDIR"/*.c "$PRGDIR"/*.c
+if [ -n "$hasMT" ]
+then
+  println "- Multithreaded frequency count gives the same dictionary"
+  zstd --train-fastcover=k=56,d=8,f=16 -T1 -r "$TESTDIR"/*.c "$PRGDIR"/*.c -o tmpDictT1
+  zstd --train-fastcover=k=56,d=8,f=16 -T4 -r "$TESTDIR"/*.c "$PRGDIR"/*.c -o tmpDictT4
+  $DIFF tmpDictT1 tmpDictT4
+fi
 println "- Test -o before --train-fastcover"
 rm -f tmpDict dictionary
 zstd -o tmpDict --train-fastcover=k=56,d=8 "$TESTDIR"/*.c "$PRGDIR"/*.c
@@ -1219,9 +1248,13 @@ println "bench negative level"
 zstd -bi0 --fast tmp1
 println "with recursive and quiet modes"
 zstd -rqi0b1e2 tmp1
+println "batch of small chunks"
+zstd -bi0 -B1KB --batch tmp1
+zstd -bi0 -B1KB --batch -T3 tmp1
 println "benchmark decompression only"
 zstd -f tmp1
 zstd -b -d -i0 tmp1.zst
+zstd -b -d -i0 --batch -T2 tmp1.zst
 println "benchmark can fail - decompression on invalid data"
 zstd -b -d -i0 tmp1 && die "invalid .zst data => benchmark should have failed"
 
@@ -1493,6 +1526,35 @@ then
     unset ZSTD_NBTHREADS
     rm -f mt_tmp*
 
+    println "\n===>  zstdmt multi-frame decompression tests "
+    datagen -g3M -s1 > tmp1
+    datagen -g2M -s2 > tmp2
+    zstd -q -f tmp1 tmp2
+    cat tmp1 | zstd -q > tmp_nosize.zst  # unknown size : streaming path
+    cat tmp1.zst tmp2.zst tmp_nosize.zst tmp1.zst tmp2.zst > tmp_multi.zst
+    cat tmp1 tmp2 tmp1 tmp1 tmp2 > tmp_multi
+    zstd -d -T4 -f tmp_multi.zst -o tmp_multi.out
+    $DIFF tmp_multi tmp_multi.out
+    zstd -d -T2 -c tmp_multi.zst | $DIFF - tmp_multi
+    zstd -d -T3 --memory=2MB -c tmp1.zst tmp2.zst > tmp_multi.out  # tmp1 is larger than the limit
+    cat tmp1 tmp2 | $DIFF - tmp_multi.out
+    zstd -t -T4 tmp_multi.zst
+    head -c 4000000 tmp_multi.zst > tmp_trunc.zst
+    zstd -d -T4 -c tmp_trunc.zst > $INTOVOID && die "truncated input should fail"
+    rm -f tmp1* tmp2* tmp_multi* tmp_nosize.zst tmp_trunc.zst
+    println "test : frames decoded in parallel stay within --memory"
+    for i in 1 2 3 4 5 6 7 8; do datagen -g1M -s$i > tmp_mem$i; done
+    zstd -q -f tmp_mem?
+    cat tmp_mem?.zst > tmp_mem.zst
+    cat tmp_mem? > tmp_mem
+    zstd -d -T8 --memory=3MB -vvvv -c tmp_mem.zst 2> tmp_mem.log > tmp_mem.out
+    $DIFF tmp_mem tmp_mem.out
+    grep "8 frames decoded by workers" tmp_mem.log
+    memKB=$(sed -n 's/.*decoded by workers, \([0-9]*\) KB.*/\1/p' tmp_mem.log)
+    # the limit, plus the compressed size of one frame
+    [ "$memKB" -le 4096 ] || die "multi-threaded decompression used $memKB KB with --memory=3MB"
+    rm -f tmp_mem*
+
     println "\n===>  ovLog tests "
     datagen -g2MB > tmp
     refSize=$(zstd tmp -6 -c --zstd=wlog=18         | wc -c)
@@ -1593,6 +1655,8 @@ zstd -f --trace tmp.trace -d tmp1.zst tmp2.zst tmp3.zst
 zstd -D tmp1 tmp2 -c | zstd --trace tmp.trace -t -D tmp1
 zstd -b1e10i0 --trace tmp.trace tmp1
 zstd -b1e10i0 --trace tmp.trace tmp1 tmp2 tmp3
+zstd -f --trace-blocks -d tmp1.zst tmp2.zst tmp3.zst
+zstd -f --trace-blocks --trace tmp.trace -t tmp1.zst
 
 rm -f tmp*
 
@@ -1666,6 +1730,22 @@ rm tmp1
 zstd -d tmp_compressed.zst --no-asyncio -c | $MD5SUM > tmp1
 $DIFF -q tmp1 tmp2
 
+println "test : asyncio from and to regular files, with sparse output"
+datagen -g1M > tmp_uncompressed
+dd bs=1048576 count=3 if=/dev/zero >> tmp_uncompressed
+datagen -g300K -s2 >> tmp_uncompressed
+zstd -q -f tmp_uncompressed -o tmp_compressed.zst
+zstd -d -q -f --asyncio --sparse tmp_compressed.zst -o tmp1
+$DIFF -s tmp1 tmp_uncompressed
+zstd -d -q -f --asyncio --no-sparse tmp_compressed.zst -o tmp1
+$DIFF -s tmp1 tmp_uncompressed
+zstd -d -q --asyncio --sparse -c tmp_compressed.zst tmp_compressed.zst > tmp1
+cat tmp_uncompressed tmp_uncompressed > tmp2
+$DIFF -s tmp1 tmp2
+zstd -q -f --asyncio tmp_uncompressed -o tmp1.zst
+zstd -q -f --no-asyncio tmp_uncompressed -o tmp2.zst
+$DIFF -s tmp1.zst tmp2.zst
+
 if [ "$1" != "--test-large-data" ]; then
     println "Skipping large data tests"
     exit 0
@@ -1691,6 +1771,18 @@ then
     roundTripTest -g10M " --rsyncable -B100K"
     println "===>   test: --rsyncable must fail with --single-thread"
     zstd -f -vv --rsyncable --single-thread tmp && die "--rsyncable must fail with --single-thread"
+
+    println "\n===>   compression memory limit "
+    roundTripTest -g30M " -T4 --memlimit-compress=12MB"
+    roundTripTest -g30M " -T4 --long --memlimit-compress=200MB"
+    println "===>   test: a memory limit keeps a set job size reproducible"
+    datagen -g8M > tmp
+    zstd -f -q -T4 -B1M tmp -o tmp1.zst
+    zstd -f -q -T4 -B1M --memlimit-compress=8MB tmp -o tmp2.zst
+    $DIFF tmp1.zst tmp2.zst
+    rm -f tmp1.zst tmp2.zst
+    println "===>   test: --memlimit-compress must fail with --single-thread"
+    zstd -f -vv --memlimit-compress=8MB --single-thread tmp && die "--memlimit-compress must fail with --single-thread"
 fi
 
 println "\n===> patch-from=origin tests"